@@ -0,0 +1,121 @@
+#include "AnimationClip.h"
+#include <DirectXPackedVector.h>
+
+using namespace std;
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+// Loads four consecutive normalized int16 values.
+inline XMVECTOR XM_CALLCONV LoadShortN4(const int16_t *src)
+{
+	return XMLoadShortN4(reinterpret_cast<const XMSHORTN4 *>(src));
+}
+
+// Loads four consecutive float values.
+inline XMVECTOR XM_CALLCONV LoadFloat4(const float *src)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4 *>(src));
+}
+
+AnimationClip::AnimationClip()
+	: mDuration(0.0f)
+	, mSampleRate(0.0f)
+	, mSampleCount(0)
+	, mJointCount(0)
+	, mJointStride(0)
+{
+
+}
+
+AnimationClip::~AnimationClip()
+{
+
+}
+
+void AnimationClip::SampleLocalPose(float time, AnimationPose *outLocalPose) const
+{
+	outLocalPose->mRotations.resize(mJointCount);
+	outLocalPose->mTranslations.resize(mJointCount);
+	outLocalPose->mScales.assign(mScales.begin(), mScales.end());
+	if (mSampleCount == 0) return;
+
+	// Find the two samples around the given time
+	float clipTime = (mDuration > 0.0f) ? fmodf(time, mDuration) : 0.0f;
+	if (clipTime < 0.0f) clipTime += mDuration;
+	float samplePosition = clipTime * mSampleRate;
+	UINT s0 = min((UINT)samplePosition, mSampleCount - 1);
+	UINT s1 = min(s0 + 1, mSampleCount - 1);
+	XMVECTOR alpha = XMVectorReplicate(samplePosition - (float)s0);
+
+	const int16_t *rot0 = &mRotations[s0 * 4 * mJointStride];
+	const int16_t *rot1 = &mRotations[s1 * 4 * mJointStride];
+	const float *tra0 = &mTranslations[s0 * 3 * mJointStride];
+	const float *tra1 = &mTranslations[s1 * 3 * mJointStride];
+	const UINT stride = mJointStride;
+
+	// Four joints at the time
+	for (UINT j = 0; j < mJointCount; j += 4)
+	{
+		// Rotations (normalized lerp, consecutive samples are baked in the same hemisphere)
+		XMVECTOR qx = XMVectorLerpV(LoadShortN4(rot0 + j), LoadShortN4(rot1 + j), alpha);
+		XMVECTOR qy = XMVectorLerpV(LoadShortN4(rot0 + stride + j), LoadShortN4(rot1 + stride + j), alpha);
+		XMVECTOR qz = XMVectorLerpV(LoadShortN4(rot0 + 2 * stride + j), LoadShortN4(rot1 + 2 * stride + j), alpha);
+		XMVECTOR qw = XMVectorLerpV(LoadShortN4(rot0 + 3 * stride + j), LoadShortN4(rot1 + 3 * stride + j), alpha);
+		XMVECTOR invLength = XMVectorReciprocalSqrt(qx * qx + qy * qy + qz * qz + qw * qw);
+		XMMATRIX rotations(qx * invLength, qy * invLength, qz * invLength, qw * invLength);
+		rotations = XMMatrixTranspose(rotations);
+
+		// Translations
+		XMVECTOR tx = XMVectorLerpV(LoadFloat4(tra0 + j), LoadFloat4(tra1 + j), alpha);
+		XMVECTOR ty = XMVectorLerpV(LoadFloat4(tra0 + stride + j), LoadFloat4(tra1 + stride + j), alpha);
+		XMVECTOR tz = XMVectorLerpV(LoadFloat4(tra0 + 2 * stride + j), LoadFloat4(tra1 + 2 * stride + j), alpha);
+		XMMATRIX translations(tx, ty, tz, XMVectorZero());
+		translations = XMMatrixTranspose(translations);
+
+		// Back to one transform per joint
+		UINT count = min(4U, mJointCount - j);
+		for (UINT k = 0; k < count; ++k)
+		{
+			XMStoreFloat4(&outLocalPose->mRotations[j + k], rotations.r[k]);
+			XMStoreFloat3(&outLocalPose->mTranslations[j + k], translations.r[k]);
+		}
+	}
+}
+
+void AnimationClip::LocalToModelPose(const AnimationPose &localPose, AnimationPose *outModelPose) const
+{
+	outModelPose->mRotations.resize(mJointCount);
+	outModelPose->mTranslations.resize(mJointCount);
+	outModelPose->mScales.resize(mJointCount);
+
+	// Parents are always processed before their children
+	for (UINT j = 0; j < mJointCount; ++j)
+	{
+		XMVECTOR r = XMLoadFloat4(&localPose.mRotations[j]);
+		XMVECTOR t = XMLoadFloat3(&localPose.mTranslations[j]);
+		float s = localPose.mScales[j];
+		int parentIndex = mParentIndices[j];
+		if (parentIndex != -1)
+		{
+			XMVECTOR parentR = XMLoadFloat4(&outModelPose->mRotations[parentIndex]);
+			XMVECTOR parentT = XMLoadFloat3(&outModelPose->mTranslations[parentIndex]);
+			float parentS = outModelPose->mScales[parentIndex];
+			t = XMVector3Rotate(t * parentS, parentR) + parentT;
+			r = XMQuaternionMultiply(r, parentR);
+			s *= parentS;
+		}
+		XMStoreFloat4(&outModelPose->mRotations[j], r);
+		XMStoreFloat3(&outModelPose->mTranslations[j], t);
+		outModelPose->mScales[j] = s;
+	}
+}
+
+int AnimationClip::GetJointIndex(const string &name) const
+{
+	for (UINT j = 0; j < mJointCount; ++j)
+	{
+		if (mJointNames[j].compare(name) == 0)
+			return (int)j;
+	}
+	return -1;
+}
@@ -0,0 +1,64 @@
+#ifndef ANIMATION_CLIP_H
+#define ANIMATION_CLIP_H
+
+#include <SpeckEngineDefinitions.h>
+
+// Pose of every joint of a clip. Depending on the call that filled it the
+// transforms are either relative to the parent joint or to the model.
+struct AnimationPose
+{
+	std::vector<DirectX::XMFLOAT4> mRotations;
+	std::vector<DirectX::XMFLOAT3> mTranslations;
+	std::vector<float> mScales;
+};
+
+// Animation baked into uniformly spaced samples of local joint transforms.
+// Runtime sampling does not depend on the FBX SDK.
+class AnimationClip
+{
+	friend class AnimationClipBaker;
+	friend class SpeckAssetFile;
+
+public:
+	AnimationClip();
+	~AnimationClip();
+
+	// Evaluates the local (parent relative) transforms of all joints at the given time.
+	// Time is wrapped around the clip duration.
+	void SampleLocalPose(float time, AnimationPose *outLocalPose) const;
+	// Concatenates the local transforms down the hierarchy.
+	void LocalToModelPose(const AnimationPose &localPose, AnimationPose *outModelPose) const;
+
+	float GetDuration() const { return mDuration; }
+	UINT GetJointCount() const { return mJointCount; }
+	int GetJointIndex(const std::string &name) const;
+	const std::string &GetJointName(UINT jointIndex) const { return mJointNames[jointIndex]; }
+	int GetParentIndex(UINT jointIndex) const { return mParentIndices[jointIndex]; }
+
+	// Raw baked data, used for serialization
+	float GetSampleRate() const { return mSampleRate; }
+	UINT GetSampleCount() const { return mSampleCount; }
+	UINT GetJointStride() const { return mJointStride; }
+	const std::vector<float> &GetScales() const { return mScales; }
+	const std::vector<int16_t> &GetRotations() const { return mRotations; }
+	const std::vector<float> &GetTranslations() const { return mTranslations; }
+
+private:
+	float mDuration;
+	float mSampleRate;
+	UINT mSampleCount;
+	UINT mJointCount;
+	// Joint count rounded up to the multiple of four so every sample can be processed four joints at the time.
+	UINT mJointStride;
+	// Parents always come before their children.
+	std::vector<int> mParentIndices;
+	std::vector<std::string> mJointNames;
+	// Local scale is not animated, only one uniform value per joint.
+	std::vector<float> mScales;
+	// For every sample: x, y, z and w components of all joints (SoA), normalized to the int16 range.
+	std::vector<int16_t> mRotations;
+	// For every sample: x, y and z components of all joints (SoA).
+	std::vector<float> mTranslations;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "AnimationClipBaker.h"
+#include "AnimationClip.h"
+#include "FBXConversions.h"
+
+using namespace std;
+using namespace DirectX;
+
+// Maps a value from the [-1, 1] range to the int16 range.
+inline int16_t QuantizeSNorm16(float value)
+{
+	value = max(-1.0f, min(1.0f, value));
+	return (int16_t)lroundf(value * 32767.0f);
+}
+
+void AnimationClipBaker::Bake(FbxScene *scene, FbxAnimStack *animStack, float sampleRate, AnimationClip *outClip, AnimationPose *outBindPose)
+{
+	// Flatten the node tree so that parents come before their children
+	vector<FbxNode *> nodes;
+	vector<int> parentIndices;
+	vector<pair<FbxNode *, int>> nodeStack;
+	nodeStack.push_back(make_pair(scene->GetRootNode(), -1));
+	while (!nodeStack.empty())
+	{
+		// Pop the last item on the stack
+		pair<FbxNode *, int> item = nodeStack.back();
+		nodeStack.pop_back();
+
+		int index = (int)nodes.size();
+		nodes.push_back(item.first);
+		parentIndices.push_back(item.second);
+		int numChildren = item.first->GetChildCount();
+		for (int i = 0; i < numChildren; i++)
+		{
+			nodeStack.push_back(make_pair(item.first->GetChild(i), index));
+		}
+	}
+
+	// Timing, samples are evenly spread so that the last one falls exactly on the end of the clip
+	scene->SetCurrentAnimationStack(animStack);
+	FbxTimeSpan timeSpan = animStack->GetLocalTimeSpan();
+	if (sampleRate <= 0.0f)
+		sampleRate = (float)FbxTime::GetFrameRate(scene->GetGlobalSettings().GetTimeMode());
+	float duration = (float)timeSpan.GetDuration().GetSecondDouble();
+	UINT sampleCount = (UINT)ceilf(duration * sampleRate) + 1;
+
+	AnimationClip &clip = *outClip;
+	clip.mDuration = duration;
+	clip.mSampleRate = (sampleCount > 1) ? (float)(sampleCount - 1) / duration : 0.0f;
+	clip.mSampleCount = sampleCount;
+	clip.mJointCount = (UINT)nodes.size();
+	clip.mJointStride = (clip.mJointCount + 3) & ~3U;
+	clip.mParentIndices = parentIndices;
+	clip.mJointNames.resize(clip.mJointCount);
+	for (UINT j = 0; j < clip.mJointCount; ++j)
+	{
+		clip.mJointNames[j] = nodes[j]->GetName();
+	}
+	clip.mScales.assign(clip.mJointCount, 1.0f);
+
+	// Padding joints hold the identity transform
+	const UINT stride = clip.mJointStride;
+	clip.mRotations.assign(sampleCount * 4 * stride, 0);
+	clip.mTranslations.assign(sampleCount * 3 * stride, 0.0f);
+	for (UINT s = 0; s < sampleCount; ++s)
+	{
+		for (UINT j = 0; j < stride; ++j)
+		{
+			clip.mRotations[(s * 4 + 3) * stride + j] = QuantizeSNorm16(1.0f);
+		}
+	}
+
+	// Sample every node
+	FbxAnimEvaluator* sceneEvaluator = scene->GetAnimationEvaluator();
+	vector<XMFLOAT4X4> globalTransforms(clip.mJointCount);
+	vector<XMFLOAT4> previousRotations(clip.mJointCount, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+	for (UINT s = 0; s < sampleCount; ++s)
+	{
+		// The local span of the stack does not necessarily start at zero
+		FbxTime sampleTime;
+		sampleTime.SetSecondDouble((sampleCount > 1) ? (double)s / (double)clip.mSampleRate : 0.0);
+		sampleTime += timeSpan.GetStart();
+		int16_t *rotations = &clip.mRotations[s * 4 * stride];
+		float *translations = &clip.mTranslations[s * 3 * stride];
+
+		for (UINT j = 0; j < clip.mJointCount; ++j)
+		{
+			Conv(&globalTransforms[j], sceneEvaluator->GetNodeGlobalTransform(nodes[j], sampleTime));
+
+			// Transform relative to the parent
+			XMMATRIX local = XMLoadFloat4x4(&globalTransforms[j]);
+			int parentIndex = parentIndices[j];
+			if (parentIndex != -1)
+			{
+				XMVECTOR det;
+				XMMATRIX parentInv = XMMatrixInverse(&det, XMLoadFloat4x4(&globalTransforms[parentIndex]));
+				local = XMMatrixMultiply(local, parentInv);
+			}
+			XMVECTOR sca, rot, tra;
+			XMMatrixDecompose(&sca, &rot, &tra, local);
+
+			// Keep consecutive samples in the same hemisphere so that the sampler can lerp without checks
+			XMVECTOR previousRot = XMLoadFloat4(&previousRotations[j]);
+			if (XMVectorGetX(XMQuaternionDot(rot, previousRot)) < 0.0f)
+				rot = XMVectorNegate(rot);
+			XMStoreFloat4(&previousRotations[j], rot);
+
+			// Store
+			XMFLOAT4 rotF;
+			XMStoreFloat4(&rotF, rot);
+			rotations[j] = QuantizeSNorm16(rotF.x);
+			rotations[stride + j] = QuantizeSNorm16(rotF.y);
+			rotations[2 * stride + j] = QuantizeSNorm16(rotF.z);
+			rotations[3 * stride + j] = QuantizeSNorm16(rotF.w);
+			XMFLOAT3 traF;
+			XMStoreFloat3(&traF, tra);
+			translations[j] = traF.x;
+			translations[stride + j] = traF.y;
+			translations[2 * stride + j] = traF.z;
+			if (s == 0)
+			{
+				XMFLOAT3 scaF;
+				XMStoreFloat3(&scaF, sca);
+				clip.mScales[j] = (scaF.x + scaF.y + scaF.z) / 3.0f;
+			}
+		}
+	}
+
+	// Bind pose
+	if (outBindPose)
+	{
+		outBindPose->mRotations.resize(clip.mJointCount);
+		outBindPose->mTranslations.resize(clip.mJointCount);
+		outBindPose->mScales.resize(clip.mJointCount);
+		for (UINT j = 0; j < clip.mJointCount; ++j)
+		{
+			XMFLOAT4X4 nodeTransformF;
+			Conv(&nodeTransformF, sceneEvaluator->GetNodeGlobalTransform(nodes[j]));
+			XMVECTOR sca, rot, tra;
+			XMMatrixDecompose(&sca, &rot, &tra, XMLoadFloat4x4(&nodeTransformF));
+			XMStoreFloat4(&outBindPose->mRotations[j], rot);
+			XMStoreFloat3(&outBindPose->mTranslations[j], tra);
+			outBindPose->mScales[j] = (XMVectorGetX(sca) + XMVectorGetY(sca) + XMVectorGetZ(sca)) / 3.0f;
+		}
+	}
+}
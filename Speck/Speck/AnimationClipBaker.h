@@ -0,0 +1,24 @@
+#ifndef ANIMATION_CLIP_BAKER_H
+#define ANIMATION_CLIP_BAKER_H
+
+#include <SpeckEngineDefinitions.h>
+
+namespace fbxsdk
+{
+	class FbxScene;
+	class FbxAnimStack;
+}
+
+class AnimationClip;
+struct AnimationPose;
+
+// Converts FBX animation stacks to animation clips.
+class AnimationClipBaker
+{
+public:
+	// Samples every node of the scene at the given rate (or at the scene frame rate if the rate is zero).
+	// Optionally outputs the model space transforms of the joints when no animation is applied.
+	static void Bake(fbxsdk::FbxScene *scene, fbxsdk::FbxAnimStack *animStack, float sampleRate, AnimationClip *outClip, AnimationPose *outBindPose = nullptr);
+};
+
+#endif
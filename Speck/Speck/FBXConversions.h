@@ -0,0 +1,53 @@
+#ifndef FBX_CONVERSIONS_H
+#define FBX_CONVERSIONS_H
+
+#include <SpeckEngineDefinitions.h>
+
+// FBX
+#pragma warning( push )
+#pragma warning( disable : 4244 )  
+#include <fbxsdk.h>
+#pragma warning( pop )
+
+inline void Conv(fbxsdk::FbxDouble3 *out, const DirectX::XMFLOAT3 &in)
+{
+	out->mData[0] = in.x;
+	out->mData[1] = in.y;
+	out->mData[2] = in.z;
+}
+
+inline void Conv(DirectX::XMFLOAT3 *out, const fbxsdk::FbxDouble3 &in)
+{
+	out->x = (float)in.mData[0];
+	out->y = (float)in.mData[1];
+	out->z = (float)in.mData[2];
+}
+
+inline void Conv(DirectX::XMFLOAT4 *out, const fbxsdk::FbxDouble4 &in)
+{
+	out->x = (float)in.mData[0];
+	out->y = (float)in.mData[1];
+	out->z = (float)in.mData[2];
+	out->w = (float)in.mData[3];
+}
+
+inline void Conv(DirectX::XMFLOAT4 *out, const fbxsdk::FbxQuaternion &in)
+{
+	out->x = (float)in.mData[0];
+	out->y = (float)in.mData[1];
+	out->z = (float)in.mData[2];
+	out->w = (float)in.mData[3];
+}
+
+inline void Conv(DirectX::XMFLOAT4X4 *out, const fbxsdk::FbxDouble4x4 &in)
+{
+	for (UINT i = 0; i < 4; i++)
+	{
+		for (UINT j = 0; j < 4; j++)
+		{
+			out->m[i][j] = (float)in[i][j];
+		}
+	}
+}
+
+#endif
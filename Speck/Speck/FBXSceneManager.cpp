@@ -1,6 +1,9 @@
 
 #include "FBXSceneManager.h"
 #include <SpeckEngineDefinitions.h>
+#include "SkeletonTemplate.h"
+#include "SpeckAssetFile.h"
+#include "SpeckAssetCooker.h"
 
 // FBX
 #pragma warning( push )
@@ -15,15 +18,7 @@ FBXSceneManager::FBXSceneManager()
 	: mSDKManager(nullptr)
 	, mIOs(nullptr)
 {
-	// Create the FBX SDK manager
-	mSDKManager = FbxManager::Create();
-
-	// Create an IOSettings object.
-	mIOs = FbxIOSettings::Create(mSDKManager, IOSROOT);
-	mSDKManager->SetIOSettings(mIOs);
-
-	// ... Configure the FbxIOSettings object ...
-
+	// The FBX SDK manager is created on the first scene import (only when cooking)
 }
 
 FBXSceneManager::~FBXSceneManager()
@@ -55,6 +50,18 @@ FbxScene * FBXSceneManager::GetScene(const wchar_t * filePath)
 	map<wstring, FbxScene *>::iterator it = mScenes.find(filePath);
 	if (it == mScenes.end())
 	{
+		if (!mSDKManager)
+		{
+			// Create the FBX SDK manager
+			mSDKManager = FbxManager::Create();
+
+			// Create an IOSettings object.
+			mIOs = FbxIOSettings::Create(mSDKManager, IOSROOT);
+			mSDKManager->SetIOSettings(mIOs);
+
+			// ... Configure the FbxIOSettings object ...
+		}
+
 		// Create an importer.
 		FbxImporter* lImporter = FbxImporter::Create(mSDKManager, "");
 
@@ -162,3 +169,40 @@ FbxScene * FBXSceneManager::FixSceneSaveScene(const wchar_t * filePath)
 		return nullptr;
 	}
 }
+
+const SkeletonTemplate * FBXSceneManager::GetSkeletonTemplate(const wchar_t * fbxFilePath, const wchar_t * speckStructure)
+{
+	pair<wstring, wstring> key(fbxFilePath, speckStructure);
+	auto it = mSkeletonTemplates.find(key);
+	if (it == mSkeletonTemplates.end())
+	{
+		// Use the cooked package next to the FBX file, cook it first if it is missing or older than the FBX file
+		wstring assetFilePath(fbxFilePath);
+		size_t extensionPos = assetFilePath.rfind(L'.');
+		if (extensionPos != wstring::npos) assetFilePath.erase(extensionPos);
+		assetFilePath += L".speckasset";
+		SpeckAssetCooker::CookIfOutdated(this, fbxFilePath, assetFilePath.c_str());
+		SpeckAssetFile asset;
+		if (!asset.Open(assetFilePath.c_str()))
+		{
+			LOG(TEXT("Could not load the speck asset: ") + assetFilePath, ERROR);
+			return nullptr;
+		}
+
+		unique_ptr<SkeletonTemplate> skeletonTemplate = make_unique<SkeletonTemplate>();
+		if (!skeletonTemplate->Build(asset, speckStructure))
+		{
+			LOG(TEXT("Could not build the skeleton template: ") + assetFilePath, ERROR);
+			return nullptr;
+		}
+
+		// save it to the map
+		const SkeletonTemplate *result = skeletonTemplate.get();
+		mSkeletonTemplates[key] = move(skeletonTemplate);
+		return result;
+	}
+	else
+	{
+		return it->second.get();
+	}
+}
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <string>
+#include <memory>
 
 namespace fbxsdk
 {
@@ -10,6 +11,8 @@ namespace fbxsdk
 	class FbxIOSettings;
 }
 
+class SkeletonTemplate;
+
 class FBXSceneManager
 {
 public:
@@ -17,11 +20,15 @@ public:
 	~FBXSceneManager();
 
 	fbxsdk::FbxManager *GetFBXSDKManager() { return mSDKManager; }
+	// Imports the scene on first use, the FBX SDK manager is created with the first scene.
 	fbxsdk::FbxScene *GetScene(const wchar_t* filePath);
 	fbxsdk::FbxScene *FixSceneSaveScene(const wchar_t* filePath);
+	// Builds the template from the cooked .speckasset file on first use, afterwards the same one is returned for the same pair of files.
+	const SkeletonTemplate *GetSkeletonTemplate(const wchar_t* fbxFilePath, const wchar_t* speckStructure);
 
 private:
 	fbxsdk::FbxManager *mSDKManager;
 	fbxsdk::FbxIOSettings * mIOs;
 	std::map<std::wstring, fbxsdk::FbxScene *> mScenes;
+	std::map<std::pair<std::wstring, std::wstring>, std::unique_ptr<SkeletonTemplate>> mSkeletonTemplates;
 };
@@ -4,243 +4,35 @@
 #include <App.h>
 
 #include "SpeckPrimitivesGenerator.h"
-#include "Json.h"
 #include "FBXSceneManager.h"
-
-// FBX
-#pragma warning( push )
-#pragma warning( disable : 4244 )  
-#include <fbxsdk.h>
-#include <fbxsdk\utils\fbxgeometryconverter.h>
-#pragma warning( pop )
+#include "SkeletonTemplate.h"
+#include <WorkerPool.h>
+#include <Profiler.h>
 
 using namespace std;
 using namespace DirectX;
 using namespace Speck;
-using json = nlohmann::json;
-
-void Conv(fbxsdk::FbxDouble3 *out, const DirectX::XMFLOAT3 &in)
-{
-	out->mData[0] = in.x;
-	out->mData[1] = in.y;
-	out->mData[2] = in.z;
-}
-
-void Conv(DirectX::XMFLOAT3 *out, const fbxsdk::FbxDouble3 &in)
-{
-	out->x = (float)in.mData[0];
-	out->y = (float)in.mData[1];
-	out->z = (float)in.mData[2];
-}
-
-void Conv(DirectX::XMFLOAT4 *out, const fbxsdk::FbxDouble4 &in)
-{
-	out->x = (float)in.mData[0];
-	out->y = (float)in.mData[1];
-	out->z = (float)in.mData[2];
-	out->w = (float)in.mData[3];
-}
-
-void Conv(DirectX::XMFLOAT4 *out, const fbxsdk::FbxQuaternion &in)
-{
-	out->x = (float)in.mData[0];
-	out->y = (float)in.mData[1];
-	out->z = (float)in.mData[2];
-	out->w = (float)in.mData[3];
-}
-
-void Conv(DirectX::XMFLOAT4X4 *out, const fbxsdk::FbxDouble4x4 &in)
-{
-	for (UINT i = 0; i < 4; i++)
-	{
-		for (UINT j = 0; j < 4; j++)
-		{
-			out->m[i][j] = (float)in[i][j];
-		}
-	}
-}
-
-bool operator==(const AppCommands::StaticMeshVertex &left, const AppCommands::StaticMeshVertex &right)
-{
-	if (left.Normal == right.Normal &&
-		left.Position == right.Position &&
-		left.TangentU == right.TangentU &&
-		left.TexC == right.TexC)
-		return true;
-	else
-		return false;
-}
-
-bool operator==(const AppCommands::SkinnedMeshVertex &left, const AppCommands::SkinnedMeshVertex &right)
-{
-	if (left.Normal[0] == right.Normal[0] &&
-		left.Position[0] == right.Position[0] &&
-		left.TangentU[0] == right.TangentU[0] &&
-		left.TexC == right.TexC)
-		return true;
-	else
-		return false;
-}
-
-void HumanoidSkeleton::ProcessBone(FbxNode *node, WorldCommands::AddSpecksCommand *outCommand, const string &boneName)
-{
-	// FBX
-	FbxAMatrix world = node->EvaluateGlobalTransform();
-	XMFLOAT4X4 worldF;
-	Conv(&worldF, world);
-	XMMATRIX worldXM = XMLoadFloat4x4(&worldF);
-	XMVECTOR s, r, t;
-	XMMatrixDecompose(&s, &r, &t, worldXM);
-	XMMATRIX worldWithoutScale = XMMatrixRotationQuaternion(r) * XMMatrixTranslationFromVector(t);
-
-	// Calculate the center of mass
-	XMVECTOR com = XMVectorZero();
-	for (int i = 0; i < outCommand->newSpecks.size(); i++)
-	{
-		com += XMLoadFloat3(&outCommand->newSpecks[i].position);
-	}
-	com /= (float)outCommand->newSpecks.size();
-
-	// Calculate local transform
-	FbxVector4 sca = world.GetS();
-	XMVECTOR invSca = XMVectorSet(1.0f / (float)sca[0], 1.0f / (float)sca[1], 1.0f / (float)sca[2], 1.0f);
-	FbxQuaternion rot = world.GetQ();
-	rot.Inverse();
-	XMFLOAT4 rotF;
-	Conv(&rotF, rot);
-	XMVECTOR rotV = XMLoadFloat4(&rotF);
-	XMMATRIX rotM = XMMatrixRotationQuaternion(rotV);
-	XMMATRIX local = XMMatrixTranslationFromVector(com);
-
-	// Transfrom with the node transform matrix
-	for (int i = 0; i < outCommand->newSpecks.size(); ++i)
-	{
-		XMVECTOR posFinal = XMVector3TransformCoord(XMLoadFloat3(&outCommand->newSpecks[i].position), worldWithoutScale);
-		XMStoreFloat3(&outCommand->newSpecks[i].position, posFinal);
-	}
-
-	// Add the node to the world
-	WorldCommands::AddSpecksCommandResult commandResult;
-	if (outCommand->newSpecks.size() > 0)
-	{
-		GetWorld().ExecuteCommand(*outCommand, &commandResult);
-		mNodesAnimData[boneName].index = commandResult.rigidBodyIndex;
-		mNodesParents[boneName] = boneName;
-	}
-	mNodesAnimData[boneName].numberOfSpecks = (UINT)outCommand->newSpecks.size();
-	XMStoreFloat3(&mNodesAnimData[boneName].centerOfMass, com);
-	XMStoreFloat3(&mNodesAnimData[boneName].inverseScale, invSca);
-	mNodesAnimData[boneName].inverseRotation = rotF;
-	XMStoreFloat4x4(&mNodesAnimData[boneName].bindPoseWorldTransform, worldWithoutScale);
-}
 
 void HumanoidSkeleton::CreateSpecksBody(Speck::App *pApp, bool useSkinning)
 {
-	// Parse the JSON file
-	json j;
-	try
-	{
-		j = json::parse(mSpeckBodyStructureJSONFile);
-	}
-	catch (const exception& ex)
-	{
-		(void)ex; // Mark the object as "used" by casting it to void. It has no influence on the generated machine code, but it will suppress the compiler warning.
-		LOG(TEXT("Exception caught while parsing a json file: ") + StrToWStr(mName) + TEXT(" ."), WARNING);
-		LOG(StrToWStr(ex.what()), ERROR);
-	}
-
 	// some constants
 	const float speckMass = 2.0f;
 	const float frictionCoefficient = 0.8f;
-	mSpeckCount = 0;
-
-	// Create a body made out of specks
-	int numStacks = mScene->GetSrcObjectCount<FbxAnimStack>();
-	FbxAnimStack* pAnimStack = FbxCast<FbxAnimStack>(mScene->GetSrcObject<FbxAnimStack>(0));
-	vector<FbxNode *> nodeStack;
-	FbxNode *root = mScene->GetRootNode();
-	nodeStack.push_back(root);
-
-	// Body creation logic
-	FbxNode *skinNode = nullptr;
-
-	while (!nodeStack.empty())
+	mSpeckCount = (int)mTemplate->GetSpeckCount();
+
+	// Create the bones
+	const vector<SkeletonTemplate::Bone> &bones = mTemplate->GetBones();
+	mRigidBodyIndices.resize(bones.size());
+	WorldCommands::AddSpecksCommand command;
+	command.speckType = WorldCommands::SpeckType::RigidBody;
+	command.speckMass = speckMass;
+	command.frictionCoefficient = frictionCoefficient;
+	for (size_t i = 0; i < bones.size(); ++i)
 	{
-		// Pop the last item on the stack
-		FbxNode *node = *(nodeStack.end() - 1);
-		nodeStack.pop_back();
-
-		//FbxNodeAttribute* lNodeAttribute = node->GetNodeAttribute();
-		string boneName = node->GetName();
-		WorldCommands::AddSpecksCommand command;
-		command.speckType = WorldCommands::SpeckType::RigidBody;
-		command.speckMass = speckMass;
-		command.frictionCoefficient = frictionCoefficient;
-
-		// find the name in the json
-		bool boneFound = false;
-		json::iterator it = j.find("bones");
-		if (it != j.end())
-		{
-			json list = it.value();
-			for (json::iterator listIt = list.begin(); listIt != list.end(); ++listIt)
-			{
-				// first check if there is the name we are looking for in this json bone
-				json jsonBone = listIt.value();
-				json jsonBoneNamesList = jsonBone.at("bones").get<json>();
-				string jsonBoneName = "";
-				for (json::iterator boneNamesListIt = jsonBoneNamesList.begin(); boneNamesListIt != jsonBoneNamesList.end(); ++boneNamesListIt)
-				{
-					jsonBoneName = boneNamesListIt.value().get<string>();
-					if (boneName.compare(jsonBoneName) == 0)
-					{
-						boneFound = true;
-						break;
-					}
-				}
-
-				// this is the one from the stack
-				if (boneFound)
-				{
-					WorldCommands::NewSpeck speck;
-					json speckPositionsList = jsonBone.at("specks").get<json>();
-					for (json::iterator speckPositionsListIt = speckPositionsList.begin(); speckPositionsListIt != speckPositionsList.end(); ++speckPositionsListIt)
-					{
-						json speckPosition = speckPositionsListIt.value();
-						speck.position.x = speckPosition.at("x").get<float>();
-						speck.position.y = speckPosition.at("y").get<float>();
-						speck.position.z = speckPosition.at("z").get<float>();
-						command.newSpecks.push_back(speck);
-					}
-
-					mSpeckCount += (int)command.newSpecks.size();
-					ProcessBone(node, &command, jsonBoneName);
-					break;
-				}
-			}
-		}
-
-		if (!boneFound)
-		{
-			FbxNode *parentNode = node->GetParent();
-			if (parentNode)
-			{
-				string parentNodeName = parentNode->GetName(); // parent has already been processed
-				mNodesParents[boneName] = mNodesParents[parentNodeName];
-			}
-		}
-
-		int numChildren = node->GetChildCount();
-		for (int i = 0; i < numChildren; i++)
-		{
-			FbxNode *childNode = node->GetChild(i);
-			nodeStack.push_back(childNode);
-		}
-
-		if (boneName.find("Guard02") != string::npos)
-		{
-			skinNode = node;
-		}
+		WorldCommands::AddSpecksCommandResult commandResult;
+		command.newSpecks = bones[i].specks;
+		GetWorld().ExecuteCommand(command, &commandResult);
+		mRigidBodyIndices[i] = commandResult.rigidBodyIndex;
 	}
 
 	// connect the bones
@@ -248,384 +40,62 @@ void HumanoidSkeleton::CreateSpecksBody(Speck::App *pApp, bool useSkinning)
 	commandForJoint.speckType = WorldCommands::SpeckType::RigidBodyJoint;
 	commandForJoint.speckMass = speckMass;
 	commandForJoint.frictionCoefficient = frictionCoefficient;
-	json::iterator it = j.find("joints");
-	
-	//return;
-	
-	if (it != j.end())
+	for (const SkeletonTemplate::Joint &joint : mTemplate->GetJoints())
 	{
-		json list = it.value();
-		for (json::iterator listIt = list.begin(); listIt != list.end(); ++listIt)
-		{
-			json jsonJoint = listIt.value();
-			json pairsList = jsonJoint.find("pairs").value();
-			for (json::iterator pairListIt = pairsList.begin(); pairListIt != pairsList.end(); ++pairListIt)
-			{
-				json pair = pairListIt.value();
-				string jsonJointParentBoneName = pair.at("parentBoneName").get<string>();
-				string jsonJointChildBoneName = pair.at("childBoneName").get<string>();
-				auto parentIte = mNodesAnimData.find(jsonJointParentBoneName);
-				auto childIte = mNodesAnimData.find(jsonJointChildBoneName);
-
-				if (parentIte != mNodesAnimData.end() && childIte != mNodesAnimData.end())
-				{
-					int parentRBIndex = parentIte->second.index;
-					int childRBIndex = childIte->second.index;
-					commandForJoint.rigidBodyJoint.rigidBodyIndex[0] = parentRBIndex;
-					commandForJoint.rigidBodyJoint.rigidBodyIndex[1] = childRBIndex;
-					XMMATRIX parentWorldBindPose = XMLoadFloat4x4(&parentIte->second.bindPoseWorldTransform);
-					XMVECTOR det;
-					XMMATRIX parentWorldBindPoseInv = XMMatrixInverse(&det, parentWorldBindPose);
-					XMMATRIX childWorldBindPose = XMLoadFloat4x4(&childIte->second.bindPoseWorldTransform);
-					XMMATRIX childLocalSpaceToParentLocalSpace = childWorldBindPose * parentWorldBindPoseInv;
-
-					XMVECTOR parentCOM = XMLoadFloat3(&parentIte->second.centerOfMass) * (float)parentIte->second.numberOfSpecks;
-					XMVECTOR childCOM = XMLoadFloat3(&childIte->second.centerOfMass) * (float)childIte->second.numberOfSpecks;
-
-					// for every speck
-					WorldCommands::NewSpeck speck;
-					commandForJoint.newSpecks.clear();
-					json speckPositionsList = jsonJoint.at("specks").get<json>();
-					for (json::iterator speckPositionsListIt = speckPositionsList.begin(); speckPositionsListIt != speckPositionsList.end(); ++speckPositionsListIt)
-					{
-						// load it
-						json speckPosition = speckPositionsListIt.value();
-						speck.position.x = speckPosition.at("x").get<float>();
-						speck.position.y = speckPosition.at("y").get<float>();
-						speck.position.z = speckPosition.at("z").get<float>();
-						XMVECTOR jointPosChildLocalSpace = XMLoadFloat3(&speck.position);
-
-						// update the rigid body bones with the mass distribution information
-						parentCOM += XMVector3TransformCoord(jointPosChildLocalSpace, childLocalSpaceToParentLocalSpace);
-						childCOM += jointPosChildLocalSpace;
-						parentIte->second.numberOfSpecks += 1;
-						childIte->second.numberOfSpecks += 1;
-
-						// transform it
-						XMVECTOR jointPosW = XMVector3TransformCoord(jointPosChildLocalSpace, childWorldBindPose);
-						XMStoreFloat3(&speck.position, jointPosW);
-
-						// save it
-						commandForJoint.newSpecks.push_back(speck);
-					}
-
-					// calculate the new center of mass and store it
-					parentCOM = parentCOM / (float)parentIte->second.numberOfSpecks;
-					childCOM = childCOM / (float)childIte->second.numberOfSpecks;
-					XMStoreFloat3(&parentIte->second.centerOfMass, parentCOM);
-					XMStoreFloat3(&childIte->second.centerOfMass, childCOM);
-
-					// should use SDF gradient?
-					commandForJoint.rigidBodyJoint.calculateSDFGradient = (commandForJoint.newSpecks.size() > 2);
-
-					mSpeckCount += (int)commandForJoint.newSpecks.size();
-					GetWorld().ExecuteCommand(commandForJoint);
-				}
-			}
-		}
-	}
+		commandForJoint.rigidBodyJoint.rigidBodyIndex[0] = mRigidBodyIndices[joint.parentBone];
+		commandForJoint.rigidBodyJoint.rigidBodyIndex[1] = mRigidBodyIndices[joint.childBone];
+		commandForJoint.newSpecks = joint.specks;
 
-	if (skinNode && useSkinning)
-	{
-		ProcessRenderSkin(skinNode, pApp);
+		// should use SDF gradient?
+		commandForJoint.rigidBodyJoint.calculateSDFGradient = (commandForJoint.newSpecks.size() > 2);
+		GetWorld().ExecuteCommand(commandForJoint);
 	}
-}
 
-template <int size> struct VertexSkinningData
-{
-	static const int maxSize = size;
-	UINT count = 0;
-	int bones[size];
-	float weights[size];
-};
-
-void HumanoidSkeleton::ProcessRenderSkin(fbxsdk::FbxNode * node, App *pApp)
-{
-	FbxMesh *meshPt = node->GetMesh();
-	bool triMesh = meshPt->IsTriangleMesh();
-	FbxAMatrix world = node->EvaluateGlobalTransform();
-
-	FbxStringList pUVSetNameList;
-	meshPt->GetUVSetNames(pUVSetNameList);
-
-	AppCommands::CreateSkinnedGeometryCommand csgc;
-	csgc.geometryName = node->GetName();
-	csgc.meshName = meshPt->GetName();
-
-	// for each polygon
-	FbxVector4* controlPoints = meshPt->GetControlPoints();
-	int polyCount = meshPt->mPolygons.GetCount();
-	int *controlPointVertices = meshPt->GetPolygonVertices();
-	int controlPointCount = meshPt->GetControlPointsCount();
-	vector<set<int>> controlPointIndexToLocalBufferVertexIndexSet(controlPointCount);
-	for (int i = 0; i < polyCount; i++)
+	// Find the bones driven by the animation
+	mAnimatedRigidBodies.clear();
+	for (size_t i = 0; i < bones.size(); ++i)
 	{
-		// for each triangle
-		int polyVertCount = meshPt->GetPolygonSize(i);
-		for (int j = 0; j < polyVertCount; j++)
-		{
-			AppCommands::SkinnedMeshVertex vert;
-			int cpIndex = meshPt->GetPolygonVertex(i, j);
-
-			controlPoints[cpIndex].mData[3] = 1.0f;
-			FbxVector4 pos = world.MultT(controlPoints[cpIndex]);
-			vert.Position[0] = XMFLOAT4((float)pos.mData[0], (float)pos.mData[1], (float)pos.mData[2], 1.0f);
-
-			FbxVector4 pNormal;
-			meshPt->GetPolygonVertexNormal(i, j, pNormal);
-			vert.Normal[0] = XMFLOAT3((float)pNormal.mData[0], (float)pNormal.mData[1], (float)pNormal.mData[2]);
-
-			FbxVector2 pUV;
-			bool hasUV = false, retVal = false;
-			for (int k = 0; k < pUVSetNameList.GetCount(); k++)
-			{
-				retVal = meshPt->GetPolygonVertexUV(i, j, pUVSetNameList[k], pUV, hasUV);
-				if (retVal) break;
-			}
-			if (retVal)
-				vert.TexC = XMFLOAT2((float)pUV.mData[0], (float)pUV.mData[1]);
-
-			// Is it already in
-			int size = (int)csgc.vertices.size();
-			int vertI;
-			for (vertI = 0; vertI < size; vertI++)
-			{
-				if (vert == csgc.vertices[vertI])
-				{
-					break;
-				}
-			}
-
-			// Add to command lists
-			if (vertI == size)
-			{
-				csgc.vertices.push_back(vert);
-				auto &vertexIndexSet = controlPointIndexToLocalBufferVertexIndexSet[cpIndex];
-				vertexIndexSet.insert(vertI);
-			}
-			csgc.indices.push_back((uint32_t)vertI);
-		}
+		if (bones[i].clipJointIndex == -1) continue;
+		AnimatedRigidBody arb;
+		arb.jointIndex = (UINT)bones[i].clipJointIndex;
+		arb.rigidBodyIndex = mRigidBodyIndices[i];
+		arb.centerOfMass = bones[i].centerOfMass;
+		arb.inverseRotation = bones[i].inverseRotation;
+		mAnimatedRigidBodies.push_back(arb);
 	}
+	mRigidBodyTransforms.assign(mAnimatedRigidBodies.size(), Transform::Identity());
 
-	// get skinning data
-	map<UINT, XMMATRIX> rigidBodyInverseBindPoseMap;
-	vector<VertexSkinningData<10>> verticesSkinningData;
-	verticesSkinningData.resize(csgc.vertices.size());
-	int nDeformers = meshPt->GetDeformerCount();
-	FbxSkin *pSkin = (FbxSkin*)meshPt->GetDeformer(0, FbxDeformer::eSkin);
-
-	// iterate bones
-	int ncBones = pSkin->GetClusterCount();
-	for (int boneIndex = 0; boneIndex < ncBones; ++boneIndex)
+	const AppCommands::CreateSkinnedGeometryCommand *skinMesh = mTemplate->GetSkinMesh();
+	if (skinMesh && useSkinning)
 	{
-		// cluster
-		FbxCluster* cluster = pSkin->GetCluster(boneIndex);
-
-		// bone ref
-		FbxNode* pBone = cluster->GetLink();
-		string boneName = pBone->GetName();
-		NodeAnimData *nodeAnimData = &mNodesAnimData[boneName];
-		if (nodeAnimData->index == -1) nodeAnimData = &mNodesAnimData[mNodesParents[boneName]];
-
-		// get the bind pose
-		FbxAMatrix bindPoseMatrix, transformMatrix;
-		cluster->GetTransformMatrix(transformMatrix);
-		cluster->GetTransformLinkMatrix(bindPoseMatrix);
-		XMFLOAT4X4 bindPoseMatrixF;
-		Conv(&bindPoseMatrixF, bindPoseMatrix);
-		XMMATRIX bindPose = XMLoadFloat4x4(&bindPoseMatrixF);
-
-		// get the inverse local transform
-		XMVECTOR inverseLocalTranslation = XMLoadFloat3(&nodeAnimData->centerOfMass);
-		XMVECTOR inverseLocalRotation = XMLoadFloat4(&nodeAnimData->inverseRotation);
-		XMVECTOR inverseLocalScale = XMLoadFloat3(&nodeAnimData->inverseScale);
-		XMMATRIX inverseLocalTransform = XMMatrixTranslationFromVector(inverseLocalTranslation) * XMMatrixRotationQuaternion(inverseLocalRotation) * XMMatrixScalingFromVector(inverseLocalScale);
-
-		// get the inverse 'offset matrix' without scale
-		XMMATRIX w = XMMatrixMultiply(inverseLocalTransform, bindPose);
-		XMVECTOR s, r, t;
-		XMMatrixDecompose(&s, &r, &t, w);
-		XMMATRIX wWithoutScale = XMMatrixRotationQuaternion(r) * XMMatrixTranslationFromVector(t);
-		XMVECTOR det;
-		XMMATRIX invW = XMMatrixInverse(&det, wWithoutScale);
-		rigidBodyInverseBindPoseMap[nodeAnimData->index] = invW;
-
-		// Iterate through all the control points that are affected by the bone
-		int *pVertexIndices = cluster->GetControlPointIndices();
-		double *pVertexWeights = cluster->GetControlPointWeights();
-		int ncVertexIndices = cluster->GetControlPointIndicesCount();
-		for (int iBoneVertexIndex = 0; iBoneVertexIndex < ncVertexIndices; iBoneVertexIndex++)
-		{
-			int cpIndex = pVertexIndices[iBoneVertexIndex];
-			float fWeight = (float)pVertexWeights[iBoneVertexIndex];
-
-			auto &vertexIndexSet = controlPointIndexToLocalBufferVertexIndexSet[cpIndex];
-			// for every vertex using this control point
-			for (set<int>::iterator vertIt = vertexIndexSet.begin(); vertIt != vertexIndexSet.end(); ++vertIt)
-			{
-				int niVertex = *vertIt;
-				auto &vsd = verticesSkinningData[niVertex];
-				assert(vsd.count < vsd.maxSize);
-				// instead of the bone index, put rigidBodyIndex
-				vsd.bones[vsd.count] = nodeAnimData->index;
-				vsd.weights[vsd.count] = fWeight;
-				++vsd.count;
-			}
-		}
-	}
-
-	// for each vertex migrate the weights (choose only 4 strongest weights)
-	for (int i = 0; i < (int)csgc.vertices.size(); ++i)
-	{
-		AppCommands::SkinnedMeshVertex &vert = csgc.vertices[i];
-		float weights[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-		int newArray[] = { 0, 0, 0, 0 };
-		memcpy(vert.BoneIndices, newArray, sizeof(int) * 4);
-		auto &vertSkinningData = verticesSkinningData[i];
-		float weightSum = 0.0f;
-
-		// populate with weights
-		for (int j = 0; j < MAX_BONES_PER_VERTEX; ++j)
-		{
-			// find the greatest weight
-			float greatestWeight = 0.0f;
-			int greatestWeightIndex = -1;
-			for (int k = 0; k < (int)vertSkinningData.count; k++)
-			{
-				if (greatestWeight < vertSkinningData.weights[k])
-				{
-					greatestWeight = vertSkinningData.weights[k];
-					greatestWeightIndex = vertSkinningData.bones[k];
-					vertSkinningData.weights[k] = 0.0f; // make it 'used'
-				}
-			}
-
-			// add it to the list
-			if (greatestWeightIndex != -1)
-			{
-				weights[j] = greatestWeight;
-				vert.BoneIndices[j] = greatestWeightIndex;
-				weightSum += greatestWeight;
-			}
-		}
-
-		// fix the sum
-		for (int j = 0; j < MAX_BONES_PER_VERTEX; ++j)
-		{
-			assert(weightSum != 0.0f);
-			weights[j] /= weightSum;
-		}
-
-		// distribute the weights along the bone specific vertex data
-		XMVECTOR pL = XMLoadFloat4(&vert.Position[0]);
-		XMVECTOR nL = XMLoadFloat3(&vert.Normal[0]);
-		XMVECTOR tL = XMLoadFloat3(&vert.TangentU[0]);
-		for (int j = 0; j < MAX_BONES_PER_VERTEX; ++j)
-		{
-			XMVECTOR p = pL * weights[j];
-			XMVECTOR n = nL * weights[j];
-			XMVECTOR t = tL * weights[j];
-			XMStoreFloat4(&vert.Position[j], p);
-			XMStoreFloat3(&vert.Normal[j], n);
-			XMStoreFloat3(&vert.TangentU[j], t);
-		}
+		CreateRenderSkin(*skinMesh, pApp);
 	}
+}
 
-	// for each vertex -> transform (position, normal, tangent) to the respective bone space
-	for (int i = 0; i < (int)csgc.vertices.size(); ++i)
+void HumanoidSkeleton::CreateRenderSkin(const AppCommands::CreateSkinnedGeometryCommand &skinMesh, App *pApp)
+{
+	// Replace the template bone indices with the rigid body ones
+	AppCommands::CreateSkinnedGeometryCommand csgc = skinMesh;
+	for (AppCommands::SkinnedMeshVertex &vert : csgc.vertices)
 	{
-		XMVECTOR pL, nL, tL;
-		XMMATRIX inverseBindPose;
-		// for each bone space
 		for (int j = 0; j < MAX_BONES_PER_VERTEX; ++j)
 		{
-			// transform
-			inverseBindPose = rigidBodyInverseBindPoseMap[csgc.vertices[i].BoneIndices[j]];
-			pL = XMLoadFloat4(&csgc.vertices[i].Position[j]);
-			pL = XMVector4Transform(pL, inverseBindPose);
-			nL = XMLoadFloat3(&csgc.vertices[i].Normal[j]);
-			nL = XMVector3TransformNormal(nL, inverseBindPose);
-			tL = XMLoadFloat3(&csgc.vertices[i].TangentU[j]);
-			tL = XMVector3TransformNormal(tL, inverseBindPose);
-			// store
-			XMStoreFloat4(&csgc.vertices[i].Position[j], pL);
-			XMStoreFloat3(&csgc.vertices[i].Normal[j], nL);
-			XMStoreFloat3(&csgc.vertices[i].TangentU[j], tL);
+			vert.BoneIndices[j] = mRigidBodyIndices[vert.BoneIndices[j]];
 		}
 	}
 
 	// Create the geometry
 	pApp->ExecuteCommand(csgc);
 
-	/*
-	// Create the material
-	int materialCount = node->GetSrcObjectCount<FbxSurfaceMaterial>();
-	for (int i = 0; i < materialCount; ++i)
-	{
-		FbxSurfaceMaterial* material = (FbxSurfaceMaterial*)node->GetSrcObject<FbxSurfaceMaterial>(i);
-		if (material == NULL) continue;
-
-		// This only gets the material of type sDiffuse, you probably need to traverse all Standard Material Property by its name to get all possible textures.
-		FbxProperty prop = material->FindProperty(FbxSurfaceMaterial::sDiffuse);
-
-		// Check if it's layeredtextures
-		int layeredTextureCount = prop.GetSrcObjectCount<FbxLayeredTexture>();
-
-		if (layeredTextureCount > 0)
-		{
-			//for (int j = 0; j < layeredTextureCount; j++)
-			//{
-			//	FbxLayeredTexture* layered_texture = FbxCast<FbxLayeredTexture>(prop.GetSrcObject<FbxLayeredTexture>(j));
-			//	int lcount = layered_texture->GetSrcObjectCount<FbxTexture>();
-
-			//	for (int k = 0; k < lcount; k++)
-			//	{
-			//		FbxTexture* texture = FbxCast<FbxTexture>(layered_texture->GetSrcObject<FbxTexture>(k));
-			//		// Then, you can get all the properties of the texture, include its name
-			//		const char* textureName = texture->GetName();
-			//	}
-			//}
-
-			// source: https://stackoverflow.com/questions/19634369/read-texture-filename-from-fbx-with-fbx-sdk-c
-			THROW_NOT_IMPLEMENTED;
-		}
-		else
-		{
-			// Directly get textures
-			int textureCount = prop.GetSrcObjectCount<FbxTexture>();
-			for (int j = 0; j < textureCount; j++)
-			{
-				FbxFileTexture* texture = FbxCast<FbxFileTexture>(prop.GetSrcObject<FbxFileTexture>(j));
-				AppCommands::LoadResourceCommand lrc_ao;
-				lrc_ao.name = texture->GetName();
-				lrc_ao.path = StrToWStr(texture->GetFileName());
-				lrc_ao.resType = AppCommands::ResourceType::Texture;
-				pApp->ExecuteCommand(lrc_ao);
-			}
-		}
-
-		AppCommands::CreateMaterialCommand cmc_pbr;
-		//cmc_pbr.materialName = geoMatName;
-		//cmc_pbr.albedoTexName = lrc_albedo.name;
-		//cmc_pbr.normalTexName = lrc_normal.name;
-		//cmc_pbr.heightTexName = lrc_height.name;
-		//cmc_pbr.metalnessTexName = lrc_metalness.name;
-		//cmc_pbr.roughnessTexName = lrc_rough.name;
-		//cmc_pbr.aoTexName = lrc_ao.name;
-		cmc_pbr.DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-		cmc_pbr.FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-		cmc_pbr.Roughness = 1.0f;
-		pApp->ExecuteCommand(cmc_pbr);
-	}
-	*/
-
 	// Add an object
 	WorldCommands::AddRenderItemCommand cmd3;
 	XMStoreFloat4x4(&cmd3.texTransform, XMMatrixScaling(20.0f, 20.0f, 0.4f));
-	cmd3.geometryName = node->GetName();
+	cmd3.geometryName = csgc.geometryName;
 	cmd3.materialName = "pbrMatTest";
-	cmd3.meshName = meshPt->GetName();
+	cmd3.meshName = csgc.meshName;
 	cmd3.type = WorldCommands::RenderItemType::SpeckSkeletalBody;
+	// the first bone picks the level of detail of the whole skin
+	cmd3.speckSkeletalBodyRenderItem.lodRigidBodyIndex = mRigidBodyIndices[0];
 	cmd3.staticRenderItem.worldTransform.mS = XMFLOAT3(1.0f, 1.0f, 1.0f);
 	cmd3.staticRenderItem.worldTransform.mT = XMFLOAT3(0.0f, 0.0f, 0.0f);
 	XMStoreFloat4(&cmd3.staticRenderItem.worldTransform.mR, XMQuaternionRotationRollPitchYaw(0.0f, 0.0f, 0.0f));
@@ -635,7 +105,7 @@ void HumanoidSkeleton::ProcessRenderSkin(fbxsdk::FbxNode * node, App *pApp)
 HumanoidSkeleton::HumanoidSkeleton(FBXSceneManager *sceneManager, World &w)
 	: WorldUser(w)
 	, mSceneManager(sceneManager)
-	, mScene(0)
+	, mTemplate(nullptr)
 {
 	
 }
@@ -645,7 +115,19 @@ HumanoidSkeleton::~HumanoidSkeleton()
 
 }
 
-void HumanoidSkeleton::Initialize(const wchar_t * fbxFilePath, const wchar_t *speckStructureJSON, App *pApp, bool useSkinning, bool saveFixed)
+bool HumanoidSkeleton::Initialize(const wchar_t * fbxFilePath, const wchar_t *speckStructureJSON, App *pApp, bool useSkinning)
+{
+	const SkeletonTemplate *skeletonTemplate = mSceneManager->GetSkeletonTemplate(fbxFilePath, speckStructureJSON);
+	if (!skeletonTemplate)
+	{
+		LOG(TEXT("Could not create the skeleton: ") + wstring(fbxFilePath), ERROR);
+		return false;
+	}
+	Initialize(skeletonTemplate, pApp, useSkinning);
+	return true;
+}
+
+void HumanoidSkeleton::Initialize(const SkeletonTemplate *skeletonTemplate, App *pApp, bool useSkinning)
 {
 	// Get world properties
 	WorldCommands::GetWorldPropertiesCommand gwp;
@@ -653,19 +135,7 @@ void HumanoidSkeleton::Initialize(const wchar_t * fbxFilePath, const wchar_t *sp
 	GetWorld().ExecuteCommand(gwp, &gwpr);
 	mSpeckRadius = gwpr.speckRadius;
 
-	mScene = mSceneManager->GetScene(fbxFilePath);
-	assert(mScene);
-	//mSceneManager->FixSceneSaveScene(fbxFilePath);
-
-	// Open the JSON file, read from it and close it
-	fstream fileStream;
-	fileStream.open(speckStructureJSON, fstream::in | fstream::out | fstream::app);
-	fileStream.seekg(0, ios::end);
-	mSpeckBodyStructureJSONFile.reserve(fileStream.tellg());
-	fileStream.seekg(0, ios::beg);
-	mSpeckBodyStructureJSONFile.assign((istreambuf_iterator<char>(fileStream)), istreambuf_iterator<char>());
-	fileStream.close();
-
+	mTemplate = skeletonTemplate;
 	CreateSpecksBody(pApp, useSkinning);
 
 	// Set the state
@@ -685,167 +155,102 @@ void HumanoidSkeleton::SetWorldTransform(CXMMATRIX world)
 	XMStoreFloat4x4(&mWorld, world);
 	if (mState != BindPose) return;
 
-	// Create a body made out of specks
-	int numStacks = mScene->GetSrcObjectCount<FbxAnimStack>();
-	FbxAnimStack* pAnimStack = FbxCast<FbxAnimStack>(mScene->GetSrcObject<FbxAnimStack>(0));
-	vector<FbxNode *> nodeStack;
-	FbxNode *root = mScene->GetRootNode();
-	nodeStack.push_back(root);
-	FbxAnimEvaluator* sceneEvaluator = mScene->GetAnimationEvaluator();
+	// Place the rigid bodies in the bind pose
+	CalculateRigidBodyTransforms(mTemplate->GetBindPose());
+	SubmitRigidBodyTransforms();
+}
 
-	while (!nodeStack.empty())
-	{
-		// Pop the last item on the stack
-		FbxNode *node = *(nodeStack.end() - 1);
-		nodeStack.pop_back();
+void HumanoidSkeleton::UpdateAnimation(float time)
+{
+	PROFILE_ZONE("HumanoidSkeleton::UpdateAnimation");
+	EvaluateAnimation(time);
+	SubmitRigidBodyTransforms();
+
+	// Set the state
+	mState = Animating;
+}
+
+void HumanoidSkeleton::StartSimulation()
+{
+	if (mState == Simulating) return;
 
-		// Get a reference to nodes local transform.
-		FbxMatrix nodeTransform = sceneEvaluator->GetNodeGlobalTransform(node);
-		string name = node->GetName();
+	// Hand the rigid bodies over to the GPU
+	WorldCommands::UpdateSpeckRigidBodyCommand command;
+	command.movementMode = WorldCommands::RigidBodyMovementMode::GPU;
+	for (const AnimatedRigidBody &arb : mAnimatedRigidBodies)
+	{
+		command.rigidBodyIndex = arb.rigidBodyIndex;
+		GetWorld().ExecuteCommand(command);
+	}
 
-		WorldCommands::UpdateSpeckRigidBodyCommand command;
-		command.movementMode = WorldCommands::RigidBodyMovementMode::CPU;
+	// Set the state
+	mState = Simulating;
+}
 
-		command.rigidBodyIndex = mNodesAnimData[name].index;
-		if (command.rigidBodyIndex != -1)
-		{
-			XMFLOAT4X4 worldMatrix;
-			Conv(&worldMatrix, nodeTransform);
-			XMMATRIX w = XMLoadFloat4x4(&worldMatrix);
-			XMVECTOR inverseLocalTranslation = XMLoadFloat3(&mNodesAnimData[name].centerOfMass);
-			XMVECTOR inverseLocalRotation = XMLoadFloat4(&mNodesAnimData[name].inverseRotation);
-			XMVECTOR inverseLocalScale = XMLoadFloat3(&mNodesAnimData[name].inverseScale);
-			XMMATRIX inverseLocalTransform = XMMatrixTranslationFromVector(inverseLocalTranslation) * XMMatrixRotationQuaternion(inverseLocalRotation) * XMMatrixScalingFromVector(inverseLocalScale);
-			w = XMMatrixMultiply(inverseLocalTransform, w);
-			w = XMMatrixMultiply(w, world);
-			XMVECTOR s, r, t;
-			XMMatrixDecompose(&s, &r, &t, w);
-			XMStoreFloat3(&command.transform.mT, t);
-			XMStoreFloat4(&command.transform.mR, r);
-			//XMStoreFloat3(&command.transform.mS, s);
-			GetWorld().ExecuteCommand(command);
-		}
-		int numChildren = node->GetChildCount();
-		for (int i = 0; i < numChildren; i++)
+void HumanoidSkeleton::UpdateAnimations(const vector<unique_ptr<HumanoidSkeleton>> &skeletons, float time, WorkerPool *workerPool)
+{
+	PROFILE_ZONE("HumanoidSkeleton::UpdateAnimations");
+	// Poses are independent of each other, but the world is not thread safe so the commands are sent afterwards
+	const UINT skeletonsPerChunk = 8;
+	workerPool->ParallelFor((UINT)skeletons.size(), skeletonsPerChunk, [&skeletons, time](UINT begin, UINT end)
+	{
+		PROFILE_ZONE("HumanoidSkeleton::EvaluateAnimations");
+		for (UINT i = begin; i < end; ++i)
 		{
-			FbxNode *childNode = node->GetChild(i);
-			nodeStack.push_back(childNode);
+			skeletons[i]->EvaluateAnimation(time);
 		}
+	});
+
+	for (auto &skeleton : skeletons)
+	{
+		skeleton->SubmitRigidBodyTransforms();
+		skeleton->mState = Animating;
 	}
 }
 
-void HumanoidSkeleton::UpdateAnimation(float time)
+void HumanoidSkeleton::CalculateRigidBodyTransforms(const AnimationPose &modelPose)
 {
 	// transforms the model to the world space
 	XMMATRIX modelWorld = XMLoadFloat4x4(&mWorld);
+	XMVECTOR worldS, worldR, worldT;
+	XMMatrixDecompose(&worldS, &worldR, &worldT, modelWorld);
 
-	int numStacks = mScene->GetSrcObjectCount<FbxAnimStack>();
-	FbxAnimStack* pAnimStack = FbxCast<FbxAnimStack>(mScene->GetSrcObject<FbxAnimStack>(numStacks - 1));
-	FbxTimeSpan &timeSpan = pAnimStack->GetLocalTimeSpan();
-	float animTime = (float)timeSpan.GetDuration().GetSecondDouble();
-	int numAnimLayers = pAnimStack->GetMemberCount<FbxAnimLayer>();
-	FbxAnimLayer* animLayer = pAnimStack->GetMember<FbxAnimLayer>(0);
-	FbxAnimEvaluator* sceneEvaluator = mScene->GetAnimationEvaluator();
-
-	// Create a time object.
-	FbxTime myTime;					// The time for each key in the animation curve(s)
-	if (time > animTime)
-	{
-		int a = (int)(time / animTime);
-		float newTime = (time - animTime*a);
-		myTime.SetSecondDouble(newTime);
-	}
-	else
-		myTime.SetSecondDouble(time);
-
-	vector<FbxNode *> nodeStack;
-	FbxNode *root = mScene->GetRootNode();
-	nodeStack.push_back(root);
-
-	while (!nodeStack.empty())
+	for (size_t i = 0; i < mAnimatedRigidBodies.size(); ++i)
 	{
-		// Pop the last item on the stack
-		FbxNode *node = *(nodeStack.end() - 1);
-		nodeStack.pop_back();
+		const AnimatedRigidBody &arb = mAnimatedRigidBodies[i];
 
-		// Get a reference to nodes local transform.
-		FbxMatrix nodeTransform = sceneEvaluator->GetNodeGlobalTransform(node, myTime);
-		string name = node->GetName();
+		// Rigid body space -> node space -> model space (node scale cancels out with the inverse bind pose scale)
+		XMVECTOR nodeR = XMLoadFloat4(&modelPose.mRotations[arb.jointIndex]);
+		XMVECTOR nodeT = XMLoadFloat3(&modelPose.mTranslations[arb.jointIndex]);
+		XMVECTOR r = XMQuaternionMultiply(XMLoadFloat4(&arb.inverseRotation), nodeR);
+		XMVECTOR t = XMVector3Rotate(XMLoadFloat3(&arb.centerOfMass), r) + nodeT;
 
-		WorldCommands::UpdateSpeckRigidBodyCommand command;
-		command.movementMode = WorldCommands::RigidBodyMovementMode::CPU;
+		// Model space -> world space
+		t = XMVector3TransformCoord(t, modelWorld);
+		r = XMQuaternionMultiply(r, worldR);
 
-		command.rigidBodyIndex = mNodesAnimData[name].index;
-		if (command.rigidBodyIndex != -1)
-		{
-			XMFLOAT4X4 worldMatrix;
-			Conv(&worldMatrix, nodeTransform);
-			XMMATRIX w = XMLoadFloat4x4(&worldMatrix);
-			XMVECTOR inverseLocalTranslation = XMLoadFloat3(&mNodesAnimData[name].centerOfMass);
-			XMVECTOR inverseLocalRotation = XMLoadFloat4(&mNodesAnimData[name].inverseRotation);
-			XMVECTOR inverseLocalScale = XMLoadFloat3(&mNodesAnimData[name].inverseScale);
-			XMMATRIX inverseLocalTransform = XMMatrixTranslationFromVector(inverseLocalTranslation) * XMMatrixRotationQuaternion(inverseLocalRotation) * XMMatrixScalingFromVector(inverseLocalScale);
-			w = XMMatrixMultiply(inverseLocalTransform, w);
-			w = XMMatrixMultiply(w, modelWorld);
-			XMVECTOR s, r, t;
-			XMMatrixDecompose(&s, &r, &t, w);
-			XMStoreFloat3(&command.transform.mT, t);
-			XMStoreFloat4(&command.transform.mR, r);
-			//XMStoreFloat3(&command.transform.mS, s);
-			GetWorld().ExecuteCommand(command);
-		}
-		int numChildren = node->GetChildCount();
-		for (int i = 0; i < numChildren; i++)
-		{
-			FbxNode *childNode = node->GetChild(i);
-			nodeStack.push_back(childNode);
-		}
+		XMStoreFloat3(&mRigidBodyTransforms[i].mT, t);
+		XMStoreFloat4(&mRigidBodyTransforms[i].mR, r);
 	}
-	// Set the state
-	mState = Animating;
 }
 
-void HumanoidSkeleton::StartSimulation()
+void HumanoidSkeleton::EvaluateAnimation(float time)
 {
-	if (mState == Simulating) return;
-
-	// Create the body made out of specks
-	int numStacks = mScene->GetSrcObjectCount<FbxAnimStack>();
-	FbxAnimStack* pAnimStack = FbxCast<FbxAnimStack>(mScene->GetSrcObject<FbxAnimStack>(0));
-	FbxTimeSpan &timeSpan = pAnimStack->GetLocalTimeSpan();
-	float animTime = (float)timeSpan.GetDuration().GetSecondDouble();
-	int numAnimLayers = pAnimStack->GetMemberCount<FbxAnimLayer>();
-	FbxAnimLayer* animLayer = pAnimStack->GetMember<FbxAnimLayer>(0);
-	FbxAnimEvaluator* sceneEvaluator = mScene->GetAnimationEvaluator();
-
-	vector<FbxNode *> nodeStack;
-	FbxNode *root = mScene->GetRootNode();
-	nodeStack.push_back(root);
+	// Sample the baked clip
+	const AnimationClip &clip = mTemplate->GetAnimationClip();
+	clip.SampleLocalPose(time, &mLocalPose);
+	clip.LocalToModelPose(mLocalPose, &mModelPose);
+	CalculateRigidBodyTransforms(mModelPose);
+}
 
-	while (!nodeStack.empty())
+void HumanoidSkeleton::SubmitRigidBodyTransforms()
+{
+	WorldCommands::UpdateSpeckRigidBodyCommand command;
+	command.movementMode = WorldCommands::RigidBodyMovementMode::CPU;
+	for (size_t i = 0; i < mAnimatedRigidBodies.size(); ++i)
 	{
-		// Pop the last item on the stack
-		FbxNode *node = *(nodeStack.end() - 1);
-		nodeStack.pop_back();
-		string name = node->GetName();
-
-		WorldCommands::UpdateSpeckRigidBodyCommand command;
-		command.movementMode = WorldCommands::RigidBodyMovementMode::GPU;
-
-		command.rigidBodyIndex = mNodesAnimData[name].index;
-		if (command.rigidBodyIndex != -1)
-		{
-			//XMStoreFloat3(&command.transform.mS, s);
-			GetWorld().ExecuteCommand(command);
-		}
-		int numChildren = node->GetChildCount();
-		for (int i = 0; i < numChildren; i++)
-		{
-			FbxNode *childNode = node->GetChild(i);
-			nodeStack.push_back(childNode);
-		}
+		command.rigidBodyIndex = mAnimatedRigidBodies[i].rigidBodyIndex;
+		command.transform = mRigidBodyTransforms[i];
+		GetWorld().ExecuteCommand(command);
 	}
-
-	// Set the state
-	mState = Simulating;
 }
@@ -7,14 +7,15 @@
 #include <WorldCommands.h>
 #include <AppCommands.h>
 
-namespace fbxsdk
-{
-	class FbxNode;
-	class FbxAnimLayer;
-	class FbxScene;
-}
+#include "AnimationClip.h"
 
 class FBXSceneManager;
+class SkeletonTemplate;
+
+namespace Speck
+{
+	class WorkerPool;
+}
 
 class HumanoidSkeleton : public Speck::WorldUser
 {
@@ -22,38 +23,52 @@ public:
 	HumanoidSkeleton(FBXSceneManager *sceneManager, Speck::World &w);
 	~HumanoidSkeleton();
 
-	void Initialize(const wchar_t *fbxFilePath, const wchar_t *speckStructureJSON, Speck::App *pApp, bool useSkinning, bool saveFixed = false);
+	// Returns false if the skeleton template could not be built, the skeleton is then left empty.
+	bool Initialize(const wchar_t *fbxFilePath, const wchar_t *speckStructureJSON, Speck::App *pApp, bool useSkinning);
+	// Creates the speck body from an already built template.
+	void Initialize(const SkeletonTemplate *skeletonTemplate, Speck::App *pApp, bool useSkinning);
 	void SetWorldTransform(const DirectX::XMFLOAT4X4 &world);
 	void SetWorldTransform(DirectX::CXMMATRIX world);
 	void UpdateAnimation(float time);
 	void StartSimulation();
 
+	// Evaluates the poses of all the skeletons in parallel and then updates their rigid bodies.
+	static void UpdateAnimations(const std::vector<std::unique_ptr<HumanoidSkeleton>> &skeletons, float time, Speck::WorkerPool *workerPool);
+
 private:
-	void ProcessBone(fbxsdk::FbxNode *node, Speck::WorldCommands::AddSpecksCommand *outCommand, const std::string &boneName);
 	void CreateSpecksBody(Speck::App *pApp, bool useSkinning);
-	void ProcessRenderSkin(fbxsdk::FbxNode *node, Speck::App *pApp);
+	// Creates the skinned geometry and its render item from the template skinned mesh.
+	void CreateRenderSkin(const Speck::AppCommands::CreateSkinnedGeometryCommand &skinMesh, Speck::App *pApp);
+	// Calculates the world transforms of the rigid bodies, does not touch the world so it can run on any thread.
+	void CalculateRigidBodyTransforms(const AnimationPose &modelPose);
+	void EvaluateAnimation(float time);
+	void SubmitRigidBodyTransforms();
 
 private:
 	FBXSceneManager *mSceneManager;
-	fbxsdk::FbxScene *mScene;
+	// Shared by all the skeletons created from the same files
+	const SkeletonTemplate *mTemplate;
 	float mSpeckRadius;
-	std::string mSpeckBodyStructureJSONFile;
-	struct NodeAnimData 
-	{
-		int index = -1;
-		UINT numberOfSpecks; 
-		DirectX::XMFLOAT3 centerOfMass; 
-		DirectX::XMFLOAT3 inverseScale; 
-		DirectX::XMFLOAT4 inverseRotation;
-		DirectX::XMFLOAT4X4 bindPoseWorldTransform;
-	};
-	std::unordered_map < std::string, NodeAnimData > mNodesAnimData;
-	// First parent of a node that has a rigid body, if the node does not have a rigid body already.
-	std::unordered_map < std::string, std::string > mNodesParents; 
+	// Rigid body index of every template bone
+	std::vector<int> mRigidBodyIndices;
 	enum { None, BindPose, Animating, Simulating } mState = None;
 	DirectX::XMFLOAT4X4 mWorld;
 	// Total number of specks in this skeleton
 	int mSpeckCount; 
+	// Animation poses, the clip itself is in the template
+	AnimationPose mLocalPose;
+	AnimationPose mModelPose;
+	// Clip joints that drive rigid bodies, in the same (parent before child) order as in the clip
+	struct AnimatedRigidBody
+	{
+		UINT jointIndex;
+		int rigidBodyIndex;
+		DirectX::XMFLOAT3 centerOfMass;
+		DirectX::XMFLOAT4 inverseRotation;
+	};
+	std::vector<AnimatedRigidBody> mAnimatedRigidBodies;
+	// Last calculated world transforms, one for every animated rigid body
+	std::vector<Speck::Transform> mRigidBodyTransforms;
 };
 
 #endif
@@ -8,6 +8,11 @@
 #include "ManySkeletonsTestingState.h"
 #include "JointTestingState.h"
 #include "JointShowcaseState.h"
+#include "SpeckBodyCompiler.h"
+#include "SpeckAssetCooker.h"
+#include "FBXSceneManager.h"
+#include "TextureImporter.h"
+#include <shellapi.h>
 
 using namespace Speck;
 using namespace std;
@@ -84,6 +89,34 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, in
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// Offline tools: Speck.exe -compileSpeckBody <input.json> <output.speckbody>
+	//               Speck.exe -cookFbx <input.fbx> <output.speckasset>
+	//               Speck.exe -importTexture <input.png> <output.dds> <bc1|bc1_srgb|bc3|bc3_srgb|bc5|bc7|bc7_srgb>
+	int argc;
+	LPWSTR *argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+	if (argv && argc == 4 && wcscmp(argv[1], L"-compileSpeckBody") == 0)
+	{
+		bool compiled = SpeckBodyCompiler::Compile(argv[2], argv[3]);
+		LocalFree(argv);
+		return compiled ? 0 : 1;
+	}
+	if (argv && argc == 4 && wcscmp(argv[1], L"-cookFbx") == 0)
+	{
+		FBXSceneManager sceneManager;
+		bool cooked = SpeckAssetCooker::Cook(&sceneManager, argv[2], argv[3]);
+		LocalFree(argv);
+		return cooked ? 0 : 1;
+	}
+	if (argv && argc == 5 && wcscmp(argv[1], L"-importTexture") == 0)
+	{
+		BlockCompressionFormat format;
+		bool sRGB;
+		bool imported = TextureImporter::ParseFormat(argv[4], &format, &sRGB) && TextureImporter::Import(argv[2], argv[3], format, sRGB);
+		LocalFree(argv);
+		return imported ? 0 : 1;
+	}
+	LocalFree(argv);
+
 	try
 	{
 		return Test4(hInstance);
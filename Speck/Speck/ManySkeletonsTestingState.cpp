@@ -37,41 +37,52 @@ void ManySkeletonsTestingState::Initialize()
 	//
 	// PBR testing
 	//
+	// Loaded together with a single wait for the GPU. Only the smallest mips are loaded
+	// upfront, the textures sharpen over the next frames.
+	AppCommands::LoadResourcesCommand lrcs_pbr;
+
 	AppCommands::LoadResourceCommand lrc_albedo;
 	lrc_albedo.name = "spaced-tiles1-albedo";
 	lrc_albedo.path = L"Data/Textures/spaced-tiles1/spaced-tiles1-albedo.dds";
 	lrc_albedo.resType = AppCommands::ResourceType::Texture;
-	GetApp().ExecuteCommand(lrc_albedo);
+	lrc_albedo.residentMipCount = 4;
+	lrcs_pbr.resources.push_back(lrc_albedo);
 
 	AppCommands::LoadResourceCommand lrc_normal;
 	lrc_normal.name = "spaced-tiles1-normal";
 	lrc_normal.path = L"Data/Textures/spaced-tiles1/spaced-tiles1-normal.dds";
 	lrc_normal.resType = AppCommands::ResourceType::Texture;
-	GetApp().ExecuteCommand(lrc_normal);
+	lrc_normal.residentMipCount = 4;
+	lrcs_pbr.resources.push_back(lrc_normal);
 
 	AppCommands::LoadResourceCommand lrc_height;
 	lrc_height.name = "spaced-tiles1-height";
 	lrc_height.path = L"Data/Textures/spaced-tiles1/spaced-tiles1-height.dds";
 	lrc_height.resType = AppCommands::ResourceType::Texture;
-	GetApp().ExecuteCommand(lrc_height);
+	lrc_height.residentMipCount = 4;
+	lrcs_pbr.resources.push_back(lrc_height);
 
 	AppCommands::LoadResourceCommand lrc_metalness;
 	lrc_metalness.name = "spaced-tiles1-metalness";
 	lrc_metalness.path = L"Data/Textures/spaced-tiles1/spaced-tiles1-metalness.dds";
 	lrc_metalness.resType = AppCommands::ResourceType::Texture;
-	GetApp().ExecuteCommand(lrc_metalness);
+	lrc_metalness.residentMipCount = 4;
+	lrcs_pbr.resources.push_back(lrc_metalness);
 
 	AppCommands::LoadResourceCommand lrc_rough;
 	lrc_rough.name = "spaced-tiles1-rough";
 	lrc_rough.path = L"Data/Textures/spaced-tiles1/spaced-tiles1-rough.dds";
 	lrc_rough.resType = AppCommands::ResourceType::Texture;
-	GetApp().ExecuteCommand(lrc_rough);
+	lrc_rough.residentMipCount = 4;
+	lrcs_pbr.resources.push_back(lrc_rough);
 
 	AppCommands::LoadResourceCommand lrc_ao;
 	lrc_ao.name = "spaced-tiles1-ao";
 	lrc_ao.path = L"Data/Textures/spaced-tiles1/spaced-tiles1-ao.dds";
 	lrc_ao.resType = AppCommands::ResourceType::Texture;
-	GetApp().ExecuteCommand(lrc_ao);
+	lrc_ao.residentMipCount = 4;
+	lrcs_pbr.resources.push_back(lrc_ao);
+	GetApp().ExecuteCommand(lrcs_pbr);
 
 	AppCommands::CreateMaterialCommand cmc_pbr;
 	cmc_pbr.materialName = "pbrMatTest";
@@ -135,17 +146,20 @@ void ManySkeletonsTestingState::Initialize()
 	for (int i = 0; i < 35; ++i)
 	{
 		unique_ptr<HumanoidSkeleton> humSkeleton1 = make_unique<HumanoidSkeleton>(&mFBXSceneManager, GetWorld());
-		humSkeleton1->Initialize(L"Data/Animations/knight_idle.fbx", L"Data/Animations/knight.json", &GetApp(), false);
+		if (!humSkeleton1->Initialize(L"Data/Animations/knight_idle.fbx", L"Data/Animations/knight.json", &GetApp(), false))
+			break;
 		humSkeleton1->SetWorldTransform(XMMatrixTranslation(25.0f, 200.0f + 30.0f * i, 0.0f));
 		mHumanoidSkeletons.push_back(move(humSkeleton1));
 
 		unique_ptr<HumanoidSkeleton> humSkeleton2 = make_unique<HumanoidSkeleton>(&mFBXSceneManager, GetWorld());
-		humSkeleton2->Initialize(L"Data/Animations/knight_idle.fbx", L"Data/Animations/knight.json", &GetApp(), false);
+		if (!humSkeleton2->Initialize(L"Data/Animations/knight_idle.fbx", L"Data/Animations/knight.json", &GetApp(), false))
+			break;
 		humSkeleton2->SetWorldTransform(XMMatrixTranslation(0.0f, 200.0f + 30.0f * i, 0.0f));
 		mHumanoidSkeletons.push_back(move(humSkeleton2));
 
 		unique_ptr<HumanoidSkeleton> humSkeleton3 = make_unique<HumanoidSkeleton>(&mFBXSceneManager, GetWorld());
-		humSkeleton3->Initialize(L"Data/Animations/knight_idle.fbx", L"Data/Animations/knight.json", &GetApp(), false);
+		if (!humSkeleton3->Initialize(L"Data/Animations/knight_idle.fbx", L"Data/Animations/knight.json", &GetApp(), false))
+			break;
 		humSkeleton3->SetWorldTransform(XMMatrixTranslation(-25.0f, 200.0f + 30.0f * i, 0.0f));
 		mHumanoidSkeletons.push_back(move(humSkeleton3));
 	
@@ -179,11 +193,18 @@ void ManySkeletonsTestingState::Update(float dt)
 	cmd.text = L"    fps: " + fpsStr + L"   spf: " + mspfStr;
 	GetApp().ExecuteCommand(cmd);
 
-	if (t > 1.0f)
+	// Wait in the bind pose, play the idle animation of all the skeletons at once and then let them fall
+	float t1 = 1.0f;
+	float t2 = t1 + 1.0f;
+	if (t > t2)
 	{
 		for (auto &sk : mHumanoidSkeletons)
 			sk->StartSimulation();
 	}
+	else if (t > t1)
+	{
+		HumanoidSkeleton::UpdateAnimations(mHumanoidSkeletons, t - t1, GetEngineCore().GetWorkerPool());
+	}
 
 	t += dt;
 }
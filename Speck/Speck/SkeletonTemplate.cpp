@@ -0,0 +1,306 @@
+#include "SkeletonTemplate.h"
+#include "SpeckAssetFile.h"
+#include "SpeckBodyFile.h"
+#include "SpeckBodyCompiler.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+SkeletonTemplate::SkeletonTemplate()
+	: mHasSkin(false)
+	, mSpeckCount(0)
+{
+
+}
+
+SkeletonTemplate::~SkeletonTemplate()
+{
+
+}
+
+bool SkeletonTemplate::Build(const SpeckAssetFile &asset, const wchar_t *speckStructure)
+{
+	// Use the compiled speck body, compile it first if it is missing or older than the JSON
+	wstring speckBodyFilePath(speckStructure);
+	size_t extensionPos = speckBodyFilePath.rfind(L'.');
+	if (extensionPos != wstring::npos && speckBodyFilePath.compare(extensionPos, wstring::npos, L".json") == 0)
+	{
+		speckBodyFilePath.replace(extensionPos, wstring::npos, L".speckbody");
+		SpeckBodyCompiler::CompileIfOutdated(speckStructure, speckBodyFilePath.c_str());
+	}
+	SpeckBodyFile speckBody;
+	if (!speckBody.Open(speckBodyFilePath.c_str()))
+	{
+		LOG(TEXT("Could not load the speck body: ") + wstring(speckBodyFilePath), ERROR);
+		return false;
+	}
+
+	// Nodes are stored so that parents are processed before their children
+	int skinNode = -1;
+	for (UINT n = 0; n < asset.GetNodeCount(); ++n)
+	{
+		const SpeckAssetFormat::Node &node = asset.GetNode(n);
+		string boneName = asset.GetString(node.name);
+
+		// find the name in the speck body, bones without specks are treated as any other node
+		UINT speckCount = 0;
+		int speckBodyBone = speckBody.FindBone(boneName.c_str(), boneName.size());
+		if (speckBodyBone != -1)
+		{
+			const XMFLOAT3 *specks = speckBody.GetBoneSpecks((UINT)speckBodyBone, &speckCount);
+			if (speckCount > 0)
+			{
+				vector<WorldCommands::NewSpeck> newSpecks(speckCount);
+				for (UINT i = 0; i < speckCount; ++i)
+				{
+					newSpecks[i].position = specks[i];
+				}
+				mNodeBones[boneName] = (int)mBones.size();
+				ProcessBone(node, boneName, &newSpecks);
+			}
+		}
+
+		if (speckCount == 0)
+		{
+			auto parentIt = (node.parent != -1) ? mNodeBones.find(asset.GetString(asset.GetNode(node.parent).name)) : mNodeBones.end(); // parent has already been processed
+			mNodeBones[boneName] = (parentIt != mNodeBones.end()) ? parentIt->second : -1;
+		}
+
+		if (boneName.find("Guard02") != string::npos)
+		{
+			skinNode = (int)n;
+		}
+	}
+	if (mBones.empty())
+	{
+		LOG(TEXT("None of the bones of the speck body is in the scene: ") + wstring(speckBodyFilePath), ERROR);
+		return false;
+	}
+
+	// connect the bones
+	for (UINT j = 0; j < speckBody.GetJointCount(); ++j)
+	{
+		const SpeckBodyFormat::Joint &speckBodyJoint = speckBody.GetJoint(j);
+		UINT speckCount;
+		const XMFLOAT3 *specks = speckBody.GetJointSpecks(j, &speckCount);
+		for (UINT p = 0; p < speckBodyJoint.pairCount; ++p)
+		{
+			const SpeckBodyFormat::JointPair &pair = speckBody.GetJointPair(speckBodyJoint.firstPair + p);
+			const char *parentBoneName = speckBody.GetString(pair.parentBoneName);
+			const char *childBoneName = speckBody.GetString(pair.childBoneName);
+			int parentBoneIndex = GetNodeBoneIndex(parentBoneName);
+			int childBoneIndex = GetNodeBoneIndex(childBoneName);
+
+			// both nodes have to be bones themselves
+			if (parentBoneIndex != -1 && mBones[parentBoneIndex].name.compare(parentBoneName) == 0 &&
+				childBoneIndex != -1 && mBones[childBoneIndex].name.compare(childBoneName) == 0)
+			{
+				Bone &parentBone = mBones[parentBoneIndex];
+				Bone &childBone = mBones[childBoneIndex];
+				Joint joint;
+				joint.parentBone = (UINT)parentBoneIndex;
+				joint.childBone = (UINT)childBoneIndex;
+
+				XMMATRIX parentWorldBindPose = XMLoadFloat4x4(&parentBone.bindPoseWorldTransform);
+				XMVECTOR det;
+				XMMATRIX parentWorldBindPoseInv = XMMatrixInverse(&det, parentWorldBindPose);
+				XMMATRIX childWorldBindPose = XMLoadFloat4x4(&childBone.bindPoseWorldTransform);
+				XMMATRIX childLocalSpaceToParentLocalSpace = childWorldBindPose * parentWorldBindPoseInv;
+
+				XMVECTOR parentCOM = XMLoadFloat3(&parentBone.centerOfMass) * (float)parentBone.numberOfSpecks;
+				XMVECTOR childCOM = XMLoadFloat3(&childBone.centerOfMass) * (float)childBone.numberOfSpecks;
+
+				// for every speck
+				joint.specks.resize(speckCount);
+				for (UINT i = 0; i < speckCount; ++i)
+				{
+					XMVECTOR jointPosChildLocalSpace = XMLoadFloat3(&specks[i]);
+
+					// update the rigid body bones with the mass distribution information
+					parentCOM += XMVector3TransformCoord(jointPosChildLocalSpace, childLocalSpaceToParentLocalSpace);
+					childCOM += jointPosChildLocalSpace;
+					parentBone.numberOfSpecks += 1;
+					childBone.numberOfSpecks += 1;
+
+					// transform it
+					XMVECTOR jointPosW = XMVector3TransformCoord(jointPosChildLocalSpace, childWorldBindPose);
+					XMStoreFloat3(&joint.specks[i].position, jointPosW);
+				}
+
+				// calculate the new center of mass and store it
+				parentCOM = parentCOM / (float)parentBone.numberOfSpecks;
+				childCOM = childCOM / (float)childBone.numberOfSpecks;
+				XMStoreFloat3(&parentBone.centerOfMass, parentCOM);
+				XMStoreFloat3(&childBone.centerOfMass, childCOM);
+
+				mSpeckCount += (UINT)joint.specks.size();
+				mJoints.push_back(move(joint));
+			}
+		}
+	}
+
+	// Animation (the last anim stack of the FBX file)
+	asset.GetAnimationClip(&mAnimationClip, &mBindPose);
+	for (Bone &bone : mBones)
+	{
+		bone.clipJointIndex = mAnimationClip.GetJointIndex(bone.name);
+	}
+
+	// Skin, the bones have to be complete
+	if (skinNode != -1 && asset.GetNode(skinNode).mesh != -1)
+	{
+		BuildSkin(asset, (UINT)asset.GetNode(skinNode).mesh);
+	}
+	return true;
+}
+
+int SkeletonTemplate::GetNodeBoneIndex(const string &nodeName) const
+{
+	auto it = mNodeBones.find(nodeName);
+	return (it != mNodeBones.end()) ? it->second : -1;
+}
+
+void SkeletonTemplate::ProcessBone(const SpeckAssetFormat::Node &node, const string &boneName, vector<WorldCommands::NewSpeck> *specks)
+{
+	XMMATRIX worldXM = XMLoadFloat4x4(&node.globalTransform);
+	XMVECTOR s, r, t;
+	XMMatrixDecompose(&s, &r, &t, worldXM);
+	XMMATRIX worldWithoutScale = XMMatrixRotationQuaternion(r) * XMMatrixTranslationFromVector(t);
+
+	// Calculate the center of mass
+	XMVECTOR com = XMVectorZero();
+	for (int i = 0; i < specks->size(); i++)
+	{
+		com += XMLoadFloat3(&(*specks)[i].position);
+	}
+	com /= (float)specks->size();
+
+	// Calculate local transform
+	XMVECTOR invSca = XMVectorReciprocal(XMLoadFloat3(&node.globalScale));
+	XMVECTOR invRot = XMQuaternionInverse(XMLoadFloat4(&node.globalRotation));
+
+	// Transfrom with the node transform matrix
+	for (int i = 0; i < specks->size(); ++i)
+	{
+		XMVECTOR posFinal = XMVector3TransformCoord(XMLoadFloat3(&(*specks)[i].position), worldWithoutScale);
+		XMStoreFloat3(&(*specks)[i].position, posFinal);
+	}
+
+	// Save the bone
+	Bone bone;
+	bone.name = boneName;
+	bone.numberOfSpecks = (UINT)specks->size();
+	XMStoreFloat3(&bone.centerOfMass, com);
+	XMStoreFloat3(&bone.inverseScale, invSca);
+	XMStoreFloat4(&bone.inverseRotation, invRot);
+	XMStoreFloat4x4(&bone.bindPoseWorldTransform, worldWithoutScale);
+	bone.clipJointIndex = -1;
+	bone.specks = move(*specks);
+	mSpeckCount += bone.numberOfSpecks;
+	mBones.push_back(move(bone));
+}
+
+void SkeletonTemplate::BuildSkin(const SpeckAssetFile &asset, UINT meshIndex)
+{
+	const SpeckAssetFormat::Mesh &mesh = asset.GetMesh(meshIndex);
+	AppCommands::CreateSkinnedGeometryCommand &csgc = mSkinMesh;
+	csgc.geometryName = asset.GetString(asset.GetNode(mesh.node).name);
+	csgc.meshName = asset.GetString(mesh.meshName);
+	const uint32_t *indices = asset.GetIndices(mesh);
+	csgc.indices.assign(indices, indices + mesh.indexCount);
+
+	// inverse bind pose of every bone that deforms the mesh
+	vector<int> clusterBones(mesh.clusterCount);
+	vector<XMMATRIX> boneInverseBindPoses(mBones.size(), XMMatrixIdentity());
+	const SpeckAssetFormat::Cluster *clusters = asset.GetClusters(mesh);
+	for (UINT c = 0; c < mesh.clusterCount; ++c)
+	{
+		// bone ref
+		int templateBoneIndex = GetNodeBoneIndex(asset.GetString(asset.GetNode(clusters[c].linkNode).name));
+		clusterBones[c] = templateBoneIndex;
+		if (templateBoneIndex == -1) continue;
+		const Bone &templateBone = mBones[templateBoneIndex];
+
+		// get the bind pose
+		XMMATRIX bindPose = XMLoadFloat4x4(&clusters[c].bindPose);
+
+		// get the inverse local transform
+		XMVECTOR inverseLocalTranslation = XMLoadFloat3(&templateBone.centerOfMass);
+		XMVECTOR inverseLocalRotation = XMLoadFloat4(&templateBone.inverseRotation);
+		XMVECTOR inverseLocalScale = XMLoadFloat3(&templateBone.inverseScale);
+		XMMATRIX inverseLocalTransform = XMMatrixTranslationFromVector(inverseLocalTranslation) * XMMatrixRotationQuaternion(inverseLocalRotation) * XMMatrixScalingFromVector(inverseLocalScale);
+
+		// get the inverse 'offset matrix' without scale
+		XMMATRIX w = XMMatrixMultiply(inverseLocalTransform, bindPose);
+		XMVECTOR s, r, t;
+		XMMatrixDecompose(&s, &r, &t, w);
+		XMMATRIX wWithoutScale = XMMatrixRotationQuaternion(r) * XMMatrixTranslationFromVector(t);
+		XMVECTOR det;
+		boneInverseBindPoses[templateBoneIndex] = XMMatrixInverse(&det, wWithoutScale);
+	}
+
+	// for each vertex distribute the weights along the bone specific vertex data and transform it to the bone space
+	const AppCommands::StaticMeshVertex *vertices = asset.GetVertices(mesh);
+	const SpeckAssetFormat::VertexWeights *vertexWeights = asset.GetVertexWeights(mesh);
+	csgc.vertices.resize(mesh.vertexCount);
+	for (UINT i = 0; i < mesh.vertexCount; ++i)
+	{
+		AppCommands::SkinnedMeshVertex &vert = csgc.vertices[i];
+		vert = {};
+		vert.TexC = vertices[i].TexC;
+		XMVECTOR pL = XMVectorSetW(XMLoadFloat3(&vertices[i].Position), 1.0f);
+		XMVECTOR nL = XMLoadFloat3(&vertices[i].Normal);
+		XMVECTOR tL = XMLoadFloat3(&vertices[i].TangentU);
+		for (int j = 0; j < MAX_BONES_PER_VERTEX; ++j)
+		{
+			float weight = vertexWeights[i].weights[j];
+			UINT cluster = vertexWeights[i].clusters[j];
+			if (weight == 0.0f || clusterBones[cluster] == -1) continue;
+
+			// template bone index, skeletons replace it with their rigid body index
+			vert.BoneIndices[j] = clusterBones[cluster];
+			const XMMATRIX &inverseBindPose = boneInverseBindPoses[vert.BoneIndices[j]];
+			XMStoreFloat4(&vert.Position[j], XMVector4Transform(pL * weight, inverseBindPose));
+			XMStoreFloat3(&vert.Normal[j], XMVector3TransformNormal(nL * weight, inverseBindPose));
+			XMStoreFloat3(&vert.TangentU[j], XMVector3TransformNormal(tL * weight, inverseBindPose));
+		}
+	}
+
+	// the LODs are simplified in the bind pose
+	vector<float> attributes, attributeWeights;
+	GetLODAttributes(vertices, vertexWeights, mesh.vertexCount, clusterBones, (UINT)mBones.size(), &attributes, &attributeWeights);
+	MeshSimplifier::Attributes simplifierAttributes;
+	simplifierAttributes.data = attributes.data();
+	simplifierAttributes.stride = attributeWeights.size() * sizeof(float);
+	simplifierAttributes.count = (UINT)attributeWeights.size();
+	simplifierAttributes.weights = attributeWeights.data();
+	MeshSimplifier::BuildLODChain(csgc.indices.data(), csgc.indices.size(), &vertices[0].Position.x, mesh.vertexCount,
+		sizeof(AppCommands::StaticMeshVertex), simplifierAttributes, 4, &csgc.lods);
+	mHasSkin = true;
+}
+
+void SkeletonTemplate::GetLODAttributes(const AppCommands::StaticMeshVertex *vertices, const SpeckAssetFormat::VertexWeights *vertexWeights,
+	UINT vertexCount, const vector<int> &clusterBones, UINT boneCount, vector<float> *outAttributes, vector<float> *outAttributeWeights)
+{
+	const UINT attributeCount = 5 + boneCount;
+	outAttributes->assign((size_t)vertexCount * attributeCount, 0.0f);
+	outAttributeWeights->assign(attributeCount, 0.1f);
+	for (UINT k = 0; k < 5; ++k)
+		(*outAttributeWeights)[k] = 0.01f; // normal and texture coordinates
+	for (UINT i = 0; i < vertexCount; ++i)
+	{
+		float *attribute = &(*outAttributes)[(size_t)i * attributeCount];
+		attribute[0] = vertices[i].Normal.x;
+		attribute[1] = vertices[i].Normal.y;
+		attribute[2] = vertices[i].Normal.z;
+		attribute[3] = vertices[i].TexC.x;
+		attribute[4] = vertices[i].TexC.y;
+		for (int j = 0; j < MAX_BONES_PER_VERTEX; ++j)
+		{
+			UINT cluster = vertexWeights[i].clusters[j];
+			if (vertexWeights[i].weights[j] == 0.0f || clusterBones[cluster] == -1) continue;
+			attribute[5 + clusterBones[cluster]] += vertexWeights[i].weights[j];
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef SKELETON_TEMPLATE_H
+#define SKELETON_TEMPLATE_H
+
+#include <SpeckEngineDefinitions.h>
+#include <WorldCommands.h>
+#include <AppCommands.h>
+
+#include "AnimationClip.h"
+
+class SpeckAssetFile;
+namespace SpeckAssetFormat
+{
+	struct Node;
+	struct VertexWeights;
+}
+
+// Everything needed to create a speck body from an (FBX file, speck structure JSON) pair.
+// Built from the cooked FBX file (see SpeckAssetCooker.h), so the FBX SDK is not used.
+// It is built once and shared by all the skeletons using the same pair.
+class SkeletonTemplate
+{
+public:
+	SkeletonTemplate();
+	~SkeletonTemplate();
+
+	// The speck structure can be a .speckbody file or a JSON file, which is then compiled to a .speckbody file next to it.
+	// Returns false if the speck body could not be loaded or none of its bones is in the scene.
+	bool Build(const SpeckAssetFile &asset, const wchar_t *speckStructure);
+
+	// Rigid body made out of specks
+	struct Bone
+	{
+		std::string name;
+		// Speck positions in the model space of the bind pose
+		std::vector<Speck::WorldCommands::NewSpeck> specks;
+		// Including the specks of the joints connected to the bone
+		UINT numberOfSpecks;
+		DirectX::XMFLOAT3 centerOfMass;
+		DirectX::XMFLOAT3 inverseScale;
+		DirectX::XMFLOAT4 inverseRotation;
+		DirectX::XMFLOAT4X4 bindPoseWorldTransform;
+		// Index of the joint in the animation clip that drives the bone, -1 if none
+		int clipJointIndex;
+	};
+
+	// Specks that connect two bones
+	struct Joint
+	{
+		UINT parentBone;
+		UINT childBone;
+		// Speck positions in the model space of the bind pose
+		std::vector<Speck::WorldCommands::NewSpeck> specks;
+	};
+
+	const std::vector<Bone> &GetBones() const { return mBones; }
+	const std::vector<Joint> &GetJoints() const { return mJoints; }
+	// Index of the bone of the node or of its first ancestor that has one, -1 if there is none.
+	int GetNodeBoneIndex(const std::string &nodeName) const;
+	const AnimationClip &GetAnimationClip() const { return mAnimationClip; }
+	const AnimationPose &GetBindPose() const { return mBindPose; }
+	// Skinned mesh with the template bone indices instead of the rigid body ones, nullptr if the scene has no skin.
+	const Speck::AppCommands::CreateSkinnedGeometryCommand *GetSkinMesh() const { return mHasSkin ? &mSkinMesh : nullptr; }
+	// Total number of specks (bones and joints)
+	UINT GetSpeckCount() const { return mSpeckCount; }
+
+	// Vertex attributes the LODs of the skin are simplified with: the normal, the texture coordinates and the weight of
+	// every bone, so that the collapses keep the parts of the mesh that the different bones move. clusterBones maps the
+	// clusters of the mesh to the bones, -1 for none. There are outAttributeWeights->size() floats per vertex.
+	static void GetLODAttributes(const Speck::AppCommands::StaticMeshVertex *vertices, const SpeckAssetFormat::VertexWeights *vertexWeights,
+		UINT vertexCount, const std::vector<int> &clusterBones, UINT boneCount, std::vector<float> *outAttributes, std::vector<float> *outAttributeWeights);
+
+private:
+	void ProcessBone(const SpeckAssetFormat::Node &node, const std::string &boneName, std::vector<Speck::WorldCommands::NewSpeck> *specks);
+	// Transforms the weighted vertices of the mesh to the spaces of the bones.
+	void BuildSkin(const SpeckAssetFile &asset, UINT meshIndex);
+
+private:
+	std::vector<Bone> mBones;
+	std::vector<Joint> mJoints;
+	// Maps every node name to the result of GetNodeBoneIndex
+	std::unordered_map<std::string, int> mNodeBones;
+	// Animation baked from the FBX scene, sampled without the FBX SDK
+	AnimationClip mAnimationClip;
+	// Model space transforms of the clip joints when no animation is applied
+	AnimationPose mBindPose;
+	bool mHasSkin;
+	Speck::AppCommands::CreateSkinnedGeometryCommand mSkinMesh;
+	UINT mSpeckCount;
+};
+
+#endif
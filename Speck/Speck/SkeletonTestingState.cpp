@@ -162,7 +162,10 @@ void SkeletonTestingState::Initialize()
 	GetWorld().ExecuteCommand(efc);
 
 	mHumanoidSkeleton = make_unique<HumanoidSkeleton>(&mFBXSceneManager, GetWorld());
-	mHumanoidSkeleton->Initialize(L"Data/Animations/knight_dancing.fbx", L"Data/Animations/knight.json", &GetApp(), false);
+	if (!mHumanoidSkeleton->Initialize(L"Data/Animations/knight_dancing.fbx", L"Data/Animations/knight.json", &GetApp(), false))
+	{
+		mHumanoidSkeleton.reset();
+	}
 
 	WorldCommands::SetTimeMultiplierCommand stmc;
 	stmc.timeMultiplierConstant = 2.0f;
@@ -193,6 +196,10 @@ void SkeletonTestingState::Update(float dt)
 
 	t += dt;
 
+	if (!mHumanoidSkeleton)
+	{
+		return;
+	}
 	if (t < 20.1f && t > 0.0f)
 	{
 		mHumanoidSkeleton->UpdateAnimation(t*1.0f);
@@ -121,8 +121,14 @@ void SkinnedSkeletonTestingState::Initialize()
 
 	// add the skeleton
 	mHumanoidSkeleton = make_unique<HumanoidSkeleton>(&mFBXSceneManager, GetWorld());
-	mHumanoidSkeleton->Initialize(L"Data/Animations/knight_jump.fbx", L"Data/Animations/knight.json", &GetApp(), true);
-	mHumanoidSkeleton->SetWorldTransform(XMMatrixTranslation(0.0f, 0.6f, 0.0f));
+	if (mHumanoidSkeleton->Initialize(L"Data/Animations/knight_jump.fbx", L"Data/Animations/knight.json", &GetApp(), true))
+	{
+		mHumanoidSkeleton->SetWorldTransform(XMMatrixTranslation(0.0f, 0.6f, 0.0f));
+	}
+	else
+	{
+		mHumanoidSkeleton.reset();
+	}
 
 	WorldCommands::SetTimeMultiplierCommand stmc;
 	stmc.timeMultiplierConstant = 1.0f;
@@ -159,7 +165,11 @@ void SkinnedSkeletonTestingState::Update(float dt)
 	float t1 = 2.0f;
 	float t2 = t1 + 0.69f;
 
-	if (t < t1)
+	if (!mHumanoidSkeleton)
+	{
+		// nothing to animate
+	}
+	else if (t < t1)
 	{
 		// wait
 		mHumanoidSkeleton->UpdateAnimation(0.0f);
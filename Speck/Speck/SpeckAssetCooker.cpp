@@ -0,0 +1,394 @@
+#include "SpeckAssetCooker.h"
+#include "SpeckAssetFile.h"
+#include "AnimationClip.h"
+#include "AnimationClipBaker.h"
+#include "FBXSceneManager.h"
+#include "FBXConversions.h"
+#include "VertexWelder.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using namespace SpeckAssetFormat;
+
+// Contents of the package, only used while cooking.
+struct SpeckAssetSource
+{
+	vector<Node> nodes;
+	vector<Mesh> meshes;
+	vector<AppCommands::StaticMeshVertex> vertices;
+	vector<VertexWeights> vertexWeights;
+	vector<uint32_t> indices;
+	vector<Cluster> clusters;
+	vector<char> strings;
+	AnimationClip clip;
+	AnimationPose bindPose;
+};
+
+// Appends the string followed by the null character.
+static String AddString(vector<char> *strings, const string &str)
+{
+	String out;
+	out.offset = (uint32_t)strings->size();
+	out.length = (uint32_t)str.size();
+	strings->insert(strings->end(), str.begin(), str.end());
+	strings->push_back('\0');
+	return out;
+}
+
+// Nodes in the same order as the animation clip joints, parents before their children.
+static void ExtractNodes(FbxScene *scene, SpeckAssetSource *source, vector<FbxNode *> *outNodes, unordered_map<FbxNode *, uint32_t> *outNodeIndices)
+{
+	vector<pair<FbxNode *, int>> nodeStack;
+	nodeStack.push_back(make_pair(scene->GetRootNode(), -1));
+	while (!nodeStack.empty())
+	{
+		// Pop the last item on the stack
+		pair<FbxNode *, int> item = nodeStack.back();
+		nodeStack.pop_back();
+		FbxNode *fbxNode = item.first;
+
+		FbxAMatrix world = fbxNode->EvaluateGlobalTransform();
+		Node node;
+		node.name = AddString(&source->strings, fbxNode->GetName());
+		node.parent = item.second;
+		node.mesh = -1;
+		Conv(&node.globalTransform, world);
+		FbxVector4 sca = world.GetS();
+		node.globalScale = XMFLOAT3((float)sca[0], (float)sca[1], (float)sca[2]);
+		Conv(&node.globalRotation, world.GetQ());
+
+		int index = (int)source->nodes.size();
+		(*outNodeIndices)[fbxNode] = (uint32_t)index;
+		outNodes->push_back(fbxNode);
+		source->nodes.push_back(node);
+		int numChildren = fbxNode->GetChildCount();
+		for (int i = 0; i < numChildren; i++)
+		{
+			nodeStack.push_back(make_pair(fbxNode->GetChild(i), index));
+		}
+	}
+}
+
+static void ExtractMesh(FbxNode *fbxNode, uint32_t nodeIndex, const unordered_map<FbxNode *, uint32_t> &nodeIndices, SpeckAssetSource *source)
+{
+	FbxMesh *meshPt = fbxNode->GetMesh();
+	FbxAMatrix world = fbxNode->EvaluateGlobalTransform();
+	FbxStringList pUVSetNameList;
+	meshPt->GetUVSetNames(pUVSetNameList);
+
+	// Weld the polygon corners and triangulate the polygons as fans
+	vector<AppCommands::StaticMeshVertex> vertices;
+	vector<int> vertexControlPoints;
+	vector<uint32_t> indices;
+	vector<uint32_t> polygonVertices;
+	VertexWelder<AppCommands::StaticMeshVertex> welder(&vertices, meshPt->GetPolygonVertexCount());
+	FbxVector4 *controlPoints = meshPt->GetControlPoints();
+	int polyCount = meshPt->GetPolygonCount();
+	for (int i = 0; i < polyCount; i++)
+	{
+		polygonVertices.clear();
+		int polyVertCount = meshPt->GetPolygonSize(i);
+		for (int j = 0; j < polyVertCount; j++)
+		{
+			AppCommands::StaticMeshVertex vert = {};
+			int cpIndex = meshPt->GetPolygonVertex(i, j);
+
+			FbxVector4 controlPoint = controlPoints[cpIndex];
+			controlPoint.mData[3] = 1.0f;
+			FbxVector4 pos = world.MultT(controlPoint);
+			vert.Position = XMFLOAT3((float)pos.mData[0], (float)pos.mData[1], (float)pos.mData[2]);
+
+			FbxVector4 pNormal;
+			meshPt->GetPolygonVertexNormal(i, j, pNormal);
+			vert.Normal = XMFLOAT3((float)pNormal.mData[0], (float)pNormal.mData[1], (float)pNormal.mData[2]);
+
+			FbxVector2 pUV;
+			bool hasUV = false, retVal = false;
+			for (int k = 0; k < pUVSetNameList.GetCount(); k++)
+			{
+				retVal = meshPt->GetPolygonVertexUV(i, j, pUVSetNameList[k], pUV, hasUV);
+				if (retVal) break;
+			}
+			if (retVal)
+				vert.TexC = XMFLOAT2((float)pUV.mData[0], (float)pUV.mData[1]);
+
+			bool added;
+			polygonVertices.push_back(welder.Add(vert, &added));
+			if (added) vertexControlPoints.push_back(cpIndex);
+		}
+		for (int j = 1; j + 1 < polyVertCount; j++)
+		{
+			indices.push_back(polygonVertices[0]);
+			indices.push_back(polygonVertices[j]);
+			indices.push_back(polygonVertices[j + 1]);
+		}
+	}
+
+	Mesh mesh;
+	mesh.meshName = AddString(&source->strings, meshPt->GetName());
+	mesh.node = nodeIndex;
+	mesh.firstVertex = (uint32_t)source->vertices.size();
+	mesh.vertexCount = (uint32_t)vertices.size();
+	mesh.firstIndex = (uint32_t)source->indices.size();
+	mesh.indexCount = (uint32_t)indices.size();
+	mesh.firstCluster = (uint32_t)source->clusters.size();
+	mesh.clusterCount = 0;
+
+	// Skin clusters and the influences of every control point
+	vector<VertexWeights> vertexWeights(vertices.size(), VertexWeights());
+	if (meshPt->GetDeformerCount(FbxDeformer::eSkin) > 0)
+	{
+		vector<vector<pair<float, uint32_t>>> influences(meshPt->GetControlPointsCount());
+		FbxSkin *pSkin = (FbxSkin*)meshPt->GetDeformer(0, FbxDeformer::eSkin);
+		int ncBones = pSkin->GetClusterCount();
+		for (int boneIndex = 0; boneIndex < ncBones; ++boneIndex)
+		{
+			FbxCluster* cluster = pSkin->GetCluster(boneIndex);
+			auto linkIt = nodeIndices.find(cluster->GetLink());
+			if (linkIt == nodeIndices.end()) continue;
+
+			Cluster c;
+			c.linkNode = linkIt->second;
+			FbxAMatrix bindPoseMatrix;
+			cluster->GetTransformLinkMatrix(bindPoseMatrix);
+			Conv(&c.bindPose, bindPoseMatrix);
+
+			int *pVertexIndices = cluster->GetControlPointIndices();
+			double *pVertexWeights = cluster->GetControlPointWeights();
+			int ncVertexIndices = cluster->GetControlPointIndicesCount();
+			for (int i = 0; i < ncVertexIndices; i++)
+			{
+				float weight = (float)pVertexWeights[i];
+				if (weight > 0.0f) influences[pVertexIndices[i]].push_back(make_pair(weight, mesh.clusterCount));
+			}
+			source->clusters.push_back(c);
+			++mesh.clusterCount;
+		}
+
+		// Keep the strongest influences
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			vector<pair<float, uint32_t>> &vertexInfluences = influences[vertexControlPoints[i]];
+			stable_sort(vertexInfluences.begin(), vertexInfluences.end(),
+				[](const pair<float, uint32_t> &a, const pair<float, uint32_t> &b) { return a.first > b.first; });
+			UINT count = min((UINT)vertexInfluences.size(), (UINT)MAX_BONES_PER_VERTEX);
+			float weightSum = 0.0f;
+			for (UINT j = 0; j < count; ++j) weightSum += vertexInfluences[j].first;
+			for (UINT j = 0; j < count; ++j)
+			{
+				vertexWeights[i].clusters[j] = vertexInfluences[j].second;
+				vertexWeights[i].weights[j] = vertexInfluences[j].first / weightSum;
+			}
+		}
+	}
+
+	source->nodes[nodeIndex].mesh = (int32_t)source->meshes.size();
+	source->meshes.push_back(mesh);
+	source->vertices.insert(source->vertices.end(), vertices.begin(), vertices.end());
+	source->vertexWeights.insert(source->vertexWeights.end(), vertexWeights.begin(), vertexWeights.end());
+	source->indices.insert(source->indices.end(), indices.begin(), indices.end());
+}
+
+static void Extract(FbxScene *scene, SpeckAssetSource *source)
+{
+	vector<FbxNode *> nodes;
+	unordered_map<FbxNode *, uint32_t> nodeIndices;
+	ExtractNodes(scene, source, &nodes, &nodeIndices);
+	for (uint32_t i = 0; i < (uint32_t)nodes.size(); ++i)
+	{
+		if (nodes[i]->GetMesh()) ExtractMesh(nodes[i], i, nodeIndices, source);
+	}
+
+	// The last anim stack is the one that is played
+	int numStacks = scene->GetSrcObjectCount<FbxAnimStack>();
+	if (numStacks > 0)
+	{
+		FbxAnimStack* pAnimStack = FbxCast<FbxAnimStack>(scene->GetSrcObject<FbxAnimStack>(numStacks - 1));
+		AnimationClipBaker::Bake(scene, pAnimStack, 0.0f, &source->clip, &source->bindPose);
+	}
+}
+
+static bool Write(SpeckAssetSource &source, const wchar_t *assetFilePath)
+{
+	// Flatten the animation clip
+	const AnimationClip &clip = source.clip;
+	vector<ClipJoint> clipJoints(clip.GetJointCount());
+	for (UINT j = 0; j < clip.GetJointCount(); ++j)
+	{
+		clipJoints[j].name = AddString(&source.strings, clip.GetJointName(j));
+		clipJoints[j].parent = clip.GetParentIndex(j);
+	}
+	vector<BindPoseJoint> bindPose(source.bindPose.mRotations.size());
+	for (size_t j = 0; j < bindPose.size(); ++j)
+	{
+		bindPose[j].rotation = source.bindPose.mRotations[j];
+		bindPose[j].translation = source.bindPose.mTranslations[j];
+		bindPose[j].scale = source.bindPose.mScales[j];
+	}
+
+	// Layout
+	Header header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.clipDuration = clip.GetDuration();
+	header.clipSampleRate = clip.GetSampleRate();
+	header.clipSampleCount = clip.GetSampleCount();
+	header.clipJointStride = clip.GetJointStride();
+	uint32_t offset = (uint32_t)sizeof(Header);
+	auto place = [&offset](Section *section, size_t count, size_t elementSize)
+	{
+		section->offset = offset;
+		section->count = (uint32_t)count;
+		offset += (uint32_t)((count * elementSize + 3) & ~(size_t)3);
+	};
+	place(&header.nodes, source.nodes.size(), sizeof(Node));
+	place(&header.meshes, source.meshes.size(), sizeof(Mesh));
+	place(&header.vertices, source.vertices.size(), sizeof(AppCommands::StaticMeshVertex));
+	place(&header.vertexWeights, source.vertexWeights.size(), sizeof(VertexWeights));
+	place(&header.indices, source.indices.size(), sizeof(uint32_t));
+	place(&header.clusters, source.clusters.size(), sizeof(Cluster));
+	place(&header.clipJoints, clipJoints.size(), sizeof(ClipJoint));
+	place(&header.clipScales, clip.GetScales().size(), sizeof(float));
+	place(&header.clipRotations, clip.GetRotations().size(), sizeof(int16_t));
+	place(&header.clipTranslations, clip.GetTranslations().size(), sizeof(float));
+	place(&header.bindPose, bindPose.size(), sizeof(BindPoseJoint));
+	place(&header.strings, source.strings.size(), sizeof(char));
+	header.fileSize = offset;
+
+	// Copy everything to one buffer
+	vector<uint8_t> buffer(header.fileSize, 0);
+	auto copySection = [&buffer](const Section &section, const void *data, size_t elementSize)
+	{
+		if (section.count > 0) memcpy(&buffer[section.offset], data, section.count * elementSize);
+	};
+	memcpy(&buffer[0], &header, sizeof(Header));
+	copySection(header.nodes, source.nodes.data(), sizeof(Node));
+	copySection(header.meshes, source.meshes.data(), sizeof(Mesh));
+	copySection(header.vertices, source.vertices.data(), sizeof(AppCommands::StaticMeshVertex));
+	copySection(header.vertexWeights, source.vertexWeights.data(), sizeof(VertexWeights));
+	copySection(header.indices, source.indices.data(), sizeof(uint32_t));
+	copySection(header.clusters, source.clusters.data(), sizeof(Cluster));
+	copySection(header.clipJoints, clipJoints.data(), sizeof(ClipJoint));
+	copySection(header.clipScales, clip.GetScales().data(), sizeof(float));
+	copySection(header.clipRotations, clip.GetRotations().data(), sizeof(int16_t));
+	copySection(header.clipTranslations, clip.GetTranslations().data(), sizeof(float));
+	copySection(header.bindPose, bindPose.data(), sizeof(BindPoseJoint));
+	copySection(header.strings, source.strings.data(), sizeof(char));
+
+	// Save
+	ofstream fileStream(assetFilePath, ios::out | ios::binary | ios::trunc);
+	if (!fileStream.is_open()) return false;
+	fileStream.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+	fileStream.close();
+	return !fileStream.fail();
+}
+
+template <class T> static bool AreEqual(const T *data, const vector<T> &expected, size_t first, size_t count)
+{
+	return count == 0 || memcmp(data, &expected[first], count * sizeof(T)) == 0;
+}
+
+// Reads the package back and compares it with the data taken from the FBX scene.
+static bool Verify(const SpeckAssetSource &source, const wchar_t *assetFilePath)
+{
+	SpeckAssetFile file;
+	if (!file.Open(assetFilePath)) return false;
+	if (file.GetNodeCount() != source.nodes.size() || file.GetMeshCount() != source.meshes.size()) return false;
+
+	// Nodes
+	for (UINT i = 0; i < file.GetNodeCount(); ++i)
+	{
+		const Node &node = file.GetNode(i);
+		if (memcmp(&node, &source.nodes[i], sizeof(Node)) != 0) return false;
+		if (strcmp(file.GetString(node.name), &source.strings[node.name.offset]) != 0) return false;
+	}
+
+	// Meshes
+	for (UINT i = 0; i < file.GetMeshCount(); ++i)
+	{
+		const Mesh &mesh = file.GetMesh(i);
+		if (memcmp(&mesh, &source.meshes[i], sizeof(Mesh)) != 0) return false;
+		if (strcmp(file.GetString(mesh.meshName), &source.strings[mesh.meshName.offset]) != 0) return false;
+		if (!AreEqual(file.GetVertices(mesh), source.vertices, mesh.firstVertex, mesh.vertexCount) ||
+			!AreEqual(file.GetVertexWeights(mesh), source.vertexWeights, mesh.firstVertex, mesh.vertexCount) ||
+			!AreEqual(file.GetIndices(mesh), source.indices, mesh.firstIndex, mesh.indexCount) ||
+			!AreEqual(file.GetClusters(mesh), source.clusters, mesh.firstCluster, mesh.clusterCount))
+			return false;
+	}
+
+	// Animation clip
+	AnimationClip clip;
+	AnimationPose bindPose;
+	file.GetAnimationClip(&clip, &bindPose);
+	const AnimationClip &expected = source.clip;
+	if (clip.GetDuration() != expected.GetDuration() || clip.GetJointCount() != expected.GetJointCount()) return false;
+	for (UINT j = 0; j < clip.GetJointCount(); ++j)
+	{
+		if (clip.GetJointName(j) != expected.GetJointName(j) || clip.GetParentIndex(j) != expected.GetParentIndex(j)) return false;
+	}
+	if (clip.GetSampleRate() != expected.GetSampleRate() || clip.GetSampleCount() != expected.GetSampleCount() ||
+		clip.GetScales() != expected.GetScales() || clip.GetRotations() != expected.GetRotations() || clip.GetTranslations() != expected.GetTranslations())
+		return false;
+	if (bindPose.mRotations.size() != source.bindPose.mRotations.size() ||
+		!AreEqual(bindPose.mRotations.data(), source.bindPose.mRotations, 0, bindPose.mRotations.size()) ||
+		!AreEqual(bindPose.mTranslations.data(), source.bindPose.mTranslations, 0, bindPose.mTranslations.size()) ||
+		!AreEqual(bindPose.mScales.data(), source.bindPose.mScales, 0, bindPose.mScales.size()))
+		return false;
+
+	return true;
+}
+
+bool SpeckAssetCooker::Cook(FBXSceneManager *sceneManager, const wchar_t *fbxFilePath, const wchar_t *assetFilePath)
+{
+	FbxScene *scene = sceneManager->GetScene(fbxFilePath);
+	if (!scene)
+	{
+		LOG(TEXT("Could not import the FBX file: ") + wstring(fbxFilePath), ERROR);
+		return false;
+	}
+
+	SpeckAssetSource source;
+	Extract(scene, &source);
+
+	if (!Write(source, assetFilePath))
+	{
+		LOG(TEXT("Could not write the speck asset file: ") + wstring(assetFilePath), ERROR);
+		return false;
+	}
+
+	if (!Verify(source, assetFilePath))
+	{
+		LOG(TEXT("Cooked speck asset file does not match the FBX file: ") + wstring(assetFilePath), ERROR);
+		return false;
+	}
+
+	return true;
+}
+
+bool SpeckAssetCooker::CookIfOutdated(FBXSceneManager *sceneManager, const wchar_t *fbxFilePath, const wchar_t *assetFilePath)
+{
+#ifdef NDEBUG
+	// Release builds only load the packages cooked by the post-build step of Speck
+	SpeckAssetFile file;
+	if (file.Open(assetFilePath))
+		return true;
+	LOG(TEXT("Missing or outdated speck asset, cooked when Speck is built: ") + wstring(assetFilePath), ERROR);
+	return false;
+#else
+	WIN32_FILE_ATTRIBUTE_DATA fbxAttributes, assetAttributes;
+	bool assetExists = (GetFileAttributesExW(assetFilePath, GetFileExInfoStandard, &assetAttributes) != 0);
+	if (!GetFileAttributesExW(fbxFilePath, GetFileExInfoStandard, &fbxAttributes))
+		return assetExists; // nothing to cook from
+
+	// Packages written by an older version of the cooker do not open
+	if (assetExists && CompareFileTime(&assetAttributes.ftLastWriteTime, &fbxAttributes.ftLastWriteTime) >= 0)
+	{
+		SpeckAssetFile file;
+		if (file.Open(assetFilePath))
+			return true;
+	}
+
+	return Cook(sceneManager, fbxFilePath, assetFilePath);
+#endif
+}
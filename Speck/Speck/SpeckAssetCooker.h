@@ -0,0 +1,21 @@
+#ifndef SPECK_ASSET_COOKER_H
+#define SPECK_ASSET_COOKER_H
+
+#include <SpeckEngineDefinitions.h>
+
+class FBXSceneManager;
+
+// Converts FBX files to the binary .speckasset format (see SpeckAssetFile.h): node transforms, welded and
+// triangulated meshes with their skin weights and clusters, and the baked animation of the last stack.
+// This is the only place where the FBX SDK is needed, the runtime only reads the cooked files.
+class SpeckAssetCooker
+{
+public:
+	// Writes the package and checks that it reads back the same as the data taken from the FBX scene. Returns false on failure.
+	static bool Cook(FBXSceneManager *sceneManager, const wchar_t *fbxFilePath, const wchar_t *assetFilePath);
+	// Cooks only if the package is missing, invalid or older than the FBX file. Without the FBX file the existing package is used.
+	// Release builds never cook, the packages of the app are cooked by the post-build step and a missing one fails to load.
+	static bool CookIfOutdated(FBXSceneManager *sceneManager, const wchar_t *fbxFilePath, const wchar_t *assetFilePath);
+};
+
+#endif
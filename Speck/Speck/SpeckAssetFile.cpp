@@ -0,0 +1,191 @@
+#include "SpeckAssetFile.h"
+#include "AnimationClip.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using namespace SpeckAssetFormat;
+
+// Checks that the section lies inside of the file and is properly aligned.
+static bool IsSectionValid(const Section &section, size_t elementSize, uint64_t fileSize)
+{
+	if (section.offset % 4 != 0) return false;
+	return (uint64_t)section.offset + (uint64_t)section.count * elementSize <= fileSize;
+}
+
+SpeckAssetFile::SpeckAssetFile()
+	: mHeader(nullptr)
+{
+
+}
+
+SpeckAssetFile::~SpeckAssetFile()
+{
+	Close();
+}
+
+bool SpeckAssetFile::Open(const wchar_t *filePath)
+{
+	Close();
+	if (!mFile.Open(filePath))
+		return false;
+
+	if (mFile.GetSize() < sizeof(Header))
+	{
+		LOG(TEXT("Speck asset file is too small: ") + wstring(filePath), ERROR);
+		Close();
+		return false;
+	}
+
+	mHeader = reinterpret_cast<const Header *>(mFile.GetData());
+	if (!Validate())
+	{
+		LOG(TEXT("Invalid speck asset file: ") + wstring(filePath), ERROR);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void SpeckAssetFile::Close()
+{
+	mHeader = nullptr;
+	mFile.Close();
+}
+
+bool SpeckAssetFile::Validate() const
+{
+	// Header
+	const Header &h = *mHeader;
+	uint64_t fileSize = mFile.GetSize();
+	if (memcmp(h.magic, Magic, sizeof(Magic)) != 0 || h.version != Version || h.fileSize != fileSize)
+		return false;
+
+	// Sections
+	if (!IsSectionValid(h.nodes, sizeof(Node), fileSize) ||
+		!IsSectionValid(h.meshes, sizeof(Mesh), fileSize) ||
+		!IsSectionValid(h.vertices, sizeof(AppCommands::StaticMeshVertex), fileSize) ||
+		!IsSectionValid(h.vertexWeights, sizeof(VertexWeights), fileSize) ||
+		!IsSectionValid(h.indices, sizeof(uint32_t), fileSize) ||
+		!IsSectionValid(h.clusters, sizeof(Cluster), fileSize) ||
+		!IsSectionValid(h.clipJoints, sizeof(ClipJoint), fileSize) ||
+		!IsSectionValid(h.clipScales, sizeof(float), fileSize) ||
+		!IsSectionValid(h.clipRotations, sizeof(int16_t), fileSize) ||
+		!IsSectionValid(h.clipTranslations, sizeof(float), fileSize) ||
+		!IsSectionValid(h.bindPose, sizeof(BindPoseJoint), fileSize) ||
+		!IsSectionValid(h.strings, sizeof(char), fileSize))
+		return false;
+
+	// Every string has to end with the null character inside of the strings section
+	const char *strings = GetSection<char>(h.strings);
+	auto isStringValid = [&](const String &str)
+	{
+		return (uint64_t)str.offset + str.length < h.strings.count && strings[str.offset + str.length] == '\0';
+	};
+
+	// Nodes, parents come first
+	const Node *nodes = GetSection<Node>(h.nodes);
+	for (UINT i = 0; i < h.nodes.count; ++i)
+	{
+		if (!isStringValid(nodes[i].name)) return false;
+		if (nodes[i].parent < -1 || nodes[i].parent >= (int32_t)i) return false;
+		if (nodes[i].mesh < -1 || nodes[i].mesh >= (int32_t)h.meshes.count) return false;
+	}
+
+	// Meshes
+	if (h.vertexWeights.count != h.vertices.count) return false;
+	const Mesh *meshes = GetSection<Mesh>(h.meshes);
+	const uint32_t *indices = GetSection<uint32_t>(h.indices);
+	const VertexWeights *vertexWeights = GetSection<VertexWeights>(h.vertexWeights);
+	for (UINT i = 0; i < h.meshes.count; ++i)
+	{
+		const Mesh &mesh = meshes[i];
+		if (!isStringValid(mesh.meshName) || mesh.node >= h.nodes.count) return false;
+		if ((uint64_t)mesh.firstVertex + mesh.vertexCount > h.vertices.count) return false;
+		if ((uint64_t)mesh.firstIndex + mesh.indexCount > h.indices.count) return false;
+		if ((uint64_t)mesh.firstCluster + mesh.clusterCount > h.clusters.count) return false;
+		for (UINT j = 0; j < mesh.indexCount; ++j)
+		{
+			if (indices[mesh.firstIndex + j] >= mesh.vertexCount) return false;
+		}
+		for (UINT j = 0; j < mesh.vertexCount; ++j)
+		{
+			const VertexWeights &vw = vertexWeights[mesh.firstVertex + j];
+			for (UINT k = 0; k < MAX_BONES_PER_VERTEX; ++k)
+			{
+				if (vw.weights[k] != 0.0f && vw.clusters[k] >= mesh.clusterCount) return false;
+			}
+		}
+	}
+	const Cluster *clusters = GetSection<Cluster>(h.clusters);
+	for (UINT i = 0; i < h.clusters.count; ++i)
+	{
+		if (clusters[i].linkNode >= h.nodes.count) return false;
+	}
+
+	// Animation clip
+	uint32_t jointCount = h.clipJoints.count;
+	if (h.clipJointStride != ((jointCount + 3) & ~3U)) return false;
+	if (h.clipScales.count != jointCount || (h.bindPose.count != 0 && h.bindPose.count != jointCount)) return false;
+	if ((uint64_t)h.clipRotations.count != (uint64_t)h.clipSampleCount * 4 * h.clipJointStride) return false;
+	if ((uint64_t)h.clipTranslations.count != (uint64_t)h.clipSampleCount * 3 * h.clipJointStride) return false;
+	const ClipJoint *clipJoints = GetSection<ClipJoint>(h.clipJoints);
+	for (UINT i = 0; i < jointCount; ++i)
+	{
+		if (!isStringValid(clipJoints[i].name)) return false;
+		if (clipJoints[i].parent < -1 || clipJoints[i].parent >= (int32_t)i) return false;
+	}
+
+	return true;
+}
+
+void SpeckAssetFile::GetStaticGeometry(UINT meshIndex, AppCommands::CreateStaticGeometryCommand *outCommand) const
+{
+	const Mesh &mesh = GetMesh(meshIndex);
+	outCommand->geometryName = GetString(GetNode(mesh.node).name);
+	outCommand->meshName = GetString(mesh.meshName);
+	const AppCommands::StaticMeshVertex *vertices = GetVertices(mesh);
+	outCommand->vertices.assign(vertices, vertices + mesh.vertexCount);
+	const uint32_t *indices = GetIndices(mesh);
+	outCommand->indices.assign(indices, indices + mesh.indexCount);
+}
+
+void SpeckAssetFile::GetAnimationClip(AnimationClip *outClip, AnimationPose *outBindPose) const
+{
+	const Header &h = *mHeader;
+	AnimationClip &clip = *outClip;
+	clip.mDuration = h.clipDuration;
+	clip.mSampleRate = h.clipSampleRate;
+	clip.mSampleCount = h.clipSampleCount;
+	clip.mJointCount = h.clipJoints.count;
+	clip.mJointStride = h.clipJointStride;
+	clip.mParentIndices.resize(clip.mJointCount);
+	clip.mJointNames.resize(clip.mJointCount);
+	const ClipJoint *clipJoints = GetSection<ClipJoint>(h.clipJoints);
+	for (UINT j = 0; j < clip.mJointCount; ++j)
+	{
+		clip.mParentIndices[j] = clipJoints[j].parent;
+		clip.mJointNames[j] = GetString(clipJoints[j].name);
+	}
+	const float *scales = GetSection<float>(h.clipScales);
+	clip.mScales.assign(scales, scales + h.clipScales.count);
+	const int16_t *rotations = GetSection<int16_t>(h.clipRotations);
+	clip.mRotations.assign(rotations, rotations + h.clipRotations.count);
+	const float *translations = GetSection<float>(h.clipTranslations);
+	clip.mTranslations.assign(translations, translations + h.clipTranslations.count);
+
+	if (outBindPose)
+	{
+		const BindPoseJoint *bindPose = GetSection<BindPoseJoint>(h.bindPose);
+		outBindPose->mRotations.resize(h.bindPose.count);
+		outBindPose->mTranslations.resize(h.bindPose.count);
+		outBindPose->mScales.resize(h.bindPose.count);
+		for (UINT j = 0; j < h.bindPose.count; ++j)
+		{
+			outBindPose->mRotations[j] = bindPose[j].rotation;
+			outBindPose->mTranslations[j] = bindPose[j].translation;
+			outBindPose->mScales[j] = bindPose[j].scale;
+		}
+	}
+}
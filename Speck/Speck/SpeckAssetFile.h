@@ -0,0 +1,149 @@
+#ifndef SPECK_ASSET_FILE_H
+#define SPECK_ASSET_FILE_H
+
+#include <SpeckEngineDefinitions.h>
+#include <MemoryMappedFile.h>
+#include <AppCommands.h>
+
+class AnimationClip;
+struct AnimationPose;
+
+// Binary, memory mappable package cooked from an FBX file (see SpeckAssetCooker.h).
+// Sections are arrays of 4 byte aligned PODs addressed by offsets from the beginning of the file.
+namespace SpeckAssetFormat
+{
+	const char Magic[4] = { 'S', 'P', 'K', 'A' };
+	// Change whenever the layout of the file changes
+	const uint32_t Version = 1;
+
+	struct Section
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t fileSize;
+		// Animation clip
+		float clipDuration;
+		float clipSampleRate;
+		uint32_t clipSampleCount;
+		uint32_t clipJointStride;
+		Section nodes;				// Node
+		Section meshes;				// Mesh
+		Section vertices;			// Speck::AppCommands::StaticMeshVertex
+		Section vertexWeights;		// VertexWeights, one for every vertex
+		Section indices;			// uint32_t, relative to the first vertex of the mesh
+		Section clusters;			// Cluster
+		Section clipJoints;			// ClipJoint
+		Section clipScales;			// float, one for every joint
+		Section clipRotations;		// int16_t, for every sample x, y, z and w of all joints (SoA)
+		Section clipTranslations;	// float, for every sample x, y and z of all joints (SoA)
+		Section bindPose;			// BindPoseJoint, one for every clip joint
+		Section strings;			// char, every string is followed by a null character
+	};
+
+	struct String
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	// Scene node at the default time. Nodes are stored so that parents come before their children.
+	struct Node
+	{
+		String name;
+		int32_t parent;
+		// Mesh attached to the node, -1 if none
+		int32_t mesh;
+		DirectX::XMFLOAT4X4 globalTransform;
+		DirectX::XMFLOAT3 globalScale;
+		DirectX::XMFLOAT4 globalRotation;
+	};
+
+	// Welded triangle mesh, positions are in the model space. Skinned meshes have clusters.
+	struct Mesh
+	{
+		String meshName;
+		uint32_t node;
+		uint32_t firstVertex;
+		uint32_t vertexCount;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t firstCluster;
+		uint32_t clusterCount;
+	};
+
+	// Up to four strongest influences normalized to the sum of one, unused ones have zero weight.
+	struct VertexWeights
+	{
+		uint32_t clusters[MAX_BONES_PER_VERTEX]; // relative to the first cluster of the mesh
+		float weights[MAX_BONES_PER_VERTEX];
+	};
+
+	// Node that deforms a skinned mesh
+	struct Cluster
+	{
+		uint32_t linkNode;
+		// Model space transform of the node when the mesh was bound, the inverse bind pose is its inverse
+		DirectX::XMFLOAT4X4 bindPose;
+	};
+
+	struct ClipJoint
+	{
+		String name;
+		int32_t parent;
+	};
+
+	struct BindPoseJoint
+	{
+		DirectX::XMFLOAT4 rotation;
+		DirectX::XMFLOAT3 translation;
+		float scale;
+	};
+}
+
+// Read-only access to a memory mapped .speckasset file. Nothing is allocated after the file is opened.
+class SpeckAssetFile
+{
+public:
+	SpeckAssetFile();
+	~SpeckAssetFile();
+
+	// Maps the file and validates all of its offsets and indices.
+	bool Open(const wchar_t *filePath);
+	void Close();
+
+	UINT GetNodeCount() const { return mHeader ? mHeader->nodes.count : 0; }
+	const SpeckAssetFormat::Node &GetNode(UINT node) const { return GetSection<SpeckAssetFormat::Node>(mHeader->nodes)[node]; }
+	UINT GetMeshCount() const { return mHeader ? mHeader->meshes.count : 0; }
+	const SpeckAssetFormat::Mesh &GetMesh(UINT mesh) const { return GetSection<SpeckAssetFormat::Mesh>(mHeader->meshes)[mesh]; }
+	const Speck::AppCommands::StaticMeshVertex *GetVertices(const SpeckAssetFormat::Mesh &mesh) const { return GetSection<Speck::AppCommands::StaticMeshVertex>(mHeader->vertices) + mesh.firstVertex; }
+	const SpeckAssetFormat::VertexWeights *GetVertexWeights(const SpeckAssetFormat::Mesh &mesh) const { return GetSection<SpeckAssetFormat::VertexWeights>(mHeader->vertexWeights) + mesh.firstVertex; }
+	const uint32_t *GetIndices(const SpeckAssetFormat::Mesh &mesh) const { return GetSection<uint32_t>(mHeader->indices) + mesh.firstIndex; }
+	const SpeckAssetFormat::Cluster *GetClusters(const SpeckAssetFormat::Mesh &mesh) const { return GetSection<SpeckAssetFormat::Cluster>(mHeader->clusters) + mesh.firstCluster; }
+
+	// Fills the command with the mesh, named after its node.
+	void GetStaticGeometry(UINT mesh, Speck::AppCommands::CreateStaticGeometryCommand *outCommand) const;
+	// Copies the animation clip and the model space bind pose of its joints.
+	void GetAnimationClip(AnimationClip *outClip, AnimationPose *outBindPose) const;
+
+	// Null terminated
+	const char *GetString(const SpeckAssetFormat::String &str) const { return GetSection<char>(mHeader->strings) + str.offset; }
+
+private:
+	template <class T> const T *GetSection(const SpeckAssetFormat::Section &section) const
+	{
+		return reinterpret_cast<const T *>(mFile.GetData() + section.offset);
+	}
+	bool Validate() const;
+
+private:
+	Speck::MemoryMappedFile mFile;
+	const SpeckAssetFormat::Header *mHeader;
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include "SpeckBodyCompiler.h"
+#include "SpeckBodyFile.h"
+#include "Json.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace SpeckBodyFormat;
+using json = nlohmann::json;
+
+// Contents of the JSON file, only used while compiling.
+struct SpeckBodySource
+{
+	struct BoneSource
+	{
+		vector<string> names;
+		vector<XMFLOAT3> specks;
+	};
+	struct JointSource
+	{
+		vector<pair<string, string>> pairs;
+		vector<XMFLOAT3> specks;
+	};
+	vector<BoneSource> bones;
+	vector<JointSource> joints;
+};
+
+static void ReadSpecks(const json &speckPositionsList, vector<XMFLOAT3> *outSpecks)
+{
+	for (json::const_iterator speckPositionsListIt = speckPositionsList.begin(); speckPositionsListIt != speckPositionsList.end(); ++speckPositionsListIt)
+	{
+		const json &speckPosition = speckPositionsListIt.value();
+		XMFLOAT3 position;
+		position.x = speckPosition.at("x").get<float>();
+		position.y = speckPosition.at("y").get<float>();
+		position.z = speckPosition.at("z").get<float>();
+		outSpecks->push_back(position);
+	}
+}
+
+static bool ReadJSON(const wchar_t *jsonFilePath, SpeckBodySource *outSource)
+{
+	// Open the JSON file, read from it and close it
+	ifstream fileStream(jsonFilePath, ios::in | ios::binary);
+	if (!fileStream.is_open())
+	{
+		LOG(TEXT("Could not open the json file: ") + wstring(jsonFilePath), ERROR);
+		return false;
+	}
+	string jsonFile((istreambuf_iterator<char>(fileStream)), istreambuf_iterator<char>());
+	fileStream.close();
+
+	try
+	{
+		json j = json::parse(jsonFile);
+
+		json::iterator it = j.find("bones");
+		if (it != j.end())
+		{
+			for (const json &jsonBone : it.value())
+			{
+				SpeckBodySource::BoneSource bone;
+				for (const json &jsonBoneName : jsonBone.at("bones"))
+				{
+					bone.names.push_back(jsonBoneName.get<string>());
+				}
+				ReadSpecks(jsonBone.at("specks"), &bone.specks);
+				outSource->bones.push_back(move(bone));
+			}
+		}
+
+		it = j.find("joints");
+		if (it != j.end())
+		{
+			for (const json &jsonJoint : it.value())
+			{
+				SpeckBodySource::JointSource joint;
+				for (const json &pair : jsonJoint.at("pairs"))
+				{
+					joint.pairs.push_back(make_pair(pair.at("parentBoneName").get<string>(), pair.at("childBoneName").get<string>()));
+				}
+				ReadSpecks(jsonJoint.at("specks"), &joint.specks);
+				outSource->joints.push_back(move(joint));
+			}
+		}
+	}
+	catch (const exception& ex)
+	{
+		(void)ex; // Mark the object as "used" by casting it to void. It has no influence on the generated machine code, but it will suppress the compiler warning.
+		LOG(TEXT("Exception caught while parsing a json file: ") + wstring(jsonFilePath) + TEXT(" ."), WARNING);
+		LOG(StrToWStr(ex.what()), ERROR);
+		return false;
+	}
+
+	return true;
+}
+
+// Appends the string followed by the null character.
+static String AddString(vector<char> *strings, const string &str)
+{
+	String out;
+	out.offset = (uint32_t)strings->size();
+	out.length = (uint32_t)str.size();
+	strings->insert(strings->end(), str.begin(), str.end());
+	strings->push_back('\0');
+	return out;
+}
+
+static bool Write(const SpeckBodySource &source, const wchar_t *speckBodyFilePath)
+{
+	// Flatten
+	vector<Bone> bones;
+	vector<BoneName> boneNames;
+	vector<Joint> joints;
+	vector<JointPair> jointPairs;
+	vector<XMFLOAT3> specks;
+	vector<char> strings;
+	for (const SpeckBodySource::BoneSource &boneSource : source.bones)
+	{
+		Bone bone;
+		bone.firstSpeck = (uint32_t)specks.size();
+		bone.speckCount = (uint32_t)boneSource.specks.size();
+		specks.insert(specks.end(), boneSource.specks.begin(), boneSource.specks.end());
+		for (const string &name : boneSource.names)
+		{
+			BoneName boneName;
+			boneName.name = AddString(&strings, name);
+			boneName.hash = Hash(name.c_str(), name.size());
+			boneName.bone = (uint32_t)bones.size();
+			boneNames.push_back(boneName);
+		}
+		bones.push_back(bone);
+	}
+	for (const SpeckBodySource::JointSource &jointSource : source.joints)
+	{
+		Joint joint;
+		joint.firstPair = (uint32_t)jointPairs.size();
+		joint.pairCount = (uint32_t)jointSource.pairs.size();
+		joint.firstSpeck = (uint32_t)specks.size();
+		joint.speckCount = (uint32_t)jointSource.specks.size();
+		specks.insert(specks.end(), jointSource.specks.begin(), jointSource.specks.end());
+		for (const pair<string, string> &p : jointSource.pairs)
+		{
+			JointPair jointPair;
+			jointPair.parentBoneName = AddString(&strings, p.first);
+			jointPair.childBoneName = AddString(&strings, p.second);
+			jointPairs.push_back(jointPair);
+		}
+		joints.push_back(joint);
+	}
+
+	// Hash table, at most half full. Names are inserted in order, so for duplicates the first bone is found (as when searching the JSON).
+	uint32_t hashTableSize = 1;
+	while (hashTableSize <= 2 * boneNames.size()) hashTableSize *= 2;
+	vector<uint32_t> hashTable(hashTableSize, 0);
+	uint32_t mask = hashTableSize - 1;
+	for (uint32_t i = 0; i < (uint32_t)boneNames.size(); ++i)
+	{
+		uint32_t slot = boneNames[i].hash & mask;
+		while (hashTable[slot] != 0) slot = (slot + 1) & mask;
+		hashTable[slot] = i + 1;
+	}
+
+	// Layout
+	Header header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	uint32_t offset = (uint32_t)sizeof(Header);
+	auto place = [&offset](Section *section, size_t count, size_t elementSize)
+	{
+		section->offset = offset;
+		section->count = (uint32_t)count;
+		offset += (uint32_t)((count * elementSize + 3) & ~(size_t)3);
+	};
+	place(&header.bones, bones.size(), sizeof(Bone));
+	place(&header.boneNames, boneNames.size(), sizeof(BoneName));
+	place(&header.joints, joints.size(), sizeof(Joint));
+	place(&header.jointPairs, jointPairs.size(), sizeof(JointPair));
+	place(&header.specks, specks.size(), sizeof(XMFLOAT3));
+	place(&header.hashTable, hashTable.size(), sizeof(uint32_t));
+	place(&header.strings, strings.size(), sizeof(char));
+	header.fileSize = offset;
+
+	// Copy everything to one buffer
+	vector<uint8_t> buffer(header.fileSize, 0);
+	auto copySection = [&buffer](const Section &section, const void *data, size_t elementSize)
+	{
+		if (section.count > 0) memcpy(&buffer[section.offset], data, section.count * elementSize);
+	};
+	memcpy(&buffer[0], &header, sizeof(Header));
+	copySection(header.bones, bones.data(), sizeof(Bone));
+	copySection(header.boneNames, boneNames.data(), sizeof(BoneName));
+	copySection(header.joints, joints.data(), sizeof(Joint));
+	copySection(header.jointPairs, jointPairs.data(), sizeof(JointPair));
+	copySection(header.specks, specks.data(), sizeof(XMFLOAT3));
+	copySection(header.hashTable, hashTable.data(), sizeof(uint32_t));
+	copySection(header.strings, strings.data(), sizeof(char));
+
+	// Save
+	ofstream fileStream(speckBodyFilePath, ios::out | ios::binary | ios::trunc);
+	if (!fileStream.is_open()) return false;
+	fileStream.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+	fileStream.close();
+	return !fileStream.fail();
+}
+
+static bool AreSpecksEqual(const XMFLOAT3 *specks, UINT count, const vector<XMFLOAT3> &expected)
+{
+	return count == expected.size() && (count == 0 || memcmp(specks, expected.data(), count * sizeof(XMFLOAT3)) == 0);
+}
+
+// Reads the compiled file back and compares it with the JSON contents.
+static bool Verify(const SpeckBodySource &source, const wchar_t *speckBodyFilePath)
+{
+	SpeckBodyFile file;
+	if (!file.Open(speckBodyFilePath)) return false;
+	if (file.GetBoneCount() != source.bones.size() || file.GetJointCount() != source.joints.size()) return false;
+
+	// Bones, the name lookup has to return the first bone listing the name
+	unordered_map<string, UINT> firstBones;
+	for (UINT i = 0; i < (UINT)source.bones.size(); ++i)
+	{
+		UINT count;
+		const XMFLOAT3 *specks = file.GetBoneSpecks(i, &count);
+		if (!AreSpecksEqual(specks, count, source.bones[i].specks)) return false;
+		for (const string &name : source.bones[i].names)
+		{
+			firstBones.emplace(name, i);
+			if (file.FindBone(name.c_str(), name.size()) != (int)firstBones[name]) return false;
+		}
+	}
+
+	// Joints
+	for (UINT i = 0; i < (UINT)source.joints.size(); ++i)
+	{
+		const Joint &joint = file.GetJoint(i);
+		const SpeckBodySource::JointSource &jointSource = source.joints[i];
+		if (joint.pairCount != jointSource.pairs.size()) return false;
+		for (UINT p = 0; p < joint.pairCount; ++p)
+		{
+			const JointPair &jointPair = file.GetJointPair(joint.firstPair + p);
+			if (jointSource.pairs[p].first.compare(file.GetString(jointPair.parentBoneName)) != 0 ||
+				jointSource.pairs[p].second.compare(file.GetString(jointPair.childBoneName)) != 0)
+				return false;
+		}
+		UINT count;
+		const XMFLOAT3 *specks = file.GetJointSpecks(i, &count);
+		if (!AreSpecksEqual(specks, count, jointSource.specks)) return false;
+	}
+
+	return true;
+}
+
+bool SpeckBodyCompiler::Compile(const wchar_t *jsonFilePath, const wchar_t *speckBodyFilePath)
+{
+	SpeckBodySource source;
+	if (!ReadJSON(jsonFilePath, &source))
+		return false;
+
+	if (!Write(source, speckBodyFilePath))
+	{
+		LOG(TEXT("Could not write the speck body file: ") + wstring(speckBodyFilePath), ERROR);
+		return false;
+	}
+
+	if (!Verify(source, speckBodyFilePath))
+	{
+		LOG(TEXT("Compiled speck body file does not match the json file: ") + wstring(speckBodyFilePath), ERROR);
+		return false;
+	}
+
+	return true;
+}
+
+bool SpeckBodyCompiler::CompileIfOutdated(const wchar_t *jsonFilePath, const wchar_t *speckBodyFilePath)
+{
+	WIN32_FILE_ATTRIBUTE_DATA jsonAttributes, speckBodyAttributes;
+	bool speckBodyExists = (GetFileAttributesExW(speckBodyFilePath, GetFileExInfoStandard, &speckBodyAttributes) != 0);
+	if (!GetFileAttributesExW(jsonFilePath, GetFileExInfoStandard, &jsonAttributes))
+		return speckBodyExists; // nothing to compile from
+
+	if (speckBodyExists && CompareFileTime(&speckBodyAttributes.ftLastWriteTime, &jsonAttributes.ftLastWriteTime) >= 0)
+		return true;
+
+	return Compile(jsonFilePath, speckBodyFilePath);
+}
@@ -0,0 +1,16 @@
+#ifndef SPECK_BODY_COMPILER_H
+#define SPECK_BODY_COMPILER_H
+
+#include <SpeckEngineDefinitions.h>
+
+// Converts speck body structure JSON files to the binary .speckbody format (see SpeckBodyFile.h).
+class SpeckBodyCompiler
+{
+public:
+	// Writes the binary file and checks that it reads back the same as the JSON. Returns false on failure.
+	static bool Compile(const wchar_t *jsonFilePath, const wchar_t *speckBodyFilePath);
+	// Compiles only if the binary file is missing or older than the JSON file.
+	static bool CompileIfOutdated(const wchar_t *jsonFilePath, const wchar_t *speckBodyFilePath);
+};
+
+#endif
@@ -0,0 +1,149 @@
+#include "SpeckBodyFile.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace SpeckBodyFormat;
+
+// Checks that the section lies inside of the file and is properly aligned.
+static bool IsSectionValid(const Section &section, size_t elementSize, uint64_t fileSize)
+{
+	if (section.offset % 4 != 0) return false;
+	return (uint64_t)section.offset + (uint64_t)section.count * elementSize <= fileSize;
+}
+
+SpeckBodyFile::SpeckBodyFile()
+	: mHeader(nullptr)
+{
+
+}
+
+SpeckBodyFile::~SpeckBodyFile()
+{
+	Close();
+}
+
+bool SpeckBodyFile::Open(const wchar_t *filePath)
+{
+	Close();
+	if (!mFile.Open(filePath))
+		return false;
+
+	if (mFile.GetSize() < sizeof(Header))
+	{
+		LOG(TEXT("Speck body file is too small: ") + wstring(filePath), ERROR);
+		Close();
+		return false;
+	}
+
+	mHeader = reinterpret_cast<const Header *>(mFile.GetData());
+	if (!Validate())
+	{
+		LOG(TEXT("Invalid speck body file: ") + wstring(filePath), ERROR);
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void SpeckBodyFile::Close()
+{
+	mHeader = nullptr;
+	mFile.Close();
+}
+
+bool SpeckBodyFile::Validate() const
+{
+	// Header
+	const Header &h = *mHeader;
+	uint64_t fileSize = mFile.GetSize();
+	if (memcmp(h.magic, Magic, sizeof(Magic)) != 0 || h.version != Version || h.fileSize != fileSize)
+		return false;
+
+	// Sections
+	if (!IsSectionValid(h.bones, sizeof(Bone), fileSize) ||
+		!IsSectionValid(h.boneNames, sizeof(BoneName), fileSize) ||
+		!IsSectionValid(h.joints, sizeof(Joint), fileSize) ||
+		!IsSectionValid(h.jointPairs, sizeof(JointPair), fileSize) ||
+		!IsSectionValid(h.specks, sizeof(XMFLOAT3), fileSize) ||
+		!IsSectionValid(h.hashTable, sizeof(uint32_t), fileSize) ||
+		!IsSectionValid(h.strings, sizeof(char), fileSize))
+		return false;
+	if (h.hashTable.count == 0 || (h.hashTable.count & (h.hashTable.count - 1)) != 0 || h.hashTable.count <= h.boneNames.count)
+		return false;
+
+	// Every string has to end with the null character inside of the strings section
+	const char *strings = GetSection<char>(h.strings);
+	auto isStringValid = [&](const String &str)
+	{
+		return (uint64_t)str.offset + str.length < h.strings.count && strings[str.offset + str.length] == '\0';
+	};
+
+	// Indices
+	const Bone *bones = GetSection<Bone>(h.bones);
+	for (UINT i = 0; i < h.bones.count; ++i)
+	{
+		if ((uint64_t)bones[i].firstSpeck + bones[i].speckCount > h.specks.count) return false;
+	}
+	const BoneName *boneNames = GetSection<BoneName>(h.boneNames);
+	for (UINT i = 0; i < h.boneNames.count; ++i)
+	{
+		if (boneNames[i].bone >= h.bones.count || !isStringValid(boneNames[i].name)) return false;
+	}
+	const Joint *joints = GetSection<Joint>(h.joints);
+	for (UINT i = 0; i < h.joints.count; ++i)
+	{
+		if ((uint64_t)joints[i].firstPair + joints[i].pairCount > h.jointPairs.count) return false;
+		if ((uint64_t)joints[i].firstSpeck + joints[i].speckCount > h.specks.count) return false;
+	}
+	const JointPair *jointPairs = GetSection<JointPair>(h.jointPairs);
+	for (UINT i = 0; i < h.jointPairs.count; ++i)
+	{
+		if (!isStringValid(jointPairs[i].parentBoneName) || !isStringValid(jointPairs[i].childBoneName)) return false;
+	}
+	// Every bone name is in the table exactly once, so the table keeps empty slots and the probing in FindBone ends
+	const uint32_t *hashTable = GetSection<uint32_t>(h.hashTable);
+	vector<bool> isNameInTable(h.boneNames.count, false);
+	for (UINT i = 0; i < h.hashTable.count; ++i)
+	{
+		if (hashTable[i] == 0) continue;
+		if (hashTable[i] > h.boneNames.count || isNameInTable[hashTable[i] - 1]) return false;
+		isNameInTable[hashTable[i] - 1] = true;
+	}
+	if (find(isNameInTable.begin(), isNameInTable.end(), false) != isNameInTable.end())
+		return false;
+
+	return true;
+}
+
+int SpeckBodyFile::FindBone(const char *name, size_t length) const
+{
+	if (!mHeader) return -1;
+
+	// Open addressing with linear probing, the table always has empty slots
+	uint32_t hash = Hash(name, length);
+	const uint32_t *hashTable = GetSection<uint32_t>(mHeader->hashTable);
+	const BoneName *boneNames = GetSection<BoneName>(mHeader->boneNames);
+	uint32_t mask = mHeader->hashTable.count - 1;
+	for (uint32_t slot = hash & mask; hashTable[slot] != 0; slot = (slot + 1) & mask)
+	{
+		const BoneName &boneName = boneNames[hashTable[slot] - 1];
+		if (boneName.hash == hash && boneName.name.length == length && memcmp(GetString(boneName.name), name, length) == 0)
+			return (int)boneName.bone;
+	}
+	return -1;
+}
+
+const XMFLOAT3 *SpeckBodyFile::GetBoneSpecks(UINT bone, UINT *outCount) const
+{
+	const Bone &b = GetSection<Bone>(mHeader->bones)[bone];
+	*outCount = b.speckCount;
+	return GetSection<XMFLOAT3>(mHeader->specks) + b.firstSpeck;
+}
+
+const XMFLOAT3 *SpeckBodyFile::GetJointSpecks(UINT joint, UINT *outCount) const
+{
+	const Joint &j = GetJoint(joint);
+	*outCount = j.speckCount;
+	return GetSection<XMFLOAT3>(mHeader->specks) + j.firstSpeck;
+}
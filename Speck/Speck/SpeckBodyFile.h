@@ -0,0 +1,120 @@
+#ifndef SPECK_BODY_FILE_H
+#define SPECK_BODY_FILE_H
+
+#include <SpeckEngineDefinitions.h>
+#include <MemoryMappedFile.h>
+
+// Binary, memory mappable version of the speck body structure (JSON) files.
+// Sections are arrays of 4 byte aligned PODs addressed by offsets from the beginning of the file.
+namespace SpeckBodyFormat
+{
+	const char Magic[4] = { 'S', 'P', 'K', 'B' };
+	const uint32_t Version = 1;
+
+	struct Section
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t fileSize;
+		Section bones;		// Bone
+		Section boneNames;	// BoneName
+		Section joints;		// Joint
+		Section jointPairs;	// JointPair
+		Section specks;		// DirectX::XMFLOAT3
+		Section hashTable;	// uint32_t, bone name index + 1 (zero is an empty slot), size is a power of two
+		Section strings;	// char, every string is followed by a null character
+	};
+
+	struct String
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	// Group of FBX nodes sharing the same specks
+	struct Bone
+	{
+		uint32_t firstSpeck;
+		uint32_t speckCount;
+	};
+
+	struct BoneName
+	{
+		String name;
+		uint32_t hash;
+		uint32_t bone;
+	};
+
+	// Specks connecting the bone pairs
+	struct Joint
+	{
+		uint32_t firstPair;
+		uint32_t pairCount;
+		uint32_t firstSpeck;
+		uint32_t speckCount;
+	};
+
+	struct JointPair
+	{
+		String parentBoneName;
+		String childBoneName;
+	};
+
+	// FNV-1a
+	inline uint32_t Hash(const char *str, size_t length)
+	{
+		uint32_t hash = 2166136261U;
+		for (size_t i = 0; i < length; ++i)
+		{
+			hash ^= (uint8_t)str[i];
+			hash *= 16777619U;
+		}
+		return hash;
+	}
+}
+
+// Read-only access to a memory mapped .speckbody file. Nothing is allocated after the file is opened.
+class SpeckBodyFile
+{
+public:
+	SpeckBodyFile();
+	~SpeckBodyFile();
+
+	// Maps the file and validates all of its offsets and indices.
+	bool Open(const wchar_t *filePath);
+	void Close();
+
+	// Index of the bone that lists the name, -1 if there is none.
+	int FindBone(const char *name, size_t length) const;
+	UINT GetBoneCount() const { return mHeader ? mHeader->bones.count : 0; }
+	const DirectX::XMFLOAT3 *GetBoneSpecks(UINT bone, UINT *outCount) const;
+	UINT GetBoneNameCount() const { return mHeader ? mHeader->boneNames.count : 0; }
+	const SpeckBodyFormat::BoneName &GetBoneName(UINT boneName) const { return GetSection<SpeckBodyFormat::BoneName>(mHeader->boneNames)[boneName]; }
+
+	UINT GetJointCount() const { return mHeader ? mHeader->joints.count : 0; }
+	const SpeckBodyFormat::Joint &GetJoint(UINT joint) const { return GetSection<SpeckBodyFormat::Joint>(mHeader->joints)[joint]; }
+	const SpeckBodyFormat::JointPair &GetJointPair(UINT pair) const { return GetSection<SpeckBodyFormat::JointPair>(mHeader->jointPairs)[pair]; }
+	const DirectX::XMFLOAT3 *GetJointSpecks(UINT joint, UINT *outCount) const;
+
+	// Null terminated
+	const char *GetString(const SpeckBodyFormat::String &str) const { return GetSection<char>(mHeader->strings) + str.offset; }
+
+private:
+	template <class T> const T *GetSection(const SpeckBodyFormat::Section &section) const
+	{
+		return reinterpret_cast<const T *>(mFile.GetData() + section.offset);
+	}
+	bool Validate() const;
+
+private:
+	Speck::MemoryMappedFile mFile;
+	const SpeckBodyFormat::Header *mHeader;
+};
+
+#endif
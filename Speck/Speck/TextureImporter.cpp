@@ -0,0 +1,193 @@
+#include "TextureImporter.h"
+#include <WorkerPool.h>
+#include <MipGenerator.h>
+#include <wrl.h>
+#include <wincodec.h>
+#include <dxgiformat.h>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+using namespace std;
+using namespace Speck;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// DDS file structures, always written with the DX10 header.
+#pragma pack(push, 1)
+	struct DDSPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDSPixelFormat ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDSHeaderDX10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+#pragma pack(pop)
+
+	const uint32_t DDSMagic = 0x20534444; // "DDS "
+	const uint32_t DDSFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixel format, mip count, linear size
+	const uint32_t DDSCaps = 0x1000 | 0x8 | 0x400000; // texture, complex, mipmap
+	const uint32_t DDSFourCC = 0x00000004;
+	const uint32_t DX10FourCC = 0x30315844; // "DX10"
+	const uint32_t DX10Texture2D = 3;
+
+	struct Image
+	{
+		UINT width;
+		UINT height;
+		vector<uint8_t> rgba;
+	};
+
+	// Decodes the first frame of the image to RGBA8 with WIC.
+	bool ReadImage(const wchar_t *imageFilePath, Image *outImage)
+	{
+		ComPtr<IWICImagingFactory> factory;
+		ComPtr<IWICBitmapDecoder> decoder;
+		ComPtr<IWICBitmapFrameDecode> frame;
+		ComPtr<IWICFormatConverter> converter;
+		if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))) ||
+			FAILED(factory->CreateDecoderFromFilename(imageFilePath, nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+			FAILED(decoder->GetFrame(0, &frame)) ||
+			FAILED(factory->CreateFormatConverter(&converter)) ||
+			FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)) ||
+			FAILED(converter->GetSize(&outImage->width, &outImage->height)))
+			return false;
+
+		outImage->rgba.resize((size_t)outImage->width * outImage->height * 4);
+		return SUCCEEDED(converter->CopyPixels(nullptr, outImage->width * 4, (UINT)outImage->rgba.size(), outImage->rgba.data()));
+	}
+
+	DXGI_FORMAT GetDXGIFormat(BlockCompressionFormat format, bool sRGB)
+	{
+		switch (format)
+		{
+		case BlockCompressionFormat::BC1: return sRGB ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		case BlockCompressionFormat::BC3: return sRGB ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+		case BlockCompressionFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+		case BlockCompressionFormat::BC7: return sRGB ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+bool TextureImporter::Import(const wchar_t *imageFilePath, const wchar_t *ddsFilePath, BlockCompressionFormat format, bool sRGB)
+{
+	HRESULT coInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	Image image;
+	bool read = ReadImage(imageFilePath, &image);
+	if (SUCCEEDED(coInit))
+		CoUninitialize();
+	if (!read)
+	{
+		LOG(TEXT("Could not read the image: ") + wstring(imageFilePath), ERROR);
+		return false;
+	}
+	if (image.width % 4 != 0 || image.height % 4 != 0)
+	{
+		LOG(TEXT("Block compressed textures need dimensions that are multiples of 4: ") + wstring(imageFilePath), ERROR);
+		return false;
+	}
+
+	// Mips, BC5 is used for normal maps
+	WorkerPool workerPool;
+	MipGenerator::Settings mipSettings;
+	mipSettings.sRGB = sRGB;
+	mipSettings.normalMap = (format == BlockCompressionFormat::BC5);
+	vector<MipGenerator::Mip> mips;
+	MipGenerator::Generate(image.rgba.data(), image.width, image.height, image.width * 4, mipSettings, &workerPool, &mips);
+	UINT mipCount = (UINT)mips.size();
+
+	// Headers
+
+	DDSHeader header = {};
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSFlags;
+	header.height = image.height;
+	header.width = image.width;
+	header.pitchOrLinearSize = (uint32_t)BlockCompressor::GetCompressedSize(format, image.width, image.height);
+	header.mipMapCount = mipCount;
+	header.ddspf.size = sizeof(DDSPixelFormat);
+	header.ddspf.flags = DDSFourCC;
+	header.ddspf.fourCC = DX10FourCC;
+	header.caps = DDSCaps;
+
+	DDSHeaderDX10 headerDX10 = {};
+	headerDX10.dxgiFormat = GetDXGIFormat(format, sRGB);
+	headerDX10.resourceDimension = DX10Texture2D;
+	headerDX10.arraySize = 1;
+
+	// Compress the mips, from the most detailed one
+	vector<uint8_t> buffer(sizeof(DDSMagic) + sizeof(DDSHeader) + sizeof(DDSHeaderDX10));
+	memcpy(&buffer[0], &DDSMagic, sizeof(DDSMagic));
+	memcpy(&buffer[sizeof(DDSMagic)], &header, sizeof(DDSHeader));
+	memcpy(&buffer[sizeof(DDSMagic) + sizeof(DDSHeader)], &headerDX10, sizeof(DDSHeaderDX10));
+
+	for (const MipGenerator::Mip &mip : mips)
+	{
+		size_t offset = buffer.size();
+		buffer.resize(offset + BlockCompressor::GetCompressedSize(format, mip.width, mip.height));
+		BlockCompressor::Compress(format, mip.rgba.data(), mip.width, mip.height, mip.width * 4, &workerPool, &buffer[offset]);
+	}
+
+	// Save
+	ofstream fileStream(ddsFilePath, ios::out | ios::binary | ios::trunc);
+	if (!fileStream.is_open()) return false;
+	fileStream.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+	fileStream.close();
+	return !fileStream.fail();
+}
+
+bool TextureImporter::ParseFormat(const wchar_t *name, BlockCompressionFormat *outFormat, bool *outSRGB)
+{
+	struct FormatName { const wchar_t *name; BlockCompressionFormat format; bool sRGB; };
+	const FormatName formatNames[] = {
+		{ L"bc1", BlockCompressionFormat::BC1, false },
+		{ L"bc1_srgb", BlockCompressionFormat::BC1, true },
+		{ L"bc3", BlockCompressionFormat::BC3, false },
+		{ L"bc3_srgb", BlockCompressionFormat::BC3, true },
+		{ L"bc5", BlockCompressionFormat::BC5, false },
+		{ L"bc7", BlockCompressionFormat::BC7, false },
+		{ L"bc7_srgb", BlockCompressionFormat::BC7, true },
+	};
+	for (const FormatName &formatName : formatNames)
+	{
+		if (_wcsicmp(name, formatName.name) == 0)
+		{
+			*outFormat = formatName.format;
+			*outSRGB = formatName.sRGB;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,19 @@
+#ifndef TEXTURE_IMPORTER_H
+#define TEXTURE_IMPORTER_H
+
+#include <SpeckEngineDefinitions.h>
+#include <BlockCompressor.h>
+
+// Converts images (PNG or any other format that WIC can read) to mipmapped, block compressed DDS
+// files that the engine loads as they are. The mips are filtered with MipGenerator (in linear
+// space for the sRGB formats, BC5 is treated as a normal map).
+class TextureImporter
+{
+public:
+	// The dimensions of the image have to be multiples of 4. Returns false on failure.
+	static bool Import(const wchar_t *imageFilePath, const wchar_t *ddsFilePath, Speck::BlockCompressionFormat format, bool sRGB);
+	// Format names: bc1, bc3, bc5, bc7, and bc1_srgb, bc3_srgb, bc7_srgb for color textures.
+	static bool ParseFormat(const wchar_t *name, Speck::BlockCompressionFormat *outFormat, bool *outSRGB);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef VERTEX_WELDER_H
+#define VERTEX_WELDER_H
+
+#include <SpeckEngineDefinitions.h>
+#include <AppCommands.h>
+#include <MathHelper.h>
+
+// Hashes of the vertex attributes that are compared when welding.
+// Zero and negative zero compare as equal, so they have to hash the same.
+inline uint32_t HashVertexFloat(uint32_t hash, float value)
+{
+	uint32_t bits;
+	if (value == 0.0f) value = 0.0f;
+	memcpy(&bits, &value, sizeof(bits));
+	// FNV-1a over the four bytes
+	for (int i = 0; i < 4; ++i)
+	{
+		hash ^= (bits >> (i * 8)) & 0xFF;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+inline uint32_t HashVertexFloats(uint32_t hash, const float *values, int count)
+{
+	for (int i = 0; i < count; ++i) hash = HashVertexFloat(hash, values[i]);
+	return hash;
+}
+
+inline uint32_t HashVertex(const Speck::AppCommands::StaticMeshVertex &v)
+{
+	uint32_t hash = 2166136261u;
+	hash = HashVertexFloats(hash, &v.Position.x, 3);
+	hash = HashVertexFloats(hash, &v.Normal.x, 3);
+	hash = HashVertexFloats(hash, &v.TangentU.x, 3);
+	return HashVertexFloats(hash, &v.TexC.x, 2);
+}
+
+inline bool AreVerticesEqual(const Speck::AppCommands::StaticMeshVertex &left, const Speck::AppCommands::StaticMeshVertex &right)
+{
+	using Speck::operator==;
+	return left.Position == right.Position &&
+		left.Normal == right.Normal &&
+		left.TangentU == right.TangentU &&
+		left.TexC == right.TexC;
+}
+
+// Merges equal vertices while a vertex buffer is being built. Vertices keep the order in which they were first added.
+// Uses a hash table with open addressing, so adding a vertex takes constant time on average.
+template <typename Vertex>
+class VertexWelder
+{
+public:
+	// The welder appends to the given vertex list, which must not be changed from the outside while welding.
+	VertexWelder(std::vector<Vertex> *vertices, size_t expectedVertexCount = 0)
+		: mVertices(vertices)
+	{
+		mVertices->reserve(expectedVertexCount);
+		Rehash(max(expectedVertexCount, (size_t)16));
+	}
+
+	// Returns the index of the equal vertex, the vertex is appended if there is none.
+	uint32_t Add(const Vertex &vertex, bool *outAdded = nullptr)
+	{
+		uint32_t hash = HashVertex(vertex);
+		uint32_t mask = (uint32_t)mTable.size() - 1;
+		uint32_t slot = hash & mask;
+		for (; mTable[slot] != 0; slot = (slot + 1) & mask)
+		{
+			uint32_t index = mTable[slot] - 1;
+			if (mHashes[index] == hash && AreVerticesEqual((*mVertices)[index], vertex))
+			{
+				if (outAdded) *outAdded = false;
+				return index;
+			}
+		}
+
+		uint32_t index = (uint32_t)mVertices->size();
+		mVertices->push_back(vertex);
+		mHashes.push_back(hash);
+		mTable[slot] = index + 1;
+		// keep the table at most half full
+		if (mHashes.size() * 2 > mTable.size()) Rehash(mHashes.size() * 2);
+		if (outAdded) *outAdded = true;
+		return index;
+	}
+
+private:
+	void Rehash(size_t vertexCount)
+	{
+		size_t size = 1;
+		while (size < vertexCount * 2) size *= 2;
+		mTable.assign(size, 0);
+		uint32_t mask = (uint32_t)size - 1;
+		for (uint32_t i = 0; i < (uint32_t)mHashes.size(); ++i)
+		{
+			uint32_t slot = mHashes[i] & mask;
+			while (mTable[slot] != 0) slot = (slot + 1) & mask;
+			mTable[slot] = i + 1;
+		}
+	}
+
+private:
+	std::vector<Vertex> *mVertices;
+	// Hash of every welded vertex
+	std::vector<uint32_t> mHashes;
+	// Vertex index plus one, zero for empty slots
+	std::vector<uint32_t> mTable;
+};
+
+#endif
@@ -12,6 +12,11 @@
 #include "MaterialShaderStructure.h"
 #include "Timer.h"
 #include "Camera.h"
+#include "TextMeshLoader.h"
+#include "TextureStreamer.h"
+#include "ResourceLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -19,6 +24,104 @@ using namespace DirectX;
 using namespace Speck;
 using namespace Speck::AppCommands;
 
+// Creates the index buffer, with 16 bit indices if the vertex count allows it. The command list has to be open.
+template<class MeshData>
+static void CreateIndexBuffer(DirectXCore &dxCore, MeshData &mesh, MeshGeometry *geo)
+{
+	const void *indexData;
+	UINT indexByteSize;
+	if (MeshOptimizer::NeedsIndices32(mesh.Vertices.size()))
+	{
+		indexData = mesh.Indices32.data();
+		indexByteSize = sizeof(uint32_t);
+		geo->IndexFormat = DXGI_FORMAT_R32_UINT;
+	}
+	else
+	{
+		indexData = mesh.GetIndices16().data();
+		indexByteSize = sizeof(uint16_t);
+		geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
+	const UINT ibByteSize = (UINT)mesh.Indices32.size() * indexByteSize;
+
+	THROW_IF_FAILED(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indexData, ibByteSize);
+
+	geo->IndexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
+		dxCore.GetCommandList(), indexData, ibByteSize, geo->IndexBufferUploader, MemoryTag::Geometry);
+
+	geo->IndexBufferByteSize = ibByteSize;
+	geo->TrackCPUMemory();
+}
+
+// Fills the result of the geometry commands, if it was asked for.
+static void SetGeometryCommandResult(const MeshOptimizationStats &stats, CommandResult *result)
+{
+	CreateGeometryCommandResult *resPt = dynamic_cast<CreateGeometryCommandResult *>(result);
+	if (!resPt)
+		return;
+
+	resPt->acmrBefore = stats.acmrBefore;
+	resPt->atvrBefore = stats.atvrBefore;
+	resPt->acmrAfter = stats.acmrAfter;
+	resPt->atvrAfter = stats.atvrAfter;
+}
+
+// The indices of the LODs follow the ones of the full mesh in the index buffer.
+template<class MeshData>
+static void AppendLODs(MeshData &mesh, const vector<MeshLOD> &lods, SubmeshGeometry *submesh)
+{
+	if (lods.empty())
+		return;
+
+	SubmeshLOD fullLOD;
+	fullLOD.IndexCount = submesh->IndexCount;
+	fullLOD.StartIndexLocation = submesh->StartIndexLocation;
+	submesh->LODs.push_back(fullLOD);
+	for (const MeshLOD &lod : lods)
+	{
+		SubmeshLOD submeshLOD;
+		submeshLOD.IndexCount = (UINT)lod.indices.size();
+		submeshLOD.StartIndexLocation = (UINT)mesh.Indices32.size();
+		submeshLOD.Error = lod.error;
+		submesh->LODs.push_back(submeshLOD);
+		mesh.Indices32.insert(mesh.Indices32.end(), lod.indices.begin(), lod.indices.end());
+	}
+}
+
+// Creates the vertex and index buffers of a static mesh with a single submesh, the command list has to be open.
+static unique_ptr<MeshGeometry> CreateStaticMeshGeometry(DirectXCore &dxCore, GeometryGenerator::StaticMeshData &mesh, const string &meshName, const BoundingBox &bounds,
+	const vector<MeshLOD> &lods = vector<MeshLOD>())
+{
+	// Define the SubmeshGeometry that cover different 
+	// regions of the vertex/index buffers.
+	SubmeshGeometry submesh;
+	submesh.IndexCount = (UINT)mesh.Indices32.size();
+	submesh.StartIndexLocation = 0;
+	submesh.BaseVertexLocation = 0;
+	submesh.Bounds = bounds;
+	MeshletBuilder::Build(&mesh, mesh.Indices32.size(), &submesh.Meshlets);
+	AppendLODs(mesh, lods, &submesh);
+
+	const UINT vbByteSize = (UINT)mesh.Vertices.size() * sizeof(GeometryGenerator::StaticVertex);
+
+	auto geo = make_unique<MeshGeometry>();
+
+	THROW_IF_FAILED(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), mesh.Vertices.data(), vbByteSize);
+
+	geo->VertexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
+		dxCore.GetCommandList(), mesh.Vertices.data(), vbByteSize, geo->VertexBufferUploader, MemoryTag::Geometry);
+
+	geo->VertexByteStride = sizeof(GeometryGenerator::StaticVertex);
+	geo->VertexBufferByteSize = vbByteSize;
+	CreateIndexBuffer(dxCore, mesh, geo.get());
+
+	geo->DrawArgs[meshName] = submesh;
+	return geo;
+}
+
 int LimitFrameTimeCommand::Execute(void * ptIn, CommandResult * result) const
 {
 	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
@@ -29,6 +132,22 @@ int LimitFrameTimeCommand::Execute(void * ptIn, CommandResult * result) const
 	return 0;
 }
 
+int GetFramePacingStatsCommand::Execute(void * ptIn, CommandResult * result) const
+{
+	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
+	auto &ec = sApp->GetEngineCore();
+	FramePacer &pacer = ec.GetTimer()->GetFramePacer();
+	if (result)
+	{
+		GetFramePacingStatsCommandResult *statsResult = static_cast<GetFramePacingStatsCommandResult *>(result);
+		pacer.GetStats(&statsResult->stats);
+	}
+	if (clear)
+		pacer.ClearStats();
+
+	return 0;
+}
+
 int UpdateCameraCommand::Execute(void * ptIn, CommandResult * result) const
 {
 	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
@@ -46,53 +165,108 @@ int SetWindowTitleCommand::Execute(void *ptIn, CommandResult *result) const
 	return 0;
 }
 
-int LoadResourceCommand::Execute(void *ptIn, CommandResult *result) const
+namespace Speck
 {
-	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
-	auto &dxCore = sApp->GetEngineCore().GetDirectXCore();
-	// DirectX CommandList is needed to execute this command.
-	// Reset the command list to prep for initialization commands.
-	THROW_IF_FAILED(dxCore.GetCommandList()->Reset(dxCore.GetCommandAllocator(), nullptr));
-
-	int retVal = 1;
-	switch (resType)
+	// Records the uploads of the whole batch to the app's command list and waits for the GPU once.
+	class SpeckResourceUploader : public ResourceUploader
 	{
-		case ResourceType::Texture:
+	public:
+		SpeckResourceUploader(SpeckApp *sApp) : mApp(sApp), mDXCore(sApp->GetEngineCore().GetDirectXCore()) { }
+
+		virtual void Begin() override
 		{
-			auto tex = make_unique<Texture>();
-			tex->Name = name;
-			THROW_IF_FAILED(CreateDDSTextureFromFile12(dxCore.GetDevice(), dxCore.GetCommandList(), path.c_str(), tex->Resource, tex->UploadHeap));
-			sApp->mTextures[tex->Name] = move(tex);
-			retVal = 0;
+			// Reset the command list to prep for initialization commands.
+			THROW_IF_FAILED(mDXCore.GetCommandList()->Reset(mDXCore.GetCommandAllocator(), nullptr));
 		}
-		break;
-		case ResourceType::Shader:
+
+		virtual void Upload(LoadedResource &resource) override
 		{
-			sApp->mShaders[name] = LoadBinary(path);
-			retVal = 0;
+			switch (resource.resType)
+			{
+				case ResourceType::Texture:
+					UploadTexture(resource);
+					break;
+				case ResourceType::Shader:
+					mApp->mShaders[resource.name] = resource.shader;
+					break;
+				case ResourceType::Geometry:
+					// The geometry and its only submesh are both named after the resource
+					mApp->mGeometries[resource.name] = CreateStaticMeshGeometry(mDXCore, resource.mesh, resource.name, resource.bounds, resource.lods);
+					break;
+			}
 		}
-		break;
-		case ResourceType::Geometry:
+
+		virtual void End() override
 		{
-			retVal = 0; // not implemented
+			// Execute the initialization commands.
+			THROW_IF_FAILED(mDXCore.GetCommandList()->Close());
+			ID3D12CommandList* cmdsListsInitialization[] = { mDXCore.GetCommandList() };
+			mDXCore.GetCommandQueue()->ExecuteCommandLists(_countof(cmdsListsInitialization), cmdsListsInitialization);
+
+			// Wait until initialization is complete.
+			mDXCore.FlushCommandQueue();
 		}
-		break;
-		default:
+
+	private:
+		void UploadTexture(LoadedResource &resource)
 		{
-			LOG(L"No type specified while loading resource.", ERROR);
-			retVal = 1; // not good
+			// Reloaded textures keep their object, the materials point to it
+			unique_ptr<Texture> &tex = mApp->mTextures[resource.name];
+			if (tex)
+			{
+				mApp->mTextureStreamer->Cancel(tex.get());
+			}
+			else
+			{
+				tex = make_unique<Texture>();
+				tex->Name = resource.name;
+			}
+
+			// Only the smallest mips are uploaded now if asked, the file stays mapped for the texture streamer
+			const DDSTextureLayout &layout = resource.textureLayout;
+			size_t firstMip = layout.GetFirstResidentMip(resource.residentMipCount);
+			THROW_IF_FAILED(CreateDDSTextureFromLayout12(mDXCore.GetDevice(), mDXCore.GetCommandList(), layout, firstMip, tex->Resource, tex->UploadHeap));
+			tex->ResidentMip = (UINT)firstMip;
+			MemoryTracker::TrackResource(tex->Resource.Get(), MemoryTag::Textures, false);
+			MemoryTracker::TrackResource(tex->UploadHeap.Get(), MemoryTag::Textures);
+			tex->ResidentMemory.Set(0, layout.GetResidentSize(firstMip));
+			if (firstMip > 0)
+				mApp->mTextureStreamer->Enqueue(tex.get(), move(resource.file), move(resource.textureLayout));
 		}
-		break;
+
+	private:
+		SpeckApp *mApp;
+		DirectXCore &mDXCore;
+	};
+}
+
+// Loads the batch through the app's uploader.
+static int LoadResources(SpeckApp *sApp, const LoadResourceCommand *commands, size_t count)
+{
+	vector<LoadedResource> resources(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		resources[i].name = commands[i].name;
+		resources[i].path = commands[i].path;
+		resources[i].resType = commands[i].resType;
+		resources[i].residentMipCount = commands[i].residentMipCount;
 	}
 
-	// Execute the initialization commands.
-	THROW_IF_FAILED(dxCore.GetCommandList()->Close());
-	ID3D12CommandList* cmdsListsInitialization[] = { dxCore.GetCommandList() };
-	dxCore.GetCommandQueue()->ExecuteCommandLists(_countof(cmdsListsInitialization), cmdsListsInitialization);
+	SpeckResourceUploader uploader(sApp);
+	UINT failedCount = ResourceLoader::Load(resources, sApp->GetEngineCore().GetWorkerPool(), &uploader);
+	return (failedCount == 0) ? 0 : 1;
+}
 
-	// Wait until initialization is complete.
-	dxCore.FlushCommandQueue();
-	return retVal;
+int LoadResourceCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
+	return LoadResources(sApp, this, 1);
+}
+
+int LoadResourcesCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
+	return LoadResources(sApp, resources.data(), resources.size());
 }
 
 int CreateMaterialCommand::Execute(void *ptIn, CommandResult *result) const
@@ -118,7 +292,8 @@ int CreateMaterialCommand::Execute(void *ptIn, CommandResult *result) const
 		}
 		else if (sApp->mTextures.find(tNames[i]) != sApp->mTextures.end())
 		{// Use the specified
-			t[i] = sApp->mTextures[tNames[i]]->Resource.Get();
+			texMatPt->Textures[i] = sApp->mTextures[tNames[i]].get();
+			t[i] = texMatPt->Textures[i]->Resource.Get();
 		}
 		else
 		{// Error, specified not found, use default.
@@ -192,40 +367,15 @@ int CreateStaticGeometryCommand::Execute(void * ptIn, CommandResult * result) co
 		mesh.Vertices[i].TexC = vertices[i].TexC;
 	}
 
-	// Define the SubmeshGeometry that cover different 
-	// regions of the vertex/index buffers.
-	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
-	submesh.BaseVertexLocation = 0;
-	submesh.Bounds = mesh.CalculateBounds();
-
-	vector<uint16_t> indices16 = mesh.GetIndices16();
+	vector<MeshLOD> lods;
+	MeshSimplifier::BuildLODChain(mesh, lodCount, &lods);
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(GeometryGenerator::StaticVertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(uint16_t);
+	MeshOptimizationStats stats;
+	if (optimize)
+		MeshOptimizer::Optimize(&mesh, &stats, &lods);
+	SetGeometryCommandResult(stats, result);
 
-	auto geo = make_unique<MeshGeometry>();
-
-	THROW_IF_FAILED(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	THROW_IF_FAILED(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices16.data(), ibByteSize);
-
-	geo->VertexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), indices16.data(), ibByteSize, geo->IndexBufferUploader);
-
-	geo->VertexByteStride = sizeof(GeometryGenerator::StaticVertex);
-	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
-
-	geo->DrawArgs[meshName] = submesh;
-	sApp->mGeometries[geometryName] = move(geo);
+	sApp->mGeometries[geometryName] = CreateStaticMeshGeometry(dxCore, mesh, meshName, mesh.CalculateBounds(), lods);
 
 	// Execute the initialization commands.
 	THROW_IF_FAILED(dxCore.GetCommandList()->Close());
@@ -258,47 +408,33 @@ int AppCommands::CreateSkinnedGeometryCommand::Execute(void * ptIn, CommandResul
 		memcpy(&mesh.Vertices[i].BoneIndices, &vertices[i].BoneIndices, sizeof(mesh.Vertices[i].BoneIndices));
 	}
 
+	vector<MeshLOD> meshLODs = lods;
+	MeshOptimizationStats stats;
+	if (optimize)
+		MeshOptimizer::Optimize(&mesh, &stats, &meshLODs);
+	SetGeometryCommandResult(stats, result);
+
 	// Define the SubmeshGeometry that cover different 
 	// regions of the vertex/index buffers.
 	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
+	submesh.IndexCount = (UINT)mesh.Indices32.size();
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
+	AppendLODs(mesh, meshLODs, &submesh);
 
-	// Extract the vertex elements we are interested in and pack the
-	// vertices of all the meshes into one vertex buffer.
-	auto totalVertexCount = mesh.Vertices.size();
-
-	vector<GeometryGenerator::SkinnedVertex> vertices(totalVertexCount);
-	UINT k = 0;
-	for (size_t i = 0; i < mesh.Vertices.size(); ++i, ++k)
-	{
-		vertices[k] = mesh.Vertices[i];
-	}
-
-	vector<uint16_t> indices16 = mesh.GetIndices16();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(GeometryGenerator::SkinnedVertex);
-	const UINT ibByteSize = (UINT)indices16.size() * sizeof(uint16_t);
+	const UINT vbByteSize = (UINT)mesh.Vertices.size() * sizeof(GeometryGenerator::SkinnedVertex);
 
 	auto geo = make_unique<MeshGeometry>();
 
 	THROW_IF_FAILED(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	THROW_IF_FAILED(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices16.data(), ibByteSize);
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), mesh.Vertices.data(), vbByteSize);
 
 	geo->VertexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), indices16.data(), ibByteSize, geo->IndexBufferUploader);
+		dxCore.GetCommandList(), mesh.Vertices.data(), vbByteSize, geo->VertexBufferUploader, MemoryTag::Geometry);
 
 	geo->VertexByteStride = sizeof(GeometryGenerator::SkinnedVertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
+	CreateIndexBuffer(dxCore, mesh, geo.get());
 
 	geo->DrawArgs[meshName] = submesh;
 	sApp->mGeometries[geometryName] = move(geo);
@@ -312,3 +448,74 @@ int AppCommands::CreateSkinnedGeometryCommand::Execute(void * ptIn, CommandResul
 	dxCore.FlushCommandQueue();
 	return 0;
 }
+
+int ExportProfileCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	if (!Profiler::ExportChromeTrace(path))
+	{
+		LOG(TEXT("Could not write the profile: ") + path, ERROR);
+		return 1;
+	}
+	return 0;
+}
+
+int GetProfileSummaryCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	if (result)
+	{
+		GetProfileSummaryCommandResult *summaryResult = static_cast<GetProfileSummaryCommandResult *>(result);
+		Profiler::GetSummary(&summaryResult->zones);
+	}
+	if (clear)
+		Profiler::Clear();
+	return 0;
+}
+
+int ExportMetricsCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
+	MetricsSampler *sampler = sApp->GetEngineCore().GetMetricsSampler();
+	bool written = (format == Format::JSON) ? sampler->ExportJSON(WStrToStr(path)) : sampler->ExportCSV(WStrToStr(path));
+	if (!written)
+	{
+		LOG(TEXT("Could not write the metrics: ") + path, ERROR);
+		return 1;
+	}
+	return 0;
+}
+
+int GetMetricsSummaryCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
+	MetricsSampler *sampler = sApp->GetEngineCore().GetMetricsSampler();
+	if (result)
+	{
+		GetMetricsSummaryCommandResult *summaryResult = static_cast<GetMetricsSummaryCommandResult *>(result);
+		sampler->GetSummary(&summaryResult->metrics);
+	}
+	if (clear)
+		sampler->Clear();
+	return 0;
+}
+
+int DumpMemoryCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	if (!MemoryTracker::Dump(WStrToStr(path)))
+	{
+		LOG(TEXT("Could not write the memory dump: ") + path, ERROR);
+		return 1;
+	}
+	return 0;
+}
+
+int GetMemoryStatsCommand::Execute(void *ptIn, CommandResult *result) const
+{
+	if (result)
+	{
+		GetMemoryStatsCommandResult *statsResult = static_cast<GetMemoryStatsCommandResult *>(result);
+		MemoryTracker::GetStats(&statsResult->tags);
+	}
+	if (resetHighWater)
+		MemoryTracker::ResetHighWater();
+	return 0;
+}
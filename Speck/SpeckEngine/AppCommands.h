@@ -10,6 +10,11 @@
 #include "SpeckEngineDefinitions.h"
 #include "Camera.h"
 #include "CameraController.h"
+#include "MeshSimplifier.h"
+#include "Profiler.h"
+#include "MetricsSampler.h"
+#include "FramePacer.h"
+#include "MemoryTracker.h"
 
 namespace Speck
 {
@@ -25,6 +30,20 @@ namespace Speck
 			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
 		};
 
+		struct GetFramePacingStatsCommandResult : CommandResult
+		{
+			FramePacingStats stats;
+		};
+
+		// How precisely the frames limited by LimitFrameTimeCommand were paced.
+		struct GetFramePacingStatsCommand : AppCommand
+		{
+			// Starts the stats over after they were returned.
+			bool clear = false;
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
 		struct UpdateCameraCommand : AppCommand
 		{
 			CameraController *ccPt;
@@ -42,11 +61,26 @@ namespace Speck
 
 		enum struct ResourceType { Texture, Shader, Geometry };
 
+		// Geometry is loaded from the text mesh format (see TextMeshLoader.h) as a geometry with a
+		// single submesh, both named after the resource.
 		struct LoadResourceCommand : AppCommand
 		{
 			std::string name = "";
 			std::wstring path = L"";
 			ResourceType resType;
+			// Textures only: number of the smallest mips loaded right away, the rest is streamed
+			// in over the next frames. Zero loads all of the mips.
+			UINT residentMipCount = 0;
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
+		// Loads the resources in parallel on the worker pool and uploads all of them with a
+		// single command list and a single wait for the GPU. Preferred over a sequence of
+		// LoadResourceCommands, each of which waits for the GPU on its own.
+		struct LoadResourcesCommand : AppCommand
+		{
+			std::vector<LoadResourceCommand> resources;
 		protected:
 			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
 		};
@@ -80,12 +114,26 @@ namespace Speck
 			DirectX::XMFLOAT2 TexC;
 		};
 
+		// Optional result of the geometry commands, cache efficiency of the mesh before and after the optimization
+		// (average cache miss ratio per triangle and average transformed vertex ratio).
+		struct CreateGeometryCommandResult : CommandResult
+		{
+			float acmrBefore;
+			float atvrBefore;
+			float acmrAfter;
+			float atvrAfter;
+		};
+
 		struct CreateStaticGeometryCommand : AppCommand
 		{
 			std::string geometryName = "";
 			std::string meshName = "";
 			std::vector<StaticMeshVertex> vertices;
 			std::vector<std::uint32_t> indices;
+			// Reorder the triangles and the vertices for the vertex cache, overdraw and vertex fetch.
+			bool optimize = true;
+			// Number of levels of detail, including the full mesh. The simplified ones are generated.
+			UINT lodCount = 4;
 
 		protected:
 			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
@@ -106,7 +154,81 @@ namespace Speck
 			std::string meshName = "";
 			std::vector<SkinnedMeshVertex> vertices;
 			std::vector<std::uint32_t> indices;
+			// Reorder the triangles and the vertices for the vertex cache and vertex fetch.
+			bool optimize = true;
+			// Simplified versions of the mesh (see MeshSimplifier). The vertices are in the spaces of
+			// the bones, so they are built by the caller from the bind pose.
+			std::vector<MeshLOD> lods;
+
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
 
+		// Writes the zones kept by the profiler as a trace for chrome://tracing or Perfetto.
+		struct ExportProfileCommand : AppCommand
+		{
+			std::wstring path = L"";
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
+		struct GetProfileSummaryCommandResult : CommandResult
+		{
+			std::vector<ProfileZoneSummary> zones;
+		};
+
+		// Percentiles of the durations of each zone kept by the profiler.
+		struct GetProfileSummaryCommand : AppCommand
+		{
+			// Drops the summarized events, so the next summary covers only the new ones.
+			bool clear = false;
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
+		// Writes the process metrics kept by the sampler, one row or value per frame.
+		struct ExportMetricsCommand : AppCommand
+		{
+			enum Format { CSV, JSON };
+
+			std::wstring path = L"";
+			Format format = Format::CSV;
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
+		struct GetMetricsSummaryCommandResult : CommandResult
+		{
+			std::vector<MetricSummary> metrics;
+		};
+
+		// Percentiles of the process metrics kept by the sampler.
+		struct GetMetricsSummaryCommand : AppCommand
+		{
+			// Drops the summarized samples, so the next summary covers only the new ones.
+			bool clear = false;
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
+		// Writes the memory of each subsystem as a table.
+		struct DumpMemoryCommand : AppCommand
+		{
+			std::wstring path = L"";
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
+		struct GetMemoryStatsCommandResult : CommandResult
+		{
+			std::vector<MemoryTagStats> tags;
+		};
+
+		// Reserved and used memory of each subsystem, with the high-water marks.
+		struct GetMemoryStatsCommand : AppCommand
+		{
+			// Starts the high-water marks over from the current values after they were returned.
+			bool resetHighWater = false;
 		protected:
 			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
 		};
@@ -0,0 +1,675 @@
+#include "BlockCompressor.h"
+#include "WorkerPool.h"
+#include <emmintrin.h>
+#include <cfloat>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	// Pixels of a block as floats, one channel after another so that four pixels fit into an SSE register.
+	struct Block
+	{
+		alignas(16) float c[4][16];
+	};
+
+	// Palette entries in the same channel order.
+	typedef float Palette[16][4];
+
+	// BC7 4-bit index weights (out of 64).
+	const int BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	void LoadBlock(const uint8_t *pixels, Block *block)
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int ch = 0; ch < 4; ++ch)
+				block->c[ch][i] = (float)pixels[i * 4 + ch];
+		}
+	}
+
+	float Clamp255(float v)
+	{
+		return (v < 0.0f) ? 0.0f : ((v > 255.0f) ? 255.0f : v);
+	}
+
+	// Finds the closest palette entry for every pixel over the channels [channelBegin, channelEnd).
+	// Four pixels are compared at a time. Returns the total squared error.
+	float FitIndices(const Block &block, int channelBegin, int channelEnd, const Palette &palette, int paletteSize, uint8_t *indices)
+	{
+		__m128 total = _mm_setzero_ps();
+		for (int group = 0; group < 4; ++group)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				__m128 dist = _mm_setzero_ps();
+				for (int ch = channelBegin; ch < channelEnd; ++ch)
+				{
+					__m128 d = _mm_sub_ps(_mm_load_ps(&block.c[ch][group * 4]), _mm_set1_ps(palette[p][ch]));
+					dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+				}
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(dist, best));
+				best = _mm_min_ps(dist, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+			}
+			total = _mm_add_ps(total, best);
+
+			alignas(16) int32_t groupIndices[4];
+			_mm_store_si128(reinterpret_cast<__m128i *>(groupIndices), bestIndex);
+			for (int i = 0; i < 4; ++i)
+				indices[group * 4 + i] = (uint8_t)groupIndices[i];
+		}
+
+		alignas(16) float totals[4];
+		_mm_store_ps(totals, total);
+		return totals[0] + totals[1] + totals[2] + totals[3];
+	}
+
+	// Endpoints at the extremes of the projections of the pixels on their principal axis
+	// (power iteration on the covariance matrix).
+	void PrincipalAxisEndpoints(const Block &block, int channelCount, float *e0, float *e1)
+	{
+		float mean[4] = {};
+		for (int ch = 0; ch < channelCount; ++ch)
+		{
+			for (int i = 0; i < 16; ++i)
+				mean[ch] += block.c[ch][i];
+			mean[ch] /= 16.0f;
+		}
+
+		float cov[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int a = 0; a < channelCount; ++a)
+			{
+				for (int b = a; b < channelCount; ++b)
+					cov[a][b] += (block.c[a][i] - mean[a]) * (block.c[b][i] - mean[b]);
+			}
+		}
+		for (int a = 0; a < channelCount; ++a)
+		{
+			for (int b = 0; b < a; ++b)
+				cov[a][b] = cov[b][a];
+		}
+
+		float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int iter = 0; iter < 8; ++iter)
+		{
+			float next[4] = {};
+			float lenSq = 0.0f;
+			for (int a = 0; a < channelCount; ++a)
+			{
+				for (int b = 0; b < channelCount; ++b)
+					next[a] += cov[a][b] * axis[b];
+				lenSq += next[a] * next[a];
+			}
+			if (lenSq < 1e-12f)
+				break; // flat block, any axis will do
+			float invLen = 1.0f / sqrtf(lenSq);
+			for (int a = 0; a < channelCount; ++a)
+				axis[a] = next[a] * invLen;
+		}
+
+		float tMin = FLT_MAX, tMax = -FLT_MAX;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int ch = 0; ch < channelCount; ++ch)
+				t += (block.c[ch][i] - mean[ch]) * axis[ch];
+			tMin = min(tMin, t);
+			tMax = max(tMax, t);
+		}
+
+		for (int ch = 0; ch < channelCount; ++ch)
+		{
+			e0[ch] = Clamp255(mean[ch] + tMax * axis[ch]);
+			e1[ch] = Clamp255(mean[ch] + tMin * axis[ch]);
+		}
+	}
+
+	// Least squares endpoints for the given interpolation weights of the pixels. Returns false if
+	// the system is singular (all the pixels use the same weight).
+	bool RefineEndpoints(const Block &block, int channelBegin, int channelEnd, const float *weights, float *e0, float *e1)
+	{
+		float a = 0.0f, b = 0.0f, c = 0.0f;
+		float rhs0[4] = {}, rhs1[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float w = weights[i];
+			float iw = 1.0f - w;
+			a += iw * iw;
+			b += iw * w;
+			c += w * w;
+			for (int ch = channelBegin; ch < channelEnd; ++ch)
+			{
+				rhs0[ch] += iw * block.c[ch][i];
+				rhs1[ch] += w * block.c[ch][i];
+			}
+		}
+
+		float det = a * c - b * b;
+		if (fabsf(det) < 1e-6f)
+			return false;
+
+		float invDet = 1.0f / det;
+		for (int ch = channelBegin; ch < channelEnd; ++ch)
+		{
+			e0[ch] = Clamp255((c * rhs0[ch] - b * rhs1[ch]) * invDet);
+			e1[ch] = Clamp255((a * rhs1[ch] - b * rhs0[ch]) * invDet);
+		}
+		return true;
+	}
+
+	void WriteUint16(uint8_t *out, uint16_t value)
+	{
+		out[0] = (uint8_t)(value & 0xFF);
+		out[1] = (uint8_t)(value >> 8);
+	}
+
+	uint16_t ReadUint16(const uint8_t *in)
+	{
+		return (uint16_t)(in[0] | (in[1] << 8));
+	}
+
+	//
+	// BC1 (also the color part of BC3)
+	//
+
+	uint16_t To565(const float *color)
+	{
+		int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+		int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+		int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	void From565(uint16_t value, int *color)
+	{
+		int r = (value >> 11) & 31;
+		int g = (value >> 5) & 63;
+		int b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// Four color palette (the order in which the endpoints are stored decides the mode in BC1,
+	// so the palette of the pair with c0 > c1 is always used).
+	void BuildBC1Palette(uint16_t c0, uint16_t c1, Palette &palette)
+	{
+		int a[3], b[3];
+		From565(c0, a);
+		From565(c1, b);
+		for (int ch = 0; ch < 3; ++ch)
+		{
+			palette[0][ch] = (float)a[ch];
+			palette[1][ch] = (float)b[ch];
+			palette[2][ch] = (float)((2 * a[ch] + b[ch]) / 3);
+			palette[3][ch] = (float)((a[ch] + 2 * b[ch]) / 3);
+		}
+	}
+
+	void CompressBC1(const Block &block, uint8_t *out)
+	{
+		const float indexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+		float e0[4], e1[4];
+		PrincipalAxisEndpoints(block, 3, e0, e1);
+
+		uint16_t bestC0 = 0, bestC1 = 0;
+		uint8_t bestIndices[16] = {};
+		float bestError = FLT_MAX;
+		for (int iter = 0; iter < 3; ++iter)
+		{
+			uint16_t c0 = To565(e0);
+			uint16_t c1 = To565(e1);
+			Palette palette;
+			BuildBC1Palette(c0, c1, palette);
+			uint8_t indices[16];
+			float error = FitIndices(block, 0, 3, palette, 4, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestC0 = c0;
+				bestC1 = c1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f)
+				break;
+
+			// Next try with the endpoints that fit the chosen indices best
+			float weights[16];
+			for (int i = 0; i < 16; ++i)
+				weights[i] = indexWeights[indices[i]];
+			if (!RefineEndpoints(block, 0, 3, weights, e0, e1))
+				break;
+		}
+
+		// The four color mode needs c0 > c1
+		if (bestC0 < bestC1)
+		{
+			swap(bestC0, bestC1);
+			for (int i = 0; i < 16; ++i)
+				bestIndices[i] ^= 1; // 0 <-> 1 and 2 <-> 3
+		}
+		else if (bestC0 == bestC1)
+		{
+			memset(bestIndices, 0, sizeof(bestIndices));
+		}
+
+		WriteUint16(out + 0, bestC0);
+		WriteUint16(out + 2, bestC1);
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= (uint32_t)bestIndices[i] << (i * 2);
+		for (int i = 0; i < 4; ++i)
+			out[4 + i] = (uint8_t)(bits >> (i * 8));
+	}
+
+	void DecompressBC1(const uint8_t *in, bool alwaysFourColors, uint8_t *outPixels)
+	{
+		uint16_t c0 = ReadUint16(in);
+		uint16_t c1 = ReadUint16(in + 2);
+		int a[3], b[3];
+		From565(c0, a);
+		From565(c1, b);
+
+		int palette[4][4];
+		for (int ch = 0; ch < 3; ++ch)
+		{
+			palette[0][ch] = a[ch];
+			palette[1][ch] = b[ch];
+			if (alwaysFourColors || c0 > c1)
+			{
+				palette[2][ch] = (2 * a[ch] + b[ch]) / 3;
+				palette[3][ch] = (a[ch] + 2 * b[ch]) / 3;
+			}
+			else
+			{
+				palette[2][ch] = (a[ch] + b[ch]) / 2;
+				palette[3][ch] = 0;
+			}
+		}
+		for (int p = 0; p < 4; ++p)
+			palette[p][3] = 255;
+		if (!alwaysFourColors && c0 <= c1)
+			palette[3][3] = 0;
+
+		uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = (bits >> (i * 2)) & 3;
+			for (int ch = 0; ch < 4; ++ch)
+				outPixels[i * 4 + ch] = (uint8_t)palette[index][ch];
+		}
+	}
+
+	//
+	// BC4 (the alpha part of BC3 and both channels of BC5)
+	//
+
+	void BuildBC4Palette(int a0, int a1, Palette &palette, int channel)
+	{
+		palette[0][channel] = (float)a0;
+		palette[1][channel] = (float)a1;
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; ++i)
+				palette[i][channel] = (float)(((8 - i) * a0 + (i - 1) * a1 + 3) / 7);
+		}
+		else
+		{
+			for (int i = 2; i < 6; ++i)
+				palette[i][channel] = (float)(((6 - i) * a0 + (i - 1) * a1 + 2) / 5);
+			palette[6][channel] = 0.0f;
+			palette[7][channel] = 255.0f;
+		}
+	}
+
+	void CompressBC4(const Block &block, int channel, uint8_t *out)
+	{
+		const float *values = block.c[channel];
+		float minValue = 255.0f, maxValue = 0.0f;
+		float minInner = 255.0f, maxInner = 0.0f; // without 0 and 255
+		for (int i = 0; i < 16; ++i)
+		{
+			minValue = min(minValue, values[i]);
+			maxValue = max(maxValue, values[i]);
+			if (values[i] > 0.0f && values[i] < 255.0f)
+			{
+				minInner = min(minInner, values[i]);
+				maxInner = max(maxInner, values[i]);
+			}
+		}
+
+		// Candidates: eight values between the extremes, refined eight values and
+		// six values between the inner extremes (with exact 0 and 255)
+		int candidates[3][2];
+		int candidateCount = 0;
+		candidates[candidateCount][0] = (int)(maxValue + 0.5f);
+		candidates[candidateCount][1] = (int)(minValue + 0.5f);
+		candidateCount++;
+		if (minInner <= maxInner && (minValue == 0.0f || maxValue == 255.0f))
+		{
+			candidates[candidateCount][0] = (int)(minInner + 0.5f);
+			candidates[candidateCount][1] = (int)(maxInner + 0.5f);
+			candidateCount++;
+		}
+
+		Palette palette;
+		uint8_t indices[16], bestIndices[16] = {};
+		int bestA0 = candidates[0][0], bestA1 = candidates[0][1];
+		float bestError = FLT_MAX;
+		for (int c = 0; c < candidateCount; ++c)
+		{
+			int a0 = candidates[c][0], a1 = candidates[c][1];
+			BuildBC4Palette(a0, a1, palette, channel);
+			float error = FitIndices(block, channel, channel + 1, palette, 8, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestA0 = a0;
+				bestA1 = a1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+
+			// Least squares refinement of the eight value mode
+			if (c == 0 && a0 > a1 && error > 0.0f)
+			{
+				float weights[16];
+				for (int i = 0; i < 16; ++i)
+					weights[i] = (indices[i] == 0) ? 0.0f : ((indices[i] == 1) ? 1.0f : (indices[i] - 1) / 7.0f);
+				float e0[4], e1[4];
+				if (RefineEndpoints(block, channel, channel + 1, weights, e0, e1))
+				{
+					int r0 = (int)(e0[channel] + 0.5f), r1 = (int)(e1[channel] + 0.5f);
+					if (r0 > r1)
+					{
+						BuildBC4Palette(r0, r1, palette, channel);
+						error = FitIndices(block, channel, channel + 1, palette, 8, indices);
+						if (error < bestError)
+						{
+							bestError = error;
+							bestA0 = r0;
+							bestA1 = r1;
+							memcpy(bestIndices, indices, sizeof(indices));
+						}
+					}
+				}
+			}
+		}
+
+		out[0] = (uint8_t)bestA0;
+		out[1] = (uint8_t)bestA1;
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= (uint64_t)bestIndices[i] << (i * 3);
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = (uint8_t)(bits >> (i * 8));
+	}
+
+	void DecompressBC4(const uint8_t *in, int channel, uint8_t *outPixels)
+	{
+		Palette palette;
+		BuildBC4Palette(in[0], in[1], palette, 0);
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= (uint64_t)in[2 + i] << (i * 8);
+		for (int i = 0; i < 16; ++i)
+			outPixels[i * 4 + channel] = (uint8_t)palette[(bits >> (i * 3)) & 7][0];
+	}
+
+	//
+	// BC7 mode 6: one subset, RGBA endpoints with 7 bits and a p-bit each, 4-bit indices
+	//
+
+	struct BitWriter
+	{
+		uint8_t *data;
+		UINT position;
+
+		void Write(uint32_t value, UINT bitCount)
+		{
+			for (UINT i = 0; i < bitCount; ++i, ++position)
+				data[position >> 3] |= (uint8_t)(((value >> i) & 1) << (position & 7));
+		}
+	};
+
+	struct BitReader
+	{
+		const uint8_t *data;
+		UINT position;
+
+		uint32_t Read(UINT bitCount)
+		{
+			uint32_t value = 0;
+			for (UINT i = 0; i < bitCount; ++i, ++position)
+				value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+			return value;
+		}
+	};
+
+	// Picks the p-bit with the smaller error, the endpoint channels are (q << 1) | p.
+	void QuantizeBC7Endpoint(const float *endpoint, int *q, int *p)
+	{
+		float bestError = FLT_MAX;
+		for (int pBit = 0; pBit < 2; ++pBit)
+		{
+			int candidate[4];
+			float error = 0.0f;
+			for (int ch = 0; ch < 4; ++ch)
+			{
+				int v = (int)((endpoint[ch] - pBit) * 0.5f + 0.5f);
+				candidate[ch] = (v < 0) ? 0 : ((v > 127) ? 127 : v);
+				float d = (float)((candidate[ch] << 1) | pBit) - endpoint[ch];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				*p = pBit;
+				memcpy(q, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	void BuildBC7Palette(const int *q0, int p0, const int *q1, int p1, Palette &palette)
+	{
+		for (int ch = 0; ch < 4; ++ch)
+		{
+			int a = (q0[ch] << 1) | p0;
+			int b = (q1[ch] << 1) | p1;
+			for (int i = 0; i < 16; ++i)
+				palette[i][ch] = (float)(((64 - BC7Weights4[i]) * a + BC7Weights4[i] * b + 32) >> 6);
+		}
+	}
+
+	void CompressBC7(const Block &block, uint8_t *out)
+	{
+		float e0[4], e1[4];
+		PrincipalAxisEndpoints(block, 4, e0, e1);
+
+		int bestQ0[4] = {}, bestQ1[4] = {}, bestP0 = 0, bestP1 = 0;
+		uint8_t bestIndices[16] = {};
+		float bestError = FLT_MAX;
+		for (int iter = 0; iter < 3; ++iter)
+		{
+			int q0[4], q1[4], p0, p1;
+			QuantizeBC7Endpoint(e0, q0, &p0);
+			QuantizeBC7Endpoint(e1, q1, &p1);
+			Palette palette;
+			BuildBC7Palette(q0, p0, q1, p1, palette);
+			uint8_t indices[16];
+			float error = FitIndices(block, 0, 4, palette, 16, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestQ0, q0, sizeof(q0));
+				memcpy(bestQ1, q1, sizeof(q1));
+				bestP0 = p0;
+				bestP1 = p1;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (error == 0.0f)
+				break;
+
+			float weights[16];
+			for (int i = 0; i < 16; ++i)
+				weights[i] = BC7Weights4[indices[i]] / 64.0f;
+			if (!RefineEndpoints(block, 0, 4, weights, e0, e1))
+				break;
+		}
+
+		// The most significant bit of the first index is implied to be 0
+		if (bestIndices[0] & 8)
+		{
+			swap(bestQ0, bestQ1);
+			swap(bestP0, bestP1);
+			for (int i = 0; i < 16; ++i)
+				bestIndices[i] = 15 - bestIndices[i];
+		}
+
+		memset(out, 0, 16);
+		BitWriter writer = { out, 0 };
+		writer.Write(1 << 6, 7); // mode 6
+		for (int ch = 0; ch < 4; ++ch)
+		{
+			writer.Write(bestQ0[ch], 7);
+			writer.Write(bestQ1[ch], 7);
+		}
+		writer.Write(bestP0, 1);
+		writer.Write(bestP1, 1);
+		writer.Write(bestIndices[0], 3);
+		for (int i = 1; i < 16; ++i)
+			writer.Write(bestIndices[i], 4);
+	}
+
+	void DecompressBC7(const uint8_t *in, uint8_t *outPixels)
+	{
+		BitReader reader = { in, 0 };
+		if (reader.Read(7) != (1 << 6))
+		{
+			// Only mode 6 is written by the encoder
+			memset(outPixels, 0, 64);
+			return;
+		}
+
+		int q0[4], q1[4];
+		for (int ch = 0; ch < 4; ++ch)
+		{
+			q0[ch] = reader.Read(7);
+			q1[ch] = reader.Read(7);
+		}
+		int p0 = reader.Read(1);
+		int p1 = reader.Read(1);
+		Palette palette;
+		BuildBC7Palette(q0, p0, q1, p1, palette);
+		for (int i = 0; i < 16; ++i)
+		{
+			int index = reader.Read((i == 0) ? 3 : 4);
+			for (int ch = 0; ch < 4; ++ch)
+				outPixels[i * 4 + ch] = (uint8_t)palette[index][ch];
+		}
+	}
+}
+
+UINT BlockCompressor::GetBlockByteSize(BlockCompressionFormat format)
+{
+	return (format == BlockCompressionFormat::BC1) ? 8 : 16;
+}
+
+size_t BlockCompressor::GetCompressedSize(BlockCompressionFormat format, UINT width, UINT height)
+{
+	size_t blocksWide = max(1U, (width + 3) / 4);
+	size_t blocksHigh = max(1U, (height + 3) / 4);
+	return blocksWide * blocksHigh * GetBlockByteSize(format);
+}
+
+void BlockCompressor::Compress(BlockCompressionFormat format, const uint8_t *rgba, UINT width, UINT height, UINT rowPitch,
+	WorkerPool *workerPool, uint8_t *outBlocks)
+{
+	UINT blocksWide = max(1U, (width + 3) / 4);
+	UINT blocksHigh = max(1U, (height + 3) / 4);
+	UINT blockSize = GetBlockByteSize(format);
+
+	auto compressRows = [=](UINT begin, UINT end)
+	{
+		uint8_t pixels[64];
+		for (UINT by = begin; by < end; ++by)
+		{
+			for (UINT bx = 0; bx < blocksWide; ++bx)
+			{
+				// Gather the block, clamped to the image
+				for (UINT y = 0; y < 4; ++y)
+				{
+					UINT py = min(by * 4 + y, height - 1);
+					for (UINT x = 0; x < 4; ++x)
+					{
+						UINT px = min(bx * 4 + x, width - 1);
+						memcpy(&pixels[(y * 4 + x) * 4], rgba + (size_t)py * rowPitch + px * 4, 4);
+					}
+				}
+				CompressBlock(format, pixels, outBlocks + ((size_t)by * blocksWide + bx) * blockSize);
+			}
+		}
+	};
+
+	if (workerPool)
+		workerPool->ParallelFor(blocksHigh, 4, compressRows);
+	else
+		compressRows(0, blocksHigh);
+}
+
+void BlockCompressor::CompressBlock(BlockCompressionFormat format, const uint8_t *pixels, uint8_t *outBlock)
+{
+	Block block;
+	LoadBlock(pixels, &block);
+	switch (format)
+	{
+	case BlockCompressionFormat::BC1:
+		CompressBC1(block, outBlock);
+		break;
+	case BlockCompressionFormat::BC3:
+		CompressBC4(block, 3, outBlock);
+		CompressBC1(block, outBlock + 8);
+		break;
+	case BlockCompressionFormat::BC5:
+		CompressBC4(block, 0, outBlock);
+		CompressBC4(block, 1, outBlock + 8);
+		break;
+	case BlockCompressionFormat::BC7:
+		CompressBC7(block, outBlock);
+		break;
+	}
+}
+
+void BlockCompressor::DecompressBlock(BlockCompressionFormat format, const uint8_t *block, uint8_t *outPixels)
+{
+	switch (format)
+	{
+	case BlockCompressionFormat::BC1:
+		DecompressBC1(block, false, outPixels);
+		break;
+	case BlockCompressionFormat::BC3:
+		DecompressBC1(block + 8, true, outPixels);
+		DecompressBC4(block, 3, outPixels);
+		break;
+	case BlockCompressionFormat::BC5:
+		for (int i = 0; i < 16; ++i)
+		{
+			outPixels[i * 4 + 2] = 0;
+			outPixels[i * 4 + 3] = 255;
+		}
+		DecompressBC4(block, 0, outPixels);
+		DecompressBC4(block + 8, 1, outPixels);
+		break;
+	case BlockCompressionFormat::BC7:
+		DecompressBC7(block, outPixels);
+		break;
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef BLOCK_COMPRESSOR_H
+#define BLOCK_COMPRESSOR_H
+
+#include "SpeckEngineDefinitions.h"
+
+namespace Speck
+{
+	class WorkerPool;
+
+	enum struct BlockCompressionFormat
+	{
+		BC1, // RGB, 4 bits per pixel
+		BC3, // RGBA, 8 bits per pixel
+		BC5, // two channels (RG), 8 bits per pixel, for normal maps
+		BC7  // RGBA, 8 bits per pixel, best quality
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	CPU encoder of the block compressed texture formats. Every 4x4 block of pixels is
+	//	fitted along the principal axis of its colors and refined with least squares, the
+	//	closest palette entries are searched for four pixels at a time with SSE. Images
+	//	are compressed in rows of blocks on the worker threads. BC7 uses mode 6 only.
+	//-------------------------------------------------------------------------------------
+	class BlockCompressor
+	{
+	public:
+		// 8 or 16 bytes.
+		DLL_EXPORT static UINT GetBlockByteSize(BlockCompressionFormat format);
+		// The dimensions are rounded up to whole blocks.
+		DLL_EXPORT static size_t GetCompressedSize(BlockCompressionFormat format, UINT width, UINT height);
+
+		// Compresses the RGBA8 image, blocks are written in rows. Blocks over the edges of the image
+		// repeat the edge pixels. The worker pool is optional.
+		DLL_EXPORT static void Compress(BlockCompressionFormat format, const uint8_t *rgba, UINT width, UINT height, UINT rowPitch,
+			WorkerPool *workerPool, uint8_t *outBlocks);
+
+		// Single block of 16 RGBA8 pixels, in rows.
+		DLL_EXPORT static void CompressBlock(BlockCompressionFormat format, const uint8_t *pixels, uint8_t *outBlock);
+		// Used to measure the quality of the compression. Channels that are not stored are set to 0 (255 for alpha).
+		DLL_EXPORT static void DecompressBlock(BlockCompressionFormat format, const uint8_t *block, uint8_t *outPixels);
+	};
+}
+
+#endif
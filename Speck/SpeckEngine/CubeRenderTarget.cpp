@@ -372,6 +372,10 @@ void CubeRenderTarget::BuildResource()
 		D3D12_RESOURCE_STATE_COMMON,
 		nullptr,
 		IID_PPV_ARGS(&mCubeMapIrradianceBuffer)));
+
+	MemoryTracker::TrackResource(mCubeMapBuffer.Get(), MemoryTag::CubeMaps);
+	MemoryTracker::TrackResource(mCubeDepthStencilBuffer.Get(), MemoryTag::CubeMaps);
+	MemoryTracker::TrackResource(mCubeMapIrradianceBuffer.Get(), MemoryTag::CubeMaps);
 }
 
 void CubeRenderTarget::BuildPassConstantBuffer()
@@ -383,7 +387,7 @@ void CubeRenderTarget::BuildPassConstantBuffer()
 	for (int i = 0; i < NUM_FRAME_RESOURCES; ++i)
 	{
 		// Make constant buffer, with the room for six PassConstants. Each for one cube side.
-		auto passCB = make_unique<UploadBuffer<PassConstants>>(device, 6, true);
+		auto passCB = make_unique<UploadBuffer<PassConstants>>(device, 6, true, MemoryTag::CubeMaps);
 		mPassCB.push_back(move(passCB));
 	}
 }
@@ -487,7 +491,7 @@ void CubeRenderTarget::BuildStaticMembers(ID3D12Device *device, ID3D12GraphicsCo
 	}
 
 	UINT byteSize = (UINT)data.size() * sizeof(XMFLOAT4);
-	mSamplerRaysBuffer = CreateDefaultBuffer(device, cmdList, &data[0], byteSize, mSamplerRaysUploadBuffer);
+	mSamplerRaysBuffer = CreateDefaultBuffer(device, cmdList, &data[0], byteSize, mSamplerRaysUploadBuffer, MemoryTag::CubeMaps);
 }
 
 void CubeRenderTarget::ReleaseStaticMembers()
@@ -6,9 +6,11 @@
 #include "DirectXHeaders.h"
 #include "DirectXCore.h"
 #include "ProcessAndSystemData.h"
+#include "MetricsSampler.h"
 #include "CameraController.h"
 #include "Timer.h"
 #include "InputHandler.h"
+#include "Profiler.h"
 #include <psapi.h> // for system data
 #include <pdh.h>
 #pragma comment(lib, "pdh.lib")
@@ -131,6 +133,7 @@ static HANDLE self;
 
 				if (!mAppPaused)
 				{
+					PROFILE_ZONE("Frame");
 					UpdateProcessAndSystemData();
 					Update(*GetEngineCore().mTimer.get());
 					Draw(*GetEngineCore().mTimer.get());
@@ -671,6 +674,11 @@ static HANDLE self;
 		lastUserCPU = user;
 		lastSysCPU = sys;
 		GetEngineCore().mProcessAndSystemData->mCPU_usageByMe = percent * 100;
+
+		// The first update is done before the timer ticks
+		float deltaTime = GetEngineCore().mTimer->DeltaTime();
+		if (deltaTime > 0.0f)
+			GetEngineCore().mMetricsSampler->Sample(deltaTime * 1000.0);
 	}
 
 	void D3DApp::LogAdapters()
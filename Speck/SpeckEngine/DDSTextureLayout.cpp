@@ -0,0 +1,625 @@
+#include "DDSTextureLayout.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	// DDS file structures, see DDS.h in the DirectXTex library.
+	const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+	constexpr uint32_t MakeFourCC(char ch0, char ch1, char ch2, char ch3)
+	{
+		return (uint32_t)(uint8_t)ch0 | ((uint32_t)(uint8_t)ch1 << 8) | ((uint32_t)(uint8_t)ch2 << 16) | ((uint32_t)(uint8_t)ch3 << 24);
+	}
+
+	const uint32_t DDS_FOURCC = 0x00000004;		// DDPF_FOURCC
+	const uint32_t DDS_RGB = 0x00000040;		// DDPF_RGB
+	const uint32_t DDS_LUMINANCE = 0x00020000;	// DDPF_LUMINANCE
+	const uint32_t DDS_ALPHA = 0x00000002;		// DDPF_ALPHA
+	const uint32_t DDS_HEADER_FLAGS_VOLUME = 0x00800000;	// DDSD_DEPTH
+	const uint32_t DDS_HEIGHT = 0x00000002;		// DDSD_HEIGHT
+	const uint32_t DDS_CUBEMAP = 0x00000200;	// DDSCAPS2_CUBEMAP
+	const uint32_t DDS_CUBEMAP_ALLFACES = 0x0000fe00;	// DDSCAPS2_CUBEMAP and all the DDSCAPS2_CUBEMAP_POSITIVEX... faces
+	const uint32_t DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7;
+	const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;	// D3D11_RESOURCE_MISC_TEXTURECUBE
+
+	// Limits of the Direct3D 12 hardware (D3D12_REQ_*), larger sizes in the headers are not trusted.
+	const size_t MAX_MIP_LEVELS = 15;
+	const size_t MAX_TEXTURE1D_SIZE = 16384;
+	const size_t MAX_TEXTURE2D_SIZE = 16384;
+	const size_t MAX_TEXTURECUBE_SIZE = 16384;
+	const size_t MAX_TEXTURE3D_SIZE = 2048;
+	const size_t MAX_ARRAY_SIZE = 2048;
+
+#pragma pack(push, 1)
+	struct DDS_PIXELFORMAT
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct DDS_HEADER
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DDS_PIXELFORMAT ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DDS_HEADER_DXT10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension; // D3D11_RESOURCE_DIMENSION, the same values as DDSDimension
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+#pragma pack(pop)
+
+	size_t BitsPerPixel(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_UINT:
+		case DXGI_FORMAT_R32G32B32A32_SINT:
+			return 128;
+
+		case DXGI_FORMAT_R32G32B32_TYPELESS:
+		case DXGI_FORMAT_R32G32B32_FLOAT:
+		case DXGI_FORMAT_R32G32B32_UINT:
+		case DXGI_FORMAT_R32G32B32_SINT:
+			return 96;
+
+		case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R16G16B16A16_UINT:
+		case DXGI_FORMAT_R16G16B16A16_SNORM:
+		case DXGI_FORMAT_R16G16B16A16_SINT:
+		case DXGI_FORMAT_R32G32_TYPELESS:
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R32G32_UINT:
+		case DXGI_FORMAT_R32G32_SINT:
+		case DXGI_FORMAT_R32G8X24_TYPELESS:
+		case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+		case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+		case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+		case DXGI_FORMAT_Y416:
+		case DXGI_FORMAT_Y210:
+		case DXGI_FORMAT_Y216:
+			return 64;
+
+		case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+		case DXGI_FORMAT_R10G10B10A2_UNORM:
+		case DXGI_FORMAT_R10G10B10A2_UINT:
+		case DXGI_FORMAT_R11G11B10_FLOAT:
+		case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_R8G8B8A8_UINT:
+		case DXGI_FORMAT_R8G8B8A8_SNORM:
+		case DXGI_FORMAT_R8G8B8A8_SINT:
+		case DXGI_FORMAT_R16G16_TYPELESS:
+		case DXGI_FORMAT_R16G16_FLOAT:
+		case DXGI_FORMAT_R16G16_UNORM:
+		case DXGI_FORMAT_R16G16_UINT:
+		case DXGI_FORMAT_R16G16_SNORM:
+		case DXGI_FORMAT_R16G16_SINT:
+		case DXGI_FORMAT_R32_TYPELESS:
+		case DXGI_FORMAT_D32_FLOAT:
+		case DXGI_FORMAT_R32_FLOAT:
+		case DXGI_FORMAT_R32_UINT:
+		case DXGI_FORMAT_R32_SINT:
+		case DXGI_FORMAT_R24G8_TYPELESS:
+		case DXGI_FORMAT_D24_UNORM_S8_UINT:
+		case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+		case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+		case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+		case DXGI_FORMAT_R8G8_B8G8_UNORM:
+		case DXGI_FORMAT_G8R8_G8B8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8X8_UNORM:
+		case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+		case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		case DXGI_FORMAT_AYUV:
+		case DXGI_FORMAT_Y410:
+		case DXGI_FORMAT_YUY2:
+			return 32;
+
+		case DXGI_FORMAT_P010:
+		case DXGI_FORMAT_P016:
+			return 24;
+
+		case DXGI_FORMAT_R8G8_TYPELESS:
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_R8G8_UINT:
+		case DXGI_FORMAT_R8G8_SNORM:
+		case DXGI_FORMAT_R8G8_SINT:
+		case DXGI_FORMAT_R16_TYPELESS:
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_D16_UNORM:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_R16_UINT:
+		case DXGI_FORMAT_R16_SNORM:
+		case DXGI_FORMAT_R16_SINT:
+		case DXGI_FORMAT_B5G6R5_UNORM:
+		case DXGI_FORMAT_B5G5R5A1_UNORM:
+		case DXGI_FORMAT_A8P8:
+		case DXGI_FORMAT_B4G4R4A4_UNORM:
+			return 16;
+
+		case DXGI_FORMAT_NV12:
+		case DXGI_FORMAT_420_OPAQUE:
+		case DXGI_FORMAT_NV11:
+			return 12;
+
+		case DXGI_FORMAT_R8_TYPELESS:
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_R8_UINT:
+		case DXGI_FORMAT_R8_SNORM:
+		case DXGI_FORMAT_R8_SINT:
+		case DXGI_FORMAT_A8_UNORM:
+		case DXGI_FORMAT_AI44:
+		case DXGI_FORMAT_IA44:
+		case DXGI_FORMAT_P8:
+			return 8;
+
+		case DXGI_FORMAT_R1_UNORM:
+			return 1;
+
+		case DXGI_FORMAT_BC1_TYPELESS:
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_TYPELESS:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			return 4;
+
+		case DXGI_FORMAT_BC2_TYPELESS:
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_TYPELESS:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_TYPELESS:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC6H_TYPELESS:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC6H_SF16:
+		case DXGI_FORMAT_BC7_TYPELESS:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return 8;
+
+		default:
+			return 0;
+		}
+	}
+
+	// Bytes of one slice of the surface and of one of its rows (of blocks for the block compressed formats).
+	void GetSurfaceInfo(size_t width, size_t height, DXGI_FORMAT format, size_t *outNumBytes, size_t *outRowBytes)
+	{
+		bool bc = false;
+		bool packed = false;
+		bool planar = false;
+		size_t bpe = 0;
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_TYPELESS:
+		case DXGI_FORMAT_BC1_UNORM:
+		case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_TYPELESS:
+		case DXGI_FORMAT_BC4_UNORM:
+		case DXGI_FORMAT_BC4_SNORM:
+			bc = true;
+			bpe = 8;
+			break;
+
+		case DXGI_FORMAT_BC2_TYPELESS:
+		case DXGI_FORMAT_BC2_UNORM:
+		case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_TYPELESS:
+		case DXGI_FORMAT_BC3_UNORM:
+		case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_TYPELESS:
+		case DXGI_FORMAT_BC5_UNORM:
+		case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC6H_TYPELESS:
+		case DXGI_FORMAT_BC6H_UF16:
+		case DXGI_FORMAT_BC6H_SF16:
+		case DXGI_FORMAT_BC7_TYPELESS:
+		case DXGI_FORMAT_BC7_UNORM:
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			bc = true;
+			bpe = 16;
+			break;
+
+		case DXGI_FORMAT_R8G8_B8G8_UNORM:
+		case DXGI_FORMAT_G8R8_G8B8_UNORM:
+		case DXGI_FORMAT_YUY2:
+			packed = true;
+			bpe = 4;
+			break;
+
+		case DXGI_FORMAT_Y210:
+		case DXGI_FORMAT_Y216:
+			packed = true;
+			bpe = 8;
+			break;
+
+		case DXGI_FORMAT_NV12:
+		case DXGI_FORMAT_420_OPAQUE:
+			planar = true;
+			bpe = 2;
+			break;
+
+		case DXGI_FORMAT_P010:
+		case DXGI_FORMAT_P016:
+			planar = true;
+			bpe = 4;
+			break;
+
+		default:
+			break;
+		}
+
+		size_t rowBytes;
+		size_t numBytes;
+		if (bc)
+		{
+			size_t numBlocksWide = (width > 0) ? max<size_t>(1, (width + 3) / 4) : 0;
+			size_t numBlocksHigh = (height > 0) ? max<size_t>(1, (height + 3) / 4) : 0;
+			rowBytes = numBlocksWide * bpe;
+			numBytes = rowBytes * numBlocksHigh;
+		}
+		else if (packed)
+		{
+			rowBytes = ((width + 1) >> 1) * bpe;
+			numBytes = rowBytes * height;
+		}
+		else if (format == DXGI_FORMAT_NV11)
+		{
+			// Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+			rowBytes = ((width + 3) >> 2) * 4;
+			numBytes = rowBytes * height * 2;
+		}
+		else if (planar)
+		{
+			rowBytes = ((width + 1) >> 1) * bpe;
+			numBytes = (rowBytes * height) + ((rowBytes * height + 1) >> 1);
+		}
+		else
+		{
+			rowBytes = (width * BitsPerPixel(format) + 7) / 8; // round up to nearest byte
+			numBytes = rowBytes * height;
+		}
+
+		*outNumBytes = numBytes;
+		*outRowBytes = rowBytes;
+	}
+
+	bool IsBitMask(const DDS_PIXELFORMAT &ddpf, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a;
+	}
+
+	// Format of the files without the DX10 header, the sRGB formats are always written with it.
+	DXGI_FORMAT GetDXGIFormat(const DDS_PIXELFORMAT &ddpf)
+	{
+		if (ddpf.flags & DDS_RGB)
+		{
+			switch (ddpf.RGBBitCount)
+			{
+			case 32:
+				if (IsBitMask(ddpf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+					return DXGI_FORMAT_R8G8B8A8_UNORM;
+				if (IsBitMask(ddpf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+					return DXGI_FORMAT_B8G8R8A8_UNORM;
+				if (IsBitMask(ddpf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+					return DXGI_FORMAT_B8G8R8X8_UNORM;
+				// D3DX writes the red and blue masks of 10:10:10:2 swapped
+				if (IsBitMask(ddpf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+					return DXGI_FORMAT_R10G10B10A2_UNORM;
+				if (IsBitMask(ddpf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+					return DXGI_FORMAT_R16G16_UNORM;
+				if (IsBitMask(ddpf, 0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+					return DXGI_FORMAT_R32_FLOAT;
+				break;
+
+			case 16:
+				if (IsBitMask(ddpf, 0x7c00, 0x03e0, 0x001f, 0x8000))
+					return DXGI_FORMAT_B5G5R5A1_UNORM;
+				if (IsBitMask(ddpf, 0xf800, 0x07e0, 0x001f, 0x0000))
+					return DXGI_FORMAT_B5G6R5_UNORM;
+				if (IsBitMask(ddpf, 0x0f00, 0x00f0, 0x000f, 0xf000))
+					return DXGI_FORMAT_B4G4R4A4_UNORM;
+				break;
+			}
+		}
+		else if (ddpf.flags & DDS_LUMINANCE)
+		{
+			if (ddpf.RGBBitCount == 8 && IsBitMask(ddpf, 0x000000ff, 0x00000000, 0x00000000, 0x00000000))
+				return DXGI_FORMAT_R8_UNORM;
+			if (ddpf.RGBBitCount == 16 && IsBitMask(ddpf, 0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
+				return DXGI_FORMAT_R16_UNORM;
+			if (ddpf.RGBBitCount == 16 && IsBitMask(ddpf, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+				return DXGI_FORMAT_R8G8_UNORM;
+		}
+		else if (ddpf.flags & DDS_ALPHA)
+		{
+			if (ddpf.RGBBitCount == 8)
+				return DXGI_FORMAT_A8_UNORM;
+		}
+		else if (ddpf.flags & DDS_FOURCC)
+		{
+			switch (ddpf.fourCC)
+			{
+			case MakeFourCC('D', 'X', 'T', '1'): return DXGI_FORMAT_BC1_UNORM;
+			// The premultiplied alpha is not in the formats, the data is the same
+			case MakeFourCC('D', 'X', 'T', '2'):
+			case MakeFourCC('D', 'X', 'T', '3'): return DXGI_FORMAT_BC2_UNORM;
+			case MakeFourCC('D', 'X', 'T', '4'):
+			case MakeFourCC('D', 'X', 'T', '5'): return DXGI_FORMAT_BC3_UNORM;
+			case MakeFourCC('A', 'T', 'I', '1'):
+			case MakeFourCC('B', 'C', '4', 'U'): return DXGI_FORMAT_BC4_UNORM;
+			case MakeFourCC('B', 'C', '4', 'S'): return DXGI_FORMAT_BC4_SNORM;
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'): return DXGI_FORMAT_BC5_UNORM;
+			case MakeFourCC('B', 'C', '5', 'S'): return DXGI_FORMAT_BC5_SNORM;
+			case MakeFourCC('R', 'G', 'B', 'G'): return DXGI_FORMAT_R8G8_B8G8_UNORM;
+			case MakeFourCC('G', 'R', 'G', 'B'): return DXGI_FORMAT_G8R8_G8B8_UNORM;
+			case MakeFourCC('Y', 'U', 'Y', '2'): return DXGI_FORMAT_YUY2;
+			// D3DFORMAT values
+			case 36: return DXGI_FORMAT_R16G16B16A16_UNORM;		// D3DFMT_A16B16G16R16
+			case 110: return DXGI_FORMAT_R16G16B16A16_SNORM;	// D3DFMT_Q16W16V16U16
+			case 111: return DXGI_FORMAT_R16_FLOAT;				// D3DFMT_R16F
+			case 112: return DXGI_FORMAT_R16G16_FLOAT;			// D3DFMT_G16R16F
+			case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT;	// D3DFMT_A16B16G16R16F
+			case 114: return DXGI_FORMAT_R32_FLOAT;				// D3DFMT_R32F
+			case 115: return DXGI_FORMAT_R32G32_FLOAT;			// D3DFMT_G32R32F
+			case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT;	// D3DFMT_A32B32G32R32F
+			}
+		}
+
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	DDSAlphaMode GetAlphaMode(const DDS_HEADER &header, const DDS_HEADER_DXT10 *dxt10)
+	{
+		if (dxt10)
+		{
+			uint32_t mode = dxt10->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK;
+			if (mode <= (uint32_t)DDSAlphaMode::Custom)
+				return (DDSAlphaMode)mode;
+		}
+		else if ((header.ddspf.flags & DDS_FOURCC) && (header.ddspf.fourCC == MakeFourCC('D', 'X', 'T', '2') || header.ddspf.fourCC == MakeFourCC('D', 'X', 'T', '4')))
+		{
+			return DDSAlphaMode::Premultiplied;
+		}
+		return DDSAlphaMode::Unknown;
+	}
+
+	// Dimensions, format and kind of the texture, false if they are invalid or not supported.
+	bool GetTextureInfo(const DDS_HEADER &header, const DDS_HEADER_DXT10 *dxt10, DDSTextureLayout *layout)
+	{
+		layout->width = header.width;
+		layout->height = header.height;
+		layout->depth = header.depth;
+		layout->mipCount = max<size_t>(header.mipMapCount, 1);
+		layout->arraySize = 1;
+		layout->isCubeMap = false;
+
+		if (dxt10)
+		{
+			layout->arraySize = dxt10->arraySize;
+			if (layout->arraySize == 0)
+				return false;
+
+			layout->format = (DXGI_FORMAT)dxt10->dxgiFormat;
+			switch (layout->format)
+			{
+			case DXGI_FORMAT_AI44:
+			case DXGI_FORMAT_IA44:
+			case DXGI_FORMAT_P8:
+			case DXGI_FORMAT_A8P8:
+				return false;
+			default:
+				if (BitsPerPixel(layout->format) == 0)
+					return false;
+			}
+
+			layout->dimension = (DDSDimension)dxt10->resourceDimension;
+			switch (layout->dimension)
+			{
+			case DDSDimension::Texture1D:
+				if ((header.flags & DDS_HEIGHT) && layout->height != 1)
+					return false;
+				layout->height = layout->depth = 1;
+				break;
+
+			case DDSDimension::Texture2D:
+				if (dxt10->miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+				{
+					layout->arraySize *= 6;
+					layout->isCubeMap = true;
+				}
+				layout->depth = 1;
+				break;
+
+			case DDSDimension::Texture3D:
+				if (!(header.flags & DDS_HEADER_FLAGS_VOLUME) || layout->arraySize > 1)
+					return false;
+				break;
+
+			default:
+				return false;
+			}
+		}
+		else
+		{
+			layout->format = GetDXGIFormat(header.ddspf);
+			if (layout->format == DXGI_FORMAT_UNKNOWN)
+				return false;
+
+			if (header.flags & DDS_HEADER_FLAGS_VOLUME)
+			{
+				layout->dimension = DDSDimension::Texture3D;
+			}
+			else
+			{
+				if (header.caps2 & DDS_CUBEMAP)
+				{
+					if ((header.caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+						return false;
+					layout->arraySize = 6;
+					layout->isCubeMap = true;
+				}
+				layout->depth = 1;
+				layout->dimension = DDSDimension::Texture2D;
+			}
+		}
+
+		if (layout->width == 0 || layout->height == 0 || layout->depth == 0 || layout->mipCount > MAX_MIP_LEVELS)
+			return false;
+
+		// No more mips than down to 1x1x1, the texture could not be created with them
+		size_t largest = max(layout->width, max(layout->height, layout->depth));
+		size_t fullMipCount = 1;
+		while (largest >> fullMipCount)
+			++fullMipCount;
+		if (layout->mipCount > fullMipCount)
+			return false;
+
+		switch (layout->dimension)
+		{
+		case DDSDimension::Texture1D:
+			return layout->arraySize <= MAX_ARRAY_SIZE && layout->width <= MAX_TEXTURE1D_SIZE;
+		case DDSDimension::Texture2D:
+		{
+			// The array size of the cube maps is already NumCubes * 6
+			size_t maxSize = layout->isCubeMap ? MAX_TEXTURECUBE_SIZE : MAX_TEXTURE2D_SIZE;
+			return layout->arraySize <= MAX_ARRAY_SIZE && layout->width <= maxSize && layout->height <= maxSize;
+		}
+		case DDSDimension::Texture3D:
+			return layout->width <= MAX_TEXTURE3D_SIZE && layout->height <= MAX_TEXTURE3D_SIZE && layout->depth <= MAX_TEXTURE3D_SIZE;
+		default:
+			return false;
+		}
+	}
+}
+
+bool DDSTextureLayout::Parse(const uint8_t *ddsData, size_t ddsDataSize, DDSTextureLayout *outLayout)
+{
+	// Magic number and headers
+	if (!ddsData || ddsDataSize < sizeof(uint32_t) + sizeof(DDS_HEADER))
+		return false;
+	uint32_t magic;
+	memcpy(&magic, ddsData, sizeof(uint32_t));
+	DDS_HEADER header;
+	memcpy(&header, ddsData + sizeof(uint32_t), sizeof(DDS_HEADER));
+	if (magic != DDS_MAGIC || header.size != sizeof(DDS_HEADER) || header.ddspf.size != sizeof(DDS_PIXELFORMAT))
+		return false;
+
+	size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+	DDS_HEADER_DXT10 dxt10;
+	bool hasDXT10 = (header.ddspf.flags & DDS_FOURCC) && header.ddspf.fourCC == MakeFourCC('D', 'X', '1', '0');
+	if (hasDXT10)
+	{
+		if (ddsDataSize < offset + sizeof(DDS_HEADER_DXT10))
+			return false;
+		memcpy(&dxt10, ddsData + offset, sizeof(DDS_HEADER_DXT10));
+		offset += sizeof(DDS_HEADER_DXT10);
+	}
+
+	DDSTextureLayout layout;
+	if (!GetTextureInfo(header, hasDXT10 ? &dxt10 : nullptr, &layout))
+		return false;
+	layout.alphaMode = GetAlphaMode(header, hasDXT10 ? &dxt10 : nullptr);
+
+	// Subresources are stored one after another, all the mips of an item and then the next item
+	layout.subresources.resize(layout.mipCount * layout.arraySize);
+	const uint8_t *bits = ddsData + offset;
+	size_t remaining = ddsDataSize - offset;
+	size_t index = 0;
+	for (size_t item = 0; item < layout.arraySize; ++item)
+	{
+		size_t w = layout.width;
+		size_t h = layout.height;
+		size_t d = layout.depth;
+		for (size_t mip = 0; mip < layout.mipCount; ++mip)
+		{
+			size_t numBytes, rowBytes;
+			GetSurfaceInfo(w, h, layout.format, &numBytes, &rowBytes);
+			if (numBytes * d > remaining)
+				return false;
+
+			DDSSubresource &subresource = layout.subresources[index++];
+			subresource.data = bits;
+			subresource.rowPitch = rowBytes;
+			subresource.slicePitch = numBytes;
+			subresource.width = w;
+			subresource.height = h;
+			subresource.depth = d;
+			bits += numBytes * d;
+			remaining -= numBytes * d;
+
+			w = max<size_t>(w >> 1, 1);
+			h = max<size_t>(h >> 1, 1);
+			d = max<size_t>(d >> 1, 1);
+		}
+	}
+
+	*outLayout = move(layout);
+	return true;
+}
+
+size_t DDSTextureLayout::GetFirstResidentMip(size_t residentMipCount) const
+{
+	if (residentMipCount == 0 || residentMipCount >= mipCount)
+		return 0;
+	return mipCount - residentMipCount;
+}
+
+uint64_t DDSTextureLayout::GetMipSize(size_t mip) const
+{
+	uint64_t size = 0;
+	for (size_t item = 0; item < arraySize; ++item)
+	{
+		const DDSSubresource &subresource = GetSubresource(item, mip);
+		size += (uint64_t)subresource.slicePitch * subresource.depth;
+	}
+	return size;
+}
+
+uint64_t DDSTextureLayout::GetResidentSize(size_t firstMip) const
+{
+	uint64_t size = 0;
+	for (size_t mip = firstMip; mip < mipCount; ++mip)
+		size += GetMipSize(mip);
+	return size;
+}
@@ -0,0 +1,85 @@
+#ifndef DDS_TEXTURE_LAYOUT_H
+#define DDS_TEXTURE_LAYOUT_H
+
+// No SpeckEngineDefinitions.h here, this unit does not depend on Windows or Direct3D. The formats
+// are DXGI_FORMAT values, see DXGIFormat.h.
+#include "DXGIFormat.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#ifndef DLL_EXPORT
+#ifdef _MSC_VER
+#define DLL_EXPORT __declspec(dllexport)
+#else
+#define DLL_EXPORT
+#endif
+#endif
+
+namespace Speck
+{
+	// Values match D3D12_RESOURCE_DIMENSION.
+	enum class DDSDimension : uint32_t
+	{
+		Unknown = 0,
+		Texture1D = 2,
+		Texture2D = 3,
+		Texture3D = 4
+	};
+
+	// Values match DirectX::DDS_ALPHA_MODE.
+	enum class DDSAlphaMode : uint32_t
+	{
+		Unknown = 0,
+		Straight = 1,
+		Premultiplied = 2,
+		Opaque = 3,
+		Custom = 4
+	};
+
+	// Subresource of a DDS file, the data points into the file.
+	struct DDSSubresource
+	{
+		const uint8_t *data;
+		size_t rowPitch;
+		size_t slicePitch;
+		size_t width;
+		size_t height;
+		size_t depth;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Everything needed to create a texture from a DDS file without copying its data.
+	//	The headers are validated the way DDSTextureLoader does it, with the same limits
+	//	of the Direct3D 12 hardware. Subresources are in the Direct3D 12 order (all the
+	//	mips of the first array item, then the next item).
+	//-------------------------------------------------------------------------------------
+	struct DDSTextureLayout
+	{
+		DDSDimension dimension = DDSDimension::Unknown;
+		DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+		size_t width = 0;
+		size_t height = 0;
+		size_t depth = 0;
+		size_t mipCount = 0;
+		size_t arraySize = 0;
+		bool isCubeMap = false;
+		DDSAlphaMode alphaMode = DDSAlphaMode::Unknown;
+		std::vector<DDSSubresource> subresources;
+
+		// Computes the layout of every subresource over the data, nothing is copied. Returns false if the
+		// headers are invalid or not supported, or if the data ends before the last subresource.
+		DLL_EXPORT static bool Parse(const uint8_t *ddsData, size_t ddsDataSize, DDSTextureLayout *outLayout);
+
+		const DDSSubresource &GetSubresource(size_t item, size_t mip) const { return subresources[item * mipCount + mip]; }
+
+		// First mip to upload when only the residentMipCount smallest mips are loaded up front (0 loads all of them).
+		DLL_EXPORT size_t GetFirstResidentMip(size_t residentMipCount) const;
+		// Size of the mip, summed over all of the array items.
+		DLL_EXPORT uint64_t GetMipSize(size_t mip) const;
+		// Size of the mips from firstMip on.
+		DLL_EXPORT uint64_t GetResidentSize(size_t firstMip) const;
+	};
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include <wrl.h>
 
 #include "DDSTextureLoader.h" 
+#include "MemoryMappedFile.h"
 
 using namespace Microsoft::WRL;
 
@@ -269,6 +270,62 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
 }
 
 
+//--------------------------------------------------------------------------------------
+// Validates the magic number and the headers of DDS data already in memory
+//--------------------------------------------------------------------------------------
+static HRESULT GetTextureData( _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+                               _In_ size_t ddsDataSize,
+                               const DDS_HEADER** header,
+                               const uint8_t** bitData,
+                               size_t* bitSize
+                             )
+{
+    // Need at least enough data to fill the header and magic number to be a valid DDS
+    if (ddsDataSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) ) )
+    {
+        return E_FAIL;
+    }
+
+    // DDS files always start with the same magic number ("DDS ")
+    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData );
+    if (dwMagicNumber != DDS_MAGIC)
+    {
+        return E_FAIL;
+    }
+
+    auto hdr = reinterpret_cast<const DDS_HEADER*>( ddsData + sizeof( uint32_t ) );
+
+    // Verify header to validate DDS file
+    if (hdr->size != sizeof(DDS_HEADER) ||
+        hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return E_FAIL;
+    }
+
+    // Check for DX10 extension
+    bool bDXT10Header = false;
+    if ((hdr->ddspf.flags & DDS_FOURCC) &&
+        (MAKEFOURCC( 'D', 'X', '1', '0' ) == hdr->ddspf.fourCC))
+    {
+        // Must be long enough for both headers and magic value
+        if (ddsDataSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10) ) )
+        {
+            return E_FAIL;
+        }
+
+        bDXT10Header = true;
+    }
+
+    // setup the pointers in the process request
+    *header = hdr;
+    ptrdiff_t offset = sizeof( uint32_t ) + sizeof( DDS_HEADER )
+                       + (bDXT10Header ? sizeof( DDS_HEADER_DXT10 ) : 0);
+    *bitData = ddsData + offset;
+    *bitSize = ddsDataSize - offset;
+
+    return S_OK;
+}
+
 //--------------------------------------------------------------------------------------
 // Return the BPP for a particular format
 //--------------------------------------------------------------------------------------
@@ -1669,29 +1726,31 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D11Device* d3dDevice,
     return hr;
 }
 
-static HRESULT CreateTextureFromDDS12(
-	_In_ ID3D12Device* device,
-	_In_opt_ ID3D12GraphicsCommandList* cmdList,
+//--------------------------------------------------------------------------------------
+// Reads the dimensions and the format of the texture from the header and checks them
+// against the Direct3D 12 limits.
+//--------------------------------------------------------------------------------------
+static HRESULT GetTextureInfo12(
 	_In_ const DDS_HEADER* header,
-	_In_reads_bytes_(bitSize) const uint8_t* bitData,
-	_In_ size_t bitSize,
-	_In_ size_t maxsize,
-	_In_ bool forceSRGB,
-	ComPtr<ID3D12Resource>& texture,
-	ComPtr<ID3D12Resource>& textureUploadHeap)
+	_Out_ uint32_t& resDim,
+	_Out_ UINT& width,
+	_Out_ UINT& height,
+	_Out_ UINT& depth,
+	_Out_ size_t& mipCount,
+	_Out_ UINT& arraySize,
+	_Out_ DXGI_FORMAT& format,
+	_Out_ bool& isCubeMap)
 {
-	HRESULT hr = S_OK;
-
-	UINT width = header->width;
-	UINT height = header->height;
-	UINT depth = header->depth;
+	width = header->width;
+	height = header->height;
+	depth = header->depth;
 
-	uint32_t resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
-	UINT arraySize = 1;
-	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-	bool isCubeMap = false;
+	resDim = D3D12_RESOURCE_DIMENSION_UNKNOWN;
+	arraySize = 1;
+	format = DXGI_FORMAT_UNKNOWN;
+	isCubeMap = false;
 
-	size_t mipCount = header->mipMapCount;
+	mipCount = header->mipMapCount;
 	if (0 == mipCount) mipCount = 1;
 
 	if ((header->ddspf.flags & DDS_FOURCC) && (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
@@ -1835,6 +1894,29 @@ static HRESULT CreateTextureFromDDS12(
 		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 	}
 
+	return S_OK;
+}
+
+static HRESULT CreateTextureFromDDS12(
+	_In_ ID3D12Device* device,
+	_In_opt_ ID3D12GraphicsCommandList* cmdList,
+	_In_ const DDS_HEADER* header,
+	_In_reads_bytes_(bitSize) const uint8_t* bitData,
+	_In_ size_t bitSize,
+	_In_ size_t maxsize,
+	_In_ bool forceSRGB,
+	ComPtr<ID3D12Resource>& texture,
+	ComPtr<ID3D12Resource>& textureUploadHeap)
+{
+	uint32_t resDim;
+	UINT width, height, depth, arraySize;
+	size_t mipCount;
+	DXGI_FORMAT format;
+	bool isCubeMap;
+	HRESULT hr = GetTextureInfo12(header, resDim, width, height, depth, mipCount, arraySize, format, isCubeMap);
+	if (FAILED(hr))
+		return hr;
+
 	// Create the texture
 	std::unique_ptr<D3D12_SUBRESOURCE_DATA[]> initData(
 		new (std::nothrow) D3D12_SUBRESOURCE_DATA[mipCount * arraySize]
@@ -2160,12 +2242,17 @@ HRESULT DirectX::CreateDDSTextureFromFile12(_In_ ID3D12Device* device,
 		return E_INVALIDARG;
 	}
 
-	DDS_HEADER* header = nullptr;
-	uint8_t* bitData = nullptr;
-	size_t bitSize = 0;
+	// The file is mapped instead of read, so its data is copied only once (into the upload heap)
+	Speck::MemoryMappedFile ddsFile;
+	if (!ddsFile.Open(szFileName))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
 
-	std::unique_ptr<uint8_t[]> ddsData;
-	HRESULT hr = LoadTextureDataFromFile(szFileName, ddsData, &header, &bitData, &bitSize);
+	const DDS_HEADER* header = nullptr;
+	const uint8_t* bitData = nullptr;
+	size_t bitSize = 0;
+	HRESULT hr = GetTextureData(ddsFile.GetData(), (size_t)ddsFile.GetSize(), &header, &bitData, &bitSize);
 	if (FAILED(hr))
 	{
 		return hr;
@@ -2365,3 +2452,140 @@ HRESULT DirectX::CreateDDSTextureFromFileEx( ID3D11Device* d3dDevice,
 
     return hr;
 }
+
+//--------------------------------------------------------------------------------------
+// Copies the range of mips of every array item into a new upload heap and records the
+// copies to the texture, which has to be in the copy destination state.
+//--------------------------------------------------------------------------------------
+static HRESULT UploadMips12(
+	ID3D12Device* device,
+	ID3D12GraphicsCommandList* cmdList,
+	const Speck::DDSTextureLayout& layout,
+	size_t firstMip,
+	size_t mipCount,
+	ID3D12Resource* texture,
+	ComPtr<ID3D12Resource>& textureUploadHeap)
+{
+	// Every item has its own range of subresources in the upload heap
+	std::vector<UINT64> itemOffsets(layout.arraySize);
+	UINT64 uploadBufferSize = 0;
+	for (size_t j = 0; j < layout.arraySize; j++)
+	{
+		uploadBufferSize = (uploadBufferSize + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+		itemOffsets[j] = uploadBufferSize;
+		uploadBufferSize += GetRequiredIntermediateSize(texture, (UINT)(j * layout.mipCount + firstMip), (UINT)mipCount);
+	}
+
+	HRESULT hr = device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(&textureUploadHeap));
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	std::vector<D3D12_SUBRESOURCE_DATA> initData(mipCount);
+	for (size_t j = 0; j < layout.arraySize; j++)
+	{
+		for (size_t i = 0; i < mipCount; i++)
+		{
+			const Speck::DDSSubresource& subresource = layout.GetSubresource(j, firstMip + i);
+			initData[i].pData = subresource.data;
+			initData[i].RowPitch = (LONG_PTR)subresource.rowPitch;
+			initData[i].SlicePitch = (LONG_PTR)subresource.slicePitch;
+		}
+		UpdateSubresources(cmdList, texture, textureUploadHeap.Get(), itemOffsets[j], (UINT)(j * layout.mipCount + firstMip), (UINT)mipCount, initData.data());
+	}
+
+	return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::CreateDDSTextureFromLayout12(
+	ID3D12Device* device,
+	ID3D12GraphicsCommandList* cmdList,
+	const Speck::DDSTextureLayout& layout,
+	size_t firstMip,
+	ComPtr<ID3D12Resource>& texture,
+	ComPtr<ID3D12Resource>& textureUploadHeap)
+{
+	if (!device || !cmdList || firstMip >= layout.mipCount)
+	{
+		return E_INVALIDARG;
+	}
+
+	if (layout.dimension != Speck::DDSDimension::Texture2D)
+	{
+		return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+	}
+
+	// All the mips exist from the start, so the rest of them can be uploaded later
+	D3D12_RESOURCE_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D12_RESOURCE_DESC));
+	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	texDesc.Alignment = 0;
+	texDesc.Width = layout.width;
+	texDesc.Height = (uint32_t)layout.height;
+	texDesc.DepthOrArraySize = (uint16_t)layout.arraySize;
+	texDesc.MipLevels = (uint16_t)layout.mipCount;
+	texDesc.Format = layout.format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+	texDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	HRESULT hr = device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&texDesc,
+		D3D12_RESOURCE_STATE_COPY_DEST,
+		nullptr,
+		IID_PPV_ARGS(&texture)
+		);
+	if (FAILED(hr))
+	{
+		texture = nullptr;
+		return hr;
+	}
+
+	hr = UploadMips12(device, cmdList, layout, firstMip, layout.mipCount - firstMip, texture.Get(), textureUploadHeap);
+	if (FAILED(hr))
+	{
+		texture = nullptr;
+		return hr;
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture.Get(),
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::UploadDDSTextureMip12(
+	ID3D12Device* device,
+	ID3D12GraphicsCommandList* cmdList,
+	const Speck::DDSTextureLayout& layout,
+	size_t mip,
+	ID3D12Resource* texture,
+	ComPtr<ID3D12Resource>& textureUploadHeap)
+{
+	if (!device || !cmdList || !texture || mip >= layout.mipCount)
+	{
+		return E_INVALIDARG;
+	}
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture,
+		D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+
+	HRESULT hr = UploadMips12(device, cmdList, layout, mip, 1, texture, textureUploadHeap);
+
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texture,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+	return hr;
+}
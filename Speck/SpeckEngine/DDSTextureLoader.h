@@ -25,10 +25,12 @@
 #include <wrl.h>
 #include <d3d11_1.h>
 #include "d3dx12.h"
+#include "DDSTextureLayout.h"
 
 #pragma warning(push)
 #pragma warning(disable : 4005)
 #include <stdint.h>
+#include <vector>
 
 #pragma warning(pop)
 
@@ -92,6 +94,26 @@ namespace DirectX
 		                               _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr
 		                               );
 
+	// Creates a 2D texture with all of its mips, but uploads only the mips from firstMip on (the smallest ones).
+	// See Speck::DDSTextureLayout::Parse for the layout.
+	HRESULT CreateDDSTextureFromLayout12(_In_ ID3D12Device* device,
+		                                 _In_ ID3D12GraphicsCommandList* cmdList,
+		                                 _In_ const Speck::DDSTextureLayout& layout,
+		                                 _In_ size_t firstMip,
+		                                 _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& texture,
+		                                 _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap
+		                                 );
+
+	// Uploads one mip of every array item of a texture created by CreateDDSTextureFromLayout12.
+	// The texture has to be in the pixel shader resource state, the upload heap has to live until the copy is done.
+	HRESULT UploadDDSTextureMip12(_In_ ID3D12Device* device,
+		                          _In_ ID3D12GraphicsCommandList* cmdList,
+		                          _In_ const Speck::DDSTextureLayout& layout,
+		                          _In_ size_t mip,
+		                          _In_ ID3D12Resource* texture,
+		                          _Out_ Microsoft::WRL::ComPtr<ID3D12Resource>& textureUploadHeap
+		                          );
+
     // Standard version with optional auto-gen mipmap support
     HRESULT CreateDDSTextureFromMemory( _In_ ID3D11Device* d3dDevice,
                                         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -8,6 +8,7 @@
 #include <d3d12.h>
 #include <D3Dcompiler.h>
 #include "d3dx12.h"
+#include "MemoryTracker.h"
 #include <string>
 
 #define RELEASE_COM(com) if (com) { (com)->Release();  (com) = NULL; }
@@ -72,7 +73,8 @@ namespace Speck
 		return blob;
 	}
 
-	inline Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, const D3D12_RESOURCE_DESC &rd, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+	// The buffers are counted to the memory tag until they are destroyed, the default one as used or not.
+	inline Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, const D3D12_RESOURCE_DESC &rd, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer, MemoryTag tag, bool used = true)
 	{
 		Microsoft::WRL::ComPtr<ID3D12Resource> defaultBuffer;
 
@@ -95,6 +97,8 @@ namespace Speck
 			nullptr,
 			IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
 
+		MemoryTracker::TrackResource(defaultBuffer.Get(), tag, used);
+		MemoryTracker::TrackResource(uploadBuffer.Get(), tag);
 
 		// Describe the data we want to copy into the default buffer.
 		D3D12_SUBRESOURCE_DATA subResourceData = {};
@@ -118,10 +122,10 @@ namespace Speck
 		return defaultBuffer;
 	}
 
-	inline Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer)
+	inline Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, const void* initData, UINT64 byteSize, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer, MemoryTag tag)
 	{
 		D3D12_RESOURCE_DESC rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
-		return CreateDefaultBuffer(device, cmdList, initData, byteSize, rd, uploadBuffer);
+		return CreateDefaultBuffer(device, cmdList, initData, byteSize, rd, uploadBuffer, tag);
 	}
 
 	struct ComputeShaderThreadGroups
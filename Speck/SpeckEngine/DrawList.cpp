@@ -0,0 +1,57 @@
+#include "DrawList.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+UINT64 DrawList::MakeKey(UINT psoIndex, UINT materialIndex, UINT geometryIndex, float depth)
+{
+	UINT64 maxDepth = (1ULL << DepthBits) - 1;
+	UINT64 quantizedDepth = (UINT64)(min(max(depth, 0.0f), 1.0f) * maxDepth);
+	UINT64 key = (UINT64)(psoIndex & ((1U << PSOBits) - 1));
+	key = (key << MaterialBits) | (materialIndex & ((1U << MaterialBits) - 1));
+	key = (key << GeometryBits) | (geometryIndex & ((1U << GeometryBits) - 1));
+	key = (key << DepthBits) | quantizedDepth;
+	return key;
+}
+
+void DrawList::Sort()
+{
+	size_t count = mKeys.size();
+	if (count < 2)
+		return;
+	mSortedKeys.resize(count);
+	mSortedItems.resize(count);
+
+	// Histograms of all the bytes in one pass over the keys
+	UINT histograms[8][256] = {};
+	for (UINT64 key : mKeys)
+	{
+		for (int b = 0; b < 8; ++b)
+			++histograms[b][(key >> (8 * b)) & 0xFF];
+	}
+
+	// One pass per byte, from the least significant one. The bytes that are the same in all the keys are skipped.
+	for (int b = 0; b < 8; ++b)
+	{
+		UINT *histogram = histograms[b];
+		if (histogram[(mKeys[0] >> (8 * b)) & 0xFF] == count)
+			continue;
+
+		UINT offset = 0;
+		for (int i = 0; i < 256; ++i)
+		{
+			UINT bucketSize = histogram[i];
+			histogram[i] = offset;
+			offset += bucketSize;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			UINT target = histogram[(mKeys[i] >> (8 * b)) & 0xFF]++;
+			mSortedKeys[target] = mKeys[i];
+			mSortedItems[target] = mItems[i];
+		}
+		mKeys.swap(mSortedKeys);
+		mItems.swap(mSortedItems);
+	}
+}
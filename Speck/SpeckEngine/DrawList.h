@@ -0,0 +1,45 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include "SpeckEngineDefinitions.h"
+#include "RenderItem.h"
+
+namespace Speck
+{
+	//-------------------------------------------------------------------------------------
+	//	Render items to draw in a frame, each with a 64 bit key made of its PSO, material,
+	//	geometry and depth, from the most to the least significant bits. Sorting by the
+	//	keys puts the items that share the state next to each other and the ones with the
+	//	same state from the front to the back. The keys are radix sorted a byte at a time.
+	//-------------------------------------------------------------------------------------
+	class DrawList
+	{
+	public:
+		static const UINT PSOBits = 8;
+		static const UINT MaterialBits = 16;
+		static const UINT GeometryBits = 16;
+		static const UINT DepthBits = 24;
+
+		// The indices are cut to their bits, depth is clamped to [0, 1].
+		DLL_EXPORT static UINT64 MakeKey(UINT psoIndex, UINT materialIndex, UINT geometryIndex, float depth);
+		static UINT GetPSOIndex(UINT64 key) { return (UINT)(key >> (MaterialBits + GeometryBits + DepthBits)); }
+
+		void Clear() { mKeys.clear(); mItems.clear(); }
+		void Add(UINT64 key, RenderItemHandle item) { mKeys.push_back(key); mItems.push_back(item); }
+		// Stable, the items with the same key keep their order.
+		DLL_EXPORT void Sort();
+
+		size_t GetCount() const { return mKeys.size(); }
+		UINT64 GetKey(size_t i) const { return mKeys[i]; }
+		RenderItemHandle GetItem(size_t i) const { return mItems[i]; }
+
+	private:
+		std::vector<UINT64> mKeys;
+		std::vector<RenderItemHandle> mItems;
+		// Targets of the sorting passes.
+		std::vector<UINT64> mSortedKeys;
+		std::vector<RenderItemHandle> mSortedItems;
+	};
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include "Timer.h"
 #include "ProcessAndSystemData.h"
 #include "DirectXCore.h"
+#include "WorkerPool.h"
+#include "MetricsSampler.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -15,9 +17,11 @@ EngineCore::EngineCore()
 { 
 	mDefaultCamera			= make_unique<Camera>(*this);
 	mProcessAndSystemData	= make_unique<ProcessAndSystemData>();
+	mMetricsSampler			= make_unique<MetricsSampler>();
 	mTimer					= make_unique<Timer>();
 	mInputHandler			= make_unique<InputHandler>();
 	mDirectXCore			= make_unique<DirectXCore>();
+	mWorkerPool			= make_unique<WorkerPool>();
 
 	mCamera = mDefaultCamera.get();
 }
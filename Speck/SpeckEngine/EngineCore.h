@@ -18,11 +18,14 @@ namespace Speck
 	class CameraController;
 	class InputHandler;
 	class DirectXCore;
+	class WorkerPool;
+	class MetricsSampler;
 
 	struct ProcessAndSystemData;
 	namespace AppCommands
 	{
 		struct LimitFrameTimeCommand;
+		struct GetFramePacingStatsCommand;
 		struct UpdateCameraCommand;
 		struct LoadResourceCommand;
 		struct CreateMaterialCommand;
@@ -45,6 +48,7 @@ namespace Speck
 		friend struct RenderItem;
 
 		friend struct AppCommands::LimitFrameTimeCommand;
+		friend struct AppCommands::GetFramePacingStatsCommand;
 		friend struct AppCommands::UpdateCameraCommand;
 		friend struct AppCommands::LoadResourceCommand;
 		friend struct AppCommands::CreateMaterialCommand;
@@ -71,6 +75,8 @@ namespace Speck
 		DLL_EXPORT int GetClientWidth() const;
 		DLL_EXPORT float GetAspectRatio() const;
 		DirectXCore const &GetDirectXCore() const { return *mDirectXCore.get(); };
+		WorkerPool *GetWorkerPool() { return mWorkerPool.get(); }
+		MetricsSampler *GetMetricsSampler() { return mMetricsSampler.get(); }
 
 	private:
 		//
@@ -93,12 +99,16 @@ namespace Speck
 		std::unique_ptr<Camera> mDefaultCamera;
 		// Information about process and system.
 		std::unique_ptr<ProcessAndSystemData> mProcessAndSystemData;
+		// History of the process metrics, sampled every frame.
+		std::unique_ptr<MetricsSampler> mMetricsSampler;
 		// Used to keep track of the delta-time and game time (4.4).
 		std::unique_ptr<Timer> mTimer;
 		// Input stuff
 		std::unique_ptr<InputHandler> mInputHandler;
 		// All the DirectX stuff goes here
 		std::unique_ptr<DirectXCore> mDirectXCore;
+		// Threads for CPU work that can be split into independent tasks
+		std::unique_ptr<WorkerPool> mWorkerPool;
 	};
 }
 
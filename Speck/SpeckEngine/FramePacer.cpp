@@ -0,0 +1,158 @@
+#include "FramePacer.h"
+#include <thread>
+#include <limits>
+#ifdef _WIN32
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	// Ends of the histogram buckets, in microseconds.
+	const double gHistogramBucketEnds[FramePacingStats::HistogramBucketCount - 1] = { 10.0, 25.0, 50.0, 100.0, 250.0, 500.0, 1000.0, 2000.0, 5000.0 };
+
+	// Limits of the spinning part of a wait, in seconds.
+	const double gMinSpinThreshold = 50e-6;
+	const double gMaxSpinThreshold = 4e-3;
+	// Weight of the newest sleep in the overshoot averages.
+	const double gOvershootWeight = 0.1;
+}
+
+#ifdef _WIN32
+struct FramePacer::PlatformData
+{
+	// Waitable timers can be created with a high resolution since Windows 10 1803
+	HANDLE Timer = NULL;
+	bool RaisedTimerResolution = false;
+};
+
+void FramePacer::SleepFor(Clock::duration duration)
+{
+	if (mPlatformData->Timer)
+	{
+		// Negative due times are relative, in 100 ns units
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(LONGLONG)(chrono::duration_cast<chrono::nanoseconds>(duration).count() / 100);
+		if (SetWaitableTimer(mPlatformData->Timer, &dueTime, 0, NULL, NULL, FALSE))
+		{
+			WaitForSingleObject(mPlatformData->Timer, INFINITE);
+			return;
+		}
+	}
+	this_thread::sleep_for(duration);
+}
+#else
+struct FramePacer::PlatformData
+{
+};
+
+void FramePacer::SleepFor(Clock::duration duration)
+{
+	this_thread::sleep_for(duration);
+}
+#endif
+
+FramePacer::FramePacer()
+	: mPlatformData(make_unique<PlatformData>()),
+	mOvershootMean(0.5e-3),
+	mOvershootVariance(0.0)
+{
+#ifdef _WIN32
+	mPlatformData->Timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!mPlatformData->Timer)
+	{
+		// Older systems sleep with the resolution of the system timer, which is 15.6 ms by default
+		mPlatformData->RaisedTimerResolution = timeBeginPeriod(1) == TIMERR_NOERROR;
+	}
+#endif
+	ClearStats();
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+	if (mPlatformData->Timer)
+		CloseHandle(mPlatformData->Timer);
+	if (mPlatformData->RaisedTimerResolution)
+		timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::Wait(double seconds)
+{
+	Clock::time_point start = Clock::now();
+	Clock::time_point deadline = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(seconds));
+
+	// Sleep while the time left is longer than a sleep might overshoot by
+	Clock::time_point now = start;
+	while (deadline - now > GetSpinThreshold())
+	{
+		Clock::duration sleepTime = deadline - now - GetSpinThreshold();
+		SleepFor(sleepTime);
+		Clock::time_point woken = Clock::now();
+
+		double overshoot = chrono::duration<double>(woken - now - sleepTime).count();
+		double difference = overshoot - mOvershootMean;
+		mOvershootMean += gOvershootWeight * difference;
+		mOvershootVariance = (1.0 - gOvershootWeight) * (mOvershootVariance + gOvershootWeight * difference * difference);
+		now = woken;
+	}
+
+	// Spin for the rest
+	Clock::time_point spinStart = now;
+	while (now < deadline)
+		now = Clock::now();
+
+	double error = chrono::duration<double, micro>(now - deadline).count();
+	UINT bucket = 0;
+	while (bucket < FramePacingStats::HistogramBucketCount - 1 && error > gHistogramBucketEnds[bucket])
+		++bucket;
+	++mHistogram[bucket];
+	++mWaits;
+	mErrorSum += error;
+	mMaxError = max(mMaxError, error);
+	mSleepTime += chrono::duration<double>(spinStart - start).count();
+	mSpinTime += chrono::duration<double>(now - spinStart).count();
+}
+
+void FramePacer::GetStats(FramePacingStats *outStats) const
+{
+	outStats->Waits = mWaits;
+	outStats->MeanError = (mWaits > 0) ? mErrorSum / mWaits : 0.0;
+	outStats->MaxError = mMaxError;
+	outStats->SleepTime = mSleepTime;
+	outStats->SpinTime = mSpinTime;
+	outStats->SpinThreshold = chrono::duration<double, micro>(GetSpinThreshold()).count();
+	for (UINT i = 0; i < FramePacingStats::HistogramBucketCount; ++i)
+		outStats->Histogram[i] = mHistogram[i];
+}
+
+void FramePacer::ClearStats()
+{
+	mWaits = 0;
+	mErrorSum = 0.0;
+	mMaxError = 0.0;
+	mSleepTime = 0.0;
+	mSpinTime = 0.0;
+	for (UINT i = 0; i < FramePacingStats::HistogramBucketCount; ++i)
+		mHistogram[i] = 0;
+}
+
+double FramePacer::GetHistogramBucketEnd(UINT bucket)
+{
+	return (bucket < FramePacingStats::HistogramBucketCount - 1) ? gHistogramBucketEnds[bucket] : numeric_limits<double>::infinity();
+}
+
+FramePacer::Clock::duration FramePacer::GetSpinThreshold() const
+{
+	// Most sleeps overshoot by less than this
+	double threshold = mOvershootMean + 2.0 * sqrt(mOvershootVariance);
+	threshold = min(max(threshold, gMinSpinThreshold), gMaxSpinThreshold);
+	return chrono::duration_cast<Clock::duration>(chrono::duration<double>(threshold));
+}
@@ -0,0 +1,72 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include "SpeckEngineDefinitions.h"
+#include <chrono>
+
+namespace Speck
+{
+	// How well the waits met their deadlines since the stats were cleared.
+	struct FramePacingStats
+	{
+		static const UINT HistogramBucketCount = 10;
+
+		UINT64 Waits;
+		// How late the waits ended, in microseconds.
+		double MeanError;
+		double MaxError;
+		// In seconds, only the spinning keeps a core busy.
+		double SleepTime;
+		double SpinTime;
+		// Time left to the deadline that is spun instead of slept, in microseconds.
+		double SpinThreshold;
+		// Waits by their error, see FramePacer::GetHistogramBucketEnd.
+		UINT64 Histogram[HistogramBucketCount];
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Waits for the rest of a frame without keeping a core busy. It sleeps while the
+	//	time left is longer than the sleeps tend to overshoot by, and spins only for the
+	//	remainder. The overshoot is measured on every sleep, so the spin stays short on
+	//	systems with precise sleeps and grows where they are coarse.
+	//-------------------------------------------------------------------------------------
+	class FramePacer
+	{
+	public:
+		DLL_EXPORT FramePacer();
+		DLL_EXPORT ~FramePacer();
+		// Make these inaccessible.
+		FramePacer(const FramePacer &pacer) = delete;
+		FramePacer &operator=(const FramePacer &pacer) = delete;
+
+		// Returns once the given number of seconds has passed.
+		DLL_EXPORT void Wait(double seconds);
+
+		DLL_EXPORT void GetStats(FramePacingStats *outStats) const;
+		DLL_EXPORT void ClearStats();
+		// Largest error of the waits in the histogram bucket, in microseconds. The last bucket has no end.
+		DLL_EXPORT static double GetHistogramBucketEnd(UINT bucket);
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+		// System handles, if the platform needs any.
+		struct PlatformData;
+
+		void SleepFor(Clock::duration duration);
+		Clock::duration GetSpinThreshold() const;
+
+		std::unique_ptr<PlatformData> mPlatformData;
+		// Moving average and variance of how much longer the sleeps took than asked, in seconds.
+		double mOvershootMean;
+		double mOvershootVariance;
+
+		UINT64 mWaits;
+		double mErrorSum;
+		double mMaxError;
+		double mSleepTime;
+		double mSpinTime;
+		UINT64 mHistogram[FramePacingStats::HistogramBucketCount];
+	};
+}
+
+#endif
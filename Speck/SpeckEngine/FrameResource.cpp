@@ -11,10 +11,12 @@ FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT maxRende
         D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
-    PassCB											= make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-	SSAODataBuffer									= make_unique<UploadBuffer<SSAOData>>(device, 1, false);
-	MaterialBuffer									= make_unique<UploadBuffer<MaterialBufferData>>(device, materialCount, false);
-	RenderItemConstantsBuffer						= make_unique<UploadBuffer<RenderItemConstants>>(device, maxRenderItemsCount, true);
+    PassCB											= make_unique<UploadBuffer<PassConstants>>(device, passCount, true, MemoryTag::FrameResources);
+	SSAODataBuffer									= make_unique<UploadBuffer<SSAOData>>(device, 1, false, MemoryTag::FrameResources);
+	MaterialBuffer									= make_unique<UploadBuffer<MaterialBufferData>>(device, materialCount, false, MemoryTag::FrameResources);
+	RenderItemConstantsBuffer						= make_unique<UploadBuffer<RenderItemConstants>>(device, maxRenderItemsCount, true, MemoryTag::FrameResources);
+	StaticInstanceBuffer							= make_unique<UploadBuffer<StaticInstanceData>>(device, maxRenderItemsCount, false, MemoryTag::FrameResources);
+	StaticInstanceIndexBuffer						= make_unique<UploadBuffer<UINT>>(device, maxRenderItemsCount, false, MemoryTag::FrameResources);
 }
 
 FrameResource::~FrameResource()
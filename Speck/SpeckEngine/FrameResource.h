@@ -27,6 +27,14 @@ namespace Speck
 		UINT4 Param[RENDER_ITEM_SPECIAL_PARAM_N];
 	};
 
+	// Transforms of a static render item for the instanced draws.
+	struct StaticInstanceData
+	{
+		DirectX::XMFLOAT4X4 Transform = MathHelper::Identity4x4();
+		DirectX::XMFLOAT4X4 InvTransposeTransform = MathHelper::Identity4x4();
+		DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+	};
+
 	struct PassConstants
 	{
 		DirectX::XMFLOAT4X4 View = MathHelper::Identity4x4();
@@ -55,6 +63,11 @@ namespace Speck
 			FresnelR0 = tMat->FresnelR0;
 			Roughness = tMat->Roughness;
 			XMStoreFloat4x4(&TexTransform, XMMatrixTranspose(matTransform));
+			for (int i = 0; i < MATERIAL_TEXTURES_COUNT; ++i)
+			{
+				if (tMat->Textures[i])
+					MinLod = max(MinLod, (float)tMat->Textures[i]->ResidentMip);
+			}
 		}
 
 		DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -63,6 +76,10 @@ namespace Speck
 
 		// Used in texture mapping.
 		DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+		// Mips that are not streamed in yet are not sampled.
+		float MinLod = 0.0f;
+		DirectX::XMFLOAT3 Pad0;
 	};
 
 	struct SSAOData
@@ -91,10 +108,10 @@ namespace Speck
 	{
 	public:
 
-		FrameResource(ID3D12Device* device, UINT passCount, UINT maxRenderItemsCount, UINT materialCount);
+		DLL_EXPORT FrameResource(ID3D12Device* device, UINT passCount, UINT maxRenderItemsCount, UINT materialCount);
 		FrameResource(const FrameResource& rhs) = delete;
 		FrameResource& operator=(const FrameResource& rhs) = delete;
-		~FrameResource();
+		DLL_EXPORT ~FrameResource();
 
 		// We cannot reset the allocator until the GPU is done processing the commands.
 		// So each frame needs their own allocator.
@@ -106,6 +123,10 @@ namespace Speck
 		std::unique_ptr<UploadBuffer<SSAOData>> SSAODataBuffer = nullptr;
 		std::unique_ptr<UploadBuffer<MaterialBufferData>> MaterialBuffer = nullptr;
 		std::unique_ptr<UploadBuffer<RenderItemConstants>> RenderItemConstantsBuffer = nullptr;
+		// Indexed by the render item buffer indices of the static items.
+		std::unique_ptr<UploadBuffer<StaticInstanceData>> StaticInstanceBuffer = nullptr;
+		// Static items drawn instanced in the frame.
+		std::unique_ptr<UploadBuffer<UINT>> StaticInstanceIndexBuffer = nullptr;
 
 		// Array of abstract buffers for general purpose.
 		std::vector<std::unique_ptr<UploadBufferBase>> UploadBuffers;
@@ -0,0 +1,104 @@
+#include "FrustumCuller.h"
+#include <cfloat>
+#include <xmmintrin.h>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+void FrustumCuller::Resize(UINT count)
+{
+	UINT first = mCount;
+	UINT paddedCount = (count + 3) & ~3U;
+	mCenterX.resize(paddedCount);
+	mCenterY.resize(paddedCount);
+	mCenterZ.resize(paddedCount);
+	mExtentX.resize(paddedCount);
+	mExtentY.resize(paddedCount);
+	mExtentZ.resize(paddedCount);
+	mCount = count;
+	for (UINT i = first; i < paddedCount; ++i)
+		SetAlwaysVisible(i);
+}
+
+void FrustumCuller::SetBounds(UINT index, const BoundingBox &worldBounds)
+{
+	mCenterX[index] = worldBounds.Center.x;
+	mCenterY[index] = worldBounds.Center.y;
+	mCenterZ[index] = worldBounds.Center.z;
+	mExtentX[index] = worldBounds.Extents.x;
+	mExtentY[index] = worldBounds.Extents.y;
+	mExtentZ[index] = worldBounds.Extents.z;
+}
+
+void FrustumCuller::SetAlwaysVisible(UINT index)
+{
+	// No plane is far enough from a box this big
+	mCenterX[index] = 0.0f;
+	mCenterY[index] = 0.0f;
+	mCenterZ[index] = 0.0f;
+	mExtentX[index] = FLT_MAX;
+	mExtentY[index] = FLT_MAX;
+	mExtentZ[index] = FLT_MAX;
+}
+
+bool FrustumCuller::GetBounds(UINT index, BoundingBox *outWorldBounds) const
+{
+	if (mExtentX[index] == FLT_MAX)
+		return false;
+	outWorldBounds->Center = XMFLOAT3(mCenterX[index], mCenterY[index], mCenterZ[index]);
+	outWorldBounds->Extents = XMFLOAT3(mExtentX[index], mExtentY[index], mExtentZ[index]);
+	return true;
+}
+
+void FrustumCuller::Cull(const BoundingFrustum &worldFrustum, vector<UINT> *outVisible) const
+{
+	outVisible->clear();
+
+	// The normals of the planes point out of the frustum
+	XMVECTOR planeVectors[6];
+	worldFrustum.GetPlanes(&planeVectors[0], &planeVectors[1], &planeVectors[2], &planeVectors[3], &planeVectors[4], &planeVectors[5]);
+	__m128 normalX[6], normalY[6], normalZ[6], distance[6], absNormalX[6], absNormalY[6], absNormalZ[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		XMFLOAT4 plane;
+		XMStoreFloat4(&plane, planeVectors[p]);
+		normalX[p] = _mm_set1_ps(plane.x);
+		normalY[p] = _mm_set1_ps(plane.y);
+		normalZ[p] = _mm_set1_ps(plane.z);
+		distance[p] = _mm_set1_ps(plane.w);
+		absNormalX[p] = _mm_set1_ps(fabsf(plane.x));
+		absNormalY[p] = _mm_set1_ps(fabsf(plane.y));
+		absNormalZ[p] = _mm_set1_ps(fabsf(plane.z));
+	}
+
+	for (UINT i = 0; i < mCount; i += 4)
+	{
+		__m128 centerX = _mm_loadu_ps(&mCenterX[i]);
+		__m128 centerY = _mm_loadu_ps(&mCenterY[i]);
+		__m128 centerZ = _mm_loadu_ps(&mCenterZ[i]);
+		__m128 extentX = _mm_loadu_ps(&mExtentX[i]);
+		__m128 extentY = _mm_loadu_ps(&mExtentY[i]);
+		__m128 extentZ = _mm_loadu_ps(&mExtentZ[i]);
+
+		// A box is outside if its center is further in front of a plane than the box reaches towards it
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 centerDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[p], centerX), _mm_mul_ps(normalY[p], centerY)),
+				_mm_add_ps(_mm_mul_ps(normalZ[p], centerZ), distance[p]));
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[p], extentX), _mm_mul_ps(absNormalY[p], extentY)),
+				_mm_mul_ps(absNormalZ[p], extentZ));
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(centerDistance, reach));
+		}
+
+		int visibleMask = ~_mm_movemask_ps(outside) & 0xF;
+		if (visibleMask == 0)
+			continue;
+		for (UINT k = 0; visibleMask != 0; ++k, visibleMask >>= 1)
+		{
+			if ((visibleMask & 1) && i + k < mCount)
+				outVisible->push_back(i + k);
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "DirectXHeaders.h"
+
+namespace Speck
+{
+	//-------------------------------------------------------------------------------------
+	//	World space bounding boxes of a list of items, stored as separate arrays of the
+	//	centers and the extents so that four of them are tested against the frustum
+	//	planes at once. The items whose bounds are not known are never culled.
+	//-------------------------------------------------------------------------------------
+	class FrustumCuller
+	{
+	public:
+		UINT GetCount() const { return mCount; }
+		// New items are never culled until their bounds are set.
+		DLL_EXPORT void Resize(UINT count);
+		DLL_EXPORT void SetBounds(UINT index, const DirectX::BoundingBox &worldBounds);
+		DLL_EXPORT void SetAlwaysVisible(UINT index);
+		// Returns false if the bounds of the item are not known.
+		DLL_EXPORT bool GetBounds(UINT index, DirectX::BoundingBox *outWorldBounds) const;
+
+		// Outputs the indices of the items that intersect the frustum (in world space), in increasing order.
+		DLL_EXPORT void Cull(const DirectX::BoundingFrustum &worldFrustum, std::vector<UINT> *outVisible) const;
+
+	private:
+		// Padded to a multiple of four.
+		std::vector<float> mCenterX, mCenterY, mCenterZ;
+		std::vector<float> mExtentX, mExtentY, mExtentZ;
+		UINT mCount = 0;
+	};
+}
+
+#endif
@@ -8,6 +8,35 @@
 
 namespace Speck
 {
+	// Simplified version of a submesh, drawn with the same vertices.
+	struct SubmeshLOD
+	{
+		UINT IndexCount = 0;
+		UINT StartIndexLocation = 0;
+		// Largest distance from the full mesh, in the units of the mesh.
+		float Error = 0.0f;
+	};
+
+	// Range of an index buffer drawn with one call.
+	struct IndexRange
+	{
+		UINT IndexCount = 0;
+		UINT StartIndexLocation = 0;
+	};
+
+	// Cluster of consecutive triangles of a submesh, StartIndexLocation is relative to the submesh.
+	struct Meshlet
+	{
+		UINT IndexCount = 0;
+		UINT StartIndexLocation = 0;
+		DirectX::BoundingSphere Bounds;
+		// Cone of the triangle normals, the cameras that look at the apex from within the cone see only
+		// the back faces. The cutoff is the sine of the cone angle, 1 if the cluster is never culled.
+		DirectX::XMFLOAT3 ConeApex = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 0.0f };
+		float ConeCutoff = 1.0f;
+	};
+
 	// Defines a subrange of geometry in a MeshGeometry.  This is for when multiple
 	// geometries are stored in one vertex and index buffer.  It provides the offsets
 	// and data needed to draw a subset of geometry stores in the vertex and index 
@@ -21,6 +50,11 @@ namespace Speck
 		// Bounding box of the geometry defined by this submesh. 
 		// This is used in later chapters of the book.
 		DirectX::BoundingBox Bounds;
+
+		// Levels of detail, the first one is the full submesh. Empty if the submesh has none.
+		std::vector<SubmeshLOD> LODs;
+		// Clusters of the full submesh for the culling. Empty if the submesh has none.
+		std::vector<Meshlet> Meshlets;
 	};
 
 	struct MeshGeometry
@@ -73,6 +107,15 @@ namespace Speck
 			VertexBufferUploader = nullptr;
 			IndexBufferUploader = nullptr;
 		}
+
+		// Counts the system memory copies, once they are made.
+		void TrackCPUMemory()
+		{
+			UINT64 size = (VertexBufferCPU ? VertexBufferCPU->GetBufferSize() : 0) + (IndexBufferCPU ? IndexBufferCPU->GetBufferSize() : 0);
+			CPUMemory.Set(size, size);
+		}
+
+		MemoryAllocation CPUMemory{ MemoryTag::Geometry };
 	};
 
 	struct Light
@@ -92,6 +135,10 @@ namespace Speck
 
 		// Texture resource with the loaded image data.
 		Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
+		// Most detailed mip with the image data, the more detailed ones are still streaming in.
+		UINT ResidentMip = 0;
+		// Image data of the resident mips. The resource has all the mips from the start, it is counted as reserved.
+		MemoryAllocation ResidentMemory{ MemoryTag::Textures };
 		// Texture resource that was used as an upload heap to copy 
 		// the image data into the default heap texture resource.
 		Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
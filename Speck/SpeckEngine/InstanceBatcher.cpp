@@ -0,0 +1,73 @@
+#include "InstanceBatcher.h"
+
+using namespace std;
+using namespace Speck;
+
+UINT InstanceBatcher::Assign(UINT item, const InstanceBatchKey &key, bool *isNewBatch)
+{
+	auto inserted = mBatches.insert(make_pair(key, (UINT)mBatchMemberCounts.size()));
+	UINT batch = inserted.first->second;
+	if (inserted.second)
+		mBatchMemberCounts.push_back(0);
+	if (isNewBatch)
+		*isNewBatch = inserted.second;
+
+	if (item >= mItemBatches.size())
+		mItemBatches.resize(item + 1, (UINT)NoBatch);
+	UINT oldBatch = mItemBatches[item];
+	if (oldBatch == batch)
+		return batch;
+
+	// Only the batches of this item change, the empty ones are kept for the items to come
+	if (oldBatch != NoBatch)
+		--mBatchMemberCounts[oldBatch];
+	++mBatchMemberCounts[batch];
+	mItemBatches[item] = batch;
+	return batch;
+}
+
+void InstanceBatcher::Begin()
+{
+	mVisibleItems.clear();
+}
+
+void InstanceBatcher::End()
+{
+	mRanges.clear();
+	mInstances.clear();
+	mSingles.clear();
+
+	// Count the visible items of each batch
+	mVisibleCounts.assign(mBatchMemberCounts.size(), 0);
+	for (UINT item : mVisibleItems)
+		++mVisibleCounts[mItemBatches[item]];
+
+	// Give the instanced batches their ranges, the counts become the offsets where their items are written next
+	UINT instanceCount = 0;
+	for (UINT batch = 0; batch < (UINT)mVisibleCounts.size(); ++batch)
+	{
+		UINT count = mVisibleCounts[batch];
+		if (count < MinInstances)
+		{
+			mVisibleCounts[batch] = NoBatch;
+			continue;
+		}
+		InstanceRange range;
+		range.Batch = batch;
+		range.FirstInstance = instanceCount;
+		range.InstanceCount = count;
+		mRanges.push_back(range);
+		mVisibleCounts[batch] = instanceCount;
+		instanceCount += count;
+	}
+
+	mInstances.resize(instanceCount);
+	for (UINT item : mVisibleItems)
+	{
+		UINT &offset = mVisibleCounts[mItemBatches[item]];
+		if (offset == NoBatch)
+			mSingles.push_back(item);
+		else
+			mInstances[offset++] = item;
+	}
+}
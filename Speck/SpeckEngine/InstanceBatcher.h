@@ -0,0 +1,92 @@
+#ifndef INSTANCE_BATCHER_H
+#define INSTANCE_BATCHER_H
+
+#include "SpeckEngineDefinitions.h"
+
+namespace Speck
+{
+	// What the items drawn by the same instanced draw have to share.
+	struct InstanceBatchKey
+	{
+		const void *Group = nullptr;
+		const void *Geometry = nullptr;
+		const void *Material = nullptr;
+		// Start of the full level of detail of the submesh.
+		UINT StartIndexLocation = 0;
+		int BaseVertexLocation = 0;
+
+		bool operator==(const InstanceBatchKey &other) const
+		{
+			return Group == other.Group && Geometry == other.Geometry && Material == other.Material &&
+				StartIndexLocation == other.StartIndexLocation && BaseVertexLocation == other.BaseVertexLocation;
+		}
+	};
+
+	// Visible members of a batch, in the instances of the frame.
+	struct InstanceRange
+	{
+		UINT Batch;
+		UINT FirstInstance;
+		UINT InstanceCount;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Groups the items with the same key into batches. The batch of an item is kept
+	//	between the frames and changed only when its key changes. Each frame the visible
+	//	items are gathered by their batches, the batches with enough of them are drawn as
+	//	one instanced draw and the rest are drawn one by one.
+	//-------------------------------------------------------------------------------------
+	class InstanceBatcher
+	{
+	public:
+		// Fewer visible members than this are not worth an instanced draw.
+		static const UINT MinInstances = 2;
+		static const UINT NoBatch = (UINT)-1;
+
+		// Puts the item into the batch of the key, creating it if there is none yet. Call it again after the key
+		// of the item changed. Returns the batch, set isNewBatch to know if it was created.
+		DLL_EXPORT UINT Assign(UINT item, const InstanceBatchKey &key, bool *isNewBatch = nullptr);
+		UINT GetBatch(UINT item) const { return item < mItemBatches.size() ? mItemBatches[item] : NoBatch; }
+		UINT GetBatchCount() const { return (UINT)mBatchMemberCounts.size(); }
+		// Number of the items in the batch, visible or not.
+		UINT GetMemberCount(UINT batch) const { return mBatchMemberCounts[batch]; }
+
+		// Gathering of the visible items, the items without a batch are not accepted.
+		DLL_EXPORT void Begin();
+		bool Add(UINT item) { if (GetBatch(item) == NoBatch) return false; mVisibleItems.push_back(item); return true; }
+		// Sorts the visible items by their batches, in the order they were added within each batch.
+		DLL_EXPORT void End();
+
+		// Batches to draw instanced, with the ranges of their items in the instances.
+		const std::vector<InstanceRange> &GetRanges() const { return mRanges; }
+		const std::vector<UINT> &GetInstances() const { return mInstances; }
+		// Items of the batches with too few visible members.
+		const std::vector<UINT> &GetSingles() const { return mSingles; }
+
+	private:
+		struct KeyHasher
+		{
+			size_t operator()(const InstanceBatchKey &key) const
+			{
+				size_t h = std::hash<const void *>()(key.Geometry);
+				h = h * 31 + std::hash<const void *>()(key.Material);
+				h = h * 31 + std::hash<const void *>()(key.Group);
+				h = h * 31 + key.StartIndexLocation;
+				return h * 31 + (size_t)key.BaseVertexLocation;
+			}
+		};
+
+		std::unordered_map<InstanceBatchKey, UINT, KeyHasher> mBatches;
+		std::vector<UINT> mBatchMemberCounts;
+		std::vector<UINT> mItemBatches;
+
+		// Gathered in the frame
+		std::vector<UINT> mVisibleItems;
+		std::vector<UINT> mVisibleCounts;
+		std::vector<InstanceRange> mRanges;
+		std::vector<UINT> mInstances;
+		std::vector<UINT> mSingles;
+	};
+}
+
+#endif
@@ -7,6 +7,8 @@
 
 namespace Speck
 {
+	struct Texture;
+
 	struct Material
 	{
 		Material() = default;
@@ -38,6 +40,9 @@ namespace Speck
 
 		// Used in texture mapping.
 		DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+		// Textures in the SRV heap (nullptr for the default ones), for the resident mips.
+		Texture *Textures[MATERIAL_TEXTURES_COUNT] = {};
 	};
 }
 
@@ -0,0 +1,75 @@
+#include "MemoryMappedFile.h"
+
+using namespace std;
+using namespace Speck;
+
+MemoryMappedFile::MemoryMappedFile()
+	: mFile(INVALID_HANDLE_VALUE)
+	, mMapping(nullptr)
+	, mData(nullptr)
+	, mSize(0)
+{
+
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+bool MemoryMappedFile::Open(const wchar_t *filePath)
+{
+	Close();
+
+	// Open the file
+	mFile = CreateFileW(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		LOG(TEXT("Could not open file: ") + wstring(filePath), WARNING);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	mSize = (uint64_t)fileSize.QuadPart;
+
+	// Map the whole file
+	mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mMapping)
+	{
+		Close();
+		return false;
+	}
+	mData = static_cast<const uint8_t *>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mData)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+		mData = nullptr;
+	}
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+		mMapping = nullptr;
+	}
+	if (mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+	}
+	mSize = 0;
+}
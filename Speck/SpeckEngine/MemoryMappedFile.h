@@ -0,0 +1,37 @@
+#ifndef MEMORY_MAPPED_FILE_H
+#define MEMORY_MAPPED_FILE_H
+
+#include "SpeckEngineDefinitions.h"
+
+namespace Speck
+{
+	//-------------------------------------------------------------------------------------
+	//	Read-only view of a whole file mapped into the address space of the process.
+	//	Pages are loaded by the OS on first access, nothing is copied.
+	//-------------------------------------------------------------------------------------
+	class MemoryMappedFile
+	{
+	public:
+		DLL_EXPORT MemoryMappedFile();
+		DLL_EXPORT ~MemoryMappedFile();
+		// Make these inaccessible.
+		MemoryMappedFile(const MemoryMappedFile &file) = delete;
+		MemoryMappedFile &operator=(const MemoryMappedFile &file) = delete;
+
+		// Returns false if the file could not be opened or mapped (empty files can not be mapped).
+		DLL_EXPORT bool Open(const wchar_t *filePath);
+		DLL_EXPORT void Close();
+
+		bool IsOpen() const { return mData != nullptr; }
+		const uint8_t *GetData() const { return mData; }
+		uint64_t GetSize() const { return mSize; }
+
+	private:
+		HANDLE mFile;
+		HANDLE mMapping;
+		const uint8_t *mData;
+		uint64_t mSize;
+	};
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <iomanip>
+#include <fstream>
+#ifdef _WIN32
+#include "DirectXHeaders.h"
+#endif
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	const char *gTagNames[] = { "Specks", "FrameResources", "Textures", "Geometry", "CubeMaps", "RenderTargets", "RenderItems", "World", "Diagnostics" };
+
+	struct TagCounters
+	{
+		atomic<uint64_t> Reserved = { 0 };
+		atomic<uint64_t> Used = { 0 };
+		atomic<uint64_t> ReservedHighWater = { 0 };
+		atomic<uint64_t> UsedHighWater = { 0 };
+		atomic<uint64_t> Allocations = { 0 };
+	};
+
+	TagCounters gCounters[(uint32_t)MemoryTag::Count];
+
+	void RaiseHighWater(atomic<uint64_t> &highWater, uint64_t value)
+	{
+		uint64_t current = highWater.load(memory_order_relaxed);
+		while (value > current && !highWater.compare_exchange_weak(current, value, memory_order_relaxed))
+		{
+		}
+	}
+
+	double ToMegabytes(uint64_t bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+}
+
+#ifdef _WIN32
+namespace
+{
+	// {8E3C1B52-6F0A-4D7E-9B1C-2A5D4F3E7C61}
+	const GUID gTrackedMemoryGuid = { 0x8e3c1b52, 0x6f0a, 0x4d7e, { 0x9b, 0x1c, 0x2a, 0x5d, 0x4f, 0x3e, 0x7c, 0x61 } };
+
+	// Set as the private data of a resource, which releases it when it is destroyed.
+	class TrackedResourceMemory : public IUnknown
+	{
+	public:
+		TrackedResourceMemory(MemoryTag tag, uint64_t reservedBytes, uint64_t usedBytes) : mAllocation(tag) { mAllocation.Set(reservedBytes, usedBytes); }
+
+		virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **object) override
+		{
+			if (!object)
+				return E_POINTER;
+			if (riid != __uuidof(IUnknown))
+			{
+				*object = nullptr;
+				return E_NOINTERFACE;
+			}
+			*object = this;
+			AddRef();
+			return S_OK;
+		}
+		virtual ULONG STDMETHODCALLTYPE AddRef() override { return ++mRefCount; }
+		virtual ULONG STDMETHODCALLTYPE Release() override
+		{
+			ULONG refCount = --mRefCount;
+			if (refCount == 0)
+				delete this;
+			return refCount;
+		}
+
+	private:
+		atomic<ULONG> mRefCount = { 1 };
+		MemoryAllocation mAllocation;
+	};
+}
+
+void MemoryTracker::TrackResource(ID3D12Resource *resource, MemoryTag tag, bool used)
+{
+	if (!resource)
+		return;
+
+	// The size the device allocates, with the alignment of the buffers and the padding of the textures
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	if (FAILED(resource->GetDevice(IID_PPV_ARGS(device.GetAddressOf()))))
+		return;
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+	uint64_t size = device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+
+	// Tracking the resource again replaces and releases the old data, so it is never counted twice
+	TrackedResourceMemory *memory = new TrackedResourceMemory(tag, size, used ? size : 0);
+	resource->SetPrivateDataInterface(gTrackedMemoryGuid, memory);
+	memory->Release();
+}
+#else
+void MemoryTracker::TrackResource(ID3D12Resource *resource, MemoryTag tag, bool used)
+{
+}
+#endif
+
+void MemoryTracker::Change(MemoryTag tag, int64_t reservedBytes, int64_t usedBytes, int allocations)
+{
+	// Unsigned addition wraps, so the negative changes subtract
+	TagCounters &counters = gCounters[(uint32_t)tag];
+	uint64_t reserved = counters.Reserved.fetch_add((uint64_t)reservedBytes, memory_order_relaxed) + (uint64_t)reservedBytes;
+	uint64_t used = counters.Used.fetch_add((uint64_t)usedBytes, memory_order_relaxed) + (uint64_t)usedBytes;
+	counters.Allocations.fetch_add((uint64_t)(int64_t)allocations, memory_order_relaxed);
+	if (reservedBytes > 0)
+		RaiseHighWater(counters.ReservedHighWater, reserved);
+	if (usedBytes > 0)
+		RaiseHighWater(counters.UsedHighWater, used);
+}
+
+void MemoryTracker::GetStats(vector<MemoryTagStats> *outStats)
+{
+	outStats->clear();
+	for (uint32_t t = 0; t < (uint32_t)MemoryTag::Count; ++t)
+	{
+		const TagCounters &counters = gCounters[t];
+		MemoryTagStats stats;
+		stats.Name = gTagNames[t];
+		stats.Reserved = counters.Reserved.load(memory_order_relaxed);
+		stats.Used = counters.Used.load(memory_order_relaxed);
+		stats.ReservedHighWater = counters.ReservedHighWater.load(memory_order_relaxed);
+		stats.UsedHighWater = counters.UsedHighWater.load(memory_order_relaxed);
+		stats.Allocations = counters.Allocations.load(memory_order_relaxed);
+		outStats->push_back(stats);
+	}
+}
+
+void MemoryTracker::Dump(ostream &stream)
+{
+	vector<MemoryTagStats> stats;
+	GetStats(&stats);
+
+	// The totals of the high-water marks are sums, the tags did not necessarily peak at the same time
+	MemoryTagStats total = {};
+	total.Name = "Total";
+	for (const MemoryTagStats &s : stats)
+	{
+		total.Reserved += s.Reserved;
+		total.Used += s.Used;
+		total.ReservedHighWater += s.ReservedHighWater;
+		total.UsedHighWater += s.UsedHighWater;
+		total.Allocations += s.Allocations;
+	}
+	stats.push_back(total);
+
+	stream << left << setw(16) << "Tag" << right << setw(16) << "Reserved (MB)" << setw(12) << "Used (MB)"
+		<< setw(16) << "Peak reserved" << setw(12) << "Peak used" << setw(13) << "Allocations" << "\n";
+	stream << fixed << setprecision(3);
+	for (const MemoryTagStats &s : stats)
+	{
+		stream << left << setw(16) << s.Name << right << setw(16) << ToMegabytes(s.Reserved) << setw(12) << ToMegabytes(s.Used)
+			<< setw(16) << ToMegabytes(s.ReservedHighWater) << setw(12) << ToMegabytes(s.UsedHighWater) << setw(13) << s.Allocations << "\n";
+	}
+}
+
+bool MemoryTracker::Dump(const string &path)
+{
+	ofstream file(path, ios::out | ios::trunc);
+	if (!file)
+		return false;
+	Dump(file);
+	return file.good();
+}
+
+void MemoryTracker::ResetHighWater()
+{
+	for (TagCounters &counters : gCounters)
+	{
+		counters.ReservedHighWater.store(counters.Reserved.load(memory_order_relaxed), memory_order_relaxed);
+		counters.UsedHighWater.store(counters.Used.load(memory_order_relaxed), memory_order_relaxed);
+	}
+}
+
+const char *MemoryTracker::GetTagName(MemoryTag tag)
+{
+	return gTagNames[(uint32_t)tag];
+}
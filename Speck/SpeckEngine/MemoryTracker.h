@@ -0,0 +1,112 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+// No SpeckEngineDefinitions.h here, the counters do not depend on Windows or Direct3D (only the tracking of the
+// resources does, on Windows).
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#ifndef DLL_EXPORT
+#ifdef _MSC_VER
+#define DLL_EXPORT __declspec(dllexport)
+#else
+#define DLL_EXPORT
+#endif
+#endif
+
+struct ID3D12Resource;
+
+namespace Speck
+{
+	// Subsystems the memory is accounted to.
+	enum class MemoryTag
+	{
+		Specks,				// buffers of the specks physics and their upload buffers in the frame resources
+		FrameResources,		// upload buffers of the frame resources used for rendering
+		Textures,			// loaded textures and their upload heaps
+		Geometry,			// vertex and index buffers
+		CubeMaps,			// environment maps and their render targets
+		RenderTargets,		// deferred render targets and the SSAO maps
+		RenderItems,		// CPU side containers of the render scene
+		World,				// CPU side containers of the world
+		Diagnostics,		// histories of the profiler and the metrics
+		Count
+	};
+
+	// Memory of a subsystem, in bytes.
+	struct MemoryTagStats
+	{
+		std::string Name;
+		// Allocated and the part of it that holds live data.
+		uint64_t Reserved;
+		uint64_t Used;
+		// Largest values since the start or the last reset of the high-water marks.
+		uint64_t ReservedHighWater;
+		uint64_t UsedHighWater;
+		// Number of the live allocations.
+		uint64_t Allocations;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Counts the memory held by each subsystem. The GPU resources are counted until
+	//	they are destroyed, the owners of the CPU side containers report them through
+	//	MemoryAllocation. The counters are atomic, any thread can report to them, and
+	//	they do not depend on the device, so they also work without one.
+	//-------------------------------------------------------------------------------------
+	class MemoryTracker
+	{
+	public:
+		// Adds the given number of bytes (negative to remove them) to the tag.
+		DLL_EXPORT static void Change(MemoryTag tag, int64_t reservedBytes, int64_t usedBytes, int allocations);
+		// Counts the resource to the tag until it is destroyed, with all of it in use or none of it. Owners of
+		// resources sized by a cap report their use themselves.
+		DLL_EXPORT static void TrackResource(ID3D12Resource *resource, MemoryTag tag, bool used = true);
+
+		// Stats of the tags, in the order of the enum.
+		DLL_EXPORT static void GetStats(std::vector<MemoryTagStats> *outStats);
+		// Writes the stats as a table, to the stream or to the file. Returns false if the file could not be written.
+		DLL_EXPORT static void Dump(std::ostream &stream);
+		DLL_EXPORT static bool Dump(const std::string &path);
+		// Starts the high-water marks over from the current values.
+		DLL_EXPORT static void ResetHighWater();
+
+		DLL_EXPORT static const char *GetTagName(MemoryTag tag);
+	};
+
+	// Memory of a CPU side container or any other allocation, counted while the object lives.
+	class MemoryAllocation
+	{
+	public:
+		MemoryAllocation(MemoryTag tag) : mTag(tag) { }
+		~MemoryAllocation() { Set(0, 0); }
+		// Make these inaccessible.
+		MemoryAllocation(const MemoryAllocation &allocation) = delete;
+		MemoryAllocation &operator=(const MemoryAllocation &allocation) = delete;
+
+		void Set(uint64_t reservedBytes, uint64_t usedBytes)
+		{
+			if (reservedBytes == mReserved && usedBytes == mUsed)
+				return;
+			int allocations = (reservedBytes > 0 ? 1 : 0) - (mReserved > 0 ? 1 : 0);
+			MemoryTracker::Change(mTag, (int64_t)reservedBytes - (int64_t)mReserved, (int64_t)usedBytes - (int64_t)mUsed, allocations);
+			mReserved = reservedBytes;
+			mUsed = usedBytes;
+		}
+
+		// The capacity of the vector is reserved, its size used.
+		template<typename T>
+		void Set(const std::vector<T> &container) { Set(container.capacity() * sizeof(T), container.size() * sizeof(T)); }
+
+		uint64_t GetReserved() const { return mReserved; }
+		uint64_t GetUsed() const { return mUsed; }
+
+	private:
+		MemoryTag mTag;
+		uint64_t mReserved = 0;
+		uint64_t mUsed = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,418 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+const float MeshOptimizer::OverdrawThreshold = 1.05f;
+
+namespace
+{
+	// Forsyth's vertex scoring, the cache modelled here is an LRU cache of 32 vertices
+	const int ScoringCacheSize = 32;
+	const int MaxValence = 64;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	struct VertexScoreTables
+	{
+		float cache[ScoringCacheSize];
+		float valence[MaxValence + 1];
+
+		VertexScoreTables()
+		{
+			for (int i = 0; i < ScoringCacheSize; ++i)
+			{
+				// The vertices of the last triangle get a fixed score, so that it is not used again right away
+				if (i < 3)
+					cache[i] = LastTriangleScore;
+				else
+					cache[i] = powf(1.0f - (float)(i - 3) / (ScoringCacheSize - 3), CacheDecayPower);
+			}
+
+			// Vertices with few triangles left are preferred, so that they do not stay behind
+			valence[0] = 0.0f;
+			for (int i = 1; i <= MaxValence; ++i)
+				valence[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+		}
+	};
+
+	float GetVertexScore(const VertexScoreTables &tables, int cachePos, UINT liveTriangles)
+	{
+		if (liveTriangles == 0)
+			return -1.0f; // not needed anymore
+		float score = (cachePos >= 0) ? tables.cache[cachePos] : 0.0f;
+		return score + tables.valence[min(liveTriangles, (UINT)MaxValence)];
+	}
+
+	// FIFO cache simulation, a vertex is in the cache if fewer than cacheSize misses happened since it was loaded.
+	class FIFOCache
+	{
+	public:
+		FIFOCache(size_t vertexCount, UINT cacheSize)
+			: mTimestamps(vertexCount, 0)
+			, mTime(cacheSize + 1)
+			, mCacheSize(cacheSize)
+		{}
+
+		// Returns the number of misses of the triangle.
+		UINT Process(const uint32_t *triangle)
+		{
+			UINT misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				if (mTime - mTimestamps[triangle[k]] > mCacheSize)
+				{
+					mTimestamps[triangle[k]] = mTime++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		void Flush() { mTime += mCacheSize + 1; }
+
+	private:
+		vector<UINT> mTimestamps;
+		UINT mTime;
+		UINT mCacheSize;
+	};
+
+	const XMFLOAT3 &GetPosition(const float *positions, size_t vertexStride, uint32_t index)
+	{
+		return *reinterpret_cast<const XMFLOAT3 *>(reinterpret_cast<const uint8_t *>(positions) + index * vertexStride);
+	}
+
+	template<class MeshData>
+	void OptimizeMesh(MeshData *mesh, const float *positions, size_t vertexStride, MeshOptimizationStats *outStats, vector<MeshLOD> *lods)
+	{
+		vector<uint32_t> &indices = mesh->Indices32;
+		if (indices.empty())
+			return;
+
+		size_t vertexCount = mesh->Vertices.size();
+		if (outStats)
+		{
+			outStats->acmrBefore = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), vertexCount);
+			outStats->atvrBefore = MeshOptimizer::CalculateATVR(indices.data(), indices.size(), vertexCount);
+		}
+
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+		if (positions)
+			MeshOptimizer::OptimizeOverdraw(indices.data(), indices.size(), positions, vertexCount, vertexStride);
+		if (lods)
+		{
+			for (MeshLOD &lod : *lods)
+			{
+				MeshOptimizer::OptimizeVertexCache(lod.indices.data(), lod.indices.size(), vertexCount);
+				if (positions)
+					MeshOptimizer::OptimizeOverdraw(lod.indices.data(), lod.indices.size(), positions, vertexCount, vertexStride);
+			}
+		}
+
+		// The LODs only use the vertices of the full mesh, so its order is used for all of them
+		vector<uint32_t> remap;
+		size_t usedCount = MeshOptimizer::OptimizeVertexFetchRemap(indices.data(), indices.size(), vertexCount, &remap);
+		MeshOptimizer::RemapVertices(&mesh->Vertices, remap, usedCount);
+		if (lods)
+		{
+			for (MeshLOD &lod : *lods)
+				for (uint32_t &index : lod.indices)
+					index = remap[index];
+		}
+
+		if (outStats)
+		{
+			outStats->acmrAfter = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), usedCount);
+			outStats->atvrAfter = MeshOptimizer::CalculateATVR(indices.data(), indices.size(), usedCount);
+		}
+	}
+}
+
+void MeshOptimizer::Optimize(GeometryGenerator::StaticMeshData *mesh, MeshOptimizationStats *outStats, vector<MeshLOD> *lods)
+{
+	const float *positions = mesh->Vertices.empty() ? nullptr : &mesh->Vertices[0].Position.x;
+	OptimizeMesh(mesh, positions, sizeof(GeometryGenerator::StaticVertex), outStats, lods);
+}
+
+void MeshOptimizer::Optimize(GeometryGenerator::SkinnedMeshData *mesh, MeshOptimizationStats *outStats, vector<MeshLOD> *lods)
+{
+	OptimizeMesh(mesh, nullptr, 0, outStats, lods);
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+	static const VertexScoreTables tables;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles of every vertex, the live ones are kept at the front of each range
+	vector<UINT> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+		liveTriangles[indices[i]]++;
+
+	vector<UINT> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+	vector<UINT> adjacency(triangleCount * 3);
+	{
+		vector<UINT> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t)
+			for (int k = 0; k < 3; ++k)
+				adjacency[fill[indices[t * 3 + k]]++] = (UINT)t;
+	}
+
+	vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexScores[v] = GetVertexScore(tables, -1, liveTriangles[v]);
+
+	vector<bool> emitted(triangleCount, false);
+	int bestTriangle = -1;
+	float bestScore = -1.0f;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const uint32_t *tri = &indices[t * 3];
+		float score = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestTriangle = (int)t;
+		}
+	}
+
+	vector<uint32_t> output(triangleCount * 3);
+	uint32_t cache[ScoringCacheSize + 3];
+	uint32_t newCache[ScoringCacheSize + 3];
+	int cacheCount = 0;
+	size_t nextUnemitted = 0;
+
+	for (size_t outTriangle = 0; outTriangle < triangleCount; ++outTriangle)
+	{
+		// Nothing in the cache is connected to a live triangle, continue with the first one left
+		if (bestTriangle < 0)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = (int)nextUnemitted;
+		}
+
+		const uint32_t *tri = &indices[bestTriangle * 3];
+		memcpy(&output[outTriangle * 3], tri, 3 * sizeof(uint32_t));
+		emitted[bestTriangle] = true;
+
+		// The vertices of the triangle go to the front of the cache
+		int newCacheCount = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = tri[k];
+			if (find(newCache, newCache + newCacheCount, v) == newCache + newCacheCount)
+				newCache[newCacheCount++] = v;
+
+			// Remove the triangle from the live ones of the vertex
+			UINT *begin = &adjacency[adjacencyOffsets[v]];
+			UINT *end = begin + liveTriangles[v];
+			UINT *found = find(begin, end, (UINT)bestTriangle);
+			swap(*found, *(end - 1));
+			liveTriangles[v]--;
+		}
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			uint32_t v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCacheCount++] = v;
+		}
+
+		// Vertices pushed out of the cache
+		for (int i = ScoringCacheSize; i < newCacheCount; ++i)
+			vertexScores[newCache[i]] = GetVertexScore(tables, -1, liveTriangles[newCache[i]]);
+		cacheCount = min(newCacheCount, ScoringCacheSize);
+		memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+		// Rescore the triangles around the cache and pick the best one of them
+		for (int i = 0; i < cacheCount; ++i)
+			vertexScores[cache[i]] = GetVertexScore(tables, i, liveTriangles[cache[i]]);
+
+		bestTriangle = -1;
+		bestScore = -1.0f;
+		for (int i = 0; i < cacheCount; ++i)
+		{
+			uint32_t v = cache[i];
+			for (UINT j = adjacencyOffsets[v]; j < adjacencyOffsets[v] + liveTriangles[v]; ++j)
+			{
+				UINT t = adjacency[j];
+				const uint32_t *adjTri = &indices[t * 3];
+				float score = vertexScores[adjTri[0]] + vertexScores[adjTri[1]] + vertexScores[adjTri[2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = (int)t;
+				}
+			}
+		}
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t vertexStride, float threshold)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Hard boundaries, the cache order starts over where a triangle misses all of its vertices
+	vector<size_t> hardClusters;
+	{
+		FIFOCache cache(vertexCount, CacheSize);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			if (cache.Process(&indices[t * 3]) == 3 || t == 0)
+				hardClusters.push_back(t);
+		}
+		hardClusters.push_back(triangleCount);
+	}
+
+	// Soft boundaries, hard clusters are split once the ACMR of the current part gets close to the one
+	// of the whole cluster (each part starts with an empty cache, as it may be drawn after any other one)
+	vector<size_t> clusters;
+	{
+		FIFOCache cache(vertexCount, CacheSize);
+		vector<UINT> misses(triangleCount);
+		for (size_t c = 0; c + 1 < hardClusters.size(); ++c)
+		{
+			size_t begin = hardClusters[c], end = hardClusters[c + 1];
+			cache.Flush();
+			UINT clusterMisses = 0;
+			for (size_t t = begin; t < end; ++t)
+			{
+				misses[t] = cache.Process(&indices[t * 3]);
+				clusterMisses += misses[t];
+			}
+			float clusterThreshold = threshold * clusterMisses / (end - begin);
+
+			clusters.push_back(begin);
+			cache.Flush();
+			size_t partBegin = begin;
+			UINT partMisses = 0;
+			for (size_t t = begin; t < end; ++t)
+			{
+				partMisses += cache.Process(&indices[t * 3]);
+				if (t + 1 < end && (float)partMisses / (t + 1 - partBegin) <= clusterThreshold)
+				{
+					clusters.push_back(t + 1);
+					cache.Flush();
+					partBegin = t + 1;
+					partMisses = 0;
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+	}
+
+	// Area weighted centroid and normal of every cluster
+	size_t clusterCount = clusters.size() - 1;
+	vector<XMFLOAT3> clusterCentroids(clusterCount);
+	vector<XMFLOAT3> clusterNormals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&GetPosition(positions, vertexStride, indices[t * 3 + 0]));
+			XMVECTOR p1 = XMLoadFloat3(&GetPosition(positions, vertexStride, indices[t * 3 + 1]));
+			XMVECTOR p2 = XMLoadFloat3(&GetPosition(positions, vertexStride, indices[t * 3 + 2]));
+			XMVECTOR cross = XMVector3Cross(p1 - p0, p2 - p0);
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+		XMStoreFloat3(&clusterCentroids[c], (area > 0.0f) ? centroid / area : XMVectorZero());
+		XMStoreFloat3(&clusterNormals[c], XMVector3Normalize(normal));
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters far out along their normal are drawn first, they are the likely occluders
+	vector<float> sortKeys(clusterCount);
+	vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		XMVECTOR offset = XMLoadFloat3(&clusterCentroids[c]) - meshCentroid;
+		sortKeys[c] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[c])));
+		order[c] = c;
+	}
+	stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (size_t c : order)
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+size_t MeshOptimizer::OptimizeVertexFetchRemap(uint32_t *indices, size_t indexCount, size_t vertexCount, vector<uint32_t> *outRemap)
+{
+	outRemap->assign(vertexCount, UINT_MAX);
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t &remapped = (*outRemap)[indices[i]];
+		if (remapped == UINT_MAX)
+			remapped = next++;
+		indices[i] = remapped;
+	}
+	return next;
+}
+
+float MeshOptimizer::CalculateACMR(const uint32_t *indices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return 0.0f;
+
+	FIFOCache cache(vertexCount, cacheSize);
+	size_t misses = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+		misses += cache.Process(&indices[t * 3]);
+	return (float)misses / triangleCount;
+}
+
+float MeshOptimizer::CalculateATVR(const uint32_t *indices, size_t indexCount, size_t vertexCount, UINT cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return 0.0f;
+
+	FIFOCache cache(vertexCount, cacheSize);
+	vector<bool> used(vertexCount, false);
+	size_t misses = 0, usedCount = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		misses += cache.Process(&indices[t * 3]);
+		for (int k = 0; k < 3; ++k)
+		{
+			if (!used[indices[t * 3 + k]])
+			{
+				used[indices[t * 3 + k]] = true;
+				usedCount++;
+			}
+		}
+	}
+	return (float)misses / usedCount;
+}
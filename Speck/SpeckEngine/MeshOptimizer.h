@@ -0,0 +1,71 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "GeometryGenerator.h"
+#include "MeshSimplifier.h"
+#include <climits>
+
+namespace Speck
+{
+	// Average cache miss ratio (misses per triangle, 0.5 at best, 3 at worst) and average
+	// transformed vertex ratio (misses per vertex, 1 at best) of a FIFO post-transform cache.
+	struct MeshOptimizationStats
+	{
+		float acmrBefore = 0.0f;
+		float atvrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+		float atvrAfter = 0.0f;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Reorders the triangles and the vertices of indexed triangle lists for the GPU:
+	//	triangles are sorted for the post-transform vertex cache (Forsyth), then clustered
+	//	and sorted so that the clusters facing outwards are drawn first (less overdraw),
+	//	and finally the vertices are renumbered in the order they are first used.
+	//-------------------------------------------------------------------------------------
+	class MeshOptimizer
+	{
+	public:
+		// Size of the FIFO cache used for the statistics and for the overdraw clustering.
+		static const UINT CacheSize = 16;
+		// Clusters may have this much worse ACMR than the vertex cache order, for the sake of the overdraw.
+		static const float OverdrawThreshold;
+
+		// Runs all the passes and removes the unused vertices. The skinned vertices keep their positions
+		// in the spaces of the bones, so the overdraw pass is skipped for them. The LODs of the mesh are
+		// optimized too and follow the new vertex order (the stats are for the full mesh).
+		DLL_EXPORT static void Optimize(GeometryGenerator::StaticMeshData *mesh, MeshOptimizationStats *outStats = nullptr, std::vector<MeshLOD> *lods = nullptr);
+		DLL_EXPORT static void Optimize(GeometryGenerator::SkinnedMeshData *mesh, MeshOptimizationStats *outStats = nullptr, std::vector<MeshLOD> *lods = nullptr);
+
+		// Triangle order that reuses the transformed vertices as much as possible.
+		DLL_EXPORT static void OptimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount);
+		// Splits the triangles into clusters that keep the cache order and sorts them front to back from the outside.
+		// Positions are three floats, vertexStride apart (in bytes).
+		DLL_EXPORT static void OptimizeOverdraw(uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+			size_t vertexStride, float threshold = OverdrawThreshold);
+		// Outputs the new index of every vertex (UINT_MAX for the unused ones) and rewrites the indices. Returns the
+		// number of vertices that are used.
+		DLL_EXPORT static size_t OptimizeVertexFetchRemap(uint32_t *indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t> *outRemap);
+
+		DLL_EXPORT static float CalculateACMR(const uint32_t *indices, size_t indexCount, size_t vertexCount, UINT cacheSize = CacheSize);
+		DLL_EXPORT static float CalculateATVR(const uint32_t *indices, size_t indexCount, size_t vertexCount, UINT cacheSize = CacheSize);
+
+		// 16 bit indices are enough for the meshes that have up to 65536 vertices.
+		static bool NeedsIndices32(size_t vertexCount) { return vertexCount > 0x10000; }
+
+		template<class Vertex>
+		static void RemapVertices(std::vector<Vertex> *vertices, const std::vector<uint32_t> &remap, size_t usedCount)
+		{
+			std::vector<Vertex> remapped(usedCount);
+			for (size_t i = 0; i < remap.size(); ++i)
+			{
+				if (remap[i] != UINT_MAX)
+					remapped[remap[i]] = (*vertices)[i];
+			}
+			vertices->swap(remapped);
+		}
+	};
+}
+
+#endif
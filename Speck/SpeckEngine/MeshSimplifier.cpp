@@ -0,0 +1,483 @@
+#include "MeshSimplifier.h"
+#include "GenericShaderStructures.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+const float MeshSimplifier::LODReduction = 0.5f;
+const float MeshSimplifier::MaxLODError = 0.05f;
+
+namespace
+{
+	// Open edges pull their vertices back along the surface this much harder than the faces.
+	const double BorderWeight = 10.0;
+	// Collapses that turn a triangle more than this (cosine of the angle) are rejected.
+	const float MinFlipCosine = 0.25f;
+	// Default weights of the static vertex attributes (normal, tangent, texture coordinates).
+	const float StaticAttributeWeights[8] = { 0.01f, 0.01f, 0.01f, 0.0f, 0.0f, 0.0f, 0.01f, 0.01f };
+
+	const uint32_t NoEdge = UINT_MAX;
+	const uint32_t ManyEdges = UINT_MAX - 1;
+
+	enum struct VertexKind
+	{
+		Manifold,	// can collapse to any neighbour
+		Border,		// can only collapse along the border
+		Seam,		// can only collapse along the seam, together with the vertex on its other side
+		Locked		// stays
+	};
+
+	// Sum of the squared distances to a set of weighted planes.
+	struct Quadric
+	{
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+		double weight = 0.0;
+
+		void AddPlane(double nx, double ny, double nz, double d, double w)
+		{
+			a00 += w * nx * nx; a11 += w * ny * ny; a22 += w * nz * nz;
+			a01 += w * nx * ny; a02 += w * nx * nz; a12 += w * ny * nz;
+			b0 += w * nx * d; b1 += w * ny * d; b2 += w * nz * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric &q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a01 += q.a01; a02 += q.a02; a12 += q.a12;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		// Average squared distance of the point to the planes.
+		double Evaluate(const XMFLOAT3 &p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			double r = a00 * x * x + a11 * y * y + a22 * z * z
+				+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+				+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return fabs(r) / ((weight > 0.0) ? weight : 1.0);
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		float cost;
+	};
+
+	XMFLOAT3 Subtract(const XMFLOAT3 &a, const XMFLOAT3 &b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	XMFLOAT3 Cross(const XMFLOAT3 &a, const XMFLOAT3 &b) { return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	float Dot(const XMFLOAT3 &a, const XMFLOAT3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	float Length(const XMFLOAT3 &a) { return sqrtf(Dot(a, a)); }
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b) { return ((uint64_t)a << 32) | b; }
+
+	// Moves the positions into the unit cube, so that the errors are relative to the size of the mesh. Returns the size.
+	float NormalizePositions(const float *positions, size_t vertexCount, size_t vertexStride, vector<XMFLOAT3> *outPoints)
+	{
+		XMFLOAT3 minP(FLT_MAX, FLT_MAX, FLT_MAX), maxP(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		outPoints->resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const float *p = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(positions) + i * vertexStride);
+			(*outPoints)[i] = XMFLOAT3(p[0], p[1], p[2]);
+			minP = XMFLOAT3(min(minP.x, p[0]), min(minP.y, p[1]), min(minP.z, p[2]));
+			maxP = XMFLOAT3(max(maxP.x, p[0]), max(maxP.y, p[1]), max(maxP.z, p[2]));
+		}
+
+		float extent = max(max(maxP.x - minP.x, maxP.y - minP.y), maxP.z - minP.z);
+		float scale = (extent > 0.0f) ? 1.0f / extent : 1.0f;
+		for (XMFLOAT3 &p : *outPoints)
+			p = XMFLOAT3((p.x - minP.x) * scale, (p.y - minP.y) * scale, (p.z - minP.z) * scale);
+		return (extent > 0.0f) ? extent : 1.0f;
+	}
+
+	// Every vertex is mapped to the first one with the same position, the vertices with the same position
+	// are linked in a ring.
+	void WeldPositions(const vector<XMFLOAT3> &points, vector<uint32_t> *outRemap, vector<uint32_t> *outWedges)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const XMFLOAT3 &p) const
+			{
+				const uint32_t *bits = reinterpret_cast<const uint32_t *>(&p);
+				return (size_t)((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+			}
+		};
+		struct PositionEqual
+		{
+			bool operator()(const XMFLOAT3 &a, const XMFLOAT3 &b) const { return a.x == b.x && a.y == b.y && a.z == b.z; }
+		};
+
+		unordered_map<XMFLOAT3, uint32_t, PositionHash, PositionEqual> firstVertices;
+		firstVertices.reserve(points.size());
+		outRemap->resize(points.size());
+		outWedges->resize(points.size());
+		for (uint32_t i = 0; i < (uint32_t)points.size(); ++i)
+		{
+			auto inserted = firstVertices.insert(make_pair(points[i], i));
+			uint32_t first = inserted.first->second;
+			(*outRemap)[i] = first;
+			if (first == i)
+			{
+				(*outWedges)[i] = i;
+			}
+			else
+			{
+				(*outWedges)[i] = (*outWedges)[first];
+				(*outWedges)[first] = i;
+			}
+		}
+	}
+
+	void ClassifyVertices(const vector<uint32_t> &indices, const vector<uint32_t> &remap, const vector<uint32_t> &wedges,
+		vector<VertexKind> *outKinds, vector<uint32_t> *outOpenOut, vector<uint32_t> *outOpenIn)
+	{
+		size_t vertexCount = remap.size();
+		unordered_set<uint64_t> edges;
+		edges.reserve(indices.size());
+		for (size_t i = 0; i < indices.size(); i += 3)
+			for (int k = 0; k < 3; ++k)
+				edges.insert(EdgeKey(indices[i + k], indices[i + (k + 1) % 3]));
+
+		// Edges without a twin going the other way
+		outOpenOut->assign(vertexCount, NoEdge);
+		outOpenIn->assign(vertexCount, NoEdge);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+				if (edges.count(EdgeKey(b, a)))
+					continue;
+				(*outOpenOut)[a] = ((*outOpenOut)[a] == NoEdge) ? b : ManyEdges;
+				(*outOpenIn)[b] = ((*outOpenIn)[b] == NoEdge) ? a : ManyEdges;
+			}
+		}
+
+		auto isSingle = [](uint32_t edge) { return edge != NoEdge && edge != ManyEdges; };
+		const vector<uint32_t> &openOut = *outOpenOut;
+		const vector<uint32_t> &openIn = *outOpenIn;
+		outKinds->assign(vertexCount, VertexKind::Locked);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			uint32_t w = wedges[v];
+			if (w == v)
+			{
+				if (openOut[v] == NoEdge && openIn[v] == NoEdge)
+					(*outKinds)[v] = VertexKind::Manifold;
+				else if (isSingle(openOut[v]) && isSingle(openIn[v]))
+					(*outKinds)[v] = VertexKind::Border;
+			}
+			else if (wedges[w] == v)
+			{
+				// Two vertices at the same position, the open edges of one have to be the twins of the other's
+				if (isSingle(openOut[v]) && isSingle(openIn[v]) && isSingle(openOut[w]) && isSingle(openIn[w]) &&
+					remap[openOut[v]] == remap[openIn[w]] && remap[openIn[v]] == remap[openOut[w]])
+					(*outKinds)[v] = VertexKind::Seam;
+			}
+		}
+	}
+
+	void AddQuadrics(const vector<uint32_t> &indices, const vector<XMFLOAT3> &points, const vector<uint32_t> &remap,
+		const vector<uint32_t> &openOut, vector<Quadric> *quadrics)
+	{
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			const XMFLOAT3 &p0 = points[indices[i]];
+			XMFLOAT3 normal = Cross(Subtract(points[indices[i + 1]], p0), Subtract(points[indices[i + 2]], p0));
+			float length = Length(normal);
+			if (length == 0.0f)
+				continue;
+			normal = XMFLOAT3(normal.x / length, normal.y / length, normal.z / length);
+
+			// Plane of the face, weighted by the area
+			double d = -Dot(normal, p0);
+			for (int k = 0; k < 3; ++k)
+				(*quadrics)[remap[indices[i + k]]].AddPlane(normal.x, normal.y, normal.z, d, length * 0.5);
+
+			// Plane through the open edges, perpendicular to the face
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+				if (openOut[a] != b)
+					continue;
+				XMFLOAT3 edge = Subtract(points[b], points[a]);
+				XMFLOAT3 edgeNormal = Cross(edge, normal);
+				float edgeLength = Length(edgeNormal);
+				if (edgeLength == 0.0f)
+					continue;
+				edgeNormal = XMFLOAT3(edgeNormal.x / edgeLength, edgeNormal.y / edgeLength, edgeNormal.z / edgeLength);
+				double edgeD = -Dot(edgeNormal, points[a]);
+				double weight = Dot(edge, edge) * BorderWeight;
+				(*quadrics)[remap[a]].AddPlane(edgeNormal.x, edgeNormal.y, edgeNormal.z, edgeD, weight);
+				(*quadrics)[remap[b]].AddPlane(edgeNormal.x, edgeNormal.y, edgeNormal.z, edgeD, weight);
+			}
+		}
+	}
+
+	float GetAttributeError(const MeshSimplifier::Attributes &attributes, uint32_t a, uint32_t b)
+	{
+		const float *attrA = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(attributes.data) + a * attributes.stride);
+		const float *attrB = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(attributes.data) + b * attributes.stride);
+		float error = 0.0f;
+		for (UINT k = 0; k < attributes.count; ++k)
+		{
+			float diff = attrA[k] - attrB[k];
+			error += attributes.weights[k] * diff * diff;
+		}
+		return error;
+	}
+
+	// Vertex on the other side of the seam, that goes with the collapse of the seam vertex 'from' into 'to'.
+	uint32_t GetSeamTwinTarget(uint32_t from, uint32_t to, const vector<uint32_t> &wedges, const vector<uint32_t> &openOut, const vector<uint32_t> &openIn)
+	{
+		uint32_t twin = wedges[from];
+		return (openOut[from] == to) ? openIn[twin] : openOut[twin];
+	}
+
+	bool CanCollapse(uint32_t from, uint32_t to, const vector<VertexKind> &kinds, const vector<uint32_t> &remap,
+		const vector<uint32_t> &openOut, const vector<uint32_t> &openIn)
+	{
+		if (remap[from] == remap[to])
+			return false;
+
+		switch (kinds[from])
+		{
+			case VertexKind::Manifold:
+				return true;
+			case VertexKind::Border:
+				return (openOut[from] == to || openIn[from] == to) &&
+					(kinds[to] == VertexKind::Border || kinds[to] == VertexKind::Locked);
+			case VertexKind::Seam:
+				return (openOut[from] == to || openIn[from] == to) && kinds[to] == VertexKind::Seam;
+			default:
+				return false;
+		}
+	}
+
+	// Checks that none of the triangles around the removed vertex flips over.
+	bool IsCollapseValid(uint32_t from, uint32_t to, const vector<uint32_t> &indices, const vector<XMFLOAT3> &points,
+		const vector<uint32_t> &remap, const vector<uint32_t> &triangleOffsets, const vector<uint32_t> &triangles)
+	{
+		uint32_t weldedFrom = remap[from], weldedTo = remap[to];
+		for (uint32_t i = triangleOffsets[weldedFrom]; i < triangleOffsets[weldedFrom + 1]; ++i)
+		{
+			const uint32_t *tri = &indices[triangles[i] * 3];
+			uint32_t w0 = remap[tri[0]], w1 = remap[tri[1]], w2 = remap[tri[2]];
+			if (w0 == weldedTo || w1 == weldedTo || w2 == weldedTo)
+				continue; // removed by the collapse
+
+			XMFLOAT3 p[3] = { points[tri[0]], points[tri[1]], points[tri[2]] };
+			XMFLOAT3 oldNormal = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+			if (w0 == weldedFrom) p[0] = points[to];
+			if (w1 == weldedFrom) p[1] = points[to];
+			if (w2 == weldedFrom) p[2] = points[to];
+			XMFLOAT3 newNormal = Cross(Subtract(p[1], p[0]), Subtract(p[2], p[0]));
+			if (Dot(oldNormal, newNormal) < MinFlipCosine * Length(oldNormal) * Length(newNormal))
+				return false;
+		}
+		return true;
+	}
+}
+
+float MeshSimplifier::Simplify(const uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t vertexStride, const Attributes &attributes, size_t targetIndexCount, float targetError, vector<uint32_t> *outIndices)
+{
+	vector<uint32_t> &result = *outIndices;
+	result.assign(indices, indices + indexCount);
+	if (indexCount <= targetIndexCount || vertexCount == 0)
+		return 0.0f;
+
+	vector<XMFLOAT3> points;
+	float extent = NormalizePositions(positions, vertexCount, vertexStride, &points);
+
+	vector<uint32_t> remap, wedges, openOut, openIn;
+	vector<VertexKind> kinds;
+	WeldPositions(points, &remap, &wedges);
+	ClassifyVertices(result, remap, wedges, &kinds, &openOut, &openIn);
+
+	// Quadrics are kept for the welded vertices
+	vector<Quadric> quadrics(vertexCount);
+	AddQuadrics(result, points, remap, openOut, &quadrics);
+
+	const float maxCost = targetError * targetError;
+	float resultCost = 0.0f;
+	vector<Collapse> collapses;
+	vector<uint32_t> collapseRemap(vertexCount);
+	vector<bool> locked(vertexCount);
+	vector<uint32_t> triangleOffsets(vertexCount + 1);
+	vector<uint32_t> triangles;
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// The borders and seams change as their vertices collapse
+		ClassifyVertices(result, remap, wedges, &kinds, &openOut, &openIn);
+
+		// Triangles around every welded vertex
+		fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : result)
+			triangleOffsets[remap[index] + 1]++;
+		for (size_t v = 0; v < vertexCount; ++v)
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		triangles.resize(result.size());
+		{
+			vector<uint32_t> fillPos(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i)
+				triangles[fillPos[remap[result[i]]]++] = (uint32_t)(i / 3);
+		}
+
+		// Cheaper direction of every edge
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+				Collapse best = { 0, 0, FLT_MAX };
+				for (int dir = 0; dir < 2; ++dir)
+				{
+					uint32_t from = dir ? b : a, to = dir ? a : b;
+					if (!CanCollapse(from, to, kinds, remap, openOut, openIn))
+						continue;
+
+					float cost = (float)quadrics[remap[from]].Evaluate(points[to]);
+					if (attributes.count > 0)
+					{
+						float attributeError = GetAttributeError(attributes, from, to);
+						if (kinds[from] == VertexKind::Seam)
+							attributeError = max(attributeError, GetAttributeError(attributes, wedges[from], GetSeamTwinTarget(from, to, wedges, openOut, openIn)));
+						cost += attributeError;
+					}
+					if (cost < best.cost)
+						best = { from, to, cost };
+				}
+				if (best.cost < FLT_MAX)
+					collapses.push_back(best);
+			}
+		}
+		if (collapses.empty())
+			break;
+		sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+		// Only the cheapest part of the collapses is done in one pass, the rest are reevaluated in the next one
+		size_t collapseGoal = (triangleCount - targetIndexCount / 3) / 2 + 1;
+		size_t passCollapses = max(collapseGoal + collapseGoal / 2, collapses.size() / 8);
+		float passCost = min(maxCost, collapses[min(collapses.size() - 1, passCollapses)].cost);
+
+		for (uint32_t v = 0; v < vertexCount; ++v)
+			collapseRemap[v] = v;
+		fill(locked.begin(), locked.end(), false);
+		size_t removedTriangles = 0;
+		size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+		for (const Collapse &c : collapses)
+		{
+			if (c.cost > passCost || removedTriangles >= trianglesToRemove)
+				break;
+			uint32_t weldedFrom = remap[c.from], weldedTo = remap[c.to];
+			if (locked[weldedFrom] || locked[weldedTo])
+				continue;
+			if (!IsCollapseValid(c.from, c.to, result, points, remap, triangleOffsets, triangles))
+				continue;
+
+			collapseRemap[c.from] = c.to;
+			if (kinds[c.from] == VertexKind::Seam)
+				collapseRemap[wedges[c.from]] = GetSeamTwinTarget(c.from, c.to, wedges, openOut, openIn);
+			quadrics[weldedTo].Add(quadrics[weldedFrom]);
+			resultCost = max(resultCost, c.cost);
+			removedTriangles += (kinds[c.from] == VertexKind::Border) ? 1 : 2;
+
+			// The triangles around the vertex changed, their vertices wait for the next pass
+			for (uint32_t i = triangleOffsets[weldedFrom]; i < triangleOffsets[weldedFrom + 1]; ++i)
+			{
+				const uint32_t *tri = &result[triangles[i] * 3];
+				for (int k = 0; k < 3; ++k)
+					locked[remap[tri[k]]] = true;
+			}
+		}
+		if (removedTriangles == 0)
+			break;
+
+		// Remap the indices and remove the triangles that collapsed
+		size_t writePos = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32_t i0 = collapseRemap[result[i]], i1 = collapseRemap[result[i + 1]], i2 = collapseRemap[result[i + 2]];
+			if (remap[i0] == remap[i1] || remap[i1] == remap[i2] || remap[i0] == remap[i2])
+				continue;
+			result[writePos++] = i0;
+			result[writePos++] = i1;
+			result[writePos++] = i2;
+		}
+		result.resize(writePos);
+	}
+
+	return sqrtf(resultCost) * extent;
+}
+
+void MeshSimplifier::BuildLODChain(const uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t vertexStride, const Attributes &attributes, UINT lodCount, vector<MeshLOD> *outLODs)
+{
+	outLODs->clear();
+	size_t previousIndexCount = indexCount;
+	float previousError = 0.0f;
+	for (UINT lod = 1; lod < lodCount; ++lod)
+	{
+		// Every LOD is simplified from the full mesh, so that the errors do not add up
+		size_t targetIndexCount = (size_t)(previousIndexCount * LODReduction) / 3 * 3;
+		MeshLOD meshLOD;
+		meshLOD.error = Simplify(indices, indexCount, positions, vertexCount, vertexStride, attributes, targetIndexCount, MaxLODError, &meshLOD.indices);
+
+		// Not worth another LOD
+		if (meshLOD.indices.empty() || meshLOD.indices.size() > previousIndexCount * 0.9f)
+			break;
+
+		meshLOD.error = max(meshLOD.error, previousError);
+		previousIndexCount = meshLOD.indices.size();
+		previousError = meshLOD.error;
+		outLODs->push_back(move(meshLOD));
+	}
+}
+
+void MeshSimplifier::BuildLODChain(const GeometryGenerator::StaticMeshData &mesh, UINT lodCount, vector<MeshLOD> *outLODs)
+{
+	outLODs->clear();
+	if (mesh.Vertices.empty())
+		return;
+
+	// Normal, tangent and texture coordinates follow each other in the vertex
+	Attributes attributes;
+	attributes.data = &mesh.Vertices[0].Normal.x;
+	attributes.stride = sizeof(GeometryGenerator::StaticVertex);
+	attributes.count = _countof(StaticAttributeWeights);
+	attributes.weights = StaticAttributeWeights;
+	BuildLODChain(mesh.Indices32.data(), mesh.Indices32.size(), &mesh.Vertices[0].Position.x, mesh.Vertices.size(),
+		sizeof(GeometryGenerator::StaticVertex), attributes, lodCount, outLODs);
+}
+
+size_t MeshSimplifier::SelectLOD(const vector<SubmeshLOD> &lods, float distance, float scale, float pixelsPerUnit, float maxPixelError)
+{
+	size_t selected = 0;
+	float pixelErrorScale = scale * pixelsPerUnit / max(distance, 1e-3f);
+	for (size_t i = 1; i < lods.size(); ++i)
+	{
+		if (lods[i].Error * pixelErrorScale > maxPixelError)
+			break;
+		selected = i;
+	}
+	return selected;
+}
@@ -0,0 +1,63 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "GeometryGenerator.h"
+
+namespace Speck
+{
+	struct SubmeshLOD;
+
+	// Simplified version of a mesh, it indexes the vertices of the full mesh.
+	struct MeshLOD
+	{
+		std::vector<std::uint32_t> indices;
+		// Largest error of the simplification, in the units of the mesh.
+		float error = 0.0f;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Simplifies indexed triangle meshes by collapsing edges into one of their vertices,
+	//	cheapest first, by the quadric error of the removed vertex plus the weighted
+	//	difference of the vertex attributes. No vertices are created, so all the LODs of a
+	//	mesh share its vertex buffer. Vertices on the borders and on the attribute seams
+	//	(same position, different attributes) only move along the border or the seam.
+	//-------------------------------------------------------------------------------------
+	class MeshSimplifier
+	{
+	public:
+		// Per vertex floats that should not change much when the edges are collapsed (normals,
+		// texture coordinates, skin weights...). Each one is multiplied by its weight.
+		struct Attributes
+		{
+			const float *data = nullptr;
+			size_t stride = 0; // in bytes
+			UINT count = 0;
+			const float *weights = nullptr;
+		};
+
+		// Each LOD has half of the triangles of the previous one.
+		static const float LODReduction;
+		// The LODs are not simplified beyond this error, relative to the size of the mesh.
+		static const float MaxLODError;
+
+		// Outputs the simplified indices and returns the error in the units of the positions. Stops at the
+		// target index count or at the target error (relative to the size of the mesh), whichever comes first.
+		// Positions are three floats, vertexStride apart (in bytes).
+		DLL_EXPORT static float Simplify(const std::uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+			size_t vertexStride, const Attributes &attributes, size_t targetIndexCount, float targetError, std::vector<std::uint32_t> *outIndices);
+
+		// Outputs up to lodCount - 1 simplified versions (the full mesh is the first LOD), the chain ends
+		// early once the mesh can not be simplified further.
+		DLL_EXPORT static void BuildLODChain(const std::uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+			size_t vertexStride, const Attributes &attributes, UINT lodCount, std::vector<MeshLOD> *outLODs);
+		// Normals and texture coordinates are preserved.
+		DLL_EXPORT static void BuildLODChain(const GeometryGenerator::StaticMeshData &mesh, UINT lodCount, std::vector<MeshLOD> *outLODs);
+
+		// Index of the coarsest LOD whose error is not bigger than maxPixelError on the screen, for a mesh drawn with the
+		// given scale at the given distance. The errors grow with the levels, the first one is the full mesh.
+		DLL_EXPORT static size_t SelectLOD(const std::vector<SubmeshLOD> &lods, float distance, float scale, float pixelsPerUnit, float maxPixelError);
+	};
+}
+
+#endif
@@ -0,0 +1,277 @@
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	// Cones wider than this (the smallest cosine between a normal and the axis) are not worth testing.
+	const float MinConeCosine = 0.1f;
+	// Weights of the normal spread and of the distance against one new vertex when the meshlets grow.
+	const float ConeWeight = 1.0f;
+	const float DistanceWeight = 0.5f;
+
+	XMVECTOR LoadPosition(const float *positions, size_t vertexStride, uint32_t index)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3 *>(reinterpret_cast<const uint8_t *>(positions) + index * vertexStride));
+	}
+
+	// Bounding sphere of the used vertices and the normal cone of the triangles.
+	void ComputeBounds(const uint32_t *indices, const float *positions, size_t vertexStride, Meshlet *meshlet)
+	{
+		const uint32_t *first = indices + meshlet->StartIndexLocation;
+		vector<uint32_t> meshletVertices(first, first + meshlet->IndexCount);
+		sort(meshletVertices.begin(), meshletVertices.end());
+		meshletVertices.erase(unique(meshletVertices.begin(), meshletVertices.end()), meshletVertices.end());
+		vector<XMFLOAT3> points(meshletVertices.size());
+		for (size_t i = 0; i < meshletVertices.size(); ++i)
+			XMStoreFloat3(&points[i], LoadPosition(positions, vertexStride, meshletVertices[i]));
+		BoundingSphere::CreateFromPoints(meshlet->Bounds, points.size(), points.data(), sizeof(XMFLOAT3));
+
+		UINT triangleCount = meshlet->IndexCount / 3;
+		vector<XMFLOAT3> normals;
+		normals.reserve(triangleCount);
+		XMVECTOR normalSum = XMVectorZero();
+		for (UINT t = 0; t < triangleCount; ++t)
+		{
+			const uint32_t *tri = first + t * 3;
+			XMVECTOR p0 = LoadPosition(positions, vertexStride, tri[0]);
+			XMVECTOR p1 = LoadPosition(positions, vertexStride, tri[1]);
+			XMVECTOR p2 = LoadPosition(positions, vertexStride, tri[2]);
+			// Clockwise triangles are the front ones, this normal points out of them
+			XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+			if (XMVectorGetX(XMVector3LengthSq(normal)) < 1e-20f)
+				continue; // degenerate triangles face nowhere
+			normal = XMVector3Normalize(normal);
+			normals.push_back(XMFLOAT3());
+			XMStoreFloat3(&normals.back(), normal);
+			normalSum += normal;
+		}
+
+		meshlet->ConeAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		meshlet->ConeCutoff = 1.0f;
+		if (normals.empty() || XMVectorGetX(XMVector3LengthSq(normalSum)) < 1e-12f)
+			return;
+
+		XMVECTOR axis = XMVector3Normalize(normalSum);
+		float minCosine = 1.0f;
+		for (const XMFLOAT3 &normal : normals)
+			minCosine = min(minCosine, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normal), axis)));
+		if (minCosine <= MinConeCosine)
+			return;
+
+		// Apex of the cone, the planes of all the triangles are in front of it
+		XMVECTOR center = XMLoadFloat3(&meshlet->Bounds.Center);
+		float maxDistance = 0.0f;
+		for (UINT t = 0; t < triangleCount; ++t)
+		{
+			const uint32_t *tri = first + t * 3;
+			XMVECTOR p0 = LoadPosition(positions, vertexStride, tri[0]);
+			XMVECTOR normal = XMVector3Cross(LoadPosition(positions, vertexStride, tri[1]) - p0, LoadPosition(positions, vertexStride, tri[2]) - p0);
+			float alongAxis = XMVectorGetX(XMVector3Dot(normal, axis));
+			if (alongAxis <= 0.0f)
+				continue;
+			float distance = XMVectorGetX(XMVector3Dot(center - p0, normal)) / alongAxis;
+			maxDistance = max(maxDistance, distance);
+		}
+
+		XMStoreFloat3(&meshlet->ConeAxis, axis);
+		XMStoreFloat3(&meshlet->ConeApex, center - axis * maxDistance);
+		meshlet->ConeCutoff = sqrtf(1.0f - minCosine * minCosine);
+	}
+}
+
+void MeshletBuilder::Build(uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+	size_t vertexStride, vector<Meshlet> *outMeshlets)
+{
+	outMeshlets->clear();
+	UINT triangleCount = (UINT)(indexCount / 3);
+
+	// Triangles that use each vertex
+	vector<UINT> vertexTriangleStarts(vertexCount + 1, 0);
+	for (UINT i = 0; i < triangleCount * 3; ++i)
+		vertexTriangleStarts[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; ++v)
+		vertexTriangleStarts[v + 1] += vertexTriangleStarts[v];
+	vector<UINT> vertexTriangles(triangleCount * 3);
+	vector<UINT> vertexTriangleFill(vertexTriangleStarts.begin(), vertexTriangleStarts.end() - 1);
+	for (UINT i = 0; i < triangleCount * 3; ++i)
+		vertexTriangles[vertexTriangleFill[indices[i]]++] = i / 3;
+	// Triangles of each vertex that are not in a meshlet yet
+	vector<UINT> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+		liveTriangles[v] = vertexTriangleStarts[v + 1] - vertexTriangleStarts[v];
+
+	// Normals and centers of the triangles, and the radius a meshlet of the average triangles would have
+	vector<XMFLOAT3> triangleNormals(triangleCount);
+	vector<XMFLOAT3> triangleCenters(triangleCount);
+	float areaSum = 0.0f;
+	for (UINT t = 0; t < triangleCount; ++t)
+	{
+		XMVECTOR p0 = LoadPosition(positions, vertexStride, indices[t * 3 + 0]);
+		XMVECTOR p1 = LoadPosition(positions, vertexStride, indices[t * 3 + 1]);
+		XMVECTOR p2 = LoadPosition(positions, vertexStride, indices[t * 3 + 2]);
+		XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+		float doubleArea = XMVectorGetX(XMVector3Length(normal));
+		areaSum += 0.5f * doubleArea;
+		XMStoreFloat3(&triangleNormals[t], (doubleArea > 0.0f) ? normal / doubleArea : XMVectorZero());
+		XMStoreFloat3(&triangleCenters[t], (p0 + p1 + p2) / 3.0f);
+	}
+	float expectedRadius = max(0.5f * sqrtf(areaSum / max(triangleCount, 1U) * MaxTriangles), 1e-6f);
+
+	// Meshlets grow from the first triangle left in the (vertex cache) order, over the triangles that share vertices
+	// with them. Those that add the fewest vertices and keep the normals and the positions close are taken first.
+	vector<bool> used(triangleCount, false);
+	vector<UINT> vertexMeshlet(vertexCount, UINT_MAX);
+	// Index of each vertex in its meshlet
+	vector<UINT> vertexLocalIndex(vertexCount);
+	vector<UINT> meshletVertices, meshletTriangles;
+	vector<uint32_t> localIndices;
+	vector<uint32_t> ordered;
+	ordered.reserve(triangleCount * 3);
+	UINT seed = 0;
+	while (true)
+	{
+		while (seed < triangleCount && used[seed])
+			seed++;
+		if (seed == triangleCount)
+			break;
+
+		UINT meshletIndex = (UINT)outMeshlets->size();
+		meshletVertices.clear();
+		meshletTriangles.clear();
+		XMVECTOR normalSum = XMVectorZero();
+		XMVECTOR centerSum = XMVectorZero();
+		UINT next = seed;
+		while (next != UINT_MAX)
+		{
+			used[next] = true;
+			meshletTriangles.push_back(next);
+			for (UINT k = 0; k < 3; ++k)
+			{
+				uint32_t index = indices[next * 3 + k];
+				liveTriangles[index]--;
+				if (vertexMeshlet[index] == meshletIndex)
+					continue;
+				vertexMeshlet[index] = meshletIndex;
+				vertexLocalIndex[index] = (UINT)meshletVertices.size();
+				meshletVertices.push_back(index);
+			}
+			normalSum += XMLoadFloat3(&triangleNormals[next]);
+			centerSum += XMLoadFloat3(&triangleCenters[next]);
+			if (meshletTriangles.size() == MaxTriangles)
+				break;
+
+			XMVECTOR axis = XMVector3Normalize(normalSum);
+			XMVECTOR center = centerSum / (float)meshletTriangles.size();
+			next = UINT_MAX;
+			float bestScore = FLT_MAX;
+			for (UINT v : meshletVertices)
+			{
+				if (liveTriangles[v] == 0)
+					continue;
+				for (UINT i = vertexTriangleStarts[v]; i < vertexTriangleStarts[v + 1]; ++i)
+				{
+					UINT t = vertexTriangles[i];
+					if (used[t])
+						continue;
+
+					uint32_t a = indices[t * 3 + 0], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+					UINT newVertices = (vertexMeshlet[a] != meshletIndex) + (vertexMeshlet[b] != meshletIndex && b != a) +
+						(vertexMeshlet[c] != meshletIndex && c != a && c != b);
+					if (meshletVertices.size() + newVertices > MaxVertices || newVertices >= bestScore)
+						continue;
+
+					float spread = 1.0f - XMVectorGetX(XMVector3Dot(XMLoadFloat3(&triangleNormals[t]), axis));
+					float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&triangleCenters[t]) - center)) / expectedRadius;
+					float score = newVertices + ConeWeight * spread + DistanceWeight * distance;
+					if (score < bestScore)
+					{
+						bestScore = score;
+						next = t;
+					}
+				}
+			}
+		}
+
+		// The growth order jumps around, the triangles are ordered for the vertex cache again. Only the vertices of
+		// the meshlet are numbered, so the pass does not depend on the size of the mesh.
+		localIndices.clear();
+		for (UINT t : meshletTriangles)
+		{
+			for (UINT k = 0; k < 3; ++k)
+				localIndices.push_back(vertexLocalIndex[indices[t * 3 + k]]);
+		}
+		MeshOptimizer::OptimizeVertexCache(localIndices.data(), localIndices.size(), meshletVertices.size());
+
+		Meshlet meshlet;
+		meshlet.StartIndexLocation = (UINT)ordered.size();
+		meshlet.IndexCount = (UINT)localIndices.size();
+		for (uint32_t index : localIndices)
+			ordered.push_back(meshletVertices[index]);
+		outMeshlets->push_back(meshlet);
+	}
+
+	copy(ordered.begin(), ordered.end(), indices);
+	for (Meshlet &meshlet : *outMeshlets)
+		ComputeBounds(indices, positions, vertexStride, &meshlet);
+}
+
+void MeshletBuilder::Build(GeometryGenerator::StaticMeshData *mesh, size_t indexCount, vector<Meshlet> *outMeshlets)
+{
+	outMeshlets->clear();
+	if (mesh->Vertices.empty())
+		return;
+	Build(mesh->Indices32.data(), indexCount, &mesh->Vertices[0].Position.x, mesh->Vertices.size(),
+		sizeof(GeometryGenerator::StaticVertex), outMeshlets);
+}
+
+void MeshletBuilder::Cull(const vector<Meshlet> &meshlets, const BoundingFrustum &localFrustum, const XMFLOAT3 &scale, vector<IndexRange> *outRanges)
+{
+	outRanges->clear();
+
+	XMVECTOR planes[6];
+	localFrustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+	XMVECTOR cameraPosition = XMLoadFloat3(&localFrustum.Origin);
+	XMVECTOR scaleV = XMLoadFloat3(&scale);
+	float maxScale = max(max(scale.x, scale.y), scale.z);
+	float minScale = min(min(scale.x, scale.y), scale.z);
+	// The normals keep their directions only if the scale is uniform
+	bool testCones = (maxScale - minScale) <= 1e-4f * maxScale;
+
+	for (const Meshlet &meshlet : meshlets)
+	{
+		BoundingSphere bounds;
+		XMStoreFloat3(&bounds.Center, XMVectorMultiply(XMLoadFloat3(&meshlet.Bounds.Center), scaleV));
+		bounds.Radius = meshlet.Bounds.Radius * maxScale;
+		if (bounds.ContainedBy(planes[0], planes[1], planes[2], planes[3], planes[4], planes[5]) == DISJOINT)
+			continue;
+
+		if (testCones && meshlet.ConeCutoff < 1.0f)
+		{
+			// All of the triangles face away if the camera looks at the apex along the cone
+			XMVECTOR toApex = XMVector3Normalize(XMVectorMultiply(XMLoadFloat3(&meshlet.ConeApex), scaleV) - cameraPosition);
+			if (XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&meshlet.ConeAxis))) >= meshlet.ConeCutoff)
+				continue;
+		}
+
+		// Merge with the previous range if they touch
+		if (!outRanges->empty() && outRanges->back().StartIndexLocation + outRanges->back().IndexCount == meshlet.StartIndexLocation)
+		{
+			outRanges->back().IndexCount += meshlet.IndexCount;
+		}
+		else
+		{
+			IndexRange range;
+			range.IndexCount = meshlet.IndexCount;
+			range.StartIndexLocation = meshlet.StartIndexLocation;
+			outRanges->push_back(range);
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "DirectXHeaders.h"
+#include "GenericShaderStructures.h"
+#include "GeometryGenerator.h"
+
+namespace Speck
+{
+	//-------------------------------------------------------------------------------------
+	//	Splits indexed triangle lists into meshlets of up to MaxVertices vertices and
+	//	MaxTriangles triangles that lie close together and face the same way, and moves the
+	//	triangles of each meshlet together in the index buffer. Each meshlet gets a bounding
+	//	sphere and a cone of its normals, which the CPU culling uses to skip the clusters
+	//	that are outside of the frustum or that face away from the camera.
+	//-------------------------------------------------------------------------------------
+	class MeshletBuilder
+	{
+	public:
+		static const UINT MaxVertices = 64;
+		static const UINT MaxTriangles = 124;
+
+		// Meshlets of the first indexCount indices, their triangles are moved together in the index buffer.
+		// Positions are three floats, vertexStride apart (in bytes).
+		DLL_EXPORT static void Build(std::uint32_t *indices, size_t indexCount, const float *positions, size_t vertexCount,
+			size_t vertexStride, std::vector<Meshlet> *outMeshlets);
+		DLL_EXPORT static void Build(GeometryGenerator::StaticMeshData *mesh, size_t indexCount, std::vector<Meshlet> *outMeshlets);
+
+		// Outputs the index ranges of the visible meshlets, the neighbouring ones are merged. The frustum (and its origin,
+		// the camera) is in the space of the mesh without its scale. The cone test is skipped for non-uniform scales.
+		DLL_EXPORT static void Cull(const std::vector<Meshlet> &meshlets, const DirectX::BoundingFrustum &localFrustum,
+			const DirectX::XMFLOAT3 &scale, std::vector<IndexRange> *outRanges);
+	};
+}
+
+#endif
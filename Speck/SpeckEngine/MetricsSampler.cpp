@@ -0,0 +1,225 @@
+#include "MetricsSampler.h"
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#ifdef _WIN32
+#include "SpeckEngineDefinitions.h"
+#include <psapi.h>
+#include <pdh.h>
+#pragma comment(lib, "pdh.lib")
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdio>
+#endif
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	const char *gMetricNames[] = { "FrameTime", "CpuTime", "ResidentMemory", "PageFaults", "ContextSwitches" };
+	const char *gMetricUnits[] = { "ms", "ms", "MB", "count", "count" };
+
+	// Nearest rank percentile of the sorted values.
+	double Percentile(const vector<double> &sortedValues, double percentile)
+	{
+		size_t rank = (size_t)ceil(percentile * sortedValues.size());
+		return sortedValues[max(rank, (size_t)1) - 1];
+	}
+}
+
+#ifdef _WIN32
+struct MetricsSampler::PlatformData
+{
+	PDH_HQUERY Query = NULL;
+	PDH_HCOUNTER ContextSwitches = NULL;
+};
+
+bool MetricsSampler::ReadCounters(Counters *outCounters)
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return false;
+	ULARGE_INTEGER kernel, user;
+	memcpy(&kernel, &kernelTime, sizeof(FILETIME));
+	memcpy(&user, &userTime, sizeof(FILETIME));
+	outCounters->CpuTime = (kernel.QuadPart + user.QuadPart) * 1e-7; // in 100 ns units
+
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return false;
+	outCounters->ResidentBytes = pmc.WorkingSetSize;
+	outCounters->PageFaults = pmc.PageFaultCount;
+
+	// The raw value of a rate counter is the count itself. Windows does not count the switches per process.
+	PDH_RAW_COUNTER rawValue;
+	if (mPlatformData->Query && PdhCollectQueryData(mPlatformData->Query) == ERROR_SUCCESS &&
+		PdhGetRawCounterValue(mPlatformData->ContextSwitches, NULL, &rawValue) == ERROR_SUCCESS)
+		outCounters->ContextSwitches = (UINT64)rawValue.FirstValue;
+	return true;
+}
+#else
+struct MetricsSampler::PlatformData
+{
+	// Kept open, reading it again is much cheaper than opening it every frame.
+	int Statm = -1;
+};
+
+bool MetricsSampler::ReadCounters(Counters *outCounters)
+{
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return false;
+	outCounters->CpuTime = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+	outCounters->PageFaults = (uint64_t)(usage.ru_minflt + usage.ru_majflt);
+	outCounters->ContextSwitches = (uint64_t)(usage.ru_nvcsw + usage.ru_nivcsw);
+
+	// getrusage only knows the peak resident size, the current one is in /proc
+	char buffer[128];
+	ssize_t length = (mPlatformData->Statm >= 0) ? pread(mPlatformData->Statm, buffer, sizeof(buffer) - 1, 0) : -1;
+	if (length <= 0)
+		return false;
+	buffer[length] = '\0';
+	unsigned long long size = 0, resident = 0;
+	if (sscanf(buffer, "%llu %llu", &size, &resident) != 2)
+		return false;
+	outCounters->ResidentBytes = resident * (uint64_t)sysconf(_SC_PAGESIZE);
+	return true;
+}
+#endif
+
+MetricsSampler::MetricsSampler(uint32_t historySize)
+	: mRecords(max(historySize, 1u)),
+	mPlatformData(make_unique<PlatformData>()),
+	mStartTime(chrono::steady_clock::now())
+{
+#ifdef _WIN32
+	if (PdhOpenQuery(NULL, 0, &mPlatformData->Query) != ERROR_SUCCESS ||
+		PdhAddEnglishCounter(mPlatformData->Query, L"\\System\\Context Switches/sec", 0, &mPlatformData->ContextSwitches) != ERROR_SUCCESS)
+	{
+		LOG(L"Context switches will not be sampled.", WARNING);
+		if (mPlatformData->Query)
+			PdhCloseQuery(mPlatformData->Query);
+		mPlatformData->Query = NULL;
+	}
+#else
+	mPlatformData->Statm = open("/proc/self/statm", O_RDONLY);
+#endif
+	ReadCounters(&mLastCounters);
+	mMemory.Set(mRecords);
+}
+
+MetricsSampler::~MetricsSampler()
+{
+#ifdef _WIN32
+	if (mPlatformData->Query)
+		PdhCloseQuery(mPlatformData->Query);
+#else
+	if (mPlatformData->Statm >= 0)
+		close(mPlatformData->Statm);
+#endif
+}
+
+void MetricsSampler::Sample(double frameTime)
+{
+	Counters counters;
+	if (!ReadCounters(&counters))
+		counters = mLastCounters;
+
+	Record &record = mRecords[mWrittenCount % mRecords.size()];
+	record.Time = chrono::duration<double>(chrono::steady_clock::now() - mStartTime).count();
+	record.Values[(uint32_t)Metric::FrameTime] = frameTime;
+	record.Values[(uint32_t)Metric::CpuTime] = (counters.CpuTime - mLastCounters.CpuTime) * 1000.0;
+	record.Values[(uint32_t)Metric::ResidentMemory] = counters.ResidentBytes / (1024.0 * 1024.0);
+	record.Values[(uint32_t)Metric::PageFaults] = (double)(counters.PageFaults - mLastCounters.PageFaults);
+	record.Values[(uint32_t)Metric::ContextSwitches] = (double)(counters.ContextSwitches - mLastCounters.ContextSwitches);
+	++mWrittenCount;
+	mLastCounters = counters;
+}
+
+void MetricsSampler::GetSummary(vector<MetricSummary> *outSummary) const
+{
+	outSummary->clear();
+	uint32_t count = GetSampleCount();
+	vector<double> values(count);
+	for (uint32_t m = 0; m < (uint32_t)Metric::Count; ++m)
+	{
+		MetricSummary summary = {};
+		summary.Name = gMetricNames[m];
+		summary.Unit = gMetricUnits[m];
+		summary.Count = count;
+		if (count > 0)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+				values[i] = mRecords[(GetFirstIndex() + i) % mRecords.size()].Values[m];
+			summary.Last = values.back();
+			sort(values.begin(), values.end());
+			summary.P50 = Percentile(values, 0.50);
+			summary.P95 = Percentile(values, 0.95);
+			summary.P99 = Percentile(values, 0.99);
+			summary.Max = values.back();
+		}
+		outSummary->push_back(summary);
+	}
+}
+
+bool MetricsSampler::ExportCSV(const string &path) const
+{
+	ofstream file(path, ios::out | ios::trunc);
+	if (!file)
+		return false;
+
+	file << "Time";
+	for (uint32_t m = 0; m < (uint32_t)Metric::Count; ++m)
+		file << "," << gMetricNames[m];
+	file << "\n" << fixed << setprecision(3);
+	for (uint64_t i = GetFirstIndex(); i < mWrittenCount; ++i)
+	{
+		const Record &record = mRecords[i % mRecords.size()];
+		file << record.Time;
+		for (uint32_t m = 0; m < (uint32_t)Metric::Count; ++m)
+			file << "," << record.Values[m];
+		file << "\n";
+	}
+	return file.good();
+}
+
+bool MetricsSampler::ExportJSON(const string &path) const
+{
+	ofstream file(path, ios::out | ios::trunc);
+	if (!file)
+		return false;
+
+	// The summaries first, then the samples as a column per metric
+	vector<MetricSummary> summary;
+	GetSummary(&summary);
+	file << fixed << setprecision(3);
+	file << "{\"summary\":[";
+	for (size_t m = 0; m < summary.size(); ++m)
+	{
+		const MetricSummary &s = summary[m];
+		file << (m ? "," : "") << "\n{\"name\":\"" << s.Name << "\",\"unit\":\"" << s.Unit << "\",\"count\":" << s.Count
+			<< ",\"last\":" << s.Last << ",\"p50\":" << s.P50 << ",\"p95\":" << s.P95 << ",\"p99\":" << s.P99 << ",\"max\":" << s.Max << "}";
+	}
+	file << "\n],\"samples\":{\n\"Time\":[";
+	for (uint64_t i = GetFirstIndex(); i < mWrittenCount; ++i)
+		file << (i > GetFirstIndex() ? "," : "") << mRecords[i % mRecords.size()].Time;
+	file << "]";
+	for (uint32_t m = 0; m < (uint32_t)Metric::Count; ++m)
+	{
+		file << ",\n\"" << gMetricNames[m] << "\":[";
+		for (uint64_t i = GetFirstIndex(); i < mWrittenCount; ++i)
+			file << (i > GetFirstIndex() ? "," : "") << mRecords[i % mRecords.size()].Values[m];
+		file << "]";
+	}
+	file << "\n}}\n";
+	return file.good();
+}
+
+void MetricsSampler::Clear()
+{
+	mWrittenCount = 0;
+}
@@ -0,0 +1,97 @@
+#ifndef METRICS_SAMPLER_H
+#define METRICS_SAMPLER_H
+
+// No SpeckEngineDefinitions.h here, the sampler does not depend on Windows outside of its source file.
+#include "MemoryTracker.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+namespace Speck
+{
+	enum class Metric
+	{
+		FrameTime,			// milliseconds
+		CpuTime,			// milliseconds of the CPU time of the process since the last sample
+		ResidentMemory,		// megabytes of the physical memory used by the process
+		PageFaults,			// since the last sample
+		ContextSwitches,	// since the last sample (of the whole system on Windows)
+		Count
+	};
+
+	// Kept samples of a metric.
+	struct MetricSummary
+	{
+		std::string Name;
+		std::string Unit;
+		uint32_t Count;
+		double Last;
+		double P50;
+		double P95;
+		double P99;
+		double Max;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Samples the counters of the process once per frame and keeps the latest samples
+	//	in a ring buffer. Uses getrusage and /proc on Linux, PSAPI and PDH on Windows.
+	//	The kept samples can be summarized to percentiles or written to a CSV or a JSON
+	//	file, e.g. at the end of a soak test.
+	//-------------------------------------------------------------------------------------
+	class MetricsSampler
+	{
+	public:
+		DLL_EXPORT MetricsSampler(uint32_t historySize = 1 << 14);
+		DLL_EXPORT ~MetricsSampler();
+		// Make these inaccessible.
+		MetricsSampler(const MetricsSampler &sampler) = delete;
+		MetricsSampler &operator=(const MetricsSampler &sampler) = delete;
+
+		// Records a frame that took the given time, with the counters of the process at its end.
+		DLL_EXPORT void Sample(double frameTime);
+		// Summaries of the metrics, in the order of the enum.
+		DLL_EXPORT void GetSummary(std::vector<MetricSummary> *outSummary) const;
+		// Write all the kept samples. Return false if the file could not be written.
+		DLL_EXPORT bool ExportCSV(const std::string &path) const;
+		DLL_EXPORT bool ExportJSON(const std::string &path) const;
+		// Drops the kept samples.
+		DLL_EXPORT void Clear();
+
+		uint32_t GetHistorySize() const { return (uint32_t)mRecords.size(); }
+		uint32_t GetSampleCount() const { return (uint32_t)(mWrittenCount < mRecords.size() ? mWrittenCount : mRecords.size()); }
+
+	private:
+		struct Record
+		{
+			// Seconds since the sampler was created.
+			double Time;
+			double Values[(uint32_t)Metric::Count];
+		};
+
+		// Cumulative counters of the process, read from the system.
+		struct Counters
+		{
+			double CpuTime = 0.0;
+			uint64_t ResidentBytes = 0;
+			uint64_t PageFaults = 0;
+			uint64_t ContextSwitches = 0;
+		};
+		// System handles, if the platform needs any.
+		struct PlatformData;
+
+		bool ReadCounters(Counters *outCounters);
+		// Index of the oldest kept sample.
+		uint64_t GetFirstIndex() const { return mWrittenCount - GetSampleCount(); }
+
+		std::vector<Record> mRecords;
+		uint64_t mWrittenCount = 0;
+		Counters mLastCounters;
+		std::unique_ptr<PlatformData> mPlatformData;
+		std::chrono::steady_clock::time_point mStartTime;
+		MemoryAllocation mMemory{ MemoryTag::Diagnostics };
+	};
+}
+
+#endif
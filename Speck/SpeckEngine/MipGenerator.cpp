@@ -0,0 +1,280 @@
+#include "MipGenerator.h"
+#include "WorkerPool.h"
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	const float Pi = 3.14159265358979f;
+	// Kaiser filter parameters (the width is in the texels of the smaller mip).
+	const float KaiserWidth = 3.0f;
+	const float KaiserAlpha = 4.0f;
+
+	// RGBA in float, rows tightly packed.
+	struct FloatImage
+	{
+		UINT width;
+		UINT height;
+		vector<float> data;
+	};
+
+	// Source texel and its weight for one of the destination texels.
+	struct Tap
+	{
+		UINT index;
+		float weight;
+	};
+
+	float BesselI0(float x)
+	{
+		// Power series, converges quickly for the arguments used here
+		float sum = 1.0f, term = 1.0f, halfX = 0.5f * x;
+		for (int k = 1; k < 32 && term > sum * 1e-8f; ++k)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	float Sinc(float x)
+	{
+		if (fabsf(x) < 1e-5f)
+			return 1.0f;
+		return sinf(Pi * x) / (Pi * x);
+	}
+
+	float Kaiser(float t)
+	{
+		float r = t / KaiserWidth;
+		if (fabsf(r) >= 1.0f)
+			return 0.0f;
+		return Sinc(t) * BesselI0(KaiserAlpha * sqrtf(1.0f - r * r)) / BesselI0(KaiserAlpha);
+	}
+
+	// Weights of the source texels for every destination texel of one dimension, normalized to
+	// sum up to 1. The box filter uses the exact coverage, so odd sizes are handled too.
+	void ComputeTaps(UINT srcSize, UINT dstSize, MipGenerator::Filter filter, bool wrap, vector<UINT> *outTapStarts, vector<Tap> *outTaps)
+	{
+		float scale = (float)srcSize / dstSize;
+		float radius = ((filter == MipGenerator::Filter::Box) ? 0.5f : KaiserWidth) * scale;
+
+		outTapStarts->resize(dstSize + 1);
+		outTaps->clear();
+		for (UINT dst = 0; dst < dstSize; ++dst)
+		{
+			(*outTapStarts)[dst] = (UINT)outTaps->size();
+			float center = (dst + 0.5f) * scale;
+			int first = (int)floorf(center - radius);
+			int last = (int)ceilf(center + radius);
+			float sum = 0.0f;
+			for (int src = first; src <= last; ++src)
+			{
+				float weight;
+				if (filter == MipGenerator::Filter::Box)
+					weight = max(0.0f, min((float)src + 1.0f, center + radius) - max((float)src, center - radius));
+				else
+					weight = Kaiser((src + 0.5f - center) / scale);
+				if (weight == 0.0f)
+					continue;
+
+				int index = wrap ? ((src % (int)srcSize) + (int)srcSize) % (int)srcSize : min(max(src, 0), (int)srcSize - 1);
+				outTaps->push_back({ (UINT)index, weight });
+				sum += weight;
+			}
+
+			for (UINT i = (*outTapStarts)[dst]; i < outTaps->size(); ++i)
+				(*outTaps)[i].weight /= sum;
+		}
+		(*outTapStarts)[dstSize] = (UINT)outTaps->size();
+	}
+
+	float SRGBToLinear(float c)
+	{
+		return (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSRGB(float c)
+	{
+		return (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	uint8_t ToUnorm8(float v)
+	{
+		v = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+		return (uint8_t)(v * 255.0f + 0.5f);
+	}
+
+	void Decode(const uint8_t *rgba, UINT rowPitch, const MipGenerator::Settings &settings, FloatImage *outImage)
+	{
+		float toLinear[256];
+		for (int i = 0; i < 256; ++i)
+		{
+			float c = i / 255.0f;
+			toLinear[i] = settings.normalMap ? c * 2.0f - 1.0f : (settings.sRGB ? SRGBToLinear(c) : c);
+		}
+
+		for (UINT y = 0; y < outImage->height; ++y)
+		{
+			const uint8_t *row = rgba + (size_t)y * rowPitch;
+			float *outRow = &outImage->data[(size_t)y * outImage->width * 4];
+			for (UINT x = 0; x < outImage->width; ++x)
+			{
+				for (int ch = 0; ch < 3; ++ch)
+					outRow[x * 4 + ch] = toLinear[row[x * 4 + ch]];
+				outRow[x * 4 + 3] = row[x * 4 + 3] / 255.0f;
+			}
+		}
+	}
+
+	void Encode(const FloatImage &image, const MipGenerator::Settings &settings, MipGenerator::Mip *outMip)
+	{
+		outMip->width = image.width;
+		outMip->height = image.height;
+		outMip->rgba.resize(image.data.size());
+		for (size_t i = 0; i < image.data.size(); i += 4)
+		{
+			for (int ch = 0; ch < 3; ++ch)
+			{
+				float c = image.data[i + ch];
+				if (settings.normalMap)
+					c = c * 0.5f + 0.5f;
+				else if (settings.sRGB)
+					c = LinearToSRGB(max(c, 0.0f));
+				outMip->rgba[i + ch] = ToUnorm8(c);
+			}
+			outMip->rgba[i + 3] = ToUnorm8(image.data[i + 3]);
+		}
+	}
+
+	void Renormalize(FloatImage *image)
+	{
+		for (size_t i = 0; i < image->data.size(); i += 4)
+		{
+			float *n = &image->data[i];
+			float lenSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+			if (lenSq > 1e-12f)
+			{
+				float invLen = 1.0f / sqrtf(lenSq);
+				n[0] *= invLen;
+				n[1] *= invLen;
+				n[2] *= invLen;
+			}
+			else
+			{
+				n[0] = 0.0f;
+				n[1] = 0.0f;
+				n[2] = 1.0f; // the normals cancelled out, point away from the surface
+			}
+		}
+	}
+
+	void Downsample(const FloatImage &src, const MipGenerator::Settings &settings, WorkerPool *workerPool, FloatImage *outDst)
+	{
+		outDst->width = max(1U, src.width / 2);
+		outDst->height = max(1U, src.height / 2);
+		outDst->data.resize((size_t)outDst->width * outDst->height * 4);
+
+		vector<UINT> tapStartsX, tapStartsY;
+		vector<Tap> tapsX, tapsY;
+		ComputeTaps(src.width, outDst->width, settings.filter, settings.wrap, &tapStartsX, &tapsX);
+		ComputeTaps(src.height, outDst->height, settings.filter, settings.wrap, &tapStartsY, &tapsY);
+
+		// Horizontal pass
+		FloatImage tmp;
+		tmp.width = outDst->width;
+		tmp.height = src.height;
+		tmp.data.resize((size_t)tmp.width * tmp.height * 4);
+		auto horizontal = [&](UINT begin, UINT end)
+		{
+			for (UINT y = begin; y < end; ++y)
+			{
+				const float *srcRow = &src.data[(size_t)y * src.width * 4];
+				float *tmpRow = &tmp.data[(size_t)y * tmp.width * 4];
+				for (UINT x = 0; x < tmp.width; ++x)
+				{
+					// All four channels of a texel at once
+					__m128 sum = _mm_setzero_ps();
+					for (UINT t = tapStartsX[x]; t < tapStartsX[x + 1]; ++t)
+					{
+						__m128 texel = _mm_loadu_ps(&srcRow[tapsX[t].index * 4]);
+						sum = _mm_add_ps(sum, _mm_mul_ps(texel, _mm_set1_ps(tapsX[t].weight)));
+					}
+					_mm_storeu_ps(&tmpRow[x * 4], sum);
+				}
+			}
+		};
+
+		// Vertical pass
+		auto vertical = [&](UINT begin, UINT end)
+		{
+			for (UINT y = begin; y < end; ++y)
+			{
+				float *dstRow = &outDst->data[(size_t)y * outDst->width * 4];
+				memset(dstRow, 0, outDst->width * 4 * sizeof(float));
+				for (UINT t = tapStartsY[y]; t < tapStartsY[y + 1]; ++t)
+				{
+					const float *tmpRow = &tmp.data[(size_t)tapsY[t].index * tmp.width * 4];
+					__m128 weight = _mm_set1_ps(tapsY[t].weight);
+					for (UINT i = 0; i < outDst->width * 4; i += 4)
+						_mm_storeu_ps(&dstRow[i], _mm_add_ps(_mm_loadu_ps(&dstRow[i]), _mm_mul_ps(_mm_loadu_ps(&tmpRow[i]), weight)));
+				}
+			}
+		};
+
+		if (workerPool)
+		{
+			workerPool->ParallelFor(tmp.height, 16, horizontal);
+			workerPool->ParallelFor(outDst->height, 16, vertical);
+		}
+		else
+		{
+			horizontal(0, tmp.height);
+			vertical(0, outDst->height);
+		}
+
+		if (settings.normalMap)
+			Renormalize(outDst);
+	}
+}
+
+UINT MipGenerator::GetMipCount(UINT width, UINT height)
+{
+	UINT mipCount = 1;
+	while ((max(width, height) >> mipCount) > 0)
+		mipCount++;
+	return mipCount;
+}
+
+void MipGenerator::Generate(const uint8_t *rgba, UINT width, UINT height, UINT rowPitch, const Settings &settings,
+	WorkerPool *workerPool, vector<Mip> *outMips)
+{
+	UINT mipCount = GetMipCount(width, height);
+	outMips->resize(mipCount);
+
+	// The first mip is the image itself
+	Mip &first = (*outMips)[0];
+	first.width = width;
+	first.height = height;
+	first.rgba.resize((size_t)width * height * 4);
+	for (UINT y = 0; y < height; ++y)
+		memcpy(&first.rgba[(size_t)y * width * 4], rgba + (size_t)y * rowPitch, width * 4);
+
+	// The rest are filtered from the previous mip in float, so the rounding errors do not add up
+	FloatImage current;
+	current.width = width;
+	current.height = height;
+	current.data.resize((size_t)width * height * 4);
+	Decode(rgba, rowPitch, settings, &current);
+	for (UINT i = 1; i < mipCount; ++i)
+	{
+		FloatImage next;
+		Downsample(current, settings, workerPool, &next);
+		Encode(next, settings, &(*outMips)[i]);
+		current = move(next);
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include "SpeckEngineDefinitions.h"
+
+namespace Speck
+{
+	class WorkerPool;
+
+	//-------------------------------------------------------------------------------------
+	//	Generates the mip chain of an RGBA8 image on the CPU. Every mip is resampled from
+	//	the previous one with a separable filter, in float and in linear space, four channels
+	//	at a time with SSE, with the rows of each pass split over the worker threads.
+	//-------------------------------------------------------------------------------------
+	class MipGenerator
+	{
+	public:
+		enum struct Filter
+		{
+			Box,	// average of the covered texels, cheap
+			Kaiser	// Kaiser windowed sinc, sharper
+		};
+
+		struct Settings
+		{
+			Filter filter = Filter::Kaiser;
+			// Color is filtered in linear space (alpha is always linear).
+			bool sRGB = false;
+			// RGB holds a normal in [0, 1], the filtered normals are renormalized.
+			bool normalMap = false;
+			// Tiling textures wrap around the edges, the others are clamped.
+			bool wrap = true;
+		};
+
+		struct Mip
+		{
+			UINT width;
+			UINT height;
+			std::vector<uint8_t> rgba; // tightly packed rows
+		};
+
+		// Number of mips down to 1x1.
+		DLL_EXPORT static UINT GetMipCount(UINT width, UINT height);
+
+		// Outputs all the mips, the first one is a copy of the image. The worker pool is optional.
+		DLL_EXPORT static void Generate(const uint8_t *rgba, UINT width, UINT height, UINT rowPitch, const Settings &settings,
+			WorkerPool *workerPool, std::vector<Mip> *outMips);
+	};
+}
+
+#endif
@@ -0,0 +1,266 @@
+#include "OcclusionCuller.h"
+#include <cfloat>
+#include <xmmintrin.h>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+// Vertices closer than this (in the clip space w) are treated as if they were behind the camera.
+static const float NearW = 1e-4f;
+
+const float OcclusionCuller::MinOccluderSize = 0.1f;
+
+namespace
+{
+	inline XMFLOAT4 TransformPoint(float x, float y, float z, const XMFLOAT4X4 &m)
+	{
+		return XMFLOAT4(
+			x * m._11 + y * m._21 + z * m._31 + m._41,
+			x * m._12 + y * m._22 + z * m._32 + m._42,
+			x * m._13 + y * m._23 + z * m._33 + m._43,
+			x * m._14 + y * m._24 + z * m._34 + m._44);
+	}
+
+	inline XMFLOAT4X4 Multiply(const XMFLOAT4X4 &a, const XMFLOAT4X4 &b)
+	{
+		XMFLOAT4X4 result;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+			}
+		}
+		return result;
+	}
+
+	inline float HorizontalMin(__m128 v)
+	{
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(v);
+	}
+
+	inline float HorizontalMax(__m128 v)
+	{
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtss_f32(v);
+	}
+}
+
+OcclusionCuller::OcclusionCuller()
+{
+	UINT width = Width, height = Height;
+	for (;;)
+	{
+		mLevels.push_back(vector<float>(width * height, 1.0f));
+		if (width == 1 && height == 1)
+			break;
+		width = max(1U, width / 2);
+		height = max(1U, height / 2);
+	}
+}
+
+void OcclusionCuller::Begin(const XMFLOAT4X4 &viewProj)
+{
+	mViewProj = viewProj;
+	fill(mLevels[0].begin(), mLevels[0].end(), 1.0f);
+}
+
+void OcclusionCuller::RasterizeOccluder(const float *positions, size_t vertexStride, const void *indices, bool indices32,
+	UINT indexCount, const XMFLOAT4X4 &world)
+{
+	XMFLOAT4X4 worldViewProj = Multiply(world, mViewProj);
+	const uint32_t *indices32Bit = (const uint32_t *)indices;
+	const uint16_t *indices16Bit = (const uint16_t *)indices;
+	for (UINT i = 0; i + 2 < indexCount; i += 3)
+	{
+		XMFLOAT4 clip[3];
+		for (UINT k = 0; k < 3; ++k)
+		{
+			UINT index = indices32 ? indices32Bit[i + k] : indices16Bit[i + k];
+			const float *p = (const float *)((const char *)positions + index * vertexStride);
+			clip[k] = TransformPoint(p[0], p[1], p[2], worldViewProj);
+		}
+		RasterizeTriangle(clip);
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const XMFLOAT4 clip[3])
+{
+	// Triangles that cross the near plane are skipped, leaving the occluders with holes is always safe
+	float x[3], y[3], z[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		if (clip[k].w < NearW)
+			return;
+		float invW = 1.0f / clip[k].w;
+		x[k] = (clip[k].x * invW * 0.5f + 0.5f) * Width;
+		y[k] = (0.5f - clip[k].y * invW * 0.5f) * Height;
+		z[k] = clip[k].z * invW;
+	}
+
+	// Front faces are clockwise on the screen, which is positive here because y points down
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area <= 0.0f)
+		return;
+
+	// Pixels whose centers are inside of the triangle
+	int minX = max(0, (int)ceilf(min(x[0], min(x[1], x[2])) - 0.5f));
+	int maxX = min((int)Width - 1, (int)floorf(max(x[0], max(x[1], x[2])) - 0.5f));
+	int minY = max(0, (int)ceilf(min(y[0], min(y[1], y[2])) - 0.5f));
+	int maxY = min((int)Height - 1, (int)floorf(max(y[0], max(y[1], y[2])) - 0.5f));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// Edge functions of the edges opposite to each vertex, e = a*x + b*y + c, positive inside
+	float a[3], b[3], c[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		int i = (k + 1) % 3, j = (k + 2) % 3;
+		a[k] = y[i] - y[j];
+		b[k] = x[j] - x[i];
+		c[k] = x[i] * y[j] - x[j] * y[i];
+	}
+
+	// The depth is linear on the screen, the farthest depth inside of a pixel is stored so that the test stays conservative
+	float invArea = 1.0f / area;
+	float depthA = (a[0] * z[0] + a[1] * z[1] + a[2] * z[2]) * invArea;
+	float depthB = (b[0] * z[0] + b[1] * z[1] + b[2] * z[2]) * invArea;
+	float depthC = (c[0] * z[0] + c[1] * z[1] + c[2] * z[2]) * invArea + 0.5f * (fabsf(depthA) + fabsf(depthB));
+
+	// Four pixels at a time, starting at a multiple of four
+	int startX = minX & ~3;
+	__m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	__m128 pixelX0 = _mm_add_ps(_mm_set1_ps((float)startX), offsets);
+	__m128 edgeA[3], edgeStep[3];
+	for (int k = 0; k < 3; ++k)
+	{
+		edgeA[k] = _mm_set1_ps(a[k]);
+		edgeStep[k] = _mm_set1_ps(4.0f * a[k]);
+	}
+	__m128 depthStep = _mm_set1_ps(4.0f * depthA);
+	__m128 zero = _mm_setzero_ps();
+	float *depths = mLevels[0].data();
+
+	for (int py = minY; py <= maxY; ++py)
+	{
+		float pixelY = py + 0.5f;
+		__m128 edge[3];
+		for (int k = 0; k < 3; ++k)
+			edge[k] = _mm_add_ps(_mm_mul_ps(edgeA[k], pixelX0), _mm_set1_ps(b[k] * pixelY + c[k]));
+		__m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), pixelX0), _mm_set1_ps(depthB * pixelY + depthC));
+
+		float *row = depths + py * Width;
+		for (int px = startX; px <= maxX; px += 4)
+		{
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)), _mm_cmpge_ps(edge[2], zero));
+			if (_mm_movemask_ps(inside) != 0)
+			{
+				__m128 stored = _mm_loadu_ps(row + px);
+				__m128 nearer = _mm_min_ps(stored, depth);
+				_mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+			}
+			for (int k = 0; k < 3; ++k)
+				edge[k] = _mm_add_ps(edge[k], edgeStep[k]);
+			depth = _mm_add_ps(depth, depthStep);
+		}
+	}
+}
+
+void OcclusionCuller::End()
+{
+	UINT width = Width, height = Height;
+	for (size_t level = 1; level < mLevels.size(); ++level)
+	{
+		const float *source = mLevels[level - 1].data();
+		float *target = mLevels[level].data();
+		UINT targetWidth = max(1U, width / 2), targetHeight = max(1U, height / 2);
+		for (UINT y = 0; y < targetHeight; ++y)
+		{
+			const float *row0 = source + min(2 * y, height - 1) * width;
+			const float *row1 = source + min(2 * y + 1, height - 1) * width;
+			UINT x = 0;
+			if (width >= 8)
+			{
+				// Four target texels from eight source texels of each row
+				for (; x + 4 <= targetWidth; x += 4)
+				{
+					__m128 vertical0 = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x), _mm_loadu_ps(row1 + 2 * x));
+					__m128 vertical1 = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x + 4), _mm_loadu_ps(row1 + 2 * x + 4));
+					__m128 even = _mm_shuffle_ps(vertical0, vertical1, _MM_SHUFFLE(2, 0, 2, 0));
+					__m128 odd = _mm_shuffle_ps(vertical0, vertical1, _MM_SHUFFLE(3, 1, 3, 1));
+					_mm_storeu_ps(target + y * targetWidth + x, _mm_max_ps(even, odd));
+				}
+			}
+			for (; x < targetWidth; ++x)
+			{
+				UINT x0 = min(2 * x, width - 1), x1 = min(2 * x + 1, width - 1);
+				target[y * targetWidth + x] = max(max(row0[x0], row0[x1]), max(row1[x0], row1[x1]));
+			}
+		}
+		width = targetWidth;
+		height = targetHeight;
+	}
+}
+
+bool OcclusionCuller::IsOccluded(const BoundingBox &worldBounds) const
+{
+	// Screen rectangle and the nearest depth of the box, from its eight corners projected four at a time
+	__m128 signs = _mm_setr_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+	__m128 cornerX = _mm_add_ps(_mm_set1_ps(worldBounds.Center.x), _mm_mul_ps(signs, _mm_set1_ps(worldBounds.Extents.x)));
+	__m128 cornerY = _mm_add_ps(_mm_set1_ps(worldBounds.Center.y),
+		_mm_mul_ps(_mm_setr_ps(-1.0f, -1.0f, 1.0f, 1.0f), _mm_set1_ps(worldBounds.Extents.y)));
+	__m128 minSX = _mm_set1_ps(FLT_MAX), maxSX = _mm_set1_ps(-FLT_MAX);
+	__m128 minSY = _mm_set1_ps(FLT_MAX), maxSY = _mm_set1_ps(-FLT_MAX);
+	__m128 minSZ = _mm_set1_ps(FLT_MAX);
+	const XMFLOAT4X4 &m = mViewProj;
+	for (int half = 0; half < 2; ++half)
+	{
+		float cz = worldBounds.Center.z + (half ? worldBounds.Extents.z : -worldBounds.Extents.z);
+		__m128 clipX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cornerX, _mm_set1_ps(m._11)), _mm_mul_ps(cornerY, _mm_set1_ps(m._21))), _mm_set1_ps(cz * m._31 + m._41));
+		__m128 clipY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cornerX, _mm_set1_ps(m._12)), _mm_mul_ps(cornerY, _mm_set1_ps(m._22))), _mm_set1_ps(cz * m._32 + m._42));
+		__m128 clipZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cornerX, _mm_set1_ps(m._13)), _mm_mul_ps(cornerY, _mm_set1_ps(m._23))), _mm_set1_ps(cz * m._33 + m._43));
+		__m128 clipW = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cornerX, _mm_set1_ps(m._14)), _mm_mul_ps(cornerY, _mm_set1_ps(m._24))), _mm_set1_ps(cz * m._34 + m._44));
+		if (_mm_movemask_ps(_mm_cmplt_ps(clipW, _mm_set1_ps(NearW))) != 0)
+			return false;
+		__m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), clipW);
+		__m128 sx = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(clipX, invW), _mm_set1_ps(0.5f * Width)), _mm_set1_ps(0.5f * Width));
+		__m128 sy = _mm_sub_ps(_mm_set1_ps(0.5f * Height), _mm_mul_ps(_mm_mul_ps(clipY, invW), _mm_set1_ps(0.5f * Height)));
+		minSX = _mm_min_ps(minSX, sx);
+		maxSX = _mm_max_ps(maxSX, sx);
+		minSY = _mm_min_ps(minSY, sy);
+		maxSY = _mm_max_ps(maxSY, sy);
+		minSZ = _mm_min_ps(minSZ, _mm_mul_ps(clipZ, invW));
+	}
+	float minX = HorizontalMin(minSX), maxX = HorizontalMax(maxSX);
+	float minY = HorizontalMin(minSY), maxY = HorizontalMax(maxSY);
+	float minZ = HorizontalMin(minSZ);
+	if (maxX < 0.0f || maxY < 0.0f || minX >= Width || minY >= Height)
+		return false;
+
+	// One more pixel on each side covers the edges of the occluders, which are only rasterized at the pixel centers
+	int x0 = max(0, (int)floorf(minX) - 1);
+	int x1 = min((int)Width - 1, (int)floorf(maxX) + 1);
+	int y0 = max(0, (int)floorf(minY) - 1);
+	int y1 = min((int)Height - 1, (int)floorf(maxY) + 1);
+
+	// The level at which the rectangle spans at most two texels in each direction
+	UINT level = 0;
+	while (level + 1 < mLevels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		++level;
+
+	UINT levelWidth = max(1U, Width >> level);
+	const float *depths = mLevels[level].data();
+	for (int y = y0 >> level; y <= y1 >> level; ++y)
+	{
+		for (int x = x0 >> level; x <= x1 >> level; ++x)
+		{
+			if (depths[y * levelWidth + x] >= minZ)
+				return false;
+		}
+	}
+	return true;
+}
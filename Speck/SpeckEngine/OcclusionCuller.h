@@ -0,0 +1,53 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "DirectXHeaders.h"
+
+namespace Speck
+{
+	//-------------------------------------------------------------------------------------
+	//	Rasterizes a few large occluders on the CPU into a small depth buffer and tests
+	//	the bounding boxes of the render items against the hierarchy of its maximal depths,
+	//	so that the items hidden behind the occluders are not drawn at all. The pixels are
+	//	rasterized four at a time with SSE.
+	//-------------------------------------------------------------------------------------
+	class OcclusionCuller
+	{
+	public:
+		static const UINT Width = 256;
+		static const UINT Height = 128;
+		// Only the biggest occluders on the screen are rasterized, and only the simple ones.
+		static const UINT MaxOccluders = 32;
+		static const UINT MaxOccluderTriangles = 256;
+		// Smallest size of an occluder on the screen (its radius divided by its distance).
+		static const float MinOccluderSize;
+
+		DLL_EXPORT OcclusionCuller();
+
+		// Clears the depth buffer, viewProj transforms the world space to the clip space.
+		DLL_EXPORT void Begin(const DirectX::XMFLOAT4X4 &viewProj);
+		// Positions are three floats, vertexStride apart (in bytes). Only the front faces are rasterized.
+		DLL_EXPORT void RasterizeOccluder(const float *positions, size_t vertexStride, const void *indices, bool indices32,
+			UINT indexCount, const DirectX::XMFLOAT4X4 &world);
+		// Builds the hierarchy of the depths, call it after the last occluder.
+		DLL_EXPORT void End();
+
+		// True if the box is behind the occluders. The boxes that cross the near plane are never occluded.
+		DLL_EXPORT bool IsOccluded(const DirectX::BoundingBox &worldBounds) const;
+
+		// Depths of the mip level, rows of (Width >> level) floats.
+		const float *GetDepths(UINT level) const { return mLevels[level].data(); }
+		UINT GetLevelCount() const { return (UINT)mLevels.size(); }
+
+	private:
+		void RasterizeTriangle(const DirectX::XMFLOAT4 clip[3]);
+
+	private:
+		DirectX::XMFLOAT4X4 mViewProj;
+		// The first level is the depth buffer, each next one keeps the largest depth of 2x2 texels of the previous.
+		std::vector<std::vector<float>> mLevels;
+	};
+}
+
+#endif
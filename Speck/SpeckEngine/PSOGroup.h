@@ -4,11 +4,11 @@
 
 #include "SpeckEngineDefinitions.h"
 #include "DirectXHeaders.h"
+#include "FrustumCuller.h"
+#include "RenderItem.h"
 
 namespace Speck
 {
-	struct RenderItem;
-
 	// Pipeline state group
 	struct PSOGroup
 	{
@@ -17,8 +17,16 @@ namespace Speck
 		PSOGroup& operator=(const PSOGroup& v) = delete;
 
 		Microsoft::WRL::ComPtr<ID3D12PipelineState> mPSO;
-		std::vector<std::unique_ptr<RenderItem>> mRItems;
+		// Render items drawn with this PSO, they are kept in the render scene.
+		std::vector<RenderItemHandle> mRItems;
 		bool mVisible = true;
+
+		// World bounds of the render items, in the same order.
+		FrustumCuller mCuller;
+		// Render items whose bounds are updated every frame.
+		std::vector<UINT> mMovingRItems;
+		// Indices of the render items that passed the culling this frame.
+		std::vector<UINT> mVisibleRItems;
 	};
 }
 
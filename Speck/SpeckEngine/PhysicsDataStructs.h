@@ -62,6 +62,31 @@ namespace Speck
 		// Used for rendering
 		UINT mMaterialIndex;
 	};
+
+	// Health of the speck solver in a single frame. The counts are summed over the substeps.
+	struct SolverStats
+	{
+		// Counts the frames the stats were collected in.
+		UINT mFrame = 0;
+		UINT mSpecks = 0;
+		UINT mSubsteps = 0;
+		UINT mSolverIterations = 0;
+		// Specks that did not fit in their grid cell, they do not collide with other specks.
+		UINT mGridOverflowCount = 0;
+		UINT mMaxSpeckContacts = 0;
+		// Per speck and substep.
+		float mAverageSpeckContacts = 0.0f;
+		// Constraints that were found, but there was no room to keep them.
+		UINT mDroppedSpeckContacts = 0;
+		UINT mDroppedStaticColliderContacts = 0;
+		UINT mDroppedRigidBodyConstraints = 0;
+		// Per substep.
+		UINT mActiveSpecks = 0;
+		UINT mSleepingSpecks = 0;
+		// Position correction of a speck in each solver iteration (only the first SOLVER_STATS_MAX_ITERATIONS are recorded).
+		float mAverageResidual[SOLVER_STATS_MAX_ITERATIONS] = {};
+		float mMaxResidual[SOLVER_STATS_MAX_ITERATIONS] = {};
+	};
 }
 
 #endif
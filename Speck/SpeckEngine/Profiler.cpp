@@ -0,0 +1,203 @@
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include <intrin.h>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <iomanip>
+
+using namespace std;
+using namespace Speck;
+
+struct Speck::ProfileThreadEvents
+{
+	UINT ThreadIndex = 0;
+	UINT Depth = 0;
+	// Events before these counts are overwritten or cleared.
+	atomic<UINT64> WrittenCount = { 0 };
+	atomic<UINT64> ClearedCount = { 0 };
+	vector<ProfileEvent> Events = vector<ProfileEvent>(Profiler::RingBufferSize);
+};
+
+namespace
+{
+	// The buffers are kept after their threads end, so their events can still be read
+	mutex gThreadsMutex;
+	vector<unique_ptr<ProfileThreadEvents>> gThreads;
+	thread_local ProfileThreadEvents *tThreadEvents = nullptr;
+
+	// The ticks of the time stamp counter are converted to the time by comparing both to their values at the start
+	const UINT64 gStartTicks = __rdtsc();
+	const chrono::steady_clock::time_point gStartTime = chrono::steady_clock::now();
+
+	ProfileThreadEvents &GetThreadEvents()
+	{
+		if (!tThreadEvents)
+		{
+			lock_guard<mutex> lock(gThreadsMutex);
+			gThreads.push_back(make_unique<ProfileThreadEvents>());
+			gThreads.back()->ThreadIndex = (UINT)gThreads.size() - 1;
+			INT64 size = Profiler::RingBufferSize * sizeof(ProfileEvent);
+			MemoryTracker::Change(MemoryTag::Diagnostics, size, size, 1);
+			tThreadEvents = gThreads.back().get();
+		}
+		return *tThreadEvents;
+	}
+
+	double GetTicksPerMicrosecond()
+	{
+		UINT64 ticks = __rdtsc();
+		double microseconds = chrono::duration<double, micro>(chrono::steady_clock::now() - gStartTime).count();
+		return (microseconds > 0.0 && ticks > gStartTicks) ? (ticks - gStartTicks) / microseconds : 1.0;
+	}
+
+	// Copies the kept events of the thread, without the ones that were overwritten while they were copied.
+	// The events are copied like a seqlock reads: the writer is not stopped, the count is read again after the copy
+	// and the events it shows could have been overwritten are dropped. This relies on the writer storing an event
+	// only after the count that precedes it is visible (true for the x86 and x64 stores, which are not reordered).
+	void ReadEvents(const ProfileThreadEvents &threadEvents, vector<ProfileEvent> *outEvents)
+	{
+		outEvents->clear();
+		UINT64 written = threadEvents.WrittenCount.load(memory_order_acquire);
+		// The slot of the next event is skipped, the writer can already be storing it
+		UINT64 first = max(threadEvents.ClearedCount.load(memory_order_acquire), (written + 1 > Profiler::RingBufferSize) ? written + 1 - Profiler::RingBufferSize : 0);
+		for (UINT64 i = first; i < written; ++i)
+			outEvents->push_back(threadEvents.Events[i % Profiler::RingBufferSize]);
+
+		// The copy is done before the count is read again. With writtenAfter events written, the writer can be
+		// storing event writtenAfter over event writtenAfter - RingBufferSize, so that one is dropped too.
+		atomic_thread_fence(memory_order_acquire);
+		UINT64 writtenAfter = threadEvents.WrittenCount.load(memory_order_relaxed);
+		if (writtenAfter + 1 > first + Profiler::RingBufferSize)
+		{
+			size_t overwritten = (size_t)min<UINT64>(writtenAfter + 1 - Profiler::RingBufferSize - first, outEvents->size());
+			outEvents->erase(outEvents->begin(), outEvents->begin() + overwritten);
+		}
+	}
+
+	// Nearest rank percentile of the sorted values.
+	double Percentile(const vector<double> &sortedValues, double percentile)
+	{
+		size_t rank = (size_t)ceil(percentile * sortedValues.size());
+		return sortedValues[max(rank, (size_t)1) - 1];
+	}
+
+	void WriteJsonString(ostream &stream, const char *str)
+	{
+		stream << '"';
+		for (; *str; ++str)
+		{
+			if (*str == '"' || *str == '\\')
+				stream << '\\';
+			stream << *str;
+		}
+		stream << '"';
+	}
+}
+
+UINT64 Profiler::BeginZone(ProfileThreadEvents **outThreadEvents)
+{
+	ProfileThreadEvents &threadEvents = GetThreadEvents();
+	++threadEvents.Depth;
+	*outThreadEvents = &threadEvents;
+	return __rdtsc();
+}
+
+void Profiler::EndZone(ProfileThreadEvents *threadEvents, const char *name, UINT64 begin)
+{
+	UINT64 end = __rdtsc();
+	--threadEvents->Depth;
+
+	// Only this thread writes to the buffer, the readers see the event once the count is increased
+	UINT64 written = threadEvents->WrittenCount.load(memory_order_relaxed);
+	ProfileEvent &event = threadEvents->Events[written % RingBufferSize];
+	event.Name = name;
+	event.Begin = begin;
+	event.End = end;
+	event.Depth = threadEvents->Depth;
+	threadEvents->WrittenCount.store(written + 1, memory_order_release);
+}
+
+bool Profiler::ExportChromeTrace(const wstring &path)
+{
+	ofstream file(path, ios::out | ios::trunc);
+	if (!file)
+		return false;
+
+	double ticksPerMicrosecond = GetTicksPerMicrosecond();
+	file << fixed << setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	vector<ProfileEvent> events;
+	lock_guard<mutex> lock(gThreadsMutex);
+	for (const auto &threadEvents : gThreads)
+	{
+		// Name the thread, then its complete events
+		file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadEvents->ThreadIndex
+			<< ",\"args\":{\"name\":\"Thread " << threadEvents->ThreadIndex << "\"}}";
+		first = false;
+
+		ReadEvents(*threadEvents, &events);
+		for (const ProfileEvent &event : events)
+		{
+			file << ",\n{\"name\":";
+			WriteJsonString(file, event.Name);
+			file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadEvents->ThreadIndex
+				<< ",\"ts\":" << (double)(INT64)(event.Begin - gStartTicks) / ticksPerMicrosecond
+				<< ",\"dur\":" << (double)(event.End - event.Begin) / ticksPerMicrosecond << "}";
+		}
+	}
+	file << "\n]}\n";
+	return file.good();
+}
+
+void Profiler::GetSummary(vector<ProfileZoneSummary> *outSummary)
+{
+	double ticksPerMicrosecond = GetTicksPerMicrosecond();
+	unordered_map<string, size_t> zoneIndices;
+	vector<vector<double>> durations;
+	outSummary->clear();
+
+	vector<ProfileEvent> events;
+	{
+		lock_guard<mutex> lock(gThreadsMutex);
+		for (const auto &threadEvents : gThreads)
+		{
+			ReadEvents(*threadEvents, &events);
+			for (const ProfileEvent &event : events)
+			{
+				auto inserted = zoneIndices.insert(make_pair(string(event.Name), outSummary->size()));
+				if (inserted.second)
+				{
+					ProfileZoneSummary zone;
+					zone.Name = event.Name;
+					zone.Depth = event.Depth;
+					outSummary->push_back(zone);
+					durations.emplace_back();
+				}
+				size_t index = inserted.first->second;
+				(*outSummary)[index].Depth = min((*outSummary)[index].Depth, event.Depth);
+				durations[index].push_back((event.End - event.Begin) / ticksPerMicrosecond);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < outSummary->size(); ++i)
+	{
+		vector<double> &zoneDurations = durations[i];
+		sort(zoneDurations.begin(), zoneDurations.end());
+		ProfileZoneSummary &zone = (*outSummary)[i];
+		zone.Count = (UINT)zoneDurations.size();
+		zone.P50 = Percentile(zoneDurations, 0.50);
+		zone.P95 = Percentile(zoneDurations, 0.95);
+		zone.P99 = Percentile(zoneDurations, 0.99);
+		zone.Max = zoneDurations.back();
+	}
+}
+
+void Profiler::Clear()
+{
+	lock_guard<mutex> lock(gThreadsMutex);
+	for (const auto &threadEvents : gThreads)
+		threadEvents->ClearedCount.store(threadEvents->WrittenCount.load(memory_order_acquire), memory_order_release);
+}
@@ -0,0 +1,83 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "SpeckEngineDefinitions.h"
+
+// Times the rest of the scope as a zone with the given name, which has to outlive the profiler (a string literal).
+#define PROFILE_ZONE_CONCAT_(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) Speck::ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
+
+namespace Speck
+{
+	// Ring buffer of the events of one thread, only the profiler sees inside.
+	struct ProfileThreadEvents;
+
+	// One timed zone on one thread, in the ticks of the time stamp counter.
+	struct ProfileEvent
+	{
+		const char *Name;
+		UINT64 Begin;
+		UINT64 End;
+		// Number of the zones it is nested in.
+		UINT Depth;
+	};
+
+	// Durations of the recorded events of a zone, in microseconds.
+	struct ProfileZoneSummary
+	{
+		std::string Name;
+		// Smallest nesting depth the zone was seen at.
+		UINT Depth;
+		UINT Count;
+		double P50;
+		double P95;
+		double P99;
+		double Max;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Records the CPU time spent in named zones. Every thread writes the zones it ends
+	//	to its own ring buffer, so the recording takes no locks and only the latest
+	//	events are kept. The buffers are read to export a trace for chrome://tracing or
+	//	Perfetto, or to summarize the durations of each zone.
+	//-------------------------------------------------------------------------------------
+	class Profiler
+	{
+	public:
+		// Number of the slots of the ring buffer of a thread. The latest RingBufferSize - 1 events are read, the slot
+		// after them is the one the thread writes next.
+		static const UINT RingBufferSize = 1 << 14;
+
+		// Returns the time stamp of the beginning of a zone on the calling thread and the buffer of the thread,
+		// which ends the zone without looking the thread up again.
+		DLL_EXPORT static UINT64 BeginZone(ProfileThreadEvents **outThreadEvents);
+		DLL_EXPORT static void EndZone(ProfileThreadEvents *threadEvents, const char *name, UINT64 begin);
+
+		// Writes the kept events of all the threads in the Chrome trace event format. Returns false if the file
+		// could not be written.
+		DLL_EXPORT static bool ExportChromeTrace(const std::wstring &path);
+		// Summaries of the zones, in the order they were first seen.
+		DLL_EXPORT static void GetSummary(std::vector<ProfileZoneSummary> *outSummary);
+		// Drops the kept events.
+		DLL_EXPORT static void Clear();
+	};
+
+	// Times its own lifetime, use it through PROFILE_ZONE.
+	class ProfileZone
+	{
+	public:
+		ProfileZone(const char *name) : mName(name), mBegin(Profiler::BeginZone(&mThreadEvents)) { }
+		~ProfileZone() { Profiler::EndZone(mThreadEvents, mName, mBegin); }
+		// Make these inaccessible.
+		ProfileZone(const ProfileZone &zone) = delete;
+		ProfileZone &operator=(const ProfileZone &zone) = delete;
+
+	private:
+		const char *mName;
+		ProfileThreadEvents *mThreadEvents;
+		UINT64 mBegin;
+	};
+}
+
+#endif
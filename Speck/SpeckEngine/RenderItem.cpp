@@ -5,182 +5,263 @@
 #include "Camera.h"
 #include "DirectXCore.h"
 #include "SpecksHandler.h"
+#include "SpeckWorld.h"
+#include "MeshletBuilder.h"
+#include "OcclusionCuller.h"
+#include "RenderStateCache.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
 using namespace DirectX;
 using namespace Speck;
 
-void SpecksRenderItem::Render(App *app, FrameResource* frameResource, const BoundingFrustum &camFrustum)
+void SpecksRenderItem::Render(App *app, RenderStateCache &state, FrameResource* frameResource)
 {
-	ID3D12GraphicsCommandList *cmdList = GetDirectXCore(app).GetCommandList();
-	cmdList->IASetVertexBuffers(0, 1, &mGeo->VertexBufferView());
-	cmdList->IASetIndexBuffer(&mGeo->IndexBufferView());
-	cmdList->IASetPrimitiveTopology(mPrimitiveType);
+	state.SetGeometry(mGeo);
+	state.SetPrimitiveTopology(mPrimitiveType);
 	// Set the instance buffer to use for this render-item.  For structured buffers, we can bypass 
 	// the heap and set as a root descriptor.
 	auto instancedDataBufferResource = frameResource->Buffers[mBufferIndex].first.Get();
-	cmdList->SetGraphicsRootShaderResourceView((UINT)SpeckApp::MainPassRootParameter::InstancesConstantBuffer, instancedDataBufferResource->GetGPUVirtualAddress());
-	cmdList->DrawIndexedInstanced(mIndexCount, mInstanceCount, mStartIndexLocation, mBaseVertexLocation, 0);
+	state.SetGraphicsRootShaderResourceView((UINT)SpeckApp::MainPassRootParameter::InstancesConstantBuffer, instancedDataBufferResource->GetGPUVirtualAddress());
+	state.DrawIndexedInstanced(mIndexCount, mInstanceCount, mStartIndexLocation, mBaseVertexLocation, 0);
 }
 
-void StaticRenderItem::UpdateBufferCPU(App *app, FrameResource *currentFrameResource)
+void StaticRenderItem::UpdateConstants(FrameResource *currentFrameResource) const
 {
-	// Only update the cbuffer data if the constants have changed.  
-	// This needs to be tracked per frame resource.
-	if (mNumFramesDirty > 0)
+	XMMATRIX world = mW.GetWorldMatrix();
+	XMMATRIX invTransposeWorld = mW.GetInverseWorldMatrix(); // avoid double transposing
+	XMMATRIX texTransform = XMLoadFloat4x4(&mTexTransform);
+
+	RenderItemConstants renderItemConstants;
+	XMStoreFloat4x4(&renderItemConstants.Transform, XMMatrixTranspose(world));
+	XMStoreFloat4x4(&renderItemConstants.InvTransposeTransform, invTransposeWorld); // already transposed
+	XMStoreFloat4x4(&renderItemConstants.TexTransform, XMMatrixTranspose(texTransform));
+	renderItemConstants.MaterialIndex = mMat->MatCBIndex;
+	renderItemConstants.RenderItemType = RENDER_ITEM_TYPE_STATIC;
+	auto upBuff = currentFrameResource->RenderItemConstantsBuffer.get();
+	upBuff->CopyData(mRenderItemBufferIndex, renderItemConstants);
+
+	// The same transforms for the case the item is drawn in an instance batch.
+	StaticInstanceData instanceData;
+	instanceData.Transform = renderItemConstants.Transform;
+	instanceData.InvTransposeTransform = renderItemConstants.InvTransposeTransform;
+	instanceData.TexTransform = renderItemConstants.TexTransform;
+	currentFrameResource->StaticInstanceBuffer->CopyData(mRenderItemBufferIndex, instanceData);
+}
+
+void StaticRenderItem::Render(App *app, RenderStateCache &state, FrameResource* frameResource, const BoundingFrustum &camFrustum)
+{
+	// The whole item was already tested against the frustum by the world.
+	Bind(state, frameResource);
+
+	if (mMeshlets)
+	{
+		// Transform the camera frustum to the object's local space (while ignoring scale).
+		XMVECTOR invRotQuat = XMQuaternionInverse(XMLoadFloat4(&mW.mR));
+		XMVECTOR invTranslation = XMVectorNegate(XMLoadFloat3(&mW.mT));
+		XMMATRIX invWorld = XMMatrixTranslationFromVector(invTranslation) * XMMatrixRotationQuaternion(invRotQuat);
+		BoundingFrustum localSpaceFrustum;
+		camFrustum.Transform(localSpaceFrustum, invWorld);
+		DrawIndexed(state, &localSpaceFrustum, mW.mS);
+	}
+	else
 	{
-		XMMATRIX world = mW.GetWorldMatrix();
-		XMMATRIX invTransposeWorld = mW.GetInverseWorldMatrix(); // avoid double transposing
-		XMMATRIX texTransform = XMLoadFloat4x4(&mTexTransform);
-
-		RenderItemConstants renderItemConstants;
-		XMStoreFloat4x4(&renderItemConstants.Transform, XMMatrixTranspose(world));
-		XMStoreFloat4x4(&renderItemConstants.InvTransposeTransform, invTransposeWorld); // already transposed
-		XMStoreFloat4x4(&renderItemConstants.TexTransform, XMMatrixTranspose(texTransform));
-		renderItemConstants.MaterialIndex = mMat->MatCBIndex;
-		renderItemConstants.RenderItemType = RENDER_ITEM_TYPE_STATIC;
-		auto upBuff = currentFrameResource->RenderItemConstantsBuffer.get();
-		upBuff->CopyData(mRenderItemBufferIndex, renderItemConstants);
-
-		// Next FrameResource need to be updated too.
-		mNumFramesDirty--;
+		DrawIndexed(state, nullptr, mW.mS);
 	}
 }
 
-void StaticRenderItem::Render(App *app, FrameResource* frameResource, const BoundingFrustum &camFrustum)
+bool StaticRenderItem::GetLODReference(App *app, XMFLOAT3 *outPosition, float *outScale) const
 {
-	XMVECTOR scale = XMLoadFloat3(&mW.mS);
-	XMVECTOR invRotQuat = XMQuaternionInverse(XMLoadFloat4(&mW.mR));
-	XMVECTOR invTranslation = XMVectorMultiply(XMLoadFloat3(&mW.mT), XMVectorSet(-1.0f, -1.0f, -1.0f, 1.0f));
+	*outPosition = mW.mT;
+	*outScale = max(max(mW.mS.x, mW.mS.y), mW.mS.z);
+	return true;
+}
 
-	// Transform the camera frustum to the object's local space (while ignoring scale).
-	BoundingFrustum localSpaceFrustum;
-	// inverse world transform without scaling
-	XMMATRIX invWorld = XMMatrixTranslationFromVector(invTranslation) * XMMatrixRotationQuaternion(invRotQuat); 
-	camFrustum.Transform(localSpaceFrustum, invWorld);
+bool StaticRenderItem::GetWorldBounds(App *app, BoundingBox *outBounds) const
+{
+	if (!mBounds)
+		return false;
+	mBounds->Transform(*outBounds, mW.GetWorldMatrix());
+	return true;
+}
 
-	BoundingBox bounds;
-	bounds.Center = mBounds->Center;
-	bounds.Extents.x = XMVectorGetX(scale) * mBounds->Extents.x;
-	bounds.Extents.y = XMVectorGetY(scale) * mBounds->Extents.y;
-	bounds.Extents.z = XMVectorGetZ(scale) * mBounds->Extents.z;
-	
-	// Perform the box/frustum intersection test in local space.
-	if ((localSpaceFrustum.Contains(bounds) != DirectX::DISJOINT))
-	{
-		ID3D12GraphicsCommandList *cmdList = GetDirectXCore(app).GetCommandList();
-		cmdList->IASetVertexBuffers(0, 1, &mGeo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&mGeo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(mPrimitiveType);
-
-		// Bind all the textures used in this item.
-		ID3D12DescriptorHeap* descriptorHeaps[] = { mMat->mSrvDescriptorHeap.Get() };
-		cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-		cmdList->SetGraphicsRootDescriptorTable((UINT)SpeckApp::MainPassRootParameter::TexturesDescriptorTable, mMat->mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-
-		// Set the constant buffer to use for this render-item.  For structured buffers, we can bypass 
-		// the heap and set as a root descriptor.
-		auto cbArrayResource = frameResource->RenderItemConstantsBuffer->Resource();
-		auto cbElementByteSize = frameResource->RenderItemConstantsBuffer->GetElementByteSize();
-		D3D12_GPU_VIRTUAL_ADDRESS cbAddress = cbArrayResource->GetGPUVirtualAddress() + mRenderItemBufferIndex*cbElementByteSize;
-		cmdList->SetGraphicsRootConstantBufferView((UINT)SpeckApp::MainPassRootParameter::StaticConstantBuffer, cbAddress);
-		cmdList->DrawIndexedInstanced(mIndexCount, 1, mStartIndexLocation, mBaseVertexLocation, 0);
-	}
+bool StaticRenderItem::GetOccluderWorld(App *app, XMFLOAT4X4 *outWorld) const
+{
+	// The triangles are read from the copy of the geometry on the CPU
+	if (!mGeo || !mGeo->VertexBufferCPU || !mGeo->IndexBufferCPU)
+		return false;
+	if (GetFullLODRange().IndexCount > 3 * OcclusionCuller::MaxOccluderTriangles)
+		return false;
+	XMStoreFloat4x4(outWorld, mW.GetWorldMatrix());
+	return true;
 }
 
-void SpeckRigidBodyRenderItem::UpdateBufferCPU(App * app, FrameResource * currentFrameResource)
+void StaticInstancesRenderItem::UpdateConstants(FrameResource *currentFrameResource) const
 {
-	// Only update the cbuffer data if the constants have changed.  
-	// This needs to be tracked per frame resource.
-	if (mNumFramesDirty > 0)
-	{
-		XMMATRIX world = mL.GetWorldMatrix();
-		XMMATRIX invTransposeWorld = mL.GetInverseWorldMatrix(); // avoid double transposing
-		XMMATRIX texTransform = XMLoadFloat4x4(&mTexTransform);
-
-		RenderItemConstants renderItemConstants;
-		XMStoreFloat4x4(&renderItemConstants.Transform, XMMatrixTranspose(world));
-		XMStoreFloat4x4(&renderItemConstants.InvTransposeTransform, invTransposeWorld); // already transposed
-		XMStoreFloat4x4(&renderItemConstants.TexTransform, XMMatrixTranspose(texTransform));
-		renderItemConstants.MaterialIndex = mMat->MatCBIndex;
-		renderItemConstants.RenderItemType = RENDER_ITEM_TYPE_SPECK_RIGID_BODY;
-		renderItemConstants.Param[0].x = mSpeckRigidBodyIndex;
-		auto upBuff = currentFrameResource->RenderItemConstantsBuffer.get();
-		upBuff->CopyData(mRenderItemBufferIndex, renderItemConstants);
-
-		// Next FrameResource need to be updated too.
-		mNumFramesDirty--;
-	}
+	// The transforms are per instance
+	RenderItemConstants renderItemConstants;
+	renderItemConstants.MaterialIndex = mMat->MatCBIndex;
+	renderItemConstants.RenderItemType = RENDER_ITEM_TYPE_STATIC_INSTANCED;
+	renderItemConstants.Param[0].x = mFirstInstance;
+	auto upBuff = currentFrameResource->RenderItemConstantsBuffer.get();
+	upBuff->CopyData(mRenderItemBufferIndex, renderItemConstants);
 }
 
-void SpeckRigidBodyRenderItem::Render(App * app, FrameResource * frameResource, const BoundingFrustum & camFrustum)
+void StaticInstancesRenderItem::Render(App *app, RenderStateCache &state, FrameResource* frameResource)
 {
-	ID3D12GraphicsCommandList *cmdList = GetDirectXCore(app).GetCommandList();
-	cmdList->IASetVertexBuffers(0, 1, &mGeo->VertexBufferView());
-	cmdList->IASetIndexBuffer(&mGeo->IndexBufferView());
-	cmdList->IASetPrimitiveTopology(mPrimitiveType);
+	// The LOD is shared by all the instances and the meshlets are not culled
+	Bind(state, frameResource);
+	state.DrawIndexedInstanced(mIndexCount, mInstanceCount, mStartIndexLocation, mBaseVertexLocation, 0);
+}
 
-	// Bind all the textures used in this item.
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mMat->mSrvDescriptorHeap.Get() };
-	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-	cmdList->SetGraphicsRootDescriptorTable((UINT)SpeckApp::MainPassRootParameter::TexturesDescriptorTable, mMat->mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+// Position of the speck rigid body as last known on the CPU (the bodies simulated on the GPU are not read back).
+static bool GetRigidBodyPosition(App *app, UINT rigidBodyIndex, XMFLOAT3 *outPosition)
+{
+	const SpeckWorld &sWorld = static_cast<const SpeckWorld &>(app->GetWorld());
+	if (rigidBodyIndex >= sWorld.mSpeckRigidBodyData.size())
+		return false;
 
-	// Set the constant buffer to use for this render-item.  For structured buffers, we can bypass 
-	// the heap and set as a root descriptor.
-	auto cbArrayResource = frameResource->RenderItemConstantsBuffer->Resource();
-	auto cbElementByteSize = frameResource->RenderItemConstantsBuffer->GetElementByteSize();
-	D3D12_GPU_VIRTUAL_ADDRESS cbAddress = cbArrayResource->GetGPUVirtualAddress() + mRenderItemBufferIndex*cbElementByteSize;
-	cmdList->SetGraphicsRootConstantBufferView((UINT)SpeckApp::MainPassRootParameter::StaticConstantBuffer, cbAddress);
-	cmdList->DrawIndexedInstanced(mIndexCount, 1, mStartIndexLocation, mBaseVertexLocation, 0);
+	// The world matrix is stored transposed
+	const XMFLOAT4X4 &world = sWorld.mSpeckRigidBodyData[rigidBodyIndex].mRBData.mWorld;
+	*outPosition = XMFLOAT3(world._14, world._24, world._34);
+	return true;
+}
+
+// World matrix of the speck rigid body, if it is moved by the CPU (the bodies simulated on the GPU are not read back).
+static bool GetRigidBodyWorld(App *app, UINT rigidBodyIndex, XMMATRIX *outWorld)
+{
+	const SpeckWorld &sWorld = static_cast<const SpeckWorld &>(app->GetWorld());
+	if (rigidBodyIndex >= sWorld.mSpeckRigidBodyData.size())
+		return false;
+
+	const RigidBodyData &rbData = sWorld.mSpeckRigidBodyData[rigidBodyIndex].mRBData;
+	if (rbData.movementMode != RIGID_BODY_MOVEMENT_MODE_CPU)
+		return false;
+
+	// The world matrix is stored transposed
+	*outWorld = XMMatrixTranspose(XMLoadFloat4x4(&rbData.mWorld));
+	return true;
 }
 
-void SpeckSkeletalBodyRenderItem::UpdateBufferCPU(App * app, FrameResource * currentFrameResource)
+void SpeckRigidBodyRenderItem::UpdateConstants(FrameResource *currentFrameResource) const
 {
-	// Only update the cbuffer data if the constants have changed.  
-	// This needs to be tracked per frame resource.
-	if (mNumFramesDirty > 0)
+	XMMATRIX world = mL.GetWorldMatrix();
+	XMMATRIX invTransposeWorld = mL.GetInverseWorldMatrix(); // avoid double transposing
+	XMMATRIX texTransform = XMLoadFloat4x4(&mTexTransform);
+
+	RenderItemConstants renderItemConstants;
+	XMStoreFloat4x4(&renderItemConstants.Transform, XMMatrixTranspose(world));
+	XMStoreFloat4x4(&renderItemConstants.InvTransposeTransform, invTransposeWorld); // already transposed
+	XMStoreFloat4x4(&renderItemConstants.TexTransform, XMMatrixTranspose(texTransform));
+	renderItemConstants.MaterialIndex = mMat->MatCBIndex;
+	renderItemConstants.RenderItemType = RENDER_ITEM_TYPE_SPECK_RIGID_BODY;
+	renderItemConstants.Param[0].x = mSpeckRigidBodyIndex;
+	auto upBuff = currentFrameResource->RenderItemConstantsBuffer.get();
+	upBuff->CopyData(mRenderItemBufferIndex, renderItemConstants);
+}
+
+void SpeckRigidBodyRenderItem::Render(App * app, RenderStateCache &state, FrameResource * frameResource, const BoundingFrustum & camFrustum)
+{
+	Bind(state, frameResource);
+
+	// The meshlets can be culled only if the transform of the rigid body is known on the CPU.
+	XMMATRIX rigidBodyWorld;
+	if (mMeshlets && GetRigidBodyWorld(app, mSpeckRigidBodyIndex, &rigidBodyWorld))
+	{
+		// Transform the camera frustum to the object's local space (while ignoring scale).
+		XMMATRIX world = XMMatrixRotationQuaternion(XMLoadFloat4(&mL.mR)) * XMMatrixTranslationFromVector(XMLoadFloat3(&mL.mT)) * rigidBodyWorld;
+		BoundingFrustum localSpaceFrustum;
+		camFrustum.Transform(localSpaceFrustum, XMMatrixInverse(nullptr, world));
+		DrawIndexed(state, &localSpaceFrustum, mL.mS);
+	}
+	else
 	{
-		XMMATRIX world = XMMatrixIdentity();
-		XMMATRIX invTransposeWorld = XMMatrixIdentity();
-		XMMATRIX texTransform = XMLoadFloat4x4(&mTexTransform);
-
-		RenderItemConstants renderItemConstants;
-		XMStoreFloat4x4(&renderItemConstants.Transform, XMMatrixTranspose(world));
-		XMStoreFloat4x4(&renderItemConstants.InvTransposeTransform, invTransposeWorld); // already transposed
-		XMStoreFloat4x4(&renderItemConstants.TexTransform, XMMatrixTranspose(texTransform));
-		renderItemConstants.MaterialIndex = mMat->MatCBIndex;
-		renderItemConstants.RenderItemType = RENDER_ITEM_TYPE_SPECK_SKELETAL_BODY;
-		auto upBuff = currentFrameResource->RenderItemConstantsBuffer.get();
-		upBuff->CopyData(mRenderItemBufferIndex, renderItemConstants);
-
-		// Next FrameResource need to be updated too.
-		mNumFramesDirty--;
+		DrawIndexed(state, nullptr, mL.mS);
 	}
 }
 
-void SpeckSkeletalBodyRenderItem::Render(App * app, FrameResource * frameResource, const BoundingFrustum & camFrustum)
+bool SpeckRigidBodyRenderItem::GetLODReference(App *app, XMFLOAT3 *outPosition, float *outScale) const
 {
-	ID3D12GraphicsCommandList *cmdList = GetDirectXCore(app).GetCommandList();
-	cmdList->IASetVertexBuffers(0, 1, &mGeo->VertexBufferView());
-	cmdList->IASetIndexBuffer(&mGeo->IndexBufferView());
-	cmdList->IASetPrimitiveTopology(mPrimitiveType);
+	if (!GetRigidBodyPosition(app, mSpeckRigidBodyIndex, outPosition))
+		return false;
+	*outScale = max(max(mL.mS.x, mL.mS.y), mL.mS.z);
+	return true;
+}
+
+bool SpeckRigidBodyRenderItem::GetWorldBounds(App *app, BoundingBox *outBounds) const
+{
+	XMMATRIX rigidBodyWorld;
+	if (!mBounds || !GetRigidBodyWorld(app, mSpeckRigidBodyIndex, &rigidBodyWorld))
+		return false;
+	mBounds->Transform(*outBounds, mL.GetWorldMatrix() * rigidBodyWorld);
+	return true;
+}
+
+void SpeckSkeletalBodyRenderItem::UpdateConstants(FrameResource *currentFrameResource) const
+{
+	XMMATRIX world = XMMatrixIdentity();
+	XMMATRIX invTransposeWorld = XMMatrixIdentity();
+	XMMATRIX texTransform = XMLoadFloat4x4(&mTexTransform);
+
+	RenderItemConstants renderItemConstants;
+	XMStoreFloat4x4(&renderItemConstants.Transform, XMMatrixTranspose(world));
+	XMStoreFloat4x4(&renderItemConstants.InvTransposeTransform, invTransposeWorld); // already transposed
+	XMStoreFloat4x4(&renderItemConstants.TexTransform, XMMatrixTranspose(texTransform));
+	renderItemConstants.MaterialIndex = mMat->MatCBIndex;
+	renderItemConstants.RenderItemType = RENDER_ITEM_TYPE_SPECK_SKELETAL_BODY;
+	auto upBuff = currentFrameResource->RenderItemConstantsBuffer.get();
+	upBuff->CopyData(mRenderItemBufferIndex, renderItemConstants);
+}
+
+void SpeckSkeletalBodyRenderItem::Render(App * app, RenderStateCache &state, FrameResource * frameResource)
+{
+	Bind(state, frameResource);
+	state.DrawIndexedInstanced(mIndexCount, 1, mStartIndexLocation, mBaseVertexLocation, 0);
+}
+
+bool SpeckSkeletalBodyRenderItem::GetLODReference(App *app, XMFLOAT3 *outPosition, float *outScale) const
+{
+	*outScale = 1.0f;
+	return GetRigidBodyPosition(app, mLODRigidBodyIndex, outPosition);
+}
+
+void TexturedRenderItem::Bind(RenderStateCache &state, FrameResource* frameResource) const
+{
+	state.SetGeometry(mGeo);
+	state.SetPrimitiveTopology(mPrimitiveType);
 
 	// Bind all the textures used in this item.
-	ID3D12DescriptorHeap* descriptorHeaps[] = { mMat->mSrvDescriptorHeap.Get() };
-	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-	cmdList->SetGraphicsRootDescriptorTable((UINT)SpeckApp::MainPassRootParameter::TexturesDescriptorTable, mMat->mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+	state.SetDescriptorHeap(mMat->mSrvDescriptorHeap.Get());
+	state.SetGraphicsRootDescriptorTable((UINT)SpeckApp::MainPassRootParameter::TexturesDescriptorTable, mMat->mSrvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 
 	// Set the constant buffer to use for this render-item.  For structured buffers, we can bypass 
 	// the heap and set as a root descriptor.
 	auto cbArrayResource = frameResource->RenderItemConstantsBuffer->Resource();
 	auto cbElementByteSize = frameResource->RenderItemConstantsBuffer->GetElementByteSize();
 	D3D12_GPU_VIRTUAL_ADDRESS cbAddress = cbArrayResource->GetGPUVirtualAddress() + mRenderItemBufferIndex*cbElementByteSize;
-	cmdList->SetGraphicsRootConstantBufferView((UINT)SpeckApp::MainPassRootParameter::StaticConstantBuffer, cbAddress);
-	cmdList->DrawIndexedInstanced(mIndexCount, 1, mStartIndexLocation, mBaseVertexLocation, 0);
+	state.SetGraphicsRootConstantBufferView((UINT)SpeckApp::MainPassRootParameter::StaticConstantBuffer, cbAddress);
+}
+
+IndexRange RenderItem::GetFullLODRange() const
+{
+	// The chosen level of detail overwrites the draw parameters, the first one is the full mesh
+	IndexRange range;
+	range.IndexCount = mLODs ? mLODs->front().IndexCount : mIndexCount;
+	range.StartIndexLocation = mLODs ? mLODs->front().StartIndexLocation : mStartIndexLocation;
+	return range;
 }
 
-DirectXCore &RenderItem::GetDirectXCore(App * app) const
+void RenderItem::DrawIndexed(RenderStateCache &state, const BoundingFrustum *localFrustum, const XMFLOAT3 &scale)
 {
-	return app->GetEngineCore().GetDirectXCore();
+	// The meshlets cover only the full level of detail
+	bool fullDetail = !mLODs || mStartIndexLocation == mLODs->front().StartIndexLocation;
+	if (!localFrustum || !mMeshlets || !fullDetail)
+	{
+		state.DrawIndexedInstanced(mIndexCount, 1, mStartIndexLocation, mBaseVertexLocation, 0);
+		return;
+	}
+
+	MeshletBuilder::Cull(*mMeshlets, *localFrustum, scale, &mVisibleRanges);
+	for (const IndexRange &range : mVisibleRanges)
+		state.DrawIndexedInstanced(range.IndexCount, 1, mStartIndexLocation + range.StartIndexLocation, mBaseVertexLocation, 0);
 }
@@ -1,4 +1,3 @@
-
 #ifndef RENDER_ITEM_H
 #define RENDER_ITEM_H
 
@@ -12,23 +11,38 @@ namespace Speck
 {
 	class App;
 	class SpecksHandler;
-	class DirectXCore;
+	class RenderStateCache;
+
+	// Each kind of the render items is kept in its own array of the render scene.
+	enum class RenderItemKind : UINT { Static, SpeckRigidBody, SpeckSkeletalBody, Specks, StaticInstances, Count };
+
+	// Identifies a render item in the render scene. The items are never moved to another index,
+	// so the handle stays valid while the arrays grow.
+	struct RenderItemHandle
+	{
+		RenderItemKind Kind = RenderItemKind::Count;
+		UINT Index = (UINT)-1;
+
+		bool IsValid() const { return Kind != RenderItemKind::Count; }
+	};
 
 	// Lightweight structure stores parameters to draw a shape.  This will
-	// vary from app-to-app.
+	// vary from app-to-app. The kinds of the items below are plain data,
+	// the render scene calls their functions directly for each kind.
 	struct RenderItem
 	{
-		RenderItem() = default;
-		RenderItem(const RenderItem& rhs) = delete;
-		virtual void UpdateBufferCPU(App *app, FrameResource *currentFrameResource) {}
-		virtual void UpdateBufferGPU(App *app, FrameResource *currentFrameResource) {}
-		virtual void Render(App *app, FrameResource* frameResource, const DirectX::BoundingFrustum &camFrustum) = 0;
+		// Indices of the full level of detail.
+		IndexRange GetFullLODRange() const;
 
 	protected:
-		DirectXCore &GetDirectXCore(App *app) const;// { return app->GetEngineCore().GetDirectXCore(); }
+		// Draws only the visible meshlets if the frustum is known (in the space of the mesh without its scale) and the full
+		// level of detail is drawn, the whole mesh otherwise.
+		void DrawIndexed(RenderStateCache &state, const DirectX::BoundingFrustum *localFrustum, const DirectX::XMFLOAT3 &scale);
 
 	public:
 		MeshGeometry* mGeo = nullptr;
+		// Small index of the geometry in the render scene, used to sort the draws.
+		UINT mGeoId = 0;
 
 		// Primitive topology.
 		D3D12_PRIMITIVE_TOPOLOGY mPrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
@@ -38,13 +52,27 @@ namespace Speck
 		UINT mInstanceCount = 0;
 		UINT mStartIndexLocation = 0;
 		int mBaseVertexLocation = 0;
+
+		// Bounds of the mesh in its local space.
+		DirectX::BoundingBox const *mBounds = nullptr;
+
+		// Levels of detail of the mesh, null if it has none. The chosen one is written to the parameters above.
+		std::vector<SubmeshLOD> const *mLODs = nullptr;
+		// Meshlets of the full level of detail, null if it has none.
+		std::vector<Meshlet> const *mMeshlets = nullptr;
+
+		// Number of the frame resources whose constants of this item are out of date.
+		// The item is in the dirty list of the render scene while it is positive.
+		int mNumFramesDirty = 0;
+
+	private:
+		// Index ranges of the visible meshlets, kept between the frames to reuse the memory.
+		std::vector<IndexRange> mVisibleRanges;
 	};
 
 	struct SpecksRenderItem : public RenderItem
 	{
-		SpecksRenderItem() = default;
-		SpecksRenderItem(const SpecksRenderItem& rhs) = delete;
-		void Render(App *app, FrameResource* frameResource, const DirectX::BoundingFrustum &camFrustum) override;
+		void Render(App *app, RenderStateCache &state, FrameResource* frameResource);
 
 		// Buffer in frame resource from where this instanced data will be drawn.
 		UINT mBufferIndex;
@@ -52,77 +80,68 @@ namespace Speck
 
 	struct TexturedRenderItem : public RenderItem
 	{
-		TexturedRenderItem() = default;
-		TexturedRenderItem(const TexturedRenderItem& rhs) = delete;
-
 		// Texture transform for this item
 		DirectX::XMFLOAT4X4 mTexTransform = MathHelper::Identity4x4();
 		// Material for this item
 		PBRMaterial *mMat = nullptr;
-	};
 
+		// Index into GPU constant buffer corresponding to the RenderItemConstants for this render item.
+		UINT mRenderItemBufferIndex = -1;
+
+	protected:
+		// Binds the geometry, the textures and the constants of the item.
+		void Bind(RenderStateCache &state, FrameResource* frameResource) const;
+	};
 
 	struct StaticRenderItem : public TexturedRenderItem
 	{
-		StaticRenderItem() = default;
-		StaticRenderItem(const StaticRenderItem& rhs) = delete;
-		void UpdateBufferCPU(App *app, FrameResource *currentFrameResource) override;
-		void Render(App *app, FrameResource* frameResource, const DirectX::BoundingFrustum &camFrustum) override;
-
-		// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-		// Because we have an object cbuffer for each FrameResource, we have to apply the
-		// update to each FrameResource.  Thus, when we modify obect data we should set 
-		// NumFramesDirty = NUM_FRAME_RESOURCES so that each frame resource gets the update.
-		int mNumFramesDirty = NUM_FRAME_RESOURCES;
+		void UpdateConstants(FrameResource *currentFrameResource) const;
+		void Render(App *app, RenderStateCache &state, FrameResource* frameResource, const DirectX::BoundingFrustum &camFrustum);
+		bool GetLODReference(App *app, DirectX::XMFLOAT3 *outPosition, float *outScale) const;
+		bool GetWorldBounds(App *app, DirectX::BoundingBox *outBounds) const;
+		// World transform of the item if it is simple enough to hide the others behind it, returns false otherwise.
+		bool GetOccluderWorld(App *app, DirectX::XMFLOAT4X4 *outWorld) const;
 
 		// World transform of the render item
 		Transform mW;
-		DirectX::BoundingBox const *mBounds;
+	};
 
-		// Index into GPU constant buffer corresponding to the RenderItemConstants for this render item.
-		UINT mRenderItemBufferIndex = -1;
+	// Draws the visible static items of an instance batch at once. Their transforms are read from the static
+	// instance buffer, indexed by the instance indices of the frame starting at the first instance.
+	struct StaticInstancesRenderItem : public TexturedRenderItem
+	{
+		void UpdateConstants(FrameResource *currentFrameResource) const;
+		void Render(App *app, RenderStateCache &state, FrameResource* frameResource);
+
+		// Offset of the instance indices of the frame.
+		UINT mFirstInstance = 0;
 	};
 
 	// This body transformation will be determined by its respective speck rigid body.
 	struct SpeckRigidBodyRenderItem : public TexturedRenderItem
 	{
-		SpeckRigidBodyRenderItem() = default;
-		SpeckRigidBodyRenderItem(const StaticRenderItem& rhs) = delete;
-		void UpdateBufferCPU(App *app, FrameResource *currentFrameResource) override;
-		void Render(App *app, FrameResource* frameResource, const DirectX::BoundingFrustum &camFrustum) override;
-
-		// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-		// Because we have an object cbuffer for each FrameResource, we have to apply the
-		// update to each FrameResource.  Thus, when we modify obect data we should set 
-		// NumFramesDirty = NUM_FRAME_RESOURCES so that each frame resource gets the update.
-		int mNumFramesDirty = NUM_FRAME_RESOURCES;
+		void UpdateConstants(FrameResource *currentFrameResource) const;
+		void Render(App *app, RenderStateCache &state, FrameResource* frameResource, const DirectX::BoundingFrustum &camFrustum);
+		bool GetLODReference(App *app, DirectX::XMFLOAT3 *outPosition, float *outScale) const;
+		// Known only for the bodies that are moved by the CPU.
+		bool GetWorldBounds(App *app, DirectX::BoundingBox *outBounds) const;
 
 		// Local transform of the render item.
 		Transform mL;
 
 		// Index to the speck rigid body buffer on the GPU.
 		UINT mSpeckRigidBodyIndex = -1;
-
-		// Index into GPU constant buffer corresponding to this render item.
-		UINT mRenderItemBufferIndex = -1;
 	};
 
 	// This body bone transformations will be determined by its respective speck rigid bodies.
 	struct SpeckSkeletalBodyRenderItem : public TexturedRenderItem
 	{
-		SpeckSkeletalBodyRenderItem() = default;
-		SpeckSkeletalBodyRenderItem(const StaticRenderItem& rhs) = delete;
-		void UpdateBufferCPU(App *app, FrameResource *currentFrameResource) override;
-		void Render(App *app, FrameResource* frameResource, const DirectX::BoundingFrustum &camFrustum) override;
-
-		// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-		// Because we have an object cbuffer for each FrameResource, we have to apply the
-		// update to each FrameResource.  Thus, when we modify obect data we should set 
-		// NumFramesDirty = NUM_FRAME_RESOURCES so that each frame resource gets the update.
-		int mNumFramesDirty = NUM_FRAME_RESOURCES;
-
-		// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-		UINT mRenderItemBufferIndex = -1;
+		void UpdateConstants(FrameResource *currentFrameResource) const;
+		void Render(App *app, RenderStateCache &state, FrameResource* frameResource);
+		bool GetLODReference(App *app, DirectX::XMFLOAT3 *outPosition, float *outScale) const;
+
+		// Speck rigid body whose position is used to pick the level of detail.
+		UINT mLODRigidBodyIndex = -1;
 	};
 }
 
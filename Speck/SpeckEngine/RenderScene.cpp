@@ -0,0 +1,213 @@
+#include "RenderScene.h"
+#include "FrameResource.h"
+#include "RenderStateCache.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	template <typename T>
+	RenderItemHandle AddItem(vector<T> &items, const T &item, RenderItemKind kind, unordered_map<const MeshGeometry *, UINT> &geometryIds)
+	{
+		RenderItemHandle handle;
+		handle.Kind = kind;
+		handle.Index = (UINT)items.size();
+		items.push_back(item);
+
+		// The geometries are numbered in the order they are first seen
+		auto geometryId = geometryIds.insert(make_pair(item.mGeo, (UINT)geometryIds.size()));
+		items.back().mGeoId = geometryId.first->second;
+		return handle;
+	}
+
+	// Uploads the constants of the dirty items and keeps the ones that are still out of date for other frame resources.
+	template <typename T>
+	void UpdateDirtyItems(vector<T> &items, vector<UINT> &dirtyItems, FrameResource *currentFrameResource)
+	{
+		size_t kept = 0;
+		for (UINT index : dirtyItems)
+		{
+			T &item = items[index];
+			item.UpdateConstants(currentFrameResource);
+			if (--item.mNumFramesDirty > 0)
+				dirtyItems[kept++] = index;
+		}
+		dirtyItems.resize(kept);
+	}
+}
+
+RenderItemHandle RenderScene::Add(const StaticRenderItem &item)
+{
+	RenderItemHandle handle = AddItem(mStaticItems, item, RenderItemKind::Static, mGeometryIds);
+	MarkDirty(handle);
+	UpdateMemory();
+	return handle;
+}
+
+RenderItemHandle RenderScene::Add(const SpeckRigidBodyRenderItem &item)
+{
+	RenderItemHandle handle = AddItem(mSpeckRigidBodyItems, item, RenderItemKind::SpeckRigidBody, mGeometryIds);
+	MarkDirty(handle);
+	UpdateMemory();
+	return handle;
+}
+
+RenderItemHandle RenderScene::Add(const SpeckSkeletalBodyRenderItem &item)
+{
+	RenderItemHandle handle = AddItem(mSpeckSkeletalBodyItems, item, RenderItemKind::SpeckSkeletalBody, mGeometryIds);
+	MarkDirty(handle);
+	UpdateMemory();
+	return handle;
+}
+
+RenderItemHandle RenderScene::Add(const SpecksRenderItem &item)
+{
+	// The specks have no constants of their own
+	RenderItemHandle handle = AddItem(mSpecksItems, item, RenderItemKind::Specks, mGeometryIds);
+	UpdateMemory();
+	return handle;
+}
+
+RenderItemHandle RenderScene::Add(const StaticInstancesRenderItem &item)
+{
+	// The constants of the batches change every frame they are drawn, they are written by the world
+	RenderItemHandle handle = AddItem(mStaticInstancesItems, item, RenderItemKind::StaticInstances, mGeometryIds);
+	UpdateMemory();
+	return handle;
+}
+
+RenderItem &RenderScene::Get(RenderItemHandle handle)
+{
+	switch (handle.Kind)
+	{
+		case RenderItemKind::Static:
+			return mStaticItems[handle.Index];
+		case RenderItemKind::SpeckRigidBody:
+			return mSpeckRigidBodyItems[handle.Index];
+		case RenderItemKind::SpeckSkeletalBody:
+			return mSpeckSkeletalBodyItems[handle.Index];
+		case RenderItemKind::Specks:
+			return mSpecksItems[handle.Index];
+		default:
+			return mStaticInstancesItems[handle.Index];
+	}
+}
+
+UINT RenderScene::GetCount(RenderItemKind kind) const
+{
+	switch (kind)
+	{
+		case RenderItemKind::Static:
+			return (UINT)mStaticItems.size();
+		case RenderItemKind::SpeckRigidBody:
+			return (UINT)mSpeckRigidBodyItems.size();
+		case RenderItemKind::SpeckSkeletalBody:
+			return (UINT)mSpeckSkeletalBodyItems.size();
+		case RenderItemKind::Specks:
+			return (UINT)mSpecksItems.size();
+		case RenderItemKind::StaticInstances:
+			return (UINT)mStaticInstancesItems.size();
+		default:
+			return 0;
+	}
+}
+
+void RenderScene::MarkDirty(RenderItemHandle handle)
+{
+	if (handle.Kind == RenderItemKind::Specks || handle.Kind == RenderItemKind::StaticInstances)
+		return;
+
+	// Already dirty items are in the list, they only have to be uploaded to all the frame resources again
+	RenderItem &item = Get(handle);
+	if (item.mNumFramesDirty <= 0)
+		mDirtyItems[(UINT)handle.Kind].push_back(handle.Index);
+	item.mNumFramesDirty = NUM_FRAME_RESOURCES;
+}
+
+void RenderScene::UpdateConstants(FrameResource *currentFrameResource)
+{
+	UpdateDirtyItems(mStaticItems, mDirtyItems[(UINT)RenderItemKind::Static], currentFrameResource);
+	UpdateDirtyItems(mSpeckRigidBodyItems, mDirtyItems[(UINT)RenderItemKind::SpeckRigidBody], currentFrameResource);
+	UpdateDirtyItems(mSpeckSkeletalBodyItems, mDirtyItems[(UINT)RenderItemKind::SpeckSkeletalBody], currentFrameResource);
+}
+
+UINT RenderScene::GetDirtyCount() const
+{
+	size_t count = 0;
+	for (const vector<UINT> &dirtyItems : mDirtyItems)
+		count += dirtyItems.size();
+	return (UINT)count;
+}
+
+void RenderScene::Render(App *app, RenderStateCache &state, FrameResource *frameResource, RenderItemHandle handle, const BoundingFrustum &camFrustum)
+{
+	switch (handle.Kind)
+	{
+		case RenderItemKind::Static:
+			mStaticItems[handle.Index].Render(app, state, frameResource, camFrustum);
+			break;
+		case RenderItemKind::SpeckRigidBody:
+			mSpeckRigidBodyItems[handle.Index].Render(app, state, frameResource, camFrustum);
+			break;
+		case RenderItemKind::SpeckSkeletalBody:
+			mSpeckSkeletalBodyItems[handle.Index].Render(app, state, frameResource);
+			break;
+		case RenderItemKind::Specks:
+			mSpecksItems[handle.Index].Render(app, state, frameResource);
+			break;
+		case RenderItemKind::StaticInstances:
+			mStaticInstancesItems[handle.Index].Render(app, state, frameResource);
+			break;
+		default:
+			break;
+	}
+}
+
+bool RenderScene::GetLODReference(App *app, RenderItemHandle handle, XMFLOAT3 *outPosition, float *outScale) const
+{
+	switch (handle.Kind)
+	{
+		case RenderItemKind::Static:
+			return mStaticItems[handle.Index].GetLODReference(app, outPosition, outScale);
+		case RenderItemKind::SpeckRigidBody:
+			return mSpeckRigidBodyItems[handle.Index].GetLODReference(app, outPosition, outScale);
+		case RenderItemKind::SpeckSkeletalBody:
+			return mSpeckSkeletalBodyItems[handle.Index].GetLODReference(app, outPosition, outScale);
+		default:
+			return false;
+	}
+}
+
+bool RenderScene::GetWorldBounds(App *app, RenderItemHandle handle, BoundingBox *outBounds) const
+{
+	// The skinned meshes and the specks are never culled
+	switch (handle.Kind)
+	{
+		case RenderItemKind::Static:
+			return mStaticItems[handle.Index].GetWorldBounds(app, outBounds);
+		case RenderItemKind::SpeckRigidBody:
+			return mSpeckRigidBodyItems[handle.Index].GetWorldBounds(app, outBounds);
+		default:
+			return false;
+	}
+}
+
+bool RenderScene::GetOccluderWorld(App *app, RenderItemHandle handle, XMFLOAT4X4 *outWorld) const
+{
+	if (handle.Kind != RenderItemKind::Static)
+		return false;
+	return mStaticItems[handle.Index].GetOccluderWorld(app, outWorld);
+}
+
+void RenderScene::UpdateMemory()
+{
+	UINT64 reserved = mStaticItems.capacity() * sizeof(StaticRenderItem) + mSpeckRigidBodyItems.capacity() * sizeof(SpeckRigidBodyRenderItem) +
+		mSpeckSkeletalBodyItems.capacity() * sizeof(SpeckSkeletalBodyRenderItem) + mSpecksItems.capacity() * sizeof(SpecksRenderItem) +
+		mStaticInstancesItems.capacity() * sizeof(StaticInstancesRenderItem);
+	UINT64 used = mStaticItems.size() * sizeof(StaticRenderItem) + mSpeckRigidBodyItems.size() * sizeof(SpeckRigidBodyRenderItem) +
+		mSpeckSkeletalBodyItems.size() * sizeof(SpeckSkeletalBodyRenderItem) + mSpecksItems.size() * sizeof(SpecksRenderItem) +
+		mStaticInstancesItems.size() * sizeof(StaticInstancesRenderItem);
+	mMemory.Set(reserved, used);
+}
@@ -0,0 +1,72 @@
+#ifndef RENDER_SCENE_H
+#define RENDER_SCENE_H
+
+#include "SpeckEngineDefinitions.h"
+#include "DirectXHeaders.h"
+#include "RenderItem.h"
+
+namespace Speck
+{
+	class App;
+	struct FrameResource;
+	class RenderStateCache;
+
+	//-------------------------------------------------------------------------------------
+	//	Owns all the render items, each kind in its own contiguous array, and refers to
+	//	them by handles. The constants of an item are uploaded only while it is in the
+	//	dirty list, so the work of a frame grows with the changed and the drawn items
+	//	instead of with all of them.
+	//-------------------------------------------------------------------------------------
+	class RenderScene
+	{
+	public:
+		// The new item is marked dirty.
+		DLL_EXPORT RenderItemHandle Add(const StaticRenderItem &item);
+		DLL_EXPORT RenderItemHandle Add(const SpeckRigidBodyRenderItem &item);
+		DLL_EXPORT RenderItemHandle Add(const SpeckSkeletalBodyRenderItem &item);
+		DLL_EXPORT RenderItemHandle Add(const SpecksRenderItem &item);
+		DLL_EXPORT RenderItemHandle Add(const StaticInstancesRenderItem &item);
+
+		DLL_EXPORT RenderItem &Get(RenderItemHandle handle);
+		StaticRenderItem &GetStatic(RenderItemHandle handle) { return mStaticItems[handle.Index]; }
+		SpeckRigidBodyRenderItem &GetSpeckRigidBody(RenderItemHandle handle) { return mSpeckRigidBodyItems[handle.Index]; }
+		SpeckSkeletalBodyRenderItem &GetSpeckSkeletalBody(RenderItemHandle handle) { return mSpeckSkeletalBodyItems[handle.Index]; }
+		SpecksRenderItem &GetSpecks(RenderItemHandle handle) { return mSpecksItems[handle.Index]; }
+		StaticInstancesRenderItem &GetStaticInstances(RenderItemHandle handle) { return mStaticInstancesItems[handle.Index]; }
+		DLL_EXPORT UINT GetCount(RenderItemKind kind) const;
+
+		// Call it after the constants of the item were changed, they are uploaded to all the frame resources.
+		DLL_EXPORT void MarkDirty(RenderItemHandle handle);
+		// Uploads the constants of the dirty items to the frame resource.
+		DLL_EXPORT void UpdateConstants(FrameResource *currentFrameResource);
+		DLL_EXPORT UINT GetDirtyCount() const;
+
+		void Render(App *app, RenderStateCache &state, FrameResource *frameResource, RenderItemHandle handle, const DirectX::BoundingFrustum &camFrustum);
+		bool GetLODReference(App *app, RenderItemHandle handle, DirectX::XMFLOAT3 *outPosition, float *outScale) const;
+		// Bounding box in the world for the culling. Returns false if it is unknown, the item is never culled then.
+		bool GetWorldBounds(App *app, RenderItemHandle handle, DirectX::BoundingBox *outBounds) const;
+		// The world bounds of the items that can move are updated every frame, the others only once.
+		bool CanMove(RenderItemHandle handle) const { return handle.Kind == RenderItemKind::SpeckRigidBody; }
+		// World transform of the item if it is simple enough to hide the others behind it, returns false otherwise.
+		bool GetOccluderWorld(App *app, RenderItemHandle handle, DirectX::XMFLOAT4X4 *outWorld) const;
+
+	private:
+		// Reports the arrays of the items to the memory tracker.
+		void UpdateMemory();
+
+	private:
+		std::vector<StaticRenderItem> mStaticItems;
+		std::vector<SpeckRigidBodyRenderItem> mSpeckRigidBodyItems;
+		std::vector<SpeckSkeletalBodyRenderItem> mSpeckSkeletalBodyItems;
+		std::vector<SpecksRenderItem> mSpecksItems;
+		std::vector<StaticInstancesRenderItem> mStaticInstancesItems;
+
+		// Indices of the items of each kind whose constants are still to be uploaded.
+		std::vector<UINT> mDirtyItems[(UINT)RenderItemKind::Count];
+		// Index of each geometry used by the items, given to the items as their geometry ids.
+		std::unordered_map<const MeshGeometry *, UINT> mGeometryIds;
+		MemoryAllocation mMemory{ MemoryTag::RenderItems };
+	};
+}
+
+#endif
@@ -0,0 +1,166 @@
+#include "RenderStateCache.h"
+#include "GenericShaderStructures.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+void D3D12DrawCommandList::SetPipelineState(ID3D12PipelineState *pso)
+{
+	mCommandList->SetPipelineState(pso);
+}
+
+void D3D12DrawCommandList::IASetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW &view)
+{
+	mCommandList->IASetVertexBuffers(0, 1, &view);
+}
+
+void D3D12DrawCommandList::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW &view)
+{
+	mCommandList->IASetIndexBuffer(&view);
+}
+
+void D3D12DrawCommandList::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	mCommandList->IASetPrimitiveTopology(topology);
+}
+
+void D3D12DrawCommandList::SetDescriptorHeap(ID3D12DescriptorHeap *heap)
+{
+	ID3D12DescriptorHeap* descriptorHeaps[] = { heap };
+	mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+}
+
+void D3D12DrawCommandList::SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	mCommandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+}
+
+void D3D12DrawCommandList::SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	mCommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, address);
+}
+
+void D3D12DrawCommandList::SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	mCommandList->SetGraphicsRootShaderResourceView(rootParameterIndex, address);
+}
+
+void D3D12DrawCommandList::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation,
+	int baseVertexLocation, UINT startInstanceLocation)
+{
+	mCommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+RenderStateCache::RenderStateCache(DrawCommandList *commandList)
+	: mCommandList(commandList)
+{
+	Invalidate();
+}
+
+void RenderStateCache::SetPipelineState(ID3D12PipelineState *pso)
+{
+	if (pso == mPSO)
+	{
+		++mDroppedCount;
+		return;
+	}
+	mPSO = pso;
+	mCommandList->SetPipelineState(pso);
+}
+
+void RenderStateCache::SetGeometry(const MeshGeometry *geo)
+{
+	if (geo == mGeo)
+	{
+		++mDroppedCount;
+		return;
+	}
+	mGeo = geo;
+	mCommandList->IASetVertexBuffer(geo->VertexBufferView());
+	mCommandList->IASetIndexBuffer(geo->IndexBufferView());
+}
+
+void RenderStateCache::SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+	if (topology == mTopology)
+	{
+		++mDroppedCount;
+		return;
+	}
+	mTopology = topology;
+	mCommandList->IASetPrimitiveTopology(topology);
+}
+
+void RenderStateCache::SetDescriptorHeap(ID3D12DescriptorHeap *heap)
+{
+	if (heap == mDescriptorHeap)
+	{
+		++mDroppedCount;
+		return;
+	}
+	mDescriptorHeap = heap;
+	mCommandList->SetDescriptorHeap(heap);
+
+	// The tables have to be set again after the heaps change
+	for (UINT i = 0; i < MaxRootParameters; ++i)
+	{
+		if (mDescriptorTableMask & (1 << i))
+			mRootParameters[i] = 0;
+	}
+}
+
+void RenderStateCache::SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	assert(rootParameterIndex < MaxRootParameters);
+	if (baseDescriptor.ptr == mRootParameters[rootParameterIndex])
+	{
+		++mDroppedCount;
+		return;
+	}
+	mRootParameters[rootParameterIndex] = baseDescriptor.ptr;
+	mDescriptorTableMask |= 1 << rootParameterIndex;
+	mCommandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+}
+
+void RenderStateCache::SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	assert(rootParameterIndex < MaxRootParameters);
+	if (address == mRootParameters[rootParameterIndex])
+	{
+		++mDroppedCount;
+		return;
+	}
+	mRootParameters[rootParameterIndex] = address;
+	mCommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, address);
+}
+
+void RenderStateCache::SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+	assert(rootParameterIndex < MaxRootParameters);
+	if (address == mRootParameters[rootParameterIndex])
+	{
+		++mDroppedCount;
+		return;
+	}
+	mRootParameters[rootParameterIndex] = address;
+	mCommandList->SetGraphicsRootShaderResourceView(rootParameterIndex, address);
+}
+
+void RenderStateCache::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation,
+	int baseVertexLocation, UINT startInstanceLocation)
+{
+	mCommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void RenderStateCache::Invalidate()
+{
+	// None of these is ever bound on purpose
+	mPSO = nullptr;
+	mGeo = nullptr;
+	mTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	mDescriptorHeap = nullptr;
+	for (UINT i = 0; i < MaxRootParameters; ++i)
+		mRootParameters[i] = 0;
+	mDescriptorTableMask = 0;
+}
@@ -0,0 +1,94 @@
+#ifndef RENDER_STATE_CACHE_H
+#define RENDER_STATE_CACHE_H
+
+#include "SpeckEngineDefinitions.h"
+#include "DirectXHeaders.h"
+
+namespace Speck
+{
+	struct MeshGeometry;
+
+	//-------------------------------------------------------------------------------------
+	//	Commands used to record the draws of the render items. The engine records them to
+	//	a D3D12 command list, anything else that implements them (like a mock counting the
+	//	calls) can be used instead.
+	//-------------------------------------------------------------------------------------
+	class DrawCommandList
+	{
+	public:
+		virtual ~DrawCommandList() {}
+		virtual void SetPipelineState(ID3D12PipelineState *pso) = 0;
+		virtual void IASetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW &view) = 0;
+		virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW &view) = 0;
+		virtual void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) = 0;
+		virtual void SetDescriptorHeap(ID3D12DescriptorHeap *heap) = 0;
+		virtual void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) = 0;
+		virtual void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+		virtual void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+		virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation,
+			int baseVertexLocation, UINT startInstanceLocation) = 0;
+	};
+
+	// Forwards the commands to a D3D12 graphics command list.
+	class D3D12DrawCommandList : public DrawCommandList
+	{
+	public:
+		D3D12DrawCommandList(ID3D12GraphicsCommandList *commandList) : mCommandList(commandList) {}
+		DLL_EXPORT void SetPipelineState(ID3D12PipelineState *pso) override;
+		DLL_EXPORT void IASetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW &view) override;
+		DLL_EXPORT void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW &view) override;
+		DLL_EXPORT void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override;
+		DLL_EXPORT void SetDescriptorHeap(ID3D12DescriptorHeap *heap) override;
+		DLL_EXPORT void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override;
+		DLL_EXPORT void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+		DLL_EXPORT void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+		DLL_EXPORT void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation,
+			int baseVertexLocation, UINT startInstanceLocation) override;
+
+	private:
+		ID3D12GraphicsCommandList *mCommandList;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Remembers the state bound to a draw command list and passes on only the commands
+	//	that change it. The state is unknown at first, so everything is bound once.
+	//-------------------------------------------------------------------------------------
+	class RenderStateCache
+	{
+	public:
+		static const UINT MaxRootParameters = 16;
+
+		DLL_EXPORT RenderStateCache(DrawCommandList *commandList);
+
+		DLL_EXPORT void SetPipelineState(ID3D12PipelineState *pso);
+		// Binds the vertex and the index buffer of the geometry.
+		DLL_EXPORT void SetGeometry(const MeshGeometry *geo);
+		DLL_EXPORT void SetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology);
+		DLL_EXPORT void SetDescriptorHeap(ID3D12DescriptorHeap *heap);
+		DLL_EXPORT void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor);
+		DLL_EXPORT void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+		DLL_EXPORT void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address);
+		DLL_EXPORT void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation,
+			int baseVertexLocation, UINT startInstanceLocation);
+
+		// Forgets the bound state, call it if the command list was used past the cache.
+		DLL_EXPORT void Invalidate();
+		// Number of the commands that were dropped because they would not change anything.
+		UINT GetDroppedCount() const { return mDroppedCount; }
+
+	private:
+		DrawCommandList *mCommandList;
+
+		ID3D12PipelineState *mPSO;
+		const MeshGeometry *mGeo;
+		D3D12_PRIMITIVE_TOPOLOGY mTopology;
+		ID3D12DescriptorHeap *mDescriptorHeap;
+		// Last value bound to each root parameter, zero if unknown.
+		UINT64 mRootParameters[MaxRootParameters];
+		// Root parameters that hold descriptor tables.
+		UINT mDescriptorTableMask;
+		UINT mDroppedCount = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,108 @@
+#include "ResourceLoader.h"
+#include "TextMeshLoader.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using namespace Speck::AppCommands;
+
+void ResourceLoader::LoadCPU(vector<LoadedResource> &resources, WorkerPool *workerPool)
+{
+	auto loadRange = [&resources, workerPool](UINT begin, UINT end)
+	{
+		for (UINT i = begin; i < end; ++i)
+		{
+			PROFILE_ZONE("ResourceLoader::LoadResource");
+			LoadedResource &resource = resources[i];
+			switch (resource.resType)
+			{
+			case ResourceType::Texture:
+				resource.loaded = LoadTexture(resource);
+				break;
+			case ResourceType::Shader:
+				resource.loaded = LoadShader(resource);
+				break;
+			case ResourceType::Geometry:
+				// Parses in parallel on its own, the pool takes care of the nesting
+				resource.loaded = TextMeshLoader::Load(resource.path.c_str(), workerPool, &resource.mesh, &resource.bounds, &resource.lods);
+				break;
+			default:
+				resource.loaded = false;
+				break;
+			}
+
+			if (!resource.loaded)
+				LOG(TEXT("Could not load the resource: ") + resource.path, ERROR);
+		}
+	};
+
+	// One resource per chunk, the files differ a lot in size
+	if (workerPool)
+		workerPool->ParallelFor((UINT)resources.size(), 1, loadRange);
+	else
+		loadRange(0, (UINT)resources.size());
+}
+
+UINT ResourceLoader::Load(vector<LoadedResource> &resources, WorkerPool *workerPool, ResourceUploader *uploader)
+{
+	PROFILE_ZONE("ResourceLoader::Load");
+	LoadCPU(resources, workerPool);
+
+	PROFILE_ZONE("ResourceLoader::Upload");
+	UINT failedCount = 0;
+	uploader->Begin();
+	for (auto &resource : resources)
+	{
+		if (resource.loaded)
+			uploader->Upload(resource);
+		else
+			failedCount++;
+	}
+	uploader->End();
+	return failedCount;
+}
+
+bool ResourceLoader::LoadTexture(LoadedResource &resource)
+{
+	resource.file = make_unique<MemoryMappedFile>();
+	if (!resource.file->Open(resource.path.c_str()))
+		return false;
+
+	if (!DDSTextureLayout::Parse(resource.file->GetData(), (size_t)resource.file->GetSize(), &resource.textureLayout))
+		return false;
+
+	// Touch every page of the mips that will be uploaded, so that the disk reads happen
+	// here and not on the thread that records the uploads.
+	const size_t pageSize = 4096;
+	size_t firstMip = resource.textureLayout.GetFirstResidentMip(resource.residentMipCount);
+	volatile uint8_t sum = 0;
+	for (size_t item = 0; item < resource.textureLayout.arraySize; ++item)
+	{
+		for (size_t mip = firstMip; mip < resource.textureLayout.mipCount; ++mip)
+		{
+			const DDSSubresource &subresource = resource.textureLayout.GetSubresource(item, mip);
+			size_t size = subresource.slicePitch * subresource.depth;
+			for (size_t offset = 0; offset < size; offset += pageSize)
+				sum += subresource.data[offset];
+		}
+	}
+
+	return true;
+}
+
+bool ResourceLoader::LoadShader(LoadedResource &resource)
+{
+	ifstream fin(resource.path, ios::binary | ios::ate);
+	if (!fin)
+		return false;
+
+	streamoff size = fin.tellg();
+	fin.seekg(0, ios_base::beg);
+	if (FAILED(D3DCreateBlob((SIZE_T)size, resource.shader.GetAddressOf())))
+		return false;
+
+	fin.read((char *)resource.shader->GetBufferPointer(), size);
+	return !fin.fail();
+}
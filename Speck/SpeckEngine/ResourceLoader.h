@@ -0,0 +1,71 @@
+#ifndef RESOURCE_LOADER_H
+#define RESOURCE_LOADER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "DirectXHeaders.h"
+#include "AppCommands.h"
+#include "GeometryGenerator.h"
+#include "MeshSimplifier.h"
+#include "MemoryMappedFile.h"
+#include "DDSTextureLayout.h"
+
+namespace Speck
+{
+	class WorkerPool;
+
+	// Resource as it goes through the loading: the request, then its data once the file is loaded and decoded.
+	struct LoadedResource
+	{
+		std::string name;
+		std::wstring path;
+		AppCommands::ResourceType resType;
+		// Textures only, see AppCommands::LoadResourceCommand.
+		UINT residentMipCount = 0;
+
+		// Set when the CPU side of the loading succeeded.
+		bool loaded = false;
+
+		// Texture (the file stays mapped, the layout points into it)
+		std::unique_ptr<MemoryMappedFile> file;
+		DDSTextureLayout textureLayout;
+		// Shader
+		Microsoft::WRL::ComPtr<ID3DBlob> shader;
+		// Geometry
+		GeometryGenerator::StaticMeshData mesh;
+		DirectX::BoundingBox bounds;
+		std::vector<MeshLOD> lods;
+	};
+
+	// Takes the loaded resources to the GPU. The app records all of them to a single command list
+	// and waits once, other implementations can stand in for it where there is no device.
+	class ResourceUploader
+	{
+	public:
+		virtual ~ResourceUploader() = default;
+
+		virtual void Begin() = 0;
+		virtual void Upload(LoadedResource &resource) = 0;
+		// Returns when all of the uploads are done.
+		virtual void End() = 0;
+	};
+
+	//-------------------------------------------------------------------------------------
+	//	Loads a batch of resources. File I/O and decoding of all the resources is done in
+	//	parallel on the worker pool, then the uploader gets them one after another on the
+	//	calling thread.
+	//-------------------------------------------------------------------------------------
+	class ResourceLoader
+	{
+	public:
+		// The CPU side only, the worker pool is optional.
+		DLL_EXPORT static void LoadCPU(std::vector<LoadedResource> &resources, WorkerPool *workerPool);
+		// Loads and uploads the batch. Returns the number of the resources that could not be loaded.
+		DLL_EXPORT static UINT Load(std::vector<LoadedResource> &resources, WorkerPool *workerPool, ResourceUploader *uploader);
+
+	private:
+		static bool LoadTexture(LoadedResource &resource);
+		static bool LoadShader(LoadedResource &resource);
+	};
+}
+
+#endif
@@ -0,0 +1,246 @@
+#include "SDFGradient.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using namespace Speck::WorldCommands;
+
+// Specks closer than this (relative to the speck diameter) are neighbours
+static const float NEIGHBOUR_DISTANCE_FACTOR = 1.2f;
+// Larger bodies fall back to the neighbour search only
+static const UINT MAX_VOXEL_COUNT = 1 << 23;
+static const float INFINITE_DISTANCE = numeric_limits<float>::infinity();
+
+// Runs the function over [0, count) on the worker pool if there is one.
+static void ForEachChunk(WorkerPool *workerPool, UINT count, UINT chunkSize, const function<void(UINT begin, UINT end)> &func)
+{
+	if (workerPool)
+		workerPool->ParallelFor(count, chunkSize, func);
+	else if (count > 0)
+		func(0, count);
+}
+
+// Cell coordinates are offset by one so that the neighbouring cells are never negative.
+static uint64_t GetCellKey(UINT x, UINT y, UINT z)
+{
+	return (uint64_t)x | ((uint64_t)y << 21) | ((uint64_t)z << 42);
+}
+
+// Squared Euclidean distance transform of a sampled function in one dimension
+// (Felzenszwalb and Huttenlocher). Infinite samples are not used as parabola sites.
+static void DistanceTransform1D(const float *f, UINT n, float *d, int *v, float *z)
+{
+	int k = -1;
+	for (int q = 0; q < (int)n; ++q)
+	{
+		if (f[q] == INFINITE_DISTANCE) continue;
+		if (k < 0)
+		{
+			k = 0;
+			v[0] = q;
+			z[0] = -INFINITE_DISTANCE;
+			z[1] = INFINITE_DISTANCE;
+			continue;
+		}
+
+		float s;
+		for (;;)
+		{
+			int p = v[k];
+			s = ((f[q] + (float)(q * q)) - (f[p] + (float)(p * p))) / (float)(2 * q - 2 * p);
+			if (s > z[k]) break;
+			--k; // z[0] is minus infinity, so k never gets below zero
+		}
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = INFINITE_DISTANCE;
+	}
+
+	if (k < 0)
+	{
+		fill(d, d + n, INFINITE_DISTANCE);
+		return;
+	}
+
+	k = 0;
+	for (int q = 0; q < (int)n; ++q)
+	{
+		while (z[k + 1] < (float)q) ++k;
+		int diff = q - v[k];
+		d[q] = (float)(diff * diff) + f[v[k]];
+	}
+}
+
+// Applies the one dimensional transform to every line of the grid along one axis.
+// The first voxel of a line is at (line % innerCount) * innerStride + (line / innerCount) * outerStride.
+static void DistanceTransformAxis(vector<float> *field, UINT lineLength, UINT stride, UINT lineCount, UINT innerCount, UINT innerStride, UINT outerStride,
+	WorkerPool *workerPool)
+{
+	float *data = field->data();
+	ForEachChunk(workerPool, lineCount, 64, [=](UINT begin, UINT end)
+	{
+		vector<float> f(lineLength), d(lineLength), z(lineLength + 1);
+		vector<int> v(lineLength);
+		for (UINT line = begin; line < end; ++line)
+		{
+			float *first = data + (line % innerCount) * innerStride + (line / innerCount) * outerStride;
+			for (UINT i = 0; i < lineLength; ++i) f[i] = first[i * stride];
+			DistanceTransform1D(f.data(), lineLength, d.data(), v.data(), z.data());
+			for (UINT i = 0; i < lineLength; ++i) first[i * stride] = d[i];
+		}
+	});
+}
+
+void SDFGradient::Calculate(const vector<NewSpeck> &specks, float speckRadius, WorkerPool *workerPool, vector<XMFLOAT3> *outGradients)
+{
+	UINT speckCount = (UINT)specks.size();
+	outGradients->assign(speckCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	if (speckCount == 0) return;
+
+	// Bounds
+	XMVECTOR minPos = XMLoadFloat3(&specks[0].position);
+	XMVECTOR maxPos = minPos;
+	for (UINT i = 1; i < speckCount; ++i)
+	{
+		XMVECTOR pos = XMLoadFloat3(&specks[i].position);
+		minPos = XMVectorMin(minPos, pos);
+		maxPos = XMVectorMax(maxPos, pos);
+	}
+
+	// Step 1: sort the specks by cells as large as the neighbour distance
+	float maxDist = speckRadius * 2.0f * NEIGHBOUR_DISTANCE_FACTOR;
+	float maxDistSq = maxDist*maxDist;
+	float invMaxDistSq = 1.0f / maxDistSq;
+	XMVECTOR invCellSize = XMVectorReplicate(1.0f / maxDist);
+	vector<XMINT3> speckCells(speckCount);
+	vector<pair<uint64_t, UINT>> sortedSpecks(speckCount);
+	for (UINT i = 0; i < speckCount; ++i)
+	{
+		XMVECTOR cell = XMVectorFloor((XMLoadFloat3(&specks[i].position) - minPos) * invCellSize) + XMVectorReplicate(1.0f);
+		XMStoreSInt3(&speckCells[i], cell);
+		sortedSpecks[i] = make_pair(GetCellKey(speckCells[i].x, speckCells[i].y, speckCells[i].z), i);
+	}
+	sort(sortedSpecks.begin(), sortedSpecks.end());
+
+	// Step 2: boundary specks and the local gradient estimate, both from the neighbours only.
+	// The local estimate weights the neighbours with the inverse distance to the power of 20.
+	vector<uint8_t> isBoundary(speckCount); // not vector<bool>, it is written from many threads
+	vector<XMFLOAT3> localGradients(speckCount);
+	ForEachChunk(workerPool, speckCount, 256, [&](UINT begin, UINT end)
+	{
+		for (UINT i = begin; i < end; ++i)
+		{
+			XMVECTOR gradient1 = XMVectorZero(); // used as the local gradient estimate
+			XMVECTOR gradient2 = XMVectorZero(); // used as an indicator of the boundary specks
+			XMVECTOR pos = XMLoadFloat3(&specks[i].position);
+			const XMINT3 &cell = speckCells[i];
+			for (int z = cell.z - 1; z <= cell.z + 1; ++z)
+			{
+				for (int y = cell.y - 1; y <= cell.y + 1; ++y)
+				{
+					// cells with the same y and z are next to each other in the sorted list
+					auto first = lower_bound(sortedSpecks.begin(), sortedSpecks.end(), make_pair(GetCellKey(cell.x - 1, y, z), 0U));
+					uint64_t lastKey = GetCellKey(cell.x + 1, y, z);
+					for (auto it = first; it != sortedSpecks.end() && it->first <= lastKey; ++it)
+					{
+						UINT j = it->second;
+						if (i == j) continue;
+						XMVECTOR r = pos - XMLoadFloat3(&specks[j].position);
+						float lenSq = XMVectorGetX(XMVector3LengthSq(r));
+						if (lenSq < maxDistSq && lenSq > 0.0f)
+						{
+							gradient2 += r;
+							float s = max(lenSq * invMaxDistSq, 0.01f); // keeps the weight finite
+							float s2 = s*s;
+							float s4 = s2*s2;
+							float s8 = s4*s4;
+							gradient1 += r * (1.0f / (s8*s2));
+						}
+					}
+				}
+			}
+			float grad2Len = XMVectorGetX(XMVector3LengthEst(gradient2));
+			float epsilon = 0.001f;
+			isBoundary[i] = (grad2Len > epsilon);
+			XMStoreFloat3(&localGradients[i], XMVector3Normalize(gradient1));
+		}
+	});
+
+	// Step 3: voxelize the body. Every speck fills the voxels up to the center of a cube of neighbouring specks,
+	// so that there are no holes between them. There is at least one empty voxel on every side.
+	float voxelSize = speckRadius;
+	float splatRadius = maxDist * 0.5f * sqrtf(3.0f);
+	XMVECTOR padding = XMVectorReplicate(splatRadius + voxelSize);
+	XMVECTOR origin = minPos - padding;
+	XMFLOAT3 extents;
+	XMStoreFloat3(&extents, (maxPos - minPos + 2.0f * padding) / voxelSize);
+	bool useVoxels = ((extents.x + 2.0f) * (extents.y + 2.0f) * (extents.z + 2.0f) <= (float)MAX_VOXEL_COUNT);
+	UINT nx = useVoxels ? (UINT)extents.x + 2 : 0;
+	UINT ny = useVoxels ? (UINT)extents.y + 2 : 0;
+	UINT nz = useVoxels ? (UINT)extents.z + 2 : 0;
+
+	vector<float> field;
+	if (useVoxels)
+	{
+		field.assign(nx * ny * nz, 0.0f);
+		int splatVoxels = (int)ceilf(splatRadius / voxelSize);
+		float splatRadiusSq = splatRadius*splatRadius;
+		for (UINT i = 0; i < speckCount; ++i)
+		{
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, (XMLoadFloat3(&specks[i].position) - origin) / voxelSize);
+			int cx = (int)p.x, cy = (int)p.y, cz = (int)p.z;
+			for (int z = cz - splatVoxels; z <= cz + splatVoxels; ++z)
+				for (int y = cy - splatVoxels; y <= cy + splatVoxels; ++y)
+					for (int x = cx - splatVoxels; x <= cx + splatVoxels; ++x)
+					{
+						float dx = ((float)x + 0.5f - p.x) * voxelSize;
+						float dy = ((float)y + 0.5f - p.y) * voxelSize;
+						float dz = ((float)z + 0.5f - p.z) * voxelSize;
+						if (dx*dx + dy*dy + dz*dz <= splatRadiusSq)
+							field[(z * ny + y) * nx + x] = INFINITE_DISTANCE;
+					}
+		}
+
+		// Step 4: squared distance of every filled voxel to the closest empty one, separably along x, y and z
+		DistanceTransformAxis(&field, nx, 1, ny * nz, ny * nz, nx, 0, workerPool);
+		DistanceTransformAxis(&field, ny, nx, nx * nz, nx, 1, nx * ny, workerPool);
+		DistanceTransformAxis(&field, nz, nx * ny, nx * ny, nx * ny, 1, 0, workerPool);
+	}
+
+	// Step 5: gradients, central differences of the distance field point inside, so they are negated.
+	// Where the distance field is flat (thin or symmetric parts) the local estimate is used.
+	ForEachChunk(workerPool, speckCount, 256, [&](UINT begin, UINT end)
+	{
+		for (UINT i = begin; i < end; ++i)
+		{
+			XMVECTOR gradient = XMVectorZero();
+			if (useVoxels)
+			{
+				XMFLOAT3 p;
+				XMStoreFloat3(&p, (XMLoadFloat3(&specks[i].position) - origin) / voxelSize);
+				UINT index = ((UINT)p.z * ny + (UINT)p.y) * nx + (UINT)p.x;
+				auto dist = [&](UINT voxel) { return sqrtf(field[voxel]); };
+				gradient = XMVectorSet(
+					dist(index - 1) - dist(index + 1),
+					dist(index - nx) - dist(index + nx),
+					dist(index - nx * ny) - dist(index + nx * ny),
+					0.0f);
+			}
+			if (XMVector3Less(XMVector3LengthSq(gradient), XMVectorReplicate(1e-6f)))
+			{
+				gradient = XMLoadFloat3(&localGradients[i]);
+			}
+			gradient = XMVector3Normalize(gradient);
+			if (isBoundary[i])
+			{
+				gradient *= 2.0f; // indication that this is a boundary speck
+			}
+			XMStoreFloat3(&(*outGradients)[i], gradient);
+		}
+	});
+}
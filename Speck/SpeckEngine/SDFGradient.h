@@ -0,0 +1,27 @@
+#ifndef SDF_GRADIENT_H
+#define SDF_GRADIENT_H
+
+#include "SpeckEngineDefinitions.h"
+#include "WorldCommands.h"
+
+namespace Speck
+{
+	class WorkerPool;
+
+	//-------------------------------------------------------------------------------------
+	//	Calculates the gradient of the signed distance field of a rigid body made out of
+	//	specks. Boundary specks are found with a neighbour search over a uniform grid and
+	//	the gradient is taken from a voxel distance transform of the body.
+	//-------------------------------------------------------------------------------------
+	class SDFGradient
+	{
+	public:
+		// Outputs one gradient per speck. The gradient points towards the closest surface and has
+		// the length of 2 for boundary specks and 1 for the others (0 if it could not be determined).
+		// The worker pool is optional.
+		DLL_EXPORT static void Calculate(const std::vector<WorldCommands::NewSpeck> &specks, float speckRadius, WorkerPool *workerPool,
+			std::vector<DirectX::XMFLOAT3> *outGradients);
+	};
+}
+
+#endif
@@ -0,0 +1,41 @@
+#include "SolverStats.h"
+
+using namespace std;
+using namespace Speck;
+
+UINT Speck::EncodeSolverResidual(float residual, float speckRadius)
+{
+	if (residual <= 0.0f)
+		return 0;
+	return (UINT)(residual / speckRadius * SOLVER_STATS_RESIDUAL_SCALE + 0.5f);
+}
+
+SolverStats Speck::DecodeSolverStats(const SolverStatsData &data, float speckRadius)
+{
+	SolverStats stats;
+	stats.mFrame = data.frame;
+	stats.mSpecks = data.specks;
+	stats.mSubsteps = data.substeps;
+	stats.mSolverIterations = data.solverIterations;
+	stats.mGridOverflowCount = data.gridOverflowCount;
+	stats.mMaxSpeckContacts = data.speckContactsMax;
+	stats.mDroppedSpeckContacts = data.droppedSpeckContacts;
+	stats.mDroppedStaticColliderContacts = data.droppedStaticColliderContacts;
+	stats.mDroppedRigidBodyConstraints = data.droppedRigidBodyConstraints;
+
+	float speckSubsteps = (float)data.specks * data.substeps;
+	if (speckSubsteps > 0.0f)
+	{
+		stats.mAverageSpeckContacts = data.speckContactsSum / speckSubsteps;
+		stats.mActiveSpecks = data.activeSpecks / data.substeps;
+		stats.mSleepingSpecks = data.sleepingSpecks / data.substeps;
+
+		UINT recordedIterations = min(data.solverIterations, (UINT)SOLVER_STATS_MAX_ITERATIONS);
+		for (UINT i = 0; i < recordedIterations; ++i)
+		{
+			stats.mAverageResidual[i] = data.residualSum[i] * speckRadius / (SOLVER_STATS_RESIDUAL_SCALE * speckSubsteps);
+			memcpy(&stats.mMaxResidual[i], &data.residualMax[i], sizeof(float));
+		}
+	}
+	return stats;
+}
@@ -0,0 +1,40 @@
+#ifndef SOLVER_STATS_H
+#define SOLVER_STATS_H
+
+#include "SpeckEngineDefinitions.h"
+#include "PhysicsDataStructs.h"
+
+namespace Speck
+{
+	// Counters of the work the solver did or dropped in a frame, as the phases write them
+	// (the same layout as SolverStatsData in specksCS_Root.hlsl).
+	struct SolverStatsData
+	{
+		// Written by the CPU before the first substep.
+		UINT frame;
+		UINT specks;
+		UINT substeps;
+		UINT solverIterations;
+		// Specks that did not fit in their grid cell.
+		UINT gridOverflowCount;
+		UINT speckContactsSum;
+		UINT speckContactsMax;
+		// Constraints that were found, but there was no room to keep them.
+		UINT droppedSpeckContacts;
+		UINT droppedStaticColliderContacts;
+		UINT droppedRigidBodyConstraints;
+		UINT activeSpecks;
+		UINT sleepingSpecks;
+		// Position corrections in each solver iteration, the sums are in fixed point
+		// and the maximums are the bits of the (non-negative) float values.
+		UINT residualSum[SOLVER_STATS_MAX_ITERATIONS];
+		UINT residualMax[SOLVER_STATS_MAX_ITERATIONS];
+	};
+
+	// Fixed point value of a position correction in the residual sums, as RecordSolverResidual in specksCS_Root.hlsl adds it.
+	DLL_EXPORT UINT EncodeSolverResidual(float residual, float speckRadius);
+	// Stats of the frame from the counters read back from the device.
+	DLL_EXPORT SolverStats DecodeSolverStats(const SolverStatsData &data, float speckRadius);
+}
+
+#endif
@@ -10,7 +10,11 @@
 #include "CubeRenderTarget.h"
 #include "DDSTextureGenerator.h"
 #include "SpecksHandler.h"
+#include "Profiler.h"
 #include "Resources.h"
+#include "TextureStreamer.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -32,7 +36,8 @@ void Speck::CreateSpeckApp(HINSTANCE hInstance, float speckRadius, UINT maxNumbe
 
 SpeckApp::SpeckApp(HINSTANCE hInstance, UINT maxNumberOfMaterials, EngineCore &ec, World &w)
 	: D3DApp(hInstance, ec, w),
-	mMaxNumberOfMaterials(maxNumberOfMaterials)
+	mMaxNumberOfMaterials(maxNumberOfMaterials),
+	mTextureStreamer(make_unique<TextureStreamer>())
 {
 }
 
@@ -146,10 +151,32 @@ void SpeckApp::PreDrawUpdate(const Timer & gt)
 {
 	D3DApp::PreDrawUpdate(gt);
 	GetWorld().PreDrawUpdate();
+
+	// Stream in the texture mips, the copies are done before this frame's fence is signaled.
+	auto &dxCore = GetEngineCore().GetDirectXCore();
+	vector<Texture *> updatedTextures;
+	mTextureStreamer->Update(dxCore.GetDevice(), dxCore.GetCommandList(), dxCore.GetFence()->GetCompletedValue(), dxCore.GetCurrentFence() + 1, &updatedTextures);
+	if (!updatedTextures.empty())
+	{
+		// Materials that use the updated textures can sample the new mips from the next frame on
+		for (auto& e : mMaterials)
+		{
+			PBRMaterial *mat = static_cast<PBRMaterial *>(e.second.get());
+			for (int i = 0; i < MATERIAL_TEXTURES_COUNT; ++i)
+			{
+				if (mat->Textures[i] && find(updatedTextures.begin(), updatedTextures.end(), mat->Textures[i]) != updatedTextures.end())
+				{
+					mat->NumFramesDirty = NUM_FRAME_RESOURCES;
+					break;
+				}
+			}
+		}
+	}
 }
 
 void SpeckApp::Draw(const Timer& gt)
 {
+	PROFILE_ZONE("SpeckApp::Draw");
 	auto &dxCore = GetEngineCore().GetDirectXCore();
 	auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
 
@@ -614,6 +641,8 @@ void SpeckApp::BuildRootSignatures()
 	slotRootParameter[(UINT)MainPassRootParameter::TexturesDescriptorTable].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);	// descriptor table (for textures)
 	slotRootParameter[(UINT)MainPassRootParameter::MaterialsRootDescriptor].InitAsShaderResourceView(1, 1);										// root descriptor (for materials)
 	slotRootParameter[(UINT)MainPassRootParameter::RigidBodyRootDescriptor].InitAsShaderResourceView(2, 1);										// root descriptor (for rigid bodies)
+	slotRootParameter[(UINT)MainPassRootParameter::StaticInstancesRootDescriptor].InitAsShaderResourceView(3, 1);								// root descriptor (for static instances)
+	slotRootParameter[(UINT)MainPassRootParameter::StaticInstanceIndicesRootDescriptor].InitAsShaderResourceView(4, 1);							// root descriptor (for indices of static instances)
 	slotRootParameter[(UINT)MainPassRootParameter::PassRootDescriptor].InitAsConstantBufferView(1);												// root descriptor (for pass buffer)
 
 	auto staticSamplers = GetStaticSamplers();
@@ -757,15 +786,16 @@ void SpeckApp::BuildScreenGeometry()
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), md.Indices32.data(), ibByteSize);
 
 	geo->VertexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader, MemoryTag::Geometry);
 
 	geo->IndexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), md.Indices32.data(), ibByteSize, geo->IndexBufferUploader);
+		dxCore.GetCommandList(), md.Indices32.data(), ibByteSize, geo->IndexBufferUploader, MemoryTag::Geometry);
 
 	geo->VertexByteStride = sizeof(ScreenQuadVertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
+	geo->TrackCPUMemory();
 
 	SubmeshGeometry submesh;
 	submesh.IndexCount = (UINT)md.Indices32.size();
@@ -781,6 +811,7 @@ void SpeckApp::BuildSpeckGeometry()
 	auto &dxCore = GetEngineCore().GetDirectXCore();
 	GeometryGenerator gg;
 	GeometryGenerator::StaticMeshData md = gg.CreateGeosphere(SpecksHandler::GetSpeckRadius(), 3);
+	MeshOptimizer::Optimize(&md);
 
 	BoundingBox bounds;
 	XMStoreFloat3(&bounds.Center, XMVectorZero());
@@ -811,15 +842,16 @@ void SpeckApp::BuildSpeckGeometry()
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), md.Indices32.data(), ibByteSize);
 
 	geo->VertexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader, MemoryTag::Geometry);
 
 	geo->IndexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), md.Indices32.data(), ibByteSize, geo->IndexBufferUploader);
+		dxCore.GetCommandList(), md.Indices32.data(), ibByteSize, geo->IndexBufferUploader, MemoryTag::Geometry);
 
 	geo->VertexByteStride = sizeof(SpeckVertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
+	geo->TrackCPUMemory();
 
 	SubmeshGeometry submesh;
 	submesh.IndexCount = (UINT)md.Indices32.size();
@@ -839,6 +871,10 @@ void SpeckApp::BuildRegularGeometry()
 	GeometryGenerator::StaticMeshData grid = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
 	GeometryGenerator::StaticMeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
 	GeometryGenerator::StaticMeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+	MeshOptimizer::Optimize(&box);
+	MeshOptimizer::Optimize(&grid);
+	MeshOptimizer::Optimize(&sphere);
+	MeshOptimizer::Optimize(&cylinder);
 
 	//
 	// We are concatenating all the geometry into one big vertex/index buffer.  So
@@ -865,24 +901,28 @@ void SpeckApp::BuildRegularGeometry()
 	boxSubmesh.StartIndexLocation	= boxIndexOffset;
 	boxSubmesh.BaseVertexLocation	= boxVertexOffset;
 	boxSubmesh.Bounds				= box.CalculateBounds();
+	MeshletBuilder::Build(&box, box.Indices32.size(), &boxSubmesh.Meshlets);
 
 	SubmeshGeometry gridSubmesh;
 	gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
 	gridSubmesh.StartIndexLocation = gridIndexOffset;
 	gridSubmesh.BaseVertexLocation = gridVertexOffset;
 	gridSubmesh.Bounds = grid.CalculateBounds();
+	MeshletBuilder::Build(&grid, grid.Indices32.size(), &gridSubmesh.Meshlets);
 
 	SubmeshGeometry sphereSubmesh;
 	sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
 	sphereSubmesh.StartIndexLocation = sphereIndexOffset;
 	sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
 	sphereSubmesh.Bounds = sphere.CalculateBounds();
+	MeshletBuilder::Build(&sphere, sphere.Indices32.size(), &sphereSubmesh.Meshlets);
 
 	SubmeshGeometry cylinderSubmesh;
 	cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
 	cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
 	cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
 	cylinderSubmesh.Bounds = cylinder.CalculateBounds();
+	MeshletBuilder::Build(&cylinder, cylinder.Indices32.size(), &cylinderSubmesh.Meshlets);
 
 	//
 	// Extract the vertex elements we are interested in and pack the
@@ -932,15 +972,16 @@ void SpeckApp::BuildRegularGeometry()
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
 	geo->VertexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+		dxCore.GetCommandList(), vertices.data(), vbByteSize, geo->VertexBufferUploader, MemoryTag::Geometry);
 
 	geo->IndexBufferGPU = CreateDefaultBuffer(dxCore.GetDevice(),
-		dxCore.GetCommandList(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+		dxCore.GetCommandList(), indices.data(), ibByteSize, geo->IndexBufferUploader, MemoryTag::Geometry);
 
 	geo->VertexByteStride = sizeof(GeometryGenerator::StaticVertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
 	geo->IndexBufferByteSize = ibByteSize;
+	geo->TrackCPUMemory();
 
 	geo->DrawArgs["box"] = boxSubmesh;
 	geo->DrawArgs["grid"] = gridSubmesh;
@@ -1392,7 +1433,9 @@ void SpeckApp::BuildDeferredRenderTargetsAndBuffers()
 	{
 		device->CreateRenderTargetView(mDeferredRTBs[i].Get(), nullptr, rtvHeapHandle);
 		rtvHeapHandle.Offset(1, dxCore.GetRtvDescriptorSize());
+		MemoryTracker::TrackResource(mDeferredRTBs[i].Get(), MemoryTag::RenderTargets);
 	}
+	MemoryTracker::TrackResource(mDeferredDepthStencilBuffer.Get(), MemoryTag::RenderTargets);
 }
 
 void SpeckApp::BuildSSAORenderTargetsAndBuffers()
@@ -1458,6 +1501,9 @@ void SpeckApp::BuildSSAORenderTargetsAndBuffers()
 	rtvHeapHandle.Offset(1, dxCore.GetRtvDescriptorSize()); // skip the first
 	mSSAORTVHeapHandle[1] = rtvHeapHandle;
 	device->CreateRenderTargetView(mSSAOBuffer[1].Get(), nullptr, rtvHeapHandle);
+
+	MemoryTracker::TrackResource(mSSAOBuffer[0].Get(), MemoryTag::RenderTargets);
+	MemoryTracker::TrackResource(mSSAOBuffer[1].Get(), MemoryTag::RenderTargets);
 }
 
 void SpeckApp::BuildRandomVectorBuffer()
@@ -1506,6 +1552,8 @@ void SpeckApp::BuildRandomVectorBuffer()
 		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
 		IID_PPV_ARGS(mRandomVectorMapUploadBuffer.GetAddressOf())));
+	MemoryTracker::TrackResource(mRandomVectorMap.Get(), MemoryTag::RenderTargets);
+	MemoryTracker::TrackResource(mRandomVectorMapUploadBuffer.Get(), MemoryTag::RenderTargets);
 
 	XMCOLOR initData[256 * 256];
 	for (int i = 0; i < 256; ++i)
@@ -12,6 +12,8 @@ namespace Speck
 	struct Material;
 	struct Texture;
 	struct FrameResource;
+	class TextureStreamer;
+	class SpeckResourceUploader;
 
 	namespace AppCommands
 	{
@@ -32,6 +34,7 @@ namespace Speck
 	{
 		friend class SpeckWorld;
 
+		friend class SpeckResourceUploader;
 		friend struct AppCommands::LoadResourceCommand;
 		friend struct AppCommands::CreateMaterialCommand;
 		friend struct AppCommands::CreateStaticGeometryCommand;
@@ -61,6 +64,8 @@ namespace Speck
 			TexturesDescriptorTable,
 			MaterialsRootDescriptor,
 			RigidBodyRootDescriptor,
+			StaticInstancesRootDescriptor,
+			StaticInstanceIndicesRootDescriptor,
 			PassRootDescriptor,
 			Count // Number of elements in this enum
 		};
@@ -112,6 +117,7 @@ namespace Speck
 		UINT mLatestMatCBIndex = 0;
 		const UINT mMaxNumberOfMaterials;
 		std::unordered_map<std::string, std::unique_ptr<Texture>>			mTextures;
+		std::unique_ptr<TextureStreamer> mTextureStreamer;
 		ID3D12Resource *mDefaultTextures[MATERIAL_TEXTURES_COUNT]; // for easy access based on index
 		std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3DBlob>>	mShaders;
 
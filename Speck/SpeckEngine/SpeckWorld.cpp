@@ -10,6 +10,9 @@
 #include "Camera.h"
 #include "CubeRenderTarget.h"
 #include "SpecksHandler.h"
+#include "RenderStateCache.h"
+#include "Profiler.h"
+#include "MeshSimplifier.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -46,18 +49,18 @@ void SpeckWorld::Initialize(App * app)
 	mSpecksHandler = make_unique<SpecksHandler>(sApp->GetEngineCore(), *this, &sApp->mFrameResources, 2, 4, 1);
 
 	// Build the specks render item.
-	auto rItem = make_unique<SpecksRenderItem>();
-	rItem->mGeo = sApp->mGeometries["speckGeo"].get();
-	rItem->mPrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	rItem->mInstanceCount = 0;
-	rItem->mIndexCount = rItem->mGeo->DrawArgs["speck"].IndexCount;
-	rItem->mStartIndexLocation = rItem->mGeo->DrawArgs["speck"].StartIndexLocation;
-	rItem->mBaseVertexLocation = rItem->mGeo->DrawArgs["speck"].BaseVertexLocation;
-	rItem->mBufferIndex = mSpecksHandler->GetSpecksBufferIndex();
+	SpecksRenderItem rItem;
+	rItem.mGeo = sApp->mGeometries["speckGeo"].get();
+	rItem.mPrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	rItem.mInstanceCount = 0;
+	rItem.mIndexCount = rItem.mGeo->DrawArgs["speck"].IndexCount;
+	rItem.mStartIndexLocation = rItem.mGeo->DrawArgs["speck"].StartIndexLocation;
+	rItem.mBaseVertexLocation = rItem.mGeo->DrawArgs["speck"].BaseVertexLocation;
+	rItem.mBufferIndex = mSpecksHandler->GetSpecksBufferIndex();
 	// Save reference.
-	mSpeckInstancesRenderItem = rItem.get();
+	mSpeckInstancesRenderItem = mRenderScene.Add(rItem);
 	// Add to the render group.
-	mPSOGroups["instanced"]->mRItems.push_back(move(rItem));
+	mPSOGroups["instanced"]->mRItems.push_back(mSpeckInstancesRenderItem);
 }
 
 int SpeckWorld::ExecuteCommand(const WorldCommand &command, CommandResult *result)
@@ -67,17 +70,10 @@ int SpeckWorld::ExecuteCommand(const WorldCommand &command, CommandResult *resul
 
 void SpeckWorld::Update()
 {
+	PROFILE_ZONE("SpeckWorld::Update");
 	SpeckApp *sApp = static_cast<SpeckApp *>(mApp);
-	auto currCB = sApp->mCurrFrameResource->RenderItemConstantsBuffer.get();
-	// For each PSO group.
-	for (auto& psoGrp : mPSOGroups)
-	{
-		// For each render item in the PSO group.
-		for (auto& rItem : psoGrp.second->mRItems)
-		{
-			rItem->UpdateBufferCPU(sApp, sApp->mCurrFrameResource);
-		}
-	}
+	// Only the render items that changed are uploaded.
+	mRenderScene.UpdateConstants(sApp->mCurrFrameResource);
 
 	XMMATRIX view = sApp->GetEngineCore().GetCamera().GetView();
 	XMMATRIX proj = sApp->GetEngineCore().GetCamera().GetProj();
@@ -110,24 +106,28 @@ void SpeckWorld::Update()
 
 	// Speck handler
 	mSpecksHandler->UpdateCPU(sApp->mCurrFrameResource);
+
+	UpdateMemory();
+}
+
+void SpeckWorld::UpdateMemory()
+{
+	UINT64 reserved = mSpecks.capacity() * sizeof(SpeckData) + mSpeckRigidBodyData.capacity() * sizeof(SpeckRigidBodyData) +
+		mStaticColliders.capacity() * sizeof(StaticCollider) + mExternalForces.capacity() * sizeof(ExternalForces);
+	UINT64 used = mSpecks.size() * sizeof(SpeckData) + mSpeckRigidBodyData.size() * sizeof(SpeckRigidBodyData) +
+		mStaticColliders.size() * sizeof(StaticCollider) + mExternalForces.size() * sizeof(ExternalForces);
+	for (const SpeckRigidBodyData &rigidBody : mSpeckRigidBodyData)
+	{
+		reserved += rigidBody.mLinks.capacity() * sizeof(SpeckRigidBodyLink);
+		used += rigidBody.mLinks.size() * sizeof(SpeckRigidBodyLink);
+	}
+	mMemory.Set(reserved, used);
 }
 
 void SpeckWorld::PreDrawUpdate()
 {
-	SpeckApp *sApp = static_cast<SpeckApp *>(mApp);
-	
 	// Speck handler
 	mSpecksHandler->UpdateGPU();
-
-	// For each PSO group.
-	for (auto& psoGrp : mPSOGroups)
-	{
-		// For each render item in a PSO group.
-		for (auto& rItem : psoGrp.second->mRItems)
-		{
-			rItem->UpdateBufferGPU(sApp, sApp->mCurrFrameResource);
-		}
-	}
 }
 
 void SpeckWorld::Draw(UINT stage)
@@ -144,8 +144,35 @@ void SpeckWorld::Draw(UINT stage)
 	}
 }
 
+void SpeckWorld::UpdateCullingBounds(PSOGroup *group)
+{
+	FrustumCuller &culler = group->mCuller;
+	auto updateBounds = [&](UINT index)
+	{
+		BoundingBox bounds;
+		if (mRenderScene.GetWorldBounds(mApp, group->mRItems[index], &bounds))
+			culler.SetBounds(index, bounds);
+		else
+			culler.SetAlwaysVisible(index);
+	};
+
+	// Moving items are updated every frame, the others only when they are added
+	for (UINT index : group->mMovingRItems)
+		updateBounds(index);
+
+	UINT first = culler.GetCount();
+	culler.Resize((UINT)group->mRItems.size());
+	for (UINT index = first; index < culler.GetCount(); ++index)
+	{
+		updateBounds(index);
+		if (mRenderScene.CanMove(group->mRItems[index]))
+			group->mMovingRItems.push_back(index);
+	}
+}
+
 void SpeckWorld::Draw_Scene()
 {
+	PROFILE_ZONE("SpeckWorld::Draw_Scene");
 	SpeckApp *sApp = static_cast<SpeckApp *>(mApp);
 	auto &dxCore = sApp->GetEngineCore().GetDirectXCore();
 	XMMATRIX view = sApp->GetEngineCore().GetCamera().GetView();
@@ -154,26 +181,243 @@ void SpeckWorld::Draw_Scene()
 	BoundingFrustum transformedFrustum;
 	mCamFrustum.Transform(transformedFrustum, invView);
 
+	// Size of a unit at the distance of one unit from the camera, in pixels
+	const Camera &camera = sApp->GetEngineCore().GetCamera();
+	float pixelsPerUnit = dxCore.GetClientHeight() / (2.0f * tanf(0.5f * camera.GetFovY()));
+	XMVECTOR cameraPosition = invView.r[3];
+
+	// Find the render items in the frustum
+	for (auto &grp : mPSOGroups)
+	{
+		if (!grp.second->mVisible) continue;
+
+		UpdateCullingBounds(grp.second.get());
+		vector<UINT> &visibleRItems = grp.second->mVisibleRItems;
+		if (mFrustumCullingEnabled)
+		{
+			grp.second->mCuller.Cull(transformedFrustum, &visibleRItems);
+		}
+		else
+		{
+			visibleRItems.resize(grp.second->mRItems.size());
+			for (UINT i = 0; i < (UINT)visibleRItems.size(); ++i)
+				visibleRItems[i] = i;
+		}
+	}
+
+	// Skip the ones behind the big static items
+	if (mOcclusionCullingEnabled)
+		CullOccluded(camera.GetViewProj(), cameraPosition);
+
+	// The groups are indexed in the draw keys, always in the same order
+	if (mSortedPSOGroups.size() != mPSOGroups.size())
+	{
+		mSortedPSOGroups.clear();
+		for (auto &grp : mPSOGroups)
+			mSortedPSOGroups.push_back(make_pair(grp.first, grp.second.get()));
+		sort(mSortedPSOGroups.begin(), mSortedPSOGroups.end());
+
+		// The draw keys only have room for the indices of the first groups, the others would wrap around to another group
+		if (mSortedPSOGroups.size() > (1 << DrawList::PSOBits))
+		{
+			LOG(L"Too many PSO groups for the draw keys: " + to_wstring(mSortedPSOGroups.size()), ERROR);
+		}
+		assert(mSortedPSOGroups.size() <= (1 << DrawList::PSOBits));
+	}
+
+	// Collect the visible render items with their draw keys
+	mDrawList.Clear();
+	UINT instanceCount = 0;
+	for (UINT groupIndex = 0; groupIndex < (UINT)mSortedPSOGroups.size(); ++groupIndex)
+	{
+		PSOGroup *group = mSortedPSOGroups[groupIndex].second;
+		if (!group->mVisible) continue;
+
+		// For each visible render item...
+		mInstanceBatcher.Begin();
+		for (UINT i : group->mVisibleRItems)
+		{
+			RenderItemHandle handle = group->mRItems[i];
+			RenderItem &ri = mRenderScene.Get(handle);
+
+			// Pick the level of detail by the size of its error on the screen
+			XMFLOAT3 lodPosition;
+			float lodScale;
+			if (ri.mLODs && mRenderScene.GetLODReference(mApp, handle, &lodPosition, &lodScale))
+			{
+				float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&lodPosition) - cameraPosition));
+				const SubmeshLOD &lod = (*ri.mLODs)[MeshSimplifier::SelectLOD(*ri.mLODs, distance, lodScale, pixelsPerUnit, mMaxLODPixelError)];
+				ri.mIndexCount = lod.IndexCount;
+				ri.mStartIndexLocation = lod.StartIndexLocation;
+			}
+
+			// The static items of the instance batches are drawn later
+			if (mInstancingEnabled && handle.Kind == RenderItemKind::Static && mInstanceBatcher.Add(handle.Index))
+				continue;
+
+			// Front to back within the same state, the items without bounds go first
+			BoundingBox bounds;
+			float depth = 0.0f;
+			if (group->mCuller.GetBounds(i, &bounds))
+				depth = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - cameraPosition)) / camera.GetFarZ();
+			UINT materialIndex = (handle.Kind == RenderItemKind::Specks) ? 0 : static_cast<TexturedRenderItem &>(ri).mMat->MatCBIndex;
+			mDrawList.Add(DrawList::MakeKey(groupIndex, materialIndex, ri.mGeoId, depth), handle);
+		}
+		mInstanceBatcher.End();
+
+		// The batches with too few visible items are drawn one by one
+		for (UINT item : mInstanceBatcher.GetSingles())
+		{
+			RenderItemHandle handle;
+			handle.Kind = RenderItemKind::Static;
+			handle.Index = item;
+			const StaticRenderItem &ri = mRenderScene.GetStatic(handle);
+			BoundingBox bounds;
+			float depth = 0.0f;
+			if (ri.GetWorldBounds(mApp, &bounds))
+				depth = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - cameraPosition)) / camera.GetFarZ();
+			mDrawList.Add(DrawList::MakeKey(groupIndex, ri.mMat->MatCBIndex, ri.mGeoId, depth), handle);
+		}
+
+		// The others are drawn instanced, at the finest level of detail picked for their items
+		const vector<UINT> &instances = mInstanceBatcher.GetInstances();
+		for (const InstanceRange &range : mInstanceBatcher.GetRanges())
+		{
+			RenderItemHandle batchHandle = mInstanceBatchItems[range.Batch];
+			StaticInstancesRenderItem &batchItem = mRenderScene.GetStaticInstances(batchHandle);
+			batchItem.mFirstInstance = instanceCount + range.FirstInstance;
+			batchItem.mInstanceCount = range.InstanceCount;
+			batchItem.mIndexCount = 0;
+			for (UINT k = range.FirstInstance; k < range.FirstInstance + range.InstanceCount; ++k)
+			{
+				RenderItemHandle handle;
+				handle.Kind = RenderItemKind::Static;
+				handle.Index = instances[k];
+				const StaticRenderItem &ri = mRenderScene.GetStatic(handle);
+				if (ri.mIndexCount > batchItem.mIndexCount)
+				{
+					batchItem.mIndexCount = ri.mIndexCount;
+					batchItem.mStartIndexLocation = ri.mStartIndexLocation;
+				}
+				sApp->mCurrFrameResource->StaticInstanceIndexBuffer->CopyData(instanceCount + k, ri.mRenderItemBufferIndex);
+			}
+			batchItem.UpdateConstants(sApp->mCurrFrameResource);
+			mDrawList.Add(DrawList::MakeKey(groupIndex, batchItem.mMat->MatCBIndex, batchItem.mGeoId, 0.0f), batchHandle);
+		}
+		instanceCount += (UINT)instances.size();
+	}
+	mDrawList.Sort();
+	PROFILE_ZONE("SpeckWorld::RecordDraws");
+
+	// Record the draws, the state shared with the previous item is not bound again
+	D3D12DrawCommandList drawCommandList(dxCore.GetCommandList());
+	RenderStateCache state(&drawCommandList);
+
 	// Bind all the rigid bodies from the specks handler.
 	auto rigidBodyBuffer = mSpecksHandler->GetRigidBodyBufferResource();
-	dxCore.GetCommandList()->SetGraphicsRootShaderResourceView((UINT)SpeckApp::MainPassRootParameter::RigidBodyRootDescriptor, rigidBodyBuffer->GetGPUVirtualAddress());
+	state.SetGraphicsRootShaderResourceView((UINT)SpeckApp::MainPassRootParameter::RigidBodyRootDescriptor, rigidBodyBuffer->GetGPUVirtualAddress());
+
+	// Bind the transforms of the static items and the ones drawn instanced.
+	auto staticInstanceBuffer = sApp->mCurrFrameResource->StaticInstanceBuffer->Resource();
+	state.SetGraphicsRootShaderResourceView((UINT)SpeckApp::MainPassRootParameter::StaticInstancesRootDescriptor, staticInstanceBuffer->GetGPUVirtualAddress());
+	auto staticInstanceIndexBuffer = sApp->mCurrFrameResource->StaticInstanceIndexBuffer->Resource();
+	state.SetGraphicsRootShaderResourceView((UINT)SpeckApp::MainPassRootParameter::StaticInstanceIndicesRootDescriptor, staticInstanceIndexBuffer->GetGPUVirtualAddress());
 
-	// For all PSO groups
+	for (size_t i = 0; i < mDrawList.GetCount(); ++i)
+	{
+		PSOGroup *group = mSortedPSOGroups[DrawList::GetPSOIndex(mDrawList.GetKey(i))].second;
+		state.SetPipelineState(group->mPSO.Get());
+		mRenderScene.Render(mApp, state, sApp->mCurrFrameResource, mDrawList.GetItem(i), transformedFrustum);
+	}
+}
+
+void SpeckWorld::CullOccluded(FXMMATRIX viewProj, FXMVECTOR cameraPosition)
+{
+	PROFILE_ZONE("SpeckWorld::CullOccluded");
+	// Visible items that can occlude, by their size on the screen
+	mOccluderCandidates.clear();
 	for (auto &grp : mPSOGroups)
 	{
 		if (!grp.second->mVisible) continue;
 
-		dxCore.GetCommandList()->SetPipelineState(grp.second->mPSO.Get());
+		for (UINT i : grp.second->mVisibleRItems)
+		{
+			BoundingBox bounds;
+			XMFLOAT4X4 world;
+			RenderItemHandle handle = grp.second->mRItems[i];
+			if (!grp.second->mCuller.GetBounds(i, &bounds) || !mRenderScene.GetOccluderWorld(mApp, handle, &world))
+				continue;
+			float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+			float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - cameraPosition));
+			float size = radius / max(distance, 1e-3f);
+			if (size >= OcclusionCuller::MinOccluderSize)
+				mOccluderCandidates.push_back(make_pair(size, handle));
+		}
+	}
+	if (mOccluderCandidates.empty())
+		return;
 
-		// For each render item...
-		for (size_t i = 0; i < grp.second->mRItems.size(); ++i)
+	// Rasterize the biggest ones
+	size_t occluderCount = min(mOccluderCandidates.size(), (size_t)OcclusionCuller::MaxOccluders);
+	partial_sort(mOccluderCandidates.begin(), mOccluderCandidates.begin() + occluderCount, mOccluderCandidates.end(),
+		[](const pair<float, RenderItemHandle> &a, const pair<float, RenderItemHandle> &b) { return a.first > b.first; });
+	XMFLOAT4X4 viewProjF;
+	XMStoreFloat4x4(&viewProjF, viewProj);
+	mOcclusionCuller.Begin(viewProjF);
+	for (size_t i = 0; i < occluderCount; ++i)
+	{
+		RenderItemHandle handle = mOccluderCandidates[i].second;
+		const RenderItem &ri = mRenderScene.Get(handle);
+		XMFLOAT4X4 world;
+		mRenderScene.GetOccluderWorld(mApp, handle, &world);
+		IndexRange range = ri.GetFullLODRange();
+		bool indices32 = ri.mGeo->IndexFormat == DXGI_FORMAT_R32_UINT;
+		const char *indices = (const char *)ri.mGeo->IndexBufferCPU->GetBufferPointer() + range.StartIndexLocation * (indices32 ? 4 : 2);
+		const char *vertices = (const char *)ri.mGeo->VertexBufferCPU->GetBufferPointer() + ri.mBaseVertexLocation * ri.mGeo->VertexByteStride;
+		mOcclusionCuller.RasterizeOccluder((const float *)vertices, ri.mGeo->VertexByteStride, indices, indices32, range.IndexCount, world);
+	}
+	mOcclusionCuller.End();
+
+	// Test the bounds of the visible items, the occluders are never hidden by themselves
+	for (auto &grp : mPSOGroups)
+	{
+		if (!grp.second->mVisible) continue;
+
+		vector<UINT> &visibleRItems = grp.second->mVisibleRItems;
+		size_t kept = 0;
+		for (UINT i : visibleRItems)
 		{
-			auto ri = grp.second->mRItems[i].get();
-			ri->Render(mApp, sApp->mCurrFrameResource, transformedFrustum);
+			BoundingBox bounds;
+			if (!grp.second->mCuller.GetBounds(i, &bounds) || !mOcclusionCuller.IsOccluded(bounds))
+				visibleRItems[kept++] = i;
 		}
+		visibleRItems.resize(kept);
 	}
 }
 
+void SpeckWorld::AssignInstanceBatch(RenderItemHandle handle, PSOGroup *group)
+{
+	const StaticRenderItem &ri = mRenderScene.GetStatic(handle);
+	InstanceBatchKey key;
+	key.Group = group;
+	key.Geometry = ri.mGeo;
+	key.Material = ri.mMat;
+	key.StartIndexLocation = ri.GetFullLODRange().StartIndexLocation;
+	key.BaseVertexLocation = ri.mBaseVertexLocation;
+	bool isNewBatch;
+	mInstanceBatcher.Assign(handle.Index, key, &isNewBatch);
+	if (!isNewBatch)
+		return;
+
+	// Each batch is drawn by its own render item, with the parameters of its first item
+	StaticInstancesRenderItem batchItem;
+	static_cast<TexturedRenderItem &>(batchItem) = ri;
+	batchItem.mMeshlets = nullptr;
+	batchItem.mNumFramesDirty = 0;
+	batchItem.mRenderItemBufferIndex = GetRenderItemFreeSpace();
+	mInstanceBatchItems.push_back(mRenderScene.Add(batchItem));
+}
+
 UINT SpeckWorld::GetRenderItemFreeSpace()
 {
 	UINT ret = mFreeSpacesRenderItemBuffer.back();
@@ -6,13 +6,16 @@
 #include "World.h"
 #include "FrameResource.h"
 #include "PhysicsDataStructs.h"
+#include "OcclusionCuller.h"
+#include "RenderScene.h"
+#include "DrawList.h"
+#include "InstanceBatcher.h"
 
 namespace Speck
 {
 	struct PSOGroup;
 	struct FrameResource;
 	struct PassConstants;
-	struct SpecksRenderItem;
 	class CubeRenderTarget;
 	class SpecksHandler;
 
@@ -43,16 +46,25 @@ namespace Speck
 		virtual void PreDrawUpdate() override;
 		virtual void Draw(UINT stage) override;
 
-		SpecksRenderItem *GetSpeckInstancesRenderItem() { return mSpeckInstancesRenderItem; }
+		SpecksRenderItem *GetSpeckInstancesRenderItem() { return &mRenderScene.GetSpecks(mSpeckInstancesRenderItem); }
 		UINT GetMaxRenderItemsCount() const { return mMaxRenderItemsCount; }
 		SpecksHandler *GetSpecksHandler() { return mSpecksHandler.get(); }
 
 	private:
 		void Draw_Scene();				// used to draw scene normally
+		void UpdateCullingBounds(PSOGroup *group);
+		// Removes the visible render items that are hidden behind the biggest static ones.
+		void CullOccluded(DirectX::FXMMATRIX viewProj, DirectX::FXMVECTOR cameraPosition);
 		UINT GetRenderItemFreeSpace();
+		// Puts the static item into the instance batch of its group, geometry and material. Call it again
+		// after any of them changed.
+		void AssignInstanceBatch(RenderItemHandle handle, PSOGroup *group);
+		// Reports the containers of the specks, the bodies and the colliders to the memory tracker.
+		void UpdateMemory();
 
 	public:
 		// Rendering
+		RenderScene mRenderScene;
 		std::unordered_map<std::string, std::unique_ptr<PSOGroup>> mPSOGroups;
 		std::unordered_map<std::string, std::unique_ptr<CubeRenderTarget>> mCubeRenderTarget;
 
@@ -72,14 +84,29 @@ namespace Speck
 		std::vector<ExternalForces> mExternalForces;
 
 	private:
-		SpecksRenderItem *mSpeckInstancesRenderItem;
+		RenderItemHandle mSpeckInstancesRenderItem;
 		// Maximal number of render items to exist concurrently on the scene.
 		const UINT mMaxRenderItemsCount;
 		// Stack representing available free spaces in the render item buffer.
 		std::vector<UINT> mFreeSpacesRenderItemBuffer;
 
 		bool mFrustumCullingEnabled = true;
+		bool mOcclusionCullingEnabled = true;
+		bool mInstancingEnabled = true;
+		// Largest error of the level of detail on the screen, in pixels.
+		float mMaxLODPixelError = 1.0f;
+		OcclusionCuller mOcclusionCuller;
+		// Render items that can hide the others, with their sizes on the screen.
+		std::vector<std::pair<float, RenderItemHandle>> mOccluderCandidates;
+		// PSO groups sorted by their names, their indices are a part of the draw keys.
+		std::vector<std::pair<std::string, PSOGroup *>> mSortedPSOGroups;
+		// Visible render items sorted by their state.
+		DrawList mDrawList;
+		// Static items that share the state, drawn by the render items of their batches.
+		InstanceBatcher mInstanceBatcher;
+		std::vector<RenderItemHandle> mInstanceBatchItems;
 		PassConstants mMainPassCB;
+		MemoryAllocation mMemory{ MemoryTag::World };
 	};
 }
 
@@ -6,6 +6,8 @@
 #include "SpeckWorld.h"
 #include "Resources.h"
 #include "Timer.h"
+#include "Profiler.h"
+#include "SolverStats.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -20,7 +22,7 @@ float SpecksHandler::mSpeckRadius;
 float SpecksHandler::mCellSize;
 
 // Number of 32-bit values in the constant buffer
-const int gNumConstVals = 12;
+const int gNumConstVals = 13;
 
 namespace GPU
 {
@@ -184,7 +186,10 @@ SpecksHandler::SpecksHandler(EngineCore &ec, World &world, std::vector<std::uniq
 	mSubstepsIterations(substepsIterations),
 	mOmega(1.5f), // (1 < omega < 2) is proposed in nvidiaFlex2014
 	mDeltaTime(1.0f / 60.0f),
-	mTimeMultiplier(1.0f)
+	mTimeMultiplier(1.0f),
+	mSolverStatsEnabled(false),
+	mSolverStatsFrame(0),
+	mUsedMemory(MemoryTag::Specks)
 {
 	// Extend this for special case when there are too few specks which in 
 	// result makes the finding of neighbour cell IDs unstable (repetitive IDs)
@@ -266,7 +271,7 @@ void SpecksHandler::BuildStaticMembers(ID3D12Device *device, ID3D12GraphicsComma
 	}
 
 	// Root parameter can be a table, root descriptor or root constants.
-	const int rootParametersNum = 15;
+	const int rootParametersNum = 16;
 	CD3DX12_ROOT_PARAMETER slotRootParameter[rootParametersNum];
 
 	// Perfomance TIP: Order from most frequent to least frequent.
@@ -285,6 +290,7 @@ void SpecksHandler::BuildStaticMembers(ID3D12Device *device, ID3D12GraphicsComma
 	slotRootParameter[12].InitAsUnorderedAccessView(4, 0);			// for collision spaces
 	slotRootParameter[13].InitAsUnorderedAccessView(5, 0);			// for rigid bodies
 	slotRootParameter[14].InitAsUnorderedAccessView(6, 0);			// for speck rigid body links cache
+	slotRootParameter[15].InitAsUnorderedAccessView(7, 0);			// for solver stats
 
 	// A root signature is an array of root parameters.
 	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(rootParametersNum, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
@@ -352,7 +358,7 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 	UINT byteSize = (UINT)data1.size() * sizeof(GPU::SpeckData);
 	D3D12_RESOURCE_DESC rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 	rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-	mSpecksBuffer.first = CreateDefaultBuffer(device, cmdList, &data1[0], byteSize, rd, mSpecksBuffer.second);
+	mSpecksBuffer.first = CreateDefaultBuffer(device, cmdList, &data1[0], byteSize, rd, mSpecksBuffer.second, MemoryTag::Specks, false);
 	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mSpecksBuffer.first.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
 	// Cells buffer (hash table)
@@ -361,7 +367,7 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 	rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 	rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 	// Create both buffers in swap buffer
-	mGridCellsBuffer.first = CreateDefaultBuffer(device, cmdList, &data2[0], byteSize, rd, mGridCellsBuffer.second);
+	mGridCellsBuffer.first = CreateDefaultBuffer(device, cmdList, &data2[0], byteSize, rd, mGridCellsBuffer.second, MemoryTag::Specks);
 	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mGridCellsBuffer.first.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
 	// Constraints buffer
@@ -370,7 +376,7 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 	rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 	rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 	// Create both buffers in swap buffer
-	mContactConstraintsBuffer.first = CreateDefaultBuffer(device, cmdList, &data3[0], byteSize, rd, mContactConstraintsBuffer.second);
+	mContactConstraintsBuffer.first = CreateDefaultBuffer(device, cmdList, &data3[0], byteSize, rd, mContactConstraintsBuffer.second, MemoryTag::Specks, false);
 	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mContactConstraintsBuffer.first.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
 	// Speck collision spaces buffer
@@ -379,7 +385,7 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 	rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 	rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 	// Create both buffers in swap buffer
-	mSpeckCollisionSpacesBuffer.first = CreateDefaultBuffer(device, cmdList, &data4[0], byteSize, rd, mSpeckCollisionSpacesBuffer.second);
+	mSpeckCollisionSpacesBuffer.first = CreateDefaultBuffer(device, cmdList, &data4[0], byteSize, rd, mSpeckCollisionSpacesBuffer.second, MemoryTag::Specks, false);
 	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mSpeckCollisionSpacesBuffer.first.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
 	// Rigid bodies data
@@ -397,7 +403,7 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 	rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 	rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 	// Create both buffers in swap buffer
-	mRigidBodiesBuffer.first = CreateDefaultBuffer(device, cmdList, &data5[0], byteSize, rd, mRigidBodiesBuffer.second);
+	mRigidBodiesBuffer.first = CreateDefaultBuffer(device, cmdList, &data5[0], byteSize, rd, mRigidBodiesBuffer.second, MemoryTag::Specks, false);
 	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mRigidBodiesBuffer.first.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
 	// Speck rigid body links cache data
@@ -406,26 +412,34 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 	rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 	rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 	// Create both buffers in swap buffer
-	mSpeckRigidBodyLinkCacheBuffer.first = CreateDefaultBuffer(device, cmdList, &data6[0], byteSize, rd, mSpeckRigidBodyLinkCacheBuffer.second);
+	mSpeckRigidBodyLinkCacheBuffer.first = CreateDefaultBuffer(device, cmdList, &data6[0], byteSize, rd, mSpeckRigidBodyLinkCacheBuffer.second, MemoryTag::Specks, false);
 	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mSpeckRigidBodyLinkCacheBuffer.first.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 
+	// Solver stats
+	SolverStatsData data7 = {};
+	byteSize = sizeof(SolverStatsData);
+	rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+	rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+	mSolverStatsBuffer.first = CreateDefaultBuffer(device, cmdList, &data7, byteSize, rd, mSolverStatsBuffer.second, MemoryTag::Specks);
+	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(mSolverStatsBuffer.first.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
 	// These buffers needs to be built for each frame resource.
 	for (int i = 0; i < NUM_FRAME_RESOURCES; ++i)
 	{
 		// Create specks buffer
-		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::SpeckUploadData>>(device, MAX_SPECKS, false));
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::SpeckUploadData>>(device, MAX_SPECKS, false, MemoryTag::Specks, false));
 		// Create static colliders buffers
-		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::StaticColliderData>>(device, MAX_STATIC_COLLIDERS, false));
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::StaticColliderData>>(device, MAX_STATIC_COLLIDERS, false, MemoryTag::Specks, false));
 		// Create static collider faces buffers
-		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::StaticColliderElementData>>(device, MAX_STATIC_COLLIDERS, false));
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::StaticColliderElementData>>(device, MAX_STATIC_COLLIDERS, false, MemoryTag::Specks, false));
 		// Create static collider edge buffers
-		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::StaticColliderElementData>>(device, MAX_STATIC_COLLIDERS, false));
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::StaticColliderElementData>>(device, MAX_STATIC_COLLIDERS, false, MemoryTag::Specks, false));
 		// Create external forces buffers
-		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::ExternalForceData>>(device, MAX_EXTERNAL_FORCES, false));
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::ExternalForceData>>(device, MAX_EXTERNAL_FORCES, false, MemoryTag::Specks, false));
 		// Create speck rigid body link buffers
-		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::SpeckRigidBodyLink>>(device, MAX_SPECK_RIGID_BODY_LINKS, false));
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::SpeckRigidBodyLink>>(device, MAX_SPECK_RIGID_BODY_LINKS, false, MemoryTag::Specks, false));
 		// Create rigid body uploader structures
-		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::RigidBodyUploadData>>(device, MAX_RIGID_BODIES, false));
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<GPU::RigidBodyUploadData>>(device, MAX_RIGID_BODIES, false, MemoryTag::Specks, false));
 		
 		// Create buffer for specks rendering.
 		ResourcePair buffer;
@@ -433,7 +447,7 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 		UINT byteSize = (UINT)data.size() * sizeof(SpeckInstanceData);
 		D3D12_RESOURCE_DESC rd = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
 		rd.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-		buffer.first = CreateDefaultBuffer(device, cmdList, &data[0], byteSize, rd, buffer.second);
+		buffer.first = CreateDefaultBuffer(device, cmdList, &data[0], byteSize, rd, buffer.second, MemoryTag::Specks, false);
 		(*frameResources)[i]->Buffers.push_back(buffer);
 	}
 	mSpecks.mBufferIndex				= (UINT)((*frameResources)[0]->UploadBuffers.size() - 7);
@@ -445,8 +459,31 @@ void SpecksHandler::BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *fr
 	mRigidBodyUploader.mBufferIndex		= (UINT)((*frameResources)[0]->UploadBuffers.size() - 1);
 
 	mSpecksRender.mBufferIndex = (UINT)((*frameResources)[0]->Buffers.size() - 1);
+
+	// The solver stats are reset from and read back to these buffers, they are also needed for each frame resource.
+	for (int i = 0; i < NUM_FRAME_RESOURCES; ++i)
+	{
+		(*frameResources)[i]->UploadBuffers.push_back(make_unique<UploadBuffer<SolverStatsData>>(device, 1, false, MemoryTag::Specks));
+
+		ResourcePair buffer;
+		THROW_IF_FAILED(device->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+			D3D12_HEAP_FLAG_NONE,
+			&CD3DX12_RESOURCE_DESC::Buffer(sizeof(SolverStatsData)),
+			D3D12_RESOURCE_STATE_COPY_DEST,
+			nullptr,
+			IID_PPV_ARGS(buffer.first.GetAddressOf())));
+		MemoryTracker::TrackResource(buffer.first.Get(), MemoryTag::Specks);
+		(*frameResources)[i]->Buffers.push_back(buffer);
+	}
+	mSolverStats.mUploadBufferIndex = (UINT)((*frameResources)[0]->UploadBuffers.size() - 1);
+	mSolverStats.mReadbackBufferIndex = (UINT)((*frameResources)[0]->Buffers.size() - 1);
 }
 
+// Names of the compute shader phases in the profiler.
+static const char *gPhaseZoneNames[] = { "SpecksPhase0", "SpecksPhase1", "SpecksPhase2", "SpecksPhase3_0", "SpecksPhase3_1", "SpecksPhase4",
+	"SpecksPhase5_0", "SpecksPhase5_1", "SpecksPhase5_2", "SpecksPhase5_3", "SpecksPhase6", "SpecksPhaseFinal" };
+
 void SpecksHandler::UpdateCSPhases()
 {
 	auto speckWorld = static_cast<SpeckWorld *>(&GetWorld());
@@ -584,9 +621,11 @@ void SpecksHandler::UpdateCSPhases()
 
 void SpecksHandler::UpdateCPU(FrameResource *currentFrameResource)
 {
+	PROFILE_ZONE("SpecksHandler::UpdateCPU");
 	auto world = static_cast<SpeckWorld *>(&GetWorld());
 	mPreviousFrameResource = mCurrentFrameResource;
 	mCurrentFrameResource = currentFrameResource;
+	ReadSolverStats(currentFrameResource);
 
 	// Update specks.
 	if (mSpecks.mNumFramesDirty > 0)
@@ -728,6 +767,19 @@ void SpecksHandler::UpdateCPU(FrameResource *currentFrameResource)
 			}
 		}
 	}
+
+	UpdateUsedMemory();
+}
+
+void SpecksHandler::UpdateUsedMemory()
+{
+	// The parts of the buffers sized by the caps that hold the specks, the links and the rigid bodies
+	auto world = static_cast<SpeckWorld *>(&GetWorld());
+	UINT64 speckSize = sizeof(GPU::SpeckData) + sizeof(GPU::SpeckConstraints) + sizeof(GPU::SpeckCollisionSpace) + sizeof(GPU::SpeckRigidBodyLinkCache) +
+		NUM_FRAME_RESOURCES * (sizeof(GPU::SpeckUploadData) + sizeof(SpeckInstanceData));
+	UINT64 linkSize = NUM_FRAME_RESOURCES * sizeof(GPU::SpeckRigidBodyLink);
+	UINT64 rigidBodySize = sizeof(GPU::RigidBodyData) + NUM_FRAME_RESOURCES * sizeof(GPU::RigidBodyUploadData);
+	mUsedMemory.Set(0, mParticleNum * speckSize + mSpeckRigidBodyLinksNum * linkSize + world->mSpeckRigidBodyData.size() * rigidBodySize);
 }
 
 void SpecksHandler::UpdateGPU()
@@ -739,14 +791,44 @@ void SpecksHandler::UpdateGPU()
 	//deltaTime = 0.001f;
 	deltaTime /= mSubstepsIterations;
 
+	auto cmdList = GetEngineCore().GetDirectXCore().GetCommandList();
+	ID3D12Resource *statsBuffer = mSolverStatsBuffer.first.Get();
+	bool collectSolverStats = mSolverStatsEnabled && mParticleNum > 0;
+	if (collectSolverStats)
+	{
+		// Reset the counters, the header is read back with them.
+		auto statsUploadBuffer = static_cast<UploadBuffer<SolverStatsData> *>(mCurrentFrameResource->UploadBuffers[mSolverStats.mUploadBufferIndex].get());
+		SolverStatsData header = {};
+		header.frame = mSolverStatsFrame++;
+		header.specks = mParticleNum;
+		header.substeps = mSubstepsIterations;
+		header.solverIterations = mSolverIterations;
+		statsUploadBuffer->CopyData(0, header);
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(statsBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST));
+		cmdList->CopyBufferRegion(statsBuffer, 0, statsUploadBuffer->Resource(), 0, sizeof(SolverStatsData));
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(statsBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	}
+
 	for (UINT i = 0; i < mSubstepsIterations; i++)
 	{
-		UpdateGPU_substep(deltaTime);
+		UpdateGPU_substep(deltaTime, collectSolverStats);
+	}
+
+	if (collectSolverStats)
+	{
+		// It is read when this frame resource is used again, the device is done with it then.
+		ID3D12Resource *statsReadbackBuffer = mCurrentFrameResource->Buffers[mSolverStats.mReadbackBufferIndex].first.Get();
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(statsBuffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
+		cmdList->CopyBufferRegion(statsReadbackBuffer, 0, statsBuffer, 0, sizeof(SolverStatsData));
+		cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(statsBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+		if (find(mSolverStatsPending.begin(), mSolverStatsPending.end(), mCurrentFrameResource) == mSolverStatsPending.end())
+			mSolverStatsPending.push_back(mCurrentFrameResource);
 	}
 }
 
-void SpecksHandler::UpdateGPU_substep(float deltaTime)
+void SpecksHandler::UpdateGPU_substep(float deltaTime, bool collectSolverStats)
 {
+	PROFILE_ZONE("SpecksHandler::UpdateGPU_substep");
 	GraphicsDebuggerAnnotator gda(GetEngineCore().GetDirectXCore(), "SpecksHandlerUpdateGPU");
 	UpdateCSPhases();
 	auto device = GetEngineCore().GetDirectXCore().GetDevice();
@@ -784,6 +866,8 @@ void SpecksHandler::UpdateGPU_substep(float deltaTime)
 	memcpy(&val[10 * 4], &phaseIteration, sizeof(UINT));
 	UINT numPhaseIterations = 1;
 	memcpy(&val[11 * 4], &numPhaseIterations, sizeof(UINT));
+	UINT collectStats = collectSolverStats ? 1 : 0;
+	memcpy(&val[12 * 4], &collectStats, sizeof(UINT));
 	cmdList->SetComputeRoot32BitConstants(0, gNumConstVals, reinterpret_cast<void*>(&val), 0);
 
 	// Bind the input and output buffers.
@@ -801,6 +885,7 @@ void SpecksHandler::UpdateGPU_substep(float deltaTime)
 	cmdList->SetComputeRootUnorderedAccessView(12, mSpeckCollisionSpacesBuffer.first.Get()->GetGPUVirtualAddress());
 	cmdList->SetComputeRootUnorderedAccessView(13, mRigidBodiesBuffer.first.Get()->GetGPUVirtualAddress());
 	cmdList->SetComputeRootUnorderedAccessView(14, mSpeckRigidBodyLinkCacheBuffer.first.Get()->GetGPUVirtualAddress());
+	cmdList->SetComputeRootUnorderedAccessView(15, mSolverStatsBuffer.first.Get()->GetGPUVirtualAddress());
 
 	cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(writeToResource, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
 	for (UINT i = 0; i < mCS_phasesCount; i++)
@@ -808,6 +893,8 @@ void SpecksHandler::UpdateGPU_substep(float deltaTime)
 		if (phasesCSTG[i].GetTotalCount() == 0)
 			continue;
 
+		PROFILE_ZONE(gPhaseZoneNames[i]);
+
 #if defined(_DEBUG) || defined(DEBUG)
 		GraphicsDebuggerAnnotator gda(GetEngineCore().GetDirectXCore(), phasesCSTG[i].mName);
 #endif
@@ -843,6 +930,28 @@ void SpecksHandler::UpdateGPU_substep(float deltaTime)
 	mSpecksRender.mInitializeSpecksStartIndex = INT_MAX;
 }
 
+void SpecksHandler::ReadSolverStats(FrameResource *frameResource)
+{
+	auto pending = find(mSolverStatsPending.begin(), mSolverStatsPending.end(), frameResource);
+	if (pending == mSolverStatsPending.end())
+		return;
+	mSolverStatsPending.erase(pending);
+
+	// The device is done with the frame resource, so the copy to its readback buffer has finished.
+	ID3D12Resource *statsReadbackBuffer = frameResource->Buffers[mSolverStats.mReadbackBufferIndex].first.Get();
+	SolverStatsData *mappedData = nullptr;
+	CD3DX12_RANGE readRange(0, sizeof(SolverStatsData));
+	THROW_IF_FAILED(statsReadbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mappedData)));
+	SolverStatsData data = *mappedData;
+	CD3DX12_RANGE writtenRange(0, 0);
+	statsReadbackBuffer->Unmap(0, &writtenRange);
+
+	SolverStats stats = DecodeSolverStats(data, mSpeckRadius);
+	if (mSolverStatsHistory.size() >= mSolverStatsHistorySize)
+		mSolverStatsHistory.pop_front();
+	mSolverStatsHistory.push_back(stats);
+}
+
 void SpecksHandler::InvalidateSpecksRenderBuffers(UINT startIndex)
 {
 	if (startIndex < mSpecksRender.mInitializeSpecksStartIndex)
@@ -6,6 +6,8 @@
 #include "DirectXHeaders.h"
 #include "EngineUser.h"
 #include "WorldUser.h"
+#include "PhysicsDataStructs.h"
+#include <deque>
 
 namespace Speck
 {
@@ -50,6 +52,13 @@ namespace Speck
 		UINT GetSubstepsIterations() const { return mSubstepsIterations; }
 		void SetSubstepsIterations(UINT substepsIterations) { mSubstepsIterations = substepsIterations; }
 
+		// The phases count the dropped and the done work only while this is enabled, it costs some atomics.
+		bool GetSolverStatsEnabled() const { return mSolverStatsEnabled; }
+		void SetSolverStatsEnabled(bool enabled) { mSolverStatsEnabled = enabled; }
+		// Stats of the last frames, the oldest first. They are read back NUM_FRAME_RESOURCES frames late.
+		const std::deque<SolverStats> &GetSolverStatsHistory() const { return mSolverStatsHistory; }
+		void ClearSolverStatsHistory() { mSolverStatsHistory.clear(); }
+
 		static float GetSpeckRadius() { return mSpeckRadius; }
 		static void SetSpeckRadius(float speckRadius);
 		static void BuildStaticMembers(ID3D12Device *device, ID3D12GraphicsCommandList *cmdList);
@@ -58,7 +67,10 @@ namespace Speck
 	private:
 		void BuildBuffers(std::vector<std::unique_ptr<FrameResource>> *frameResources);
 		void UpdateCSPhases();
-		void UpdateGPU_substep(float deltaTime);
+		void UpdateGPU_substep(float deltaTime, bool collectSolverStats);
+		void ReadSolverStats(FrameResource *frameResource);
+		// Reports the used part of the buffers to the memory tracker.
+		void UpdateUsedMemory();
 
 	private:
 		FrameResource *mPreviousFrameResource;
@@ -76,6 +88,8 @@ namespace Speck
 		ResourcePair mRigidBodiesBuffer;
 		// List of speck rigid body links cache.
 		ResourcePair mSpeckRigidBodyLinkCacheBuffer;
+		// Counters of the solver, a single element.
+		ResourcePair mSolverStatsBuffer;
 
 		static Microsoft::WRL::ComPtr<ID3D12RootSignature> mRootSignature;
 		static const UINT mCS_phasesCount = 12;
@@ -122,6 +136,15 @@ namespace Speck
 		float mDeltaTime;
 		// Time multipliers will slow down or speed up the physics simulation.
 		float mTimeMultiplier;
+		// Solver stats collection.
+		static const UINT mSolverStatsHistorySize = 256;
+		bool mSolverStatsEnabled;
+		UINT mSolverStatsFrame;
+		// Frame resources whose readback buffers hold the stats that were not read yet.
+		std::vector<FrameResource *> mSolverStatsPending;
+		std::deque<SolverStats> mSolverStatsHistory;
+		// Most buffers are sized by the caps, they are tracked as unused and this counts the part in use.
+		MemoryAllocation mUsedMemory;
 
 		// Buffers
 		struct BufferStruct
@@ -137,6 +160,13 @@ namespace Speck
 			UINT mInitializeSpecksStartIndex = 0;		// Marks the start index of the part of the array that will be updated.
 		} mSpecksRender;
 
+		// Indices of the solver stats buffers.
+		struct
+		{
+			UINT mUploadBufferIndex;					// Initial values, copied to the stats before the first substep
+			UINT mReadbackBufferIndex;					// The stats are copied here after the last substep
+		} mSolverStats;
+
 		//
 		// Upload buffer indices.
 		//
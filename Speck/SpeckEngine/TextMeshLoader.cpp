@@ -0,0 +1,482 @@
+#include "TextMeshLoader.h"
+#include "MemoryMappedFile.h"
+#include "WorkerPool.h"
+#include "MathHelper.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+// Lines parsed by one task, chunks are extended to the end of the line
+static const size_t CHUNK_BYTE_SIZE = 64 * 1024;
+
+namespace
+{
+	const char Magic[4] = { 'S', 'P', 'K', 'G' };
+	// Change whenever the layout of the file or of the vertex changes
+	const uint32_t Version = 3;
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexSize;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		XMFLOAT3 boundsCenter;
+		XMFLOAT3 boundsExtents;
+		uint32_t lodCount;
+		// Text file the cache was made from
+		uint64_t sourceSize;
+		uint64_t sourceWriteTime;
+	};
+
+	// Follows the indices of the mesh, one per LOD, then the indices of all the LODs in order
+	struct LODHeader
+	{
+		uint32_t indexCount;
+		float error;
+	};
+
+	// Range of whole lines and the index of its first line
+	struct Chunk
+	{
+		const char *begin;
+		const char *end;
+		UINT firstLine;
+		UINT lineCount;
+	};
+}
+
+// Runs the function over [0, count) on the worker pool if there is one.
+static void ForEachChunk(WorkerPool *workerPool, UINT count, const function<void(UINT begin, UINT end)> &func)
+{
+	if (workerPool)
+		workerPool->ParallelFor(count, 1, func);
+	else if (count > 0)
+		func(0, count);
+}
+
+static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+static bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static void SkipBlanks(const char *&p, const char *end)
+{
+	while (p < end && IsBlank(*p)) ++p;
+}
+
+// Parses a decimal number (with an optional exponent) and advances the cursor past it.
+// Only the first 19 significant digits are used, which is more than a float can hold.
+static bool ParseFloat(const char *&p, const char *end, float *outValue)
+{
+	static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	SkipBlanks(p, end);
+	const char *c = p;
+	bool negative = false;
+	if (c < end && (*c == '-' || *c == '+'))
+	{
+		negative = (*c == '-');
+		++c;
+	}
+
+	// Mantissa
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int significantDigits = 0;
+	bool hasDigits = false;
+	for (; c < end && IsDigit(*c); ++c)
+	{
+		hasDigits = true;
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*c - '0');
+			if (mantissa != 0) ++significantDigits;
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+	if (c < end && *c == '.')
+	{
+		++c;
+		for (; c < end && IsDigit(*c); ++c)
+		{
+			hasDigits = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*c - '0');
+				if (mantissa != 0) ++significantDigits;
+				--exponent;
+			}
+		}
+	}
+	if (!hasDigits)
+		return false;
+
+	// Exponent
+	if (c < end && (*c == 'e' || *c == 'E'))
+	{
+		const char *e = c + 1;
+		bool negativeExponent = false;
+		if (e < end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = (*e == '-');
+			++e;
+		}
+		if (e < end && IsDigit(*e))
+		{
+			int value = 0;
+			for (; e < end && IsDigit(*e); ++e)
+			{
+				if (value < 10000) value = value * 10 + (*e - '0');
+			}
+			exponent += negativeExponent ? -value : value;
+			c = e;
+		}
+	}
+
+	double value = (double)mantissa;
+	if (value != 0.0)
+	{
+		int absExponent = abs(exponent);
+		double scale = (absExponent <= 22) ? powersOf10[absExponent] : pow(10.0, (double)absExponent);
+		value = (exponent < 0) ? value / scale : value * scale;
+	}
+	*outValue = (float)(negative ? -value : value);
+	p = c;
+	return true;
+}
+
+static bool ParseUInt(const char *&p, const char *end, uint32_t *outValue)
+{
+	SkipBlanks(p, end);
+	const char *c = p;
+	uint64_t value = 0;
+	for (; c < end && IsDigit(*c); ++c)
+	{
+		value = value * 10 + (*c - '0');
+		if (value > UINT32_MAX) return false;
+	}
+	if (c == p)
+		return false;
+	*outValue = (uint32_t)value;
+	p = c;
+	return true;
+}
+
+// Moves the cursor to the beginning of the next line, only blanks are allowed before the line end.
+static bool EndLine(const char *&p, const char *end)
+{
+	SkipBlanks(p, end);
+	if (p >= end || *p != '\n')
+		return false;
+	++p;
+	return true;
+}
+
+static const char *Find(const char *begin, const char *end, const char *token)
+{
+	const char *found = search(begin, end, token, token + strlen(token));
+	return (found != end) ? found : nullptr;
+}
+
+// Finds the "<name> {" block and returns the range of its lines, without the braces.
+static bool FindBlock(const char *begin, const char *end, const char *name, const char **outBegin, const char **outEnd)
+{
+	const char *p = Find(begin, end, name);
+	if (!p) return false;
+	p = find(p, end, '{');
+	if (p == end) return false;
+	p = find(p, end, '\n');
+	if (p == end) return false;
+	*outBegin = p + 1;
+	*outEnd = find(p, end, '}');
+	return *outEnd != end;
+}
+
+static bool FindCount(const char *begin, const char *end, const char *name, uint32_t *outCount)
+{
+	const char *p = Find(begin, end, name);
+	if (!p) return false;
+	p += strlen(name);
+	SkipBlanks(p, end);
+	if (p < end && *p == ':') ++p;
+	return ParseUInt(p, end, outCount);
+}
+
+// Splits the block into chunks of whole lines and counts the lines of every chunk.
+static bool SplitLines(const char *begin, const char *end, UINT expectedLineCount, WorkerPool *workerPool, vector<Chunk> *outChunks)
+{
+	vector<Chunk> &chunks = *outChunks;
+	chunks.clear();
+	const char *p = begin;
+	while (p < end)
+	{
+		const char *chunkEnd = (size_t)(end - p) > CHUNK_BYTE_SIZE ? p + CHUNK_BYTE_SIZE : end;
+		chunkEnd = find(chunkEnd, end, '\n');
+		if (chunkEnd != end) ++chunkEnd;
+		chunks.push_back({ p, chunkEnd, 0, 0 });
+		p = chunkEnd;
+	}
+
+	// Count the lines, every one of them ends with a new line character
+	ForEachChunk(workerPool, (UINT)chunks.size(), [&](UINT chunkBegin, UINT chunkEnd)
+	{
+		for (UINT i = chunkBegin; i < chunkEnd; ++i)
+		{
+			chunks[i].lineCount = (UINT)count(chunks[i].begin, chunks[i].end, '\n');
+		}
+	});
+
+	UINT lineCount = 0;
+	for (Chunk &chunk : chunks)
+	{
+		chunk.firstLine = lineCount;
+		lineCount += chunk.lineCount;
+	}
+	return lineCount == expectedLineCount;
+}
+
+// Any vector perpendicular to the normal, the format has no texture coordinates to align it with.
+static XMVECTOR GetTangent(FXMVECTOR normal)
+{
+	XMVECTOR axis = (fabsf(XMVectorGetY(normal)) < 0.99f) ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+	return XMVector3Normalize(XMVector3Cross(axis, normal));
+}
+
+bool TextMeshLoader::Load(const wchar_t *filePath, WorkerPool *workerPool, GeometryGenerator::StaticMeshData *outMesh, BoundingBox *outBounds,
+	vector<MeshLOD> *outLODs)
+{
+	wstring cacheFilePath(filePath);
+	size_t extensionPos = cacheFilePath.rfind(L'.');
+	if (extensionPos != wstring::npos) cacheFilePath.erase(extensionPos);
+	cacheFilePath += L".speckmesh";
+
+	if (LoadCache(cacheFilePath.c_str(), filePath, outMesh, outBounds, outLODs))
+		return true;
+
+	MemoryMappedFile file;
+	if (!file.Open(filePath))
+		return false;
+
+	if (!Parse(reinterpret_cast<const char *>(file.GetData()), (size_t)file.GetSize(), workerPool, outMesh, outBounds))
+	{
+		LOG(TEXT("Invalid text mesh file: ") + wstring(filePath), ERROR);
+		return false;
+	}
+
+	// The cache keeps the LODs and the optimized mesh, the optimizer reorders the LODs with it
+	MeshSimplifier::BuildLODChain(*outMesh, LODCount, outLODs);
+	MeshOptimizer::Optimize(outMesh, nullptr, outLODs);
+	SaveCache(cacheFilePath.c_str(), filePath, *outMesh, *outBounds, *outLODs);
+	return true;
+}
+
+bool TextMeshLoader::Parse(const char *text, size_t size, WorkerPool *workerPool, GeometryGenerator::StaticMeshData *outMesh, BoundingBox *outBounds)
+{
+	// Header
+	const char *end = text + size;
+	uint32_t vertexCount, triangleCount;
+	const char *verticesBegin, *verticesEnd, *trianglesBegin, *trianglesEnd;
+	if (!FindCount(text, end, "VertexCount", &vertexCount) ||
+		!FindCount(text, end, "TriangleCount", &triangleCount) ||
+		!FindBlock(text, end, "VertexList", &verticesBegin, &verticesEnd) ||
+		!FindBlock(verticesEnd, end, "TriangleList", &trianglesBegin, &trianglesEnd))
+		return false;
+	if ((uint64_t)triangleCount * 3 > UINT32_MAX)
+		return false;
+
+	// Split both of the blocks
+	vector<Chunk> vertexChunks, triangleChunks;
+	if (!SplitLines(verticesBegin, verticesEnd, vertexCount, workerPool, &vertexChunks) ||
+		!SplitLines(trianglesBegin, trianglesEnd, triangleCount, workerPool, &triangleChunks))
+		return false;
+
+	// Parse the chunks of both blocks together
+	GeometryGenerator::StaticMeshData &mesh = *outMesh;
+	mesh.Vertices.resize(vertexCount);
+	mesh.Indices32.resize((size_t)triangleCount * 3);
+	UINT vertexChunkCount = (UINT)vertexChunks.size();
+	UINT chunkCount = vertexChunkCount + (UINT)triangleChunks.size();
+	vector<XMFLOAT3> chunkMin(vertexChunkCount), chunkMax(vertexChunkCount);
+	vector<uint8_t> chunkValid(chunkCount, 1);
+	ForEachChunk(workerPool, chunkCount, [&](UINT chunkBegin, UINT chunkEnd)
+	{
+		for (UINT c = chunkBegin; c < chunkEnd; ++c)
+		{
+			if (c < vertexChunkCount)
+			{
+				// Position and normal per line
+				const Chunk &chunk = vertexChunks[c];
+				const char *p = chunk.begin;
+				XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+				XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+				for (UINT i = 0; i < chunk.lineCount; ++i)
+				{
+					GeometryGenerator::StaticVertex &v = mesh.Vertices[chunk.firstLine + i];
+					if (!ParseFloat(p, chunk.end, &v.Position.x) || !ParseFloat(p, chunk.end, &v.Position.y) || !ParseFloat(p, chunk.end, &v.Position.z) ||
+						!ParseFloat(p, chunk.end, &v.Normal.x) || !ParseFloat(p, chunk.end, &v.Normal.y) || !ParseFloat(p, chunk.end, &v.Normal.z) ||
+						!EndLine(p, chunk.end))
+					{
+						chunkValid[c] = 0;
+						break;
+					}
+					XMVECTOR pos = XMLoadFloat3(&v.Position);
+					vMin = XMVectorMin(vMin, pos);
+					vMax = XMVectorMax(vMax, pos);
+					XMStoreFloat3(&v.TangentU, GetTangent(XMLoadFloat3(&v.Normal)));
+					v.TexC = XMFLOAT2(0.0f, 0.0f);
+				}
+				XMStoreFloat3(&chunkMin[c], vMin);
+				XMStoreFloat3(&chunkMax[c], vMax);
+			}
+			else
+			{
+				// Three indices per line
+				const Chunk &chunk = triangleChunks[c - vertexChunkCount];
+				const char *p = chunk.begin;
+				uint32_t *indices = mesh.Indices32.data() + (size_t)chunk.firstLine * 3;
+				for (UINT i = 0; i < chunk.lineCount * 3; i += 3)
+				{
+					if (!ParseUInt(p, chunk.end, &indices[i]) || !ParseUInt(p, chunk.end, &indices[i + 1]) || !ParseUInt(p, chunk.end, &indices[i + 2]) ||
+						!EndLine(p, chunk.end) ||
+						indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+					{
+						chunkValid[c] = 0;
+						break;
+					}
+				}
+			}
+		}
+	});
+	if (find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end())
+		return false;
+
+	// Bounds
+	XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+	XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+	for (UINT c = 0; c < vertexChunkCount; ++c)
+	{
+		vMin = XMVectorMin(vMin, XMLoadFloat3(&chunkMin[c]));
+		vMax = XMVectorMax(vMax, XMLoadFloat3(&chunkMax[c]));
+	}
+	if (vertexCount == 0)
+	{
+		vMin = vMax = XMVectorZero();
+	}
+	XMStoreFloat3(&outBounds->Center, 0.5f*(vMin + vMax));
+	XMStoreFloat3(&outBounds->Extents, 0.5f*(vMax - vMin));
+	return true;
+}
+
+// Size and last write time of the file, zero if the file does not exist.
+static void GetSourceVersion(const wchar_t *sourceFilePath, uint64_t *outSize, uint64_t *outWriteTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExW(sourceFilePath, GetFileExInfoStandard, &attributes))
+	{
+		*outSize = *outWriteTime = 0;
+		return;
+	}
+	*outSize = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	*outWriteTime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+bool TextMeshLoader::LoadCache(const wchar_t *cacheFilePath, const wchar_t *sourceFilePath, GeometryGenerator::StaticMeshData *outMesh, BoundingBox *outBounds,
+	vector<MeshLOD> *outLODs)
+{
+	MemoryMappedFile file;
+	if (!file.Open(cacheFilePath) || file.GetSize() < sizeof(Header))
+		return false;
+
+	const Header &header = *reinterpret_cast<const Header *>(file.GetData());
+	uint64_t meshSize = sizeof(Header) + (uint64_t)header.vertexCount * sizeof(GeometryGenerator::StaticVertex) + (uint64_t)header.indexCount * sizeof(uint32_t);
+	if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+		header.version != Version ||
+		header.vertexSize != sizeof(GeometryGenerator::StaticVertex) ||
+		header.lodCount >= LODCount ||
+		file.GetSize() < meshSize + header.lodCount * sizeof(LODHeader))
+		return false;
+
+	// Without the text file the cache is used as it is
+	uint64_t sourceSize, sourceWriteTime;
+	GetSourceVersion(sourceFilePath, &sourceSize, &sourceWriteTime);
+	if (sourceWriteTime != 0 && (header.sourceSize != sourceSize || header.sourceWriteTime != sourceWriteTime))
+		return false;
+
+	const uint8_t *data = file.GetData() + sizeof(Header);
+	const GeometryGenerator::StaticVertex *vertices = reinterpret_cast<const GeometryGenerator::StaticVertex *>(data);
+	const uint32_t *indices = reinterpret_cast<const uint32_t *>(data + header.vertexCount * sizeof(GeometryGenerator::StaticVertex));
+	const LODHeader *lodHeaders = reinterpret_cast<const LODHeader *>(indices + header.indexCount);
+	const uint32_t *lodIndices = reinterpret_cast<const uint32_t *>(lodHeaders + header.lodCount);
+	uint64_t lodIndexCount = 0;
+	for (uint32_t l = 0; l < header.lodCount; ++l)
+	{
+		lodIndexCount += lodHeaders[l].indexCount;
+	}
+	if (file.GetSize() != meshSize + header.lodCount * sizeof(LODHeader) + lodIndexCount * sizeof(uint32_t))
+		return false;
+	for (uint32_t i = 0; i < header.indexCount; ++i)
+	{
+		if (indices[i] >= header.vertexCount) return false;
+	}
+	for (uint64_t i = 0; i < lodIndexCount; ++i)
+	{
+		if (lodIndices[i] >= header.vertexCount) return false;
+	}
+
+	outMesh->Vertices.assign(vertices, vertices + header.vertexCount);
+	outMesh->Indices32.assign(indices, indices + header.indexCount);
+	outLODs->resize(header.lodCount);
+	for (uint32_t l = 0; l < header.lodCount; ++l)
+	{
+		(*outLODs)[l].indices.assign(lodIndices, lodIndices + lodHeaders[l].indexCount);
+		(*outLODs)[l].error = lodHeaders[l].error;
+		lodIndices += lodHeaders[l].indexCount;
+	}
+	outBounds->Center = header.boundsCenter;
+	outBounds->Extents = header.boundsExtents;
+	return true;
+}
+
+bool TextMeshLoader::SaveCache(const wchar_t *cacheFilePath, const wchar_t *sourceFilePath, const GeometryGenerator::StaticMeshData &mesh, const BoundingBox &bounds,
+	const vector<MeshLOD> &lods)
+{
+	Header header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.vertexSize = sizeof(GeometryGenerator::StaticVertex);
+	header.vertexCount = (uint32_t)mesh.Vertices.size();
+	header.indexCount = (uint32_t)mesh.Indices32.size();
+	header.boundsCenter = bounds.Center;
+	header.boundsExtents = bounds.Extents;
+	header.lodCount = (uint32_t)lods.size();
+	GetSourceVersion(sourceFilePath, &header.sourceSize, &header.sourceWriteTime);
+
+	ofstream fileStream(cacheFilePath, ios::out | ios::binary | ios::trunc);
+	if (!fileStream.is_open())
+	{
+		LOG(TEXT("Could not write the mesh cache: ") + wstring(cacheFilePath), WARNING);
+		return false;
+	}
+	fileStream.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+	fileStream.write(reinterpret_cast<const char *>(mesh.Vertices.data()), mesh.Vertices.size() * sizeof(GeometryGenerator::StaticVertex));
+	fileStream.write(reinterpret_cast<const char *>(mesh.Indices32.data()), mesh.Indices32.size() * sizeof(uint32_t));
+	for (const MeshLOD &lod : lods)
+	{
+		LODHeader lodHeader = { (uint32_t)lod.indices.size(), lod.error };
+		fileStream.write(reinterpret_cast<const char *>(&lodHeader), sizeof(LODHeader));
+	}
+	for (const MeshLOD &lod : lods)
+	{
+		fileStream.write(reinterpret_cast<const char *>(lod.indices.data()), lod.indices.size() * sizeof(uint32_t));
+	}
+	fileStream.close();
+	return !fileStream.fail();
+}
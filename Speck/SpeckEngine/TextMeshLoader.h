@@ -0,0 +1,43 @@
+#ifndef TEXT_MESH_LOADER_H
+#define TEXT_MESH_LOADER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "GeometryGenerator.h"
+#include "MeshSimplifier.h"
+
+namespace Speck
+{
+	class WorkerPool;
+
+	//-------------------------------------------------------------------------------------
+	//	Loads meshes stored in the text format ("VertexCount", "TriangleCount", then the
+	//	"VertexList" block with a position and a normal per line and the "TriangleList"
+	//	block with three indices per line). The file is memory mapped and parsed in chunks
+	//	of whole lines on the worker threads. The LOD chain is built and the result is
+	//	optimized for the GPU, both are cached in a binary .speckmesh file next to the text
+	//	file, which is used as long as the text file does not change.
+	//-------------------------------------------------------------------------------------
+	class TextMeshLoader
+	{
+	public:
+		// Number of levels of detail of the loaded meshes, including the full mesh.
+		static const UINT LODCount = 4;
+
+		// Tangents are generated from the normals (the format has no texture coordinates). The LODs are the
+		// simplified ones, they index the vertices of the mesh. The worker pool is optional. Returns false if
+		// the file could not be loaded.
+		DLL_EXPORT static bool Load(const wchar_t *filePath, WorkerPool *workerPool, GeometryGenerator::StaticMeshData *outMesh, DirectX::BoundingBox *outBounds,
+			std::vector<MeshLOD> *outLODs);
+
+		// Parses the text file already in memory.
+		DLL_EXPORT static bool Parse(const char *text, size_t size, WorkerPool *workerPool, GeometryGenerator::StaticMeshData *outMesh, DirectX::BoundingBox *outBounds);
+
+	private:
+		static bool LoadCache(const wchar_t *cacheFilePath, const wchar_t *sourceFilePath, GeometryGenerator::StaticMeshData *outMesh, DirectX::BoundingBox *outBounds,
+			std::vector<MeshLOD> *outLODs);
+		static bool SaveCache(const wchar_t *cacheFilePath, const wchar_t *sourceFilePath, const GeometryGenerator::StaticMeshData &mesh, const DirectX::BoundingBox &bounds,
+			const std::vector<MeshLOD> &lods);
+	};
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "TextureStreamer.h"
+#include "GenericShaderStructures.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+TextureStreamer::TextureStreamer()
+	: mBudget(4 * 1024 * 1024)
+{
+
+}
+
+TextureStreamer::~TextureStreamer()
+{
+
+}
+
+void TextureStreamer::Enqueue(Texture *texture, unique_ptr<MemoryMappedFile> file, DDSTextureLayout &&layout)
+{
+	if (texture->ResidentMip == 0)
+		return; // nothing left to stream
+
+	Request request;
+	request.texture = texture;
+	request.file = move(file);
+	request.layout = move(layout);
+	mRequests.push_back(move(request));
+}
+
+void TextureStreamer::Cancel(Texture *texture)
+{
+	mRequests.erase(remove_if(mRequests.begin(), mRequests.end(),
+		[texture](const Request &request) { return request.texture == texture; }), mRequests.end());
+}
+
+void TextureStreamer::Update(ID3D12Device *device, ID3D12GraphicsCommandList *cmdList, UINT64 completedFence, UINT64 frameFence, vector<Texture *> *outUpdated)
+{
+	// Release the upload heaps the GPU is done with
+	while (!mPendingUploads.empty() && mPendingUploads.front().fence <= completedFence)
+		mPendingUploads.pop_front();
+
+	// One mip per texture in turns, so that the small textures do not wait for the big ones
+	UINT64 uploadedSize = 0;
+	size_t requestCount = mRequests.size();
+	for (size_t i = 0; i < requestCount; ++i)
+	{
+		Request &request = mRequests.front();
+		size_t mip = request.texture->ResidentMip - 1;
+		UINT64 mipSize = request.layout.GetMipSize(mip);
+		if (uploadedSize > 0 && uploadedSize + mipSize > mBudget)
+			break;
+
+		PendingUpload upload;
+		THROW_IF_FAILED(UploadDDSTextureMip12(device, cmdList, request.layout, mip, request.texture->Resource.Get(), upload.uploadHeap));
+		MemoryTracker::TrackResource(upload.uploadHeap.Get(), MemoryTag::Textures);
+		upload.texture = request.texture->Resource;
+		upload.fence = frameFence;
+		mPendingUploads.push_back(move(upload));
+		uploadedSize += mipSize;
+
+		request.texture->ResidentMip = (UINT)mip;
+		request.texture->ResidentMemory.Set(0, request.texture->ResidentMemory.GetUsed() + mipSize);
+		outUpdated->push_back(request.texture);
+
+		// Back to the end of the queue if there is more to stream, otherwise the file gets closed
+		Request current = move(request);
+		mRequests.pop_front();
+		if (mip > 0)
+			mRequests.push_back(move(current));
+	}
+}
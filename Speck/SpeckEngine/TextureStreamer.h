@@ -0,0 +1,66 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "SpeckEngineDefinitions.h"
+#include "DirectXHeaders.h"
+#include "MemoryMappedFile.h"
+#include "DDSTextureLayout.h"
+#include <deque>
+
+namespace Speck
+{
+	struct Texture;
+
+	//-------------------------------------------------------------------------------------
+	//	Streams in the more detailed mips of the textures that were created with only their
+	//	smallest mips uploaded. Every frame the textures in the queue get their next mip,
+	//	in turns and for as long as the uploads fit into the per frame budget. The files
+	//	stay memory mapped until all of their mips are uploaded.
+	//-------------------------------------------------------------------------------------
+	class TextureStreamer
+	{
+	public:
+		TextureStreamer();
+		~TextureStreamer();
+		// Make these inaccessible.
+		TextureStreamer(const TextureStreamer &streamer) = delete;
+		TextureStreamer &operator=(const TextureStreamer &streamer) = delete;
+
+		// Maximum number of bytes uploaded per frame (at least one mip is always uploaded).
+		void SetBudget(UINT64 bytesPerFrame) { mBudget = bytesPerFrame; }
+		UINT64 GetBudget() const { return mBudget; }
+		bool IsIdle() const { return mRequests.empty(); }
+
+		// The texture has to be created from the layout with the mips from texture->ResidentMip on uploaded.
+		void Enqueue(Texture *texture, std::unique_ptr<MemoryMappedFile> file, DDSTextureLayout &&layout);
+		// Has to be called before the texture is released or reloaded.
+		void Cancel(Texture *texture);
+
+		// Records the uploads to the command list that will be followed by the signal of frameFence.
+		// Upload heaps of the copies done by completedFence are released. Textures that got a new mip
+		// are added to outUpdated.
+		void Update(ID3D12Device *device, ID3D12GraphicsCommandList *cmdList, UINT64 completedFence, UINT64 frameFence, std::vector<Texture *> *outUpdated);
+
+	private:
+		struct Request
+		{
+			Texture *texture;
+			std::unique_ptr<MemoryMappedFile> file;
+			DDSTextureLayout layout;
+		};
+
+		struct PendingUpload
+		{
+			// The texture is kept alive too, in case it gets released while the copy is in flight.
+			Microsoft::WRL::ComPtr<ID3D12Resource> texture;
+			Microsoft::WRL::ComPtr<ID3D12Resource> uploadHeap;
+			UINT64 fence;
+		};
+
+		std::deque<Request> mRequests;
+		std::deque<PendingUpload> mPendingUploads;
+		UINT64 mBudget;
+	};
+}
+
+#endif
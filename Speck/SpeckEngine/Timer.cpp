@@ -109,9 +109,15 @@ void Timer::Tick()
 		return;
 	}
 
+	// Sleep through most of the time that is left, the loop below only catches up on the rest
+	__int64 currTime;
+	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	double elapsedTime = (currTime - xPrevTime)*xSecondsPerCount;
+	if (elapsedTime < xMinFrameTime)
+		xFramePacer.Wait(xMinFrameTime - elapsedTime);
+
 	do
 	{
-		__int64 currTime;
 		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
 		xCurrTime = currTime;
 
@@ -2,6 +2,7 @@
 #define TIMER_H
 
 #include "SpeckEngineDefinitions.h"
+#include "FramePacer.h"
 
 namespace Speck
 {
@@ -22,6 +23,8 @@ namespace Speck
 		void SetMinFrameTime(double minFrameTime) { xMinFrameTime = minFrameTime; }
 		// In seconds.
 		double GetMinFrameTime() const { return xMinFrameTime; }
+		// Waits for the rest of the frames shorter than the min frame time.
+		FramePacer &GetFramePacer() { return xFramePacer; }
 
 	private:
 		double xSecondsPerCount;
@@ -35,6 +38,8 @@ namespace Speck
 		__int64 xCurrTime;
 
 		bool xStopped;
+
+		FramePacer xFramePacer;
 	};
 }
 
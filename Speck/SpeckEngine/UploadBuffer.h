@@ -25,7 +25,8 @@ namespace Speck
 	class UploadBuffer : public UploadBufferBase
 	{
 	public:
-		UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer)
+		// The buffer is counted to the memory tag while it lives, as used or not.
+		UploadBuffer(ID3D12Device* device, UINT elementCount, bool isConstantBuffer, MemoryTag tag, bool used = true)
 			: UploadBufferBase(),
 			mIsConstantBuffer(isConstantBuffer)
 		{
@@ -48,6 +49,7 @@ namespace Speck
 				D3D12_RESOURCE_STATE_GENERIC_READ,
 				nullptr,
 				IID_PPV_ARGS(&mUploadBuffer)));
+			MemoryTracker::TrackResource(mUploadBuffer.Get(), tag, used);
 
 			THROW_IF_FAILED(mUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&mMappedData)));
 
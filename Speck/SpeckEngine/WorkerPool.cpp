@@ -0,0 +1,113 @@
+#include "WorkerPool.h"
+#include <atomic>
+
+using namespace std;
+using namespace Speck;
+
+WorkerPool::WorkerPool(UINT threadCount)
+	: mStopping(false)
+{
+	if (threadCount == 0)
+	{
+		UINT hardwareThreads = thread::hardware_concurrency();
+		threadCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+	}
+
+	for (UINT i = 0; i < threadCount; ++i)
+	{
+		mThreads.push_back(thread(&WorkerPool::WorkerMain, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	// Let the workers finish the queued tasks and exit
+	{
+		lock_guard<mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+	for (auto &t : mThreads)
+	{
+		t.join();
+	}
+}
+
+void WorkerPool::Enqueue(function<void()> task)
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+		mTasks.push_back(move(task));
+	}
+	mCondition.notify_one();
+}
+
+void WorkerPool::ParallelFor(UINT count, UINT chunkSize, const function<void(UINT begin, UINT end)> &func)
+{
+	if (count == 0) return;
+	chunkSize = max(chunkSize, 1U);
+	UINT chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	// Not worth waking anybody up
+	if (chunkCount == 1 || mThreads.empty())
+	{
+		func(0, count);
+		return;
+	}
+
+	// Chunks are claimed through a shared counter so that faster threads take more of them.
+	// The state is shared because a worker can start the task only after all the chunks are done.
+	struct ParallelForState
+	{
+		atomic<UINT> nextChunk;
+		atomic<UINT> remainingChunks;
+		mutex doneMutex;
+		condition_variable doneCondition;
+	};
+	shared_ptr<ParallelForState> state = make_shared<ParallelForState>();
+	state->nextChunk = 0;
+	state->remainingChunks = chunkCount;
+	const function<void(UINT, UINT)> *funcPt = &func;
+	auto processChunks = [state, funcPt, count, chunkSize, chunkCount]()
+	{
+		UINT chunk;
+		while ((chunk = state->nextChunk++) < chunkCount)
+		{
+			UINT begin = chunk * chunkSize;
+			(*funcPt)(begin, min(begin + chunkSize, count));
+			if (--state->remainingChunks == 0)
+			{
+				lock_guard<mutex> lock(state->doneMutex);
+				state->doneCondition.notify_all();
+			}
+		}
+	};
+
+	// Wake up the helpers and do some work on this thread too
+	UINT helperCount = min(chunkCount - 1, GetThreadCount());
+	for (UINT i = 0; i < helperCount; ++i)
+	{
+		Enqueue(processChunks);
+	}
+	processChunks();
+
+	// Wait for the chunks taken by the workers
+	unique_lock<mutex> lock(state->doneMutex);
+	state->doneCondition.wait(lock, [&state]() { return state->remainingChunks == 0; });
+}
+
+void WorkerPool::WorkerMain()
+{
+	while (true)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+			if (mTasks.empty()) return; // stopping
+			task = move(mTasks.front());
+			mTasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "SpeckEngineDefinitions.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+
+namespace Speck
+{
+	//-------------------------------------------------------------------------------------
+	//	Fixed set of worker threads that execute queued CPU tasks.
+	//	Threads are created once and sleep while there is no work.
+	//-------------------------------------------------------------------------------------
+	class WorkerPool
+	{
+	public:
+		// Zero thread count means one thread less than the number of hardware threads.
+		DLL_EXPORT WorkerPool(UINT threadCount = 0);
+		DLL_EXPORT ~WorkerPool();
+		// Make these inaccessible.
+		WorkerPool(const WorkerPool &workerPool) = delete;
+		WorkerPool &operator=(const WorkerPool &workerPool) = delete;
+
+		// Number of worker threads (the calling thread not included).
+		UINT GetThreadCount() const { return (UINT)mThreads.size(); }
+
+		// Queues a task to be executed on one of the worker threads.
+		DLL_EXPORT void Enqueue(std::function<void()> task);
+
+		// Splits the range [0, count) into chunks and processes them on the worker threads
+		// and on the calling thread. Returns when all of the chunks are done.
+		DLL_EXPORT void ParallelFor(UINT count, UINT chunkSize, const std::function<void(UINT begin, UINT end)> &func);
+
+	private:
+		void WorkerMain();
+
+	private:
+		std::vector<std::thread> mThreads;
+		std::deque<std::function<void()>> mTasks;
+		std::mutex mMutex;
+		std::condition_variable mCondition;
+		bool mStopping;
+	};
+}
+
+#endif
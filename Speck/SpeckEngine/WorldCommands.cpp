@@ -12,6 +12,7 @@
 #include "CubeRenderTarget.h"
 #include "SpecksHandler.h"
 #include "RandomGenerator.h"
+#include "SDFGradient.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -98,65 +99,61 @@ int AddRenderItemCommand::Execute(void *ptIn, CommandResult *result) const
 	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
 	SpeckWorld *sWorld = static_cast<SpeckWorld*>(&sApp->GetWorld());
 
-	// Determine the PSO group and create the render item.
-	vector<unique_ptr<RenderItem>> *psoGroupItems;
-	unique_ptr<RenderItem> rItem;
-	switch (type)
+	// Determine the PSO group.
+	string psoGroupName = PSOGroupNameOverride;
+	if (psoGroupName.empty())
+		psoGroupName = (type == SpeckSkeletalBody) ? "skeletalBody" : "static";
+
+	// Fill in the parameters shared by all the render items.
+	auto fillRenderItem = [&](TexturedRenderItem *rItem)
 	{
-		case Static:
-			rItem = make_unique<StaticRenderItem>();
-			psoGroupItems = (PSOGroupNameOverride.empty()) ? &sWorld->mPSOGroups["static"]->mRItems : &sWorld->mPSOGroups[PSOGroupNameOverride]->mRItems;
-			break;
-		case SpeckRigidBody:
-			rItem = make_unique<SpeckRigidBodyRenderItem>();
-			psoGroupItems = (PSOGroupNameOverride.empty()) ? &sWorld->mPSOGroups["static"]->mRItems : &sWorld->mPSOGroups[PSOGroupNameOverride]->mRItems;
-			break;
-		case SpeckSkeletalBody:
-			rItem = make_unique<SpeckSkeletalBodyRenderItem>();
-			psoGroupItems = (PSOGroupNameOverride.empty()) ? &sWorld->mPSOGroups["skeletalBody"]->mRItems : &sWorld->mPSOGroups[PSOGroupNameOverride]->mRItems;
-			break;
-		default:
-		{
-			LOG(L"Unrecognized type.", ERROR);
-			return 1;
-		}
-	}
+		rItem->mGeo = sApp->mGeometries[geometryName].get();
+		rItem->mRenderItemBufferIndex = sWorld->GetRenderItemFreeSpace();
+		rItem->mMat = static_cast<PBRMaterial *>(sApp->mMaterials[materialName].get());
+		rItem->mTexTransform = texTransform;
+		rItem->mPrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		rItem->mInstanceCount = 1;
+		rItem->mIndexCount = rItem->mGeo->DrawArgs[meshName].IndexCount;
+		rItem->mStartIndexLocation = rItem->mGeo->DrawArgs[meshName].StartIndexLocation;
+		rItem->mBaseVertexLocation = rItem->mGeo->DrawArgs[meshName].BaseVertexLocation;
+		rItem->mBounds = &rItem->mGeo->DrawArgs[meshName].Bounds;
+		if (!rItem->mGeo->DrawArgs[meshName].LODs.empty())
+			rItem->mLODs = &rItem->mGeo->DrawArgs[meshName].LODs;
+		if (!rItem->mGeo->DrawArgs[meshName].Meshlets.empty())
+			rItem->mMeshlets = &rItem->mGeo->DrawArgs[meshName].Meshlets;
+	};
 
-	// Fill in the render item with appropriate data.
-	rItem->mGeo = sApp->mGeometries[geometryName].get();
+	// Create the render item with appropriate data, the render scene keeps it.
+	RenderItemHandle handle;
 	switch (type)
 	{
 		case Static:
 		{
-			StaticRenderItem *pSRItem = static_cast<StaticRenderItem*>(rItem.get()); // cast it so that it is easier to manipulate
-			pSRItem->mRenderItemBufferIndex = sWorld->GetRenderItemFreeSpace();
-			pSRItem->mMat = static_cast<PBRMaterial *>(sApp->mMaterials[materialName].get());
-			pSRItem->mTexTransform = texTransform;
-			pSRItem->mBounds = &rItem->mGeo->DrawArgs[meshName].Bounds;
-			pSRItem->mW.mS = staticRenderItem.worldTransform.mS;
-			pSRItem->mW.mT = staticRenderItem.worldTransform.mT;
-			pSRItem->mW.mR = staticRenderItem.worldTransform.mR;
+			StaticRenderItem rItem;
+			fillRenderItem(&rItem);
+			rItem.mW.mS = staticRenderItem.worldTransform.mS;
+			rItem.mW.mT = staticRenderItem.worldTransform.mT;
+			rItem.mW.mR = staticRenderItem.worldTransform.mR;
+			handle = sWorld->mRenderScene.Add(rItem);
 			break;
 		}
 		case SpeckRigidBody:
 		{
-			SpeckRigidBodyRenderItem *pSRBRItem = static_cast<SpeckRigidBodyRenderItem*>(rItem.get()); // cast it so that it is easier to manipulate
-			pSRBRItem->mRenderItemBufferIndex = sWorld->GetRenderItemFreeSpace();
-			pSRBRItem->mMat = static_cast<PBRMaterial *>(sApp->mMaterials[materialName].get());
-			pSRBRItem->mTexTransform = texTransform;
-			pSRBRItem->mSpeckRigidBodyIndex = speckRigidBodyRenderItem.rigidBodyIndex;
-			pSRBRItem->mL.mS = staticRenderItem.worldTransform.mS;
-			pSRBRItem->mL.mT = staticRenderItem.worldTransform.mT;
-			pSRBRItem->mL.mR = staticRenderItem.worldTransform.mR;
+			SpeckRigidBodyRenderItem rItem;
+			fillRenderItem(&rItem);
+			rItem.mSpeckRigidBodyIndex = speckRigidBodyRenderItem.rigidBodyIndex;
+			rItem.mL.mS = staticRenderItem.worldTransform.mS;
+			rItem.mL.mT = staticRenderItem.worldTransform.mT;
+			rItem.mL.mR = staticRenderItem.worldTransform.mR;
+			handle = sWorld->mRenderScene.Add(rItem);
 			break;
 		}
 		case SpeckSkeletalBody:
 		{
-			SpeckSkeletalBodyRenderItem *pSSBRItem = static_cast<SpeckSkeletalBodyRenderItem*>(rItem.get()); // cast it so that it is easier to manipulate
-			pSSBRItem->mRenderItemBufferIndex = sWorld->GetRenderItemFreeSpace();
-			pSSBRItem->mMat = static_cast<PBRMaterial *>(sApp->mMaterials[materialName].get());
-			pSSBRItem->mTexTransform = texTransform;
-			// ...
+			SpeckSkeletalBodyRenderItem rItem;
+			fillRenderItem(&rItem);
+			rItem.mLODRigidBodyIndex = speckSkeletalBodyRenderItem.lodRigidBodyIndex;
+			handle = sWorld->mRenderScene.Add(rItem);
 			break;
 		}
 		default:
@@ -165,13 +162,11 @@ int AddRenderItemCommand::Execute(void *ptIn, CommandResult *result) const
 			return 1;
 		}
 	}
-	rItem->mPrimitiveType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	rItem->mIndexCount = rItem->mGeo->DrawArgs[meshName].IndexCount;
-	rItem->mStartIndexLocation = rItem->mGeo->DrawArgs[meshName].StartIndexLocation;
-	rItem->mBaseVertexLocation = rItem->mGeo->DrawArgs[meshName].BaseVertexLocation;
 
 	// Add to the render group.
-	psoGroupItems->push_back(std::move(rItem));
+	sWorld->mPSOGroups[psoGroupName]->mRItems.push_back(handle);
+	if (type == Static)
+		sWorld->AssignInstanceBatch(handle, sWorld->mPSOGroups[psoGroupName].get());
 	return 0;
 }
 
@@ -362,6 +357,13 @@ int AddSpecksCommand::Execute(void * ptIn, CommandResult *result) const
 	}
 	PBRMaterial *matPt = static_cast<PBRMaterial *>(sApp->mMaterials[materialName].get());
 
+	// Calculate SDF gradients (stored in the speck parameters)
+	vector<XMFLOAT3> sdfGradients;
+	if (speckType == RigidBody || (speckType == RigidBodyJoint && rigidBodyJoint.calculateSDFGradient))
+	{
+		SDFGradient::Calculate(newSpecks, sWorld->GetSpecksHandler()->GetSpeckRadius(), sApp->GetEngineCore().GetWorkerPool(), &sdfGradients);
+	}
+
 	for (UINT i = 0; i < (UINT)newSpecks.size(); i++)
 	{
 		SpeckData tempS;
@@ -375,77 +377,9 @@ int AddSpecksCommand::Execute(void * ptIn, CommandResult *result) const
 			case Normal:
 				break;
 			case RigidBody:
-			{
-				// Calculate SDF gradient
-				XMVECTOR gradient1 = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); // used for calculating the actual gradient
-				XMVECTOR gradient2 = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); // used as an indicator of the boundary specks
-				XMVECTOR pos = XMLoadFloat3(&newSpecks[i].position);
-				float maxDist = sWorld->GetSpecksHandler()->GetSpeckRadius() * 2.0f * 1.2f;
-				float maxDistSq = maxDist*maxDist;
-				for (UINT j = 0; j < (UINT)newSpecks.size(); ++j)
-				{
-					if (i == j) continue;
-					XMVECTOR neighbourPos = XMLoadFloat3(&newSpecks[j].position);
-					XMVECTOR r = pos - neighbourPos;
-					float lenSq = XMVectorGetX(XMVector3LengthSq(r));
-					float lenPow = powf(lenSq, 10.0f);
-					float invLenPow = 1.0f / lenPow;
-
-					gradient1 += r * invLenPow;
-					if (lenSq < maxDistSq)
-					{
-						gradient2 += r;
-					}
-				}
-				gradient1 = XMVector3Normalize(gradient1);
-				float grad2Len = XMVectorGetX(XMVector3LengthEst(gradient2));
-				float epsilon = 0.001f;
-				if (grad2Len > epsilon)
-				{
-					gradient1 *= 2.0f; // indication that this is a boundary speck
-				}
-				XMFLOAT3 gradientF;
-				XMStoreFloat3(&gradientF, gradient1);
-				tempS.mParam[0] = gradientF.x;
-				tempS.mParam[1] = gradientF.y;
-				tempS.mParam[2] = gradientF.z;
-			}
-			break;
 			case RigidBodyJoint:
 			{
-				// Calculate SDF gradient
-				XMVECTOR gradient1 = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); // used for calculating the actual gradient
-				if (rigidBodyJoint.calculateSDFGradient)
-				{
-					XMVECTOR gradient2 = XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); // used as an indicator of the boundary specks
-					XMVECTOR pos = XMLoadFloat3(&newSpecks[i].position);
-					float maxDist = sWorld->GetSpecksHandler()->GetSpeckRadius() * 2.0f * 1.2f;
-					float maxDistSq = maxDist*maxDist;
-					for (UINT j = 0; j < (UINT)newSpecks.size(); ++j)
-					{
-						if (i == j) continue;
-						XMVECTOR neighbourPos = XMLoadFloat3(&newSpecks[j].position);
-						XMVECTOR r = pos - neighbourPos;
-						float lenSq = XMVectorGetX(XMVector3LengthSq(r));
-						float lenPow = powf(lenSq, 10.0f);
-						float invLenPow = 1.0f / lenPow;
-
-						gradient1 += r * invLenPow;
-						if (lenSq < maxDistSq)
-						{
-							gradient2 += r;
-						}
-					}
-					gradient1 = XMVector3Normalize(gradient1);
-					float grad2Len = XMVectorGetX(XMVector3LengthEst(gradient2));
-					float epsilon = 0.001f;
-					if (grad2Len > epsilon)
-					{
-						gradient1 *= 2.0f; // indication that this is a boundary speck
-					}
-				}
-				XMFLOAT3 gradientF;
-				XMStoreFloat3(&gradientF, gradient1);
+				XMFLOAT3 gradientF = sdfGradients.empty() ? XMFLOAT3(0.0f, 0.0f, 0.0f) : sdfGradients[i];
 				tempS.mParam[0] = gradientF.x;
 				tempS.mParam[1] = gradientF.y;
 				tempS.mParam[2] = gradientF.z;
@@ -683,3 +617,30 @@ int SetSpecksSolverParametersCommand::Execute(void * ptIn, CommandResult * resul
 
 	return 0;
 }
+
+int SetSolverStatsEnabledCommand::Execute(void * ptIn, CommandResult * result) const
+{
+	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
+	SpeckWorld *sWorld = static_cast<SpeckWorld*>(&sApp->GetWorld());
+	sWorld->mSpecksHandler->SetSolverStatsEnabled(enabled);
+
+	return 0;
+}
+
+int GetSolverStatsCommand::Execute(void * ptIn, CommandResult * result) const
+{
+	SpeckApp *sApp = static_cast<SpeckApp*>(ptIn);
+	SpeckWorld *sWorld = static_cast<SpeckWorld*>(&sApp->GetWorld());
+	const deque<SolverStats> &history = sWorld->mSpecksHandler->GetSolverStatsHistory();
+
+	if (result)
+	{
+		GetSolverStatsCommandResult *statsResult = static_cast<GetSolverStatsCommandResult *>(result);
+		statsResult->current = history.empty() ? SolverStats() : history.back();
+		statsResult->history.assign(history.begin(), history.end());
+	}
+	if (clear)
+		sWorld->mSpecksHandler->ClearSolverStatsHistory();
+
+	return 0;
+}
@@ -65,7 +65,8 @@ namespace Speck
 				} speckRigidBodyRenderItem;
 				struct
 				{
-					//...
+					// Index of the speck rigid body whose position is used to pick the level of detail.
+					UINT lodRigidBodyIndex;
 				} speckSkeletalBodyRenderItem;
 			};
 		protected:
@@ -204,6 +205,30 @@ namespace Speck
 		protected:
 			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
 		};
+
+		// The solver counts its dropped and done work only after this is enabled.
+		struct SetSolverStatsEnabledCommand : WorldCommand
+		{
+			bool enabled = true;
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
+
+		struct GetSolverStatsCommandResult : CommandResult
+		{
+			// Stats of the last frame that was read back, zeroed if there is none.
+			SolverStats current;
+			// Stats of the last frames, the oldest first.
+			std::vector<SolverStats> history;
+		};
+
+		struct GetSolverStatsCommand : WorldCommand
+		{
+			// Forget the history after it was returned.
+			bool clear = false;
+		protected:
+			DLL_EXPORT virtual int Execute(void *ptIn, CommandResult *result) const override;
+		};
 	}
 }
 
@@ -53,6 +53,10 @@ StructuredBuffer<InstanceData> gInstanceData	: register(t0, space1);
 StructuredBuffer<MaterialData> gMaterialData	: register(t1, space1);
 // Rigid body data
 StructuredBuffer<RigidBodyData> gRigidBodies	: register(t2, space1);
+// Transforms of the static render items, by their render item buffer indices
+StructuredBuffer<StaticInstanceData> gStaticInstances	: register(t3, space1);
+// Static render items drawn by the instanced draws of the frame
+StructuredBuffer<uint> gStaticInstanceIndices			: register(t4, space1);
 
 // Samplers
 SamplerState gsamPointWrap        : register(s0);
@@ -103,7 +107,7 @@ float4 NormalInWorldToTextel(float3 normalW)
 //---------------------------------------------------------------------------------------
 // Offset the texture coordinates due to parallax occlusion.
 //---------------------------------------------------------------------------------------
-float2 GetParallaxOcclusionTextureCoordinateOffset(float2 texCoord, float3 texPosW, float3 texNormalW, float heightMapScale, float4x4 texTransform, float3x3 TBN)
+float2 GetParallaxOcclusionTextureCoordinateOffset(float2 texCoord, float3 texPosW, float3 texNormalW, float heightMapScale, float4x4 texTransform, float3x3 TBN, float minLod)
 {
 	// Calculate new parallaxed texture coordinates.
 	float3 E = normalize(texPosW - gEyePosW);
@@ -134,7 +138,7 @@ float2 GetParallaxOcclusionTextureCoordinateOffset(float2 texCoord, float3 texPo
 	[unroll(PARALLAX_OCCLUSION_MAX_STEPS)]
 	while (nCurrSample < nNumSamples)
 	{
-		fCurrSampledHeight = gTextureMaps[2].SampleGrad(gsamAnisotropicWrap, texCoord + vCurrOffset, dx, dy).r;
+		fCurrSampledHeight = gTextureMaps[2].SampleGrad(gsamAnisotropicWrap, texCoord + vCurrOffset, dx, dy, int2(0, 0), minLod).r;
 		if (fCurrSampledHeight > fCurrRayHeight)
 		{
 			float delta1 = fCurrSampledHeight - fCurrRayHeight;
@@ -8,12 +8,21 @@ struct InstanceData
 	uint		MaterialIndex;
 };
 
+struct StaticInstanceData
+{
+	float4x4 Transform;
+	float4x4 InvTransposeTransform;
+	float4x4 TexTransform;
+};
+
 struct MaterialData
 {
 	float4   DiffuseAlbedo;
 	float3   FresnelR0;
 	float    Roughness;
 	float4x4 MatTransform;
+	float    MinLod; // most detailed mip that is resident in all of the material textures
+	float3   Pad0;
 };
 
 struct RigidBodyData
@@ -34,6 +34,32 @@ cbuffer cbSettings				: register(b0)
 	uint gPhaseIteration;
 	// For repetitive phases this number represents total number of iterations.
 	uint gNumPhaseIterations;
+	// If not zero, the phases record their counters to gSolverStats.
+	uint gCollectSolverStats;
+};
+
+// Counters of the work the solver did or dropped in a frame.
+struct SolverStatsData
+{
+	// Written by the CPU before the first substep.
+	uint frame;
+	uint specks;
+	uint substeps;
+	uint solverIterations;
+	// Specks that did not fit in their grid cell.
+	uint gridOverflowCount;
+	uint speckContactsSum;
+	uint speckContactsMax;
+	// Constraints that were found, but there was no room to keep them.
+	uint droppedSpeckContacts;
+	uint droppedStaticColliderContacts;
+	uint droppedRigidBodyConstraints;
+	uint activeSpecks;
+	uint sleepingSpecks;
+	// Position corrections in each solver iteration, the sums are in fixed point
+	// and the maximums are the bits of the (non-negative) float values.
+	uint residualSum[SOLVER_STATS_MAX_ITERATIONS];
+	uint residualMax[SOLVER_STATS_MAX_ITERATIONS];
 };
 
 // Helper structure used to pass the information about specks to the device.
@@ -211,9 +237,22 @@ RWStructuredBuffer<RigidBodyData> gRigidBodies							: register(u5);
 // Speck rigid body links cache data
 RWStructuredBuffer<SpeckRigidBodyLinkCache> gSpeckRigidBodyLinkCache	: register(u6);
 
+// Solver stats, a single element
+RWStructuredBuffer<SolverStatsData> gSolverStats						: register(u7);
+
 //
 // Utility functions
 //
+// Records the position correction of a speck in the given solver iteration. The fixed point value is the one of EncodeSolverResidual in SolverStats.h.
+void RecordSolverResidual(uint iteration, float residual)
+{
+	if (iteration >= SOLVER_STATS_MAX_ITERATIONS || residual <= 0.0f)
+		return;
+
+	InterlockedAdd(gSolverStats[0].residualSum[iteration], (uint)(residual / gSpeckRadius * SOLVER_STATS_RESIDUAL_SCALE + 0.5f));
+	InterlockedMax(gSolverStats[0].residualMax[iteration], asuint(residual));
+}
+
 uint calcGridHash(int3 gridPos, uint numBuckets)
 {
 	gridPos += int3(100000, 100000, 100000);
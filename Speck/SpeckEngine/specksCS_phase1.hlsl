@@ -51,9 +51,12 @@ void main(int3 threadGroupID : SV_GroupID, int3 dispatchThreadID : SV_DispatchTh
 		// Register this speck to the appropriate position in the assigned cell.
 		gSPCells[cellID].specks[posToWrite].index = speckIndex;
 	}
-	//else
+	else if (gCollectSolverStats)
+	{
 		// All the specks that get assigned to the cell that has no more room
 		// in it will behave as if they do not collide with other specks.
+		InterlockedAdd(gSolverStats[0].gridOverflowCount, 1);
+	}
 
 
 
@@ -70,4 +70,13 @@ void main(int3 threadGroupID : SV_GroupID, int3 dispatchThreadID : SV_DispatchTh
 	float C_density_constraint = roi * invRo0 - 1.0f; // densitiy constraint
 	float lambda = -C_density_constraint / (lambdaDenominator + 100.0f);
 	gSpecksConstraints[speckIndex].densityConstraintLambda = lambda;
+
+	if (gCollectSolverStats)
+	{
+		uint numContacts = gSpecksConstraints[speckIndex].numSpeckContacts;
+		InterlockedAdd(gSolverStats[0].speckContactsSum, numContacts);
+		InterlockedMax(gSolverStats[0].speckContactsMax, numContacts);
+		if (numContacts > NUM_SPECK_CONTACT_CONSTRAINTS_PER_SPECK)
+			InterlockedAdd(gSolverStats[0].droppedSpeckContacts, numContacts - NUM_SPECK_CONTACT_CONSTRAINTS_PER_SPECK);
+	}
 }
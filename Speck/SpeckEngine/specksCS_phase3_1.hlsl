@@ -65,6 +65,10 @@ void main(int3 threadGroupID : SV_GroupID, int3 dispatchThreadID : SV_DispatchTh
 			// Register this speck to the appropriate position in the assigned cell.
 			gSpecksConstraints[speckIndex].staticColliderContacts[posToWrite] = scc;
 		}
+		else if (gCollectSolverStats)
+		{
+			InterlockedAdd(gSolverStats[0].droppedStaticColliderContacts, 1);
+		}
 
 	}
 }
@@ -410,6 +410,9 @@ void main(int3 threadGroupID : SV_GroupID, int3 dispatchThreadID : SV_DispatchTh
 		{
 			float3 appliedDeltaP = totalDeltaP / n;
 			thisSpeck.pos_predicted += appliedDeltaP;
+
+			if (gCollectSolverStats)
+				RecordSolverResidual(gPhaseIteration / 2, length(appliedDeltaP));
 		}
 		gSpecks[speckIndex] = thisSpeck;
 	}
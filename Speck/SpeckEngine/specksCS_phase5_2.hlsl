@@ -166,5 +166,9 @@ void main(int3 threadGroupID : SV_GroupID, int3 dispatchThreadID : SV_DispatchTh
 			rbc.rigidBodyIndex = thisLink.rbIndex;
 			gSpecksConstraints[thisLink.speckIndex].speckRigidBodyConstraint[posToWrite] = rbc;
 		}
+		else if (gCollectSolverStats)
+		{
+			InterlockedAdd(gSolverStats[0].droppedRigidBodyConstraints, 1);
+		}
 	}
 }
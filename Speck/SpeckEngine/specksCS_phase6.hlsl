@@ -27,12 +27,21 @@ void main(int3 threadGroupID : SV_GroupID, int3 dispatchThreadID : SV_DispatchTh
 	float3 diff = SafeDiv(s.pos_predicted - s.pos, gDeltaTime);
 	float difLenSq = dot(diff, diff);
 
-	if (difLenSq >= sleepEpsilonSq ||
-		thisSpeckUpperCode == SPECK_CODE_FLUID) // fluids behave differntly somehow :S
+	bool active = difLenSq >= sleepEpsilonSq ||
+		thisSpeckUpperCode == SPECK_CODE_FLUID; // fluids behave differntly somehow :S
+	if (active)
 	{
 		s.pos = s.pos_predicted;
 	}
 
+	if (gCollectSolverStats)
+	{
+		if (active)
+			InterlockedAdd(gSolverStats[0].activeSpecks, 1);
+		else
+			InterlockedAdd(gSolverStats[0].sleepingSpecks, 1);
+	}
+
 	s.vel = diff;
 
 	gSpecks[speckIndex] = s;
@@ -36,16 +36,16 @@ PixelOut main(VertexOut pin)
 	float fHeightMapScale = 0.0125f;
 	float4x4 texTransform = mul(gTexTransform, matData.MatTransform);
 	fHeightMapScale *= texTransform._m20*texTransform._m20 + texTransform._m21*texTransform._m21 + texTransform._m22*texTransform._m22;
-	float2 vFinalCoords = GetParallaxOcclusionTextureCoordinateOffset(pin.TexC, pin.PosW, pin.NormalW, fHeightMapScale, texTransform, TBN);
+	float2 vFinalCoords = GetParallaxOcclusionTextureCoordinateOffset(pin.TexC, pin.PosW, pin.NormalW, fHeightMapScale, texTransform, TBN, matData.MinLod);
 
-	float4 normalMapSample = gTextureMaps[DEFERRED_RENDER_TARGET_NORMAL_MAP].Sample(gsamAnisotropicWrap, vFinalCoords);
+	float4 normalMapSample = gTextureMaps[DEFERRED_RENDER_TARGET_NORMAL_MAP].Sample(gsamAnisotropicWrap, vFinalCoords, int2(0, 0), matData.MinLod);
 	float3 bumpedNormalW = NormalSampleToWorldSpace(normalMapSample.rgb, TBN);
 
 	// Dynamically look up the texture in the array.
-	diffuseAlbedo *= gTextureMaps[DEFERRED_RENDER_TARGET_DIFFUSE_MAP].Sample(gsamAnisotropicWrap, vFinalCoords);
+	diffuseAlbedo *= gTextureMaps[DEFERRED_RENDER_TARGET_DIFFUSE_MAP].Sample(gsamAnisotropicWrap, vFinalCoords, int2(0, 0), matData.MinLod);
 
 	// Fetch the PBR data
-	float texMetalness = gTextureMaps[DEFERRED_RENDER_TARGET_METALNESS_MAP].Sample(gsamAnisotropicWrap, vFinalCoords).r;
+	float texMetalness = gTextureMaps[DEFERRED_RENDER_TARGET_METALNESS_MAP].Sample(gsamAnisotropicWrap, vFinalCoords, int2(0, 0), matData.MinLod).r;
 	float texRoughness = 0.0f;// gTextureMaps[roughnessMapIndex].Sample(gsamAnisotropicWrap, vFinalCoords).r;
 	float texAO = 0.0f;// gTextureMaps[aoMapIndex].Sample(gsamAnisotropicWrap, vFinalCoords).r;
 
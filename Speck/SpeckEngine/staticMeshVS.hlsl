@@ -19,7 +19,7 @@ struct VertexOut
 	float2 TexC			: TEXCOORD;
 };
 
-VertexOut main(VertexIn vin)
+VertexOut main(VertexIn vin, uint instanceID : SV_InstanceID)
 {
 	VertexOut vout = (VertexOut)0.0f;
 
@@ -29,6 +29,7 @@ VertexOut main(VertexIn vin)
 	// World matrix is type dependant
 	float4x4 world;
 	float3x3 invTransposeWorld;
+	float4x4 texTransform = gTexTransform;
 	switch (gRenderItemType)
 	{
 		case RENDER_ITEM_TYPE_STATIC:
@@ -48,6 +49,16 @@ VertexOut main(VertexIn vin)
 		}
 		break;
 
+		case RENDER_ITEM_TYPE_STATIC_INSTANCED:
+		{
+			uint staticInstanceIndex = gStaticInstanceIndices[gParam[0].x + instanceID];
+			StaticInstanceData instData = gStaticInstances[staticInstanceIndex];
+			world = instData.Transform;
+			invTransposeWorld = (float3x3)instData.InvTransposeTransform;
+			texTransform = instData.TexTransform;
+		}
+		break;
+
 		default:
 		{
 			world = Identity4x4();
@@ -68,7 +79,7 @@ VertexOut main(VertexIn vin)
 	vout.PosH = mul(posW, gViewProj);
 
 	// Output vertex attributes for interpolation across triangle.
-	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
+	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), texTransform);
 	vout.TexC = mul(texC, matData.MatTransform).xy;
 
 	return vout;
@@ -0,0 +1,260 @@
+#include "TestFramework.h"
+#include "AnimationClip.h"
+#include "AnimationClipBaker.h"
+#include "FBXConversions.h"
+#include <WorkerPool.h>
+
+using namespace std;
+using namespace DirectX;
+
+namespace
+{
+	// Largest differences between the model pose of the clip and the global transforms evaluated by the FBX SDK.
+	struct PoseError
+	{
+		float Rotation = 0.0f;		// radians
+		float Translation = 0.0f;	// relative to the largest distance of a joint from the origin
+	};
+
+	// The clip starts at the start of the stack, which is the given time of the scene.
+	PoseError CompareWithEvaluator(FbxScene *scene, const AnimationClip &clip, float time, double stackStart = 0.0)
+	{
+		map<string, FbxNode *> nodes;
+		for (int n = 0; n < scene->GetNodeCount(); ++n)
+			nodes[scene->GetNode(n)->GetName()] = scene->GetNode(n);
+
+		AnimationPose localPose, modelPose;
+		clip.SampleLocalPose(time, &localPose);
+		clip.LocalToModelPose(localPose, &modelPose);
+
+		FbxTime fbxTime;
+		fbxTime.SetSecondDouble(stackStart + time);
+		PoseError error;
+		float extent = 1e-6f;
+		for (UINT j = 0; j < clip.GetJointCount(); ++j)
+		{
+			FbxNode *node = nodes[clip.GetJointName(j)];
+			CHECK(node != nullptr);
+			if (!node)
+				continue;
+
+			XMFLOAT4X4 globalF;
+			Conv(&globalF, scene->GetAnimationEvaluator()->GetNodeGlobalTransform(node, fbxTime));
+			XMVECTOR sca, rot, tra;
+			XMMatrixDecompose(&sca, &rot, &tra, XMLoadFloat4x4(&globalF));
+
+			float dot = fabsf(XMVectorGetX(XMQuaternionDot(rot, XMLoadFloat4(&modelPose.mRotations[j]))));
+			error.Rotation = max(error.Rotation, 2.0f * acosf(min(dot, 1.0f)));
+			error.Translation = max(error.Translation, XMVectorGetX(XMVector3Length(tra - XMLoadFloat3(&modelPose.mTranslations[j]))));
+			extent = max(extent, XMVectorGetX(XMVector3Length(tra)));
+		}
+		error.Translation /= extent;
+		return error;
+	}
+
+	FbxScene *ImportScene(FbxManager *manager, const char *filePath)
+	{
+		FbxImporter *importer = FbxImporter::Create(manager, "");
+		FbxScene *scene = nullptr;
+		if (importer->Initialize(filePath, -1, manager->GetIOSettings()))
+		{
+			scene = FbxScene::Create(manager, filePath);
+			if (!importer->Import(scene))
+			{
+				scene->Destroy();
+				scene = nullptr;
+			}
+		}
+		importer->Destroy();
+		return scene;
+	}
+
+	void AddLinearKeys(FbxAnimCurve *curve, float startValue, float endValue, double duration, double start = 0.0)
+	{
+		FbxTime time;
+		curve->KeyModifyBegin();
+		time.SetSecondDouble(start);
+		int key = curve->KeyAdd(time);
+		curve->KeySetValue(key, startValue);
+		curve->KeySetInterpolation(key, FbxAnimCurveDef::eInterpolationLinear);
+		time.SetSecondDouble(start + duration);
+		key = curve->KeyAdd(time);
+		curve->KeySetValue(key, endValue);
+		curve->KeySetInterpolation(key, FbxAnimCurveDef::eInterpolationLinear);
+		curve->KeyModifyEnd();
+	}
+}
+
+// Chain of three joints, the root moves and the middle one turns half way around.
+TEST(AnimationClip_SyntheticChainMatchesEvaluator)
+{
+	FbxManager *manager = FbxManager::Create();
+	FbxScene *scene = FbxScene::Create(manager, "Synthetic");
+	FbxNode *hips = FbxNode::Create(scene, "Hips");
+	FbxNode *arm = FbxNode::Create(scene, "Arm");
+	FbxNode *hand = FbxNode::Create(scene, "Hand");
+	scene->GetRootNode()->AddChild(hips);
+	hips->AddChild(arm);
+	arm->AddChild(hand);
+	arm->LclTranslation.Set(FbxDouble3(0.0, 1.0, 0.0));
+	hand->LclTranslation.Set(FbxDouble3(0.5, 0.0, 0.0));
+
+	const double duration = 2.0;
+	FbxAnimStack *stack = FbxAnimStack::Create(scene, "Wave");
+	FbxAnimLayer *layer = FbxAnimLayer::Create(scene, "Base");
+	stack->AddMember(layer);
+	stack->SetLocalTimeSpan(FbxTimeSpan(FBXSDK_TIME_ZERO, FbxTimeSeconds(duration)));
+	AddLinearKeys(hips->LclTranslation.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_X, true), 0.0f, 3.0f, duration);
+	AddLinearKeys(arm->LclRotation.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_Y, true), 0.0f, 170.0f, duration);
+	AddLinearKeys(hand->LclRotation.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_Z, true), 0.0f, -90.0f, duration);
+
+	AnimationClip clip;
+	AnimationClipBaker::Bake(scene, stack, 30.0f, &clip);
+	CHECK(clip.GetJointCount() == 4);
+	CHECK(clip.GetSampleCount() == 61);
+	CHECK_NEAR(clip.GetDuration(), duration, 1e-4);
+
+	// On the samples and between them
+	for (float time = 0.0f; time < (float)duration; time += 0.5f / 30.0f)
+	{
+		PoseError error = CompareWithEvaluator(scene, clip, time);
+		CHECK(error.Rotation < 0.002f);
+		CHECK(error.Translation < 0.001f);
+	}
+
+	// The time wraps around the duration
+	AnimationPose pose, wrappedPose;
+	clip.SampleLocalPose(0.3f, &pose);
+	clip.SampleLocalPose(0.3f + (float)duration, &wrappedPose);
+	for (UINT j = 0; j < clip.GetJointCount(); ++j)
+	{
+		CHECK_NEAR(pose.mRotations[j].y, wrappedPose.mRotations[j].y, 1e-4);
+		CHECK_NEAR(pose.mTranslations[j].x, wrappedPose.mTranslations[j].x, 1e-4);
+	}
+
+	manager->Destroy();
+}
+
+// A stack whose span starts later than the scene is baked from its start, not from the start of the scene.
+TEST(AnimationClip_StackStartingLaterMatchesEvaluator)
+{
+	FbxManager *manager = FbxManager::Create();
+	FbxScene *scene = FbxScene::Create(manager, "Synthetic");
+	FbxNode *hips = FbxNode::Create(scene, "Hips");
+	FbxNode *arm = FbxNode::Create(scene, "Arm");
+	scene->GetRootNode()->AddChild(hips);
+	hips->AddChild(arm);
+	arm->LclTranslation.Set(FbxDouble3(0.0, 1.0, 0.0));
+
+	const double start = 1.5, duration = 1.0;
+	FbxAnimStack *stack = FbxAnimStack::Create(scene, "Late");
+	FbxAnimLayer *layer = FbxAnimLayer::Create(scene, "Base");
+	stack->AddMember(layer);
+	stack->SetLocalTimeSpan(FbxTimeSpan(FbxTimeSeconds(start), FbxTimeSeconds(start + duration)));
+	AddLinearKeys(hips->LclTranslation.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_X, true), 0.0f, 2.0f, duration, start);
+	AddLinearKeys(arm->LclRotation.GetCurve(layer, FBXSDK_CURVENODE_COMPONENT_Y, true), 0.0f, 90.0f, duration, start);
+
+	AnimationClip clip;
+	AnimationClipBaker::Bake(scene, stack, 30.0f, &clip);
+	CHECK(clip.GetSampleCount() == 31);
+	CHECK_NEAR(clip.GetDuration(), duration, 1e-4);
+	for (float time = 0.0f; time < (float)duration; time += 0.5f / 30.0f)
+	{
+		PoseError error = CompareWithEvaluator(scene, clip, time, start);
+		CHECK(error.Rotation < 0.002f);
+		CHECK(error.Translation < 0.001f);
+	}
+
+	// Half way through the stack the hips moved half way, from the start of the scene they would not have moved yet
+	AnimationPose pose;
+	clip.SampleLocalPose(0.5f * (float)duration, &pose);
+	CHECK_NEAR(pose.mTranslations[1].x, 1.0, 1e-3);
+
+	manager->Destroy();
+}
+
+// The animations of the app, baked at the scene frame rate as the cooker does.
+TEST(AnimationClip_KnightAnimationsMatchEvaluator)
+{
+	FbxManager *manager = FbxManager::Create();
+	manager->SetIOSettings(FbxIOSettings::Create(manager, IOSROOT));
+
+	for (const char *filePath : { "Data/Animations/knight_idle.fbx", "Data/Animations/knight_jump.fbx", "Data/Animations/knight_dancing.fbx" })
+	{
+		FbxScene *scene = ImportScene(manager, filePath);
+		CHECK(scene != nullptr);
+		if (!scene)
+			continue;
+
+		int stackCount = scene->GetSrcObjectCount<FbxAnimStack>();
+		CHECK(stackCount > 0);
+		if (stackCount == 0)
+			continue;
+		FbxAnimStack *stack = scene->GetSrcObject<FbxAnimStack>(stackCount - 1);
+		AnimationClip clip;
+		AnimationClipBaker::Bake(scene, stack, 0.0f, &clip);
+
+		// Exact on the samples up to the quantization of the rotations, the error between them comes from the interpolation
+		float frame = 1.0f / clip.GetSampleRate();
+		PoseError onSamples, betweenSamples;
+		for (UINT s = 0; s + 1 < clip.GetSampleCount(); ++s)
+		{
+			PoseError error = CompareWithEvaluator(scene, clip, s * frame);
+			onSamples.Rotation = max(onSamples.Rotation, error.Rotation);
+			onSamples.Translation = max(onSamples.Translation, error.Translation);
+			error = CompareWithEvaluator(scene, clip, (s + 0.5f) * frame);
+			betweenSamples.Rotation = max(betweenSamples.Rotation, error.Rotation);
+			betweenSamples.Translation = max(betweenSamples.Translation, error.Translation);
+		}
+		string name = filePath;
+		TestRegistry::ReportValue(name + " joints", clip.GetJointCount(), "joints");
+		TestRegistry::ReportValue(name + " samples", clip.GetSampleCount(), "samples");
+		TestRegistry::ReportValue(name + " rotation error on the samples", onSamples.Rotation, "rad");
+		TestRegistry::ReportValue(name + " translation error on the samples", onSamples.Translation * 100.0f, "%");
+		TestRegistry::ReportValue(name + " rotation error between the samples", betweenSamples.Rotation, "rad");
+		TestRegistry::ReportValue(name + " translation error between the samples", betweenSamples.Translation * 100.0f, "%");
+		CHECK(onSamples.Rotation < 0.01f);
+		CHECK(onSamples.Translation < 0.002f);
+		CHECK(betweenSamples.Rotation < 0.05f);
+		CHECK(betweenSamples.Translation < 0.01f);
+	}
+
+	manager->Destroy();
+}
+
+// Poses of many skeletons playing the same clip, sampled one skeleton after the other and in chunks of eight on the
+// worker pool as HumanoidSkeleton::UpdateAnimations does. 105 is the number of skeletons of the many skeletons state.
+BENCHMARK(AnimationClip_ManySkeletonPoses)
+{
+	FbxManager *manager = FbxManager::Create();
+	manager->SetIOSettings(FbxIOSettings::Create(manager, IOSROOT));
+	FbxScene *scene = ImportScene(manager, "Data/Animations/knight_idle.fbx");
+	CHECK(scene != nullptr && scene->GetSrcObjectCount<FbxAnimStack>() > 0);
+	if (!scene || scene->GetSrcObjectCount<FbxAnimStack>() == 0)
+	{
+		manager->Destroy();
+		return;
+	}
+	AnimationClip clip;
+	AnimationClipBaker::Bake(scene, scene->GetSrcObject<FbxAnimStack>(scene->GetSrcObjectCount<FbxAnimStack>() - 1), 0.0f, &clip);
+	manager->Destroy();
+
+	WorkerPool workerPool;
+	for (UINT skeletonCount : { 105U, 1000U })
+	{
+		vector<AnimationPose> localPoses(skeletonCount), modelPoses(skeletonCount);
+		auto evaluate = [&](UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; ++i)
+			{
+				clip.SampleLocalPose(0.01f * i, &localPoses[i]);
+				clip.LocalToModelPose(localPoses[i], &modelPoses[i]);
+			}
+		};
+		double serial = MeasureMilliseconds(10, [&]() { evaluate(0, skeletonCount); });
+		double parallel = MeasureMilliseconds(10, [&]() { workerPool.ParallelFor(skeletonCount, 8, evaluate); });
+		string skeletons = to_string(skeletonCount) + " skeletons";
+		TestRegistry::ReportValue(skeletons, serial, "ms");
+		TestRegistry::ReportValue(skeletons + " with " + to_string(workerPool.GetThreadCount()) + " worker threads", parallel, "ms");
+	}
+}
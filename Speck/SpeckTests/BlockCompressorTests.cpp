@@ -0,0 +1,240 @@
+#include "TestFramework.h"
+#include <BlockCompressor.h>
+#include <DDSTextureLayout.h>
+#include <MemoryMappedFile.h>
+#include <WorkerPool.h>
+#include <random>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	const BlockCompressionFormat gFormats[] = { BlockCompressionFormat::BC1, BlockCompressionFormat::BC3, BlockCompressionFormat::BC5, BlockCompressionFormat::BC7 };
+	const char *gFormatNames[] = { "BC1", "BC3", "BC5", "BC7" };
+
+	struct Image
+	{
+		UINT width;
+		UINT height;
+		vector<uint8_t> rgba;
+	};
+
+	// Smooth gradients and shapes with some noise on top, like the textures of the app.
+	Image CreateTestImage(UINT width, UINT height)
+	{
+		mt19937 random(3);
+		uniform_int_distribution<int> noise(-6, 6);
+		Image image = { width, height, vector<uint8_t>(width * height * 4) };
+		for (UINT y = 0; y < height; ++y)
+		{
+			for (UINT x = 0; x < width; ++x)
+			{
+				float u = x / (float)width, v = y / (float)height;
+				float ring = 0.5f + 0.5f * sinf(20.0f * sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)));
+				float values[4] = { 255.0f * u, 255.0f * (0.5f + 0.5f * sinf(6.0f * v)), 255.0f * ring, 255.0f * (1.0f - v) };
+				for (UINT ch = 0; ch < 4; ++ch)
+				{
+					int value = (int)values[ch] + noise(random);
+					image.rgba[(y * width + x) * 4 + ch] = (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+				}
+			}
+		}
+		return image;
+	}
+
+	Image Decompress(BlockCompressionFormat format, const vector<uint8_t> &blocks, UINT width, UINT height)
+	{
+		UINT blocksWide = (width + 3) / 4;
+		Image image = { width, height, vector<uint8_t>(width * height * 4) };
+		uint8_t pixels[64];
+		for (UINT by = 0; by < (height + 3) / 4; ++by)
+		{
+			for (UINT bx = 0; bx < blocksWide; ++bx)
+			{
+				BlockCompressor::DecompressBlock(format, &blocks[(by * blocksWide + bx) * BlockCompressor::GetBlockByteSize(format)], pixels);
+				for (UINT i = 0; i < 16; ++i)
+				{
+					UINT x = bx * 4 + i % 4, y = by * 4 + i / 4;
+					if (x < width && y < height)
+						memcpy(&image.rgba[(y * width + x) * 4], &pixels[i * 4], 4);
+				}
+			}
+		}
+		return image;
+	}
+
+	Image RoundTrip(BlockCompressionFormat format, const Image &image)
+	{
+		vector<uint8_t> blocks(BlockCompressor::GetCompressedSize(format, image.width, image.height));
+		BlockCompressor::Compress(format, image.rgba.data(), image.width, image.height, image.width * 4, nullptr, blocks.data());
+		return Decompress(format, blocks, image.width, image.height);
+	}
+
+	// Peak signal to noise ratio over the channels [channelBegin, channelEnd), in decibels.
+	double GetPSNR(const Image &a, const Image &b, UINT channelBegin, UINT channelEnd)
+	{
+		double squaredError = 0.0;
+		for (size_t i = 0; i < a.rgba.size(); i += 4)
+		{
+			for (UINT ch = channelBegin; ch < channelEnd; ++ch)
+			{
+				double d = (double)a.rgba[i + ch] - b.rgba[i + ch];
+				squaredError += d * d;
+			}
+		}
+		double mse = squaredError / (a.rgba.size() / 4 * (channelEnd - channelBegin));
+		return (mse > 0.0) ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+	}
+
+	// First mip of a BC1 texture of the app, decompressed.
+	bool LoadAppTexture(Image *outImage)
+	{
+		MemoryMappedFile file;
+		DDSTextureLayout layout;
+		if (!file.Open(L"Data/Textures/spaced-tiles1/spaced-tiles1-albedo.dds") ||
+			!DDSTextureLayout::Parse(file.GetData(), (size_t)file.GetSize(), &layout) || layout.format != DXGI_FORMAT_BC1_UNORM)
+			return false;
+		const DDSSubresource &mip = layout.GetSubresource(0, 0);
+		vector<uint8_t> blocks(mip.data, mip.data + mip.slicePitch);
+		*outImage = Decompress(BlockCompressionFormat::BC1, blocks, (UINT)mip.width, (UINT)mip.height);
+		return true;
+	}
+}
+
+// Blocks written by hand, decoded as the hardware does it.
+TEST(BlockCompressor_DecodesReferenceBlocks)
+{
+	uint8_t pixels[64];
+
+	// BC1 with red and blue endpoints, the pixels use the palette entries 0, 1, 2, 3 in turns
+	const uint8_t bc1[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0xE4, 0xE4, 0xE4 };
+	BlockCompressor::DecompressBlock(BlockCompressionFormat::BC1, bc1, pixels);
+	const uint8_t bc1Palette[4][4] = { { 255, 0, 0, 255 }, { 0, 0, 255, 255 }, { 170, 0, 85, 255 }, { 85, 0, 170, 255 } };
+	for (UINT i = 0; i < 16; ++i)
+		CHECK(memcmp(&pixels[i * 4], bc1Palette[i % 4], 4) == 0);
+
+	// Three color mode of BC1 (c0 <= c1), the last entry is transparent black
+	const uint8_t bc1ThreeColors[8] = { 0x1F, 0x00, 0x00, 0xF8, 0xE4, 0xE4, 0xE4, 0xE4 };
+	BlockCompressor::DecompressBlock(BlockCompressionFormat::BC1, bc1ThreeColors, pixels);
+	const uint8_t threeColorPalette[4][4] = { { 0, 0, 255, 255 }, { 255, 0, 0, 255 }, { 127, 0, 127, 255 }, { 0, 0, 0, 0 } };
+	for (UINT i = 0; i < 16; ++i)
+		CHECK(memcmp(&pixels[i * 4], threeColorPalette[i % 4], 4) == 0);
+
+	// BC5 with the eight value mode in red and the six value mode in green, all the pixels use index 2
+	const uint8_t bc5[16] = { 255, 0, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0, 250, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49 };
+	BlockCompressor::DecompressBlock(BlockCompressionFormat::BC5, bc5, pixels);
+	for (UINT i = 0; i < 16; ++i)
+	{
+		CHECK(pixels[i * 4 + 0] == (6 * 255 + 3) / 7);
+		CHECK(pixels[i * 4 + 1] == (1 * 250 + 2) / 5);
+		CHECK(pixels[i * 4 + 2] == 0 && pixels[i * 4 + 3] == 255);
+	}
+}
+
+// Every format stores a single color within its precision.
+TEST(BlockCompressor_FlatBlocks)
+{
+	const uint8_t colors[][4] = { { 0, 0, 0, 0 }, { 255, 255, 255, 255 }, { 200, 100, 50, 128 }, { 13, 77, 191, 3 } };
+	for (const uint8_t *color : colors)
+	{
+		uint8_t pixels[64], block[16], decoded[64];
+		for (UINT i = 0; i < 16; ++i)
+			memcpy(&pixels[i * 4], color, 4);
+		for (UINT f = 0; f < 4; ++f)
+		{
+			BlockCompressor::CompressBlock(gFormats[f], pixels, block);
+			BlockCompressor::DecompressBlock(gFormats[f], block, decoded);
+			// 5:6:5 colors in BC1 and BC3, 7 bits and a shared bit in BC7
+			int tolerance = (f == 3) ? 1 : ((f == 2) ? 0 : 4);
+			UINT channelCount = (f == 2) ? 2 : ((f == 0) ? 3 : 4);
+			for (UINT i = 0; i < 16; ++i)
+			{
+				for (UINT ch = 0; ch < channelCount; ++ch)
+					CHECK(abs(decoded[i * 4 + ch] - color[ch]) <= ((ch == 3 && f == 1) ? 0 : tolerance));
+			}
+		}
+	}
+}
+
+// Quality of every format on a synthetic image and on a texture of the app.
+TEST(BlockCompressor_PSNR)
+{
+	Image image = CreateTestImage(256, 256);
+	// Lower bounds, the encoder gets about 2 dB more than these
+	const double minimumPSNR[4] = { 35.0, 36.0, 50.0, 36.5 };
+	const UINT channelEnds[4] = { 3, 4, 2, 4 };
+	double psnr[4];
+	for (UINT f = 0; f < 4; ++f)
+	{
+		psnr[f] = GetPSNR(image, RoundTrip(gFormats[f], image), 0, channelEnds[f]);
+		TestRegistry::ReportValue(gFormatNames[f], psnr[f], "dB");
+		CHECK(psnr[f] > minimumPSNR[f]);
+	}
+	CHECK(GetPSNR(image, RoundTrip(BlockCompressionFormat::BC7, image), 0, 3) > psnr[0]);
+	// The alpha of BC3 on its own
+	double alphaPSNR = GetPSNR(image, RoundTrip(BlockCompressionFormat::BC3, image), 3, 4);
+	TestRegistry::ReportValue("BC3 alpha", alphaPSNR, "dB");
+	CHECK(alphaPSNR > 50.0);
+
+	// The texture was BC1 already, so every block of it can be stored again without loss
+	Image texture;
+	CHECK(LoadAppTexture(&texture));
+	if (texture.rgba.empty())
+		return;
+	double texturePSNR = GetPSNR(texture, RoundTrip(BlockCompressionFormat::BC1, texture), 0, 3);
+	TestRegistry::ReportValue("BC1 of the albedo texture", texturePSNR, "dB");
+	CHECK(texturePSNR > 60.0);
+	texturePSNR = GetPSNR(texture, RoundTrip(BlockCompressionFormat::BC7, texture), 0, 3);
+	TestRegistry::ReportValue("BC7 of the albedo texture", texturePSNR, "dB");
+	CHECK(texturePSNR > 50.0);
+}
+
+// Blocks over the edges repeat the edge pixels, the worker pool gives the same blocks.
+TEST(BlockCompressor_EdgesAndWorkerPool)
+{
+	Image image = CreateTestImage(6, 5);
+	vector<uint8_t> blocks(BlockCompressor::GetCompressedSize(BlockCompressionFormat::BC7, 6, 5));
+	CHECK(blocks.size() == 4 * 16);
+	BlockCompressor::Compress(BlockCompressionFormat::BC7, image.rgba.data(), 6, 5, 6 * 4, nullptr, blocks.data());
+
+	// The last block, gathered by hand
+	uint8_t pixels[64], block[16];
+	for (UINT y = 0; y < 4; ++y)
+		for (UINT x = 0; x < 4; ++x)
+			memcpy(&pixels[(y * 4 + x) * 4], &image.rgba[(min(4 + y, 4U) * 6 + min(4 + x, 5U)) * 4], 4);
+	BlockCompressor::CompressBlock(BlockCompressionFormat::BC7, pixels, block);
+	CHECK(memcmp(block, &blocks[3 * 16], 16) == 0);
+
+	Image large = CreateTestImage(512, 256);
+	WorkerPool workerPool;
+	for (BlockCompressionFormat format : gFormats)
+	{
+		size_t size = BlockCompressor::GetCompressedSize(format, large.width, large.height);
+		vector<uint8_t> serial(size), parallel(size);
+		BlockCompressor::Compress(format, large.rgba.data(), large.width, large.height, large.width * 4, nullptr, serial.data());
+		BlockCompressor::Compress(format, large.rgba.data(), large.width, large.height, large.width * 4, &workerPool, parallel.data());
+		CHECK(serial == parallel);
+	}
+}
+
+BENCHMARK(BlockCompressor_Throughput)
+{
+	Image image = CreateTestImage(1024, 1024);
+	WorkerPool workerPool;
+	double megapixels = image.width * image.height / 1e6;
+	for (UINT f = 0; f < 4; ++f)
+	{
+		vector<uint8_t> blocks(BlockCompressor::GetCompressedSize(gFormats[f], image.width, image.height));
+		double serial = MeasureMilliseconds(3, [&]()
+		{
+			BlockCompressor::Compress(gFormats[f], image.rgba.data(), image.width, image.height, image.width * 4, nullptr, blocks.data());
+		});
+		double parallel = MeasureMilliseconds(3, [&]()
+		{
+			BlockCompressor::Compress(gFormats[f], image.rgba.data(), image.width, image.height, image.width * 4, &workerPool, blocks.data());
+		});
+		TestRegistry::ReportValue(gFormatNames[f], megapixels * 1000.0 / serial, "MPixel/s");
+		TestRegistry::ReportValue(string(gFormatNames[f]) + " with the worker pool", megapixels * 1000.0 / parallel, "MPixel/s");
+	}
+}
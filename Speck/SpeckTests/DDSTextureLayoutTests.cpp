@@ -0,0 +1,263 @@
+#include "TestFramework.h"
+#include <DDSTextureLayout.h>
+#include <cstring>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	// Words of the header of a synthetic DDS file, see DDS_HEADER and DDS_PIXELFORMAT.
+	enum HeaderWord
+	{
+		Magic = 0,
+		Size = 1,
+		Flags = 2,
+		Height = 3,
+		Width = 4,
+		Depth = 6,
+		MipMapCount = 7,
+		PixelFormatSize = 19,
+		PixelFormatFlags = 20,
+		FourCC = 21,
+		RGBBitCount = 22,
+		RBitMask = 23,
+		GBitMask = 24,
+		BBitMask = 25,
+		ABitMask = 26,
+		Caps2 = 28,
+		HeaderWordCount = 32
+	};
+
+	const uint32_t gFlagsVolume = 0x00800000;
+	const uint32_t gCubeMapAllFaces = 0x0000fe00;
+
+	uint32_t MakeFourCC(const char *code)
+	{
+		return (uint32_t)(uint8_t)code[0] | ((uint32_t)(uint8_t)code[1] << 8) | ((uint32_t)(uint8_t)code[2] << 16) | ((uint32_t)(uint8_t)code[3] << 24);
+	}
+
+	// Header of a 2D texture in a format given by a FourCC code.
+	vector<uint32_t> CreateHeader(uint32_t width, uint32_t height, uint32_t mipCount, const char *fourCC)
+	{
+		vector<uint32_t> words(HeaderWordCount, 0);
+		words[Magic] = 0x20534444;
+		words[Size] = 124;
+		words[Flags] = 0x1007 | (mipCount > 1 ? 0x20000 : 0); // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT, DDSD_MIPMAPCOUNT
+		words[Height] = height;
+		words[Width] = width;
+		words[MipMapCount] = mipCount;
+		words[PixelFormatSize] = 32;
+		words[PixelFormatFlags] = 0x4; // DDPF_FOURCC
+		words[FourCC] = MakeFourCC(fourCC);
+		return words;
+	}
+
+	// Header of a 2D texture in the R8G8B8A8_UNORM format, without the DX10 header.
+	vector<uint32_t> CreateRGBAHeader(uint32_t width, uint32_t height, uint32_t mipCount)
+	{
+		vector<uint32_t> words = CreateHeader(width, height, mipCount, "\0\0\0\0");
+		words[PixelFormatFlags] = 0x41; // DDPF_RGB | DDPF_ALPHAPIXELS
+		words[RGBBitCount] = 32;
+		words[RBitMask] = 0x000000ff;
+		words[GBitMask] = 0x0000ff00;
+		words[BBitMask] = 0x00ff0000;
+		words[ABitMask] = 0xff000000;
+		return words;
+	}
+
+	// Header followed by the DX10 header, see DDS_HEADER_DXT10.
+	vector<uint32_t> CreateDX10Header(uint32_t width, uint32_t height, uint32_t mipCount, DXGI_FORMAT format, DDSDimension dimension,
+		uint32_t arraySize, uint32_t miscFlag = 0, uint32_t miscFlags2 = 0)
+	{
+		vector<uint32_t> words = CreateHeader(width, height, mipCount, "DX10");
+		words.insert(words.end(), { (uint32_t)format, (uint32_t)dimension, miscFlag, arraySize, miscFlags2 });
+		return words;
+	}
+
+	// The headers followed by dataSize bytes of data, every byte is different from the ones next to it.
+	vector<uint8_t> CreateDDSFile(const vector<uint32_t> &words, size_t dataSize)
+	{
+		vector<uint8_t> file(words.size() * sizeof(uint32_t) + dataSize);
+		memcpy(file.data(), words.data(), words.size() * sizeof(uint32_t));
+		for (size_t i = words.size() * sizeof(uint32_t); i < file.size(); ++i)
+			file[i] = (uint8_t)(i * 7);
+		return file;
+	}
+
+	bool Parse(const vector<uint8_t> &file, DDSTextureLayout *outLayout)
+	{
+		return DDSTextureLayout::Parse(file.data(), file.size(), outLayout);
+	}
+
+	// The subresources follow each other without gaps up to the end of the file.
+	bool AreContiguous(const DDSTextureLayout &layout, const vector<uint8_t> &file, size_t headerSize)
+	{
+		const uint8_t *expected = file.data() + headerSize;
+		for (const DDSSubresource &subresource : layout.subresources)
+		{
+			if (subresource.data != expected)
+				return false;
+			expected += subresource.slicePitch * subresource.depth;
+		}
+		return expected == file.data() + file.size();
+	}
+
+	// Sizes of the mips of a 256x128 BC1 texture, the blocks are 4x4 texels and 8 bytes.
+	const size_t gBC1MipSizes[] = { 16384, 4096, 1024, 256, 64, 16, 8, 8, 8 };
+	const size_t gBC1DataSize = 21864;
+}
+
+TEST(DDSTextureLayout_BC1Mips)
+{
+	vector<uint8_t> file = CreateDDSFile(CreateHeader(256, 128, 9, "DXT1"), gBC1DataSize);
+	DDSTextureLayout layout;
+	CHECK(Parse(file, &layout));
+	CHECK(layout.dimension == DDSDimension::Texture2D);
+	CHECK(layout.format == DXGI_FORMAT_BC1_UNORM);
+	CHECK(layout.width == 256 && layout.height == 128 && layout.depth == 1);
+	CHECK(layout.mipCount == 9 && layout.arraySize == 1);
+	CHECK(!layout.isCubeMap);
+	CHECK(layout.alphaMode == DDSAlphaMode::Unknown);
+	CHECK(layout.subresources.size() == 9);
+	CHECK(AreContiguous(layout, file, HeaderWordCount * sizeof(uint32_t)));
+
+	for (size_t mip = 0; mip < layout.subresources.size(); ++mip)
+	{
+		const DDSSubresource &subresource = layout.GetSubresource(0, mip);
+		CHECK(subresource.slicePitch == gBC1MipSizes[mip]);
+		CHECK(layout.GetMipSize(mip) == gBC1MipSizes[mip]);
+		CHECK(subresource.width == max<size_t>(256 >> mip, 1) && subresource.height == max<size_t>(128 >> mip, 1));
+	}
+	CHECK(layout.GetSubresource(0, 0).rowPitch == 64 * 8);
+	CHECK(layout.GetSubresource(0, 8).rowPitch == 8);
+}
+
+// Rows are rounded up to whole blocks and whole bytes.
+TEST(DDSTextureLayout_Pitches)
+{
+	DDSTextureLayout layout;
+	CHECK(Parse(CreateDDSFile(CreateHeader(5, 3, 1, "DXT5"), 2 * 16), &layout));
+	CHECK(layout.format == DXGI_FORMAT_BC3_UNORM);
+	CHECK(layout.GetSubresource(0, 0).rowPitch == 2 * 16 && layout.GetSubresource(0, 0).slicePitch == 2 * 16);
+
+	CHECK(Parse(CreateDDSFile(CreateRGBAHeader(5, 3, 2), 5 * 3 * 4 + 2 * 1 * 4), &layout));
+	CHECK(layout.format == DXGI_FORMAT_R8G8B8A8_UNORM);
+	CHECK(layout.GetSubresource(0, 0).rowPitch == 20 && layout.GetSubresource(0, 0).slicePitch == 60);
+	CHECK(layout.GetSubresource(0, 1).rowPitch == 8 && layout.GetSubresource(0, 1).slicePitch == 8);
+
+	CHECK(Parse(CreateDDSFile(CreateDX10Header(9, 1, 1, DXGI_FORMAT_R1_UNORM, DDSDimension::Texture2D, 1), 2), &layout));
+	CHECK(layout.GetSubresource(0, 0).rowPitch == 2);
+}
+
+// All the mips of the first item come before the ones of the next item.
+TEST(DDSTextureLayout_DX10Array)
+{
+	const size_t headerSize = (HeaderWordCount + 5) * sizeof(uint32_t);
+	// 8x8 and 4x4, one and two blocks of 16 bytes
+	vector<uint8_t> file = CreateDDSFile(CreateDX10Header(8, 8, 2, DXGI_FORMAT_BC7_UNORM_SRGB, DDSDimension::Texture2D, 3, 0, 2), 3 * (64 + 16));
+	DDSTextureLayout layout;
+	CHECK(Parse(file, &layout));
+	CHECK(layout.format == DXGI_FORMAT_BC7_UNORM_SRGB);
+	CHECK(layout.arraySize == 3 && layout.mipCount == 2);
+	CHECK(layout.alphaMode == DDSAlphaMode::Premultiplied);
+	CHECK(AreContiguous(layout, file, headerSize));
+	CHECK(layout.GetSubresource(1, 0).data == layout.GetSubresource(0, 1).data + 16);
+	CHECK(layout.GetSubresource(2, 1).data == file.data() + headerSize + 2 * 80 + 64);
+	CHECK(layout.GetMipSize(0) == 3 * 64);
+	CHECK(layout.GetMipSize(1) == 3 * 16);
+}
+
+TEST(DDSTextureLayout_CubeMaps)
+{
+	DDSTextureLayout layout;
+	vector<uint32_t> words = CreateRGBAHeader(4, 4, 1);
+	words[Caps2] = gCubeMapAllFaces;
+	vector<uint8_t> file = CreateDDSFile(words, 6 * 64);
+	CHECK(Parse(file, &layout));
+	CHECK(layout.isCubeMap && layout.arraySize == 6);
+	CHECK(AreContiguous(layout, file, HeaderWordCount * sizeof(uint32_t)));
+
+	// Cube maps with some of the faces are not supported
+	words[Caps2] = 0x00000600;
+	CHECK(!Parse(CreateDDSFile(words, 6 * 64), &layout));
+
+	// Two cubes in the DX10 header
+	file = CreateDDSFile(CreateDX10Header(4, 4, 1, DXGI_FORMAT_R8G8B8A8_UNORM, DDSDimension::Texture2D, 2, 0x4), 12 * 64);
+	CHECK(Parse(file, &layout));
+	CHECK(layout.isCubeMap && layout.arraySize == 12);
+}
+
+// The slices of the volume mips shrink with them.
+TEST(DDSTextureLayout_Volume)
+{
+	vector<uint32_t> words = CreateRGBAHeader(16, 16, 2);
+	words[Flags] |= gFlagsVolume;
+	words[Depth] = 8;
+	vector<uint8_t> file = CreateDDSFile(words, 16 * 16 * 4 * 8 + 8 * 8 * 4 * 4);
+	DDSTextureLayout layout;
+	CHECK(Parse(file, &layout));
+	CHECK(layout.dimension == DDSDimension::Texture3D);
+	CHECK(layout.depth == 8 && layout.GetSubresource(0, 1).depth == 4);
+	CHECK(layout.GetMipSize(1) == 8 * 8 * 4 * 4);
+	CHECK(AreContiguous(layout, file, HeaderWordCount * sizeof(uint32_t)));
+
+	// Volumes need the flag
+	CHECK(!Parse(CreateDDSFile(CreateDX10Header(16, 16, 1, DXGI_FORMAT_R8G8B8A8_UNORM, DDSDimension::Texture3D, 1), 16 * 16 * 4), &layout));
+}
+
+TEST(DDSTextureLayout_RejectsInvalidFiles)
+{
+	DDSTextureLayout layout;
+	const vector<uint8_t> valid = CreateDDSFile(CreateHeader(256, 128, 9, "DXT1"), gBC1DataSize);
+	CHECK(Parse(valid, &layout));
+
+	// Truncated anywhere
+	for (size_t size : { valid.size() - 1, valid.size() - 8, valid.size() / 2, HeaderWordCount * sizeof(uint32_t), (size_t)100, (size_t)4, (size_t)0 })
+		CHECK(!DDSTextureLayout::Parse(valid.data(), size, &layout));
+	CHECK(!DDSTextureLayout::Parse(nullptr, valid.size(), &layout));
+	CHECK(Parse(CreateDDSFile(CreateDX10Header(4, 4, 1, DXGI_FORMAT_BC1_UNORM, DDSDimension::Texture2D, 1), 8), &layout));
+	CHECK(!Parse(CreateDDSFile(CreateHeader(4, 4, 1, "DX10"), 8), &layout));
+
+	auto parsesWith = [&](HeaderWord word, uint32_t value)
+	{
+		vector<uint8_t> file = valid;
+		memcpy(file.data() + word * sizeof(uint32_t), &value, sizeof(uint32_t));
+		return Parse(file, &layout);
+	};
+	CHECK(!parsesWith(Magic, MakeFourCC("DDS?")));
+	CHECK(!parsesWith(Size, 128));
+	CHECK(!parsesWith(PixelFormatSize, 24));
+	CHECK(!parsesWith(FourCC, MakeFourCC("ABCD")));
+	CHECK(!parsesWith(Width, 0));
+	// More mips than down to 1x1, more than the hardware supports, and a size larger than it supports
+	CHECK(!parsesWith(MipMapCount, 10));
+	CHECK(!parsesWith(MipMapCount, 16));
+	CHECK(!parsesWith(Width, 32768));
+
+	// DX10 headers
+	CHECK(!Parse(CreateDDSFile(CreateDX10Header(4, 4, 1, DXGI_FORMAT_BC1_UNORM, DDSDimension::Texture2D, 0), 8), &layout));
+	CHECK(!Parse(CreateDDSFile(CreateDX10Header(4, 4, 1, DXGI_FORMAT_P8, DDSDimension::Texture2D, 1), 16), &layout));
+	CHECK(!Parse(CreateDDSFile(CreateDX10Header(4, 4, 1, DXGI_FORMAT_UNKNOWN, DDSDimension::Texture2D, 1), 64), &layout));
+	CHECK(!Parse(CreateDDSFile(CreateDX10Header(4, 4, 1, DXGI_FORMAT_BC1_UNORM, DDSDimension::Unknown, 1), 8), &layout));
+	CHECK(!Parse(CreateDDSFile(CreateDX10Header(4, 4, 1, DXGI_FORMAT_BC1_UNORM, DDSDimension::Texture2D, 4096), 4096 * 8), &layout));
+	CHECK(!Parse(CreateDDSFile(CreateDX10Header(4, 2, 1, DXGI_FORMAT_R8_UNORM, DDSDimension::Texture1D, 1), 8), &layout));
+	CHECK(Parse(CreateDDSFile(CreateDX10Header(4, 1, 1, DXGI_FORMAT_R8_UNORM, DDSDimension::Texture1D, 1), 4), &layout));
+	CHECK(layout.dimension == DDSDimension::Texture1D);
+}
+
+// Only the given number of the smallest mips is loaded up front, the rest is streamed.
+TEST(DDSTextureLayout_ResidentMips)
+{
+	vector<uint8_t> file = CreateDDSFile(CreateHeader(256, 128, 9, "DXT1"), gBC1DataSize);
+	DDSTextureLayout layout;
+	CHECK(Parse(file, &layout));
+	CHECK(layout.GetFirstResidentMip(0) == 0);
+	CHECK(layout.GetFirstResidentMip(3) == 6);
+	CHECK(layout.GetFirstResidentMip(8) == 1);
+	CHECK(layout.GetFirstResidentMip(9) == 0);
+	CHECK(layout.GetFirstResidentMip(20) == 0);
+	CHECK(layout.GetResidentSize(0) == gBC1DataSize);
+	CHECK(layout.GetResidentSize(6) == 3 * 8);
+	CHECK(layout.GetResidentSize(9) == 0);
+}
@@ -0,0 +1,105 @@
+#include "TestFramework.h"
+#include <DrawList.h>
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	// Keys of items spread over a few PSOs, materials and geometries, with many of the same key.
+	void AddRandomItems(DrawList *drawList, UINT count, UINT depths, unsigned int seed)
+	{
+		mt19937 random(seed);
+		uniform_int_distribution<UINT> pso(0, 2), material(0, 63), geometry(0, 39), depth(0, depths - 1);
+		for (UINT i = 0; i < count; ++i)
+		{
+			RenderItemHandle item;
+			item.Kind = RenderItemKind::Static;
+			item.Index = i;
+			drawList->Add(DrawList::MakeKey(pso(random), material(random), geometry(random), (float)depth(random) / depths), item);
+		}
+	}
+
+	vector<pair<UINT64, UINT>> GetEntries(const DrawList &drawList)
+	{
+		vector<pair<UINT64, UINT>> entries;
+		for (size_t i = 0; i < drawList.GetCount(); ++i)
+			entries.push_back(make_pair(drawList.GetKey(i), drawList.GetItem(i).Index));
+		return entries;
+	}
+}
+
+// The fields are ordered from the PSO to the depth, cut to their bits and the depth is clamped.
+TEST(DrawList_MakeKey)
+{
+	CHECK(DrawList::MakeKey(1, 0, 0, 0.0f) > DrawList::MakeKey(0, 65535, 65535, 1.0f));
+	CHECK(DrawList::MakeKey(0, 1, 0, 0.0f) > DrawList::MakeKey(0, 0, 65535, 1.0f));
+	CHECK(DrawList::MakeKey(0, 0, 1, 0.0f) > DrawList::MakeKey(0, 0, 0, 1.0f));
+	CHECK(DrawList::MakeKey(0, 0, 0, 0.6f) > DrawList::MakeKey(0, 0, 0, 0.5f));
+
+	CHECK(DrawList::GetPSOIndex(DrawList::MakeKey(7, 3, 5, 0.5f)) == 7);
+	CHECK(DrawList::GetPSOIndex(DrawList::MakeKey(256 + 7, 3, 5, 0.5f)) == 7);
+	CHECK(DrawList::MakeKey(2, 65536 + 3, 65536 + 5, 0.5f) == DrawList::MakeKey(2, 3, 5, 0.5f));
+	CHECK(DrawList::MakeKey(2, 3, 5, -1.0f) == DrawList::MakeKey(2, 3, 5, 0.0f));
+	CHECK(DrawList::MakeKey(2, 3, 5, 2.0f) == DrawList::MakeKey(2, 3, 5, 1.0f));
+}
+
+// The keys end up in increasing order and the items with the same key keep the order they were added in.
+TEST(DrawList_SortIsStable)
+{
+	for (UINT count : { 0U, 1U, 2U, 100U, 20000U })
+	{
+		DrawList drawList;
+		AddRandomItems(&drawList, count, 4, count);
+		vector<pair<UINT64, UINT>> expected = GetEntries(drawList);
+		stable_sort(expected.begin(), expected.end(), [](const pair<UINT64, UINT> &a, const pair<UINT64, UINT> &b) { return a.first < b.first; });
+
+		drawList.Sort();
+		CHECK(GetEntries(drawList) == expected);
+	}
+
+	// The same key everywhere, all the passes are skipped
+	DrawList drawList;
+	for (UINT i = 0; i < 10; ++i)
+		drawList.Add(DrawList::MakeKey(1, 2, 3, 0.5f), RenderItemHandle{ RenderItemKind::Static, 9 - i });
+	drawList.Sort();
+	for (UINT i = 0; i < 10; ++i)
+		CHECK(drawList.GetItem(i).Index == 9 - i);
+
+	// Sorting again after clearing reuses the list
+	drawList.Clear();
+	CHECK(drawList.GetCount() == 0);
+	AddRandomItems(&drawList, 1000, 1000, 7);
+	drawList.Sort();
+	for (size_t i = 1; i < drawList.GetCount(); ++i)
+		CHECK(drawList.GetKey(i - 1) <= drawList.GetKey(i));
+}
+
+// Keys of 20k items with distinct depths, the radix sort against std::stable_sort.
+BENCHMARK(DrawList_Sort)
+{
+	const UINT count = 20000;
+	DrawList source;
+	AddRandomItems(&source, count, 1 << 20, 1);
+	vector<pair<UINT64, UINT>> entries = GetEntries(source);
+
+	DrawList drawList;
+	double radix = MeasureMilliseconds(20, [&]()
+	{
+		drawList.Clear();
+		for (const pair<UINT64, UINT> &entry : entries)
+			drawList.Add(entry.first, RenderItemHandle{ RenderItemKind::Static, entry.second });
+		drawList.Sort();
+	});
+	vector<pair<UINT64, UINT>> sorted;
+	double reference = MeasureMilliseconds(20, [&]()
+	{
+		sorted = entries;
+		stable_sort(sorted.begin(), sorted.end(), [](const pair<UINT64, UINT> &a, const pair<UINT64, UINT> &b) { return a.first < b.first; });
+	});
+	TestRegistry::ReportValue("Radix sort of " + to_string(count) + " keys", radix * 1000.0, "us");
+	TestRegistry::ReportValue("std::stable_sort of " + to_string(count) + " keys", reference * 1000.0, "us");
+	CHECK(GetEntries(drawList) == sorted);
+}
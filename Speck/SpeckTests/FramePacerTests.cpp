@@ -0,0 +1,142 @@
+#include "TestFramework.h"
+#include <FramePacer.h>
+#include <MetricsSampler.h>
+#include <random>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	typedef chrono::steady_clock Clock;
+
+	double GetMilliseconds(Clock::duration duration)
+	{
+		return chrono::duration<double, milli>(duration).count();
+	}
+
+	void SpinUntil(Clock::time_point deadline)
+	{
+		while (Clock::now() < deadline)
+			;
+	}
+
+	// Frames of a limited frame rate with some work in each, the rest of the frame is waited for by the function.
+	// Returns the frame times in milliseconds and the CPU time of the process over all the frames.
+	template <typename WaitFunction>
+	vector<double> RunFrames(UINT frameCount, double frameTime, WaitFunction wait, double *outCpuTime)
+	{
+		mt19937 random(1);
+		uniform_real_distribution<double> workTime(0.25 * frameTime, 0.5 * frameTime);
+		MetricsSampler sampler(1);
+		vector<double> frameTimes;
+		Clock::time_point frameStart = Clock::now();
+		for (UINT frame = 0; frame < frameCount; ++frame)
+		{
+			SpinUntil(frameStart + chrono::duration_cast<Clock::duration>(chrono::duration<double>(workTime(random))));
+			double elapsed = chrono::duration<double>(Clock::now() - frameStart).count();
+			if (elapsed < frameTime)
+				wait(frameTime - elapsed);
+
+			Clock::time_point frameEnd = Clock::now();
+			frameTimes.push_back(GetMilliseconds(frameEnd - frameStart));
+			frameStart = frameEnd;
+		}
+		sampler.Sample(0.0);
+		vector<MetricSummary> summary;
+		sampler.GetSummary(&summary);
+		*outCpuTime = summary[(UINT)Metric::CpuTime].Last;
+		sort(frameTimes.begin(), frameTimes.end());
+		return frameTimes;
+	}
+
+	double Percentile(const vector<double> &sortedValues, double percentile)
+	{
+		size_t rank = (size_t)ceil(percentile * sortedValues.size());
+		return sortedValues[max(rank, (size_t)1) - 1];
+	}
+}
+
+// A wait never ends early, the stats count every wait in one histogram bucket.
+TEST(FramePacer_Wait)
+{
+	FramePacer pacer;
+	FramePacingStats stats;
+	pacer.GetStats(&stats);
+	CHECK(stats.Waits == 0 && stats.MaxError == 0.0);
+	CHECK(stats.SpinThreshold >= 50.0 && stats.SpinThreshold <= 4000.0);
+
+	Clock::time_point start = Clock::now();
+	for (UINT i = 0; i < 20; ++i)
+	{
+		Clock::time_point waitStart = Clock::now();
+		pacer.Wait(2e-3);
+		CHECK(GetMilliseconds(Clock::now() - waitStart) >= 2.0);
+	}
+	double total = chrono::duration<double>(Clock::now() - start).count();
+
+	pacer.GetStats(&stats);
+	UINT64 histogramWaits = 0;
+	for (UINT64 count : stats.Histogram)
+		histogramWaits += count;
+	CHECK(stats.Waits == 20 && histogramWaits == 20);
+	CHECK(stats.MeanError >= 0.0 && stats.MeanError <= stats.MaxError);
+	CHECK(stats.SleepTime > 0.0 && stats.SpinTime > 0.0 && stats.SleepTime + stats.SpinTime <= total);
+	CHECK(stats.SpinThreshold >= 50.0 && stats.SpinThreshold <= 4000.0);
+
+	pacer.ClearStats();
+	pacer.GetStats(&stats);
+	CHECK(stats.Waits == 0 && stats.MeanError == 0.0 && stats.SleepTime == 0.0 && stats.Histogram[0] == 0);
+
+	// Nothing to wait for
+	pacer.Wait(0.0);
+	pacer.GetStats(&stats);
+	CHECK(stats.Waits == 1 && stats.SleepTime == 0.0);
+}
+
+// The buckets grow and the last one has no end.
+TEST(FramePacer_HistogramBuckets)
+{
+	for (UINT bucket = 1; bucket < FramePacingStats::HistogramBucketCount; ++bucket)
+		CHECK(FramePacer::GetHistogramBucketEnd(bucket) > FramePacer::GetHistogramBucketEnd(bucket - 1));
+	CHECK(FramePacer::GetHistogramBucketEnd(0) == 10.0);
+	CHECK(isinf(FramePacer::GetHistogramBucketEnd(FramePacingStats::HistogramBucketCount - 1)));
+}
+
+// 300 frames limited to 60 Hz, each with 4 to 8 ms of work: the pacer against spinning for the rest of the frame,
+// as the timer did before. The CPU use is of one core.
+BENCHMARK(FramePacer_Frames)
+{
+	const UINT frameCount = 300;
+	const double frameTime = 1.0 / 60.0;
+	double spinCpuTime = 0.0, pacerCpuTime = 0.0;
+	vector<double> spinFrames = RunFrames(frameCount, frameTime, [](double seconds)
+	{
+		SpinUntil(Clock::now() + chrono::duration_cast<Clock::duration>(chrono::duration<double>(seconds)));
+	}, &spinCpuTime);
+
+	FramePacer pacer;
+	vector<double> pacerFrames = RunFrames(frameCount, frameTime, [&](double seconds) { pacer.Wait(seconds); }, &pacerCpuTime);
+
+	double totalTime = frameCount * frameTime * 1000.0;
+	TestRegistry::ReportValue("Spin p50", Percentile(spinFrames, 0.5), "ms");
+	TestRegistry::ReportValue("Spin p99", Percentile(spinFrames, 0.99), "ms");
+	TestRegistry::ReportValue("Spin CPU", 100.0 * spinCpuTime / totalTime, "%");
+	TestRegistry::ReportValue("Pacer p50", Percentile(pacerFrames, 0.5), "ms");
+	TestRegistry::ReportValue("Pacer p99", Percentile(pacerFrames, 0.99), "ms");
+	TestRegistry::ReportValue("Pacer CPU", 100.0 * pacerCpuTime / totalTime, "%");
+
+	FramePacingStats stats;
+	pacer.GetStats(&stats);
+	TestRegistry::ReportValue("Pacer mean error", stats.MeanError, "us");
+	TestRegistry::ReportValue("Pacer max error", stats.MaxError, "us");
+	TestRegistry::ReportValue("Spin threshold", stats.SpinThreshold, "us");
+	for (UINT bucket = 0; bucket < FramePacingStats::HistogramBucketCount; ++bucket)
+	{
+		string name = (bucket < FramePacingStats::HistogramBucketCount - 1) ?
+			"Waits off by up to " + to_string((UINT)FramePacer::GetHistogramBucketEnd(bucket)) + " us" :
+			"Waits off by more than " + to_string((UINT)FramePacer::GetHistogramBucketEnd(bucket - 1)) + " us";
+		TestRegistry::ReportValue(name, (double)stats.Histogram[bucket], "waits");
+	}
+	CHECK(stats.Waits == frameCount);
+}
@@ -0,0 +1,143 @@
+#include "TestFramework.h"
+#include <FrustumCuller.h>
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	BoundingFrustum CreateFrustum(const XMFLOAT3 &eye, const XMFLOAT3 &target, float fovY, float farZ)
+	{
+		BoundingFrustum frustum;
+		BoundingFrustum::CreateFromMatrix(frustum, XMMatrixPerspectiveFovLH(fovY, 16.0f / 9.0f, 0.1f, farZ));
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+		return frustum;
+	}
+
+	// Boxes scattered in a cube of the given size, from small props to large buildings.
+	vector<BoundingBox> CreateBoxes(UINT count, float size, unsigned int seed)
+	{
+		mt19937 random(seed);
+		uniform_real_distribution<float> position(-0.5f * size, 0.5f * size);
+		uniform_real_distribution<float> extent(0.1f, 5.0f);
+		vector<BoundingBox> boxes(count);
+		for (BoundingBox &box : boxes)
+		{
+			box.Center = XMFLOAT3(position(random), position(random), position(random));
+			box.Extents = XMFLOAT3(extent(random), extent(random), extent(random));
+		}
+		return boxes;
+	}
+
+	// The test the culler does four boxes at a time, one box at a time.
+	vector<UINT> CullReference(const vector<BoundingBox> &boxes, const BoundingFrustum &frustum)
+	{
+		XMVECTOR planes[6];
+		frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+		vector<UINT> visible;
+		for (UINT i = 0; i < boxes.size(); ++i)
+		{
+			if (boxes[i].ContainedBy(planes[0], planes[1], planes[2], planes[3], planes[4], planes[5]) != DISJOINT)
+				visible.push_back(i);
+		}
+		return visible;
+	}
+}
+
+// The same boxes as the scalar test of DirectXMath, in increasing order, for item counts that are not a multiple of four.
+TEST(FrustumCuller_MatchesReference)
+{
+	for (UINT count : { 1U, 7U, 1000U, 4099U })
+	{
+		vector<BoundingBox> boxes = CreateBoxes(count, 200.0f, count);
+		FrustumCuller culler;
+		culler.Resize(count);
+		for (UINT i = 0; i < count; ++i)
+			culler.SetBounds(i, boxes[i]);
+
+		vector<UINT> visible;
+		for (UINT view = 0; view < 8; ++view)
+		{
+			float angle = XM_2PI * view / 8;
+			BoundingFrustum frustum = CreateFrustum(XMFLOAT3(0.0f, 10.0f, 0.0f), XMFLOAT3(cosf(angle), 10.0f - view, sinf(angle)), XM_PIDIV4, 80.0f);
+			culler.Cull(frustum, &visible);
+			CHECK(visible == CullReference(boxes, frustum));
+		}
+	}
+}
+
+// New items and the ones without bounds are never culled, the padding is never output.
+TEST(FrustumCuller_AlwaysVisible)
+{
+	BoundingFrustum frustum = CreateFrustum(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XM_PIDIV4, 100.0f);
+	BoundingBox behind(XMFLOAT3(0.0f, 0.0f, -50.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	BoundingBox inside(XMFLOAT3(0.0f, 0.0f, 50.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	BoundingBox acrossFarPlane(XMFLOAT3(0.0f, 0.0f, 100.5f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	BoundingBox beyondFarPlane(XMFLOAT3(0.0f, 0.0f, 102.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+
+	FrustumCuller culler;
+	culler.Resize(3);
+	CHECK(culler.GetCount() == 3);
+	vector<UINT> visible;
+	culler.Cull(frustum, &visible);
+	CHECK(visible == vector<UINT>({ 0, 1, 2 }));
+
+	BoundingBox bounds;
+	CHECK(!culler.GetBounds(0, &bounds));
+	culler.SetBounds(0, behind);
+	culler.SetBounds(1, inside);
+	CHECK(culler.GetBounds(0, &bounds) && bounds.Center.z == -50.0f && bounds.Extents.x == 1.0f);
+	culler.Cull(frustum, &visible);
+	CHECK(visible == vector<UINT>({ 1, 2 }));
+
+	// Growing keeps the old bounds, the new items are visible until they get theirs
+	culler.Resize(6);
+	culler.SetBounds(2, acrossFarPlane);
+	culler.SetBounds(3, beyondFarPlane);
+	culler.Cull(frustum, &visible);
+	CHECK(visible == vector<UINT>({ 1, 2, 4, 5 }));
+	culler.SetAlwaysVisible(0);
+	culler.Cull(frustum, &visible);
+	CHECK(visible == vector<UINT>({ 0, 1, 2, 4, 5 }));
+
+	// Shrinking and growing again forgets the bounds of the removed items
+	culler.Resize(2);
+	culler.Cull(frustum, &visible);
+	CHECK(visible == vector<UINT>({ 0, 1 }));
+	culler.Resize(4);
+	CHECK(!culler.GetBounds(3, &bounds));
+	culler.Cull(frustum, &visible);
+	CHECK(visible == vector<UINT>({ 0, 1, 2, 3 }));
+}
+
+// Boxes in a 1000 unit cube, the batched test against the scalar one of every item.
+BENCHMARK(FrustumCuller_Items)
+{
+	for (UINT count : { 10000U, 30000U, 100000U })
+	{
+		vector<BoundingBox> boxes = CreateBoxes(count, 1000.0f, 1);
+		FrustumCuller culler;
+		culler.Resize(count);
+		for (UINT i = 0; i < count; ++i)
+			culler.SetBounds(i, boxes[i]);
+
+		BoundingFrustum frustum = CreateFrustum(XMFLOAT3(0.0f, 0.0f, -500.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XM_PIDIV4, 1000.0f);
+		vector<UINT> visible;
+		double batched = MeasureMilliseconds(20, [&]() { culler.Cull(frustum, &visible); });
+		size_t scalarVisible = 0;
+		double scalar = MeasureMilliseconds(20, [&]()
+		{
+			scalarVisible = 0;
+			for (const BoundingBox &box : boxes)
+				scalarVisible += frustum.Intersects(box);
+		});
+		string items = to_string(count) + " items";
+		TestRegistry::ReportValue(items + " visible", (double)visible.size(), "items");
+		TestRegistry::ReportValue(items + " batched", batched * 1000.0, "us");
+		TestRegistry::ReportValue(items + " one at a time", scalar * 1000.0, "us");
+		CHECK(visible.size() == scalarVisible);
+	}
+}
@@ -0,0 +1,140 @@
+#include "TestFramework.h"
+#include <InstanceBatcher.h>
+#include <random>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	// Stand-ins for the geometries, materials and PSO groups, only their addresses are compared.
+	int gGroups[2], gGeometries[4], gMaterials[4];
+
+	InstanceBatchKey MakeKey(UINT geometry, UINT material, UINT group = 0, UINT startIndex = 0)
+	{
+		InstanceBatchKey key;
+		key.Group = &gGroups[group];
+		key.Geometry = &gGeometries[geometry];
+		key.Material = &gMaterials[material];
+		key.StartIndexLocation = startIndex;
+		return key;
+	}
+
+	// Number of the draws of the frame, one per instanced batch and one per single item.
+	UINT GetDrawCount(const InstanceBatcher &batcher)
+	{
+		return (UINT)(batcher.GetRanges().size() + batcher.GetSingles().size());
+	}
+}
+
+// Items with the same key share a batch, a change of any part of the key moves the item to another one.
+TEST(InstanceBatcher_Assign)
+{
+	InstanceBatcher batcher;
+	bool isNewBatch = false;
+	CHECK(batcher.Assign(0, MakeKey(0, 0), &isNewBatch) == 0 && isNewBatch);
+	CHECK(batcher.Assign(1, MakeKey(0, 0), &isNewBatch) == 0 && !isNewBatch);
+	CHECK(batcher.Assign(2, MakeKey(1, 0), &isNewBatch) == 1 && isNewBatch);
+	CHECK(batcher.Assign(3, MakeKey(0, 1)) == 2);
+	CHECK(batcher.Assign(4, MakeKey(0, 0, 1)) == 3);
+	CHECK(batcher.Assign(5, MakeKey(0, 0, 0, 36)) == 4);
+	CHECK(batcher.GetBatchCount() == 5);
+	CHECK(batcher.GetMemberCount(0) == 2 && batcher.GetMemberCount(1) == 1);
+
+	// Assigning the same key again changes nothing
+	CHECK(batcher.Assign(1, MakeKey(0, 0)) == 0);
+	CHECK(batcher.GetMemberCount(0) == 2);
+
+	// The item leaves its old batch, which is kept empty for the items to come
+	CHECK(batcher.Assign(2, MakeKey(0, 0)) == 0);
+	CHECK(batcher.GetMemberCount(0) == 3 && batcher.GetMemberCount(1) == 0);
+	CHECK(batcher.Assign(6, MakeKey(1, 0), &isNewBatch) == 1 && !isNewBatch);
+	CHECK(batcher.GetBatchCount() == 5);
+
+	// Items can be assigned in any order, the ones never assigned have no batch
+	CHECK(batcher.Assign(100, MakeKey(1, 0)) == 1);
+	CHECK(batcher.GetBatch(100) == 1 && batcher.GetBatch(2) == 0);
+	CHECK(batcher.GetBatch(50) == InstanceBatcher::NoBatch && batcher.GetBatch(1000) == InstanceBatcher::NoBatch);
+}
+
+// The visible items of the batches with enough of them are instanced in the order they were added, the rest are singles.
+TEST(InstanceBatcher_Gather)
+{
+	InstanceBatcher batcher;
+	batcher.Assign(0, MakeKey(0, 0));
+	batcher.Assign(1, MakeKey(1, 0));
+	batcher.Assign(2, MakeKey(0, 0));
+	batcher.Assign(3, MakeKey(2, 0));
+	batcher.Assign(4, MakeKey(0, 0));
+	batcher.Assign(5, MakeKey(2, 0));
+	batcher.Assign(6, MakeKey(1, 0));
+
+	batcher.Begin();
+	for (UINT item : { 5U, 4U, 1U, 0U, 3U, 2U })
+		CHECK(batcher.Add(item));
+	CHECK(!batcher.Add(7) && !batcher.Add(1000));
+	batcher.End();
+
+	// Batch 0 has three visible items, batch 2 two and batch 1 a single one
+	const vector<InstanceRange> &ranges = batcher.GetRanges();
+	CHECK(ranges.size() == 2);
+	CHECK(ranges[0].Batch == 0 && ranges[0].FirstInstance == 0 && ranges[0].InstanceCount == 3);
+	CHECK(ranges[1].Batch == 2 && ranges[1].FirstInstance == 3 && ranges[1].InstanceCount == 2);
+	CHECK(batcher.GetInstances() == vector<UINT>({ 4, 0, 2, 5, 3 }));
+	CHECK(batcher.GetSingles() == vector<UINT>({ 1 }));
+
+	// The next frame starts empty
+	batcher.Begin();
+	batcher.End();
+	CHECK(batcher.GetRanges().empty() && batcher.GetInstances().empty() && batcher.GetSingles().empty());
+
+	// A member that moved to another batch is gathered there
+	batcher.Assign(4, MakeKey(1, 0));
+	batcher.Begin();
+	for (UINT item = 0; item < 7; ++item)
+		batcher.Add(item);
+	batcher.End();
+	CHECK(batcher.GetRanges().size() == 3 && batcher.GetSingles().empty());
+	CHECK(batcher.GetInstances() == vector<UINT>({ 0, 2, 1, 4, 6, 3, 5 }));
+}
+
+// Many items of a few assets: the draws follow the assets, not the items.
+TEST(InstanceBatcher_DrawsPerAsset)
+{
+	const UINT count = 10000;
+	mt19937 random(1);
+	uniform_int_distribution<UINT> geometry(0, 3), material(0, 1);
+	InstanceBatcher batcher;
+	for (UINT item = 0; item < count; ++item)
+		batcher.Assign(item, MakeKey(geometry(random), material(random)));
+	CHECK(batcher.GetBatchCount() == 8);
+
+	batcher.Begin();
+	for (UINT item = 0; item < count; ++item)
+		batcher.Add(item);
+	batcher.End();
+	CHECK(GetDrawCount(batcher) == 8 && batcher.GetInstances().size() == count);
+
+	// Every instance is one of the items, each one once
+	vector<bool> seen(count, false);
+	for (const InstanceRange &range : batcher.GetRanges())
+	{
+		for (UINT i = range.FirstInstance; i < range.FirstInstance + range.InstanceCount; ++i)
+		{
+			UINT item = batcher.GetInstances()[i];
+			CHECK(batcher.GetBatch(item) == range.Batch && !seen[item]);
+			seen[item] = true;
+		}
+	}
+
+	// 51 boxes of the same mesh and material, as in the many skeletons state, are one draw
+	InstanceBatcher boxes;
+	boxes.Begin();
+	for (UINT item = 0; item < 51; ++item)
+	{
+		boxes.Assign(item, MakeKey(0, 0));
+		boxes.Add(item);
+	}
+	boxes.End();
+	CHECK(GetDrawCount(boxes) == 1 && boxes.GetRanges()[0].InstanceCount == 51);
+}
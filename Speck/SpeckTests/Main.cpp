@@ -0,0 +1,101 @@
+#include "TestFramework.h"
+#include <iostream>
+#include <iomanip>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdlib>
+#endif
+
+using namespace std;
+
+namespace
+{
+	unsigned int gFailureCount = 0;
+
+	string GetTemporaryDirectory()
+	{
+#ifdef _WIN32
+		char directory[MAX_PATH];
+		DWORD length = GetTempPathA(MAX_PATH, directory);
+		return string(directory, length);
+#else
+		const char *directory = getenv("TMPDIR");
+		return string(directory && *directory ? directory : "/tmp") + "/";
+#endif
+	}
+}
+
+vector<TestCase> &TestRegistry::GetTestCases()
+{
+	static vector<TestCase> testCases;
+	return testCases;
+}
+
+void TestRegistry::ReportFailure(const char *file, int line, const char *expression)
+{
+	cout << "    " << file << "(" << line << "): CHECK(" << expression << ") failed\n";
+	++gFailureCount;
+}
+
+void TestRegistry::ReportValue(const string &name, double value, const char *unit)
+{
+	cout << "    " << name << ": " << setprecision(4) << value;
+	if (*unit)
+		cout << " " << unit;
+	cout << "\n";
+}
+
+wstring GetTemporaryFilePath(const wchar_t *fileName)
+{
+#ifdef _WIN32
+	wchar_t directory[MAX_PATH];
+	DWORD length = GetTempPathW(MAX_PATH, directory);
+	return wstring(directory, length) + fileName;
+#else
+	string directory = GetTemporaryDirectory();
+	return wstring(directory.begin(), directory.end()) + fileName;
+#endif
+}
+
+string GetTemporaryFilePath(const char *fileName)
+{
+	return GetTemporaryDirectory() + fileName;
+}
+
+// Usage: SpeckTests [--benchmarks] [name filter]
+// Runs from the Build directory, the tests load the data of the app from there.
+int main(int argc, char **argv)
+{
+	bool benchmarks = false;
+	string filter;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (string(argv[i]) == "--benchmarks")
+			benchmarks = true;
+		else
+			filter = argv[i];
+	}
+
+	unsigned int run = 0;
+	unsigned int failed = 0;
+	for (const TestCase &testCase : TestRegistry::GetTestCases())
+	{
+		if (testCase.mBenchmark && !benchmarks)
+			continue;
+		if (!filter.empty() && string(testCase.mName).find(filter) == string::npos)
+			continue;
+
+		cout << (testCase.mBenchmark ? "[ BENCH ] " : "[ RUN   ] ") << testCase.mName << endl;
+		unsigned int failuresBefore = gFailureCount;
+		testCase.mFunction();
+		bool passed = (gFailureCount == failuresBefore);
+		cout << (passed ? "[    OK ] " : "[ FAIL  ] ") << testCase.mName << endl;
+		++run;
+		if (!passed)
+			++failed;
+	}
+
+	cout << run - failed << " of " << run << " passed" << endl;
+	return failed == 0 ? 0 : 1;
+}
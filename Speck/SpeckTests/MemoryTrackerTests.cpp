@@ -0,0 +1,147 @@
+#include "TestFramework.h"
+#include <MemoryTracker.h>
+#include <sstream>
+#include <thread>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	// The counters are shared by the whole process, the tests check how they change.
+	MemoryTagStats GetTagStats(MemoryTag tag)
+	{
+		vector<MemoryTagStats> stats;
+		MemoryTracker::GetStats(&stats);
+		return stats[(uint32_t)tag];
+	}
+
+	vector<string> SplitLines(const string &text)
+	{
+		istringstream stream(text);
+		vector<string> lines;
+		string line;
+		while (getline(stream, line))
+			lines.push_back(line);
+		return lines;
+	}
+}
+
+// An allocation counts its bytes while it lives, a vector its capacity as reserved and its size as used.
+TEST(MemoryTracker_Allocation)
+{
+	MemoryTracker::ResetHighWater();
+	MemoryTagStats before = GetTagStats(MemoryTag::World);
+	CHECK(before.Name == "World" && string(MemoryTracker::GetTagName(MemoryTag::World)) == "World");
+	{
+		MemoryAllocation allocation(MemoryTag::World);
+		allocation.Set(1000, 400);
+		MemoryTagStats stats = GetTagStats(MemoryTag::World);
+		CHECK(stats.Reserved == before.Reserved + 1000 && stats.Used == before.Used + 400);
+		CHECK(stats.Allocations == before.Allocations + 1);
+
+		// Growing and shrinking is still one allocation, the high-water marks keep the largest values
+		allocation.Set(4000, 3000);
+		allocation.Set(2000, 100);
+		stats = GetTagStats(MemoryTag::World);
+		CHECK(stats.Reserved == before.Reserved + 2000 && stats.Used == before.Used + 100);
+		CHECK(stats.ReservedHighWater == before.Reserved + 4000 && stats.UsedHighWater == before.Used + 3000);
+		CHECK(stats.Allocations == before.Allocations + 1);
+
+		vector<uint64_t> container;
+		container.reserve(100);
+		container.resize(10);
+		MemoryAllocation containerAllocation(MemoryTag::World);
+		containerAllocation.Set(container);
+		CHECK(containerAllocation.GetReserved() == 100 * sizeof(uint64_t) && containerAllocation.GetUsed() == 10 * sizeof(uint64_t));
+		CHECK(GetTagStats(MemoryTag::World).Allocations == before.Allocations + 2);
+
+		// An allocation emptied but kept alive no longer counts as one
+		containerAllocation.Set(0, 0);
+		CHECK(GetTagStats(MemoryTag::World).Allocations == before.Allocations + 1);
+	}
+
+	// Everything is given back when the allocations are destroyed
+	MemoryTagStats after = GetTagStats(MemoryTag::World);
+	CHECK(after.Reserved == before.Reserved && after.Used == before.Used && after.Allocations == before.Allocations);
+	CHECK(after.ReservedHighWater == before.Reserved + 4000);
+
+	MemoryTracker::ResetHighWater();
+	after = GetTagStats(MemoryTag::World);
+	CHECK(after.ReservedHighWater == after.Reserved && after.UsedHighWater == after.Used);
+}
+
+// Allocations of many threads at once add up to the same counts as one after the other.
+TEST(MemoryTracker_Threads)
+{
+	const uint32_t threadCount = 8, count = 10000;
+	MemoryTracker::ResetHighWater();
+	MemoryTagStats before = GetTagStats(MemoryTag::RenderItems);
+	vector<thread> threads;
+	for (uint32_t t = 0; t < threadCount; ++t)
+	{
+		threads.emplace_back([]()
+		{
+			MemoryAllocation kept(MemoryTag::RenderItems);
+			kept.Set(64, 32);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				MemoryAllocation allocation(MemoryTag::RenderItems);
+				allocation.Set(128 + i % 7, 64);
+			}
+			kept.Set(0, 0);
+		});
+	}
+	for (thread &thread : threads)
+		thread.join();
+
+	MemoryTagStats after = GetTagStats(MemoryTag::RenderItems);
+	CHECK(after.Reserved == before.Reserved && after.Used == before.Used && after.Allocations == before.Allocations);
+	CHECK(after.ReservedHighWater >= before.Reserved + 64 + 128 && after.ReservedHighWater <= before.Reserved + threadCount * (64 + 134));
+	CHECK(after.UsedHighWater >= before.Used + 32 + 64 && after.UsedHighWater <= before.Used + threadCount * (32 + 64));
+}
+
+// The table has a row per tag and the totals, in megabytes.
+TEST(MemoryTracker_Dump)
+{
+	MemoryAllocation allocation(MemoryTag::Geometry);
+	allocation.Set(3 * 1024 * 1024, 1024 * 1024);
+	ostringstream stream;
+	MemoryTracker::Dump(stream);
+	vector<string> lines = SplitLines(stream.str());
+	CHECK(lines.size() == (size_t)MemoryTag::Count + 2);
+	if (lines.size() != (size_t)MemoryTag::Count + 2)
+		return;
+	CHECK(lines[0].find("Tag") == 0 && lines[0].find("Reserved (MB)") != string::npos && lines[0].find("Allocations") != string::npos);
+	for (uint32_t t = 0; t < (uint32_t)MemoryTag::Count; ++t)
+		CHECK(lines[t + 1].find(MemoryTracker::GetTagName((MemoryTag)t)) == 0);
+	CHECK(lines.back().find("Total") == 0);
+
+	// Nothing else in the tests uses the geometry tag
+	CHECK(GetTagStats(MemoryTag::Geometry).Reserved == 3 * 1024 * 1024);
+	CHECK(lines[(uint32_t)MemoryTag::Geometry + 1].find("3.000") != string::npos);
+
+	string path = GetTemporaryFilePath("SpeckTests_memory.txt");
+	CHECK(MemoryTracker::Dump(path));
+	ifstream file(path, ios::in);
+	string fileText((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	file.close();
+	remove(path.c_str());
+	CHECK(SplitLines(fileText).size() == lines.size());
+	CHECK(!MemoryTracker::Dump("NoSuchDirectory/memory.txt"));
+}
+
+// Cost of a change of the counters, paid by every allocation and resize of the tracked containers.
+BENCHMARK(MemoryTracker_Change)
+{
+	const uint32_t count = 1000000;
+	MemoryAllocation allocation(MemoryTag::World);
+	double changes = MeasureMilliseconds(5, [&]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			allocation.Set(1024 + (i & 1), 512);
+	});
+	TestRegistry::ReportValue("Change", changes * 1e6 / count, "ns");
+}
@@ -0,0 +1,294 @@
+#include "TestFramework.h"
+#include <MeshOptimizer.h>
+#include <TextMeshLoader.h>
+#include <MemoryMappedFile.h>
+#include <algorithm>
+#include <array>
+#include <random>
+#include <tuple>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	struct Sphere
+	{
+		vector<XMFLOAT3> positions;
+		vector<uint32_t> indices;
+	};
+
+	// UV sphere, appended to the mesh.
+	void AddSphere(float radius, UINT slices, UINT stacks, Sphere *mesh)
+	{
+		uint32_t base = (uint32_t)mesh->positions.size();
+		for (UINT i = 0; i <= stacks; ++i)
+		{
+			float phi = XM_PI * i / stacks;
+			for (UINT j = 0; j <= slices; ++j)
+			{
+				float theta = XM_2PI * j / slices;
+				mesh->positions.push_back(XMFLOAT3(radius * sinf(phi) * cosf(theta), radius * cosf(phi), radius * sinf(phi) * sinf(theta)));
+			}
+		}
+		for (UINT i = 0; i < stacks; ++i)
+		{
+			for (UINT j = 0; j < slices; ++j)
+			{
+				uint32_t a = base + i * (slices + 1) + j, b = a + slices + 1;
+				mesh->indices.insert(mesh->indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+			}
+		}
+	}
+
+	// Shuffles the triangles and the vertices, like a mesh exported without any ordering.
+	void Shuffle(Sphere *mesh, unsigned int seed)
+	{
+		mt19937 random(seed);
+		vector<uint32_t> remap(mesh->positions.size());
+		for (uint32_t i = 0; i < remap.size(); ++i)
+			remap[i] = i;
+		shuffle(remap.begin(), remap.end(), random);
+		vector<XMFLOAT3> positions(mesh->positions.size());
+		for (size_t i = 0; i < remap.size(); ++i)
+			positions[remap[i]] = mesh->positions[i];
+		mesh->positions.swap(positions);
+
+		size_t triangleCount = mesh->indices.size() / 3;
+		vector<size_t> order(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+			order[t] = t;
+		shuffle(order.begin(), order.end(), random);
+		vector<uint32_t> indices;
+		for (size_t t : order)
+			for (UINT k = 0; k < 3; ++k)
+				indices.push_back(remap[mesh->indices[t * 3 + k]]);
+		mesh->indices.swap(indices);
+	}
+
+	// Triangles rotated to start with their smallest index, sorted. Equal lists have the same triangles with the same winding.
+	vector<array<uint32_t, 3>> GetTriangles(const vector<uint32_t> &indices)
+	{
+		vector<array<uint32_t, 3>> triangles;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			array<uint32_t, 3> triangle = { indices[t], indices[t + 1], indices[t + 2] };
+			while (triangle[0] > triangle[1] || triangle[0] > triangle[2])
+				rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+			triangles.push_back(triangle);
+		}
+		sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Triangles by the positions of their vertices, for the passes that renumber the vertices.
+	vector<array<float, 9>> GetTrianglePositions(const vector<uint32_t> &indices, const vector<GeometryGenerator::StaticVertex> &vertices)
+	{
+		vector<array<float, 9>> triangles;
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			// Rotated to start with the vertex that sorts first
+			UINT first = 0;
+			for (UINT k = 1; k < 3; ++k)
+			{
+				const XMFLOAT3 &p = vertices[indices[t + k]].Position, &q = vertices[indices[t + first]].Position;
+				if (make_tuple(p.x, p.y, p.z) < make_tuple(q.x, q.y, q.z))
+					first = k;
+			}
+			array<float, 9> triangle;
+			for (UINT k = 0; k < 3; ++k)
+				memcpy(&triangle[k * 3], &vertices[indices[t + (first + k) % 3]].Position, sizeof(XMFLOAT3));
+			triangles.push_back(triangle);
+		}
+		sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	GeometryGenerator::StaticMeshData ToMeshData(const Sphere &sphere)
+	{
+		GeometryGenerator::StaticMeshData mesh;
+		for (const XMFLOAT3 &p : sphere.positions)
+		{
+			XMFLOAT3 n;
+			XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&p)));
+			mesh.Vertices.push_back(GeometryGenerator::StaticVertex(p, n, XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(p.x, p.y)));
+		}
+		mesh.Indices32 = sphere.indices;
+		return mesh;
+	}
+
+	bool LoadSkull(GeometryGenerator::StaticMeshData *outMesh)
+	{
+		MemoryMappedFile file;
+		BoundingBox bounds;
+		return file.Open(L"Data/Models/skull.txt") &&
+			TextMeshLoader::Parse(reinterpret_cast<const char *>(file.GetData()), (size_t)file.GetSize(), nullptr, outMesh, &bounds);
+	}
+}
+
+// Misses of the FIFO cache counted by hand.
+TEST(MeshOptimizer_Stats)
+{
+	// Two triangles sharing an edge, 4 misses for 2 triangles and 4 vertices
+	const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+	CHECK_NEAR(MeshOptimizer::CalculateACMR(quad, 6, 4), 2.0f, 1e-6f);
+	CHECK_NEAR(MeshOptimizer::CalculateATVR(quad, 6, 4), 1.0f, 1e-6f);
+
+	// The first triangle is out of a cache of 3 after the second one, so it is loaded again
+	const uint32_t strip[9] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	CHECK_NEAR(MeshOptimizer::CalculateACMR(strip, 9, 6, 3), 3.0f, 1e-6f);
+	CHECK_NEAR(MeshOptimizer::CalculateATVR(strip, 9, 6, 3), 1.5f, 1e-6f);
+	CHECK_NEAR(MeshOptimizer::CalculateACMR(strip, 9, 6, 6), 2.0f, 1e-6f);
+
+	CHECK(!MeshOptimizer::NeedsIndices32(0x10000));
+	CHECK(MeshOptimizer::NeedsIndices32(0x10001));
+}
+
+// A shuffled sphere gets close to the best ratios, with the same triangles in the same winding.
+TEST(MeshOptimizer_VertexCache)
+{
+	Sphere sphere;
+	AddSphere(1.0f, 40, 40, &sphere);
+	Shuffle(&sphere, 1);
+	size_t vertexCount = sphere.positions.size();
+	vector<uint32_t> indices = sphere.indices;
+	float acmrBefore = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), vertexCount);
+
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+	float acmr = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), vertexCount);
+	float atvr = MeshOptimizer::CalculateATVR(indices.data(), indices.size(), vertexCount);
+	TestRegistry::ReportValue("ACMR before", acmrBefore, "");
+	TestRegistry::ReportValue("ACMR after", acmr, "");
+	TestRegistry::ReportValue("ATVR after", atvr, "");
+	CHECK(acmrBefore > 2.5f);
+	CHECK(acmr < 0.75f);
+	CHECK(atvr < 1.45f);
+	CHECK(GetTriangles(indices) == GetTriangles(sphere.indices));
+}
+
+// The outer sphere occludes the inner one, so its clusters move in front of all of the inner ones.
+TEST(MeshOptimizer_Overdraw)
+{
+	Sphere spheres;
+	AddSphere(1.0f, 32, 32, &spheres);
+	AddSphere(2.0f, 32, 32, &spheres);
+	size_t vertexCount = spheres.positions.size();
+	uint32_t firstOuterVertex = (uint32_t)vertexCount / 2;
+	vector<uint32_t> indices = spheres.indices;
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+	float acmr = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), vertexCount);
+
+	MeshOptimizer::OptimizeOverdraw(indices.data(), indices.size(), &spheres.positions[0].x, vertexCount, sizeof(XMFLOAT3));
+	CHECK(GetTriangles(indices) == GetTriangles(spheres.indices));
+	size_t lastOuter = 0, firstInner = indices.size();
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		if (indices[i] >= firstOuterVertex)
+			lastOuter = i;
+		else
+			firstInner = min(firstInner, i);
+	}
+	CHECK(lastOuter < firstInner);
+
+	// The clusters keep most of the cache order
+	float overdrawACMR = MeshOptimizer::CalculateACMR(indices.data(), indices.size(), vertexCount);
+	TestRegistry::ReportValue("ACMR of the cache order", acmr, "");
+	TestRegistry::ReportValue("ACMR of the overdraw order", overdrawACMR, "");
+	CHECK(overdrawACMR < acmr * 1.25f);
+}
+
+// Vertices are numbered in the order they are first used, the unused ones are dropped.
+TEST(MeshOptimizer_VertexFetch)
+{
+	uint32_t indices[9] = { 5, 2, 7, 2, 5, 0, 7, 0, 5 };
+	vector<uint32_t> remap;
+	CHECK(MeshOptimizer::OptimizeVertexFetchRemap(indices, 9, 8, &remap) == 4);
+	CHECK(vector<uint32_t>(indices, indices + 9) == vector<uint32_t>({ 0, 1, 2, 1, 0, 3, 2, 3, 0 }));
+	CHECK(remap == vector<uint32_t>({ 3, UINT_MAX, 1, UINT_MAX, UINT_MAX, 0, UINT_MAX, 2 }));
+
+	vector<int> vertices = { 10, 11, 12, 13, 14, 15, 16, 17 };
+	MeshOptimizer::RemapVertices(&vertices, remap, 4);
+	CHECK(vertices == vector<int>({ 15, 12, 17, 10 }));
+}
+
+// The whole pipeline on a mesh with LODs: the same surface, better ratios, and LODs that follow the new vertex order.
+TEST(MeshOptimizer_OptimizeMesh)
+{
+	Sphere sphere;
+	AddSphere(1.0f, 48, 24, &sphere);
+	Shuffle(&sphere, 2);
+	GeometryGenerator::StaticMeshData mesh = ToMeshData(sphere);
+	// One unused vertex
+	mesh.Vertices.push_back(mesh.Vertices[0]);
+	GeometryGenerator::StaticMeshData original = mesh;
+
+	vector<MeshLOD> lods;
+	MeshSimplifier::BuildLODChain(mesh, 3, &lods);
+	CHECK(lods.size() == 2);
+	vector<MeshLOD> originalLODs = lods;
+
+	MeshOptimizationStats stats;
+	MeshOptimizer::Optimize(&mesh, &stats, &lods);
+	CHECK(mesh.Vertices.size() == original.Vertices.size() - 1);
+	CHECK(stats.acmrBefore > 2.5f && stats.acmrAfter < 0.8f);
+	CHECK(stats.atvrBefore > 4.0f && stats.atvrAfter < 1.5f);
+	CHECK(GetTrianglePositions(mesh.Indices32, mesh.Vertices) == GetTrianglePositions(original.Indices32, original.Vertices));
+	for (size_t i = 0; i < lods.size(); ++i)
+	{
+		CHECK(*max_element(lods[i].indices.begin(), lods[i].indices.end()) < mesh.Vertices.size());
+		CHECK(GetTrianglePositions(lods[i].indices, mesh.Vertices) == GetTrianglePositions(originalLODs[i].indices, original.Vertices));
+	}
+}
+
+// The skinned vertices only get the cache and fetch passes, every vertex keeps its bones.
+TEST(MeshOptimizer_OptimizeSkinnedMesh)
+{
+	Sphere sphere;
+	AddSphere(1.0f, 24, 12, &sphere);
+	Shuffle(&sphere, 3);
+	GeometryGenerator::SkinnedMeshData mesh;
+	mesh.Vertices.resize(sphere.positions.size());
+	for (size_t i = 0; i < sphere.positions.size(); ++i)
+	{
+		GeometryGenerator::SkinnedVertex &v = mesh.Vertices[i];
+		memset(&v, 0, sizeof(v));
+		v.Position[0] = XMFLOAT4(sphere.positions[i].x, sphere.positions[i].y, sphere.positions[i].z, 1.0f);
+		v.BoneIndices[0] = (int)i;
+	}
+	mesh.Indices32 = sphere.indices;
+
+	MeshOptimizationStats stats;
+	MeshOptimizer::Optimize(&mesh, &stats);
+	CHECK(stats.acmrAfter < stats.acmrBefore && stats.acmrAfter < 0.8f);
+	// Back to the original numbering through the bone indices
+	vector<uint32_t> indices;
+	for (uint32_t index : mesh.Indices32)
+		indices.push_back((uint32_t)mesh.Vertices[index].BoneIndices[0]);
+	CHECK(GetTriangles(indices) == GetTriangles(sphere.indices));
+	for (const GeometryGenerator::SkinnedVertex &v : mesh.Vertices)
+		CHECK(memcmp(&v.Position[0], &sphere.positions[v.BoneIndices[0]], sizeof(XMFLOAT3)) == 0);
+}
+
+// The skull of the app, as it comes out of the text file.
+BENCHMARK(MeshOptimizer_Skull)
+{
+	GeometryGenerator::StaticMeshData skull;
+	CHECK(LoadSkull(&skull));
+	MeshOptimizationStats stats;
+	double milliseconds = MeasureMilliseconds(3, [&]()
+	{
+		GeometryGenerator::StaticMeshData mesh = skull;
+		MeshOptimizer::Optimize(&mesh, &stats);
+	});
+	TestRegistry::ReportValue("Optimizing " + to_string(skull.Indices32.size() / 3) + " triangles", milliseconds, "ms");
+	TestRegistry::ReportValue("ACMR before", stats.acmrBefore, "");
+	TestRegistry::ReportValue("ACMR after", stats.acmrAfter, "");
+	TestRegistry::ReportValue("ATVR before", stats.atvrBefore, "");
+	TestRegistry::ReportValue("ATVR after", stats.atvrAfter, "");
+
+	// The overdraw pass gives up some of the cache order
+	vector<uint32_t> indices = skull.Indices32;
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), skull.Vertices.size());
+	TestRegistry::ReportValue("ACMR with the vertex cache pass only", MeshOptimizer::CalculateACMR(indices.data(), indices.size(), skull.Vertices.size()), "");
+}
@@ -0,0 +1,321 @@
+#include "TestFramework.h"
+#include "SkeletonTemplate.h"
+#include "SpeckAssetFile.h"
+#include <MeshSimplifier.h>
+#include <GenericShaderStructures.h>
+#include <set>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	struct Vertex
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+	};
+
+	struct Mesh
+	{
+		vector<Vertex> vertices;
+		vector<uint32_t> indices;
+	};
+
+	// Normal and texture coordinates, weighted as BuildLODChain does for the static meshes.
+	const float gAttributeWeights[5] = { 0.01f, 0.01f, 0.01f, 0.01f, 0.01f };
+
+	// Grid of size x size quads over the unit square, with the height of the function. With a seam the column in the
+	// middle has a vertex for each side, with different texture coordinates.
+	template <typename Height>
+	Mesh CreateGrid(UINT size, bool seam, Height height)
+	{
+		Mesh mesh;
+		UINT seamColumn = seam ? size / 2 : UINT_MAX;
+		vector<uint32_t> left, right;
+		for (UINT y = 0; y <= size; ++y)
+		{
+			for (UINT x = 0; x <= size; ++x)
+			{
+				float u = (float)x / size, v = (float)y / size;
+				Vertex vertex = { XMFLOAT3(u, v, height(u, v)), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(u, v) };
+				left.push_back((uint32_t)mesh.vertices.size());
+				mesh.vertices.push_back(vertex);
+				if (x == seamColumn)
+				{
+					vertex.TexC.x += 1.0f;
+					mesh.vertices.push_back(vertex);
+				}
+				right.push_back((uint32_t)mesh.vertices.size() - 1);
+			}
+		}
+		for (UINT y = 0; y < size; ++y)
+		{
+			for (UINT x = 0; x < size; ++x)
+			{
+				const vector<uint32_t> &side = (x < seamColumn) ? left : right;
+				uint32_t i00 = side[y * (size + 1) + x], i10 = side[y * (size + 1) + x + 1];
+				uint32_t i01 = side[(y + 1) * (size + 1) + x], i11 = side[(y + 1) * (size + 1) + x + 1];
+				mesh.indices.insert(mesh.indices.end(), { i00, i10, i11, i00, i11, i01 });
+			}
+		}
+		return mesh;
+	}
+
+	float Bumps(float u, float v)
+	{
+		return 0.1f * sinf(XM_2PI * u) * sinf(XM_2PI * v);
+	}
+
+	float Simplify(const Mesh &mesh, size_t targetIndexCount, float targetError, vector<uint32_t> *outIndices, bool withAttributes = true)
+	{
+		MeshSimplifier::Attributes attributes;
+		if (withAttributes)
+		{
+			attributes.data = &mesh.vertices[0].Normal.x;
+			attributes.stride = sizeof(Vertex);
+			attributes.count = _countof(gAttributeWeights);
+			attributes.weights = gAttributeWeights;
+		}
+		return MeshSimplifier::Simplify(mesh.indices.data(), mesh.indices.size(), &mesh.vertices[0].Position.x, mesh.vertices.size(),
+			sizeof(Vertex), attributes, targetIndexCount, targetError, outIndices);
+	}
+
+	// Edges of the triangles without a twin going the other way, borders and seams.
+	vector<pair<uint32_t, uint32_t>> GetOpenEdges(const vector<uint32_t> &indices)
+	{
+		set<pair<uint32_t, uint32_t>> edges;
+		for (size_t i = 0; i < indices.size(); i += 3)
+			for (int k = 0; k < 3; ++k)
+				edges.insert(make_pair(indices[i + k], indices[i + (k + 1) % 3]));
+		vector<pair<uint32_t, uint32_t>> openEdges;
+		for (const pair<uint32_t, uint32_t> &edge : edges)
+			if (!edges.count(make_pair(edge.second, edge.first)))
+				openEdges.push_back(edge);
+		return openEdges;
+	}
+
+	// Area of the triangles seen from above, the triangles of the grid face up.
+	float GetAreaFromAbove(const vector<Vertex> &vertices, const vector<uint32_t> &indices, size_t first, size_t count)
+	{
+		float area = 0.0f;
+		for (size_t i = first; i < first + count; i += 3)
+		{
+			const XMFLOAT3 &a = vertices[indices[i]].Position, &b = vertices[indices[i + 1]].Position, &c = vertices[indices[i + 2]].Position;
+			area += 0.5f * ((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y));
+		}
+		return area;
+	}
+}
+
+// The simplification stops at the target index count when the error allows it.
+TEST(MeshSimplifier_TargetIndexCount)
+{
+	Mesh mesh = CreateGrid(32, false, Bumps);
+	for (size_t divisor : { 2, 4, 16 })
+	{
+		size_t target = mesh.indices.size() / divisor / 3 * 3;
+		vector<uint32_t> indices;
+		float error = Simplify(mesh, target, 1.0f, &indices);
+		CHECK(indices.size() <= target && indices.size() > target / 2);
+		CHECK(indices.size() % 3 == 0 && error > 0.0f && error <= 1.0f);
+		for (uint32_t index : indices)
+			CHECK(index < mesh.vertices.size());
+	}
+
+	// Nothing to do
+	vector<uint32_t> indices;
+	CHECK(Simplify(mesh, mesh.indices.size(), 1.0f, &indices) == 0.0f && indices == mesh.indices);
+}
+
+// Without a target index count the simplification stops at the target error, relative to the size of the mesh (the
+// grid is one unit wide, so the returned error is compared to it directly).
+TEST(MeshSimplifier_TargetError)
+{
+	Mesh mesh = CreateGrid(32, false, Bumps);
+	size_t previousSize = mesh.indices.size();
+	for (float targetError : { 0.001f, 0.01f, 0.05f })
+	{
+		vector<uint32_t> indices;
+		float error = Simplify(mesh, 0, targetError, &indices);
+		TestRegistry::ReportValue("Triangles at the error " + to_string(targetError), (double)indices.size() / 3, "");
+		CHECK(error <= targetError);
+		CHECK(!indices.empty() && indices.size() <= previousSize);
+		previousSize = indices.size();
+	}
+	CHECK(previousSize < mesh.indices.size() / 4);
+
+	// Without the texture coordinates a flat mesh loses all of its inner vertices without any error, the mesh is 10 units wide
+	Mesh flat = CreateGrid(16, false, [](float, float) { return 0.0f; });
+	for (Vertex &vertex : flat.vertices)
+		vertex.Position = XMFLOAT3(vertex.Position.x * 10.0f, vertex.Position.y * 10.0f, 0.0f);
+	vector<uint32_t> indices;
+	CHECK(Simplify(flat, 0, 0.001f, &indices, false) < 1e-3f);
+	CHECK(indices.size() < flat.indices.size() / 8);
+	CHECK_NEAR(GetAreaFromAbove(flat.vertices, indices, 0, indices.size()), 100.0f, 1e-3f);
+}
+
+// The open edges of the simplified mesh stay on the borders of the square and on the seam in the middle of it, so
+// both halves keep their outline.
+TEST(MeshSimplifier_BordersAndSeamsStayInPlace)
+{
+	Mesh mesh = CreateGrid(16, true, Bumps);
+	vector<uint32_t> indices;
+	Simplify(mesh, 0, MeshSimplifier::MaxLODError, &indices);
+	CHECK(!indices.empty() && indices.size() < mesh.indices.size() / 2);
+
+	auto isOnSameLine = [&](uint32_t a, uint32_t b)
+	{
+		const XMFLOAT3 &pa = mesh.vertices[a].Position, &pb = mesh.vertices[b].Position;
+		for (float line : { 0.0f, 0.5f, 1.0f })
+			if (pa.x == line && pb.x == line)
+				return true;
+		for (float line : { 0.0f, 1.0f })
+			if (pa.y == line && pb.y == line)
+				return true;
+		return false;
+	};
+	for (const pair<uint32_t, uint32_t> &edge : GetOpenEdges(indices))
+		CHECK(isOnSameLine(edge.first, edge.second));
+
+	// No triangle crosses the seam and the halves cover the same area
+	float leftArea = 0.0f, rightArea = 0.0f;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		float minX = 1.0f, maxX = 0.0f;
+		for (int k = 0; k < 3; ++k)
+		{
+			minX = min(minX, mesh.vertices[indices[i + k]].Position.x);
+			maxX = max(maxX, mesh.vertices[indices[i + k]].Position.x);
+		}
+		CHECK(maxX <= 0.5f || minX >= 0.5f);
+		(maxX <= 0.5f ? leftArea : rightArea) += GetAreaFromAbove(mesh.vertices, indices, i, 3);
+	}
+	CHECK_NEAR(leftArea, 0.5f, 1e-4f);
+	CHECK_NEAR(rightArea, 0.5f, 1e-4f);
+}
+
+// The skin weights given as attributes the way SkeletonTemplate does keep the region of every bone: a flat strip with
+// one bone at each end and a blend in the middle is not simplified across the blend. Without the weights it is.
+TEST(MeshSimplifier_SkinWeightsKeepBoneRegions)
+{
+	Mesh grid = CreateGrid(16, false, [](float, float) { return 0.0f; });
+	vector<AppCommands::StaticMeshVertex> vertices(grid.vertices.size());
+	vector<SpeckAssetFormat::VertexWeights> vertexWeights(grid.vertices.size());
+	vector<float> secondBoneWeights(grid.vertices.size());
+	for (size_t i = 0; i < grid.vertices.size(); ++i)
+	{
+		vertices[i] = {};
+		vertices[i].Position = grid.vertices[i].Position;
+		vertices[i].Normal = grid.vertices[i].Normal;
+		vertices[i].TexC = grid.vertices[i].TexC;
+		float weight = min(max((grid.vertices[i].Position.y - 0.375f) / 0.25f, 0.0f), 1.0f);
+		vertexWeights[i] = {};
+		vertexWeights[i].clusters[0] = 0;
+		vertexWeights[i].weights[0] = 1.0f - weight;
+		vertexWeights[i].clusters[1] = 2;
+		vertexWeights[i].weights[1] = weight;
+		secondBoneWeights[i] = weight;
+	}
+
+	// The middle cluster is not a bone, the last one is the second bone
+	vector<int> clusterBones = { 0, -1, 1 };
+	vector<float> attributes, attributeWeights;
+	SkeletonTemplate::GetLODAttributes(vertices.data(), vertexWeights.data(), (UINT)vertices.size(), clusterBones, 2, &attributes, &attributeWeights);
+	CHECK(attributeWeights.size() == 7 && attributes.size() == vertices.size() * 7);
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		CHECK(attributes[i * 7 + 2] == 1.0f && attributes[i * 7 + 3] == vertices[i].TexC.x);
+		CHECK(attributes[i * 7 + 5] == 1.0f - secondBoneWeights[i] && attributes[i * 7 + 6] == secondBoneWeights[i]);
+	}
+
+	// Largest difference of the weights of the second bone in a triangle of the LODs
+	auto getWeightSpread = [&](UINT attributeCount)
+	{
+		MeshSimplifier::Attributes simplifierAttributes;
+		simplifierAttributes.data = attributes.data();
+		simplifierAttributes.stride = attributeWeights.size() * sizeof(float);
+		simplifierAttributes.count = attributeCount;
+		simplifierAttributes.weights = attributeWeights.data();
+		vector<MeshLOD> lods;
+		MeshSimplifier::BuildLODChain(grid.indices.data(), grid.indices.size(), &vertices[0].Position.x, vertices.size(),
+			sizeof(AppCommands::StaticMeshVertex), simplifierAttributes, 4, &lods);
+		CHECK(lods.size() == 3);
+		float spread = 0.0f;
+		for (const MeshLOD &lod : lods)
+		{
+			for (size_t i = 0; i < lod.indices.size(); i += 3)
+			{
+				float w0 = secondBoneWeights[lod.indices[i]], w1 = secondBoneWeights[lod.indices[i + 1]], w2 = secondBoneWeights[lod.indices[i + 2]];
+				spread = max(spread, max(max(w0, w1), w2) - min(min(w0, w1), w2));
+			}
+		}
+		return spread;
+	};
+	float withWeights = getWeightSpread((UINT)attributeWeights.size());
+	float withoutWeights = getWeightSpread(5);
+	TestRegistry::ReportValue("Weight spread in a triangle with the bone weights", withWeights, "");
+	TestRegistry::ReportValue("Weight spread in a triangle without the bone weights", withoutWeights, "");
+	CHECK(withWeights <= 0.5f);
+	CHECK(withoutWeights == 1.0f);
+}
+
+// The chain ends as soon as a LOD would not remove enough triangles, the errors grow with the levels.
+TEST(MeshSimplifier_ChainEndsEarly)
+{
+	// Nothing can be removed from two triangles
+	Mesh quad = CreateGrid(1, false, [](float, float) { return 0.0f; });
+	vector<MeshLOD> lods;
+	MeshSimplifier::BuildLODChain(quad.indices.data(), quad.indices.size(), &quad.vertices[0].Position.x, quad.vertices.size(),
+		sizeof(Vertex), MeshSimplifier::Attributes(), 4, &lods);
+	CHECK(lods.empty());
+
+	// The corners of a cube cost more than the largest error of the LODs
+	GeometryGenerator generator;
+	GeometryGenerator::StaticMeshData box = generator.CreateBox(1.0f, 1.0f, 1.0f, 0);
+	MeshSimplifier::BuildLODChain(box, 4, &lods);
+	CHECK(lods.empty());
+
+	// A flat grid goes down to the two triangles of its corners long before the tenth LOD
+	Mesh flat = CreateGrid(16, false, [](float, float) { return 0.0f; });
+	MeshSimplifier::BuildLODChain(flat.indices.data(), flat.indices.size(), &flat.vertices[0].Position.x, flat.vertices.size(),
+		sizeof(Vertex), MeshSimplifier::Attributes(), 10, &lods);
+	CHECK(!lods.empty() && lods.size() < 9);
+	size_t previousSize = flat.indices.size();
+	float previousError = 0.0f;
+	for (const MeshLOD &lod : lods)
+	{
+		CHECK(lod.indices.size() <= previousSize * 0.9f && lod.error >= previousError);
+		previousSize = lod.indices.size();
+		previousError = lod.error;
+	}
+}
+
+// The coarsest LOD whose error covers at most the given number of pixels, which shrinks with the distance and grows
+// with the scale.
+TEST(MeshSimplifier_SelectLOD)
+{
+	vector<SubmeshLOD> lods(4);
+	lods[1].Error = 0.01f;
+	lods[2].Error = 0.02f;
+	lods[3].Error = 0.04f;
+	const float pixelsPerUnit = 1000.0f;
+
+	// At 10 units the errors are 1, 2 and 4 pixels
+	CHECK(MeshSimplifier::SelectLOD(lods, 10.0f, 1.0f, pixelsPerUnit, 1.0f) == 1);
+	CHECK(MeshSimplifier::SelectLOD(lods, 10.0f, 1.0f, pixelsPerUnit, 0.5f) == 0);
+	CHECK(MeshSimplifier::SelectLOD(lods, 10.0f, 1.0f, pixelsPerUnit, 4.0f) == 3);
+	CHECK(MeshSimplifier::SelectLOD(lods, 5.0f, 1.0f, pixelsPerUnit, 1.0f) == 0);
+	CHECK(MeshSimplifier::SelectLOD(lods, 20.0f, 1.0f, pixelsPerUnit, 1.0f) == 2);
+	CHECK(MeshSimplifier::SelectLOD(lods, 1000.0f, 1.0f, pixelsPerUnit, 1.0f) == 3);
+
+	// Twice the size looks the same at twice the distance
+	CHECK(MeshSimplifier::SelectLOD(lods, 20.0f, 2.0f, pixelsPerUnit, 1.0f) == 1);
+	CHECK(MeshSimplifier::SelectLOD(lods, 10.0f, 0.5f, pixelsPerUnit, 1.0f) == 2);
+
+	// At the camera and without LODs the full mesh is drawn
+	CHECK(MeshSimplifier::SelectLOD(lods, 0.0f, 1.0f, pixelsPerUnit, 1.0f) == 0);
+	CHECK(MeshSimplifier::SelectLOD(vector<SubmeshLOD>(1), 1000.0f, 1.0f, pixelsPerUnit, 1.0f) == 0);
+}
@@ -0,0 +1,269 @@
+#include "TestFramework.h"
+#include <MeshletBuilder.h>
+#include <MeshOptimizer.h>
+#include <TextMeshLoader.h>
+#include <MemoryMappedFile.h>
+#include <algorithm>
+#include <array>
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	// UV sphere with clockwise front faces, in the optimized order like the meshes of the app.
+	GeometryGenerator::StaticMeshData CreateSphere(float radius, UINT slices, UINT stacks)
+	{
+		GeometryGenerator::StaticMeshData mesh;
+		for (UINT i = 0; i <= stacks; ++i)
+		{
+			float phi = XM_PI * i / stacks;
+			for (UINT j = 0; j <= slices; ++j)
+			{
+				float theta = XM_2PI * j / slices;
+				XMFLOAT3 n(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+				mesh.Vertices.push_back(GeometryGenerator::StaticVertex(XMFLOAT3(radius * n.x, radius * n.y, radius * n.z), n,
+					XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2((float)j / slices, (float)i / stacks)));
+			}
+		}
+		for (UINT i = 0; i < stacks; ++i)
+		{
+			for (UINT j = 0; j < slices; ++j)
+			{
+				uint32_t a = i * (slices + 1) + j, b = a + slices + 1;
+				mesh.Indices32.insert(mesh.Indices32.end(), { a, a + 1, b, a + 1, b + 1, b });
+			}
+		}
+		MeshOptimizer::Optimize(&mesh);
+		return mesh;
+	}
+
+	bool LoadSkull(GeometryGenerator::StaticMeshData *outMesh)
+	{
+		MemoryMappedFile file;
+		BoundingBox bounds;
+		if (!file.Open(L"Data/Models/skull.txt") ||
+			!TextMeshLoader::Parse(reinterpret_cast<const char *>(file.GetData()), (size_t)file.GetSize(), nullptr, outMesh, &bounds))
+			return false;
+		MeshOptimizer::Optimize(outMesh);
+		return true;
+	}
+
+	BoundingFrustum CreateFrustum(const XMFLOAT3 &eye, const XMFLOAT3 &target, float fovY)
+	{
+		BoundingFrustum frustum;
+		BoundingFrustum::CreateFromMatrix(frustum, XMMatrixPerspectiveFovLH(fovY, 1.0f, 0.1f, 1000.0f));
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+		return frustum;
+	}
+
+	bool IsFrontFacing(const GeometryGenerator::StaticMeshData &mesh, const uint32_t *triangle, const XMFLOAT3 &eye)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&mesh.Vertices[triangle[0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&mesh.Vertices[triangle[1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&mesh.Vertices[triangle[2]].Position);
+		return XMVectorGetX(XMVector3Dot(XMVector3Cross(p1 - p0, p2 - p0), XMLoadFloat3(&eye) - p0)) > 0.0f;
+	}
+
+	vector<bool> GetVisibleIndices(const vector<IndexRange> &ranges, size_t indexCount)
+	{
+		vector<bool> visible(indexCount, false);
+		for (const IndexRange &range : ranges)
+			fill(visible.begin() + range.StartIndexLocation, visible.begin() + range.StartIndexLocation + range.IndexCount, true);
+		return visible;
+	}
+}
+
+// Meshlets stay within the limits, cover the index buffer in order and keep every triangle.
+TEST(MeshletBuilder_Limits)
+{
+	GeometryGenerator::StaticMeshData skull;
+	CHECK(LoadSkull(&skull));
+	for (GeometryGenerator::StaticMeshData mesh : { CreateSphere(1.0f, 64, 32), skull })
+	{
+		vector<uint32_t> original = mesh.Indices32;
+		vector<Meshlet> meshlets;
+		MeshletBuilder::Build(&mesh, mesh.Indices32.size(), &meshlets);
+		CHECK(!meshlets.empty());
+
+		UINT next = 0;
+		for (const Meshlet &meshlet : meshlets)
+		{
+			CHECK(meshlet.StartIndexLocation == next && meshlet.IndexCount % 3 == 0);
+			CHECK(meshlet.IndexCount > 0 && meshlet.IndexCount <= MeshletBuilder::MaxTriangles * 3);
+			vector<uint32_t> vertices(mesh.Indices32.begin() + meshlet.StartIndexLocation,
+				mesh.Indices32.begin() + meshlet.StartIndexLocation + meshlet.IndexCount);
+			sort(vertices.begin(), vertices.end());
+			CHECK(unique(vertices.begin(), vertices.end()) - vertices.begin() <= (ptrdiff_t)MeshletBuilder::MaxVertices);
+			next += meshlet.IndexCount;
+		}
+		CHECK(next == mesh.Indices32.size());
+
+		// The same triangles, rotated the same way
+		auto sortTriangles = [](vector<uint32_t> indices)
+		{
+			vector<array<uint32_t, 3>> triangles;
+			for (size_t t = 0; t < indices.size(); t += 3)
+			{
+				array<uint32_t, 3> triangle = { indices[t], indices[t + 1], indices[t + 2] };
+				while (triangle[0] > triangle[1] || triangle[0] > triangle[2])
+					rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+				triangles.push_back(triangle);
+			}
+			sort(triangles.begin(), triangles.end());
+			return triangles;
+		};
+		CHECK(sortTriangles(mesh.Indices32) == sortTriangles(original));
+	}
+}
+
+// Every vertex is inside the sphere of its meshlet and every triangle normal inside its cone.
+TEST(MeshletBuilder_Bounds)
+{
+	GeometryGenerator::StaticMeshData mesh = CreateSphere(2.0f, 64, 32);
+	vector<Meshlet> meshlets;
+	MeshletBuilder::Build(&mesh, mesh.Indices32.size(), &meshlets);
+
+	UINT coneCount = 0;
+	for (const Meshlet &meshlet : meshlets)
+	{
+		XMVECTOR center = XMLoadFloat3(&meshlet.Bounds.Center);
+		float cosine = sqrtf(1.0f - meshlet.ConeCutoff * meshlet.ConeCutoff);
+		coneCount += (meshlet.ConeCutoff < 1.0f);
+		for (UINT i = meshlet.StartIndexLocation; i < meshlet.StartIndexLocation + meshlet.IndexCount; i += 3)
+		{
+			const uint32_t *triangle = &mesh.Indices32[i];
+			for (UINT k = 0; k < 3; ++k)
+			{
+				float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&mesh.Vertices[triangle[k]].Position) - center));
+				CHECK(distance <= meshlet.Bounds.Radius * 1.001f);
+			}
+			// The triangles at the poles are degenerate, they face nowhere
+			XMVECTOR p0 = XMLoadFloat3(&mesh.Vertices[triangle[0]].Position);
+			XMVECTOR normal = XMVector3Cross(XMLoadFloat3(&mesh.Vertices[triangle[1]].Position) - p0, XMLoadFloat3(&mesh.Vertices[triangle[2]].Position) - p0);
+			if (meshlet.ConeCutoff < 1.0f && XMVectorGetX(XMVector3LengthSq(normal)) > 1e-20f)
+				CHECK(XMVectorGetX(XMVector3Dot(XMVector3Normalize(normal), XMLoadFloat3(&meshlet.ConeAxis))) >= cosine - 1e-4f);
+		}
+	}
+	// The sphere is smooth, so only the meshlets around the poles can be too curved
+	CHECK(coneCount > meshlets.size() * 3 / 4);
+}
+
+// The culling is conservative: the culled meshlets are outside of the frustum or only have back faces.
+TEST(MeshletBuilder_CullIsConservative)
+{
+	GeometryGenerator::StaticMeshData mesh = CreateSphere(1.0f, 64, 32);
+	vector<Meshlet> meshlets;
+	MeshletBuilder::Build(&mesh, mesh.Indices32.size(), &meshlets);
+
+	mt19937 random(4);
+	uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	const XMFLOAT3 scale(1.0f, 1.0f, 1.0f);
+	size_t culledTriangles = 0;
+	vector<IndexRange> ranges;
+	for (UINT view = 0; view < 32; ++view)
+	{
+		// Around the sphere, looking at it or at a point next to it
+		XMFLOAT3 eye;
+		XMStoreFloat3(&eye, XMVector3Normalize(XMVectorSet(direction(random), direction(random), direction(random), 0.0f)) * (1.5f + view * 0.25f));
+		XMFLOAT3 target((view % 4 == 3) ? 1.5f : 0.0f, 0.0f, 0.0f);
+		BoundingFrustum frustum = CreateFrustum(eye, target, (view % 2) ? XM_PIDIV4 : XM_PIDIV2);
+		MeshletBuilder::Cull(meshlets, frustum, scale, &ranges);
+
+		// Sorted, and merged where they touch
+		for (size_t i = 1; i < ranges.size(); ++i)
+			CHECK(ranges[i - 1].StartIndexLocation + ranges[i - 1].IndexCount < ranges[i].StartIndexLocation);
+
+		vector<bool> visible = GetVisibleIndices(ranges, mesh.Indices32.size());
+		for (size_t i = 0; i < mesh.Indices32.size(); i += 3)
+		{
+			if (visible[i])
+				continue;
+			culledTriangles++;
+			const uint32_t *triangle = &mesh.Indices32[i];
+			bool inFrustum = frustum.Intersects(XMLoadFloat3(&mesh.Vertices[triangle[0]].Position), XMLoadFloat3(&mesh.Vertices[triangle[1]].Position),
+				XMLoadFloat3(&mesh.Vertices[triangle[2]].Position));
+			CHECK(!inFrustum || !IsFrontFacing(mesh, triangle, eye));
+		}
+	}
+	// A sphere shows less than half of its faces, the cones should find a good part of the rest
+	double culledFraction = (double)culledTriangles / (32 * mesh.Indices32.size() / 3);
+	TestRegistry::ReportValue("Culled triangles", culledFraction * 100.0, "%");
+	CHECK(culledFraction > 0.3);
+}
+
+// Looking away culls everything, non-uniform scales skip the cone test.
+TEST(MeshletBuilder_CullFrustumAndScale)
+{
+	GeometryGenerator::StaticMeshData mesh = CreateSphere(1.0f, 32, 16);
+	vector<Meshlet> meshlets;
+	MeshletBuilder::Build(&mesh, mesh.Indices32.size(), &meshlets);
+	vector<IndexRange> ranges;
+
+	MeshletBuilder::Cull(meshlets, CreateFrustum(XMFLOAT3(0.0f, 0.0f, -5.0f), XMFLOAT3(0.0f, 0.0f, -10.0f), XM_PIDIV4), XMFLOAT3(1.0f, 1.0f, 1.0f), &ranges);
+	CHECK(ranges.empty());
+
+	BoundingFrustum frustum = CreateFrustum(XMFLOAT3(0.0f, 0.0f, -20.0f), XMFLOAT3(0.0f, 0.0f, 0.0f), XM_PIDIV4);
+	MeshletBuilder::Cull(meshlets, frustum, XMFLOAT3(1.0f, 1.0f, 1.0f), &ranges);
+	size_t visibleIndices = 0;
+	for (const IndexRange &range : ranges)
+		visibleIndices += range.IndexCount;
+	CHECK(visibleIndices > 0 && visibleIndices < mesh.Indices32.size());
+
+	// The whole stretched sphere is in view, nothing is culled
+	MeshletBuilder::Cull(meshlets, frustum, XMFLOAT3(1.0f, 2.0f, 1.0f), &ranges);
+	CHECK(ranges.size() == 1 && ranges[0].StartIndexLocation == 0 && ranges[0].IndexCount == mesh.Indices32.size());
+}
+
+// The skull of the app: building the meshlets, their cache order, and culling them.
+BENCHMARK(MeshletBuilder_Skull)
+{
+	GeometryGenerator::StaticMeshData skull;
+	CHECK(LoadSkull(&skull));
+	float optimizedACMR = MeshOptimizer::CalculateACMR(skull.Indices32.data(), skull.Indices32.size(), skull.Vertices.size());
+
+	vector<Meshlet> meshlets;
+	GeometryGenerator::StaticMeshData mesh;
+	double buildMilliseconds = MeasureMilliseconds(3, [&]()
+	{
+		mesh = skull;
+		MeshletBuilder::Build(&mesh, mesh.Indices32.size(), &meshlets);
+	});
+	float meshletACMR = MeshOptimizer::CalculateACMR(mesh.Indices32.data(), mesh.Indices32.size(), mesh.Vertices.size());
+	UINT coneCount = 0;
+	for (const Meshlet &meshlet : meshlets)
+		coneCount += (meshlet.ConeCutoff < 1.0f);
+	TestRegistry::ReportValue("Building the meshlets of " + to_string(mesh.Indices32.size() / 3) + " triangles", buildMilliseconds, "ms");
+	TestRegistry::ReportValue("Meshlets", (double)meshlets.size(), "meshlets");
+	TestRegistry::ReportValue("Meshlets with a cone", coneCount, "meshlets");
+	TestRegistry::ReportValue("ACMR of the meshlets", meshletACMR, "");
+	TestRegistry::ReportValue("ACMR of the optimized mesh", optimizedACMR, "");
+
+	BoundingSphere bounds;
+	BoundingSphere::CreateFromPoints(bounds, mesh.Vertices.size(), &mesh.Vertices[0].Position, sizeof(GeometryGenerator::StaticVertex));
+	const UINT viewCount = 64;
+	vector<BoundingFrustum> frustums;
+	for (UINT view = 0; view < viewCount; ++view)
+	{
+		float angle = XM_2PI * view / viewCount;
+		XMFLOAT3 eye(bounds.Center.x + 3.0f * bounds.Radius * cosf(angle), bounds.Center.y, bounds.Center.z + 3.0f * bounds.Radius * sinf(angle));
+		frustums.push_back(CreateFrustum(eye, bounds.Center, XM_PIDIV4));
+	}
+	vector<IndexRange> ranges;
+	size_t visibleIndices = 0;
+	double cullMilliseconds = MeasureMilliseconds(3, [&]()
+	{
+		visibleIndices = 0;
+		for (const BoundingFrustum &frustum : frustums)
+		{
+			MeshletBuilder::Cull(meshlets, frustum, XMFLOAT3(1.0f, 1.0f, 1.0f), &ranges);
+			for (const IndexRange &range : ranges)
+				visibleIndices += range.IndexCount;
+		}
+	});
+	TestRegistry::ReportValue("Culling per view", cullMilliseconds * 1000.0 / viewCount, "us");
+	TestRegistry::ReportValue("Triangles drawn from around the skull", 100.0 * visibleIndices / ((double)viewCount * mesh.Indices32.size()), "%");
+}
@@ -0,0 +1,155 @@
+#include "TestFramework.h"
+#include <MetricsSampler.h>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	const MetricSummary &GetMetric(const vector<MetricSummary> &summary, Metric metric)
+	{
+		return summary[(uint32_t)metric];
+	}
+
+	// Keeps the thread busy for the given time, so the process uses about as much CPU time.
+	void Spin(double milliseconds)
+	{
+		auto start = chrono::steady_clock::now();
+		while (chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() < milliseconds)
+			;
+	}
+
+	vector<string> ReadLines(const string &path)
+	{
+		ifstream file(path, ios::in);
+		vector<string> lines;
+		string line;
+		while (getline(file, line))
+			lines.push_back(line);
+		return lines;
+	}
+}
+
+// Nearest rank percentiles of the frame times, in any order they were sampled in.
+TEST(MetricsSampler_FrameTimePercentiles)
+{
+	vector<double> frameTimes;
+	for (uint32_t i = 1; i <= 200; ++i)
+		frameTimes.push_back(i * 0.5);
+	shuffle(frameTimes.begin(), frameTimes.end(), mt19937(1));
+
+	MetricsSampler sampler(1000);
+	for (double frameTime : frameTimes)
+		sampler.Sample(frameTime);
+
+	vector<MetricSummary> summary;
+	sampler.GetSummary(&summary);
+	CHECK(summary.size() == (size_t)Metric::Count);
+	const MetricSummary &frameTime = GetMetric(summary, Metric::FrameTime);
+	CHECK(frameTime.Name == "FrameTime" && frameTime.Unit == "ms");
+	CHECK(frameTime.Count == 200 && frameTime.Last == frameTimes.back());
+	CHECK(frameTime.P50 == 50.0 && frameTime.P95 == 95.0 && frameTime.P99 == 99.0 && frameTime.Max == 100.0);
+}
+
+// Only the latest samples are kept, Clear drops them all.
+TEST(MetricsSampler_RingBuffer)
+{
+	MetricsSampler sampler(10);
+	CHECK(sampler.GetHistorySize() == 10 && sampler.GetSampleCount() == 0);
+	vector<MetricSummary> summary;
+	sampler.GetSummary(&summary);
+	CHECK(GetMetric(summary, Metric::FrameTime).Count == 0 && GetMetric(summary, Metric::FrameTime).Max == 0.0);
+
+	for (uint32_t i = 1; i <= 25; ++i)
+		sampler.Sample((double)i);
+	CHECK(sampler.GetSampleCount() == 10);
+	sampler.GetSummary(&summary);
+	const MetricSummary &frameTime = GetMetric(summary, Metric::FrameTime);
+	CHECK(frameTime.Count == 10 && frameTime.Last == 25.0 && frameTime.P50 == 20.0 && frameTime.Max == 25.0);
+
+	sampler.Clear();
+	CHECK(sampler.GetSampleCount() == 0);
+	sampler.Sample(3.0);
+	sampler.GetSummary(&summary);
+	CHECK(GetMetric(summary, Metric::FrameTime).Count == 1 && GetMetric(summary, Metric::FrameTime).Max == 3.0);
+}
+
+// The counters of the process follow the work done between the samples.
+TEST(MetricsSampler_ProcessCounters)
+{
+	MetricsSampler sampler;
+	Spin(50.0);
+	sampler.Sample(50.0);
+
+	// Touching fresh memory makes it resident, a page at a time
+	const size_t size = 64 * 1024 * 1024;
+	unique_ptr<char[]> memory(new char[size]);
+	for (size_t i = 0; i < size; i += 4096)
+		memory[i] = (char)i;
+	this_thread::sleep_for(chrono::milliseconds(5));
+	sampler.Sample(5.0);
+
+	vector<MetricSummary> summary;
+	sampler.GetSummary(&summary);
+	const MetricSummary &cpuTime = GetMetric(summary, Metric::CpuTime), &resident = GetMetric(summary, Metric::ResidentMemory);
+	const MetricSummary &pageFaults = GetMetric(summary, Metric::PageFaults), &contextSwitches = GetMetric(summary, Metric::ContextSwitches);
+	TestRegistry::ReportValue("CPU time of 50 ms of spinning", cpuTime.Max, "ms");
+	TestRegistry::ReportValue("Page faults of 64 MB", pageFaults.Last, "faults");
+	CHECK(cpuTime.Max >= 30.0 && cpuTime.Max <= 200.0);
+	CHECK(resident.Last >= 64.0 && resident.Last - resident.P50 >= 48.0);
+	CHECK(pageFaults.Last >= size / 4096 / 2);
+	CHECK(contextSwitches.Last >= 1.0);
+	CHECK(memory[4096] == (char)4096);
+}
+
+// The files have a row or an array entry per kept sample.
+TEST(MetricsSampler_Export)
+{
+	MetricsSampler sampler(4);
+	for (uint32_t i = 1; i <= 6; ++i)
+		sampler.Sample(i * 2.0);
+
+	string csvPath = GetTemporaryFilePath("SpeckTests_metrics.csv");
+	string jsonPath = GetTemporaryFilePath("SpeckTests_metrics.json");
+	CHECK(sampler.ExportCSV(csvPath));
+	CHECK(sampler.ExportJSON(jsonPath));
+	vector<string> csv = ReadLines(csvPath);
+	vector<string> json = ReadLines(jsonPath);
+	remove(csvPath.c_str());
+	remove(jsonPath.c_str());
+
+	CHECK(csv.size() == 5);
+	CHECK(!csv.empty() && csv[0] == "Time,FrameTime,CpuTime,ResidentMemory,PageFaults,ContextSwitches");
+	CHECK(csv.size() == 5 && csv[1].find(",6.000,") != string::npos && csv[4].find(",12.000,") != string::npos);
+
+	string jsonText;
+	for (const string &line : json)
+		jsonText += line + "\n";
+	CHECK(jsonText.find("{\"summary\":[") == 0);
+	CHECK(jsonText.find("{\"name\":\"FrameTime\",\"unit\":\"ms\",\"count\":4,\"last\":12.000,\"p50\":8.000,") != string::npos);
+	CHECK(jsonText.find("\"FrameTime\":[6.000,8.000,10.000,12.000]") != string::npos);
+	CHECK(jsonText.size() > 4 && jsonText.compare(jsonText.size() - 4, 4, "\n}}\n") == 0);
+
+	CHECK(!sampler.ExportCSV("NoSuchDirectory/metrics.csv") && !sampler.ExportJSON("NoSuchDirectory/metrics.json"));
+}
+
+// Cost of a sample, paid every frame.
+BENCHMARK(MetricsSampler_Sample)
+{
+	MetricsSampler sampler;
+	const uint32_t count = 10000;
+	double sampling = MeasureMilliseconds(5, [&]()
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			sampler.Sample(16.7);
+	});
+	vector<MetricSummary> summary;
+	double summarizing = MeasureMilliseconds(5, [&]() { sampler.GetSummary(&summary); });
+	TestRegistry::ReportValue("Sample", sampling * 1000.0 / count, "us");
+	TestRegistry::ReportValue("Summary of " + to_string(sampler.GetSampleCount()) + " samples", summarizing, "ms");
+}
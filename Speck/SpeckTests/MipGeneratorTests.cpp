@@ -0,0 +1,249 @@
+#include "TestFramework.h"
+#include <MipGenerator.h>
+#include <WorkerPool.h>
+#include <random>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	MipGenerator::Settings CreateSettings(MipGenerator::Filter filter, bool wrap)
+	{
+		MipGenerator::Settings settings;
+		settings.filter = filter;
+		settings.wrap = wrap;
+		return settings;
+	}
+
+	vector<uint8_t> CreateRandomImage(UINT width, UINT height, unsigned int seed)
+	{
+		mt19937 random(seed);
+		uniform_int_distribution<int> value(0, 255);
+		vector<uint8_t> rgba(width * height * 4);
+		for (uint8_t &channel : rgba)
+			channel = (uint8_t)value(random);
+		return rgba;
+	}
+
+	// One channel of a mip, for the golden images.
+	vector<uint8_t> GetChannel(const MipGenerator::Mip &mip, UINT channel)
+	{
+		vector<uint8_t> values;
+		for (size_t i = channel; i < mip.rgba.size(); i += 4)
+			values.push_back(mip.rgba[i]);
+		return values;
+	}
+
+	double KaiserReference(double t)
+	{
+		// Three texels of the smaller mip wide, alpha of 4
+		double r = t / 3.0;
+		if (fabs(r) >= 1.0)
+			return 0.0;
+		double sinc = (fabs(t) < 1e-9) ? 1.0 : sin(3.14159265358979323846 * t) / (3.14159265358979323846 * t);
+		return sinc * cyl_bessel_i(0.0, 4.0 * sqrt(1.0 - r * r)) / cyl_bessel_i(0.0, 4.0);
+	}
+
+	// Kaiser filtered mip of a linear image in double precision, written out as the 2D sum.
+	vector<double> DownsampleReference(const vector<double> &src, UINT width, UINT height, bool wrap)
+	{
+		UINT dstWidth = max<UINT>(1, width / 2), dstHeight = max<UINT>(1, height / 2);
+		double scaleX = (double)width / dstWidth, scaleY = (double)height / dstHeight;
+		vector<double> dst(dstWidth * dstHeight * 4, 0.0);
+		for (UINT y = 0; y < dstHeight; ++y)
+		{
+			for (UINT x = 0; x < dstWidth; ++x)
+			{
+				double centerX = (x + 0.5) * scaleX, centerY = (y + 0.5) * scaleY;
+				double weightSum = 0.0;
+				for (int sy = (int)floor(centerY - 3.0 * scaleY); sy <= (int)ceil(centerY + 3.0 * scaleY); ++sy)
+				{
+					for (int sx = (int)floor(centerX - 3.0 * scaleX); sx <= (int)ceil(centerX + 3.0 * scaleX); ++sx)
+					{
+						double weight = KaiserReference((sx + 0.5 - centerX) / scaleX) * KaiserReference((sy + 0.5 - centerY) / scaleY);
+						int ix = wrap ? (sx % (int)width + (int)width) % (int)width : min(max(sx, 0), (int)width - 1);
+						int iy = wrap ? (sy % (int)height + (int)height) % (int)height : min(max(sy, 0), (int)height - 1);
+						for (UINT ch = 0; ch < 4; ++ch)
+							dst[(y * dstWidth + x) * 4 + ch] += weight * src[(iy * width + ix) * 4 + ch];
+						weightSum += weight;
+					}
+				}
+				for (UINT ch = 0; ch < 4; ++ch)
+					dst[(y * dstWidth + x) * 4 + ch] /= weightSum;
+			}
+		}
+		return dst;
+	}
+
+	// Largest difference of a generated mip chain from the reference one.
+	int GetKaiserError(const vector<uint8_t> &rgba, UINT width, UINT height, bool wrap)
+	{
+		vector<MipGenerator::Mip> mips;
+		MipGenerator::Generate(rgba.data(), width, height, width * 4, CreateSettings(MipGenerator::Filter::Kaiser, wrap), nullptr, &mips);
+
+		vector<double> reference(rgba.begin(), rgba.end());
+		int maxError = 0;
+		for (size_t i = 1; i < mips.size(); ++i)
+		{
+			reference = DownsampleReference(reference, width, height, wrap);
+			width = max<UINT>(1, width / 2);
+			height = max<UINT>(1, height / 2);
+			CHECK(mips[i].width == width && mips[i].height == height);
+			for (size_t j = 0; j < reference.size(); ++j)
+			{
+				int expected = (int)(min(max(reference[j], 0.0), 255.0) + 0.5);
+				maxError = max(maxError, abs(mips[i].rgba[j] - expected));
+			}
+		}
+		return maxError;
+	}
+}
+
+TEST(MipGenerator_MipCount)
+{
+	CHECK(MipGenerator::GetMipCount(1, 1) == 1);
+	CHECK(MipGenerator::GetMipCount(2048, 2048) == 12);
+	CHECK(MipGenerator::GetMipCount(5, 1) == 3);
+	CHECK(MipGenerator::GetMipCount(3, 200) == 8);
+}
+
+// Box filtered mips worked out by hand.
+TEST(MipGenerator_BoxGolden)
+{
+	const uint8_t red[16] =
+	{
+		0, 40, 100, 200,
+		20, 60, 120, 220,
+		255, 255, 0, 10,
+		255, 255, 30, 51
+	};
+	vector<uint8_t> rgba(16 * 4);
+	for (UINT i = 0; i < 16; ++i)
+	{
+		rgba[i * 4 + 0] = red[i];
+		rgba[i * 4 + 1] = 255 - red[i];
+		rgba[i * 4 + 2] = 10;
+		rgba[i * 4 + 3] = 255;
+	}
+
+	vector<MipGenerator::Mip> mips;
+	MipGenerator::Generate(rgba.data(), 4, 4, 4 * 4, CreateSettings(MipGenerator::Filter::Box, true), nullptr, &mips);
+	CHECK(mips.size() == 3);
+	CHECK(mips[0].rgba == rgba);
+	CHECK(mips[1].width == 2 && mips[1].height == 2);
+	CHECK(GetChannel(mips[1], 0) == vector<uint8_t>({ 30, 160, 255, 23 }));
+	CHECK(GetChannel(mips[1], 1) == vector<uint8_t>({ 225, 95, 0, 232 }));
+	CHECK(GetChannel(mips[1], 2) == vector<uint8_t>(4, 10));
+	CHECK(GetChannel(mips[1], 3) == vector<uint8_t>(4, 255));
+	// The last mip is filtered from the unrounded one, 116.94 and 138.06
+	CHECK(mips[2].width == 1 && mips[2].height == 1);
+	CHECK(mips[2].rgba == vector<uint8_t>({ 117, 138, 10, 255 }));
+
+	// Odd sizes use the coverage, the middle texel of 5 counts half for both of the 2 texels
+	const uint8_t row[5] = { 0, 50, 100, 150, 250 };
+	rgba.assign(5 * 4, 0);
+	for (UINT i = 0; i < 5; ++i)
+		rgba[i * 4] = row[i];
+	MipGenerator::Generate(rgba.data(), 5, 1, 5 * 4, CreateSettings(MipGenerator::Filter::Box, false), nullptr, &mips);
+	CHECK(mips.size() == 3);
+	CHECK(mips[1].width == 2 && mips[1].height == 1 && GetChannel(mips[1], 0) == vector<uint8_t>({ 40, 180 }));
+	CHECK(mips[2].width == 1 && mips[2].height == 1 && GetChannel(mips[2], 0) == vector<uint8_t>({ 110 }));
+}
+
+// A black and white checkerboard averages to half of the light, which is 188 in sRGB.
+TEST(MipGenerator_SRGBGolden)
+{
+	vector<uint8_t> rgba(8 * 8 * 4);
+	for (UINT y = 0; y < 8; ++y)
+	{
+		for (UINT x = 0; x < 8; ++x)
+		{
+			uint8_t value = ((x + y) % 2) ? 255 : 0;
+			uint8_t *texel = &rgba[(y * 8 + x) * 4];
+			texel[0] = texel[1] = texel[2] = texel[3] = value;
+		}
+	}
+
+	MipGenerator::Settings settings = CreateSettings(MipGenerator::Filter::Box, true);
+	vector<MipGenerator::Mip> mips;
+	MipGenerator::Generate(rgba.data(), 8, 8, 8 * 4, settings, nullptr, &mips);
+	for (size_t i = 1; i < mips.size(); ++i)
+		CHECK(mips[i].rgba == vector<uint8_t>(mips[i].width * mips[i].height * 4, 128));
+
+	// Alpha stays linear
+	settings.sRGB = true;
+	MipGenerator::Generate(rgba.data(), 8, 8, 8 * 4, settings, nullptr, &mips);
+	for (size_t i = 1; i < mips.size(); ++i)
+	{
+		for (size_t j = 0; j < mips[i].rgba.size(); j += 4)
+			CHECK(mips[i].rgba[j] == 188 && mips[i].rgba[j + 1] == 188 && mips[i].rgba[j + 2] == 188 && mips[i].rgba[j + 3] == 128);
+	}
+}
+
+// The Kaiser filter against a direct evaluation of it in double precision.
+TEST(MipGenerator_KaiserMatchesReference)
+{
+	CHECK(GetKaiserError(CreateRandomImage(32, 16, 1), 32, 16, true) <= 1);
+	CHECK(GetKaiserError(CreateRandomImage(32, 16, 2), 32, 16, false) <= 1);
+	CHECK(GetKaiserError(CreateRandomImage(13, 7, 3), 13, 7, true) <= 1);
+	CHECK(GetKaiserError(CreateRandomImage(13, 7, 4), 13, 7, false) <= 1);
+
+	// A constant image stays constant with both filters
+	vector<uint8_t> rgba(12 * 12 * 4);
+	for (size_t i = 0; i < rgba.size(); ++i)
+		rgba[i] = (uint8_t)(50 + 40 * (i % 4));
+	for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser })
+	{
+		vector<MipGenerator::Mip> mips;
+		MipGenerator::Generate(rgba.data(), 12, 12, 12 * 4, CreateSettings(filter, false), nullptr, &mips);
+		CHECK(mips.back().rgba == vector<uint8_t>({ 50, 90, 130, 170 }));
+	}
+}
+
+// Filtered normals are unit length again, the worker pool gives the same mips.
+TEST(MipGenerator_NormalsAndWorkerPool)
+{
+	vector<uint8_t> rgba = CreateRandomImage(64, 32, 5);
+	for (size_t i = 0; i < rgba.size(); i += 4)
+		rgba[i + 2] = max<uint8_t>(rgba[i + 2], 128); // normals away from the surface
+
+	MipGenerator::Settings settings = CreateSettings(MipGenerator::Filter::Kaiser, true);
+	settings.normalMap = true;
+	vector<MipGenerator::Mip> serial, parallel;
+	MipGenerator::Generate(rgba.data(), 64, 32, 64 * 4, settings, nullptr, &serial);
+	for (size_t i = 1; i < serial.size(); ++i)
+	{
+		for (size_t j = 0; j < serial[i].rgba.size(); j += 4)
+		{
+			float n[3];
+			for (UINT ch = 0; ch < 3; ++ch)
+				n[ch] = serial[i].rgba[j + ch] / 255.0f * 2.0f - 1.0f;
+			CHECK_NEAR(sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]), 1.0f, 0.01f);
+		}
+	}
+
+	WorkerPool workerPool;
+	MipGenerator::Generate(rgba.data(), 64, 32, 64 * 4, settings, &workerPool, &parallel);
+	CHECK(serial.size() == parallel.size());
+	for (size_t i = 0; i < serial.size() && i < parallel.size(); ++i)
+		CHECK(serial[i].rgba == parallel[i].rgba);
+}
+
+// The full chain of a 2048x2048 texture, the size of the textures of the app.
+BENCHMARK(MipGenerator_Chain)
+{
+	vector<uint8_t> rgba = CreateRandomImage(2048, 2048, 6);
+	WorkerPool workerPool;
+	for (MipGenerator::Filter filter : { MipGenerator::Filter::Box, MipGenerator::Filter::Kaiser })
+	{
+		MipGenerator::Settings settings = CreateSettings(filter, true);
+		settings.sRGB = true;
+		vector<MipGenerator::Mip> mips;
+		double serial = MeasureMilliseconds(2, [&]() { MipGenerator::Generate(rgba.data(), 2048, 2048, 2048 * 4, settings, nullptr, &mips); });
+		double parallel = MeasureMilliseconds(2, [&]() { MipGenerator::Generate(rgba.data(), 2048, 2048, 2048 * 4, settings, &workerPool, &mips); });
+		string name = (filter == MipGenerator::Filter::Box) ? "Box" : "Kaiser";
+		TestRegistry::ReportValue(name, serial, "ms");
+		TestRegistry::ReportValue(name + " with the worker pool", parallel, "ms");
+	}
+}
@@ -0,0 +1,211 @@
+#include "TestFramework.h"
+#include <OcclusionCuller.h>
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	// Camera at the origin looking along +z, as wide as the depth buffer.
+	XMFLOAT4X4 CreateViewProj()
+	{
+		XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV2, (float)OcclusionCuller::Width / OcclusionCuller::Height, 0.1f, 200.0f);
+		XMFLOAT4X4 viewProj;
+		XMStoreFloat4x4(&viewProj, XMMatrixMultiply(view, proj));
+		return viewProj;
+	}
+
+	XMFLOAT4X4 CreateTranslation(float x, float y, float z)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixTranslation(x, y, z));
+		return world;
+	}
+
+	// Unit quad in the xy plane facing the camera (clockwise seen from -z), scaled to the size of the wall.
+	struct Wall
+	{
+		XMFLOAT3 positions[4];
+		uint16_t indices16[6] = { 0, 1, 2, 0, 2, 3 };
+		uint32_t indices32[6] = { 0, 1, 2, 0, 2, 3 };
+
+		Wall(float halfWidth, float halfHeight)
+		{
+			positions[0] = XMFLOAT3(-halfWidth, -halfHeight, 0.0f);
+			positions[1] = XMFLOAT3(-halfWidth, halfHeight, 0.0f);
+			positions[2] = XMFLOAT3(halfWidth, halfHeight, 0.0f);
+			positions[3] = XMFLOAT3(halfWidth, -halfHeight, 0.0f);
+		}
+	};
+
+	// True if the box is completely behind the wall at the distance wallZ, seen from the origin.
+	bool IsHiddenByWall(const BoundingBox &box, float halfWidth, float halfHeight, float wallZ)
+	{
+		XMFLOAT3 corners[8];
+		box.GetCorners(corners);
+		for (const XMFLOAT3 &corner : corners)
+		{
+			if (corner.z <= wallZ)
+				return false;
+			// The box projects to the hull of its corners, the wall is convex
+			float scale = wallZ / corner.z;
+			if (fabsf(corner.x * scale) > halfWidth || fabsf(corner.y * scale) > halfHeight)
+				return false;
+		}
+		return true;
+	}
+
+	vector<BoundingBox> CreateBoxes(UINT count, unsigned int seed)
+	{
+		mt19937 random(seed);
+		uniform_real_distribution<float> x(-60.0f, 60.0f), y(-30.0f, 30.0f), z(1.0f, 100.0f), extent(0.1f, 3.0f);
+		vector<BoundingBox> boxes(count);
+		for (BoundingBox &box : boxes)
+		{
+			box.Center = XMFLOAT3(x(random), y(random), z(random));
+			box.Extents = XMFLOAT3(extent(random), extent(random), extent(random));
+		}
+		return boxes;
+	}
+}
+
+// Boxes behind a wall are occluded, the ones beside it, in front of it or across the near plane are not.
+TEST(OcclusionCuller_Wall)
+{
+	Wall wall(10.0f, 4.0f);
+	OcclusionCuller culler;
+	culler.Begin(CreateViewProj());
+	culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices16, false, 6, CreateTranslation(0.0f, 0.0f, 10.0f));
+	culler.End();
+
+	CHECK(culler.IsOccluded(BoundingBox(XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+	CHECK(culler.IsOccluded(BoundingBox(XMFLOAT3(-5.0f, 2.0f, 50.0f), XMFLOAT3(3.0f, 3.0f, 3.0f))));
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(0.0f, 0.0f, 10.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(30.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(19.0f, 0.0f, 20.0f), XMFLOAT3(2.0f, 1.0f, 1.0f))));
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(0.0f, 0.0f, -20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(500.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+
+	// The next frame starts empty
+	culler.Begin(CreateViewProj());
+	culler.End();
+	CHECK(!culler.IsOccluded(BoundingBox(XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))));
+}
+
+// Back faces are not rasterized, both index sizes are read.
+TEST(OcclusionCuller_OccluderFaces)
+{
+	Wall wall(10.0f, 4.0f);
+	BoundingBox behind(XMFLOAT3(0.0f, 0.0f, 20.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	OcclusionCuller culler;
+
+	culler.Begin(CreateViewProj());
+	culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices32, true, 6, CreateTranslation(0.0f, 0.0f, 10.0f));
+	culler.End();
+	CHECK(culler.IsOccluded(behind));
+
+	// Turned around, the wall faces away from the camera
+	XMFLOAT4X4 turned;
+	XMStoreFloat4x4(&turned, XMMatrixRotationY(XM_PI) * XMMatrixTranslation(0.0f, 0.0f, 10.0f));
+	culler.Begin(CreateViewProj());
+	culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices16, false, 6, turned);
+	culler.End();
+	CHECK(!culler.IsOccluded(behind));
+
+	// Crossing the near plane, the triangles are skipped
+	culler.Begin(CreateViewProj());
+	XMFLOAT4X4 tilted;
+	XMStoreFloat4x4(&tilted, XMMatrixRotationX(1.4f) * XMMatrixTranslation(0.0f, 0.0f, 1.0f));
+	culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices16, false, 6, tilted);
+	culler.End();
+	CHECK(!culler.IsOccluded(behind));
+}
+
+// Every level keeps the farthest depth of the 2x2 texels under it.
+TEST(OcclusionCuller_Hierarchy)
+{
+	Wall wall(3.0f, 2.0f);
+	OcclusionCuller culler;
+	culler.Begin(CreateViewProj());
+	culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices16, false, 6, CreateTranslation(-4.0f, 1.0f, 10.0f));
+	XMFLOAT4X4 tilted;
+	XMStoreFloat4x4(&tilted, XMMatrixRotationY(0.5f) * XMMatrixTranslation(5.0f, -1.0f, 20.0f));
+	culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices16, false, 6, tilted);
+	culler.End();
+
+	CHECK(culler.GetLevelCount() == 9);
+	UINT covered = 0;
+	for (UINT i = 0; i < OcclusionCuller::Width * OcclusionCuller::Height; ++i)
+		covered += culler.GetDepths(0)[i] < 1.0f;
+	CHECK(covered > 0);
+	UINT width = OcclusionCuller::Width, height = OcclusionCuller::Height;
+	for (UINT level = 1; level < culler.GetLevelCount(); ++level)
+	{
+		const float *source = culler.GetDepths(level - 1), *target = culler.GetDepths(level);
+		UINT targetWidth = max(1U, width / 2), targetHeight = max(1U, height / 2);
+		for (UINT y = 0; y < targetHeight; ++y)
+		{
+			for (UINT x = 0; x < targetWidth; ++x)
+			{
+				UINT x0 = min(2 * x, width - 1), x1 = min(2 * x + 1, width - 1), y0 = min(2 * y, height - 1), y1 = min(2 * y + 1, height - 1);
+				float expected = max(max(source[y0 * width + x0], source[y0 * width + x1]), max(source[y1 * width + x0], source[y1 * width + x1]));
+				CHECK(target[y * targetWidth + x] == expected);
+			}
+		}
+		width = targetWidth;
+		height = targetHeight;
+	}
+}
+
+// Random boxes around a wall: none of the visible ones is culled, most of the hidden ones are.
+TEST(OcclusionCuller_Conservative)
+{
+	const float halfWidth = 10.0f, halfHeight = 4.0f, wallZ = 10.0f;
+	Wall wall(halfWidth, halfHeight);
+	OcclusionCuller culler;
+	culler.Begin(CreateViewProj());
+	culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices16, false, 6, CreateTranslation(0.0f, 0.0f, wallZ));
+	culler.End();
+
+	UINT hidden = 0, culled = 0;
+	for (const BoundingBox &box : CreateBoxes(10000, 1))
+	{
+		bool isHidden = IsHiddenByWall(box, halfWidth, halfHeight, wallZ);
+		bool isOccluded = culler.IsOccluded(box);
+		CHECK(isHidden || !isOccluded);
+		hidden += isHidden;
+		culled += isHidden && isOccluded;
+	}
+	TestRegistry::ReportValue("Hidden boxes culled", 100.0 * culled / hidden, "%");
+	CHECK(hidden > 1000 && culled > hidden * 85 / 100);
+}
+
+// A wall in front of 10000 random boxes.
+BENCHMARK(OcclusionCuller_RandomBoxes)
+{
+	Wall wall(10.0f, 4.0f);
+	XMFLOAT4X4 viewProj = CreateViewProj(), world = CreateTranslation(0.0f, 0.0f, 10.0f);
+	vector<BoundingBox> boxes = CreateBoxes(10000, 2);
+	OcclusionCuller culler;
+	double rasterize = MeasureMilliseconds(100, [&]()
+	{
+		culler.Begin(viewProj);
+		culler.RasterizeOccluder(&wall.positions[0].x, sizeof(XMFLOAT3), wall.indices16, false, 6, world);
+		culler.End();
+	});
+	UINT occluded = 0;
+	double test = MeasureMilliseconds(10, [&]()
+	{
+		occluded = 0;
+		for (const BoundingBox &box : boxes)
+			occluded += culler.IsOccluded(box);
+	});
+	TestRegistry::ReportValue("Occluder and hierarchy", rasterize * 1000.0, "us");
+	TestRegistry::ReportValue("Testing " + to_string(boxes.size()) + " boxes", test, "ms");
+	TestRegistry::ReportValue("Occluded", occluded, "boxes");
+}
@@ -0,0 +1,194 @@
+#include "TestFramework.h"
+#include <Profiler.h>
+#include <intrin.h>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	// Keeps the thread busy for the given time, so the zone around it lasts at least that long.
+	void Spin(double microseconds)
+	{
+		auto start = chrono::steady_clock::now();
+		while (chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() < microseconds)
+			;
+	}
+
+	const ProfileZoneSummary *FindZone(const vector<ProfileZoneSummary> &summary, const char *name)
+	{
+		for (const ProfileZoneSummary &zone : summary)
+		{
+			if (zone.Name == name)
+				return &zone;
+		}
+		return nullptr;
+	}
+
+	string ReadFile(const wstring &path)
+	{
+		ifstream file(path, ios::in | ios::binary);
+		return string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	}
+}
+
+// Nested zones keep their depths, their durations are summarized in the order the zones were first seen.
+TEST(Profiler_Summary)
+{
+	Profiler::Clear();
+	for (UINT frame = 0; frame < 5; ++frame)
+	{
+		PROFILE_ZONE("Frame");
+		for (UINT i = 0; i < 10; ++i)
+		{
+			PROFILE_ZONE("Update");
+			Spin(20.0);
+		}
+	}
+
+	vector<ProfileZoneSummary> summary;
+	Profiler::GetSummary(&summary);
+	CHECK(summary.size() == 2);
+	const ProfileZoneSummary *frame = FindZone(summary, "Frame"), *update = FindZone(summary, "Update");
+	CHECK(frame && update);
+	if (!frame || !update)
+		return;
+	CHECK(summary[0].Name == "Update");
+	CHECK(frame->Count == 5 && frame->Depth == 0);
+	CHECK(update->Count == 50 && update->Depth == 1);
+	CHECK(update->P50 >= 15.0 && frame->P50 >= 10 * update->P50 * 0.9);
+	CHECK(update->P50 <= update->P95 && update->P95 <= update->P99 && update->P99 <= update->Max);
+
+	Profiler::Clear();
+	Profiler::GetSummary(&summary);
+	CHECK(summary.empty());
+}
+
+// Only the latest events of a thread are kept, the events of every thread are read.
+TEST(Profiler_RingBufferAndThreads)
+{
+	Profiler::Clear();
+	for (UINT i = 0; i < Profiler::RingBufferSize + 100; ++i)
+	{
+		PROFILE_ZONE("Zone");
+	}
+	vector<thread> threads;
+	for (UINT t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([]()
+		{
+			for (UINT i = 0; i < 100; ++i)
+			{
+				PROFILE_ZONE("Worker zone");
+			}
+		});
+	}
+	for (thread &thread : threads)
+		thread.join();
+
+	vector<ProfileZoneSummary> summary;
+	Profiler::GetSummary(&summary);
+	const ProfileZoneSummary *zone = FindZone(summary, "Zone"), *workerZone = FindZone(summary, "Worker zone");
+	CHECK(zone && zone->Count == Profiler::RingBufferSize - 1);
+	CHECK(workerZone && workerZone->Count == 400 && workerZone->Depth == 0);
+	Profiler::Clear();
+}
+
+// The events are read while a thread keeps overwriting them, the events being overwritten are not read. A torn event
+// would show as a negative duration, which wraps around to a huge one.
+TEST(Profiler_ReadWhileWriting)
+{
+	Profiler::Clear();
+	atomic<bool> stop = { false };
+	thread writer([&]()
+	{
+		// Goes around the buffer at least twice, even if the reads are done first
+		for (UINT i = 0; i < 2 * Profiler::RingBufferSize || !stop.load(memory_order_relaxed); ++i)
+		{
+			PROFILE_ZONE("Overwritten zone");
+		}
+	});
+
+	vector<ProfileZoneSummary> summary;
+	for (UINT i = 0; i < 200; ++i)
+	{
+		Profiler::GetSummary(&summary);
+		const ProfileZoneSummary *zone = FindZone(summary, "Overwritten zone");
+		if (!zone)
+			continue;
+		CHECK(zone->Count < Profiler::RingBufferSize && zone->Depth == 0);
+		CHECK(zone->Max < 1e6);
+	}
+	stop = true;
+	writer.join();
+
+	// Once the writer is done all of the buffer but the next slot is read
+	Profiler::GetSummary(&summary);
+	const ProfileZoneSummary *zone = FindZone(summary, "Overwritten zone");
+	CHECK(zone && zone->Count == Profiler::RingBufferSize - 1);
+	Profiler::Clear();
+}
+
+// The trace has the thread names and the complete events, the names of the zones are escaped.
+TEST(Profiler_ChromeTrace)
+{
+	Profiler::Clear();
+	{
+		PROFILE_ZONE("Outer");
+		PROFILE_ZONE("Quoted \"zone\"");
+		Spin(10.0);
+	}
+	wstring path = GetTemporaryFilePath(L"SpeckTests_trace.json");
+	CHECK(Profiler::ExportChromeTrace(path));
+	string trace = ReadFile(path);
+	DeleteFileW(path.c_str());
+	Profiler::Clear();
+
+	CHECK(trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+	CHECK(trace.find("\"ph\":\"M\"") != string::npos);
+	CHECK(trace.find("{\"name\":\"Outer\",\"ph\":\"X\"") != string::npos);
+	CHECK(trace.find("{\"name\":\"Quoted \\\"zone\\\"\",\"ph\":\"X\"") != string::npos);
+	CHECK(trace.size() > 4 && trace.compare(trace.size() - 4, 4, "\n]}\n") == 0);
+	CHECK(!Profiler::ExportChromeTrace(L"NoSuchDirectory/trace.json"));
+}
+
+// Cost of an empty zone, the time stamps and the write to the ring buffer of the thread. The two reads of the
+// time stamp counter alone are timed too, they are much slower in some virtual machines.
+BENCHMARK(Profiler_ZoneOverhead)
+{
+	const UINT count = 1000000;
+	Profiler::Clear();
+	volatile UINT64 timeStamp = 0;
+	double timeStamps = MeasureMilliseconds(10, [&]()
+	{
+		for (UINT i = 0; i < count; ++i)
+		{
+			timeStamp = __rdtsc();
+			timeStamp = __rdtsc();
+		}
+	});
+	double zones = MeasureMilliseconds(10, [&]()
+	{
+		for (UINT i = 0; i < count; ++i)
+		{
+			PROFILE_ZONE("Empty");
+		}
+	});
+	double nested = MeasureMilliseconds(10, [&]()
+	{
+		for (UINT i = 0; i < count / 4; ++i)
+		{
+			PROFILE_ZONE("Outer");
+			PROFILE_ZONE("Middle");
+			PROFILE_ZONE("Inner");
+			PROFILE_ZONE("Innermost");
+		}
+	});
+	Profiler::Clear();
+	// The target is under 50 ns per zone
+	TestRegistry::ReportValue("Zone", zones * 1e6 / count, "ns");
+	TestRegistry::ReportValue("Zone nested four deep", nested * 1e6 / count, "ns");
+	TestRegistry::ReportValue("Two time stamps alone", timeStamps * 1e6 / count, "ns");
+}
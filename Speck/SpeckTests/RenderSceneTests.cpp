@@ -0,0 +1,131 @@
+#include "TestFramework.h"
+#include <RenderScene.h>
+#include <FrameResource.h>
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// The constants are written to real upload buffers, of the software adapter so the tests run on any machine.
+	ComPtr<ID3D12Device> CreateWarpDevice()
+	{
+		ComPtr<IDXGIFactory4> factory;
+		ComPtr<IDXGIAdapter> warpAdapter;
+		ComPtr<ID3D12Device> device;
+		THROW_IF_FAILED(CreateDXGIFactory1(IID_PPV_ARGS(&factory)));
+		THROW_IF_FAILED(factory->EnumWarpAdapter(IID_PPV_ARGS(&warpAdapter)));
+		THROW_IF_FAILED(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device)));
+		return device;
+	}
+
+	// Half static items and half speck rigid bodies at random places, each with its own constants.
+	void AddItems(RenderScene &scene, PBRMaterial *material, UINT count, vector<RenderItemHandle> *outHandles)
+	{
+		mt19937 random(1);
+		uniform_real_distribution<float> position(-500.0f, 500.0f);
+		for (UINT i = 0; i < count; ++i)
+		{
+			Transform transform = Transform::Identity();
+			transform.mT = XMFLOAT3(position(random), position(random), position(random));
+			if (i % 2 == 0)
+			{
+				StaticRenderItem item;
+				item.mMat = material;
+				item.mRenderItemBufferIndex = i;
+				item.mW = transform;
+				outHandles->push_back(scene.Add(item));
+			}
+			else
+			{
+				SpeckRigidBodyRenderItem item;
+				item.mMat = material;
+				item.mRenderItemBufferIndex = i;
+				item.mL = transform;
+				item.mSpeckRigidBodyIndex = i / 2;
+				outHandles->push_back(scene.Add(item));
+			}
+		}
+	}
+}
+
+// An item stays in the dirty list until all the frame resources got its constants, and is listed only once.
+TEST(RenderScene_DirtyItems)
+{
+	ComPtr<ID3D12Device> device = CreateWarpDevice();
+	FrameResource frameResource(device.Get(), 1, 16, 1);
+	PBRMaterial material;
+	material.MatCBIndex = 0;
+
+	RenderScene scene;
+	vector<RenderItemHandle> handles;
+	AddItems(scene, &material, 4, &handles);
+	CHECK(scene.GetCount(RenderItemKind::Static) == 2 && scene.GetCount(RenderItemKind::SpeckRigidBody) == 2);
+	CHECK(scene.GetDirtyCount() == 4);
+
+	for (UINT frame = 0; frame < NUM_FRAME_RESOURCES; ++frame)
+	{
+		CHECK(scene.GetDirtyCount() == 4);
+		scene.UpdateConstants(&frameResource);
+	}
+	CHECK(scene.GetDirtyCount() == 0);
+	scene.UpdateConstants(&frameResource);
+	CHECK(scene.GetDirtyCount() == 0);
+
+	// Marking a dirty item again restarts its frames without listing it twice
+	scene.MarkDirty(handles[1]);
+	scene.UpdateConstants(&frameResource);
+	scene.MarkDirty(handles[1]);
+	scene.MarkDirty(handles[2]);
+	CHECK(scene.GetDirtyCount() == 2);
+	for (UINT frame = 0; frame < NUM_FRAME_RESOURCES - 1; ++frame)
+		scene.UpdateConstants(&frameResource);
+	CHECK(scene.GetDirtyCount() == 2);
+	scene.UpdateConstants(&frameResource);
+	CHECK(scene.GetDirtyCount() == 0);
+	CHECK(scene.Get(handles[1]).mNumFramesDirty == 0 && scene.Get(handles[0]).mNumFramesDirty == 0);
+}
+
+// 50k items: the upload of all of them, as the constants of every item were written every frame before the
+// render scene, against the frames where none or 100 of them changed.
+BENCHMARK(RenderScene_50kItems)
+{
+	const UINT count = 50000;
+	ComPtr<ID3D12Device> device = CreateWarpDevice();
+	FrameResource frameResource(device.Get(), 1, count, 1);
+	PBRMaterial material;
+	material.MatCBIndex = 0;
+
+	RenderScene scene;
+	vector<RenderItemHandle> handles;
+	AddItems(scene, &material, count, &handles);
+	for (UINT frame = 0; frame < NUM_FRAME_RESOURCES; ++frame)
+		scene.UpdateConstants(&frameResource);
+
+	double all = MeasureMilliseconds(20, [&]()
+	{
+		for (RenderItemHandle handle : handles)
+			scene.MarkDirty(handle);
+		scene.UpdateConstants(&frameResource);
+	});
+	for (UINT frame = 0; frame < NUM_FRAME_RESOURCES; ++frame)
+		scene.UpdateConstants(&frameResource);
+
+	double idle = MeasureMilliseconds(20, [&]() { scene.UpdateConstants(&frameResource); });
+	CHECK(scene.GetDirtyCount() == 0);
+
+	UINT next = 0;
+	double changed = MeasureMilliseconds(20, [&]()
+	{
+		for (UINT i = 0; i < 100; ++i, next = (next + 997) % count)
+			scene.MarkDirty(handles[next]);
+		scene.UpdateConstants(&frameResource);
+	});
+	string items = to_string(count) + " items";
+	TestRegistry::ReportValue(items + ", all changed", all, "ms");
+	TestRegistry::ReportValue(items + ", 100 changed", changed * 1000.0, "us");
+	TestRegistry::ReportValue(items + ", none changed", idle * 1000.0, "us");
+}
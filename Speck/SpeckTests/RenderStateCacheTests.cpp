@@ -0,0 +1,173 @@
+#include "TestFramework.h"
+#include <RenderStateCache.h>
+#include <DrawList.h>
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	enum class Command { PipelineState, VertexBuffer, IndexBuffer, PrimitiveTopology, DescriptorHeap, DescriptorTable, ConstantBufferView, ShaderResourceView, Draw, Count };
+
+	// Counts the commands that reach the command list.
+	class CountingCommandList : public DrawCommandList
+	{
+	public:
+		void SetPipelineState(ID3D12PipelineState *pso) override { Count(Command::PipelineState); }
+		void IASetVertexBuffer(const D3D12_VERTEX_BUFFER_VIEW &view) override { Count(Command::VertexBuffer); }
+		void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW &view) override { Count(Command::IndexBuffer); }
+		void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override { Count(Command::PrimitiveTopology); }
+		void SetDescriptorHeap(ID3D12DescriptorHeap *heap) override { Count(Command::DescriptorHeap); }
+		void SetGraphicsRootDescriptorTable(UINT rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override { Count(Command::DescriptorTable); }
+		void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override { Count(Command::ConstantBufferView); }
+		void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override { Count(Command::ShaderResourceView); }
+		void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation,
+			int baseVertexLocation, UINT startInstanceLocation) override { Count(Command::Draw); }
+
+		UINT Get(Command command) const { return mCounts[(UINT)command]; }
+		UINT GetTotal() const
+		{
+			UINT total = 0;
+			for (UINT count : mCounts)
+				total += count;
+			return total;
+		}
+		void Reset() { fill(begin(mCounts), end(mCounts), 0); }
+
+	private:
+		void Count(Command command) { ++mCounts[(UINT)command]; }
+
+		UINT mCounts[(UINT)Command::Count] = {};
+	};
+
+	// The cache only compares the objects, these stand-ins are never dereferenced.
+	template <typename T>
+	T *FakeObject(UINT64 id)
+	{
+		return reinterpret_cast<T *>(id * 256);
+	}
+
+	D3D12_GPU_DESCRIPTOR_HANDLE FakeDescriptor(UINT64 id)
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE handle;
+		handle.ptr = id * 256;
+		return handle;
+	}
+
+	// An item of a frame, bound the way the render items bind themselves.
+	struct Item
+	{
+		UINT PSO;
+		UINT Material;
+		UINT Constants;
+	};
+
+	void RecordItem(RenderStateCache &state, const Item &item)
+	{
+		state.SetPipelineState(FakeObject<ID3D12PipelineState>(item.PSO + 1));
+		state.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		state.SetDescriptorHeap(FakeObject<ID3D12DescriptorHeap>(1));
+		state.SetGraphicsRootDescriptorTable(3, FakeDescriptor(item.Material + 1));
+		state.SetGraphicsRootConstantBufferView(0, (item.Constants + 1) * 256);
+		state.DrawIndexedInstanced(36, 1, 0, 0, 0);
+	}
+}
+
+// Binding the same state again does not reach the command list, the draws always do.
+TEST(RenderStateCache_DropsRedundantCommands)
+{
+	CountingCommandList commandList;
+	RenderStateCache state(&commandList);
+	for (UINT i = 0; i < 2; ++i)
+	{
+		state.SetPipelineState(FakeObject<ID3D12PipelineState>(1));
+		state.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		state.SetDescriptorHeap(FakeObject<ID3D12DescriptorHeap>(1));
+		state.SetGraphicsRootDescriptorTable(3, FakeDescriptor(1));
+		state.SetGraphicsRootConstantBufferView(0, 256);
+		state.SetGraphicsRootShaderResourceView(1, 512);
+		state.DrawIndexedInstanced(36, 1, 0, 0, 0);
+	}
+	CHECK(commandList.Get(Command::PipelineState) == 1 && commandList.Get(Command::PrimitiveTopology) == 1);
+	CHECK(commandList.Get(Command::DescriptorHeap) == 1 && commandList.Get(Command::DescriptorTable) == 1);
+	CHECK(commandList.Get(Command::ConstantBufferView) == 1 && commandList.Get(Command::ShaderResourceView) == 1);
+	CHECK(commandList.Get(Command::Draw) == 2);
+	CHECK(commandList.GetTotal() == 8);
+	CHECK(state.GetDroppedCount() == 6);
+
+	// Only the changed parameter is bound, the other parameters keep their values
+	commandList.Reset();
+	state.SetGraphicsRootConstantBufferView(0, 768);
+	state.SetGraphicsRootShaderResourceView(1, 512);
+	state.SetGraphicsRootDescriptorTable(3, FakeDescriptor(1));
+	state.SetPipelineState(FakeObject<ID3D12PipelineState>(2));
+	state.SetPipelineState(FakeObject<ID3D12PipelineState>(1));
+	CHECK(commandList.Get(Command::ConstantBufferView) == 1 && commandList.Get(Command::PipelineState) == 2);
+	CHECK(commandList.GetTotal() == 3);
+	CHECK(state.GetDroppedCount() == 8);
+}
+
+// A new descriptor heap makes the tables bound before it unknown, not the root views.
+TEST(RenderStateCache_HeapChangeRebindsTables)
+{
+	CountingCommandList commandList;
+	RenderStateCache state(&commandList);
+	state.SetDescriptorHeap(FakeObject<ID3D12DescriptorHeap>(1));
+	state.SetGraphicsRootDescriptorTable(3, FakeDescriptor(1));
+	state.SetGraphicsRootDescriptorTable(4, FakeDescriptor(2));
+	state.SetGraphicsRootConstantBufferView(0, 256);
+
+	commandList.Reset();
+	state.SetDescriptorHeap(FakeObject<ID3D12DescriptorHeap>(2));
+	state.SetGraphicsRootDescriptorTable(3, FakeDescriptor(1));
+	state.SetGraphicsRootDescriptorTable(4, FakeDescriptor(2));
+	state.SetGraphicsRootConstantBufferView(0, 256);
+	CHECK(commandList.Get(Command::DescriptorHeap) == 1 && commandList.Get(Command::DescriptorTable) == 2);
+	CHECK(commandList.Get(Command::ConstantBufferView) == 0);
+
+	// After the command list was used past the cache, everything is bound again
+	commandList.Reset();
+	state.Invalidate();
+	state.SetDescriptorHeap(FakeObject<ID3D12DescriptorHeap>(2));
+	state.SetGraphicsRootDescriptorTable(3, FakeDescriptor(1));
+	state.SetGraphicsRootConstantBufferView(0, 256);
+	state.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	CHECK(commandList.GetTotal() == 4);
+}
+
+// Items of a frame in random order and sorted by their keys: sorted, the state changes only between the groups.
+TEST(RenderStateCache_SortedDraws)
+{
+	const UINT count = 20000, psoCount = 3, materialCount = 64;
+	mt19937 random(1);
+	uniform_int_distribution<UINT> pso(0, psoCount - 1), material(0, materialCount - 1);
+	vector<Item> items(count);
+	DrawList drawList;
+	for (UINT i = 0; i < count; ++i)
+	{
+		items[i] = { pso(random), material(random), i };
+		drawList.Add(DrawList::MakeKey(items[i].PSO, items[i].Material, 0, 0.5f), RenderItemHandle{ RenderItemKind::Static, i });
+	}
+
+	CountingCommandList unsorted;
+	RenderStateCache unsortedState(&unsorted);
+	for (const Item &item : items)
+		RecordItem(unsortedState, item);
+
+	drawList.Sort();
+	CountingCommandList sorted;
+	RenderStateCache sortedState(&sorted);
+	for (size_t i = 0; i < drawList.GetCount(); ++i)
+		RecordItem(sortedState, items[drawList.GetItem(i).Index]);
+
+	TestRegistry::ReportValue("Unsorted items", unsorted.GetTotal(), "commands");
+	TestRegistry::ReportValue("Sorted items", sorted.GetTotal(), "commands");
+	CHECK(sorted.Get(Command::Draw) == count && unsorted.Get(Command::Draw) == count);
+	CHECK(sorted.Get(Command::PipelineState) == psoCount);
+	CHECK(sorted.Get(Command::DescriptorTable) <= psoCount * materialCount);
+	CHECK(sorted.Get(Command::PrimitiveTopology) == 1 && sorted.Get(Command::DescriptorHeap) == 1);
+	CHECK(sorted.Get(Command::ConstantBufferView) == count);
+	CHECK(sorted.GetTotal() < unsorted.GetTotal() && unsorted.GetTotal() < count * 6);
+}
@@ -0,0 +1,154 @@
+#include "TestFramework.h"
+#include <ResourceLoader.h>
+#include <TextMeshLoader.h>
+#include <WorkerPool.h>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using namespace Speck::AppCommands;
+
+namespace
+{
+	// Stands in for the GPU, records the calls in their order.
+	class MockUploader : public ResourceUploader
+	{
+	public:
+		void Begin() override { mCalls.push_back("Begin"); }
+		void Upload(LoadedResource &resource) override
+		{
+			// Only the loaded resources get here, the textures with their files still mapped
+			CHECK(resource.loaded);
+			CHECK(resource.resType != ResourceType::Texture || (resource.file && resource.file->IsOpen()));
+			mCalls.push_back(resource.name);
+		}
+		void End() override { mCalls.push_back("End"); }
+
+		vector<string> mCalls;
+	};
+
+	const wchar_t *gTexturePaths[] =
+	{
+		L"Data/Textures/spaced-tiles1/spaced-tiles1-albedo.dds",
+		L"Data/Textures/spaced-tiles1/spaced-tiles1-normal.dds",
+		L"Data/Textures/spaced-tiles1/spaced-tiles1-height.dds",
+		L"Data/Textures/spaced-tiles1/spaced-tiles1-metalness.dds",
+		L"Data/Textures/spaced-tiles1/spaced-tiles1-rough.dds",
+		L"Data/Textures/spaced-tiles1/spaced-tiles1-ao.dds"
+	};
+
+	LoadedResource CreateRequest(const string &name, const wstring &path, ResourceType resType, UINT residentMipCount = 0)
+	{
+		LoadedResource resource;
+		resource.name = name;
+		resource.path = path;
+		resource.resType = resType;
+		resource.residentMipCount = residentMipCount;
+		return resource;
+	}
+
+	// The PBR set of ManySkeletonsTestingState and the models of the app.
+	vector<LoadedResource> CreateLevelRequests()
+	{
+		vector<LoadedResource> resources;
+		for (const wchar_t *path : gTexturePaths)
+			resources.push_back(CreateRequest("texture" + to_string(resources.size()), path, ResourceType::Texture, 4));
+		resources.push_back(CreateRequest("skull", L"Data/Models/skull.txt", ResourceType::Geometry));
+		resources.push_back(CreateRequest("car", L"Data/Models/car.txt", ResourceType::Geometry));
+		return resources;
+	}
+
+	void WriteFile(const wstring &path, const string &data)
+	{
+		ofstream file(path, ios::out | ios::binary | ios::trunc);
+		file.write(data.data(), data.size());
+	}
+}
+
+// Everything is loaded before the uploads start, the failed resources are counted and skipped.
+TEST(ResourceLoader_UploadsAfterLoading)
+{
+	wstring shaderPath = GetTemporaryFilePath(L"SpeckTests_shader.cso");
+	wstring truncatedPath = GetTemporaryFilePath(L"SpeckTests_truncated.dds");
+	const string shaderData("DXBC\0\1\2\3", 8);
+	WriteFile(shaderPath, shaderData);
+	ifstream texture("Data/Textures/spaced-tiles1/spaced-tiles1-ao.dds", ios::in | ios::binary);
+	string textureData((istreambuf_iterator<char>(texture)), istreambuf_iterator<char>());
+	CHECK(textureData.size() > 4096);
+	WriteFile(truncatedPath, textureData.substr(0, textureData.size() - 4096));
+
+	vector<LoadedResource> resources;
+	resources.push_back(CreateRequest("albedo", gTexturePaths[0], ResourceType::Texture, 4));
+	resources.push_back(CreateRequest("missing", L"Data/Textures/missing.dds", ResourceType::Texture));
+	resources.push_back(CreateRequest("skull", L"Data/Models/skull.txt", ResourceType::Geometry));
+	resources.push_back(CreateRequest("truncated", truncatedPath, ResourceType::Texture));
+	resources.push_back(CreateRequest("shader", shaderPath, ResourceType::Shader));
+	resources.push_back(CreateRequest("missingMesh", L"Data/Models/missing.txt", ResourceType::Geometry));
+
+	MockUploader uploader;
+	CHECK(ResourceLoader::Load(resources, nullptr, &uploader) == 3);
+	CHECK(uploader.mCalls == vector<string>({ "Begin", "albedo", "skull", "shader", "End" }));
+
+	// Only the layout of the texture is read, the data stays in the mapped file
+	const DDSTextureLayout &layout = resources[0].textureLayout;
+	CHECK(layout.format == DXGI_FORMAT_BC1_UNORM && layout.width == 2048 && layout.mipCount == 12);
+	CHECK(layout.GetFirstResidentMip(resources[0].residentMipCount) == 8);
+	CHECK(layout.subresources[0].data >= resources[0].file->GetData() &&
+		layout.subresources.back().data < resources[0].file->GetData() + resources[0].file->GetSize());
+	CHECK(resources[2].mesh.Vertices.size() > 0 && resources[2].lods.size() == TextMeshLoader::LODCount - 1);
+	CHECK(resources[4].shader && resources[4].shader->GetBufferSize() == shaderData.size());
+	CHECK(resources[4].shader && memcmp(resources[4].shader->GetBufferPointer(), shaderData.data(), shaderData.size()) == 0);
+
+	resources.clear();
+	DeleteFileW(shaderPath.c_str());
+	DeleteFileW(truncatedPath.c_str());
+}
+
+// An empty batch still begins and ends, the app waits for its GPU work once either way.
+TEST(ResourceLoader_EmptyBatch)
+{
+	vector<LoadedResource> resources;
+	MockUploader uploader;
+	CHECK(ResourceLoader::Load(resources, nullptr, &uploader) == 0);
+	CHECK(uploader.mCalls == vector<string>({ "Begin", "End" }));
+}
+
+// The worker pool only spreads the resources over the threads, the results are the same.
+TEST(ResourceLoader_WorkerPoolMatchesSerial)
+{
+	vector<LoadedResource> serial = CreateLevelRequests();
+	vector<LoadedResource> parallel = CreateLevelRequests();
+	ResourceLoader::LoadCPU(serial, nullptr);
+	WorkerPool workerPool;
+	MockUploader uploader;
+	CHECK(ResourceLoader::Load(parallel, &workerPool, &uploader) == 0);
+	CHECK(uploader.mCalls.size() == parallel.size() + 2);
+
+	for (size_t i = 0; i < serial.size(); ++i)
+	{
+		CHECK(serial[i].loaded && parallel[i].loaded);
+		CHECK(serial[i].textureLayout.subresources.size() == parallel[i].textureLayout.subresources.size());
+		CHECK(serial[i].mesh.Indices32 == parallel[i].mesh.Indices32);
+		CHECK(serial[i].mesh.Vertices.size() == parallel[i].mesh.Vertices.size());
+		CHECK(memcmp(&serial[i].bounds, &parallel[i].bounds, sizeof(BoundingBox)) == 0);
+	}
+}
+
+// The CPU side of a level load: the PBR set with four resident mips and both models.
+BENCHMARK(ResourceLoader_LoadLevel)
+{
+	WorkerPool workerPool;
+	double serial = MeasureMilliseconds(3, [&]()
+	{
+		vector<LoadedResource> resources = CreateLevelRequests();
+		ResourceLoader::LoadCPU(resources, nullptr);
+	});
+	double parallel = MeasureMilliseconds(3, [&]()
+	{
+		vector<LoadedResource> resources = CreateLevelRequests();
+		ResourceLoader::LoadCPU(resources, &workerPool);
+	});
+	string resources = to_string(CreateLevelRequests().size()) + " resources";
+	TestRegistry::ReportValue(resources, serial, "ms");
+	TestRegistry::ReportValue(resources + " with " + to_string(workerPool.GetThreadCount()) + " worker threads", parallel, "ms");
+}
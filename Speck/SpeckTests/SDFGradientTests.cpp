@@ -0,0 +1,250 @@
+#include "TestFramework.h"
+#include <SDFGradient.h>
+#include <WorkerPool.h>
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using namespace Speck::WorldCommands;
+
+namespace
+{
+	const float gSpeckRadius = 0.5f;
+
+	// Box of specks touching each other, the first speck at the origin.
+	vector<NewSpeck> CreateBox(UINT sizeX, UINT sizeY, UINT sizeZ)
+	{
+		vector<NewSpeck> specks;
+		for (UINT z = 0; z < sizeZ; ++z)
+			for (UINT y = 0; y < sizeY; ++y)
+				for (UINT x = 0; x < sizeX; ++x)
+				{
+					NewSpeck speck;
+					speck.position = XMFLOAT3(x * 2.0f * gSpeckRadius, y * 2.0f * gSpeckRadius, z * 2.0f * gSpeckRadius);
+					specks.push_back(speck);
+				}
+		return specks;
+	}
+
+	// Ball of specks on the same grid, centered at the origin.
+	vector<NewSpeck> CreateBall(int radius)
+	{
+		vector<NewSpeck> specks;
+		for (int z = -radius; z <= radius; ++z)
+			for (int y = -radius; y <= radius; ++y)
+				for (int x = -radius; x <= radius; ++x)
+				{
+					if (x * x + y * y + z * z > radius * radius)
+						continue;
+					NewSpeck speck;
+					speck.position = XMFLOAT3(x * 2.0f * gSpeckRadius, y * 2.0f * gSpeckRadius, z * 2.0f * gSpeckRadius);
+					specks.push_back(speck);
+				}
+		return specks;
+	}
+
+	// Union of a few ellipsoids of specks on the same grid, at random places and with random sizes.
+	vector<NewSpeck> CreateRandomBody(mt19937 &random)
+	{
+		uniform_int_distribution<int> ellipsoidCount(1, 3), center(-4, 4);
+		uniform_real_distribution<float> radius(1.5f, 6.0f);
+		XMFLOAT3 centers[3], radii[3];
+		int count = ellipsoidCount(random);
+		for (int e = 0; e < count; ++e)
+		{
+			centers[e] = XMFLOAT3((float)center(random), (float)center(random), (float)center(random));
+			radii[e] = XMFLOAT3(radius(random), radius(random), radius(random));
+		}
+
+		vector<NewSpeck> specks;
+		for (int z = -10; z <= 10; ++z)
+			for (int y = -10; y <= 10; ++y)
+				for (int x = -10; x <= 10; ++x)
+				{
+					bool inside = false;
+					for (int e = 0; e < count && !inside; ++e)
+					{
+						float dx = (x - centers[e].x) / radii[e].x, dy = (y - centers[e].y) / radii[e].y, dz = (z - centers[e].z) / radii[e].z;
+						inside = (dx * dx + dy * dy + dz * dz <= 1.0f);
+					}
+					if (!inside)
+						continue;
+					NewSpeck speck;
+					speck.position = XMFLOAT3(x * 2.0f * gSpeckRadius, y * 2.0f * gSpeckRadius, z * 2.0f * gSpeckRadius);
+					specks.push_back(speck);
+				}
+		return specks;
+	}
+
+	// The gradients as AddSpecksCommand calculated them before SDFGradient, over all the pairs of specks.
+	vector<XMFLOAT3> CalculateReference(const vector<NewSpeck> &specks, float speckRadius)
+	{
+		vector<XMFLOAT3> gradients(specks.size());
+		float maxDist = speckRadius * 2.0f * 1.2f;
+		float maxDistSq = maxDist * maxDist;
+		for (size_t i = 0; i < specks.size(); ++i)
+		{
+			XMVECTOR gradient1 = XMVectorZero();
+			XMVECTOR gradient2 = XMVectorZero();
+			XMVECTOR pos = XMLoadFloat3(&specks[i].position);
+			for (size_t j = 0; j < specks.size(); ++j)
+			{
+				if (i == j) continue;
+				XMVECTOR r = pos - XMLoadFloat3(&specks[j].position);
+				float lenSq = XMVectorGetX(XMVector3LengthSq(r));
+				gradient1 += r * (1.0f / powf(lenSq, 10.0f));
+				if (lenSq < maxDistSq)
+					gradient2 += r;
+			}
+			gradient1 = XMVector3Normalize(gradient1);
+			if (XMVectorGetX(XMVector3LengthEst(gradient2)) > 0.001f)
+				gradient1 *= 2.0f;
+			XMStoreFloat3(&gradients[i], gradient1);
+		}
+		return gradients;
+	}
+
+	float Length(const XMFLOAT3 &v)
+	{
+		return XMVectorGetX(XMVector3Length(XMLoadFloat3(&v)));
+	}
+}
+
+// Only the specks on the surface of the box are boundary specks, the gradients point out of the closest face,
+// also inside of the box.
+TEST(SDFGradient_BoxBoundary)
+{
+	const UINT size = 7;
+	vector<NewSpeck> specks = CreateBox(size, size, size);
+	vector<XMFLOAT3> gradients;
+	SDFGradient::Calculate(specks, gSpeckRadius, nullptr, &gradients);
+	CHECK(gradients.size() == specks.size());
+
+	UINT boundaryCount = 0;
+	for (UINT z = 0; z < size; ++z)
+		for (UINT y = 0; y < size; ++y)
+			for (UINT x = 0; x < size; ++x)
+			{
+				const XMFLOAT3 &gradient = gradients[(z * size + y) * size + x];
+				bool onSurface = (x == 0 || y == 0 || z == 0 || x == size - 1 || y == size - 1 || z == size - 1);
+				// The gradient of the speck in the middle is undetermined
+				if (onSurface)
+					CHECK_NEAR(Length(gradient), 2.0f, 1e-3f);
+				else
+					CHECK(Length(gradient) < 1.001f);
+				boundaryCount += onSurface ? 1 : 0;
+
+				// Direction out of the closest face, where there is only one
+				int distances[6] = { (int)x, (int)(size - 1 - x), (int)y, (int)(size - 1 - y), (int)z, (int)(size - 1 - z) };
+				int closest = (int)(min_element(distances, distances + 6) - distances);
+				if (count(distances, distances + 6, distances[closest]) != 1)
+					continue;
+				XMFLOAT3 outward(0.0f, 0.0f, 0.0f);
+				(&outward.x)[closest / 2] = (closest % 2 == 0) ? -1.0f : 1.0f;
+				float cosine = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&gradient)), XMLoadFloat3(&outward)));
+				CHECK(cosine > 0.95f);
+			}
+	CHECK(boundaryCount == size * size * size - (size - 2) * (size - 2) * (size - 2));
+}
+
+// The gradients on the surface of a ball point away from its center.
+TEST(SDFGradient_BallPointsOutwards)
+{
+	const int radius = 8;
+	vector<NewSpeck> specks = CreateBall(radius);
+	vector<XMFLOAT3> gradients;
+	SDFGradient::Calculate(specks, gSpeckRadius, nullptr, &gradients);
+
+	UINT boundaryCount = 0;
+	float worstCosine = 1.0f;
+	for (size_t i = 0; i < specks.size(); ++i)
+	{
+		float length = Length(gradients[i]);
+		CHECK(length > 0.999f);
+		if (length < 1.5f)
+			continue;
+		++boundaryCount;
+		XMVECTOR radial = XMVector3Normalize(XMLoadFloat3(&specks[i].position));
+		worstCosine = min(worstCosine, XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&gradients[i])), radial)));
+	}
+	TestRegistry::ReportValue("Boundary specks", boundaryCount, "");
+	TestRegistry::ReportValue("Worst cosine to the radial direction", worstCosine, "");
+	CHECK(boundaryCount > 0);
+	CHECK(worstCosine > 0.8f);
+}
+
+// On random bodies the boundary specks are the same as with the old gradients over all the pairs, and the gradients
+// of the boundary specks point out of the body the same way.
+TEST(SDFGradient_RandomBodiesMatchReference)
+{
+	mt19937 random(1);
+	UINT boundaryCount = 0, disagreeingCount = 0;
+	double cosineSum = 0.0;
+	for (UINT body = 0; body < 20; ++body)
+	{
+		vector<NewSpeck> specks = CreateRandomBody(random);
+		vector<XMFLOAT3> gradients;
+		SDFGradient::Calculate(specks, gSpeckRadius, nullptr, &gradients);
+		vector<XMFLOAT3> reference = CalculateReference(specks, gSpeckRadius);
+		for (size_t i = 0; i < specks.size(); ++i)
+		{
+			bool isBoundary = Length(gradients[i]) > 1.5f;
+			CHECK(isBoundary == (Length(reference[i]) > 1.5f));
+			if (!isBoundary)
+				continue;
+			float cosine = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&gradients[i])), XMVector3Normalize(XMLoadFloat3(&reference[i]))));
+			cosineSum += cosine;
+			disagreeingCount += (cosine < 0.0f);
+			++boundaryCount;
+		}
+	}
+	TestRegistry::ReportValue("Boundary specks", boundaryCount, "");
+	TestRegistry::ReportValue("Mean cosine to the reference", cosineSum / boundaryCount, "");
+	TestRegistry::ReportValue("Boundary specks pointing the other way", disagreeingCount, "");
+	CHECK(boundaryCount > 0);
+	CHECK(cosineSum / boundaryCount > 0.8);
+	CHECK(disagreeingCount <= boundaryCount / 100);
+}
+
+TEST(SDFGradient_NoSpecks)
+{
+	vector<NewSpeck> specks;
+	vector<XMFLOAT3> gradients(3);
+	SDFGradient::Calculate(specks, gSpeckRadius, nullptr, &gradients);
+	CHECK(gradients.empty());
+}
+
+// The worker pool only splits the work, the results are the same.
+TEST(SDFGradient_WorkerPoolMatchesSerial)
+{
+	vector<NewSpeck> specks = CreateBall(10);
+	vector<XMFLOAT3> serial, parallel;
+	SDFGradient::Calculate(specks, gSpeckRadius, nullptr, &serial);
+	WorkerPool workerPool;
+	SDFGradient::Calculate(specks, gSpeckRadius, &workerPool, &parallel);
+	CHECK(serial.size() == parallel.size());
+	for (size_t i = 0; i < serial.size() && i < parallel.size(); ++i)
+		CHECK(memcmp(&serial[i], &parallel[i], sizeof(XMFLOAT3)) == 0);
+}
+
+// Boxes of 1k, 10k and 50k specks, against the gradients over all the pairs up to 10k specks.
+BENCHMARK(SDFGradient_Bodies)
+{
+	WorkerPool workerPool;
+	for (UINT size : { 10U, 22U, 37U })
+	{
+		vector<NewSpeck> specks = CreateBox(size, size, size);
+		vector<XMFLOAT3> gradients;
+		double serial = MeasureMilliseconds(3, [&]() { SDFGradient::Calculate(specks, gSpeckRadius, nullptr, &gradients); });
+		double parallel = MeasureMilliseconds(3, [&]() { SDFGradient::Calculate(specks, gSpeckRadius, &workerPool, &gradients); });
+		string name = to_string(specks.size()) + " specks";
+		TestRegistry::ReportValue(name, serial, "ms");
+		TestRegistry::ReportValue(name + " with the worker pool", parallel, "ms");
+		if (specks.size() <= 20000)
+		{
+			double reference = MeasureMilliseconds(1, [&]() { gradients = CalculateReference(specks, gSpeckRadius); });
+			TestRegistry::ReportValue(name + " over all the pairs", reference, "ms");
+		}
+	}
+}
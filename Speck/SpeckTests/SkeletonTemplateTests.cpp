@@ -0,0 +1,114 @@
+#include "TestFramework.h"
+#include "SkeletonTemplate.h"
+#include "SpeckAssetFile.h"
+#include "SpeckAssetCooker.h"
+#include "FBXSceneManager.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	const wchar_t *gKnightFbx = L"Data/Animations/knight_idle.fbx";
+	const wchar_t *gKnightBody = L"Data/Animations/knight.json";
+
+	// Cooks the knight into the temporary directory, so the tests do not depend on the packages next to the FBX files.
+	wstring CookKnight()
+	{
+		wstring assetPath = GetTemporaryFilePath(L"SpeckTests_knight_idle.speckasset");
+		FBXSceneManager sceneManager;
+		if (!SpeckAssetCooker::Cook(&sceneManager, gKnightFbx, assetPath.c_str()))
+			return wstring();
+		return assetPath;
+	}
+
+	// The CPU side of HumanoidSkeleton::CreateSpecksBody: the commands of a skeleton get copies of the specks of the
+	// bones and joints. Sending them to the world needs a device and costs the same with or without the template.
+	size_t CopySpecks(const SkeletonTemplate &skeletonTemplate)
+	{
+		size_t speckCount = 0;
+		WorldCommands::AddSpecksCommand command;
+		for (const SkeletonTemplate::Bone &bone : skeletonTemplate.GetBones())
+		{
+			command.newSpecks = bone.specks;
+			speckCount += command.newSpecks.size();
+		}
+		for (const SkeletonTemplate::Joint &joint : skeletonTemplate.GetJoints())
+		{
+			command.newSpecks = joint.specks;
+			speckCount += command.newSpecks.size();
+		}
+		return speckCount;
+	}
+}
+
+// The bones of the knight are driven by the clip, the joints connect two of them and all the specks are counted.
+TEST(SkeletonTemplate_Knight)
+{
+	wstring assetPath = CookKnight();
+	CHECK(!assetPath.empty());
+	SpeckAssetFile asset;
+	CHECK(asset.Open(assetPath.c_str()));
+	SkeletonTemplate skeletonTemplate;
+	CHECK(skeletonTemplate.Build(asset, gKnightBody));
+	asset.Close();
+	DeleteFileW(assetPath.c_str());
+
+	const vector<SkeletonTemplate::Bone> &bones = skeletonTemplate.GetBones();
+	CHECK(!bones.empty() && !skeletonTemplate.GetJoints().empty());
+	UINT speckCount = 0, animatedCount = 0;
+	for (const SkeletonTemplate::Bone &bone : bones)
+	{
+		CHECK(!bone.specks.empty());
+		CHECK(bone.clipJointIndex >= -1 && bone.clipJointIndex < (int)skeletonTemplate.GetAnimationClip().GetJointCount());
+		animatedCount += (bone.clipJointIndex != -1);
+		speckCount += (UINT)bone.specks.size();
+	}
+	CHECK(animatedCount > 0);
+	for (const SkeletonTemplate::Joint &joint : skeletonTemplate.GetJoints())
+	{
+		CHECK(joint.parentBone < bones.size() && joint.childBone < bones.size() && joint.parentBone != joint.childBone);
+		speckCount += (UINT)joint.specks.size();
+	}
+	CHECK(skeletonTemplate.GetSpeckCount() == speckCount);
+	CHECK(CopySpecks(skeletonTemplate) == speckCount);
+}
+
+// Spawning 100 ragdolls: one template shared by all of them against a template built for each one, as the skeletons
+// did before the templates were shared.
+BENCHMARK(SkeletonTemplate_Spawn100)
+{
+	const UINT count = 100;
+	wstring assetPath = CookKnight();
+	CHECK(!assetPath.empty());
+	if (assetPath.empty())
+		return;
+
+	size_t speckCount = 0;
+	double perInstance = MeasureMilliseconds(3, [&]()
+	{
+		for (UINT i = 0; i < count; ++i)
+		{
+			SpeckAssetFile asset;
+			SkeletonTemplate skeletonTemplate;
+			asset.Open(assetPath.c_str());
+			skeletonTemplate.Build(asset, gKnightBody);
+			speckCount = CopySpecks(skeletonTemplate);
+		}
+	});
+	double shared = MeasureMilliseconds(3, [&]()
+	{
+		SpeckAssetFile asset;
+		SkeletonTemplate skeletonTemplate;
+		asset.Open(assetPath.c_str());
+		skeletonTemplate.Build(asset, gKnightBody);
+		for (UINT i = 0; i < count; ++i)
+			speckCount = CopySpecks(skeletonTemplate);
+	});
+	DeleteFileW(assetPath.c_str());
+
+	TestRegistry::ReportValue("Specks of a skeleton", (double)speckCount, "specks");
+	TestRegistry::ReportValue("100 skeletons, a template each", perInstance, "ms");
+	TestRegistry::ReportValue("100 skeletons, one shared template", shared, "ms");
+}
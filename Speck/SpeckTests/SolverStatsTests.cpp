@@ -0,0 +1,109 @@
+#include "TestFramework.h"
+#include <SolverStats.h>
+#include <random>
+#include <cstring>
+
+using namespace std;
+using namespace Speck;
+
+namespace
+{
+	UINT FloatBits(float value)
+	{
+		UINT bits;
+		memcpy(&bits, &value, sizeof(float));
+		return bits;
+	}
+}
+
+// The counts are passed on, the sums become averages per speck and substep, the maximum residuals are unpacked.
+TEST(SolverStats_Decode)
+{
+	SolverStatsData data = {};
+	data.frame = 42;
+	data.specks = 1000;
+	data.substeps = 4;
+	data.solverIterations = 3;
+	data.gridOverflowCount = 7;
+	data.speckContactsSum = 24000;
+	data.speckContactsMax = 12;
+	data.droppedSpeckContacts = 5;
+	data.droppedStaticColliderContacts = 6;
+	data.droppedRigidBodyConstraints = 8;
+	data.activeSpecks = 3000;
+	data.sleepingSpecks = 1000;
+	for (UINT i = 0; i < SOLVER_STATS_MAX_ITERATIONS; ++i)
+	{
+		data.residualSum[i] = (UINT)(4000 * SOLVER_STATS_RESIDUAL_SCALE) >> i;
+		data.residualMax[i] = FloatBits(0.5f / (i + 1));
+	}
+
+	SolverStats stats = DecodeSolverStats(data, 0.1f);
+	CHECK(stats.mFrame == 42 && stats.mSpecks == 1000 && stats.mSubsteps == 4 && stats.mSolverIterations == 3);
+	CHECK(stats.mGridOverflowCount == 7 && stats.mMaxSpeckContacts == 12);
+	CHECK(stats.mDroppedSpeckContacts == 5 && stats.mDroppedStaticColliderContacts == 6 && stats.mDroppedRigidBodyConstraints == 8);
+	CHECK_NEAR(stats.mAverageSpeckContacts, 6.0, 1e-6);
+	CHECK(stats.mActiveSpecks == 750 && stats.mSleepingSpecks == 250);
+
+	// A residual sum of one speck radius per speck and substep averages to the radius, halving with each iteration
+	CHECK_NEAR(stats.mAverageResidual[0], 0.1, 1e-6);
+	CHECK_NEAR(stats.mAverageResidual[1], 0.05, 1e-6);
+	CHECK_NEAR(stats.mAverageResidual[2], 0.025, 1e-6);
+	CHECK(stats.mMaxResidual[0] == 0.5f && stats.mMaxResidual[2] == 0.5f / 3);
+	// The iterations that were not run are left at zero
+	CHECK(stats.mAverageResidual[3] == 0.0f && stats.mMaxResidual[3] == 0.0f);
+}
+
+// Without specks or substeps there is nothing to average, the counts are still passed on.
+TEST(SolverStats_DecodeEmpty)
+{
+	SolverStatsData data = {};
+	data.frame = 3;
+	data.substeps = 4;
+	data.solverIterations = SOLVER_STATS_MAX_ITERATIONS + 10;
+	data.gridOverflowCount = 1;
+	data.residualSum[0] = 100;
+	SolverStats stats = DecodeSolverStats(data, 0.1f);
+	CHECK(stats.mFrame == 3 && stats.mGridOverflowCount == 1);
+	CHECK(stats.mAverageSpeckContacts == 0.0f && stats.mActiveSpecks == 0 && stats.mAverageResidual[0] == 0.0f);
+
+	// More iterations than are recorded only fill the recorded ones
+	data.specks = 10;
+	for (UINT i = 0; i < SOLVER_STATS_MAX_ITERATIONS; ++i)
+		data.residualSum[i] = 40 * (UINT)SOLVER_STATS_RESIDUAL_SCALE;
+	stats = DecodeSolverStats(data, 0.1f);
+	CHECK_NEAR(stats.mAverageResidual[SOLVER_STATS_MAX_ITERATIONS - 1], 0.1, 1e-6);
+}
+
+// The residuals of many specks summed in fixed point give their mean, with room to spare before the sum overflows.
+TEST(SolverStats_ResidualEncoding)
+{
+	const float speckRadius = 0.05f;
+	CHECK(EncodeSolverResidual(0.0f, speckRadius) == 0 && EncodeSolverResidual(-1.0f, speckRadius) == 0);
+	CHECK(EncodeSolverResidual(speckRadius, speckRadius) == (UINT)SOLVER_STATS_RESIDUAL_SCALE);
+	CHECK(EncodeSolverResidual(speckRadius * 0.5f, speckRadius) == (UINT)SOLVER_STATS_RESIDUAL_SCALE / 2);
+
+	// 100k specks over 4 substeps with corrections up to a tenth of the radius, as in a settling pile
+	const UINT specks = 100000, substeps = 4;
+	mt19937 random(1);
+	uniform_real_distribution<float> residual(0.0f, 0.1f * speckRadius);
+	SolverStatsData data = {};
+	data.specks = specks;
+	data.substeps = substeps;
+	data.solverIterations = 1;
+	double exactSum = 0.0;
+	UINT64 encodedSum = 0;
+	for (UINT i = 0; i < specks * substeps; ++i)
+	{
+		float r = residual(random);
+		exactSum += r;
+		encodedSum += EncodeSolverResidual(r, speckRadius);
+	}
+	CHECK(encodedSum < UINT_MAX);
+	data.residualSum[0] = (UINT)encodedSum;
+	SolverStats stats = DecodeSolverStats(data, speckRadius);
+	double exactMean = exactSum / (specks * substeps);
+	CHECK_NEAR(stats.mAverageResidual[0], exactMean, speckRadius * 1e-3);
+	TestRegistry::ReportValue("Residual mean error", fabs(stats.mAverageResidual[0] - exactMean) / speckRadius, "radii");
+	TestRegistry::ReportValue("Residual sum headroom", (double)UINT_MAX / encodedSum, "x");
+}
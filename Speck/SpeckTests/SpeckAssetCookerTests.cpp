@@ -0,0 +1,195 @@
+#include "TestFramework.h"
+#include "SpeckAssetCooker.h"
+#include "SpeckAssetFile.h"
+#include "FBXSceneManager.h"
+#include "FBXConversions.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+using namespace SpeckAssetFormat;
+
+namespace
+{
+	struct Influence
+	{
+		float Weight;
+		string LinkName;
+	};
+
+	// The strongest influences of every control point normalized to the sum of one, taken from the skin of the mesh.
+	vector<vector<Influence>> GetInfluences(FbxMesh *mesh)
+	{
+		vector<vector<Influence>> influences(mesh->GetControlPointsCount());
+		if (mesh->GetDeformerCount(FbxDeformer::eSkin) == 0)
+			return influences;
+		FbxSkin *skin = (FbxSkin *)mesh->GetDeformer(0, FbxDeformer::eSkin);
+		for (int c = 0; c < skin->GetClusterCount(); ++c)
+		{
+			FbxCluster *cluster = skin->GetCluster(c);
+			for (int i = 0; i < cluster->GetControlPointIndicesCount(); ++i)
+			{
+				double weight = cluster->GetControlPointWeights()[i];
+				if (weight > 0.0)
+					influences[cluster->GetControlPointIndices()[i]].push_back(Influence{ (float)weight, cluster->GetLink()->GetName() });
+			}
+		}
+		for (vector<Influence> &controlPoint : influences)
+		{
+			stable_sort(controlPoint.begin(), controlPoint.end(), [](const Influence &a, const Influence &b) { return a.Weight > b.Weight; });
+			if (controlPoint.size() > MAX_BONES_PER_VERTEX)
+				controlPoint.resize(MAX_BONES_PER_VERTEX);
+			float weightSum = 0.0f;
+			for (const Influence &influence : controlPoint)
+				weightSum += influence.Weight;
+			for (Influence &influence : controlPoint)
+				influence.Weight /= weightSum;
+		}
+		return influences;
+	}
+
+	float GetDistance(const XMFLOAT3 &a, const XMFLOAT3 &b)
+	{
+		return XMVectorGetX(XMVector3Length(XMLoadFloat3(&a) - XMLoadFloat3(&b)));
+	}
+
+	// Largest difference of the elements relative to the largest element
+	float GetMatrixError(const XMFLOAT4X4 &a, const XMFLOAT4X4 &b)
+	{
+		float error = 0.0f, extent = 1e-6f;
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+			{
+				error = max(error, fabsf(a.m[r][c] - b.m[r][c]));
+				extent = max(extent, fabsf(b.m[r][c]));
+			}
+		return error / extent;
+	}
+}
+
+// The cooked knight packages against the meshes taken from the FBX scenes directly: every corner of every polygon
+// is a vertex of the cooked triangles, with the four strongest weights, and the inverse bind poses are the same.
+TEST(SpeckAssetCooker_KnightMatchesFBX)
+{
+	FBXSceneManager sceneManager;
+	for (const wchar_t *fbxFilePath : { L"Data/Animations/knight_idle.fbx", L"Data/Animations/knight_jump.fbx", L"Data/Animations/knight_dancing.fbx" })
+	{
+		wstring assetPath = GetTemporaryFilePath(L"SpeckTests_knight.speckasset");
+		CHECK(SpeckAssetCooker::Cook(&sceneManager, fbxFilePath, assetPath.c_str()));
+		FbxScene *scene = sceneManager.GetScene(fbxFilePath);
+		SpeckAssetFile asset;
+		CHECK(scene != nullptr && asset.Open(assetPath.c_str()));
+		if (!scene || asset.GetMeshCount() == 0)
+		{
+			DeleteFileW(assetPath.c_str());
+			continue;
+		}
+
+		UINT fbxMeshCount = 0;
+		for (int n = 0; n < scene->GetNodeCount(); ++n)
+			fbxMeshCount += (scene->GetNode(n)->GetMesh() != nullptr);
+		CHECK(asset.GetMeshCount() == fbxMeshCount);
+
+		UINT cornerCount = 0, vertexCount = 0;
+		float positionError = 0.0f, weightError = 0.0f, bindPoseError = 0.0f;
+		for (UINT m = 0; m < asset.GetMeshCount(); ++m)
+		{
+			const Mesh &mesh = asset.GetMesh(m);
+			FbxNode *node = scene->FindNodeByName(asset.GetString(asset.GetNode(mesh.node).name));
+			CHECK(node != nullptr && node->GetMesh() != nullptr);
+			if (!node || !node->GetMesh())
+				continue;
+			FbxMesh *fbxMesh = node->GetMesh();
+			FbxAMatrix world = node->EvaluateGlobalTransform();
+			FbxStringList uvSetNames;
+			fbxMesh->GetUVSetNames(uvSetNames);
+			vector<vector<Influence>> influences = GetInfluences(fbxMesh);
+			const AppCommands::StaticMeshVertex *vertices = asset.GetVertices(mesh);
+			const VertexWeights *vertexWeights = asset.GetVertexWeights(mesh);
+			const uint32_t *indices = asset.GetIndices(mesh);
+			const Cluster *clusters = asset.GetClusters(mesh);
+			vertexCount += mesh.vertexCount;
+
+			// The polygons are triangulated as fans in their order
+			UINT index = 0;
+			for (int i = 0; i < fbxMesh->GetPolygonCount(); ++i)
+			{
+				for (int j = 1; j + 1 < fbxMesh->GetPolygonSize(i); ++j)
+				{
+					for (int corner : { 0, j, j + 1 })
+					{
+						CHECK(index < mesh.indexCount);
+						if (index >= mesh.indexCount)
+							break;
+						uint32_t v = indices[index++];
+						CHECK(v < mesh.vertexCount);
+						if (v >= mesh.vertexCount)
+							continue;
+						++cornerCount;
+
+						int controlPointIndex = fbxMesh->GetPolygonVertex(i, corner);
+						FbxVector4 controlPoint = fbxMesh->GetControlPoints()[controlPointIndex];
+						controlPoint.mData[3] = 1.0;
+						FbxVector4 position = world.MultT(controlPoint);
+						positionError = max(positionError, GetDistance(vertices[v].Position, XMFLOAT3((float)position.mData[0], (float)position.mData[1], (float)position.mData[2])));
+						FbxVector4 normal;
+						fbxMesh->GetPolygonVertexNormal(i, corner, normal);
+						CHECK(GetDistance(vertices[v].Normal, XMFLOAT3((float)normal.mData[0], (float)normal.mData[1], (float)normal.mData[2])) < 1e-5f);
+						FbxVector2 uv;
+						bool unmapped;
+						if (uvSetNames.GetCount() > 0 && fbxMesh->GetPolygonVertexUV(i, corner, uvSetNames[0], uv, unmapped))
+							CHECK(vertices[v].TexC.x == (float)uv.mData[0] && vertices[v].TexC.y == (float)uv.mData[1]);
+
+						const vector<Influence> &expected = influences[controlPointIndex];
+						for (UINT k = 0; k < MAX_BONES_PER_VERTEX; ++k)
+						{
+							if (k >= expected.size())
+							{
+								CHECK(vertexWeights[v].weights[k] == 0.0f);
+								continue;
+							}
+							weightError = max(weightError, fabsf(vertexWeights[v].weights[k] - expected[k].Weight));
+							uint32_t cluster = vertexWeights[v].clusters[k];
+							CHECK(cluster < mesh.clusterCount);
+							if (cluster < mesh.clusterCount)
+								CHECK(expected[k].LinkName == asset.GetString(asset.GetNode(clusters[cluster].linkNode).name));
+						}
+					}
+				}
+			}
+			CHECK(index == mesh.indexCount);
+
+			// The inverse of the cooked bind pose of every cluster against the inverse the FBX SDK computes
+			int skinClusterCount = 0;
+			if (fbxMesh->GetDeformerCount(FbxDeformer::eSkin) > 0)
+			{
+				FbxSkin *skin = (FbxSkin *)fbxMesh->GetDeformer(0, FbxDeformer::eSkin);
+				skinClusterCount = skin->GetClusterCount();
+				for (int c = 0; c < skinClusterCount && c < (int)mesh.clusterCount; ++c)
+				{
+					FbxAMatrix bindPose;
+					skin->GetCluster(c)->GetTransformLinkMatrix(bindPose);
+					XMFLOAT4X4 expected, inverseBindPose;
+					Conv(&expected, bindPose.Inverse());
+					XMStoreFloat4x4(&inverseBindPose, XMMatrixInverse(nullptr, XMLoadFloat4x4(&clusters[c].bindPose)));
+					bindPoseError = max(bindPoseError, GetMatrixError(inverseBindPose, expected));
+					CHECK(string(skin->GetCluster(c)->GetLink()->GetName()) == asset.GetString(asset.GetNode(clusters[c].linkNode).name));
+				}
+			}
+			CHECK((int)mesh.clusterCount == skinClusterCount);
+		}
+		asset.Close();
+		DeleteFileW(assetPath.c_str());
+
+		string name = WStrToStr(fbxFilePath);
+		TestRegistry::ReportValue(name + " corners", cornerCount, "corners");
+		TestRegistry::ReportValue(name + " vertices", vertexCount, "vertices");
+		TestRegistry::ReportValue(name + " position error", positionError, "m");
+		TestRegistry::ReportValue(name + " weight error", weightError, "");
+		TestRegistry::ReportValue(name + " inverse bind pose error", bindPoseError, "");
+		CHECK(cornerCount > 0 && vertexCount <= cornerCount);
+		CHECK(positionError < 1e-5f);
+		CHECK(weightError < 1e-6f);
+		CHECK(bindPoseError < 1e-4f);
+	}
+}
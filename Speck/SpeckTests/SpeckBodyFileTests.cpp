@@ -0,0 +1,186 @@
+#include "TestFramework.h"
+#include "SpeckBodyFile.h"
+#include "SpeckBodyCompiler.h"
+#include "Json.h"
+
+using namespace std;
+using namespace DirectX;
+using json = nlohmann::json;
+
+namespace
+{
+	// Two bones share the "Spine" name, the lookup has to return the first one as the JSON search did.
+	const char *gBodyJson = R"({
+		"bones": [
+			{ "bones": [ "Hips", "Spine" ], "specks": [ { "x": 0.0, "y": 1.0, "z": 0.0 }, { "x": 0.5, "y": 1.0, "z": -0.25 } ] },
+			{ "bones": [ "Spine", "Chest" ], "specks": [ { "x": 0.0, "y": 2.0, "z": 0.0 } ] },
+			{ "bones": [ "Head" ], "specks": [] }
+		],
+		"joints": [
+			{ "pairs": [ { "parentBoneName": "Hips", "childBoneName": "Chest" } ], "specks": [ { "x": 0.0, "y": 1.5, "z": 0.125 } ] },
+			{ "pairs": [ { "parentBoneName": "Chest", "childBoneName": "Head" }, { "parentBoneName": "Spine", "childBoneName": "Head" } ], "specks": [] }
+		]
+	})";
+
+	bool WriteFile(const wstring &path, const void *data, size_t size)
+	{
+		ofstream file(path, ios::out | ios::binary | ios::trunc);
+		file.write(reinterpret_cast<const char *>(data), size);
+		return file.good();
+	}
+
+	vector<char> ReadFile(const wstring &path)
+	{
+		ifstream file(path, ios::in | ios::binary);
+		return vector<char>((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	}
+
+	bool AreEqual(const XMFLOAT3 &a, const XMFLOAT3 &b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+}
+
+TEST(SpeckBodyFile_RoundTrip)
+{
+	wstring jsonPath = GetTemporaryFilePath(L"SpeckTests_body.json");
+	wstring bodyPath = GetTemporaryFilePath(L"SpeckTests_body.speckbody");
+	CHECK(WriteFile(jsonPath, gBodyJson, strlen(gBodyJson)));
+	CHECK(SpeckBodyCompiler::Compile(jsonPath.c_str(), bodyPath.c_str()));
+
+	SpeckBodyFile file;
+	CHECK(file.Open(bodyPath.c_str()));
+	CHECK(file.GetBoneCount() == 3);
+	CHECK(file.GetBoneNameCount() == 5);
+	CHECK(file.GetJointCount() == 2);
+
+	CHECK(file.FindBone("Hips", 4) == 0);
+	CHECK(file.FindBone("Spine", 5) == 0);
+	CHECK(file.FindBone("Chest", 5) == 1);
+	CHECK(file.FindBone("Head", 4) == 2);
+	CHECK(file.FindBone("Neck", 4) == -1);
+	// Only the given length of the name is compared
+	CHECK(file.FindBone("Headless", 4) == 2);
+
+	UINT count;
+	const XMFLOAT3 *specks = file.GetBoneSpecks(0, &count);
+	CHECK(count == 2 && AreEqual(specks[1], XMFLOAT3(0.5f, 1.0f, -0.25f)));
+	specks = file.GetBoneSpecks(1, &count);
+	CHECK(count == 1 && AreEqual(specks[0], XMFLOAT3(0.0f, 2.0f, 0.0f)));
+	file.GetBoneSpecks(2, &count);
+	CHECK(count == 0);
+
+	const SpeckBodyFormat::Joint &joint = file.GetJoint(1);
+	CHECK(joint.pairCount == 2);
+	CHECK(strcmp(file.GetString(file.GetJointPair(joint.firstPair).parentBoneName), "Chest") == 0);
+	CHECK(strcmp(file.GetString(file.GetJointPair(joint.firstPair + 1).parentBoneName), "Spine") == 0);
+	CHECK(strcmp(file.GetString(file.GetJointPair(joint.firstPair + 1).childBoneName), "Head") == 0);
+	specks = file.GetJointSpecks(0, &count);
+	CHECK(count == 1 && AreEqual(specks[0], XMFLOAT3(0.0f, 1.5f, 0.125f)));
+
+	file.Close();
+	DeleteFileW(jsonPath.c_str());
+	DeleteFileW(bodyPath.c_str());
+}
+
+// The body of the knight in the app data, against the JSON read directly.
+TEST(SpeckBodyFile_KnightMatchesJson)
+{
+	wstring bodyPath = GetTemporaryFilePath(L"SpeckTests_knight.speckbody");
+	CHECK(SpeckBodyCompiler::Compile(L"Data/Animations/knight.json", bodyPath.c_str()));
+	SpeckBodyFile file;
+	CHECK(file.Open(bodyPath.c_str()));
+
+	ifstream jsonFile("Data/Animations/knight.json");
+	json j = json::parse(string((istreambuf_iterator<char>(jsonFile)), istreambuf_iterator<char>()));
+	CHECK(file.GetBoneCount() == j["bones"].size());
+	CHECK(file.GetJointCount() == j["joints"].size());
+	for (UINT b = 0; b < file.GetBoneCount(); ++b)
+	{
+		const json &bone = j["bones"][b];
+		UINT count;
+		const XMFLOAT3 *specks = file.GetBoneSpecks(b, &count);
+		CHECK(count == bone["specks"].size());
+		for (UINT s = 0; s < count && s < bone["specks"].size(); ++s)
+			CHECK(specks[s].y == bone["specks"][s]["y"].get<float>());
+		for (const json &name : bone["bones"])
+		{
+			string nameString = name.get<string>();
+			CHECK(file.FindBone(nameString.c_str(), nameString.size()) != -1);
+		}
+	}
+
+	file.Close();
+	DeleteFileW(bodyPath.c_str());
+}
+
+// Damaged files are rejected when they are opened, not when they are read.
+TEST(SpeckBodyFile_RejectsDamagedFiles)
+{
+	wstring jsonPath = GetTemporaryFilePath(L"SpeckTests_body.json");
+	wstring bodyPath = GetTemporaryFilePath(L"SpeckTests_body.speckbody");
+	wstring damagedPath = GetTemporaryFilePath(L"SpeckTests_damaged.speckbody");
+	CHECK(WriteFile(jsonPath, gBodyJson, strlen(gBodyJson)));
+	CHECK(SpeckBodyCompiler::Compile(jsonPath.c_str(), bodyPath.c_str()));
+	const vector<char> original = ReadFile(bodyPath);
+	CHECK(original.size() > sizeof(SpeckBodyFormat::Header));
+
+	SpeckBodyFile file;
+	auto opensWith = [&](const vector<char> &data)
+	{
+		CHECK(WriteFile(damagedPath, data.data(), data.size()));
+		bool opened = file.Open(damagedPath.c_str());
+		file.Close();
+		return opened;
+	};
+	CHECK(opensWith(original));
+
+	// Truncated
+	CHECK(!opensWith(vector<char>(original.begin(), original.begin() + original.size() / 2)));
+	CHECK(!opensWith(vector<char>(original.begin(), original.begin() + sizeof(SpeckBodyFormat::Header) / 2)));
+
+	// Wrong magic and version
+	vector<char> damaged = original;
+	damaged[0] = 'X';
+	CHECK(!opensWith(damaged));
+	damaged = original;
+	reinterpret_cast<SpeckBodyFormat::Header *>(damaged.data())->version = SpeckBodyFormat::Version + 1;
+	CHECK(!opensWith(damaged));
+
+	// Section out of the file
+	damaged = original;
+	reinterpret_cast<SpeckBodyFormat::Header *>(damaged.data())->specks.count += 1000;
+	CHECK(!opensWith(damaged));
+
+	// Bone pointing past the specks
+	damaged = original;
+	const SpeckBodyFormat::Header *header = reinterpret_cast<const SpeckBodyFormat::Header *>(original.data());
+	reinterpret_cast<SpeckBodyFormat::Bone *>(damaged.data() + header->bones.offset)->firstSpeck = header->specks.count;
+	CHECK(!opensWith(damaged));
+
+	// String without the null character
+	damaged = original;
+	damaged[header->strings.offset + header->strings.count - 1] = 'X';
+	CHECK(!opensWith(damaged));
+
+	// Hash table without an empty slot, FindBone would probe it forever
+	damaged = original;
+	uint32_t *hashTable = reinterpret_cast<uint32_t *>(damaged.data() + header->hashTable.offset);
+	for (UINT i = 0; i < header->hashTable.count; ++i)
+		hashTable[i] = 1;
+	CHECK(!opensWith(damaged));
+
+	// A name in the table twice and another one missing
+	damaged = original;
+	hashTable = reinterpret_cast<uint32_t *>(damaged.data() + header->hashTable.offset);
+	for (UINT i = 0; i < header->hashTable.count; ++i)
+	{
+		if (hashTable[i] > 1)
+			hashTable[i] = 1;
+	}
+	CHECK(!opensWith(damaged));
+
+	DeleteFileW(jsonPath.c_str());
+	DeleteFileW(bodyPath.c_str());
+	DeleteFileW(damagedPath.c_str());
+}
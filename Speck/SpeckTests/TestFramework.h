@@ -0,0 +1,78 @@
+#ifndef TEST_FRAMEWORK_H
+#define TEST_FRAMEWORK_H
+
+// No SpeckEngineDefinitions.h here, the harness builds without the Windows headers so that the portable units can
+// be tested everywhere (see CMakeLists.txt).
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+// Test or benchmark, registered by the TEST and BENCHMARK macros.
+struct TestCase
+{
+	const char *mName;
+	void (*mFunction)();
+	bool mBenchmark;
+};
+
+//-------------------------------------------------------------------------------------
+//	Runs the tests of all the files linked into the executable. A failed check is
+//	reported and the test goes on, so one run shows all of the failures. The
+//	benchmarks only run when they are asked for.
+//-------------------------------------------------------------------------------------
+class TestRegistry
+{
+public:
+	static std::vector<TestCase> &GetTestCases();
+
+	struct Registrar
+	{
+		Registrar(const char *name, void (*function)(), bool benchmark) { GetTestCases().push_back({ name, function, benchmark }); }
+	};
+
+	static void ReportFailure(const char *file, int line, const char *expression);
+	// Prints a measurement of a test or a benchmark, the only way they report their results. Counts and ratios
+	// without a unit pass an empty one.
+	static void ReportValue(const std::string &name, double value, const char *unit);
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistry::Registrar name##Registrar(#name, name, false); \
+	static void name()
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static TestRegistry::Registrar name##Registrar(#name, name, true); \
+	static void name()
+
+// Path of the file in the temporary directory, for the tests that write files. The narrow path is for the units
+// that take std::string paths, std::remove deletes the file.
+std::wstring GetTemporaryFilePath(const wchar_t *fileName);
+std::string GetTemporaryFilePath(const char *fileName);
+
+#define CHECK(expression) \
+	do { if (!(expression)) TestRegistry::ReportFailure(__FILE__, __LINE__, #expression); } while (false)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+	CHECK(fabs((double)(value) - (double)(expected)) <= (double)(tolerance))
+
+// Fastest of the given number of runs of the function, in milliseconds.
+template<typename Function>
+double MeasureMilliseconds(unsigned int runs, Function function)
+{
+	double best = DBL_MAX;
+	for (unsigned int r = 0; r < runs; ++r)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		function();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (elapsed.count() < best)
+			best = elapsed.count();
+	}
+	return best;
+}
+
+#endif
@@ -0,0 +1,231 @@
+#include "TestFramework.h"
+#include <TextMeshLoader.h>
+#include <MemoryMappedFile.h>
+#include <WorkerPool.h>
+#include <random>
+#include <cstdio>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	// Quad of two triangles, with the blanks, signs and exponents the exporters write.
+	const char *gQuadText =
+		"VertexCount: 4\n"
+		"TriangleCount: 2\n"
+		"VertexList (pos, normal)\n"
+		"{\n"
+		"\t-1 -2.5 0.0 0 0 -1\n"
+		"\t1.5e0 -2.5 +0 0 0 -1\r\n"
+		"\t1.5 2.5E-0 0 0.0 0.0 -1.0   \n"
+		"\t-1.0 25e-1 0 0 0 -1\n"
+		"}\n"
+		"TriangleList\n"
+		"{\n"
+		"\t0 1 2\n"
+		"\t0 2 3\n"
+		"}\n";
+
+	// Grid of the given size in the text format, with numbers in the format of the exporters.
+	string CreateGridText(UINT size)
+	{
+		mt19937 random(7);
+		uniform_real_distribution<float> noise(-0.01f, 0.01f);
+		ostringstream text;
+		text << "VertexCount: " << size * size << "\nTriangleCount: " << (size - 1) * (size - 1) * 2 << "\nVertexList (pos, normal)\n{\n";
+		text.precision(6);
+		for (UINT y = 0; y < size; ++y)
+			for (UINT x = 0; x < size; ++x)
+				text << "\t" << x * 0.1f << " " << noise(random) << " " << y * -0.1f << " " << noise(random) << " 0.999 " << noise(random) << "\n";
+		text << "}\nTriangleList\n{\n";
+		for (UINT y = 0; y + 1 < size; ++y)
+			for (UINT x = 0; x + 1 < size; ++x)
+			{
+				UINT i = y * size + x;
+				text << "\t" << i << " " << i + size << " " << i + 1 << "\n";
+				text << "\t" << i + 1 << " " << i + size << " " << i + size + 1 << "\n";
+			}
+		text << "}\n";
+		return text.str();
+	}
+
+	bool Parse(const string &text, WorkerPool *workerPool, GeometryGenerator::StaticMeshData *outMesh, BoundingBox *outBounds = nullptr)
+	{
+		BoundingBox bounds;
+		return TextMeshLoader::Parse(text.data(), text.size(), workerPool, outMesh, outBounds ? outBounds : &bounds);
+	}
+
+	void WriteFile(const wstring &path, const string &text)
+	{
+		ofstream file(path, ios::out | ios::binary | ios::trunc);
+		file.write(text.data(), text.size());
+	}
+}
+
+TEST(TextMeshLoader_ParsesValues)
+{
+	GeometryGenerator::StaticMeshData mesh;
+	BoundingBox bounds;
+	CHECK(Parse(gQuadText, nullptr, &mesh, &bounds));
+	CHECK(mesh.Vertices.size() == 4);
+	CHECK(mesh.Indices32 == vector<uint32_t>({ 0, 1, 2, 0, 2, 3 }));
+	CHECK(mesh.Vertices[1].Position.x == 1.5f && mesh.Vertices[1].Position.z == 0.0f);
+	CHECK(mesh.Vertices[2].Position.y == 2.5f && mesh.Vertices[3].Position.y == 2.5f);
+	CHECK(mesh.Vertices[2].Normal.z == -1.0f);
+
+	// Tangents are perpendicular to the normals
+	for (const GeometryGenerator::StaticVertex &v : mesh.Vertices)
+	{
+		CHECK_NEAR(XMVectorGetX(XMVector3Dot(XMLoadFloat3(&v.TangentU), XMLoadFloat3(&v.Normal))), 0.0f, 1e-5f);
+		CHECK_NEAR(XMVectorGetX(XMVector3Length(XMLoadFloat3(&v.TangentU))), 1.0f, 1e-5f);
+	}
+
+	CHECK_NEAR(bounds.Center.x, 0.25f, 1e-6f);
+	CHECK_NEAR(bounds.Center.y, 0.0f, 1e-6f);
+	CHECK_NEAR(bounds.Extents.x, 1.25f, 1e-6f);
+	CHECK_NEAR(bounds.Extents.y, 2.5f, 1e-6f);
+}
+
+// The numbers are read as exactly as the C library reads them, up to the last bit of the float.
+TEST(TextMeshLoader_ParsesFloatsLikeStrtof)
+{
+	mt19937 random(11);
+	uniform_real_distribution<double> mantissa(-10.0, 10.0);
+	uniform_int_distribution<int> exponent(-20, 20);
+	const UINT count = 3000;
+	ostringstream text;
+	text << "VertexCount: " << count << "\nTriangleCount: 0\nVertexList\n{\n";
+	vector<string> numbers;
+	for (UINT i = 0; i < count * 6; ++i)
+	{
+		char number[32];
+		snprintf(number, sizeof(number), (i % 3 == 0) ? "%.9g" : "%.6f", mantissa(random) * pow(10.0, exponent(random) / 4));
+		numbers.push_back(number);
+		text << number << ((i % 6 == 5) ? "\n" : " ");
+	}
+	text << "}\nTriangleList\n{\n}\n";
+
+	GeometryGenerator::StaticMeshData mesh;
+	CHECK(Parse(text.str(), nullptr, &mesh));
+	UINT mismatches = 0;
+	for (UINT i = 0; i < count && i < mesh.Vertices.size(); ++i)
+	{
+		const GeometryGenerator::StaticVertex &v = mesh.Vertices[i];
+		const float values[6] = { v.Position.x, v.Position.y, v.Position.z, v.Normal.x, v.Normal.y, v.Normal.z };
+		for (UINT k = 0; k < 6; ++k)
+		{
+			float expected = strtof(numbers[i * 6 + k].c_str(), nullptr);
+			// One unit in the last place at most
+			int32_t a, b;
+			memcpy(&a, &values[k], sizeof(float));
+			memcpy(&b, &expected, sizeof(float));
+			CHECK(abs(a - b) <= 1);
+			mismatches += (a != b) ? 1 : 0;
+		}
+	}
+	TestRegistry::ReportValue("Numbers off by one unit in the last place", mismatches, "");
+}
+
+TEST(TextMeshLoader_RejectsInvalidFiles)
+{
+	GeometryGenerator::StaticMeshData mesh;
+	string valid = gQuadText;
+	CHECK(Parse(valid, nullptr, &mesh));
+
+	auto replace = [&](const char *from, const char *to)
+	{
+		string text = valid;
+		text.replace(text.find(from), strlen(from), to);
+		return text;
+	};
+	CHECK(!Parse(replace("VertexCount: 4", "VertexCount: 5"), nullptr, &mesh));
+	CHECK(!Parse(replace("TriangleCount: 2", "TriangleCount: 1"), nullptr, &mesh));
+	CHECK(!Parse(replace("\t0 2 3\n", "\t0 2 4\n"), nullptr, &mesh));
+	CHECK(!Parse(replace("\t0 2 3\n", "\t0 2\n"), nullptr, &mesh));
+	CHECK(!Parse(replace("\t0 2 3\n", "\t0 2 3 4\n"), nullptr, &mesh));
+	CHECK(!Parse(replace("25e-1", "two"), nullptr, &mesh));
+	CHECK(!Parse(replace("TriangleList", "Triangles"), nullptr, &mesh));
+	CHECK(!Parse(replace("VertexCount: 4", "VertexCount: 99999999999"), nullptr, &mesh));
+	CHECK(!Parse(valid.substr(0, valid.size() - 3), nullptr, &mesh));
+	CHECK(!Parse("", nullptr, &mesh));
+}
+
+// The chunks parsed on the worker threads join up to the same mesh.
+TEST(TextMeshLoader_WorkerPoolMatchesSerial)
+{
+	string text = CreateGridText(300);
+	CHECK(text.size() > 8 * 64 * 1024);
+	GeometryGenerator::StaticMeshData serial, parallel;
+	BoundingBox serialBounds, parallelBounds;
+	CHECK(Parse(text, nullptr, &serial, &serialBounds));
+	WorkerPool workerPool;
+	CHECK(Parse(text, &workerPool, &parallel, &parallelBounds));
+	CHECK(serial.Vertices.size() == 300 * 300);
+	CHECK(serial.Indices32 == parallel.Indices32);
+	CHECK(serial.Vertices.size() == parallel.Vertices.size());
+	CHECK(memcmp(serial.Vertices.data(), parallel.Vertices.data(), serial.Vertices.size() * sizeof(GeometryGenerator::StaticVertex)) == 0);
+	CHECK(memcmp(&serialBounds, &parallelBounds, sizeof(BoundingBox)) == 0);
+}
+
+// The first load writes the cache, it is used until the text file changes.
+TEST(TextMeshLoader_Cache)
+{
+	wstring textPath = GetTemporaryFilePath(L"SpeckTests_grid.txt");
+	wstring cachePath = GetTemporaryFilePath(L"SpeckTests_grid.speckmesh");
+	DeleteFileW(cachePath.c_str());
+	WriteFile(textPath, CreateGridText(40));
+
+	GeometryGenerator::StaticMeshData mesh, cachedMesh;
+	BoundingBox bounds, cachedBounds;
+	vector<MeshLOD> lods, cachedLODs;
+	CHECK(TextMeshLoader::Load(textPath.c_str(), nullptr, &mesh, &bounds, &lods));
+	CHECK(mesh.Indices32.size() == 39 * 39 * 6);
+	CHECK(lods.size() == TextMeshLoader::LODCount - 1);
+	for (size_t l = 1; l < lods.size(); ++l)
+		CHECK(lods[l].indices.size() < lods[l - 1].indices.size());
+
+	// Without the text file only the cache can be loaded
+	DeleteFileW(textPath.c_str());
+	CHECK(TextMeshLoader::Load(textPath.c_str(), nullptr, &cachedMesh, &cachedBounds, &cachedLODs));
+	CHECK(cachedMesh.Indices32 == mesh.Indices32);
+	CHECK(cachedMesh.Vertices.size() == mesh.Vertices.size());
+	CHECK(memcmp(cachedMesh.Vertices.data(), mesh.Vertices.data(), mesh.Vertices.size() * sizeof(GeometryGenerator::StaticVertex)) == 0);
+	CHECK(memcmp(&cachedBounds, &bounds, sizeof(BoundingBox)) == 0);
+	CHECK(cachedLODs.size() == lods.size());
+	for (size_t l = 0; l < lods.size() && l < cachedLODs.size(); ++l)
+	{
+		CHECK(cachedLODs[l].indices == lods[l].indices);
+		CHECK(cachedLODs[l].error == lods[l].error);
+	}
+
+	// A changed text file replaces the cache
+	WriteFile(textPath, gQuadText);
+	CHECK(TextMeshLoader::Load(textPath.c_str(), nullptr, &mesh, &bounds, &lods));
+	CHECK(mesh.Vertices.size() == 4);
+
+	DeleteFileW(textPath.c_str());
+	DeleteFileW(cachePath.c_str());
+}
+
+BENCHMARK(TextMeshLoader_ParseSkull)
+{
+	MemoryMappedFile file;
+	CHECK(file.Open(L"Data/Models/skull.txt"));
+	if (!file.GetData())
+		return;
+	const char *text = reinterpret_cast<const char *>(file.GetData());
+	size_t size = (size_t)file.GetSize();
+
+	WorkerPool workerPool;
+	GeometryGenerator::StaticMeshData mesh;
+	BoundingBox bounds;
+	double serial = MeasureMilliseconds(5, [&]() { TextMeshLoader::Parse(text, size, nullptr, &mesh, &bounds); });
+	double parallel = MeasureMilliseconds(5, [&]() { TextMeshLoader::Parse(text, size, &workerPool, &mesh, &bounds); });
+	TestRegistry::ReportValue("File size", size / 1e6, "MB");
+	TestRegistry::ReportValue("Parse", serial, "ms");
+	TestRegistry::ReportValue("Parse throughput", size / 1e3 / serial, "MB/s");
+	TestRegistry::ReportValue("Parse with the worker pool", parallel, "ms");
+	TestRegistry::ReportValue("Parse throughput with the worker pool", size / 1e3 / parallel, "MB/s");
+}
@@ -0,0 +1,144 @@
+#include "TestFramework.h"
+#include "VertexWelder.h"
+#include "FBXConversions.h"
+#include <random>
+
+using namespace std;
+using namespace DirectX;
+using namespace Speck;
+
+namespace
+{
+	// Welding as ProcessRenderSkin did before the welder, by searching all the vertices added so far.
+	template <typename Vertex>
+	vector<uint32_t> WeldLinear(const vector<Vertex> &corners, vector<Vertex> *outVertices)
+	{
+		vector<uint32_t> indices;
+		for (const Vertex &corner : corners)
+		{
+			uint32_t index = 0;
+			while (index < outVertices->size() && !AreVerticesEqual((*outVertices)[index], corner))
+				++index;
+			if (index == outVertices->size())
+				outVertices->push_back(corner);
+			indices.push_back(index);
+		}
+		return indices;
+	}
+
+	template <typename Vertex>
+	vector<uint32_t> Weld(const vector<Vertex> &corners, vector<Vertex> *outVertices)
+	{
+		VertexWelder<Vertex> welder(outVertices, corners.size());
+		vector<uint32_t> indices;
+		for (const Vertex &corner : corners)
+			indices.push_back(welder.Add(corner));
+		return indices;
+	}
+
+	// The polygon corners of all the meshes of the file, with the attributes the cooker welds on.
+	vector<AppCommands::StaticMeshVertex> GetPolygonCorners(FbxManager *manager, const char *filePath)
+	{
+		vector<AppCommands::StaticMeshVertex> corners;
+		FbxImporter *importer = FbxImporter::Create(manager, "");
+		FbxScene *scene = FbxScene::Create(manager, filePath);
+		if (importer->Initialize(filePath, -1, manager->GetIOSettings()) && importer->Import(scene))
+		{
+			for (int n = 0; n < scene->GetNodeCount(); ++n)
+			{
+				FbxMesh *mesh = scene->GetNode(n)->GetMesh();
+				if (!mesh)
+					continue;
+				FbxStringList uvSetNames;
+				mesh->GetUVSetNames(uvSetNames);
+				for (int i = 0; i < mesh->GetPolygonCount(); ++i)
+				{
+					for (int j = 0; j < mesh->GetPolygonSize(i); ++j)
+					{
+						AppCommands::StaticMeshVertex vert = {};
+						FbxVector4 position = mesh->GetControlPoints()[mesh->GetPolygonVertex(i, j)];
+						vert.Position = XMFLOAT3((float)position.mData[0], (float)position.mData[1], (float)position.mData[2]);
+						FbxVector4 normal;
+						mesh->GetPolygonVertexNormal(i, j, normal);
+						vert.Normal = XMFLOAT3((float)normal.mData[0], (float)normal.mData[1], (float)normal.mData[2]);
+						FbxVector2 uv;
+						bool unmapped;
+						if (uvSetNames.GetCount() > 0 && mesh->GetPolygonVertexUV(i, j, uvSetNames[0], uv, unmapped))
+							vert.TexC = XMFLOAT2((float)uv.mData[0], (float)uv.mData[1]);
+						corners.push_back(vert);
+					}
+				}
+			}
+		}
+		importer->Destroy();
+		scene->Destroy();
+		return corners;
+	}
+}
+
+// Equal vertices get the index of the first one, in the order they were first added, through the growth of the table.
+TEST(VertexWelder_MatchesLinearSearch)
+{
+	mt19937 random(1);
+	uniform_int_distribution<int> value(-3, 3);
+	vector<AppCommands::StaticMeshVertex> corners;
+	for (UINT i = 0; i < 5000; ++i)
+	{
+		AppCommands::StaticMeshVertex vert = {};
+		vert.Position = XMFLOAT3((float)value(random), (float)value(random), (float)value(random));
+		vert.Normal = XMFLOAT3(0.0f, (float)(value(random) & 1), 0.0f);
+		vert.TexC = XMFLOAT2(0.5f * value(random), 0.0f);
+		corners.push_back(vert);
+	}
+
+	vector<AppCommands::StaticMeshVertex> welded, expected;
+	vector<uint32_t> indices = Weld(corners, &welded);
+	CHECK(indices == WeldLinear(corners, &expected));
+	CHECK(welded.size() == expected.size() && welded.size() < corners.size());
+	for (size_t i = 0; i < welded.size() && i < expected.size(); ++i)
+		CHECK(memcmp(&welded[i], &expected[i], sizeof(AppCommands::StaticMeshVertex)) == 0);
+
+	// Zero and negative zero are the same vertex
+	AppCommands::StaticMeshVertex zero = {}, negativeZero = {};
+	negativeZero.Position.x = -0.0f;
+	negativeZero.TexC.y = -0.0f;
+	vector<AppCommands::StaticMeshVertex> vertices;
+	VertexWelder<AppCommands::StaticMeshVertex> welder(&vertices);
+	bool added = false;
+	CHECK(welder.Add(zero, &added) == 0 && added);
+	CHECK(welder.Add(negativeZero, &added) == 0 && !added);
+	CHECK(vertices.size() == 1);
+}
+
+// The polygon corners of the knight files welded as the cooker does, against the linear search of the vertices.
+BENCHMARK(VertexWelder_KnightMeshes)
+{
+	FbxManager *manager = FbxManager::Create();
+	manager->SetIOSettings(FbxIOSettings::Create(manager, IOSROOT));
+	for (const char *filePath : { "Data/Animations/knight_idle.fbx", "Data/Animations/knight_jump.fbx", "Data/Animations/knight_dancing.fbx" })
+	{
+		vector<AppCommands::StaticMeshVertex> corners = GetPolygonCorners(manager, filePath);
+		CHECK(!corners.empty());
+
+		vector<AppCommands::StaticMeshVertex> welded, expected;
+		vector<uint32_t> indices, expectedIndices;
+		double hashed = MeasureMilliseconds(5, [&]()
+		{
+			welded.clear();
+			indices = Weld(corners, &welded);
+		});
+		double linear = MeasureMilliseconds(1, [&]()
+		{
+			expected.clear();
+			expectedIndices = WeldLinear(corners, &expected);
+		});
+		CHECK(indices == expectedIndices && welded.size() == expected.size());
+
+		string name = filePath;
+		TestRegistry::ReportValue(name + " corners", (double)corners.size(), "corners");
+		TestRegistry::ReportValue(name + " welded vertices", (double)welded.size(), "vertices");
+		TestRegistry::ReportValue(name + " hash table", hashed, "ms");
+		TestRegistry::ReportValue(name + " linear search", linear, "ms");
+	}
+	manager->Destroy();
+}